@@ -0,0 +1,412 @@
+// CollisionMaskBuilder - Builds .cmask collision mask files from textures so that the game can load collision masks (see DX::LoadCollisionMask)
+// without reading the textures back from the GPU.
+//
+// Usage: CollisionMaskBuilder <input texture> [<output file>]
+//
+// The input can be a DDS file or any format that WIC can decode (PNG, BMP, JPG, etc.). The output defaults to the input file name with a .cmask
+// extension. Only the top mip level of a DDS file is used. Supported DDS formats:
+// DXGI_FORMAT_B8G8R8A8_UNORM (and _SRGB)
+// DXGI_FORMAT_R8G8B8A8_UNORM (and _SRGB)
+// DXGI_FORMAT_A8_UNORM
+// DXGI_FORMAT_BC1_UNORM (and _SRGB)
+// DXGI_FORMAT_BC3_UNORM (and _SRGB)
+// DXGI_FORMAT_BC4_UNORM (the single channel is used as alpha)
+// DXGI_FORMAT_BC5_UNORM (always opaque)
+// DXGI_FORMAT_BC4_SNORM (negative values are transparent)
+// DXGI_FORMAT_BC5_SNORM (always opaque)
+// DXGI_FORMAT_BC7_UNORM (and _SRGB)
+// along with the equivalent legacy (non-DX10 header) 32-bit and 8-bit alpha formats and the DXT1, DXT4, DXT5, ATI1, BC4U, BC4S, ATI2, BC5U,
+// and BC5S FourCC codes.
+
+#include <Windows.h>
+#include <wincodec.h>
+#include <wrl\client.h>
+
+#include <cstdint>
+#include <cstdio>
+#include <fstream>
+#include <iterator>
+#include <string>
+#include <vector>
+
+#include "BlockCompression.h"
+#include "CollisionMask.h"
+
+using Microsoft::WRL::ComPtr;
+
+namespace
+{
+	// The DDS file structures. These match the layouts documented for the DDS file format.
+	const uint32_t DdsMagic = 0x20534444; // "DDS "
+
+	const uint32_t DdsPixelFormatAlpha = 0x00000002;	// DDPF_ALPHA
+	const uint32_t DdsPixelFormatFourCC = 0x00000004;	// DDPF_FOURCC
+	const uint32_t DdsPixelFormatRgb = 0x00000040;		// DDPF_RGB
+
+	const uint32_t DdsFourCCDx10 = 0x30315844; // "DX10"
+	const uint32_t DdsFourCCDxt1 = 0x31545844; // "DXT1"
+	const uint32_t DdsFourCCDxt4 = 0x34545844; // "DXT4"
+	const uint32_t DdsFourCCDxt5 = 0x35545844; // "DXT5"
+	const uint32_t DdsFourCCAti1 = 0x31495441; // "ATI1"
+	const uint32_t DdsFourCCBc4u = 0x55344342; // "BC4U"
+	const uint32_t DdsFourCCBc4s = 0x53344342; // "BC4S"
+	const uint32_t DdsFourCCAti2 = 0x32495441; // "ATI2"
+	const uint32_t DdsFourCCBc5u = 0x55354342; // "BC5U"
+	const uint32_t DdsFourCCBc5s = 0x53354342; // "BC5S"
+
+	const uint32_t DxgiFormatR8G8B8A8Unorm = 28;
+	const uint32_t DxgiFormatR8G8B8A8UnormSrgb = 29;
+	const uint32_t DxgiFormatA8Unorm = 65;
+	const uint32_t DxgiFormatBC1Unorm = 71;
+	const uint32_t DxgiFormatBC1UnormSrgb = 72;
+	const uint32_t DxgiFormatBC3Unorm = 77;
+	const uint32_t DxgiFormatBC3UnormSrgb = 78;
+	const uint32_t DxgiFormatBC4Unorm = 80;
+	const uint32_t DxgiFormatBC4Snorm = 81;
+	const uint32_t DxgiFormatBC5Unorm = 83;
+	const uint32_t DxgiFormatBC5Snorm = 84;
+	const uint32_t DxgiFormatB8G8R8A8Unorm = 87;
+	const uint32_t DxgiFormatB8G8R8A8UnormSrgb = 91;
+	const uint32_t DxgiFormatBC7Unorm = 98;
+	const uint32_t DxgiFormatBC7UnormSrgb = 99;
+
+	struct DdsPixelFormat
+	{
+		uint32_t	size;
+		uint32_t	flags;
+		uint32_t	fourCC;
+		uint32_t	rgbBitCount;
+		uint32_t	rBitMask;
+		uint32_t	gBitMask;
+		uint32_t	bBitMask;
+		uint32_t	aBitMask;
+	};
+
+	struct DdsHeader
+	{
+		uint32_t		size;
+		uint32_t		flags;
+		uint32_t		height;
+		uint32_t		width;
+		uint32_t		pitchOrLinearSize;
+		uint32_t		depth;
+		uint32_t		mipMapCount;
+		uint32_t		reserved1[11];
+		DdsPixelFormat	pixelFormat;
+		uint32_t		caps;
+		uint32_t		caps2;
+		uint32_t		caps3;
+		uint32_t		caps4;
+		uint32_t		reserved2;
+	};
+
+	struct DdsHeaderDx10
+	{
+		uint32_t	dxgiFormat;
+		uint32_t	resourceDimension;
+		uint32_t	miscFlag;
+		uint32_t	arraySize;
+		uint32_t	miscFlags2;
+	};
+
+	// Reads an entire file into memory. Returns false if the file can't be read.
+	bool ReadFileData(const std::wstring& filename, std::vector<uint8_t>& data)
+	{
+		std::ifstream file(filename, std::ios::binary);
+		if (!file)
+		{
+			return false;
+		}
+
+		data.assign(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+		return !file.bad();
+	}
+
+	// Builds a mask from the top mip level of a DDS file. Returns false and prints an error if the file can't be used.
+	bool BuildFromDds(const std::wstring& filename, DX::CollisionMask& mask)
+	{
+		std::vector<uint8_t> data;
+		if (!ReadFileData(filename, data))
+		{
+			fwprintf(stderr, L"error: unable to read '%s'.\n", filename.c_str());
+			return false;
+		}
+
+		if (data.size() < sizeof(uint32_t) + sizeof(DdsHeader) || *reinterpret_cast<const uint32_t*>(data.data()) != DdsMagic)
+		{
+			fwprintf(stderr, L"error: '%s' is not a DDS file.\n", filename.c_str());
+			return false;
+		}
+
+		auto header = reinterpret_cast<const DdsHeader*>(data.data() + sizeof(uint32_t));
+		size_t offset = sizeof(uint32_t) + sizeof(DdsHeader);
+
+		// Work out the texel layout, either from the DX10 header or from the legacy pixel format.
+		uint32_t bytesPerTexel = 0;
+		bool isAlphaOnly = false;
+		bool isBlockCompressed = false;
+		DX::BlockFormat blockFormat = DX::BlockFormat::BC1;
+		auto& pixelFormat = header->pixelFormat;
+		if ((pixelFormat.flags & DdsPixelFormatFourCC) != 0 && pixelFormat.fourCC == DdsFourCCDx10)
+		{
+			if (data.size() < offset + sizeof(DdsHeaderDx10))
+			{
+				fwprintf(stderr, L"error: '%s' is truncated.\n", filename.c_str());
+				return false;
+			}
+
+			auto headerDx10 = reinterpret_cast<const DdsHeaderDx10*>(data.data() + offset);
+			offset += sizeof(DdsHeaderDx10);
+
+			switch (headerDx10->dxgiFormat)
+			{
+			case DxgiFormatB8G8R8A8Unorm:
+			case DxgiFormatB8G8R8A8UnormSrgb:
+			case DxgiFormatR8G8B8A8Unorm:
+			case DxgiFormatR8G8B8A8UnormSrgb:
+				bytesPerTexel = 4;
+				break;
+			case DxgiFormatA8Unorm:
+				bytesPerTexel = 1;
+				isAlphaOnly = true;
+				break;
+			case DxgiFormatBC1Unorm:
+			case DxgiFormatBC1UnormSrgb:
+				isBlockCompressed = true;
+				blockFormat = DX::BlockFormat::BC1;
+				break;
+			case DxgiFormatBC3Unorm:
+			case DxgiFormatBC3UnormSrgb:
+				isBlockCompressed = true;
+				blockFormat = DX::BlockFormat::BC3;
+				break;
+			case DxgiFormatBC4Unorm:
+				isBlockCompressed = true;
+				blockFormat = DX::BlockFormat::BC4;
+				break;
+			case DxgiFormatBC5Unorm:
+				isBlockCompressed = true;
+				blockFormat = DX::BlockFormat::BC5;
+				break;
+			case DxgiFormatBC4Snorm:
+				isBlockCompressed = true;
+				blockFormat = DX::BlockFormat::BC4Snorm;
+				break;
+			case DxgiFormatBC5Snorm:
+				isBlockCompressed = true;
+				blockFormat = DX::BlockFormat::BC5Snorm;
+				break;
+			case DxgiFormatBC7Unorm:
+			case DxgiFormatBC7UnormSrgb:
+				isBlockCompressed = true;
+				blockFormat = DX::BlockFormat::BC7;
+				break;
+			default:
+				break;
+			}
+		}
+		else if ((pixelFormat.flags & DdsPixelFormatFourCC) != 0 && pixelFormat.fourCC == DdsFourCCDxt1)
+		{
+			isBlockCompressed = true;
+			blockFormat = DX::BlockFormat::BC1;
+		}
+		else if ((pixelFormat.flags & DdsPixelFormatFourCC) != 0 && (pixelFormat.fourCC == DdsFourCCDxt4 || pixelFormat.fourCC == DdsFourCCDxt5))
+		{
+			// DXT4 is DXT5 with premultiplied alpha, which doesn't change the alpha values.
+			isBlockCompressed = true;
+			blockFormat = DX::BlockFormat::BC3;
+		}
+		else if ((pixelFormat.flags & DdsPixelFormatFourCC) != 0 && (pixelFormat.fourCC == DdsFourCCAti1 || pixelFormat.fourCC == DdsFourCCBc4u))
+		{
+			isBlockCompressed = true;
+			blockFormat = DX::BlockFormat::BC4;
+		}
+		else if ((pixelFormat.flags & DdsPixelFormatFourCC) != 0 && (pixelFormat.fourCC == DdsFourCCAti2 || pixelFormat.fourCC == DdsFourCCBc5u))
+		{
+			isBlockCompressed = true;
+			blockFormat = DX::BlockFormat::BC5;
+		}
+		else if ((pixelFormat.flags & DdsPixelFormatFourCC) != 0 && pixelFormat.fourCC == DdsFourCCBc4s)
+		{
+			isBlockCompressed = true;
+			blockFormat = DX::BlockFormat::BC4Snorm;
+		}
+		else if ((pixelFormat.flags & DdsPixelFormatFourCC) != 0 && pixelFormat.fourCC == DdsFourCCBc5s)
+		{
+			isBlockCompressed = true;
+			blockFormat = DX::BlockFormat::BC5Snorm;
+		}
+		else if ((pixelFormat.flags & DdsPixelFormatRgb) != 0 && pixelFormat.rgbBitCount == 32 && pixelFormat.aBitMask == 0xFF000000)
+		{
+			// Both B8G8R8A8 and R8G8B8A8 keep alpha in the last byte of the texel, which is all that the mask needs.
+			bytesPerTexel = 4;
+		}
+		else if ((pixelFormat.flags & DdsPixelFormatAlpha) != 0 && pixelFormat.rgbBitCount == 8 && pixelFormat.aBitMask == 0xFF)
+		{
+			bytesPerTexel = 1;
+			isAlphaOnly = true;
+		}
+
+		if (bytesPerTexel == 0 && !isBlockCompressed)
+		{
+			fwprintf(stderr, L"error: the pixel format of '%s' is not supported.\n", filename.c_str());
+			return false;
+		}
+
+		if (isBlockCompressed)
+		{
+			// Only the alpha channel matters for the mask so the blocks are decoded straight to alpha values.
+			auto blocksPerRow = (header->width + 3) / 4;
+			auto blockRowCount = (header->height + 3) / 4;
+			auto sourceRowPitch = static_cast<size_t>(blocksPerRow) * DX::GetBlockSizeInBytes(blockFormat);
+			if (header->width == 0 || header->height == 0 || data.size() - offset < sourceRowPitch * blockRowCount)
+			{
+				fwprintf(stderr, L"error: '%s' is truncated.\n", filename.c_str());
+				return false;
+			}
+
+			std::vector<uint8_t> alpha(static_cast<size_t>(header->width) * header->height);
+			DX::DecodeBlockRowsAlpha(blockFormat, data.data() + offset, sourceRowPitch, header->width, header->height, 0, blockRowCount, alpha.data());
+			mask.CreateFromAlpha(alpha.data(), header->width, header->height);
+			return true;
+		}
+
+		auto texelDataSize = static_cast<size_t>(header->width) * header->height * bytesPerTexel;
+		if (header->width == 0 || header->height == 0 || data.size() - offset < texelDataSize)
+		{
+			fwprintf(stderr, L"error: '%s' is truncated.\n", filename.c_str());
+			return false;
+		}
+
+		if (isAlphaOnly)
+		{
+			mask.CreateFromAlpha(data.data() + offset, header->width, header->height);
+		}
+		else
+		{
+			mask.CreateFromBGRA(data.data() + offset, header->width, header->height);
+		}
+
+		return true;
+	}
+
+	// Builds a mask from any image that WIC can decode. Returns false and prints an error if the file can't be used.
+	bool BuildFromWic(const std::wstring& filename, DX::CollisionMask& mask)
+	{
+		ComPtr<IWICImagingFactory> factory;
+		auto hr = CoCreateInstance(CLSID_WICImagingFactory, nullptr, CLSCTX_INPROC_SERVER, IID_PPV_ARGS(&factory));
+
+		ComPtr<IWICBitmapDecoder> decoder;
+		if (SUCCEEDED(hr))
+		{
+			hr = factory->CreateDecoderFromFilename(filename.c_str(), nullptr, GENERIC_READ, WICDecodeMetadataCacheOnDemand, &decoder);
+		}
+
+		ComPtr<IWICBitmapFrameDecode> frame;
+		if (SUCCEEDED(hr))
+		{
+			hr = decoder->GetFrame(0, &frame);
+		}
+
+		// Convert whatever the image's format is to B8G8R8A8 so that there is only one layout to deal with.
+		ComPtr<IWICFormatConverter> converter;
+		if (SUCCEEDED(hr))
+		{
+			hr = factory->CreateFormatConverter(&converter);
+		}
+
+		if (SUCCEEDED(hr))
+		{
+			hr = converter->Initialize(frame.Get(), GUID_WICPixelFormat32bppBGRA, WICBitmapDitherTypeNone, nullptr, 0.0, WICBitmapPaletteTypeCustom);
+		}
+
+		UINT width = 0;
+		UINT height = 0;
+		if (SUCCEEDED(hr))
+		{
+			hr = converter->GetSize(&width, &height);
+		}
+
+		std::vector<uint8_t> texels;
+		if (SUCCEEDED(hr))
+		{
+			texels.resize(static_cast<size_t>(width) * height * 4);
+			hr = converter->CopyPixels(nullptr, width * 4, static_cast<UINT>(texels.size()), texels.data());
+		}
+
+		if (FAILED(hr))
+		{
+			fwprintf(stderr, L"error: unable to decode '%s' (HRESULT 0x%08X).\n", filename.c_str(), static_cast<unsigned int>(hr));
+			return false;
+		}
+
+		mask.CreateFromBGRA(texels.data(), width, height);
+		return true;
+	}
+
+	// Returns true if the file name ends with the extension (which includes the '.'), ignoring case.
+	bool HasExtension(const std::wstring& filename, const wchar_t* extension)
+	{
+		auto length = wcslen(extension);
+		return filename.size() >= length && _wcsicmp(filename.c_str() + (filename.size() - length), extension) == 0;
+	}
+}
+
+int wmain(int argc, wchar_t* argv[])
+{
+	if (argc < 2 || argc > 3)
+	{
+		fwprintf(stderr, L"Usage: CollisionMaskBuilder <input texture> [<output file>]\n");
+		return 1;
+	}
+
+	std::wstring input(argv[1]);
+	std::wstring output;
+	if (argc == 3)
+	{
+		output = argv[2];
+	}
+	else
+	{
+		// Replace the extension (if any) with .cmask.
+		auto dot = input.find_last_of(L'.');
+		auto slash = input.find_last_of(L"\\/");
+		output = (dot != std::wstring::npos && (slash == std::wstring::npos || dot > slash)) ? input.substr(0, dot) : input;
+		output += L".cmask";
+	}
+
+	if (FAILED(CoInitializeEx(nullptr, COINIT_MULTITHREADED)))
+	{
+		fwprintf(stderr, L"error: unable to initialize COM.\n");
+		return 1;
+	}
+
+	DX::CollisionMask mask;
+	bool succeeded = HasExtension(input, L".dds") ? BuildFromDds(input, mask) : BuildFromWic(input, mask);
+
+	CoUninitialize();
+
+	if (!succeeded)
+	{
+		return 1;
+	}
+
+	std::vector<uint8_t> data;
+	mask.SaveToMemory(data);
+
+	std::ofstream file(output, std::ios::binary | std::ios::trunc);
+	file.write(reinterpret_cast<const char*>(data.data()), data.size());
+	file.close();
+	if (!file)
+	{
+		fwprintf(stderr, L"error: unable to write '%s'.\n", output.c_str());
+		return 1;
+	}
+
+	uint32_t left, top, right, bottom;
+	mask.GetOpaqueBounds(left, top, right, bottom);
+	wprintf(L"%s: %ux%u, opaque bounds (%u, %u)-(%u, %u), %u bytes.\n", output.c_str(), mask.GetWidth(), mask.GetHeight(), left, top, right, bottom,
+		static_cast<unsigned int>(data.size()));
+
+	return 0;
+}
@@ -0,0 +1,104 @@
+// Measures how fast the ADPCM decoder decodes a minute of 44.1 kHz audio in each format, decoding MS-ADPCM both a block at a time with
+// DecodeAdpcmBlock (the scalar path) and a run of blocks at a time with DecodeAdpcmBlocks (the SIMD path, where SSE2 or NEON is available).
+// IMA ADPCM has no SIMD path so both of its numbers should be about the same. The data is random bytes with plausible block headers.
+// Run a release build. Usage: AdpcmBenchmark
+
+#include <cstdint>
+#include <cstdio>
+#include <vector>
+
+#include "AdpcmDecoder.h"
+#include "TestHelpers.h"
+
+namespace
+{
+	const uint32_t SampleRate = 44100;
+	const uint32_t Seconds = 60;
+	const uint32_t Repeats = 5;
+
+	// The formats as SoundBankBuilder's usual encoders write them: 512 byte blocks per channel.
+	DX::AdpcmFormat MakeFormat(uint16_t formatTag, uint16_t channels)
+	{
+		DX::AdpcmFormat format = {};
+		format.m_formatTag = formatTag;
+		format.m_channels = channels;
+		format.m_samplesPerSecond = SampleRate;
+		format.m_blockAlign = static_cast<uint16_t>(512 * channels);
+		format.m_samplesPerBlock = (formatTag == DX::WaveFormatMsAdpcm) ?
+			static_cast<uint16_t>(2 + (((format.m_blockAlign - (7 * channels)) * 2) / channels)) :
+			static_cast<uint16_t>(1 + (((format.m_blockAlign - (4 * channels)) / (4 * channels)) * 8));
+		return format;
+	}
+
+	std::vector<uint8_t> MakeData(PortableTests::Random& random, const DX::AdpcmFormat& format, size_t blockCount)
+	{
+		std::vector<uint8_t> data(blockCount * format.m_blockAlign);
+		for (auto& byte : data)
+		{
+			byte = static_cast<uint8_t>(random.Next() >> 24);
+		}
+
+		for (size_t block = 0; block < blockCount; block++)
+		{
+			auto header = &data[block * format.m_blockAlign];
+			for (uint32_t channel = 0; channel < format.m_channels; channel++)
+			{
+				if (format.m_formatTag == DX::WaveFormatMsAdpcm)
+				{
+					header[channel] = static_cast<uint8_t>(random.Range(0, 6));
+					header[format.m_channels + (channel * 2)] = 64;
+					header[format.m_channels + (channel * 2) + 1] = 0;
+				}
+				else
+				{
+					header[(channel * 4) + 2] = static_cast<uint8_t>(random.Range(0, 88));
+				}
+			}
+		}
+
+		return data;
+	}
+}
+
+int main()
+{
+	PortableTests::Random random(21);
+
+	const uint16_t formatTags[] = { DX::WaveFormatMsAdpcm, DX::WaveFormatImaAdpcm };
+	for (auto formatTag : formatTags)
+	{
+		for (uint16_t channels = 1; channels <= 2; channels++)
+		{
+			auto format = MakeFormat(formatTag, channels);
+			size_t blockCount = ((static_cast<size_t>(SampleRate) * Seconds) + format.m_samplesPerBlock - 1) / format.m_samplesPerBlock;
+			auto data = MakeData(random, format, blockCount);
+			std::vector<int16_t> samples(blockCount * format.m_samplesPerBlock * channels);
+
+			// The best of a few runs, to leave out the first run's page faults.
+			double blockTime = 1.0e30;
+			double blocksTime = 1.0e30;
+			for (uint32_t repeat = 0; repeat < Repeats; repeat++)
+			{
+				double start = PortableTests::Seconds();
+				for (size_t block = 0; block < blockCount; block++)
+				{
+					DX::DecodeAdpcmBlock(format, &data[block * format.m_blockAlign], format.m_blockAlign,
+						&samples[block * format.m_samplesPerBlock * channels]);
+				}
+				double middle = PortableTests::Seconds();
+				DX::DecodeAdpcmBlocks(format, data.data(), blockCount, samples.data());
+				double end = PortableTests::Seconds();
+
+				blockTime = (middle - start) < blockTime ? middle - start : blockTime;
+				blocksTime = (end - middle) < blocksTime ? end - middle : blocksTime;
+			}
+
+			// Print a sample so that the decoding can't be optimized away.
+			printf("%s %s, %u s: DecodeAdpcmBlock %6.2f ms (%5.0fx real time), DecodeAdpcmBlocks %6.2f ms (%5.0fx real time) [%d]\n",
+				formatTag == DX::WaveFormatMsAdpcm ? "MS-ADPCM " : "IMA ADPCM", channels == 1 ? "mono  " : "stereo", Seconds,
+				blockTime * 1000.0, Seconds / blockTime, blocksTime * 1000.0, Seconds / blocksTime, samples[samples.size() / 2]);
+		}
+	}
+
+	return 0;
+}
@@ -0,0 +1,498 @@
+// Checks the ADPCM decoder against a plain reference decoder written straight from the format descriptions, one sample at a time. The blocks are
+// random bytes with random headers, which are all valid ADPCM data, and include the out of range predictors and negative step sizes that only
+// corrupt files have. DecodeAdpcmBlocks (which decodes MS-ADPCM several blocks at a time with SIMD) has to match it exactly for every block
+// count, and so do DecodeAdpcmBlock and DecodeAdpcm for short last blocks. Also checks ParseAdpcmFormat and GetAdpcmFrameCount, and that a sine
+// wave encoded with a simple IMA ADPCM encoder decodes close to the original.
+
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <vector>
+
+#include "AdpcmDecoder.h"
+#include "TestHelpers.h"
+
+namespace
+{
+	const int16_t Coefficients[7][2] = { { 256, 0 }, { 512, -256 }, { 0, 0 }, { 192, 64 }, { 240, 0 }, { 460, -208 }, { 392, -232 } };
+	const int32_t AdaptationTable[16] = { 230, 230, 230, 230, 307, 409, 512, 614, 768, 614, 512, 409, 307, 230, 230, 230 };
+	const int32_t StepTable[89] =
+	{
+		7, 8, 9, 10, 11, 12, 13, 14, 16, 17, 19, 21, 23, 25, 28, 31, 34, 37, 41, 45, 50, 55, 60, 66, 73, 80, 88, 97, 107, 118, 130, 143, 157, 173,
+		190, 209, 230, 253, 279, 307, 337, 371, 408, 449, 494, 544, 598, 658, 724, 796, 876, 963, 1060, 1166, 1282, 1411, 1552, 1707, 1878, 2066,
+		2272, 2499, 2749, 3024, 3327, 3660, 4026, 4428, 4871, 5358, 5894, 6484, 7132, 7845, 8630, 9493, 10442, 11487, 12635, 13899, 15289, 16818,
+		18500, 20350, 22385, 24623, 27086, 29794, 32767
+	};
+	const int32_t IndexTable[16] = { -1, -1, -1, -1, 2, 4, 6, 8, -1, -1, -1, -1, 2, 4, 6, 8 };
+
+	int32_t Clamp(int32_t value, int32_t low, int32_t high)
+	{
+		return value < low ? low : (value > high ? high : value);
+	}
+
+	int16_t ReadInt16(const uint8_t* data)
+	{
+		return static_cast<int16_t>(data[0] | (data[1] << 8));
+	}
+
+	void WriteUInt16(std::vector<uint8_t>& data, uint32_t value)
+	{
+		data.push_back(static_cast<uint8_t>(value & 0xFF));
+		data.push_back(static_cast<uint8_t>((value >> 8) & 0xFF));
+	}
+
+	void WriteUInt32(std::vector<uint8_t>& data, uint32_t value)
+	{
+		WriteUInt16(data, value & 0xFFFF);
+		WriteUInt16(data, value >> 16);
+	}
+
+	// Returns the frame count of a block of blockSize bytes, which is at most one whole block.
+	uint32_t ReferenceFrameCount(const DX::AdpcmFormat& format, size_t blockSize)
+	{
+		size_t channels = format.m_channels;
+		if (format.m_formatTag == DX::WaveFormatMsAdpcm)
+		{
+			return blockSize < 7 * channels ? 0 : static_cast<uint32_t>(2 + (((blockSize - (7 * channels)) * 2) / channels));
+		}
+
+		return blockSize < 4 * channels ? 0 : static_cast<uint32_t>(1 + (((blockSize - (4 * channels)) / (4 * channels)) * 8));
+	}
+
+	// Decodes one channel of one block, one sample at a time.
+	void ReferenceDecodeChannel(const DX::AdpcmFormat& format, const uint8_t* block, uint32_t frameCount, uint32_t channel, int16_t* destination)
+	{
+		uint32_t channels = format.m_channels;
+		if (format.m_formatTag == DX::WaveFormatMsAdpcm)
+		{
+			uint32_t predictor = block[channel] < 7 ? block[channel] : 0;
+			int32_t delta = ReadInt16(block + channels + (channel * 2));
+			int32_t sample1 = ReadInt16(block + (channels * 3) + (channel * 2));
+			int32_t sample2 = ReadInt16(block + (channels * 5) + (channel * 2));
+
+			destination[channel] = static_cast<int16_t>(sample2);
+			if (frameCount > 1)
+			{
+				destination[channels + channel] = static_cast<int16_t>(sample1);
+			}
+
+			for (uint32_t frame = 2; frame < frameCount; frame++)
+			{
+				// The nibbles are in frame order with the channels interleaved, high nibble first.
+				uint32_t index = ((frame - 2) * channels) + channel;
+				uint8_t byte = block[(7 * channels) + (index / 2)];
+				int32_t nibble = (index % 2 == 0) ? (byte >> 4) : (byte & 0x0F);
+				int32_t signedNibble = nibble >= 8 ? nibble - 16 : nibble;
+
+				// The prediction is divided by 256 rounding down (an arithmetic shift), not toward zero.
+				int32_t product = (sample1 * Coefficients[predictor][0]) + (sample2 * Coefficients[predictor][1]);
+				int32_t predicted = (product - ((product < 0) ? 255 : 0)) / 256;
+
+				int32_t sample = Clamp(predicted + (signedNibble * delta), -32768, 32767);
+				destination[(frame * channels) + channel] = static_cast<int16_t>(sample);
+				sample2 = sample1;
+				sample1 = sample;
+
+				delta = Clamp(static_cast<int32_t>((static_cast<int64_t>(AdaptationTable[nibble]) * delta) >> 8), 16, 0x7FFFFFFF / 768);
+			}
+		}
+		else
+		{
+			int32_t sample = ReadInt16(block + (channel * 4));
+			int32_t index = block[(channel * 4) + 2] > 88 ? 88 : block[(channel * 4) + 2];
+			destination[channel] = static_cast<int16_t>(sample);
+
+			for (uint32_t frame = 1; frame < frameCount; frame++)
+			{
+				// Each channel has runs of 4 bytes (8 samples, low nibble first) and the runs of the channels take turns.
+				uint32_t run = (frame - 1) / 8;
+				uint32_t position = (frame - 1) % 8;
+				uint8_t byte = block[(4 * channels) + (((run * channels) + channel) * 4) + (position / 2)];
+				int32_t nibble = (position % 2 == 0) ? (byte & 0x0F) : (byte >> 4);
+
+				// The shifted steps are added one bit at a time, which doesn't always round the same way as (step * (2 * magnitude + 1)) / 8.
+				int32_t step = StepTable[index];
+				int32_t difference = step >> 3;
+				difference += (nibble & 4) ? step : 0;
+				difference += (nibble & 2) ? (step >> 1) : 0;
+				difference += (nibble & 1) ? (step >> 2) : 0;
+
+				sample = Clamp((nibble & 8) ? sample - difference : sample + difference, -32768, 32767);
+				index = Clamp(index + IndexTable[nibble], 0, 88);
+				destination[(frame * channels) + channel] = static_cast<int16_t>(sample);
+			}
+		}
+	}
+
+	// Decodes data made of whole blocks and an optional short last block.
+	std::vector<int16_t> ReferenceDecode(const DX::AdpcmFormat& format, const std::vector<uint8_t>& data)
+	{
+		std::vector<int16_t> result;
+		for (size_t offset = 0; offset < data.size(); offset += format.m_blockAlign)
+		{
+			size_t blockSize = (data.size() - offset) < format.m_blockAlign ? data.size() - offset : format.m_blockAlign;
+			uint32_t frameCount = ReferenceFrameCount(format, blockSize);
+
+			std::vector<int16_t> block(static_cast<size_t>(frameCount) * format.m_channels);
+			for (uint32_t channel = 0; channel < format.m_channels && frameCount != 0; channel++)
+			{
+				ReferenceDecodeChannel(format, &data[offset], frameCount, channel, block.data());
+			}
+			result.insert(result.end(), block.begin(), block.end());
+		}
+
+		return result;
+	}
+
+	// Builds the contents of a 'fmt ' chunk for ParseAdpcmFormat.
+	std::vector<uint8_t> MakeFormatChunk(uint16_t formatTag, uint16_t channels, uint16_t blockAlign)
+	{
+		uint32_t headerSize = (formatTag == DX::WaveFormatMsAdpcm ? 7U : 4U) * channels;
+		uint32_t samplesPerBlock = (formatTag == DX::WaveFormatMsAdpcm) ?
+			2 + (((blockAlign - headerSize) * 2) / channels) :
+			1 + (((blockAlign - headerSize) / (4 * channels)) * 8);
+
+		std::vector<uint8_t> chunk;
+		WriteUInt16(chunk, formatTag);
+		WriteUInt16(chunk, channels);
+		WriteUInt32(chunk, 44100);
+		WriteUInt32(chunk, (44100 * blockAlign) / samplesPerBlock);
+		WriteUInt16(chunk, blockAlign);
+		WriteUInt16(chunk, 4);
+		WriteUInt16(chunk, formatTag == DX::WaveFormatMsAdpcm ? 32 : 2);
+		WriteUInt16(chunk, samplesPerBlock);
+		if (formatTag == DX::WaveFormatMsAdpcm)
+		{
+			WriteUInt16(chunk, 7);
+			for (uint32_t i = 0; i < 7; i++)
+			{
+				WriteUInt16(chunk, static_cast<uint16_t>(Coefficients[i][0]));
+				WriteUInt16(chunk, static_cast<uint16_t>(Coefficients[i][1]));
+			}
+		}
+
+		return chunk;
+	}
+
+	DX::AdpcmFormat MakeFormat(uint16_t formatTag, uint16_t channels, uint16_t blockAlign)
+	{
+		auto chunk = MakeFormatChunk(formatTag, channels, blockAlign);
+		DX::AdpcmFormat format = {};
+		CHECK(DX::ParseAdpcmFormat(chunk.data(), chunk.size(), format));
+		return format;
+	}
+
+	// Fills blockCount blocks with random bytes. Most headers are made plausible (an in range predictor or step index and a small positive
+	// MS-ADPCM step size), but some are left completely random the way corrupt data would be.
+	std::vector<uint8_t> MakeBlocks(PortableTests::Random& random, const DX::AdpcmFormat& format, size_t size)
+	{
+		std::vector<uint8_t> data(size);
+		for (auto& byte : data)
+		{
+			byte = static_cast<uint8_t>(random.Next() >> 24);
+		}
+
+		uint32_t channels = format.m_channels;
+		for (size_t offset = 0; offset < size; offset += format.m_blockAlign)
+		{
+			if (random.Range(0, 7) == 0)
+			{
+				continue;
+			}
+
+			for (uint32_t channel = 0; channel < channels; channel++)
+			{
+				if (format.m_formatTag == DX::WaveFormatMsAdpcm)
+				{
+					size_t deltaOffset = offset + channels + (channel * 2);
+					if (offset + channel < size)
+					{
+						data[offset + channel] = static_cast<uint8_t>(random.Range(0, 6));
+					}
+					if (deltaOffset + 1 < size)
+					{
+						uint32_t delta = static_cast<uint32_t>(random.Range(16, 2000));
+						data[deltaOffset] = static_cast<uint8_t>(delta & 0xFF);
+						data[deltaOffset + 1] = static_cast<uint8_t>(delta >> 8);
+					}
+				}
+				else if (offset + (channel * 4) + 2 < size)
+				{
+					data[offset + (channel * 4) + 2] = static_cast<uint8_t>(random.Range(0, 88));
+				}
+			}
+		}
+
+		return data;
+	}
+
+	void TestParseAdpcmFormat()
+	{
+		const uint16_t formatTags[] = { DX::WaveFormatMsAdpcm, DX::WaveFormatImaAdpcm };
+		for (auto formatTag : formatTags)
+		{
+			for (uint16_t channels = 1; channels <= 2; channels++)
+			{
+				uint16_t blockAlign = static_cast<uint16_t>(512 * channels);
+				auto chunk = MakeFormatChunk(formatTag, channels, blockAlign);
+
+				DX::AdpcmFormat format = {};
+				CHECK(DX::ParseAdpcmFormat(chunk.data(), chunk.size(), format));
+				CHECK(format.m_formatTag == formatTag);
+				CHECK(format.m_channels == channels);
+				CHECK(format.m_samplesPerSecond == 44100);
+				CHECK(format.m_blockAlign == blockAlign);
+				CHECK(format.m_samplesPerBlock == ReferenceFrameCount(format, blockAlign));
+
+				// Every truncation is rejected.
+				for (size_t size = 0; size < chunk.size(); size++)
+				{
+					CHECK(!DX::ParseAdpcmFormat(chunk.data(), size, format));
+				}
+
+				// So is a samples per block that doesn't match the block size.
+				auto wrongSamples = chunk;
+				wrongSamples[18]++;
+				CHECK(!DX::ParseAdpcmFormat(wrongSamples.data(), wrongSamples.size(), format));
+
+				auto wrongBits = chunk;
+				wrongBits[14] = 16;
+				CHECK(!DX::ParseAdpcmFormat(wrongBits.data(), wrongBits.size(), format));
+
+				auto wrongChannels = chunk;
+				wrongChannels[2] = 3;
+				CHECK(!DX::ParseAdpcmFormat(wrongChannels.data(), wrongChannels.size(), format));
+
+				auto noRate = chunk;
+				memset(&noRate[4], 0, 4);
+				CHECK(!DX::ParseAdpcmFormat(noRate.data(), noRate.size(), format));
+
+				// A block that is nothing but header.
+				auto headerOnly = MakeFormatChunk(formatTag, channels, blockAlign);
+				uint16_t headerSize = static_cast<uint16_t>((formatTag == DX::WaveFormatMsAdpcm ? 7 : 4) * channels);
+				headerOnly[12] = static_cast<uint8_t>(headerSize);
+				headerOnly[13] = 0;
+				CHECK(!DX::ParseAdpcmFormat(headerOnly.data(), headerOnly.size(), format));
+
+				if (formatTag == DX::WaveFormatMsAdpcm)
+				{
+					auto wrongCoefficient = chunk;
+					wrongCoefficient[22 + 4 * 3]++;
+					CHECK(!DX::ParseAdpcmFormat(wrongCoefficient.data(), wrongCoefficient.size(), format));
+
+					auto wrongCoefficientCount = chunk;
+					wrongCoefficientCount[20] = 6;
+					CHECK(!DX::ParseAdpcmFormat(wrongCoefficientCount.data(), wrongCoefficientCount.size(), format));
+				}
+				else
+				{
+					// IMA ADPCM blocks have to be whole runs of 8 samples.
+					auto partialRun = MakeFormatChunk(formatTag, channels, blockAlign);
+					partialRun[12] += 2;
+					CHECK(!DX::ParseAdpcmFormat(partialRun.data(), partialRun.size(), format));
+				}
+			}
+		}
+
+		DX::AdpcmFormat format = {};
+		auto pcm = MakeFormatChunk(DX::WaveFormatImaAdpcm, 1, 256);
+		pcm[0] = 1;
+		CHECK(!DX::ParseAdpcmFormat(pcm.data(), pcm.size(), format));
+		CHECK(!DX::ParseAdpcmFormat(nullptr, 0, format));
+	}
+
+	// A few samples worked out by hand so that the reference decoder itself is checked.
+	void TestKnownSamples()
+	{
+		// IMA ADPCM mono, sample 100 and step index 0 (step 7), then nibble 7 (7/8 + 7 + 7/2 + 7/4 = 11, rounding each down).
+		auto ima = MakeFormat(DX::WaveFormatImaAdpcm, 1, 36);
+		std::vector<uint8_t> imaBlock(36, 0);
+		imaBlock[0] = 100;
+		imaBlock[4] = 0x97;
+
+		std::vector<int16_t> imaSamples(ima.m_samplesPerBlock);
+		CHECK(DX::DecodeAdpcmBlock(ima, imaBlock.data(), imaBlock.size(), imaSamples.data()) == 65);
+		CHECK(imaSamples[0] == 100);
+		CHECK(imaSamples[1] == 111);
+		// Then nibble 9 (minus 1) with the index moved on by 8 to step 16: -(16/8 + 16/4) = -6.
+		CHECK(imaSamples[2] == 105);
+
+		// MS-ADPCM mono, predictor 0 (256, 0), delta 16, sample1 1000, sample2 500, then nibbles 1 (1000 + 16) and 0xF (1016 - 16).
+		auto ms = MakeFormat(DX::WaveFormatMsAdpcm, 1, 32);
+		std::vector<uint8_t> msBlock(32, 0);
+		msBlock[1] = 16;
+		msBlock[3] = 1000 & 0xFF;
+		msBlock[4] = 1000 >> 8;
+		msBlock[5] = 500 & 0xFF;
+		msBlock[6] = 500 >> 8;
+		msBlock[7] = 0x1F;
+
+		std::vector<int16_t> msSamples(ms.m_samplesPerBlock);
+		CHECK(DX::DecodeAdpcmBlock(ms, msBlock.data(), msBlock.size(), msSamples.data()) == ms.m_samplesPerBlock);
+		CHECK(msSamples[0] == 500);
+		CHECK(msSamples[1] == 1000);
+		CHECK(msSamples[2] == 1016);
+		CHECK(msSamples[3] == 1000);
+
+		CHECK(ReferenceDecode(ima, imaBlock) == imaSamples);
+		CHECK(ReferenceDecode(ms, msBlock) == msSamples);
+	}
+
+	// Compares every way of decoding against the reference for random data.
+	void TestAgainstReference()
+	{
+		PortableTests::Random random(21);
+
+		const uint16_t formatTags[] = { DX::WaveFormatMsAdpcm, DX::WaveFormatImaAdpcm };
+		const uint16_t blockSizes[] = { 36, 68, 256, 512, 1024, 2048 };
+		for (auto formatTag : formatTags)
+		{
+			for (uint16_t channels = 1; channels <= 2; channels++)
+			{
+				for (auto blockSize : blockSizes)
+				{
+					auto format = MakeFormat(formatTag, channels, static_cast<uint16_t>(blockSize * channels));
+
+					// Up to a few more blocks than the SIMD decoder decodes at once, so that every partial group is covered.
+					for (uint32_t blockCount = 0; blockCount <= 19; blockCount++)
+					{
+						size_t size = static_cast<size_t>(blockCount) * format.m_blockAlign;
+						auto data = MakeBlocks(random, format, size);
+						auto expected = ReferenceDecode(format, data);
+
+						// Decoded into a buffer that is exactly the right size so that a sanitized build catches any write past the end.
+						std::vector<int16_t> blocks(expected.size());
+						DX::DecodeAdpcmBlocks(format, data.data(), blockCount, blocks.data());
+						CHECK(blocks == expected);
+
+						std::vector<int16_t> oneAtATime(expected.size());
+						for (uint32_t block = 0; block < blockCount; block++)
+						{
+							auto frames = DX::DecodeAdpcmBlock(format, &data[block * format.m_blockAlign], format.m_blockAlign,
+								&oneAtATime[static_cast<size_t>(block) * format.m_samplesPerBlock * channels]);
+							CHECK(frames == format.m_samplesPerBlock);
+						}
+						CHECK(oneAtATime == expected);
+
+						// The same data with a short last block of every possible size.
+						if (blockCount == 3)
+						{
+							for (size_t remainder = 0; remainder < format.m_blockAlign; remainder += (format.m_blockAlign > 128 ? 29 : 1))
+							{
+								auto shortData = MakeBlocks(random, format, size + remainder);
+								auto shortExpected = ReferenceDecode(format, shortData);
+								CHECK(DX::GetAdpcmFrameCount(format, shortData.size()) * channels == shortExpected.size());
+
+								std::vector<int16_t> decoded(shortExpected.size());
+								CHECK(DX::DecodeAdpcm(format, shortData.data(), shortData.size(), decoded.data()) * channels == shortExpected.size());
+								CHECK(decoded == shortExpected);
+							}
+						}
+					}
+				}
+			}
+		}
+	}
+
+	// Encodes a 440 Hz sine with a simple IMA ADPCM encoder (the one from the IMA's recommendation, which picks each nibble from the decoder's
+	// own state) and checks that the decoded samples are close to the original.
+	void TestImaSineRoundTrip()
+	{
+		for (uint16_t channels = 1; channels <= 2; channels++)
+		{
+			auto format = MakeFormat(DX::WaveFormatImaAdpcm, channels, static_cast<uint16_t>(512 * channels));
+			const uint32_t blockCount = 40;
+			size_t frameCount = static_cast<size_t>(blockCount) * format.m_samplesPerBlock;
+
+			std::vector<int16_t> original(frameCount * channels);
+			for (size_t frame = 0; frame < frameCount; frame++)
+			{
+				for (uint32_t channel = 0; channel < channels; channel++)
+				{
+					double phase = (2.0 * 3.14159265358979 * 440.0 * static_cast<double>(frame) / 44100.0) + channel;
+					original[(frame * channels) + channel] = static_cast<int16_t>(20000.0 * sin(phase));
+				}
+			}
+
+			std::vector<uint8_t> data(static_cast<size_t>(blockCount) * format.m_blockAlign, 0);
+			for (uint32_t block = 0; block < blockCount; block++)
+			{
+				auto blockData = &data[block * format.m_blockAlign];
+				auto blockSamples = &original[static_cast<size_t>(block) * format.m_samplesPerBlock * channels];
+				for (uint32_t channel = 0; channel < channels; channel++)
+				{
+					int32_t sample = blockSamples[channel];
+					int32_t index = 40;
+					blockData[channel * 4] = static_cast<uint8_t>(sample & 0xFF);
+					blockData[(channel * 4) + 1] = static_cast<uint8_t>((sample >> 8) & 0xFF);
+					blockData[(channel * 4) + 2] = static_cast<uint8_t>(index);
+
+					for (uint32_t frame = 1; frame < format.m_samplesPerBlock; frame++)
+					{
+						int32_t step = StepTable[index];
+						int32_t difference = blockSamples[(frame * channels) + channel] - sample;
+						int32_t nibble = 0;
+						if (difference < 0)
+						{
+							nibble = 8;
+							difference = -difference;
+						}
+
+						int32_t decodedDifference = step >> 3;
+						if (difference >= step)
+						{
+							nibble |= 4;
+							difference -= step;
+							decodedDifference += step;
+						}
+						if (difference >= (step >> 1))
+						{
+							nibble |= 2;
+							difference -= step >> 1;
+							decodedDifference += step >> 1;
+						}
+						if (difference >= (step >> 2))
+						{
+							nibble |= 1;
+							decodedDifference += step >> 2;
+						}
+
+						sample = Clamp((nibble & 8) ? sample - decodedDifference : sample + decodedDifference, -32768, 32767);
+						index = Clamp(index + IndexTable[nibble], 0, 88);
+
+						uint32_t run = (frame - 1) / 8;
+						uint32_t position = (frame - 1) % 8;
+						auto& byte = blockData[(4 * channels) + (((run * channels) + channel) * 4) + (position / 2)];
+						byte = static_cast<uint8_t>(byte | ((position % 2 == 0) ? nibble : (nibble << 4)));
+					}
+				}
+			}
+
+			std::vector<int16_t> decoded(original.size());
+			CHECK(DX::DecodeAdpcm(format, data.data(), data.size(), decoded.data()) == frameCount);
+
+			double signal = 0.0;
+			double noise = 0.0;
+			for (size_t i = 0; i < original.size(); i++)
+			{
+				double error = static_cast<double>(decoded[i]) - original[i];
+				signal += static_cast<double>(original[i]) * original[i];
+				noise += error * error;
+			}
+
+			// 4-bit ADPCM of a clean sine is normally well over 30 dB.
+			double signalToNoise = 10.0 * log10(signal / (noise > 1.0 ? noise : 1.0));
+			CHECK(signalToNoise > 30.0);
+		}
+	}
+}
+
+int main()
+{
+	TestParseAdpcmFormat();
+	TestKnownSamples();
+	TestAgainstReference();
+	TestImaSineRoundTrip();
+
+	return PortableTests::Finish("AdpcmDecoderTests");
+}
@@ -0,0 +1,116 @@
+// Measures DX::IsRowAlphaOverlap (SSE2 or NEON where available) against the scalar per texel loop that IsPixelPerfectCollision used before, on
+// the overlap rectangles of synthetic sprites. Each case tests a batch of sprite pairs the way a frame of bullets against enemies would: the
+// "miss" cases have opaque texels that never line up, so every row of the overlap is scanned, and the "hit" cases stop at the first row that
+// overlaps. Run a release build. Usage: AlphaCollisionBenchmark
+
+#include <cstdint>
+#include <cstdio>
+#include <vector>
+
+#include "AlphaCollision.h"
+#include "TestHelpers.h"
+
+namespace
+{
+	const uint32_t PairCount = 256;
+	const uint32_t Repeats = 5;
+
+	// A B8G8R8A8 sprite whose texels are opaque with the given percent chance, only in the columns where (column % 2) == parity, so that
+	// sprites can be placed so that their opaque texels never line up.
+	std::vector<uint8_t> MakeSprite(PortableTests::Random& random, uint32_t size, int32_t opaquePercent, uint32_t parity)
+	{
+		std::vector<uint8_t> data(static_cast<size_t>(size) * size * 4, 0x40);
+		for (uint32_t y = 0; y < size; y++)
+		{
+			for (uint32_t x = 0; x < size; x++)
+			{
+				data[(((y * size) + x) * 4) + 3] = (x % 2 == parity && random.Range(0, 99) < opaquePercent) ? 255 : 0;
+			}
+		}
+
+		return data;
+	}
+
+	// Tests the overlap rectangle of each pair a row at a time with the given row test, the way IsPixelPerfectCollision does, and returns the
+	// number of pairs that collided.
+	template <typename RowTest>
+	uint32_t TestPairs(const std::vector<std::vector<uint8_t>>& spritesOne, const std::vector<std::vector<uint8_t>>& spritesTwo, uint32_t size,
+		uint32_t overlap, RowTest rowTest)
+	{
+		uint32_t hits = 0;
+		for (uint32_t pair = 0; pair < PairCount; pair++)
+		{
+			// Sprite two's upper left corner is at (size - overlap, size - overlap) in sprite one.
+			auto dataOne = spritesOne[pair].data();
+			auto dataTwo = spritesTwo[pair].data();
+			auto offset = size - overlap;
+			for (uint32_t y = 0; y < overlap; y++)
+			{
+				if (rowTest(dataOne + ((((offset + y) * size) + offset) * 4), dataTwo + ((y * size) * 4), overlap))
+				{
+					hits++;
+					break;
+				}
+			}
+		}
+
+		return hits;
+	}
+}
+
+int main()
+{
+	PortableTests::Random random(1);
+
+	struct BenchmarkCase
+	{
+		const char*				m_name;
+		uint32_t				m_size;
+		uint32_t				m_overlap;
+		uint32_t				m_parityTwo;
+	};
+	const BenchmarkCase cases[] =
+	{
+		{ "32x32 sprites, 13 texel overlap, miss", 32, 13, 1 },
+		{ "64x64 sprites, 48 texel overlap, miss", 64, 48, 1 },
+		{ "256x256 sprites, 255 texel overlap, miss", 256, 255, 1 },
+		{ "64x64 sprites, 48 texel overlap, hit", 64, 48, 0 },
+		{ "256x256 sprites, 255 texel overlap, hit", 256, 255, 0 },
+	};
+
+	for (auto& benchmarkCase : cases)
+	{
+		std::vector<std::vector<uint8_t>> spritesOne;
+		std::vector<std::vector<uint8_t>> spritesTwo;
+		for (uint32_t pair = 0; pair < PairCount; pair++)
+		{
+			spritesOne.push_back(MakeSprite(random, benchmarkCase.m_size, 60, 0));
+			// Sprite two's columns are offset from sprite one's by (size - overlap), which changes which of them line up.
+			auto parity = (benchmarkCase.m_parityTwo + benchmarkCase.m_size - benchmarkCase.m_overlap) % 2;
+			spritesTwo.push_back(MakeSprite(random, benchmarkCase.m_size, 60, parity));
+		}
+
+		// The best of a few runs, to leave out the first run's cache misses.
+		double scalarTime = 1.0e30;
+		double simdTime = 1.0e30;
+		uint32_t scalarHits = 0;
+		uint32_t simdHits = 0;
+		for (uint32_t repeat = 0; repeat < Repeats; repeat++)
+		{
+			double start = PortableTests::Seconds();
+			scalarHits = TestPairs(spritesOne, spritesTwo, benchmarkCase.m_size, benchmarkCase.m_overlap, DX::IsRowAlphaOverlapScalar);
+			double middle = PortableTests::Seconds();
+			simdHits = TestPairs(spritesOne, spritesTwo, benchmarkCase.m_size, benchmarkCase.m_overlap, DX::IsRowAlphaOverlap);
+			double end = PortableTests::Seconds();
+
+			scalarTime = (middle - start) < scalarTime ? middle - start : scalarTime;
+			simdTime = (end - middle) < simdTime ? end - middle : simdTime;
+		}
+
+		// The hit counts also keep the tests from being optimized away.
+		printf("%-42s %u pairs: scalar %8.1f us, IsRowAlphaOverlap %8.1f us (%4.1fx) [%u/%u hits]\n", benchmarkCase.m_name, PairCount,
+			scalarTime * 1.0e6, simdTime * 1.0e6, scalarTime / simdTime, scalarHits, simdHits);
+	}
+
+	return 0;
+}
@@ -0,0 +1,228 @@
+// Checks the SIMD DX::IsRowAlphaOverlap against the scalar version for every row length up to a few SIMD widths (so every tail length is
+// covered), with rows that are all transparent, all opaque, opaque at a single texel and random. Then checks DX::IsTransformedAlphaCollision
+// against the original per texel loop that it replaced, for random sprites and transforms. Rows and sprite two's texture data are allocated at
+// exactly their size so that a sanitized build (PORTABLE_TESTS_SANITIZE) catches any read outside of them; sprites that are only one or two
+// texels across in either direction have no columns that are safe to test without bounds checks, and used to read past the end of the data.
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <vector>
+
+#include "AlphaCollision.h"
+#include "TestHelpers.h"
+
+namespace
+{
+	// The loop that the B8G8R8A8 version of IsTransformedPixelPerfectCollision used before the scan was clipped.
+	bool ReferenceAlphaCollision(
+		const uint8_t* dataOne,
+		uint32_t texOneWidth,
+		uint32_t columnCount,
+		uint32_t rowCount,
+		const uint8_t* dataTwo,
+		int32_t texTwoWidth,
+		int32_t texTwoHeight,
+		DX::TexelVector origin,
+		DX::TexelVector stepX,
+		DX::TexelVector stepY
+		)
+	{
+		DX::TexelVector yPositionInSpriteTwo = origin;
+		for (uint32_t spriteOneY = 0; spriteOneY < rowCount; spriteOneY++)
+		{
+			DX::TexelVector positionInSpriteTwo = yPositionInSpriteTwo;
+			for (uint32_t spriteOneX = 0; spriteOneX < columnCount; spriteOneX++)
+			{
+				int32_t spriteTwoX = static_cast<int32_t>(positionInSpriteTwo.x + (positionInSpriteTwo.x > 0.0f ? 0.5f : -0.5f));
+				int32_t spriteTwoY = static_cast<int32_t>(positionInSpriteTwo.y + (positionInSpriteTwo.y > 0.0f ? 0.5f : -0.5f));
+
+				if (spriteTwoX >= 0 && spriteTwoX < texTwoWidth && spriteTwoY >= 0 && spriteTwoY < texTwoHeight)
+				{
+					auto alphaOne = dataOne[(spriteOneX * 4 + spriteOneY * texOneWidth * 4) + 3];
+					auto alphaTwo = dataTwo[(spriteTwoX * 4 + spriteTwoY * texTwoWidth * 4) + 3];
+					if (alphaOne != 0 && alphaTwo != 0)
+					{
+						return true;
+					}
+				}
+
+				positionInSpriteTwo.x += stepX.x;
+				positionInSpriteTwo.y += stepX.y;
+			}
+
+			yPositionInSpriteTwo.x += stepY.x;
+			yPositionInSpriteTwo.y += stepY.y;
+		}
+
+		return false;
+	}
+
+	// Fills a B8G8R8A8 texture with random alpha values, where roughly opaquePercent percent of the texels have a non-zero alpha.
+	std::vector<uint8_t> MakeTexture(PortableTests::Random& random, int32_t width, int32_t height, int32_t opaquePercent)
+	{
+		std::vector<uint8_t> data(static_cast<size_t>(width) * height * 4);
+		for (size_t index = 3; index < data.size(); index += 4)
+		{
+			data[index] = random.Range(0, 99) < opaquePercent ? 255 : 0;
+		}
+
+		return data;
+	}
+
+	// Returns a row of texelCount B8G8R8A8 texels that all have the given alpha value. The color bytes are set so that only a test that looks at
+	// the alpha byte alone gets the right answer.
+	std::vector<uint8_t> MakeRow(uint32_t texelCount, uint8_t alpha)
+	{
+		std::vector<uint8_t> row(static_cast<size_t>(texelCount) * 4, 0xFF);
+		for (uint32_t i = 0; i < texelCount; i++)
+		{
+			row[(i * 4) + 3] = alpha;
+		}
+
+		return row;
+	}
+
+	// Checks both versions of the row test against the expected result, then checks the SIMD version again with the rows copied 1 to 3 bytes into
+	// longer buffers, so that its loads are unaligned and the rows still end at the last byte of the buffers.
+	void CheckRowAlphaOverlap(const std::vector<uint8_t>& rowOne, const std::vector<uint8_t>& rowTwo, uint32_t texelCount, bool expected)
+	{
+		CHECK(DX::IsRowAlphaOverlapScalar(rowOne.data(), rowTwo.data(), texelCount) == expected);
+		CHECK(DX::IsRowAlphaOverlap(rowOne.data(), rowTwo.data(), texelCount) == expected);
+
+		for (size_t offset = 1; offset < 4; offset++)
+		{
+			std::vector<uint8_t> shiftedOne(rowOne.size() + offset, 0xFF);
+			std::vector<uint8_t> shiftedTwo(rowTwo.size() + offset, 0xFF);
+			std::copy(rowOne.begin(), rowOne.end(), shiftedOne.begin() + offset);
+			std::copy(rowTwo.begin(), rowTwo.end(), shiftedTwo.begin() + offset);
+			CHECK(DX::IsRowAlphaOverlap(shiftedOne.data() + offset, shiftedTwo.data() + offset, texelCount) == expected);
+		}
+	}
+
+	void TestRowAlphaOverlap(PortableTests::Random& random)
+	{
+		for (uint32_t texelCount = 0; texelCount <= 70; texelCount++)
+		{
+			auto transparent = MakeRow(texelCount, 0);
+			auto opaque = MakeRow(texelCount, 255);
+			CheckRowAlphaOverlap(transparent, transparent, texelCount, false);
+			CheckRowAlphaOverlap(transparent, opaque, texelCount, false);
+			CheckRowAlphaOverlap(opaque, transparent, texelCount, false);
+			CheckRowAlphaOverlap(opaque, opaque, texelCount, texelCount != 0);
+
+			// A single texel that is opaque in both rows, at every position (so in the 16 texel groups, the groups of 4 and the scalar tail), and
+			// opaque texels that never line up.
+			for (uint32_t hit = 0; hit < texelCount; hit++)
+			{
+				auto rowOne = MakeRow(texelCount, 0);
+				auto rowTwo = MakeRow(texelCount, 0);
+				rowOne[(hit * 4) + 3] = 1;
+				rowTwo[(hit * 4) + 3] = 0x80;
+				CheckRowAlphaOverlap(rowOne, rowTwo, texelCount, true);
+
+				rowTwo[(hit * 4) + 3] = 0;
+				if (hit + 1 < texelCount)
+				{
+					rowTwo[((hit + 1) * 4) + 3] = 255;
+				}
+				CheckRowAlphaOverlap(rowOne, rowTwo, texelCount, false);
+			}
+
+			// Random sparse rows, which only sometimes overlap.
+			for (int iteration = 0; iteration < 20; iteration++)
+			{
+				auto rowOne = MakeRow(texelCount, 0);
+				auto rowTwo = MakeRow(texelCount, 0);
+				bool expected = false;
+				for (uint32_t i = 0; i < texelCount; i++)
+				{
+					rowOne[(i * 4) + 3] = random.Range(0, 9) == 0 ? static_cast<uint8_t>(random.Range(1, 255)) : 0;
+					rowTwo[(i * 4) + 3] = random.Range(0, 9) == 0 ? static_cast<uint8_t>(random.Range(1, 255)) : 0;
+					expected = expected || (rowOne[(i * 4) + 3] != 0 && rowTwo[(i * 4) + 3] != 0);
+				}
+				CheckRowAlphaOverlap(rowOne, rowTwo, texelCount, expected);
+			}
+		}
+	}
+
+	// Tests one random placement of sprite one over a sprite two of the given size.
+	void TestRandomCase(PortableTests::Random& random, int32_t texTwoWidth, int32_t texTwoHeight)
+	{
+		auto texOneWidth = random.Range(1, 48);
+		auto texOneHeight = random.Range(1, 48);
+		auto columnCount = static_cast<uint32_t>(random.Range(1, texOneWidth));
+		auto rowCount = static_cast<uint32_t>(random.Range(1, texOneHeight));
+
+		// Sparse sprites make the scan run across whole rows without finding anything, which is where it goes wrong.
+		auto dataOne = MakeTexture(random, texOneWidth, texOneHeight, random.Range(0, 3) == 0 ? 100 : random.Range(0, 30));
+		auto dataTwo = MakeTexture(random, texTwoWidth, texTwoHeight, random.Range(0, 3) == 0 ? 100 : random.Range(0, 30));
+
+		// A random rotation and scale (sometimes axis aligned, and sometimes mirrored) and a position that puts the sprites roughly on top of
+		// each other.
+		float angle = random.Range(0, 3) == 0 ? 0.0f : random.Range(0.0f, 6.2831853f);
+		float scale = random.Range(0.25f, 3.0f);
+		float mirror = random.Range(0, 3) == 0 ? -1.0f : 1.0f;
+		DX::TexelVector stepX = { std::cos(angle) * scale, std::sin(angle) * scale };
+		DX::TexelVector stepY = { -std::sin(angle) * scale * mirror, std::cos(angle) * scale * mirror };
+		DX::TexelVector origin = {
+			random.Range(-1.5f * texOneWidth * scale, texTwoWidth + 1.5f * texOneWidth * scale),
+			random.Range(-1.5f * texOneHeight * scale, texTwoHeight + 1.5f * texOneHeight * scale)
+		};
+
+		bool expected = ReferenceAlphaCollision(dataOne.data(), texOneWidth, columnCount, rowCount, dataTwo.data(), texTwoWidth, texTwoHeight,
+			origin, stepX, stepY);
+		bool actual = DX::IsTransformedAlphaCollision(dataOne.data(), texOneWidth, columnCount, rowCount, dataTwo.data(), texTwoWidth,
+			texTwoHeight, origin, stepX, stepY);
+		CHECK(actual == expected);
+	}
+
+	// Runs a row of sprite one exactly along a sprite two that is a single texel high, which is the case that used to read past the end of it.
+	void TestThinSpriteTwo()
+	{
+		const int32_t texTwoWidth = 22;
+		std::vector<uint8_t> dataOne(64 * 4, 0);
+		std::vector<uint8_t> dataTwo(texTwoWidth * 4, 0);
+		dataOne[(63 * 4) + 3] = 255;
+		dataTwo[(21 * 4) + 3] = 255;
+
+		// The last texel of sprite one lands just past the end of sprite two.
+		DX::TexelVector origin = { -41.0f, 0.0f };
+		DX::TexelVector stepX = { 1.0f, 0.0f };
+		DX::TexelVector stepY = { 0.0f, 1.0f };
+		CHECK(!DX::IsTransformedAlphaCollision(dataOne.data(), 64, 64, 1, dataTwo.data(), texTwoWidth, 1, origin, stepX, stepY));
+
+		// The last texel of sprite one lands on the first texel of sprite two.
+		origin.x = -63.0f;
+		dataTwo[3] = 255;
+		CHECK(DX::IsTransformedAlphaCollision(dataOne.data(), 64, 64, 1, dataTwo.data(), texTwoWidth, 1, origin, stepX, stepY));
+	}
+}
+
+int main()
+{
+	PortableTests::Random random(20261016);
+
+	TestRowAlphaOverlap(random);
+	TestThinSpriteTwo();
+
+	// Sprites one and two texels across in either direction, then a spread of other sizes.
+	const int32_t sizes[][2] = {
+		{ 1, 1 }, { 2, 2 }, { 1, 2 }, { 2, 1 }, { 22, 1 }, { 1, 22 }, { 22, 2 }, { 2, 22 }, { 64, 1 }, { 1, 64 }, { 3, 3 }, { 3, 40 }, { 40, 3 },
+		{ 16, 16 }, { 37, 23 }, { 64, 64 }
+	};
+	for (auto& size : sizes)
+	{
+		for (int iteration = 0; iteration < 2000; iteration++)
+		{
+			TestRandomCase(random, size[0], size[1]);
+		}
+	}
+
+	for (int iteration = 0; iteration < 20000; iteration++)
+	{
+		TestRandomCase(random, random.Range(1, 64), random.Range(1, 64));
+	}
+
+	return PortableTests::Finish("AlphaCollisionTests");
+}
@@ -0,0 +1,342 @@
+// Streams a fake file through DX::AudioStreamScheduler to a fake voice, following the same protocol as StreamingSoundEffect: reads run on
+// background threads under a fill lock, the voice plays its buffers on its own thread and calls OnBufferEnd with the generation that each buffer
+// was submitted with, and stopping moves to a new generation under a callback lock before flushing the voice and rewinding the scheduler. The voice
+// copies each buffer when it plays it, so a buffer that is overwritten while it is still queued shows up as wrong data, and every play is checked
+// against the file (including its loops).
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <cstring>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "AudioStreamScheduler.h"
+#include "TestHelpers.h"
+
+namespace
+{
+	// Runs tasks on their own threads and waits for them, like concurrency::task_group.
+	class TaskGroup
+	{
+	public:
+		~TaskGroup() { Wait(); }
+
+		void Run(std::function<void()> task)
+		{
+			std::lock_guard<std::mutex> lock(m_lock);
+			m_threads.push_back(std::thread(task));
+		}
+
+		void Wait()
+		{
+			std::vector<std::thread> threads;
+			{
+				std::lock_guard<std::mutex> lock(m_lock);
+				threads.swap(m_threads);
+			}
+
+			for (auto& thread : threads)
+			{
+				thread.join();
+			}
+		}
+
+	private:
+		std::mutex					m_lock;
+		std::vector<std::thread>	m_threads;
+	};
+
+	class FakeStream;
+
+	// A voice that plays its queued buffers on its own thread. Playing a buffer appends its samples to the record for the buffer's generation.
+	class FakeVoice
+	{
+	public:
+		explicit FakeVoice(uint32_t bufferCount) :
+			m_bufferCount(bufferCount),
+			m_stream(),
+			m_queue(),
+			m_flushed(),
+			m_played(),
+			m_exit(),
+			m_thread()
+		{
+		}
+
+		~FakeVoice()
+		{
+			{
+				std::lock_guard<std::mutex> lock(m_lock);
+				m_exit = true;
+			}
+			m_wake.notify_all();
+			m_thread.join();
+		}
+
+		void Start(FakeStream* stream)
+		{
+			m_stream = stream;
+			m_thread = std::thread([this]() { Run(); });
+		}
+
+		void Submit(const uint8_t* data, uint32_t byteCount, uint32_t generation)
+		{
+			std::lock_guard<std::mutex> lock(m_lock);
+
+			// The scheduler must never hand out more buffers than there are.
+			CHECK(m_queue.size() < m_bufferCount);
+			QueuedBuffer buffer = { data, byteCount, generation };
+			m_queue.push_back(buffer);
+			m_wake.notify_all();
+		}
+
+		// Drops the queued buffers. Their OnBufferEnd callbacks still come, from the voice thread, like XAudio2's FlushSourceBuffers.
+		void Flush()
+		{
+			std::lock_guard<std::mutex> lock(m_lock);
+			m_flushed.insert(m_flushed.end(), m_queue.begin(), m_queue.end());
+			m_queue.clear();
+			m_wake.notify_all();
+		}
+
+		// Returns the samples played for a generation.
+		std::vector<uint32_t> GetPlayed(uint32_t generation)
+		{
+			std::lock_guard<std::mutex> lock(m_lock);
+			return (generation < m_played.size()) ? m_played[generation] : std::vector<uint32_t>();
+		}
+
+	private:
+		struct QueuedBuffer
+		{
+			const uint8_t*			m_data;
+			uint32_t				m_byteCount;
+			uint32_t				m_generation;
+		};
+
+		void Run();
+
+		uint32_t							m_bufferCount;
+		FakeStream*							m_stream;
+		std::mutex							m_lock;
+		std::condition_variable				m_wake;
+		std::deque<QueuedBuffer>			m_queue;
+		std::deque<QueuedBuffer>			m_flushed;
+		std::vector<std::vector<uint32_t>>	m_played;
+		bool								m_exit;
+		std::thread							m_thread;
+	};
+
+	// The parts of StreamingSoundEffect that drive the scheduler, with a fake file and voice.
+	class FakeStream
+	{
+	public:
+		FakeStream(const std::vector<uint32_t>& file, uint32_t bufferCount, uint32_t bufferSize) :
+			m_file(file),
+			m_voice(bufferCount),
+			m_scheduler(),
+			m_bufferData(),
+			m_generation(0),
+			m_playing(false)
+		{
+			m_scheduler.Initialize(bufferCount, bufferSize, sizeof(uint32_t), file.size() * sizeof(uint32_t), 0, 0, 0);
+			m_bufferData.assign(bufferCount * m_scheduler.GetBufferSize(), 0);
+			m_voice.Start(this);
+		}
+
+		~FakeStream()
+		{
+			StopAndFlush();
+		}
+
+		// Returns the generation that the play uses.
+		uint32_t Play(uint32_t loopCount)
+		{
+			StopAndFlush();
+			{
+				std::lock_guard<std::mutex> lock(m_fillLock);
+				m_scheduler.Rewind(loopCount);
+			}
+
+			auto generation = m_generation.load();
+			m_playing = true;
+			FillBuffers(generation);
+			return generation;
+		}
+
+		void StopAndFlush()
+		{
+			m_playing = false;
+			NextGeneration();
+
+			std::unique_lock<std::mutex> lock(m_fillLock);
+			m_voice.Flush();
+			m_scheduler.Reset(0);
+			lock.unlock();
+
+			m_readers.Wait();
+		}
+
+		bool IsFinished()
+		{
+			std::lock_guard<std::mutex> lock(m_fillLock);
+			return m_scheduler.IsFinished();
+		}
+
+		FakeVoice& GetVoice() { return m_voice; }
+
+		// Called by the voice thread.
+		void OnBufferEnd(uint32_t generation)
+		{
+			std::lock_guard<std::mutex> lock(m_callbackLock);
+			if (generation != m_generation.load())
+			{
+				return;
+			}
+
+			m_scheduler.OnBufferEnd();
+			if (m_playing)
+			{
+				m_readers.Run([this, generation]() { FillBuffers(generation); });
+			}
+		}
+
+	private:
+		void NextGeneration()
+		{
+			std::lock_guard<std::mutex> lock(m_callbackLock);
+			m_generation++;
+		}
+
+		void FillBuffers(uint32_t generation)
+		{
+			std::lock_guard<std::mutex> lock(m_fillLock);
+
+			DX::AudioStreamChunk chunk;
+			while (generation == m_generation.load() && m_scheduler.GetNextChunk(chunk))
+			{
+				auto bufferData = &m_bufferData[chunk.m_buffer * m_scheduler.GetBufferSize()];
+				memcpy(bufferData, reinterpret_cast<const uint8_t*>(m_file.data()) + chunk.m_offset, chunk.m_byteCount);
+				m_voice.Submit(bufferData, chunk.m_byteCount, generation);
+			}
+		}
+
+		const std::vector<uint32_t>&	m_file;
+		FakeVoice						m_voice;
+		DX::AudioStreamScheduler		m_scheduler;
+		std::vector<uint8_t>			m_bufferData;
+		TaskGroup						m_readers;
+		std::mutex						m_fillLock;
+		std::mutex						m_callbackLock;
+		std::atomic<uint32_t>			m_generation;
+		std::atomic<bool>				m_playing;
+	};
+
+	void FakeVoice::Run()
+	{
+		std::unique_lock<std::mutex> lock(m_lock);
+		for (;;)
+		{
+			m_wake.wait(lock, [this]() { return m_exit || !m_queue.empty() || !m_flushed.empty(); });
+			if (m_exit)
+			{
+				return;
+			}
+
+			QueuedBuffer buffer;
+			if (!m_flushed.empty())
+			{
+				buffer = m_flushed.front();
+				m_flushed.pop_front();
+			}
+			else
+			{
+				buffer = m_queue.front();
+				m_queue.pop_front();
+
+				// Play the buffer: copy it now, so a buffer that was overwritten while it was queued gives the wrong samples.
+				if (m_played.size() <= buffer.m_generation)
+				{
+					m_played.resize(buffer.m_generation + 1);
+				}
+				auto samples = reinterpret_cast<const uint32_t*>(buffer.m_data);
+				m_played[buffer.m_generation].insert(m_played[buffer.m_generation].end(), samples, samples + (buffer.m_byteCount / sizeof(uint32_t)));
+			}
+
+			// Take a little time over each buffer and call back without the voice's lock, like XAudio2.
+			lock.unlock();
+			std::this_thread::sleep_for(std::chrono::microseconds(50));
+			m_stream->OnBufferEnd(buffer.m_generation);
+			lock.lock();
+		}
+	}
+
+	// Returns what a play with loopCount loops should sound like.
+	std::vector<uint32_t> GetExpected(const std::vector<uint32_t>& file, uint32_t loopCount)
+	{
+		std::vector<uint32_t> expected;
+		for (uint32_t loop = 0; loop <= loopCount; loop++)
+		{
+			expected.insert(expected.end(), file.begin(), file.end());
+		}
+		return expected;
+	}
+
+	bool WaitUntilFinished(FakeStream& stream)
+	{
+		for (int wait = 0; wait < 20000; wait++)
+		{
+			if (stream.IsFinished())
+			{
+				return true;
+			}
+			std::this_thread::sleep_for(std::chrono::microseconds(100));
+		}
+		return false;
+	}
+}
+
+int main()
+{
+	std::vector<uint32_t> file(5000);
+	for (uint32_t i = 0; i < file.size(); i++)
+	{
+		file[i] = i;
+	}
+
+	PortableTests::Random random(15);
+	FakeStream stream(file, 3, 1000);
+
+	// Whole plays, with and without loops.
+	for (uint32_t loopCount = 0; loopCount < 3; loopCount++)
+	{
+		auto generation = stream.Play(loopCount);
+		CHECK(WaitUntilFinished(stream));
+		CHECK(stream.GetVoice().GetPlayed(generation) == GetExpected(file, loopCount));
+	}
+
+	// Plays that are cut short by another play at random times. Whatever was played before the stop has to be the start of the sound, and the
+	// stale callbacks from the flushed buffers mustn't upset the next play.
+	for (int iteration = 0; iteration < 2000; iteration++)
+	{
+		auto generation = stream.Play(1);
+		std::this_thread::sleep_for(std::chrono::microseconds(random.Range(0, 200)));
+		stream.StopAndFlush();
+
+		auto played = stream.GetVoice().GetPlayed(generation);
+		auto expected = GetExpected(file, 1);
+		CHECK(played.size() <= expected.size());
+		CHECK(std::equal(played.begin(), played.end(), expected.begin()));
+	}
+
+	auto generation = stream.Play(2);
+	CHECK(WaitUntilFinished(stream));
+	CHECK(stream.GetVoice().GetPlayed(generation) == GetExpected(file, 2));
+
+	return PortableTests::Finish("AudioStreamSchedulerTests");
+}
@@ -0,0 +1,247 @@
+// Measures how fast a 2048 x 2048 BC1 and BC3 texture decodes to B8G8R8A8 with the per texel loop that GetTexture2DCollisionDataNoRender used
+// before BlockCompression (copied below with DirectXMath's XMVectorLerp and XMStoreUByteN4 written out as float math), with DecodeBlockRowsBGRA
+// on one thread and split across every hardware thread (as GetTexture2DCollisionDataNoRender does with parallel_for), and with the alpha only
+// DecodeBlockRowsAlpha that collision masks use. The blocks are random bytes, which gives a mix of BC1's four and three color modes.
+// Run a release build. Usage: BlockCompressionBenchmark
+
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <thread>
+#include <vector>
+
+#include "BlockCompression.h"
+#include "TestHelpers.h"
+
+namespace
+{
+	const uint32_t Size = 2048;
+	const uint32_t Repeats = 5;
+
+	// Loads a B5G6R5 color as 0 to 1 floats in B, G, R order, like XMLoadU565 followed by dividing by (31, 63, 31).
+	void LoadColor(uint16_t color, float channels[3])
+	{
+		channels[0] = static_cast<float>(color & 0x1F) / 31.0f;
+		channels[1] = static_cast<float>((color >> 5) & 0x3F) / 63.0f;
+		channels[2] = static_cast<float>(color >> 11) / 31.0f;
+	}
+
+	// Stores 0 to 1 floats as bytes, like XMStoreUByteN4.
+	void StoreColor(const float channels[3], uint8_t bytes[3])
+	{
+		for (uint32_t i = 0; i < 3; i++)
+		{
+			auto value = channels[i] < 0.0f ? 0.0f : (channels[i] > 1.0f ? 1.0f : channels[i]);
+			bytes[i] = static_cast<uint8_t>((value * 255.0f) + 0.5f);
+		}
+	}
+
+	void Lerp(const float one[3], const float two[3], float t, float result[3])
+	{
+		for (uint32_t i = 0; i < 3; i++)
+		{
+			result[i] = one[i] + ((two[i] - one[i]) * t);
+		}
+	}
+
+	// The per texel decoder from before BlockCompression: copy the mapped blocks out, then decode block by block with a switch per texel.
+	void OldDecode(const uint8_t* mapped, size_t rowPitch, uint32_t width, uint32_t height, bool isBC3, uint8_t* resultDataPtr)
+	{
+		const uint32_t pixelsPerBlockDimension = 4;
+		const uint32_t bytesPerBGRAPixel = 4;
+		uint32_t bytesPerBlock = isBC3 ? 16 : 8;
+		auto resourceDataSizeInBytes = ((width / pixelsPerBlockDimension) * (height / pixelsPerBlockDimension)) * bytesPerBlock;
+		auto rowSizeInBytes = (width / pixelsPerBlockDimension) * bytesPerBlock;
+		std::vector<uint8_t> resourceData(resourceDataSizeInBytes);
+		for (unsigned int i = 0; i < (height / pixelsPerBlockDimension); i++)
+		{
+			memcpy(resourceData.data() + (i * rowSizeInBytes), mapped + (i * rowPitch), rowSizeInBytes);
+		}
+
+		memset(resultDataPtr, 0, width * height * bytesPerBGRAPixel);
+
+		auto resourceDataPtr = resourceData.data();
+		for (unsigned int i = 0; i < resourceDataSizeInBytes; i += bytesPerBlock)
+		{
+			uint8_t alphaValue = 0;
+			uint8_t alphas[8] = {};
+			uint64_t alphamap = 0ULL;
+
+			if (isBC3)
+			{
+				alphas[0] = resourceDataPtr[i + 0];
+				alphas[1] = resourceDataPtr[i + 1];
+				if (alphas[0] > alphas[1])
+				{
+					alphas[2] = static_cast<uint8_t>((6 * alphas[0] + 1 * alphas[1] + 3) / 7);
+					alphas[3] = static_cast<uint8_t>((5 * alphas[0] + 2 * alphas[1] + 3) / 7);
+					alphas[4] = static_cast<uint8_t>((4 * alphas[0] + 3 * alphas[1] + 3) / 7);
+					alphas[5] = static_cast<uint8_t>((3 * alphas[0] + 4 * alphas[1] + 3) / 7);
+					alphas[6] = static_cast<uint8_t>((2 * alphas[0] + 5 * alphas[1] + 3) / 7);
+					alphas[7] = static_cast<uint8_t>((1 * alphas[0] + 6 * alphas[1] + 3) / 7);
+				}
+				else
+				{
+					alphas[2] = static_cast<uint8_t>((4 * alphas[0] + 1 * alphas[1] + 2) / 5);
+					alphas[3] = static_cast<uint8_t>((3 * alphas[0] + 2 * alphas[1] + 2) / 5);
+					alphas[4] = static_cast<uint8_t>((2 * alphas[0] + 3 * alphas[1] + 2) / 5);
+					alphas[5] = static_cast<uint8_t>((1 * alphas[0] + 4 * alphas[1] + 2) / 5);
+					alphas[6] = 0;
+					alphas[7] = 255;
+				}
+
+				for (uint32_t byte = 0; byte < 6; byte++)
+				{
+					alphamap |= static_cast<uint64_t>(resourceDataPtr[i + 2 + byte]) << (8 * byte);
+				}
+			}
+
+			uint32_t bcTypeOffset = isBC3 ? 8 : 0;
+			auto color0 = static_cast<uint16_t>(resourceDataPtr[i + bcTypeOffset + 0] | (resourceDataPtr[i + bcTypeOffset + 1] << 8));
+			auto color1 = static_cast<uint16_t>(resourceDataPtr[i + bcTypeOffset + 2] | (resourceDataPtr[i + bcTypeOffset + 3] << 8));
+			uint32_t colormap = 0;
+			for (uint32_t byte = 0; byte < 4; byte++)
+			{
+				colormap |= static_cast<uint32_t>(resourceDataPtr[i + bcTypeOffset + 4 + byte]) << (8 * byte);
+			}
+
+			float vecColor0[3];
+			float vecColor1[3];
+			LoadColor(color0, vecColor0);
+			LoadColor(color1, vecColor1);
+
+			uint8_t c[4][3];
+			StoreColor(vecColor0, c[0]);
+			StoreColor(vecColor1, c[1]);
+			float lerped[3];
+			if (isBC3 || (color0 > color1))
+			{
+				Lerp(vecColor0, vecColor1, 1.0f / 3.0f, lerped);
+				StoreColor(lerped, c[2]);
+				Lerp(vecColor0, vecColor1, 2.0f / 3.0f, lerped);
+				StoreColor(lerped, c[3]);
+			}
+			else
+			{
+				Lerp(vecColor0, vecColor1, 0.5f, lerped);
+				StoreColor(lerped, c[2]);
+				memset(c[3], 0, sizeof(c[3]));
+			}
+
+			int currentRow = (i / ((width / pixelsPerBlockDimension))) / bytesPerBlock * pixelsPerBlockDimension;
+			int currentColumnOffset = (i % ((width / pixelsPerBlockDimension) * bytesPerBlock)) / bytesPerBlock * pixelsPerBlockDimension;
+
+			for (uint32_t y = 0; y < pixelsPerBlockDimension; y++)
+			{
+				for (uint32_t x = 0; x < pixelsPerBlockDimension; x++)
+				{
+					if (isBC3)
+					{
+						alphaValue = alphas[alphamap & 7];
+					}
+					else
+					{
+						switch (colormap & 3)
+						{
+						case 0:
+						case 1:
+						case 2:
+							alphaValue = 0xFF;
+							break;
+						default:
+							alphaValue = (color0 > color1) ? 0xFF : 0x0;
+							break;
+						}
+					}
+
+					int index = ((currentRow * width * bytesPerBGRAPixel) + (y * width * bytesPerBGRAPixel)) + (currentColumnOffset * bytesPerBGRAPixel) +
+						(x * bytesPerBGRAPixel);
+					auto color = c[colormap & 3];
+					resultDataPtr[index + 0] = color[0];
+					resultDataPtr[index + 1] = color[1];
+					resultDataPtr[index + 2] = color[2];
+					resultDataPtr[index + 3] = alphaValue;
+					colormap >>= 2;
+					alphamap >>= 3;
+				}
+			}
+		}
+	}
+
+	// Decodes the image with DecodeBlockRowsBGRA split into one range of block rows per thread.
+	void DecodeOnThreads(DX::BlockFormat format, const uint8_t* source, size_t rowPitch, uint32_t threadCount, uint8_t* destination)
+	{
+		auto blockRows = Size / 4;
+		std::vector<std::thread> threads;
+		for (uint32_t i = 0; i < threadCount; i++)
+		{
+			auto first = (blockRows * i) / threadCount;
+			auto last = (blockRows * (i + 1)) / threadCount;
+			threads.push_back(std::thread([=]()
+			{
+				DX::DecodeBlockRowsBGRA(format, source, rowPitch, Size, Size, first, last - first, destination);
+			}));
+		}
+		for (auto& thread : threads)
+		{
+			thread.join();
+		}
+	}
+}
+
+int main()
+{
+	PortableTests::Random random(10);
+	auto threadCount = std::thread::hardware_concurrency();
+	threadCount = (threadCount != 0) ? threadCount : 1;
+
+	const DX::BlockFormat formats[] = { DX::BlockFormat::BC1, DX::BlockFormat::BC3 };
+	for (auto format : formats)
+	{
+		auto rowPitch = static_cast<size_t>(Size / 4) * DX::GetBlockSizeInBytes(format);
+		std::vector<uint8_t> source(rowPitch * (Size / 4));
+		for (auto& byte : source)
+		{
+			byte = static_cast<uint8_t>(random.Next() >> 24);
+		}
+
+		std::vector<uint8_t> texels(static_cast<size_t>(Size) * Size * 4);
+		std::vector<uint8_t> alphas(static_cast<size_t>(Size) * Size);
+
+		// The best of a few runs, to leave out the first run's page faults.
+		double oldTime = 1.0e30;
+		double rowsTime = 1.0e30;
+		double threadsTime = 1.0e30;
+		double alphaTime = 1.0e30;
+		uint32_t checksum = 0;
+		for (uint32_t repeat = 0; repeat < Repeats; repeat++)
+		{
+			double start = PortableTests::Seconds();
+			OldDecode(source.data(), rowPitch, Size, Size, format == DX::BlockFormat::BC3, texels.data());
+			double afterOld = PortableTests::Seconds();
+			checksum += texels[texels.size() / 2];
+			DX::DecodeBlockRowsBGRA(format, source.data(), rowPitch, Size, Size, 0, Size / 4, texels.data());
+			double afterRows = PortableTests::Seconds();
+			checksum += texels[texels.size() / 2];
+			DecodeOnThreads(format, source.data(), rowPitch, threadCount, texels.data());
+			double afterThreads = PortableTests::Seconds();
+			checksum += texels[texels.size() / 2];
+			DX::DecodeBlockRowsAlpha(format, source.data(), rowPitch, Size, Size, 0, Size / 4, alphas.data());
+			double afterAlpha = PortableTests::Seconds();
+			checksum += alphas[alphas.size() / 2];
+
+			oldTime = (afterOld - start) < oldTime ? afterOld - start : oldTime;
+			rowsTime = (afterRows - afterOld) < rowsTime ? afterRows - afterOld : rowsTime;
+			threadsTime = (afterThreads - afterRows) < threadsTime ? afterThreads - afterRows : threadsTime;
+			alphaTime = (afterAlpha - afterThreads) < alphaTime ? afterAlpha - afterThreads : alphaTime;
+		}
+
+		// Print the checksum so that the decoding can't be optimized away.
+		printf("%s %ux%u: per texel %7.2f ms, DecodeBlockRowsBGRA %6.2f ms (%4.1fx), on %u threads %6.2f ms (%4.1fx), "
+			"DecodeBlockRowsAlpha %6.2f ms (%4.1fx) [%u]\n",
+			format == DX::BlockFormat::BC1 ? "BC1" : "BC3", Size, Size, oldTime * 1000.0, rowsTime * 1000.0, oldTime / rowsTime, threadCount,
+			threadsTime * 1000.0, oldTime / threadsTime, alphaTime * 1000.0, oldTime / alphaTime, checksum);
+	}
+
+	return 0;
+}
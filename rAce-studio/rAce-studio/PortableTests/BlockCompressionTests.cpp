@@ -0,0 +1,640 @@
+// Checks the block decoders against hand worked blocks whose texels are known: BC1 in its four color mode and in its three color mode with
+// transparent black (including equal endpoints, which pick the three color mode), BC3 with alpha blocks in both the eight value and the
+// six value orderings, and signed and unsigned BC4 and BC5 blocks in both orderings. BC7 blocks of every mode are built field by field from
+// the format description, with 2 and 3 subset partitions whose anchor texels store one less index bit, every rotation and index selection,
+// and the reserved mode 8, and their texels are worked out from the same description. Then checks that decoding whole images in row ranges,
+// with odd sizes that clip the edge blocks, gives the same texels as decoding each block on its own, and that the alpha only decoders give the
+// same alpha as the B8G8R8A8 decoders.
+
+#include <cstdint>
+#include <cstring>
+#include <vector>
+
+#include "BlockCompression.h"
+#include "TestHelpers.h"
+
+namespace
+{
+	// A B8G8R8A8 texel, in memory order.
+	struct Texel
+	{
+		uint8_t					b;
+		uint8_t					g;
+		uint8_t					r;
+		uint8_t					a;
+	};
+
+	// Writes a B5G6R5 color and a 2 bits per texel index map (indices in texel order) to a BC1 style color block.
+	void WriteColorBlock(uint8_t* block, uint16_t color0, uint16_t color1, const uint32_t indices[16])
+	{
+		block[0] = static_cast<uint8_t>(color0);
+		block[1] = static_cast<uint8_t>(color0 >> 8);
+		block[2] = static_cast<uint8_t>(color1);
+		block[3] = static_cast<uint8_t>(color1 >> 8);
+		uint32_t bits = 0;
+		for (uint32_t i = 0; i < 16; i++)
+		{
+			bits |= indices[i] << (2 * i);
+		}
+		for (uint32_t i = 0; i < 4; i++)
+		{
+			block[4 + i] = static_cast<uint8_t>(bits >> (8 * i));
+		}
+	}
+
+	// Writes two endpoints and a 3 bits per texel index map (indices in texel order) to a BC3 style alpha block.
+	void WriteAlphaBlock(uint8_t* block, uint8_t alpha0, uint8_t alpha1, const uint32_t indices[16])
+	{
+		block[0] = alpha0;
+		block[1] = alpha1;
+		uint64_t bits = 0;
+		for (uint32_t i = 0; i < 16; i++)
+		{
+			bits |= static_cast<uint64_t>(indices[i]) << (3 * i);
+		}
+		for (uint32_t i = 0; i < 6; i++)
+		{
+			block[2 + i] = static_cast<uint8_t>(bits >> (8 * i));
+		}
+	}
+
+	// Decodes a block both ways and checks every texel against the expected texels (in texel order).
+	void CheckBlock(DX::BlockFormat format, const uint8_t* block, const Texel expected[16])
+	{
+		// Decode into the middle of a larger image so that writes past the block would show up.
+		const uint32_t pitch = 12;
+		uint8_t texels[pitch * 4 * 6];
+		uint8_t alphas[pitch * 6];
+		std::memset(texels, 0xCD, sizeof(texels));
+		std::memset(alphas, 0xCD, sizeof(alphas));
+		DX::DecodeBlockBGRA(format, block, texels + (pitch * 4) + 16, pitch * 4);
+		DX::DecodeBlockAlpha(format, block, alphas + pitch + 4, pitch);
+
+		for (uint32_t y = 0; y < 6; y++)
+		{
+			for (uint32_t x = 0; x < pitch; x++)
+			{
+				auto texel = reinterpret_cast<const Texel*>(texels + (y * pitch * 4) + (x * 4));
+				auto alpha = alphas[(y * pitch) + x];
+				if (y < 1 || y > 4 || x < 4 || x > 7)
+				{
+					CHECK(texel->b == 0xCD && texel->g == 0xCD && texel->r == 0xCD && texel->a == 0xCD);
+					CHECK(alpha == 0xCD);
+					continue;
+				}
+
+				auto& wanted = expected[((y - 1) * 4) + (x - 4)];
+				CHECK(texel->b == wanted.b && texel->g == wanted.g && texel->r == wanted.r && texel->a == wanted.a);
+				CHECK(alpha == wanted.a);
+			}
+		}
+	}
+
+	void TestBC1()
+	{
+		// Each row is indices 0, 1, 2, 3.
+		const uint32_t indices[16] = { 0, 1, 2, 3, 0, 1, 2, 3, 0, 1, 2, 3, 0, 1, 2, 3 };
+		uint8_t block[8];
+
+		// Red (0xF800) > blue (0x001F): four colors, with colors 2 and 3 at 1/3 and 2/3 of the way from red to blue.
+		WriteColorBlock(block, 0xF800, 0x001F, indices);
+		const Texel fourColors[4] = { { 0, 0, 255, 255 }, { 255, 0, 0, 255 }, { 85, 0, 170, 255 }, { 170, 0, 85, 255 } };
+		Texel expected[16];
+		for (uint32_t i = 0; i < 16; i++)
+		{
+			expected[i] = fourColors[indices[i]];
+		}
+		CheckBlock(DX::BlockFormat::BC1, block, expected);
+
+		// Blue < red: three colors, with color 2 halfway between them, and color 3 transparent black.
+		WriteColorBlock(block, 0x001F, 0xF800, indices);
+		const Texel threeColors[4] = { { 255, 0, 0, 255 }, { 0, 0, 255, 255 }, { 128, 0, 128, 255 }, { 0, 0, 0, 0 } };
+		for (uint32_t i = 0; i < 16; i++)
+		{
+			expected[i] = threeColors[indices[i]];
+		}
+		CheckBlock(DX::BlockFormat::BC1, block, expected);
+
+		// Equal endpoints also pick the three color mode. 0x8410 has 16 in each 5-bit channel (132) and 32 in the 6-bit green (130).
+		const uint32_t mixed[16] = { 3, 3, 3, 3, 0, 1, 2, 3, 3, 2, 1, 0, 0, 0, 0, 0 };
+		WriteColorBlock(block, 0x8410, 0x8410, mixed);
+		const Texel equalColors[4] = { { 132, 130, 132, 255 }, { 132, 130, 132, 255 }, { 132, 130, 132, 255 }, { 0, 0, 0, 0 } };
+		for (uint32_t i = 0; i < 16; i++)
+		{
+			expected[i] = equalColors[mixed[i]];
+		}
+		CheckBlock(DX::BlockFormat::BC1, block, expected);
+
+		// White (0xFFFF) > black: white, black, and grays at 1/3 and 2/3 of the way from white to black.
+		WriteColorBlock(block, 0xFFFF, 0x0000, mixed);
+		const Texel grays[4] = { { 255, 255, 255, 255 }, { 0, 0, 0, 255 }, { 170, 170, 170, 255 }, { 85, 85, 85, 255 } };
+		for (uint32_t i = 0; i < 16; i++)
+		{
+			expected[i] = grays[mixed[i]];
+		}
+		CheckBlock(DX::BlockFormat::BC1, block, expected);
+	}
+
+	void TestBC3()
+	{
+		// Indices 0 to 7 then 7 to 0.
+		const uint32_t alphaIndices[16] = { 0, 1, 2, 3, 4, 5, 6, 7, 7, 6, 5, 4, 3, 2, 1, 0 };
+		const uint32_t colorIndices[16] = { 0, 1, 2, 3, 0, 1, 2, 3, 0, 1, 2, 3, 0, 1, 2, 3 };
+
+		// alpha0 > alpha1: the six values between them are interpolated in sevenths.
+		uint8_t block[16];
+		WriteAlphaBlock(block, 255, 0, alphaIndices);
+		const uint8_t eightValues[8] = { 255, 0, 219, 182, 146, 109, 73, 36 };
+
+		// BC3 color blocks always have four colors, even when color0 <= color1 (which would be the three color mode in BC1).
+		WriteColorBlock(block + 8, 0x001F, 0xF800, colorIndices);
+		const Texel colors[4] = { { 255, 0, 0, 0 }, { 0, 0, 255, 0 }, { 170, 0, 85, 0 }, { 85, 0, 170, 0 } };
+
+		Texel expected[16];
+		for (uint32_t i = 0; i < 16; i++)
+		{
+			expected[i] = colors[colorIndices[i]];
+			expected[i].a = eightValues[alphaIndices[i]];
+		}
+		CheckBlock(DX::BlockFormat::BC3, block, expected);
+
+		// alpha0 <= alpha1: four values are interpolated in fifths, and indices 6 and 7 are 0 and 255.
+		WriteAlphaBlock(block, 0, 255, alphaIndices);
+		const uint8_t sixValues[8] = { 0, 255, 51, 102, 153, 204, 0, 255 };
+		for (uint32_t i = 0; i < 16; i++)
+		{
+			expected[i].a = sixValues[alphaIndices[i]];
+		}
+		CheckBlock(DX::BlockFormat::BC3, block, expected);
+
+		// Uneven endpoints, where the rounding matters: (6 * 200 + 1 * 13 + 3) / 7 = 173 and so on.
+		WriteAlphaBlock(block, 200, 13, alphaIndices);
+		const uint8_t unevenEight[8] = { 200, 13, 173, 147, 120, 93, 66, 40 };
+		for (uint32_t i = 0; i < 16; i++)
+		{
+			expected[i].a = unevenEight[alphaIndices[i]];
+		}
+		CheckBlock(DX::BlockFormat::BC3, block, expected);
+
+		WriteAlphaBlock(block, 13, 200, alphaIndices);
+		const uint8_t unevenSix[8] = { 13, 200, 50, 88, 125, 163, 0, 255 };
+		for (uint32_t i = 0; i < 16; i++)
+		{
+			expected[i].a = unevenSix[alphaIndices[i]];
+		}
+		CheckBlock(DX::BlockFormat::BC3, block, expected);
+	}
+
+	void TestBC4BC5()
+	{
+		const uint32_t indices[16] = { 0, 1, 2, 3, 4, 5, 6, 7, 7, 6, 5, 4, 3, 2, 1, 0 };
+		const uint32_t otherIndices[16] = { 7, 7, 6, 6, 5, 5, 4, 4, 3, 3, 2, 2, 1, 1, 0, 0 };
+
+		// Each case is a pair of endpoints and the eight values that they decode to. Signed endpoints are bytes holding -127 to 127 (and -128,
+		// which is also -1.0). Signed values are decoded the way rendering to a UNORM target would: negative values become zero.
+		struct Case
+		{
+			uint8_t				m_endpoint0;
+			uint8_t				m_endpoint1;
+			uint8_t				m_values[8];
+		};
+		const Case unsignedCases[] =
+		{
+			{ 255, 0, { 255, 0, 219, 182, 146, 109, 73, 36 } },
+			{ 13, 200, { 13, 200, 50, 88, 125, 163, 0, 255 } },
+			{ 200, 200, { 200, 200, 200, 200, 200, 200, 0, 255 } }
+		};
+		const Case signedCases[] =
+		{
+			// 127 > -127: eight values, 127 * (7 - 2i) / 7 for i = 0 to 7, with 5/7, 3/7, and 1/7 of 255 rounding to 182, 109, and 36.
+			{ 0x7F, 0x81, { 255, 0, 182, 109, 36, 0, 0, 0 } },
+			// -128 (-1.0) <= 127: six values, 127 * (2i - 5) / 5 for i = 0 to 5, then -1.0 and 1.0.
+			{ 0x80, 0x7F, { 0, 255, 0, 0, 51, 153, 0, 255 } },
+			// 64 > 32: 64 / 127 is 128.5 / 255, and the rest lie between 128 and 64.
+			{ 0x40, 0x20, { 129, 64, 119, 110, 101, 92, 83, 73 } }
+		};
+
+		for (uint32_t isSigned = 0; isSigned < 2; isSigned++)
+		{
+			auto cases = isSigned ? signedCases : unsignedCases;
+			auto bc4 = isSigned ? DX::BlockFormat::BC4Snorm : DX::BlockFormat::BC4;
+			auto bc5 = isSigned ? DX::BlockFormat::BC5Snorm : DX::BlockFormat::BC5;
+			for (uint32_t i = 0; i < 3; i++)
+			{
+				// BC4 decodes as white with the channel as alpha.
+				uint8_t block[16];
+				WriteAlphaBlock(block, cases[i].m_endpoint0, cases[i].m_endpoint1, indices);
+				Texel expected[16];
+				for (uint32_t texel = 0; texel < 16; texel++)
+				{
+					Texel white = { 255, 255, 255, cases[i].m_values[indices[texel]] };
+					expected[texel] = white;
+				}
+				CheckBlock(bc4, block, expected);
+
+				// BC5 decodes as red and green from its two halves, and is opaque.
+				auto& greens = cases[(i + 1) % 3];
+				WriteAlphaBlock(block + 8, greens.m_endpoint0, greens.m_endpoint1, otherIndices);
+				for (uint32_t texel = 0; texel < 16; texel++)
+				{
+					Texel color = { 0, greens.m_values[otherIndices[texel]], cases[i].m_values[indices[texel]], 255 };
+					expected[texel] = color;
+				}
+				CheckBlock(bc5, block, expected);
+			}
+		}
+	}
+
+	// Writes the fields of a BC7 block in order, starting at bit 0 of byte 0.
+	class BC7Writer
+	{
+	public:
+		explicit BC7Writer(uint8_t* block) :
+			m_block(block),
+			m_position()
+		{
+			std::memset(block, 0, 16);
+		}
+
+		void Write(uint32_t value, uint32_t count)
+		{
+			CHECK(count < 32 && (value >> count) == 0);
+			for (uint32_t i = 0; i < count; i++, m_position++)
+			{
+				m_block[m_position / 8] |= static_cast<uint8_t>(((value >> i) & 1) << (m_position % 8));
+			}
+		}
+
+		uint32_t GetPosition() const { return m_position; }
+
+	private:
+		uint8_t*				m_block;
+		uint32_t				m_position;
+	};
+
+	// The fields of each BC7 mode, from the "BC7 Format Mode Reference".
+	struct BC7Layout
+	{
+		uint32_t				m_subsetCount;
+		uint32_t				m_partitionBits;
+		uint32_t				m_rotationBits;
+		uint32_t				m_indexSelectionBits;
+		uint32_t				m_colorBits;
+		uint32_t				m_alphaBits;
+		// 0 for no p-bits, 1 for a p-bit shared by both endpoints of a subset, 2 for a p-bit per endpoint.
+		uint32_t				m_pBitsPerSubset;
+		uint32_t				m_indexBits;
+		uint32_t				m_secondaryIndexBits;
+	};
+
+	const BC7Layout BC7Layouts[8] =
+	{
+		{ 3, 4, 0, 0, 4, 0, 2, 3, 0 },
+		{ 2, 6, 0, 0, 6, 0, 1, 3, 0 },
+		{ 3, 6, 0, 0, 5, 0, 0, 2, 0 },
+		{ 2, 6, 0, 0, 7, 0, 2, 2, 0 },
+		{ 1, 0, 2, 1, 5, 6, 0, 2, 3 },
+		{ 1, 0, 2, 0, 7, 8, 0, 2, 2 },
+		{ 1, 0, 0, 0, 7, 7, 2, 4, 0 },
+		{ 2, 6, 0, 0, 5, 5, 2, 2, 0 }
+	};
+
+	// A partition and the subset of each texel (from the partition tables), with the anchor texel of each subset (from the anchor tables).
+	struct BC7Partition
+	{
+		uint32_t				m_number;
+		uint32_t				m_subsets[16];
+		uint32_t				m_anchors[3];
+	};
+
+	const BC7Partition OneSubset = { 0, { 0 }, { 0, 0, 0 } };
+
+	const BC7Partition TwoSubsets[] =
+	{
+		{ 0, { 0, 0, 1, 1, 0, 0, 1, 1, 0, 0, 1, 1, 0, 0, 1, 1 }, { 0, 15, 0 } },
+		{ 17, { 0, 1, 1, 1, 0, 0, 0, 1, 0, 0, 0, 0, 0, 0, 0, 0 }, { 0, 2, 0 } },
+		{ 19, { 0, 1, 1, 1, 0, 0, 1, 1, 0, 0, 0, 1, 0, 0, 0, 0 }, { 0, 2, 0 } },
+		{ 34, { 0, 1, 0, 1, 1, 0, 1, 0, 0, 1, 0, 1, 1, 0, 1, 0 }, { 0, 6, 0 } },
+		{ 63, { 0, 1, 0, 0, 0, 1, 0, 0, 0, 1, 1, 1, 0, 1, 1, 1 }, { 0, 15, 0 } }
+	};
+
+	const BC7Partition ThreeSubsets[] =
+	{
+		{ 4, { 0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 2, 2, 1, 1, 2, 2 }, { 0, 8, 15 } },
+		{ 13, { 0, 1, 2, 2, 0, 1, 2, 2, 0, 1, 2, 2, 0, 1, 2, 2 }, { 0, 5, 15 } },
+		{ 15, { 0, 0, 1, 1, 2, 0, 0, 1, 2, 2, 0, 0, 2, 2, 2, 0 }, { 0, 3, 8 } },
+		// Here the third subset's anchor comes before the second's.
+		{ 23, { 0, 0, 0, 0, 1, 1, 0, 0, 2, 2, 1, 0, 2, 2, 1, 0 }, { 0, 10, 8 } }
+	};
+
+	// The interpolation weights (out of 64) for 2, 3, and 4 bit indices.
+	const uint32_t BC7Weights[5][16] =
+	{
+		{ 0 },
+		{ 0 },
+		{ 0, 21, 43, 64 },
+		{ 0, 9, 18, 27, 37, 46, 55, 64 },
+		{ 0, 4, 9, 13, 17, 21, 26, 30, 34, 38, 43, 47, 51, 55, 60, 64 }
+	};
+
+	// Expands an endpoint channel to 8 bits by replicating its high bits into the low bits.
+	uint32_t ExpandBC7Channel(uint32_t value, uint32_t bits)
+	{
+		value <<= (8 - bits);
+		return value | (value >> bits);
+	}
+
+	// Builds a BC7 block of the mode with random endpoints and indices, and works out the texels that it should decode to.
+	void MakeBC7Block(
+		PortableTests::Random& random,
+		uint32_t mode,
+		const BC7Partition& partition,
+		uint32_t rotation,
+		uint32_t indexSelection,
+		uint8_t block[16],
+		Texel expected[16]
+		)
+	{
+		const auto& layout = BC7Layouts[mode];
+		BC7Writer writer(block);
+		writer.Write(1U << mode, mode + 1);
+		writer.Write(partition.m_number, layout.m_partitionBits);
+		writer.Write(rotation, layout.m_rotationBits);
+		writer.Write(indexSelection, layout.m_indexSelectionBits);
+
+		// Each channel's endpoints for every subset, then the next channel.
+		uint32_t endpoints[3][2][4] = {};
+		for (uint32_t channel = 0; channel < 4; channel++)
+		{
+			auto bits = (channel < 3) ? layout.m_colorBits : layout.m_alphaBits;
+			for (uint32_t subset = 0; subset < layout.m_subsetCount; subset++)
+			{
+				for (uint32_t endpoint = 0; endpoint < 2; endpoint++)
+				{
+					endpoints[subset][endpoint][channel] = static_cast<uint32_t>(random.Range(0, (1 << bits) - 1));
+					writer.Write(endpoints[subset][endpoint][channel], bits);
+				}
+			}
+		}
+
+		// The p-bits add a low bit to every channel.
+		auto colorBits = layout.m_colorBits;
+		auto alphaBits = layout.m_alphaBits;
+		if (layout.m_pBitsPerSubset != 0)
+		{
+			for (uint32_t subset = 0; subset < layout.m_subsetCount; subset++)
+			{
+				uint32_t pBits[2];
+				pBits[0] = static_cast<uint32_t>(random.Range(0, 1));
+				writer.Write(pBits[0], 1);
+				pBits[1] = pBits[0];
+				if (layout.m_pBitsPerSubset == 2)
+				{
+					pBits[1] = static_cast<uint32_t>(random.Range(0, 1));
+					writer.Write(pBits[1], 1);
+				}
+
+				for (uint32_t endpoint = 0; endpoint < 2; endpoint++)
+				{
+					for (uint32_t channel = 0; channel < 4; channel++)
+					{
+						endpoints[subset][endpoint][channel] = (endpoints[subset][endpoint][channel] << 1) | pBits[endpoint];
+					}
+				}
+			}
+			colorBits++;
+			alphaBits = (alphaBits != 0) ? alphaBits + 1 : 0;
+		}
+
+		for (uint32_t subset = 0; subset < layout.m_subsetCount; subset++)
+		{
+			for (uint32_t endpoint = 0; endpoint < 2; endpoint++)
+			{
+				auto& value = endpoints[subset][endpoint];
+				value[0] = ExpandBC7Channel(value[0], colorBits);
+				value[1] = ExpandBC7Channel(value[1], colorBits);
+				value[2] = ExpandBC7Channel(value[2], colorBits);
+				value[3] = (alphaBits != 0) ? ExpandBC7Channel(value[3], alphaBits) : 255;
+			}
+		}
+
+		// The anchor texel of each subset has an implied zero high bit, so it is written with one less bit. In the second index set only texel
+		// 0 is an anchor.
+		uint32_t indices[16];
+		for (uint32_t i = 0; i < 16; i++)
+		{
+			bool isAnchor = false;
+			for (uint32_t subset = 0; subset < layout.m_subsetCount; subset++)
+			{
+				isAnchor = isAnchor || partition.m_anchors[subset] == i;
+			}
+
+			auto bits = layout.m_indexBits - (isAnchor ? 1 : 0);
+			indices[i] = static_cast<uint32_t>(random.Range(0, (1 << bits) - 1));
+			writer.Write(indices[i], bits);
+		}
+
+		uint32_t secondaryIndices[16];
+		for (uint32_t i = 0; i < 16 && layout.m_secondaryIndexBits != 0; i++)
+		{
+			auto bits = layout.m_secondaryIndexBits - ((i == 0) ? 1 : 0);
+			secondaryIndices[i] = static_cast<uint32_t>(random.Range(0, (1 << bits) - 1));
+			writer.Write(secondaryIndices[i], bits);
+		}
+		CHECK(writer.GetPosition() == 128);
+
+		// Color uses the first index set and alpha the second, unless the index selection swaps them. Modes with one index set use it for both.
+		const uint32_t* colorIndices = indices;
+		const uint32_t* alphaIndices = indices;
+		auto colorIndexBits = layout.m_indexBits;
+		auto alphaIndexBits = layout.m_indexBits;
+		if (layout.m_secondaryIndexBits != 0)
+		{
+			(indexSelection == 0 ? alphaIndices : colorIndices) = secondaryIndices;
+			(indexSelection == 0 ? alphaIndexBits : colorIndexBits) = layout.m_secondaryIndexBits;
+		}
+
+		for (uint32_t i = 0; i < 16; i++)
+		{
+			auto& endpoint0 = endpoints[partition.m_subsets[i]][0];
+			auto& endpoint1 = endpoints[partition.m_subsets[i]][1];
+			uint32_t channels[4];
+			for (uint32_t channel = 0; channel < 4; channel++)
+			{
+				auto weight = (channel < 3) ? BC7Weights[colorIndexBits][colorIndices[i]] : BC7Weights[alphaIndexBits][alphaIndices[i]];
+				channels[channel] = (((64 - weight) * endpoint0[channel]) + (weight * endpoint1[channel]) + 32) >> 6;
+			}
+
+			// Rotation 1, 2, or 3 swaps alpha with red, green, or blue after interpolating.
+			if (rotation != 0)
+			{
+				auto swap = channels[rotation - 1];
+				channels[rotation - 1] = channels[3];
+				channels[3] = swap;
+			}
+
+			Texel texel = { static_cast<uint8_t>(channels[2]), static_cast<uint8_t>(channels[1]), static_cast<uint8_t>(channels[0]),
+				static_cast<uint8_t>(channels[3]) };
+			expected[i] = texel;
+		}
+	}
+
+	void TestBC7()
+	{
+		PortableTests::Random random(11);
+		uint8_t block[16];
+		Texel expected[16];
+
+		for (int repeat = 0; repeat < 50; repeat++)
+		{
+			// Mode 0 only has 4 partition bits, so it can only use the first 16 partitions.
+			for (auto& partition : ThreeSubsets)
+			{
+				if (partition.m_number < 16)
+				{
+					MakeBC7Block(random, 0, partition, 0, 0, block, expected);
+					CheckBlock(DX::BlockFormat::BC7, block, expected);
+				}
+				MakeBC7Block(random, 2, partition, 0, 0, block, expected);
+				CheckBlock(DX::BlockFormat::BC7, block, expected);
+			}
+
+			const uint32_t twoSubsetModes[] = { 1, 3, 7 };
+			for (auto mode : twoSubsetModes)
+			{
+				for (auto& partition : TwoSubsets)
+				{
+					MakeBC7Block(random, mode, partition, 0, 0, block, expected);
+					CheckBlock(DX::BlockFormat::BC7, block, expected);
+				}
+			}
+
+			for (uint32_t rotation = 0; rotation < 4; rotation++)
+			{
+				for (uint32_t indexSelection = 0; indexSelection < 2; indexSelection++)
+				{
+					MakeBC7Block(random, 4, OneSubset, rotation, indexSelection, block, expected);
+					CheckBlock(DX::BlockFormat::BC7, block, expected);
+				}
+				MakeBC7Block(random, 5, OneSubset, rotation, 0, block, expected);
+				CheckBlock(DX::BlockFormat::BC7, block, expected);
+			}
+
+			MakeBC7Block(random, 6, OneSubset, 0, 0, block, expected);
+			CheckBlock(DX::BlockFormat::BC7, block, expected);
+		}
+
+		// A mode 6 block worked through by hand. Red goes from 0 to 127 with p-bits 0 and 1 (0 and 255), green from 127 to 0 (254 and 1), blue
+		// stays at 64 (128 and 129) and alpha at 127 (254 and 255). Texel i has index i, so red steps through the 4-bit weights.
+		BC7Writer writer(block);
+		writer.Write(1 << 6, 7);
+		const uint32_t endpoints[8] = { 0, 127, 127, 0, 64, 64, 127, 127 };
+		for (auto endpoint : endpoints)
+		{
+			writer.Write(endpoint, 7);
+		}
+		writer.Write(0, 1);
+		writer.Write(1, 1);
+		writer.Write(0, 3);
+		for (uint32_t i = 1; i < 16; i++)
+		{
+			writer.Write(i, 4);
+		}
+		const uint8_t reds[16] = { 0, 16, 36, 52, 68, 84, 104, 120, 135, 151, 171, 187, 203, 219, 239, 255 };
+		const uint8_t greens[16] = { 254, 238, 218, 203, 187, 171, 151, 135, 120, 104, 84, 68, 52, 37, 17, 1 };
+		for (uint32_t i = 0; i < 16; i++)
+		{
+			Texel texel = { static_cast<uint8_t>(i < 8 ? 128 : 129), greens[i], reds[i], static_cast<uint8_t>(i < 8 ? 254 : 255) };
+			expected[i] = texel;
+		}
+		CheckBlock(DX::BlockFormat::BC7, block, expected);
+
+		// Blocks without a mode bit in the first byte are reserved, and decode as transparent black.
+		const Texel transparent = { 0, 0, 0, 0 };
+		for (uint32_t i = 0; i < 16; i++)
+		{
+			expected[i] = transparent;
+		}
+		for (int repeat = 0; repeat < 20; repeat++)
+		{
+			block[0] = 0;
+			for (uint32_t i = 1; i < 16; i++)
+			{
+				block[i] = static_cast<uint8_t>(random.Next() >> 24);
+			}
+			CheckBlock(DX::BlockFormat::BC7, block, expected);
+		}
+	}
+
+	// Decodes random images of every size up to 13 x 13 in split row ranges and checks them against blocks decoded one at a time.
+	void TestBlockRows(DX::BlockFormat format)
+	{
+		PortableTests::Random random(10);
+		auto blockSize = DX::GetBlockSizeInBytes(format);
+
+		for (uint32_t height = 1; height <= 13; height++)
+		{
+			for (uint32_t width = 1; width <= 13; width++)
+			{
+				auto blocksPerRow = (width + 3) / 4;
+				auto blockRows = (height + 3) / 4;
+
+				// Leave some padding at the end of each source row, like a mapped texture's RowPitch.
+				auto sourceRowPitch = (blocksPerRow * blockSize) + 8;
+				std::vector<uint8_t> source(sourceRowPitch * blockRows);
+				for (auto& byte : source)
+				{
+					byte = static_cast<uint8_t>(random.Next() >> 24);
+				}
+
+				std::vector<uint8_t> texels(width * height * 4, 0xCD);
+				std::vector<uint8_t> alphas(width * height, 0xCD);
+				auto split = static_cast<uint32_t>(random.Range(0, static_cast<int32_t>(blockRows)));
+				DX::DecodeBlockRowsBGRA(format, source.data(), sourceRowPitch, width, height, 0, split, texels.data());
+				DX::DecodeBlockRowsBGRA(format, source.data(), sourceRowPitch, width, height, split, blockRows - split, texels.data());
+				DX::DecodeBlockRowsAlpha(format, source.data(), sourceRowPitch, width, height, split, blockRows - split, alphas.data());
+				DX::DecodeBlockRowsAlpha(format, source.data(), sourceRowPitch, width, height, 0, split, alphas.data());
+
+				for (uint32_t blockRow = 0; blockRow < blockRows; blockRow++)
+				{
+					for (uint32_t blockColumn = 0; blockColumn < blocksPerRow; blockColumn++)
+					{
+						auto block = &source[(blockRow * sourceRowPitch) + (blockColumn * blockSize)];
+						uint8_t blockTexels[4 * 4 * 4];
+						DX::DecodeBlockBGRA(format, block, blockTexels, 16);
+
+						for (uint32_t y = blockRow * 4; y < blockRow * 4 + 4 && y < height; y++)
+						{
+							for (uint32_t x = blockColumn * 4; x < blockColumn * 4 + 4 && x < width; x++)
+							{
+								auto blockTexel = &blockTexels[((y % 4) * 16) + ((x % 4) * 4)];
+								CHECK(std::memcmp(&texels[((y * width) + x) * 4], blockTexel, 4) == 0);
+								CHECK(alphas[(y * width) + x] == blockTexel[3]);
+							}
+						}
+					}
+				}
+			}
+		}
+	}
+}
+
+int main()
+{
+	TestBC1();
+	TestBC3();
+	TestBC4BC5();
+	TestBC7();
+
+	const DX::BlockFormat formats[] =
+	{
+		DX::BlockFormat::BC1, DX::BlockFormat::BC3, DX::BlockFormat::BC4, DX::BlockFormat::BC5, DX::BlockFormat::BC4Snorm, DX::BlockFormat::BC5Snorm,
+		DX::BlockFormat::BC7
+	};
+	for (auto format : formats)
+	{
+		TestBlockRows(format);
+	}
+
+	return PortableTests::Finish("BlockCompressionTests");
+}
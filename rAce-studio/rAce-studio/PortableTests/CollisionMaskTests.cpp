@@ -0,0 +1,198 @@
+// Checks that DX::CollisionMask survives a round trip through the .cmask format for a spread of sizes (including widths either side of a
+// multiple of 64), and that LoadFromMemory rejects corrupt files: every truncation, every flipped bit outside of the full resolution words
+// (the header, the padding bits and the coarse levels), and random damage. A file that does load must be self-consistent, so saving the
+// loaded mask again has to give back exactly the bytes that were loaded.
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <vector>
+
+#include "CollisionMask.h"
+#include "TestHelpers.h"
+
+namespace
+{
+	// Builds a mask of random blobs: mostly runs of opaque or transparent texels so that the coarse levels have both "any" and "all" blocks.
+	void CreateRandom(PortableTests::Random& random, DX::CollisionMask& mask, uint32_t width, uint32_t height)
+	{
+		std::vector<uint8_t> alpha(width * height);
+		uint8_t value = 0;
+		for (auto& texel : alpha)
+		{
+			if (random.Range(0, 7) == 0)
+			{
+				value = value ? 0 : static_cast<uint8_t>(random.Range(1, 255));
+			}
+			texel = value;
+		}
+
+		mask.CreateFromAlpha(alpha.data(), width, height);
+	}
+
+	// Checks that two masks have the same texels and bounds and answer the block tests the same way at every level.
+	void CheckSame(PortableTests::Random& random, const DX::CollisionMask& one, const DX::CollisionMask& two)
+	{
+		CHECK(one.GetWidth() == two.GetWidth() && one.GetHeight() == two.GetHeight() && one.GetWordsPerRow() == two.GetWordsPerRow());
+		CHECK(one.IsEmpty() == two.IsEmpty());
+		if (one.GetWidth() != two.GetWidth() || one.GetHeight() != two.GetHeight() || one.IsEmpty())
+		{
+			return;
+		}
+
+		for (uint32_t y = 0; y < one.GetHeight(); y++)
+		{
+			CHECK(std::memcmp(one.GetRow(y), two.GetRow(y), one.GetWordsPerRow() * sizeof(uint64_t)) == 0);
+		}
+
+		uint32_t boundsOne[4];
+		uint32_t boundsTwo[4];
+		one.GetOpaqueBounds(boundsOne[0], boundsOne[1], boundsOne[2], boundsOne[3]);
+		two.GetOpaqueBounds(boundsTwo[0], boundsTwo[1], boundsTwo[2], boundsTwo[3]);
+		CHECK(std::memcmp(boundsOne, boundsTwo, sizeof(boundsOne)) == 0);
+
+		auto width = static_cast<int32_t>(one.GetWidth());
+		auto height = static_cast<int32_t>(one.GetHeight());
+		for (int i = 0; i < 200; i++)
+		{
+			auto left = random.Range(-4, width);
+			auto top = random.Range(-4, height);
+			auto right = left + random.Range(1, 40);
+			auto bottom = top + random.Range(1, 40);
+			for (uint32_t level = 0; level <= DX::CollisionMask::CoarseLevelCount; level++)
+			{
+				CHECK(one.MayContainOpaque(level, left, top, right, bottom) == two.MayContainOpaque(level, left, top, right, bottom));
+				CHECK(one.IsAllOpaque(level, left, top, right, bottom) == two.IsAllOpaque(level, left, top, right, bottom));
+			}
+		}
+	}
+
+	// Loads the data and, if it loads, checks that saving it again gives back the same bytes.
+	bool CheckLoad(const std::vector<uint8_t>& data)
+	{
+		DX::CollisionMask mask;
+		if (!mask.LoadFromMemory(data.data(), data.size()))
+		{
+			CHECK(mask.IsEmpty());
+			return false;
+		}
+
+		std::vector<uint8_t> saved;
+		mask.SaveToMemory(saved);
+		CHECK(saved == data);
+		return true;
+	}
+
+	void TestRoundTrip()
+	{
+		PortableTests::Random random(9);
+		const uint32_t sizes[] = { 1, 2, 3, 7, 8, 9, 63, 64, 65, 127, 128, 129, 200 };
+		for (auto width : sizes)
+		{
+			for (auto height : sizes)
+			{
+				DX::CollisionMask mask;
+				CreateRandom(random, mask, width, height);
+
+				std::vector<uint8_t> data;
+				mask.SaveToMemory(data);
+				CHECK(data.size() % sizeof(uint64_t) == 0);
+
+				DX::CollisionMask loaded;
+				CHECK(loaded.LoadFromMemory(data.data(), data.size()));
+				CheckSame(random, mask, loaded);
+				CHECK(CheckLoad(data));
+			}
+		}
+
+		// An empty mask is just a header.
+		DX::CollisionMask empty;
+		std::vector<uint8_t> data;
+		empty.SaveToMemory(data);
+		CHECK(data.size() == sizeof(DX::CollisionMaskFileHeader));
+		DX::CollisionMask loaded;
+		CHECK(loaded.LoadFromMemory(data.data(), data.size()));
+		CHECK(loaded.IsEmpty());
+		CHECK(!loaded.LoadFromMemory(nullptr, 0));
+	}
+
+	void TestCorrupt()
+	{
+		PortableTests::Random random(90);
+
+		// 100 wide so that each row has 28 padding bits.
+		DX::CollisionMask mask;
+		CreateRandom(random, mask, 100, 37);
+		std::vector<uint8_t> data;
+		mask.SaveToMemory(data);
+		auto headerSize = sizeof(DX::CollisionMaskFileHeader);
+		auto bitsSize = mask.GetWordsPerRow() * mask.GetHeight() * sizeof(uint64_t);
+
+		// Every truncation, and a byte too many.
+		for (size_t size = 0; size < data.size(); size++)
+		{
+			std::vector<uint8_t> truncated(data.begin(), data.begin() + size);
+			CHECK(!CheckLoad(truncated));
+		}
+		auto extended = data;
+		extended.push_back(0);
+		CHECK(!CheckLoad(extended));
+
+		// Every single bit flip in the header and the coarse levels. The width is only checked by CheckLoad: a few other widths have the same
+		// layout and, with the extra columns transparent, are valid masks. The full resolution words are tested below.
+		auto widthOffset = offsetof(DX::CollisionMaskFileHeader, m_width);
+		for (size_t byte = 0; byte < data.size(); byte++)
+		{
+			if (byte >= headerSize && byte < headerSize + bitsSize)
+			{
+				continue;
+			}
+
+			for (uint32_t bit = 0; bit < 8; bit++)
+			{
+				auto corrupt = data;
+				corrupt[byte] ^= static_cast<uint8_t>(1 << bit);
+				bool isLoaded = CheckLoad(corrupt);
+				if (byte < widthOffset || byte >= widthOffset + sizeof(uint32_t))
+				{
+					CHECK(!isLoaded);
+				}
+			}
+		}
+
+		// Every padding bit of the full resolution mask. Flips of the other bits can give another valid mask, which CheckLoad checks.
+		for (uint32_t y = 0; y < mask.GetHeight(); y++)
+		{
+			for (uint32_t x = 0; x < mask.GetWordsPerRow() * 64; x++)
+			{
+				auto corrupt = data;
+				corrupt[headerSize + (((y * mask.GetWordsPerRow()) + (x / 64)) * sizeof(uint64_t)) + ((x % 64) / 8)] ^= static_cast<uint8_t>(1 << (x % 8));
+				bool isLoaded = CheckLoad(corrupt);
+				if (x >= mask.GetWidth())
+				{
+					CHECK(!isLoaded);
+				}
+			}
+		}
+
+		// Random damage to a few bytes at a time.
+		for (int i = 0; i < 20000; i++)
+		{
+			auto corrupt = data;
+			auto count = random.Range(1, 4);
+			for (int j = 0; j < count; j++)
+			{
+				corrupt[random.Range(0, static_cast<int32_t>(corrupt.size()) - 1)] = static_cast<uint8_t>(random.Next() >> 24);
+			}
+			CheckLoad(corrupt);
+		}
+	}
+}
+
+int main()
+{
+	TestRoundTrip();
+	TestCorrupt();
+
+	return PortableTests::Finish("CollisionMaskTests");
+}
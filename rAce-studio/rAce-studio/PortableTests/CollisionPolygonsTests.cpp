@@ -0,0 +1,535 @@
+// Checks DX::IsConvexPolygonOverlap against polygons that overlap, touch, and are separated, and DX::CollisionPolygons against masks with
+// several regions and with a hole (which comes back filled). Every piece must stay within MaxPieceVertices (the collision tests transform pieces
+// into a fixed size buffer), including for outlines that would otherwise merge into bigger convex pieces, such as a large disc. The polygon
+// test is also compared against the pixel perfect test over random transforms, both written out here the way that CollisionDetection2D.cpp
+// does them (which needs DirectXMath): a pixel perfect hit that the polygons miss must be within the bound that IsTransformedPolygonCollision
+// documents, tolerance plus a quarter of a texel's diagonal, of both sprites' polygons.
+
+#include <cmath>
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+#include "CollisionPolygons.h"
+#include "TestHelpers.h"
+
+namespace
+{
+	// Builds a mask of a filled disc.
+	void CreateDisc(DX::CollisionMask& mask, uint32_t size)
+	{
+		std::vector<uint8_t> alpha(size * size);
+		auto center = (static_cast<float>(size) - 1.0f) * 0.5f;
+		auto radius = static_cast<float>(size) * 0.5f - 1.0f;
+		for (uint32_t y = 0; y < size; y++)
+		{
+			for (uint32_t x = 0; x < size; x++)
+			{
+				auto dx = static_cast<float>(x) - center;
+				auto dy = static_cast<float>(y) - center;
+				alpha[(y * size) + x] = ((dx * dx) + (dy * dy) <= radius * radius) ? 255 : 0;
+			}
+		}
+
+		mask.CreateFromAlpha(alpha.data(), size, size);
+	}
+
+	// Builds a mask from rectangles of opaque texels. Each rectangle is (left, top, right, bottom) with right and bottom exclusive.
+	void CreateRectangles(DX::CollisionMask& mask, uint32_t width, uint32_t height, const uint32_t (*rectangles)[4], uint32_t rectangleCount)
+	{
+		std::vector<uint8_t> alpha(width * height);
+		for (uint32_t index = 0; index < rectangleCount; index++)
+		{
+			for (auto y = rectangles[index][1]; y < rectangles[index][3]; y++)
+			{
+				for (auto x = rectangles[index][0]; x < rectangles[index][2]; x++)
+				{
+					alpha[(y * width) + x] = 255;
+				}
+			}
+		}
+
+		mask.CreateFromAlpha(alpha.data(), width, height);
+	}
+
+	// Builds a size x size mask of random blobs, a ring, or a diagonal line a texel wide (texels that only touch at their corners).
+	void CreateRandomShape(DX::CollisionMask& mask, uint32_t size, PortableTests::Random& random)
+	{
+		std::vector<uint8_t> alpha(size * size);
+		auto shape = random.Range(0, 2);
+		auto center = (static_cast<float>(size) - 1.0f) * 0.5f;
+		for (uint32_t y = 0; y < size; y++)
+		{
+			for (uint32_t x = 0; x < size; x++)
+			{
+				auto dx = static_cast<float>(x) - center;
+				auto dy = static_cast<float>(y) - center;
+				auto distanceSquared = (dx * dx) + (dy * dy);
+				if (shape == 1)
+				{
+					alpha[(y * size) + x] = (distanceSquared <= center * center && distanceSquared >= center * center * 0.25f) ? 255 : 0;
+				}
+				else if (shape == 2)
+				{
+					alpha[(y * size) + x] = (x == y) ? 255 : 0;
+				}
+			}
+		}
+
+		if (shape == 0)
+		{
+			for (int blob = random.Range(1, 4); blob > 0; blob--)
+			{
+				auto blobX = random.Range(0.0f, static_cast<float>(size));
+				auto blobY = random.Range(0.0f, static_cast<float>(size));
+				auto radius = random.Range(1.0f, static_cast<float>(size) * 0.3f);
+				for (uint32_t y = 0; y < size; y++)
+				{
+					for (uint32_t x = 0; x < size; x++)
+					{
+						auto dx = static_cast<float>(x) - blobX;
+						auto dy = static_cast<float>(y) - blobY;
+						alpha[(y * size) + x] |= ((dx * dx) + (dy * dy) <= radius * radius) ? 255 : 0;
+					}
+				}
+			}
+		}
+
+		mask.CreateFromAlpha(alpha.data(), size, size);
+	}
+
+	// Returns true if a point is inside of (or on the edge of) any of the pieces.
+	bool IsInPieces(const DX::CollisionPolygons& polygons, float x, float y)
+	{
+		DX::PolygonVertex point[3] = { { x, y }, { x + 0.01f, y }, { x, y + 0.01f } };
+		for (uint32_t index = 0; index < polygons.GetPieceCount(); index++)
+		{
+			const auto& piece = polygons.GetPiece(index);
+			if (DX::IsConvexPolygonOverlap(polygons.GetVertices() + piece.m_firstVertex, piece.m_vertexCount, point, 3))
+			{
+				return true;
+			}
+		}
+		return false;
+	}
+
+	// Returns the total area of the pieces. The pieces don't overlap so this is the area of the polygons.
+	float GetArea(const DX::CollisionPolygons& polygons)
+	{
+		float area = 0.0f;
+		auto vertices = polygons.GetVertices();
+		for (uint32_t index = 0; index < polygons.GetPieceCount(); index++)
+		{
+			const auto& piece = polygons.GetPiece(index);
+			for (uint32_t i = 0, j = piece.m_vertexCount - 1; i < piece.m_vertexCount; j = i++)
+			{
+				const auto& a = vertices[piece.m_firstVertex + j];
+				const auto& b = vertices[piece.m_firstVertex + i];
+				area += (a.x * b.y) - (b.x * a.y);
+			}
+		}
+		return std::fabs(area) * 0.5f;
+	}
+
+	// Maps sprite one's local space to sprite two's local space: (x, y) goes to origin + (x * stepX) + (y * stepY).
+	struct Transform
+	{
+		DX::PolygonVertex		m_origin;
+		DX::PolygonVertex		m_stepX;
+		DX::PolygonVertex		m_stepY;
+	};
+
+	DX::PolygonVertex Apply(const Transform& transform, const DX::PolygonVertex& vertex)
+	{
+		DX::PolygonVertex result;
+		result.x = transform.m_origin.x + (transform.m_stepX.x * vertex.x) + (transform.m_stepY.x * vertex.y);
+		result.y = transform.m_origin.y + (transform.m_stepX.y * vertex.x) + (transform.m_stepY.y * vertex.y);
+		return result;
+	}
+
+	// Transforms one of sprite one's pieces into sprite two's local space.
+	uint32_t TransformPiece(const DX::CollisionPolygons& polygons, uint32_t index, const Transform& transform, DX::PolygonVertex* vertices)
+	{
+		const auto& piece = polygons.GetPiece(index);
+		for (uint32_t i = 0; i < piece.m_vertexCount; i++)
+		{
+			vertices[i] = Apply(transform, polygons.GetVertices()[piece.m_firstVertex + i]);
+		}
+		return piece.m_vertexCount;
+	}
+
+	// The polygon test of IsTransformedPolygonCollision, without the bounding rectangle early outs.
+	bool IsPolygonCollision(const DX::CollisionPolygons& spriteOne, const Transform& transform, const DX::CollisionPolygons& spriteTwo)
+	{
+		DX::PolygonVertex vertices[DX::CollisionPolygons::MaxPieceVertices];
+		for (uint32_t pieceOne = 0; pieceOne < spriteOne.GetPieceCount(); pieceOne++)
+		{
+			auto vertexCount = TransformPiece(spriteOne, pieceOne, transform, vertices);
+			for (uint32_t pieceTwo = 0; pieceTwo < spriteTwo.GetPieceCount(); pieceTwo++)
+			{
+				const auto& piece = spriteTwo.GetPiece(pieceTwo);
+				if (DX::IsConvexPolygonOverlap(vertices, vertexCount, spriteTwo.GetVertices() + piece.m_firstVertex, piece.m_vertexCount))
+				{
+					return true;
+				}
+			}
+		}
+		return false;
+	}
+
+	// The mask version of IsTransformedPixelPerfectCollision, texel by texel: each opaque texel center of sprite one is transformed into sprite
+	// two's local space and rounded to the nearest texel.
+	bool IsPixelCollision(const DX::CollisionMask& spriteOne, const Transform& transform, const DX::CollisionMask& spriteTwo)
+	{
+		for (uint32_t y = 0; y < spriteOne.GetHeight(); y++)
+		{
+			for (uint32_t x = 0; x < spriteOne.GetWidth(); x++)
+			{
+				if (!spriteOne.IsOpaque(static_cast<int32_t>(x), static_cast<int32_t>(y)))
+				{
+					continue;
+				}
+
+				DX::PolygonVertex center = { static_cast<float>(x), static_cast<float>(y) };
+				auto position = Apply(transform, center);
+				auto spriteTwoX = static_cast<int32_t>(position.x + (position.x > 0.0f ? 0.5f : -0.5f));
+				auto spriteTwoY = static_cast<int32_t>(position.y + (position.y > 0.0f ? 0.5f : -0.5f));
+				if (spriteTwo.IsOpaque(spriteTwoX, spriteTwoY))
+				{
+					return true;
+				}
+			}
+		}
+		return false;
+	}
+
+	// Returns the distance from a point to the segment from a to b.
+	float GetDistanceToSegment(const DX::PolygonVertex& point, const DX::PolygonVertex& a, const DX::PolygonVertex& b)
+	{
+		auto abX = b.x - a.x;
+		auto abY = b.y - a.y;
+		auto lengthSquared = (abX * abX) + (abY * abY);
+		auto t = (lengthSquared > 0.0f) ? (((point.x - a.x) * abX) + ((point.y - a.y) * abY)) / lengthSquared : 0.0f;
+		t = (t < 0.0f) ? 0.0f : ((t > 1.0f) ? 1.0f : t);
+		auto dX = point.x - a.x - (abX * t);
+		auto dY = point.y - a.y - (abY * t);
+		return std::sqrt((dX * dX) + (dY * dY));
+	}
+
+	// Returns the distance between two convex polygons that don't overlap, which is the distance from a vertex of one to an edge of the other.
+	float GetDistance(const DX::PolygonVertex* first, uint32_t firstCount, const DX::PolygonVertex* second, uint32_t secondCount)
+	{
+		float distance = 1.0e30f;
+		for (int pass = 0; pass < 2; pass++)
+		{
+			for (uint32_t i = 0; i < firstCount; i++)
+			{
+				for (uint32_t j = 0, k = secondCount - 1; j < secondCount; k = j++)
+				{
+					auto edgeDistance = GetDistanceToSegment(first[i], second[k], second[j]);
+					distance = (edgeDistance < distance) ? edgeDistance : distance;
+				}
+			}
+			std::swap(first, second);
+			std::swap(firstCount, secondCount);
+		}
+		return distance;
+	}
+
+	// Returns the distance from a point to the nearest piece, or zero if it is inside of one.
+	float GetDistance(const DX::CollisionPolygons& polygons, const DX::PolygonVertex& point)
+	{
+		if (IsInPieces(polygons, point.x, point.y))
+		{
+			return 0.0f;
+		}
+
+		float distance = 1.0e30f;
+		for (uint32_t index = 0; index < polygons.GetPieceCount(); index++)
+		{
+			const auto& piece = polygons.GetPiece(index);
+			auto pieceDistance = GetDistance(&point, 1, polygons.GetVertices() + piece.m_firstVertex, piece.m_vertexCount);
+			distance = (pieceDistance < distance) ? pieceDistance : distance;
+		}
+		return distance;
+	}
+
+	// Returns true if every opaque texel center of the mask is within distance of the polygons, which is false if the simplification dropped
+	// a whole region.
+	bool IsCovered(const DX::CollisionMask& mask, const DX::CollisionPolygons& polygons, float distance)
+	{
+		for (uint32_t y = 0; y < mask.GetHeight(); y++)
+		{
+			for (uint32_t x = 0; x < mask.GetWidth(); x++)
+			{
+				DX::PolygonVertex center = { static_cast<float>(x), static_cast<float>(y) };
+				if (mask.IsOpaque(static_cast<int32_t>(x), static_cast<int32_t>(y)) && GetDistance(polygons, center) > distance)
+				{
+					return false;
+				}
+			}
+		}
+		return true;
+	}
+
+	// Returns the distance between sprite one's polygons, transformed into sprite two's local space, and sprite two's polygons.
+	float GetDistance(const DX::CollisionPolygons& spriteOne, const Transform& transform, const DX::CollisionPolygons& spriteTwo)
+	{
+		DX::PolygonVertex vertices[DX::CollisionPolygons::MaxPieceVertices];
+		float distance = 1.0e30f;
+		for (uint32_t pieceOne = 0; pieceOne < spriteOne.GetPieceCount(); pieceOne++)
+		{
+			auto vertexCount = TransformPiece(spriteOne, pieceOne, transform, vertices);
+			for (uint32_t pieceTwo = 0; pieceTwo < spriteTwo.GetPieceCount(); pieceTwo++)
+			{
+				const auto& piece = spriteTwo.GetPiece(pieceTwo);
+				auto pieceDistance = GetDistance(vertices, vertexCount, spriteTwo.GetVertices() + piece.m_firstVertex, piece.m_vertexCount);
+				distance = (pieceDistance < distance) ? pieceDistance : distance;
+			}
+		}
+		return distance;
+	}
+
+	// Overlapping, touching and separated convex polygons, wound both ways.
+	void TestConvexOverlap()
+	{
+		const DX::PolygonVertex square[4] = { { 0.0f, 0.0f }, { 2.0f, 0.0f }, { 2.0f, 2.0f }, { 0.0f, 2.0f } };
+		const DX::PolygonVertex overlapping[4] = { { 1.0f, 1.0f }, { 3.0f, 1.0f }, { 3.0f, 3.0f }, { 1.0f, 3.0f } };
+		const DX::PolygonVertex inside[3] = { { 0.5f, 0.5f }, { 1.5f, 0.5f }, { 1.0f, 1.5f } };
+		const DX::PolygonVertex touchingEdge[4] = { { 2.0f, 0.5f }, { 4.0f, 0.5f }, { 4.0f, 1.5f }, { 2.0f, 1.5f } };
+		const DX::PolygonVertex touchingCorner[3] = { { 2.0f, 2.0f }, { 3.0f, 2.0f }, { 3.0f, 3.0f } };
+		const DX::PolygonVertex separated[4] = { { 2.01f, 0.0f }, { 4.0f, 0.0f }, { 4.0f, 2.0f }, { 2.01f, 2.0f } };
+
+		// The bounding rectangles of these overlap but the diagonal edges separate them, so only an edge normal of a triangle finds the gap.
+		const DX::PolygonVertex lowerTriangle[3] = { { 0.0f, 0.0f }, { 2.0f, 0.0f }, { 0.0f, 2.0f } };
+		const DX::PolygonVertex upperTriangle[3] = { { 2.0f, 0.1f }, { 2.0f, 2.0f }, { 0.1f, 2.0f } };
+		const DX::PolygonVertex upperTouching[3] = { { 2.0f, 0.0f }, { 2.0f, 2.0f }, { 0.0f, 2.0f } };
+
+		CHECK(DX::IsConvexPolygonOverlap(square, 4, overlapping, 4));
+		CHECK(DX::IsConvexPolygonOverlap(square, 4, inside, 3));
+		CHECK(DX::IsConvexPolygonOverlap(inside, 3, square, 4));
+		CHECK(DX::IsConvexPolygonOverlap(square, 4, touchingEdge, 4));
+		CHECK(DX::IsConvexPolygonOverlap(square, 4, touchingCorner, 3));
+		CHECK(!DX::IsConvexPolygonOverlap(square, 4, separated, 4));
+		CHECK(!DX::IsConvexPolygonOverlap(separated, 4, square, 4));
+		CHECK(!DX::IsConvexPolygonOverlap(lowerTriangle, 3, upperTriangle, 3));
+		CHECK(!DX::IsConvexPolygonOverlap(upperTriangle, 3, lowerTriangle, 3));
+		CHECK(DX::IsConvexPolygonOverlap(lowerTriangle, 3, upperTouching, 3));
+		CHECK(!DX::IsConvexPolygonOverlap(square, 0, square, 4));
+
+		// The winding doesn't matter.
+		const DX::PolygonVertex reversedSquare[4] = { square[3], square[2], square[1], square[0] };
+		const DX::PolygonVertex reversedSeparated[4] = { separated[3], separated[2], separated[1], separated[0] };
+		const DX::PolygonVertex reversedUpper[3] = { upperTriangle[2], upperTriangle[1], upperTriangle[0] };
+		CHECK(DX::IsConvexPolygonOverlap(reversedSquare, 4, overlapping, 4));
+		CHECK(DX::IsConvexPolygonOverlap(reversedSquare, 4, touchingEdge, 4));
+		CHECK(!DX::IsConvexPolygonOverlap(reversedSquare, 4, reversedSeparated, 4));
+		CHECK(!DX::IsConvexPolygonOverlap(lowerTriangle, 3, reversedUpper, 3));
+	}
+
+	// Separate regions each get their own pieces, the gaps between them stay empty, and specks below the minimum area (or that the simplification
+	// leaves with less than a triangle) are dropped.
+	void TestRegions()
+	{
+		const uint32_t rectangles[4][4] =
+		{
+			{ 2, 2, 12, 8 },
+			{ 20, 3, 30, 20 },
+			{ 4, 14, 14, 28 },
+			{ 25, 27, 26, 28 }
+		};
+
+		DX::CollisionMask mask;
+		CreateRectangles(mask, 32, 32, rectangles, 4);
+
+		DX::CollisionPolygons polygons;
+		polygons.CreateFromMask(mask, 0.0f);
+		CHECK(polygons.GetWidth() == 32 && polygons.GetHeight() == 32);
+		CHECK(polygons.GetPieceCount() >= 4);
+		CHECK(IsInPieces(polygons, 7.0f, 5.0f));
+		CHECK(IsInPieces(polygons, 25.0f, 11.5f));
+		CHECK(IsInPieces(polygons, 9.0f, 21.0f));
+		CHECK(IsInPieces(polygons, 25.0f, 27.0f));
+		CHECK(!IsInPieces(polygons, 16.0f, 5.0f));
+		CHECK(!IsInPieces(polygons, 7.0f, 11.0f));
+		CHECK(!IsInPieces(polygons, 20.0f, 25.0f));
+
+		// Each rectangle's outline runs half a texel outside of its edge texel centers, less an eighth of a texel at each corner.
+		auto area = GetArea(polygons);
+		auto expected = (60.0f + 170.0f + 140.0f + 1.0f) - (4.0f * 0.5f);
+		CHECK(std::fabs(area - expected) < 0.01f);
+
+		// The speck (a single texel, whose outline is a diamond with an area of half a texel) is dropped.
+		polygons.CreateFromMask(mask, 0.0f, 1.0f);
+		CHECK(!IsInPieces(polygons, 25.0f, 27.0f));
+		CHECK(IsInPieces(polygons, 25.0f, 11.5f));
+		CHECK(std::fabs(GetArea(polygons) - (expected - 0.5f)) < 0.01f);
+
+		// So is a region that simplifies to less than a triangle, whatever the minimum area.
+		polygons.CreateFromMask(mask, 0.5f);
+		CHECK(!IsInPieces(polygons, 25.0f, 27.0f));
+		CHECK(IsInPieces(polygons, 25.0f, 11.5f));
+		CHECK(!IsCovered(mask, polygons, 0.5f));
+
+		// A transparent mask gives no pieces.
+		DX::CollisionMask emptyMask;
+		CreateRectangles(emptyMask, 16, 16, rectangles, 0);
+		polygons.CreateFromMask(emptyMask, 0.5f);
+		CHECK(polygons.IsEmpty());
+		CHECK(polygons.GetVertexCount() == 0);
+	}
+
+	// The hole in a square frame is filled in.
+	void TestHole()
+	{
+		std::vector<uint8_t> alpha(24 * 24);
+		for (uint32_t y = 2; y < 22; y++)
+		{
+			for (uint32_t x = 2; x < 22; x++)
+			{
+				alpha[(y * 24) + x] = (x < 6 || x >= 18 || y < 6 || y >= 18) ? 255 : 0;
+			}
+		}
+
+		DX::CollisionMask mask;
+		mask.CreateFromAlpha(alpha.data(), 24, 24);
+		CHECK(!mask.IsOpaque(12, 12));
+
+		DX::CollisionPolygons polygons;
+		polygons.CreateFromMask(mask, 0.0f);
+		CHECK(IsInPieces(polygons, 12.0f, 12.0f));
+		CHECK(IsInPieces(polygons, 3.0f, 3.0f));
+		CHECK(!IsInPieces(polygons, 0.5f, 12.0f));
+		CHECK(std::fabs(GetArea(polygons) - ((20.0f * 20.0f) - 0.5f)) < 0.01f);
+	}
+
+	// Every piece of a large disc has between 3 and MaxPieceVertices vertices.
+	void TestPieceSize(uint32_t size, float tolerance)
+	{
+		DX::CollisionMask mask;
+		CreateDisc(mask, size);
+
+		DX::CollisionPolygons polygons;
+		polygons.CreateFromMask(mask, tolerance);
+		CHECK(!polygons.IsEmpty());
+
+		uint32_t vertexCount = 0;
+		for (uint32_t index = 0; index < polygons.GetPieceCount(); index++)
+		{
+			const auto& piece = polygons.GetPiece(index);
+			CHECK(piece.m_vertexCount >= 3);
+			CHECK(piece.m_vertexCount <= DX::CollisionPolygons::MaxPieceVertices);
+			vertexCount += piece.m_vertexCount;
+		}
+		CHECK(vertexCount == polygons.GetVertexCount());
+
+		// The center of the disc is inside of one of the pieces.
+		auto center = (static_cast<float>(size) - 1.0f) * 0.5f;
+		CHECK(IsInPieces(polygons, center, center));
+	}
+
+	// Marching squares cuts the corner off each corner texel, so a texel center that lands in the corner of a square sprite hits pixel perfect but
+	// misses the polygons, by less than a quarter of a texel's diagonal.
+	void TestCornerMiss()
+	{
+		const uint32_t square[1][4] = { { 0, 0, 3, 3 } };
+		const uint32_t speck[1][4] = { { 0, 0, 1, 1 } };
+		DX::CollisionMask spriteOneMask;
+		DX::CollisionMask spriteTwoMask;
+		CreateRectangles(spriteOneMask, 1, 1, speck, 1);
+		CreateRectangles(spriteTwoMask, 3, 3, square, 1);
+
+		DX::CollisionPolygons spriteOne;
+		DX::CollisionPolygons spriteTwo;
+		spriteOne.CreateFromMask(spriteOneMask, 0.0f);
+		spriteTwo.CreateFromMask(spriteTwoMask, 0.0f);
+
+		Transform transform = { { 2.45f, 2.45f }, { 0.5f, 0.0f }, { 0.0f, 0.5f } };
+		CHECK(IsPixelCollision(spriteOneMask, transform, spriteTwoMask));
+		CHECK(!IsPolygonCollision(spriteOne, transform, spriteTwo));
+		CHECK(GetDistance(spriteOne, transform, spriteTwo) <= 0.3536f);
+
+		// Along an edge the outline runs half a texel out, the same as the texels.
+		transform.m_origin.x = 1.0f;
+		CHECK(IsPixelCollision(spriteOneMask, transform, spriteTwoMask));
+		CHECK(IsPolygonCollision(spriteOne, transform, spriteTwo));
+	}
+
+	// Builds a random shape and its polygons, trying again until no region of the shape is dropped by the simplification.
+	void CreateRandomPolygons(DX::CollisionMask& mask, DX::CollisionPolygons& polygons, float tolerance, PortableTests::Random& random)
+	{
+		do
+		{
+			CreateRandomShape(mask, static_cast<uint32_t>(random.Range(8, 40)), random);
+			polygons.CreateFromMask(mask, tolerance);
+		}
+		while (!IsCovered(mask, polygons, tolerance + 0.001f));
+	}
+
+	// Random shapes under random rotations, scales and translations. The polygons can report collisions that the pixel perfect test doesn't (in
+	// filled holes and where they bulge past the texel centers), but any pixel perfect hit that they miss must be close to both outlines.
+	void TestAgainstPixelPerfect(float tolerance)
+	{
+		PortableTests::Random random(17 + static_cast<uint32_t>(tolerance * 4.0f));
+
+		uint32_t pixelHits = 0;
+		uint32_t polygonHits = 0;
+		uint32_t misses = 0;
+		for (int iteration = 0; iteration < 300; iteration++)
+		{
+			DX::CollisionMask spriteOneMask;
+			DX::CollisionMask spriteTwoMask;
+			DX::CollisionPolygons spriteOne;
+			DX::CollisionPolygons spriteTwo;
+			CreateRandomPolygons(spriteOneMask, spriteOne, tolerance, random);
+			CreateRandomPolygons(spriteTwoMask, spriteTwo, tolerance, random);
+
+			for (int placement = 0; placement < 20; placement++)
+			{
+				auto angle = random.Range(0.0f, 6.2831853f);
+				auto scale = random.Range(0.5f, 2.0f);
+				Transform transform;
+				transform.m_stepX.x = std::cos(angle) * scale;
+				transform.m_stepX.y = std::sin(angle) * scale;
+				transform.m_stepY.x = -transform.m_stepX.y;
+				transform.m_stepY.y = transform.m_stepX.x;
+				transform.m_origin.x = random.Range(-40.0f, 40.0f);
+				transform.m_origin.y = random.Range(-40.0f, 40.0f);
+
+				auto isPixelHit = IsPixelCollision(spriteOneMask, transform, spriteTwoMask);
+				auto isPolygonHit = IsPolygonCollision(spriteOne, transform, spriteTwo);
+				pixelHits += isPixelHit ? 1 : 0;
+				polygonHits += isPolygonHit ? 1 : 0;
+				if (isPixelHit && !isPolygonHit)
+				{
+					// The texel center of sprite one that hit is within the tolerance of its polygons (scaled into sprite two's space), and the point
+					// that it hit is within the tolerance and a corner cut of sprite two's polygons.
+					misses++;
+					auto bound = (tolerance * scale) + tolerance + 0.3536f;
+					CHECK(GetDistance(spriteOne, transform, spriteTwo) <= bound + 0.001f);
+				}
+			}
+		}
+
+		// Make sure that the placements found plenty of both results, and that misses are the exception.
+		CHECK(pixelHits > 500);
+		CHECK(polygonHits < 6000 - 500);
+		CHECK(misses * 10 < pixelHits);
+	}
+}
+
+int main()
+{
+	TestConvexOverlap();
+	TestRegions();
+	TestHole();
+	TestCornerMiss();
+	TestPieceSize(64, 0.5f);
+	TestPieceSize(256, 0.25f);
+	TestPieceSize(256, 1.0f);
+	TestAgainstPixelPerfect(0.0f);
+	TestAgainstPixelPerfect(0.5f);
+	TestAgainstPixelPerfect(1.0f);
+
+	return PortableTests::Finish("CollisionPolygonsTests");
+}
@@ -0,0 +1,367 @@
+// Drives DX::ReadbackScheduler with a fake device, the same way that CollisionDataReadback drives it with Direct3D: each request creates (or
+// reuses) a slot's staging "texture" before claiming the slot and queues a copy that the fake GPU finishes a random number of frames later, in
+// submission order. Update collects the finished readbacks while polling and calls their callbacks afterwards, once their slots are free.
+// Texture creation fails at random to check that a failed request never leaves a claimed slot without a texture, and mapping fails at random
+// to check that a failed map frees its slot and drops its callback. Callbacks that request another readback must get a slot even when every
+// slot was pending before the Update.
+
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <stdexcept>
+#include <vector>
+
+#include "ReadbackScheduler.h"
+#include "TestHelpers.h"
+
+namespace
+{
+	// The result of FakeDevice::Map, standing in for S_OK, DXGI_ERROR_WAS_STILL_DRAWING, and any other error.
+	enum class MapResult
+	{
+		Mapped,
+		StillDrawing,
+		Failed
+	};
+
+	// A fake device and context. Copies finish in the order they were queued, at least one frame after they were queued.
+	class FakeDevice
+	{
+	public:
+		explicit FakeDevice(PortableTests::Random& random) :
+			m_random(random),
+			m_frame(),
+			m_copies(),
+			m_copied(),
+			m_failCreates(),
+			m_failMaps()
+		{
+		}
+
+		// Creates a staging texture (an id), or throws if creation is set to fail.
+		std::unique_ptr<uint32_t> CreateTexture(uint32_t id)
+		{
+			if (m_failCreates && m_random.Range(0, 3) == 0)
+			{
+				throw std::runtime_error("CreateTexture2D failed");
+			}
+
+			return std::unique_ptr<uint32_t>(new uint32_t(id));
+		}
+
+		// Queues a copy of value into texture.
+		void Copy(const uint32_t* texture, uint32_t value)
+		{
+			PendingCopy copy = { texture, value, m_frame + static_cast<uint64_t>(m_random.Range(1, 5)) };
+			if (!m_copies.empty() && copy.m_doneFrame < m_copies.back().m_doneFrame)
+			{
+				copy.m_doneFrame = m_copies.back().m_doneFrame;
+			}
+			m_copies.push_back(copy);
+		}
+
+		// Maps texture. Returns StillDrawing if a copy into it is still pending, or Failed at random if maps are set to fail.
+		MapResult Map(const uint32_t* texture, uint32_t& value)
+		{
+			CHECK(texture != nullptr);
+			if (m_failMaps && m_random.Range(0, 7) == 0)
+			{
+				return MapResult::Failed;
+			}
+
+			while (!m_copies.empty() && m_copies.front().m_doneFrame <= m_frame)
+			{
+				m_copied.push_back(m_copies.front());
+				m_copies.pop_front();
+			}
+
+			for (auto& copy : m_copies)
+			{
+				if (copy.m_texture == texture)
+				{
+					return MapResult::StillDrawing;
+				}
+			}
+
+			for (auto copy = m_copied.rbegin(); copy != m_copied.rend(); ++copy)
+			{
+				if (copy->m_texture == texture)
+				{
+					value = copy->m_value;
+					return MapResult::Mapped;
+				}
+			}
+
+			CHECK(!"Mapped a texture that was never copied into");
+			return MapResult::Failed;
+		}
+
+		void AdvanceFrame() { m_frame++; }
+
+		void SetFailCreates(bool failCreates) { m_failCreates = failCreates; }
+
+		void SetFailMaps(bool failMaps) { m_failMaps = failMaps; }
+
+	private:
+		struct PendingCopy
+		{
+			const uint32_t*			m_texture;
+			uint32_t				m_value;
+			uint64_t				m_doneFrame;
+		};
+
+		PortableTests::Random&		m_random;
+		uint64_t					m_frame;
+		std::deque<PendingCopy>	m_copies;
+		std::vector<PendingCopy>	m_copied;
+		bool						m_failCreates;
+		bool						m_failMaps;
+	};
+
+	// The parts of CollisionDataReadback that use the scheduler, with the fake device in place of Direct3D.
+	class FakeReadback
+	{
+	public:
+		FakeReadback(FakeDevice& device, uint32_t slotCount, uint32_t frameLatency) :
+			m_device(device),
+			m_scheduler(),
+			m_textures(slotCount),
+			m_values(slotCount),
+			m_completed(),
+			m_dropped(),
+			m_callback()
+		{
+			m_scheduler.Initialize(slotCount, frameLatency);
+		}
+
+		// Returns false if every slot is pending. Throws if the texture can't be created.
+		bool Request(uint32_t value)
+		{
+			auto slot = m_scheduler.GetNextSlot();
+			if (slot == DX::ReadbackScheduler::NoSlot)
+			{
+				return false;
+			}
+
+			// Replace the texture now and then, like a request for a texture with a different size.
+			if (m_textures[slot] == nullptr || (value % 7) == 0)
+			{
+				m_textures[slot] = nullptr;
+				m_textures[slot] = m_device.CreateTexture(slot);
+			}
+
+			m_device.Copy(m_textures[slot].get(), value);
+			m_values[slot] = value;
+			CHECK(m_scheduler.Submit() == slot);
+			return true;
+		}
+
+		// Collects the finished readbacks and then calls the callback for each of them. Throws after the callbacks if a map failed.
+		void Update()
+		{
+			std::vector<uint32_t> completed;
+			bool isFailed = false;
+			m_scheduler.AdvanceFrame();
+			m_scheduler.Poll([this, &completed, &isFailed](uint32_t slot) -> bool
+			{
+				uint32_t value = 0;
+				auto result = m_device.Map(m_textures[slot].get(), value);
+				if (result == MapResult::StillDrawing)
+				{
+					return false;
+				}
+
+				// A failed map drops the readback but still frees the slot.
+				if (result == MapResult::Failed)
+				{
+					m_dropped.push_back(m_values[slot]);
+					isFailed = true;
+					return true;
+				}
+
+				CHECK(value == m_values[slot]);
+				completed.push_back(value);
+				return true;
+			});
+
+			for (auto value : completed)
+			{
+				m_completed.push_back(value);
+				if (m_callback)
+				{
+					m_callback(value);
+				}
+			}
+
+			if (isFailed)
+			{
+				throw std::runtime_error("Map failed");
+			}
+		}
+
+		// Sets a function to call for each completed readback, after its slot has been freed.
+		void SetCallback(std::function<void (uint32_t value)> callback) { m_callback = std::move(callback); }
+
+		DX::ReadbackScheduler& GetScheduler() { return m_scheduler; }
+
+		const std::vector<uint32_t>& GetCompleted() const { return m_completed; }
+
+		const std::vector<uint32_t>& GetDropped() const { return m_dropped; }
+
+	private:
+		FakeDevice&								m_device;
+		DX::ReadbackScheduler					m_scheduler;
+		std::vector<std::unique_ptr<uint32_t>>	m_textures;
+		std::vector<uint32_t>					m_values;
+		std::vector<uint32_t>					m_completed;
+		std::vector<uint32_t>					m_dropped;
+		std::function<void (uint32_t value)>	m_callback;
+	};
+
+	// Slots are handed out in ring order, the ring fills up, and nothing is polled before the latency has gone by.
+	void TestSlots()
+	{
+		DX::ReadbackScheduler scheduler;
+		scheduler.Initialize(3, 2);
+
+		CHECK(scheduler.GetNextSlot() == 0);
+		CHECK(scheduler.GetNextSlot() == 0);
+		CHECK(scheduler.Submit() == 0);
+		CHECK(scheduler.Submit() == 1);
+		CHECK(scheduler.Submit() == 2);
+		CHECK(scheduler.GetNextSlot() == DX::ReadbackScheduler::NoSlot);
+		CHECK(scheduler.Submit() == DX::ReadbackScheduler::NoSlot);
+		CHECK(scheduler.GetPendingCount() == 3);
+
+		auto always = [](uint32_t) { return true; };
+		scheduler.AdvanceFrame();
+		CHECK(scheduler.Poll(always) == 0);
+		scheduler.AdvanceFrame();
+
+		// Polling stops at the first slot that isn't ready.
+		uint32_t polled = 0;
+		CHECK(scheduler.Poll([&polled](uint32_t slot) { polled++; return slot == 0; }) == 1);
+		CHECK(polled == 2);
+		CHECK(scheduler.GetNextSlot() == 0);
+		CHECK(scheduler.Poll(always) == 2);
+		CHECK(scheduler.GetPendingCount() == 0);
+		CHECK(scheduler.GetNextSlot() == 0);
+	}
+
+	// Random requests against the fake device, with and without failing texture creation and maps.
+	void TestFakeDevice(bool failCreates, bool failMaps)
+	{
+		PortableTests::Random random((failCreates ? 7 : 3) + (failMaps ? 10 : 0));
+		FakeDevice device(random);
+		device.SetFailCreates(failCreates);
+		FakeReadback readback(device, 4, 2);
+
+		std::vector<uint32_t> requested;
+		uint32_t nextValue = 1;
+		for (int frame = 0; frame < 5000; frame++)
+		{
+			auto requestCount = random.Range(0, 3);
+			for (int request = 0; request < requestCount; request++)
+			{
+				auto pending = readback.GetScheduler().GetPendingCount();
+				try
+				{
+					if (readback.Request(nextValue))
+					{
+						requested.push_back(nextValue);
+					}
+				}
+				catch (const std::runtime_error&)
+				{
+					// A failed request mustn't claim a slot.
+					CHECK(readback.GetScheduler().GetPendingCount() == pending);
+				}
+				nextValue++;
+			}
+
+			device.AdvanceFrame();
+			device.SetFailMaps(failMaps);
+			try
+			{
+				readback.Update();
+			}
+			catch (const std::runtime_error&)
+			{
+				CHECK(failMaps);
+			}
+			device.SetFailMaps(false);
+		}
+
+		// Let everything finish.
+		for (int frame = 0; frame < 16; frame++)
+		{
+			device.AdvanceFrame();
+			readback.Update();
+		}
+
+		// Every request either completed or was dropped by a failed map, in order.
+		CHECK(readback.GetScheduler().GetPendingCount() == 0);
+		CHECK(failMaps == !readback.GetDropped().empty());
+		size_t completedIndex = 0;
+		size_t droppedIndex = 0;
+		for (auto value : requested)
+		{
+			auto& completed = readback.GetCompleted();
+			auto& dropped = readback.GetDropped();
+			bool isCompleted = completedIndex < completed.size() && completed[completedIndex] == value;
+			bool isDropped = droppedIndex < dropped.size() && dropped[droppedIndex] == value;
+			CHECK(isCompleted != isDropped);
+			completedIndex += isCompleted ? 1 : 0;
+			droppedIndex += isDropped ? 1 : 0;
+		}
+		CHECK(completedIndex == readback.GetCompleted().size() && droppedIndex == readback.GetDropped().size());
+	}
+
+	// A callback that requests another readback gets a slot even when every slot was pending, since the slot is freed before the callback.
+	void TestRequestFromCallback()
+	{
+		PortableTests::Random random(5);
+		FakeDevice device(random);
+		FakeReadback readback(device, 2, 1);
+
+		uint32_t failedRequests = 0;
+		readback.SetCallback([&readback, &failedRequests](uint32_t value)
+		{
+			if (value < 100 && !readback.Request(value + 100))
+			{
+				failedRequests++;
+			}
+		});
+
+		CHECK(readback.Request(1));
+		CHECK(readback.Request(2));
+		CHECK(!readback.Request(3));
+
+		for (int frame = 0; frame < 16; frame++)
+		{
+			device.AdvanceFrame();
+			readback.Update();
+		}
+
+		CHECK(failedRequests == 0);
+		std::vector<uint32_t> expected;
+		expected.push_back(1);
+		expected.push_back(2);
+		expected.push_back(101);
+		expected.push_back(102);
+		CHECK(readback.GetCompleted() == expected);
+	}
+}
+
+int main()
+{
+	TestSlots();
+	TestFakeDevice(false, false);
+	TestFakeDevice(true, false);
+	TestFakeDevice(false, true);
+	TestFakeDevice(true, true);
+	TestRequestFromCallback();
+
+	return PortableTests::Finish("ReadbackSchedulerTests");
+}
@@ -0,0 +1,82 @@
+// Measures how fast DX::SampleRateConverter converts a minute of stereo audio for the rate pairs that sound effects are loaded at, for both
+// sample types. AudioEngine converts each sound effect once when it is loaded (in parallel across the sound effects), so this is load time.
+// Run a release build. Usage: SampleRateConverterBenchmark
+
+#include <cstdint>
+#include <cstdio>
+#include <vector>
+
+#include "SampleRateConverter.h"
+#include "TestHelpers.h"
+
+namespace
+{
+	const uint32_t Seconds = 60;
+	const uint32_t Channels = 2;
+	const uint32_t Repeats = 3;
+
+	struct RatePair
+	{
+		uint32_t				m_input;
+		uint32_t				m_output;
+	};
+	const RatePair RatePairs[] = { { 44100, 48000 }, { 22050, 48000 }, { 48000, 44100 }, { 48000, 22050 } };
+}
+
+int main()
+{
+	PortableTests::Random random(23);
+	double check = 0.0;
+
+	for (auto& pair : RatePairs)
+	{
+		DX::SampleRateConverter converter;
+		if (!converter.Initialize(pair.m_input, pair.m_output))
+		{
+			printf("%u to %u Hz: can't be converted\n", pair.m_input, pair.m_output);
+			continue;
+		}
+
+		size_t frameCount = static_cast<size_t>(pair.m_input) * Seconds;
+		size_t outputFrameCount = static_cast<size_t>(converter.GetOutputFrameCount(frameCount));
+
+		std::vector<int16_t> input16(frameCount * Channels);
+		std::vector<float> inputFloat(frameCount * Channels);
+		for (size_t i = 0; i < input16.size(); i++)
+		{
+			input16[i] = static_cast<int16_t>(random.Range(-20000, 20000));
+			inputFloat[i] = input16[i] / 32768.0f;
+		}
+
+		std::vector<int16_t> output16(outputFrameCount * Channels);
+		std::vector<float> outputFloat(outputFrameCount * Channels);
+
+		// The best of a few runs, to leave out the first run's page faults.
+		double int16Time = 1.0e30;
+		double floatTime = 1.0e30;
+		for (uint32_t repeat = 0; repeat < Repeats; repeat++)
+		{
+			double start = PortableTests::Seconds();
+			converter.Convert(input16.data(), frameCount, Channels, output16.data());
+			double middle = PortableTests::Seconds();
+			converter.Convert(inputFloat.data(), frameCount, Channels, outputFloat.data());
+			double end = PortableTests::Seconds();
+
+			int16Time = (middle - start) < int16Time ? middle - start : int16Time;
+			floatTime = (end - middle) < floatTime ? end - middle : floatTime;
+		}
+
+		check += output16[outputFrameCount / 2] + outputFloat[outputFrameCount / 3];
+
+		// Output samples per second, counting both channels.
+		double samples = static_cast<double>(outputFrameCount) * Channels;
+		printf("%5u to %5u Hz, %u taps, %u s stereo: int16 %7.1f ms (%6.1f Msamples/s, %5.0fx real time), float %7.1f ms (%6.1f Msamples/s, %5.0fx real time)\n",
+			pair.m_input, pair.m_output, converter.GetTapCount(), Seconds, int16Time * 1000.0, samples / int16Time * 1.0e-6, Seconds / int16Time,
+			floatTime * 1000.0, samples / floatTime * 1.0e-6, Seconds / floatTime);
+	}
+
+	// Print a sample so that the conversion can't be optimized away.
+	printf("[%f]\n", check);
+
+	return 0;
+}
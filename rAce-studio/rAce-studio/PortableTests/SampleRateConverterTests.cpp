@@ -0,0 +1,266 @@
+// Checks the quality of DX::SampleRateConverter for the rate pairs the game meets: sines in the passband have to come out as the same sine at the
+// new rate (measured as a signal to noise ratio against the exact sine), frequencies above the output's Nyquist frequency have to be filtered
+// out rather than aliased, and a constant has to stay constant. Also checks the rate arithmetic, the rejected rate pairs, that channels are
+// converted independently and that the 16-bit path matches the float one. Outputs are allocated at exactly their size so that a sanitized build
+// catches any write past the end.
+
+#include <cmath>
+#include <cstdint>
+#include <vector>
+
+#include "SampleRateConverter.h"
+#include "TestHelpers.h"
+
+namespace
+{
+	const double Pi = 3.14159265358979323846;
+
+	// The rate pairs the game converts between (sound effects to the mastering voice's rate), in both directions.
+	struct RatePair
+	{
+		uint32_t				m_input;
+		uint32_t				m_output;
+	};
+	const RatePair RatePairs[] =
+	{
+		{ 44100, 48000 }, { 48000, 44100 }, { 22050, 48000 }, { 48000, 22050 }, { 32000, 48000 }, { 11025, 44100 }, { 48000, 16000 }, { 8000, 44100 }
+	};
+
+	// Returns the number of output frames at each end that the filter reaches past the sound into the silence around it (with some to spare).
+	size_t GetEdgeFrames(const DX::SampleRateConverter& converter)
+	{
+		return static_cast<size_t>(converter.GetOutputFrameCount(converter.GetTapCount())) + converter.GetTapCount();
+	}
+
+	std::vector<float> MakeSine(double frequency, uint32_t sampleRate, size_t frameCount, double amplitude)
+	{
+		std::vector<float> samples(frameCount);
+		for (size_t i = 0; i < frameCount; i++)
+		{
+			samples[i] = static_cast<float>(amplitude * std::sin(2.0 * Pi * frequency * static_cast<double>(i) / sampleRate));
+		}
+
+		return samples;
+	}
+
+	// Returns the ratio in dB of the power of the exact sine to the power of the difference from it, over the output frames that are at least
+	// margin frames from either end (the ends are the filter running into the silence around the sound).
+	double MeasureSignalToNoise(const std::vector<float>& output, double frequency, uint32_t sampleRate, double amplitude, size_t margin)
+	{
+		double signal = 0.0;
+		double noise = 0.0;
+		for (size_t i = margin; i + margin < output.size(); i++)
+		{
+			double expected = amplitude * std::sin(2.0 * Pi * frequency * static_cast<double>(i) / sampleRate);
+			double error = output[i] - expected;
+			signal += expected * expected;
+			noise += error * error;
+		}
+
+		return 10.0 * std::log10(signal / (noise > 1.0e-30 ? noise : 1.0e-30));
+	}
+
+	// Returns the RMS level of the output frames that are at least margin frames from either end.
+	double MeasureRms(const std::vector<float>& output, size_t margin)
+	{
+		double sum = 0.0;
+		size_t count = 0;
+		for (size_t i = margin; i + margin < output.size(); i++)
+		{
+			sum += static_cast<double>(output[i]) * output[i];
+			count++;
+		}
+
+		return std::sqrt(sum / (count != 0 ? count : 1));
+	}
+
+	void TestInitialize()
+	{
+		DX::SampleRateConverter converter;
+		CHECK(!converter.Initialize(0, 48000));
+		CHECK(!converter.Initialize(44100, 0));
+		CHECK(converter.GetOutputFrameCount(100) == 0);
+
+		// 44100 to 48001 reduces to 48001 / 44100, which needs far too many phases.
+		CHECK(!converter.Initialize(44100, 48001));
+
+		for (auto& pair : RatePairs)
+		{
+			CHECK(converter.Initialize(pair.m_input, pair.m_output));
+			CHECK(converter.GetInputRate() == pair.m_input && converter.GetOutputRate() == pair.m_output);
+			CHECK(converter.GetTapCount() % 4 == 0);
+			CHECK(converter.GetTapCount() >= DX::SampleRateConverter::BaseTapCount);
+
+			// A second of input is a second of output, and the frame positions scale with the rates.
+			CHECK(converter.GetOutputFrameCount(pair.m_input) == pair.m_output);
+			CHECK(converter.GetOutputFrameCount(0) == 0);
+			CHECK(converter.ConvertFramePosition(pair.m_input * 3) == static_cast<uint64_t>(pair.m_output) * 3);
+			CHECK(converter.ConvertFramePosition(0) == 0);
+		}
+
+		// 44100 to 48000 is 160 / 147: 147 input frames make 160 output frames, and the last partial step still produces a frame.
+		CHECK(converter.Initialize(44100, 48000));
+		CHECK(converter.GetOutputFrameCount(147) == 160);
+		CHECK(converter.GetOutputFrameCount(148) == 162);
+		CHECK(converter.ConvertFramePosition(147) == 160);
+	}
+
+	// Sines well inside the passband come out clean, at the right frequency and level.
+	void TestPassband()
+	{
+		DX::SampleRateConverter converter;
+		for (auto& pair : RatePairs)
+		{
+			CHECK(converter.Initialize(pair.m_input, pair.m_output));
+
+			uint32_t lowerRate = pair.m_input < pair.m_output ? pair.m_input : pair.m_output;
+			const double fractions[] = { 0.01, 0.1, 0.3, 0.7 };
+			for (auto fraction : fractions)
+			{
+				// A fraction of the lower Nyquist frequency.
+				double frequency = fraction * 0.5 * lowerRate;
+				size_t inputFrames = pair.m_input / 4;
+				auto input = MakeSine(frequency, pair.m_input, inputFrames, 0.5);
+
+				std::vector<float> output(static_cast<size_t>(converter.GetOutputFrameCount(inputFrames)));
+				converter.Convert(input.data(), inputFrames, 1, output.data());
+
+				double signalToNoise = MeasureSignalToNoise(output, frequency, pair.m_output, 0.5, GetEdgeFrames(converter));
+				CHECK(signalToNoise > 70.0);
+			}
+		}
+	}
+
+	// Frequencies above the output's Nyquist frequency are removed when converting down.
+	void TestStopband()
+	{
+		DX::SampleRateConverter converter;
+		for (auto& pair : RatePairs)
+		{
+			if (pair.m_output >= pair.m_input)
+			{
+				continue;
+			}
+
+			CHECK(converter.Initialize(pair.m_input, pair.m_output));
+
+			// From just above the output's Nyquist frequency (past the transition band) up to the input's.
+			const double fractions[] = { 1.1, 1.3, 1.6 };
+			for (auto fraction : fractions)
+			{
+				double frequency = fraction * 0.5 * pair.m_output;
+				if (frequency >= 0.5 * pair.m_input)
+				{
+					continue;
+				}
+
+				size_t inputFrames = pair.m_input / 4;
+				auto input = MakeSine(frequency, pair.m_input, inputFrames, 1.0);
+
+				std::vector<float> output(static_cast<size_t>(converter.GetOutputFrameCount(inputFrames)));
+				converter.Convert(input.data(), inputFrames, 1, output.data());
+
+				// The full scale sine has an RMS level of 0.707; what is left of it has to be at least 60 dB below that.
+				double level = 20.0 * std::log10(MeasureRms(output, GetEdgeFrames(converter)) / std::sqrt(0.5) + 1.0e-30);
+				CHECK(level < -60.0);
+			}
+		}
+	}
+
+	// A constant stays the same constant (each phase has unity gain at DC), and silence stays silent.
+	void TestConstant()
+	{
+		DX::SampleRateConverter converter;
+		for (auto& pair : RatePairs)
+		{
+			CHECK(converter.Initialize(pair.m_input, pair.m_output));
+
+			std::vector<float> input(4000, 0.25f);
+			std::vector<float> output(static_cast<size_t>(converter.GetOutputFrameCount(input.size())));
+			converter.Convert(input.data(), input.size(), 1, output.data());
+
+			size_t margin = GetEdgeFrames(converter);
+			for (size_t i = margin; i + margin < output.size(); i++)
+			{
+				CHECK(std::fabs(output[i] - 0.25f) < 1.0e-4f);
+			}
+
+			std::vector<int16_t> silence(1000, 0);
+			std::vector<int16_t> silentOutput(static_cast<size_t>(converter.GetOutputFrameCount(silence.size())), 1);
+			converter.Convert(silence.data(), silence.size(), 1, silentOutput.data());
+			for (auto sample : silentOutput)
+			{
+				CHECK(sample == 0);
+			}
+		}
+	}
+
+	// Interleaved channels come out the same as converting each one on its own, and the 16-bit path matches the float path.
+	void TestChannelsAndInt16()
+	{
+		PortableTests::Random random(23);
+		DX::SampleRateConverter converter;
+		CHECK(converter.Initialize(22050, 48000));
+
+		const uint32_t Channels = 3;
+		const size_t FrameCount = 777;
+		size_t outputFrames = static_cast<size_t>(converter.GetOutputFrameCount(FrameCount));
+
+		std::vector<float> interleaved(FrameCount * Channels);
+		for (auto& sample : interleaved)
+		{
+			sample = random.Range(-0.9f, 0.9f);
+		}
+
+		std::vector<float> output(outputFrames * Channels);
+		converter.Convert(interleaved.data(), FrameCount, Channels, output.data());
+
+		for (uint32_t channel = 0; channel < Channels; channel++)
+		{
+			std::vector<float> mono(FrameCount);
+			for (size_t i = 0; i < FrameCount; i++)
+			{
+				mono[i] = interleaved[(i * Channels) + channel];
+			}
+
+			std::vector<float> monoOutput(outputFrames);
+			converter.Convert(mono.data(), FrameCount, 1, monoOutput.data());
+			for (size_t i = 0; i < outputFrames; i++)
+			{
+				CHECK(monoOutput[i] == output[(i * Channels) + channel]);
+			}
+		}
+
+		// The 16-bit output is the float output rounded (within a step for the rounding of the float arithmetic) and clamped.
+		std::vector<int16_t> input16(FrameCount * 2);
+		std::vector<float> inputFloat(FrameCount * 2);
+		for (size_t i = 0; i < input16.size(); i++)
+		{
+			// Include full scale square-ish runs, which ring past full scale after filtering and have to be clamped.
+			input16[i] = (i / 40) % 3 == 0 ? static_cast<int16_t>((i / 2) % 2 ? 32767 : -32768) : static_cast<int16_t>(random.Range(-32768, 32767));
+			inputFloat[i] = input16[i];
+		}
+
+		std::vector<int16_t> output16(outputFrames * 2);
+		std::vector<float> outputFloat(outputFrames * 2);
+		converter.Convert(input16.data(), FrameCount, 2, output16.data());
+		converter.Convert(inputFloat.data(), FrameCount, 2, outputFloat.data());
+		for (size_t i = 0; i < output16.size(); i++)
+		{
+			double expected = std::floor(outputFloat[i] + 0.5);
+			expected = expected < -32768.0 ? -32768.0 : (expected > 32767.0 ? 32767.0 : expected);
+			CHECK(std::fabs(output16[i] - expected) <= 1.0);
+		}
+	}
+}
+
+int main()
+{
+	TestInitialize();
+	TestPassband();
+	TestStopband();
+	TestConstant();
+	TestChannelsAndInt16();
+
+	return PortableTests::Finish("SampleRateConverterTests");
+}
@@ -0,0 +1,101 @@
+// Measures how long DX::SoftwareMixer takes to render a buffer with 256 voices playing (and fewer, to show how it scales), rendering headless the
+// way an audio device callback would. The voices are a mix of mono and stereo, 16-bit and float sounds, all looping so the voice count stays
+// the same. Each line also gives the render time as a share of the time the buffer takes to play, which is what a device callback has.
+// Run a release build. Usage: SoftwareMixerBenchmark [<frames per buffer>]
+
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <vector>
+
+#include "SoftwareMixer.h"
+#include "TestHelpers.h"
+
+namespace
+{
+	const uint32_t SampleRate = 48000;
+	const uint32_t SoundCount = 8;
+	const uint32_t BufferCount = 2000;
+}
+
+int main(int argc, char* argv[])
+{
+	uint32_t framesPerBuffer = (argc > 1) ? static_cast<uint32_t>(atoi(argv[1])) : 480;
+	if (framesPerBuffer == 0)
+	{
+		printf("Usage: SoftwareMixerBenchmark [<frames per buffer>]\n");
+		return 1;
+	}
+
+	// A second of each kind of sound, so the voices read from more memory than fits in the cache, like real sound effects.
+	PortableTests::Random random(22);
+	std::vector<std::vector<int16_t>> int16Data(SoundCount);
+	std::vector<std::vector<float>> floatData(SoundCount);
+	std::vector<DX::AudioSound> sounds(SoundCount);
+	for (uint32_t i = 0; i < SoundCount; i++)
+	{
+		uint32_t channels = 1 + (i % 2);
+		bool isFloat = (i % 4) >= 2;
+		uint32_t frameCount = SampleRate + static_cast<uint32_t>(random.Range(0, 999));
+
+		auto& sound = sounds[i];
+		sound.m_frameCount = frameCount;
+		sound.m_channels = channels;
+		sound.m_sampleRate = SampleRate;
+		sound.m_loopBegin = 0;
+		sound.m_loopLength = 0;
+		if (isFloat)
+		{
+			floatData[i].resize(static_cast<size_t>(frameCount) * channels);
+			for (auto& sample : floatData[i])
+			{
+				sample = random.Range(-1.0f, 1.0f);
+			}
+			sound.m_data = floatData[i].data();
+			sound.m_sampleType = DX::AudioSampleType::Float32;
+		}
+		else
+		{
+			int16Data[i].resize(static_cast<size_t>(frameCount) * channels);
+			for (auto& sample : int16Data[i])
+			{
+				sample = static_cast<int16_t>(random.Range(-32768, 32767));
+			}
+			sound.m_data = int16Data[i].data();
+			sound.m_sampleType = DX::AudioSampleType::Int16;
+		}
+	}
+
+	std::vector<float> output(static_cast<size_t>(framesPerBuffer) * DX::SoftwareMixer::OutputChannels);
+	double bufferSeconds = static_cast<double>(framesPerBuffer) / SampleRate;
+	float check = 0.0f;
+
+	const uint32_t voiceCounts[] = { 32, 64, 128, 256 };
+	for (auto voiceCount : voiceCounts)
+	{
+		DX::SoftwareMixer mixer(SampleRate, voiceCount);
+		for (uint32_t i = 0; i < voiceCount; i++)
+		{
+			mixer.Play(sounds[i % SoundCount], DX::IAudioBackend::LoopInfinite, random.Range(0.0f, 0.1f), random.Range(-1.0f, 1.0f));
+		}
+
+		// The first buffer carries out the plays.
+		mixer.Render(output.data(), framesPerBuffer);
+
+		double start = PortableTests::Seconds();
+		for (uint32_t buffer = 0; buffer < BufferCount; buffer++)
+		{
+			mixer.Render(output.data(), framesPerBuffer);
+			check += output[buffer % output.size()];
+		}
+		double perBuffer = (PortableTests::Seconds() - start) / BufferCount;
+
+		printf("%3u voices, %u frames per buffer: %8.1f us per buffer (%5.2f%% of the buffer's %.1f ms)\n", voiceCount, framesPerBuffer,
+			perBuffer * 1.0e6, 100.0 * perBuffer / bufferSeconds, bufferSeconds * 1000.0);
+	}
+
+	// Print a sample so that the mixing can't be optimized away.
+	printf("[%f]\n", check);
+
+	return 0;
+}
@@ -0,0 +1,546 @@
+// Renders DX::SoftwareMixer headless and checks the output against a plain reference mix worked out one frame at a time: mono and stereo
+// sounds of both sample types, pan laws, loop regions, gain ramps, pause, voice reuse (old handles have to be ignored), commands that overflow
+// the ring, and random mixes with buffer sizes that aren't multiples of the SIMD width. Finally Render runs on its own thread while the game
+// thread plays and stops voices, and every voice has to come back.
+
+#include <atomic>
+#include <cmath>
+#include <cstdint>
+#include <thread>
+#include <vector>
+
+#include "SoftwareMixer.h"
+#include "TestHelpers.h"
+
+namespace
+{
+	const uint32_t SampleRate = 48000;
+
+	bool IsClose(float value, float expected, float tolerance = 1.0e-5f)
+	{
+		return std::fabs(value - expected) <= tolerance;
+	}
+
+	// A sound and the samples it plays from.
+	struct TestSound
+	{
+		std::vector<int16_t>		m_int16;
+		std::vector<float>			m_float;
+		DX::AudioSound				m_sound;
+	};
+
+	// Makes a sound of random samples.
+	void MakeSound(PortableTests::Random& random, TestSound& result, uint32_t frameCount, uint32_t channels, DX::AudioSampleType type)
+	{
+		result.m_int16.clear();
+		result.m_float.clear();
+		for (uint32_t i = 0; i < frameCount * channels; i++)
+		{
+			int16_t sample = static_cast<int16_t>(random.Range(-32768, 32767));
+			result.m_int16.push_back(sample);
+			result.m_float.push_back(sample / 32768.0f);
+		}
+
+		result.m_sound.m_data = (type == DX::AudioSampleType::Int16) ?
+			static_cast<const void*>(result.m_int16.data()) : static_cast<const void*>(result.m_float.data());
+		result.m_sound.m_frameCount = frameCount;
+		result.m_sound.m_channels = channels;
+		result.m_sound.m_sampleRate = SampleRate;
+		result.m_sound.m_sampleType = type;
+		result.m_sound.m_loopBegin = 0;
+		result.m_sound.m_loopLength = 0;
+	}
+
+	// The gains that the mixer should use for a volume and pan.
+	void ReferenceGains(uint32_t channels, float volume, float pan, float& left, float& right)
+	{
+		if (channels == 1)
+		{
+			left = volume * std::cos((pan + 1.0f) * 0.785398163f);
+			right = volume * std::sin((pan + 1.0f) * 0.785398163f);
+		}
+		else
+		{
+			left = volume * (pan > 0.0f ? 1.0f - pan : 1.0f);
+			right = volume * (pan < 0.0f ? 1.0f + pan : 1.0f);
+		}
+	}
+
+	// Returns the source frames that a play goes through, in order, with its loops.
+	std::vector<uint32_t> ReferenceFrames(const DX::AudioSound& sound, uint32_t loopCount)
+	{
+		std::vector<uint32_t> frames;
+		uint32_t loopEnd = sound.m_loopBegin + (sound.m_loopLength != 0 ? sound.m_loopLength : sound.m_frameCount - sound.m_loopBegin);
+		for (uint32_t frame = 0; frame < loopEnd; frame++)
+		{
+			frames.push_back(frame);
+		}
+		for (uint32_t loop = 0; loop < loopCount; loop++)
+		{
+			for (uint32_t frame = sound.m_loopBegin; frame < loopEnd; frame++)
+			{
+				frames.push_back(frame);
+			}
+		}
+		for (uint32_t frame = loopEnd; frame < sound.m_frameCount; frame++)
+		{
+			frames.push_back(frame);
+		}
+
+		return frames;
+	}
+
+	// One play in the reference mix, at constant gains.
+	struct ReferencePlay
+	{
+		const TestSound*			m_sound;
+		std::vector<uint32_t>		m_frames;
+		size_t						m_next;
+		float						m_left;
+		float						m_right;
+	};
+
+	// Adds frameCount frames of each play to output and advances them.
+	void ReferenceMix(std::vector<ReferencePlay>& plays, std::vector<float>& output, uint32_t frameCount)
+	{
+		output.assign(static_cast<size_t>(frameCount) * 2, 0.0f);
+		for (auto& play : plays)
+		{
+			const auto& samples = play.m_sound->m_float;
+			uint32_t channels = play.m_sound->m_sound.m_channels;
+			for (uint32_t i = 0; i < frameCount && play.m_next < play.m_frames.size(); i++, play.m_next++)
+			{
+				uint32_t frame = play.m_frames[play.m_next];
+				float left = samples[frame * channels];
+				float right = (channels == 2) ? samples[(frame * 2) + 1] : left;
+				output[i * 2] += left * play.m_left;
+				output[(i * 2) + 1] += right * play.m_right;
+			}
+		}
+	}
+
+	void TestPanAndSampleTypes()
+	{
+		PortableTests::Random random(22);
+		const DX::AudioSampleType types[] = { DX::AudioSampleType::Int16, DX::AudioSampleType::Float32 };
+		const float pans[] = { -1.0f, -0.5f, 0.0f, 0.3f, 1.0f };
+
+		for (auto type : types)
+		{
+			for (uint32_t channels = 1; channels <= 2; channels++)
+			{
+				for (auto pan : pans)
+				{
+					TestSound sound;
+					MakeSound(random, sound, 37, channels, type);
+
+					DX::SoftwareMixer mixer(SampleRate, 4);
+					auto handle = mixer.Play(sound.m_sound, 0, 0.8f, pan);
+					CHECK(handle.IsValid());
+					CHECK(mixer.IsPlaying(handle));
+
+					std::vector<ReferencePlay> plays(1);
+					plays[0].m_sound = &sound;
+					plays[0].m_frames = ReferenceFrames(sound.m_sound, 0);
+					plays[0].m_next = 0;
+					ReferenceGains(channels, 0.8f, pan, plays[0].m_left, plays[0].m_right);
+
+					// Longer than the sound, so the end is silence.
+					std::vector<float> output(64 * 2);
+					std::vector<float> expected;
+					mixer.Render(output.data(), 64);
+					ReferenceMix(plays, expected, 64);
+					for (size_t i = 0; i < output.size(); i++)
+					{
+						CHECK(IsClose(output[i], expected[i]));
+					}
+
+					mixer.Update();
+					CHECK(!mixer.IsPlaying(handle));
+					CHECK(mixer.GetActiveVoiceCount() == 0);
+				}
+			}
+		}
+
+		// The pan laws: mono is constant power, stereo is balance.
+		float left;
+		float right;
+		ReferenceGains(1, 1.0f, 0.0f, left, right);
+		CHECK(IsClose((left * left) + (right * right), 1.0f));
+		CHECK(IsClose(left, right));
+		ReferenceGains(2, 1.0f, -1.0f, left, right);
+		CHECK(left == 1.0f && right == 0.0f);
+	}
+
+	void TestLoops()
+	{
+		PortableTests::Random random(23);
+		TestSound sound;
+		MakeSound(random, sound, 50, 2, DX::AudioSampleType::Int16);
+
+		struct LoopCase
+		{
+			uint32_t				m_loopBegin;
+			uint32_t				m_loopLength;
+			uint32_t				m_loopCount;
+		};
+		const LoopCase loopCases[] = { { 0, 0, 1 }, { 10, 20, 3 }, { 45, 0, 2 }, { 3, 1, 5 }, { 20, 30, 0 } };
+
+		for (auto& loopCase : loopCases)
+		{
+			sound.m_sound.m_loopBegin = loopCase.m_loopBegin;
+			sound.m_sound.m_loopLength = loopCase.m_loopLength;
+
+			DX::SoftwareMixer mixer(SampleRate, 2);
+			auto handle = mixer.Play(sound.m_sound, loopCase.m_loopCount, 1.0f, 0.0f);
+
+			std::vector<ReferencePlay> plays(1);
+			plays[0].m_sound = &sound;
+			plays[0].m_frames = ReferenceFrames(sound.m_sound, loopCase.m_loopCount);
+			plays[0].m_next = 0;
+			ReferenceGains(2, 1.0f, 0.0f, plays[0].m_left, plays[0].m_right);
+
+			// Render in uneven pieces so that loops wrap inside a Render call and at its edges.
+			uint32_t rendered = 0;
+			for (uint32_t frameCount = 7; rendered < plays[0].m_frames.size() + 10; frameCount = (frameCount * 5) % 23 + 1)
+			{
+				std::vector<float> output(static_cast<size_t>(frameCount) * 2);
+				std::vector<float> expected;
+				mixer.Render(output.data(), frameCount);
+				ReferenceMix(plays, expected, frameCount);
+				for (size_t i = 0; i < output.size(); i++)
+				{
+					CHECK(IsClose(output[i], expected[i]));
+				}
+				rendered += frameCount;
+			}
+
+			mixer.Update();
+			CHECK(!mixer.IsPlaying(handle));
+		}
+
+		// An infinite loop only ends when it is stopped.
+		sound.m_sound.m_loopBegin = 0;
+		sound.m_sound.m_loopLength = 0;
+		DX::SoftwareMixer mixer(SampleRate, 1);
+		auto handle = mixer.Play(sound.m_sound, DX::IAudioBackend::LoopInfinite, 1.0f, 0.0f);
+		std::vector<float> output(1000 * 2);
+		for (uint32_t i = 0; i < 10; i++)
+		{
+			mixer.Render(output.data(), 1000);
+			mixer.Update();
+		}
+		CHECK(mixer.IsPlaying(handle));
+		mixer.Stop(handle);
+		mixer.Render(output.data(), 1000);
+		mixer.Update();
+		CHECK(!mixer.IsPlaying(handle));
+		CHECK(mixer.GetActiveVoiceCount() == 0);
+	}
+
+	// A gain change ramps linearly over the next Render call, as does a master volume change.
+	void TestGainRamps()
+	{
+		std::vector<float> ones(1000, 1.0f);
+		DX::AudioSound sound = {};
+		sound.m_data = ones.data();
+		sound.m_frameCount = 1000;
+		sound.m_channels = 1;
+		sound.m_sampleRate = SampleRate;
+		sound.m_sampleType = DX::AudioSampleType::Float32;
+
+		DX::SoftwareMixer mixer(SampleRate, 1);
+		auto handle = mixer.Play(sound, 0, 1.0f, -1.0f);
+
+		const uint32_t FrameCount = 101;
+		std::vector<float> output(FrameCount * 2);
+		mixer.Render(output.data(), FrameCount);
+		CHECK(IsClose(output[0], 1.0f) && IsClose(output[1], 0.0f));
+		CHECK(IsClose(output[(FrameCount - 1) * 2], 1.0f));
+
+		// Pan hard right: left ramps from 1 to 0 and right from 0 to 1 over the next call.
+		mixer.SetVolumeAndPan(handle, 1.0f, 1.0f);
+		mixer.Render(output.data(), FrameCount);
+		for (uint32_t frame = 0; frame < FrameCount; frame++)
+		{
+			float position = static_cast<float>(frame) / FrameCount;
+			CHECK(IsClose(output[frame * 2], 1.0f - position, 1.0e-4f));
+			CHECK(IsClose(output[(frame * 2) + 1], position, 1.0e-4f));
+		}
+
+		// Then it stays there.
+		mixer.Render(output.data(), FrameCount);
+		CHECK(IsClose(output[0], 0.0f) && IsClose(output[1], 1.0f));
+		CHECK(IsClose(output[(FrameCount - 1) * 2], 0.0f) && IsClose(output[((FrameCount - 1) * 2) + 1], 1.0f));
+
+		mixer.SetMasterVolume(0.5f);
+		mixer.Render(output.data(), FrameCount);
+		CHECK(IsClose(output[1], 1.0f));
+		CHECK(IsClose(output[((FrameCount / 2) * 2) + 1], 1.0f - (0.5f * (FrameCount / 2) / FrameCount), 1.0e-4f));
+		mixer.Render(output.data(), FrameCount);
+		CHECK(IsClose(output[1], 0.5f) && IsClose(output[((FrameCount - 1) * 2) + 1], 0.5f));
+	}
+
+	void TestPauseAndVoices()
+	{
+		PortableTests::Random random(24);
+		TestSound sound;
+		MakeSound(random, sound, 40, 1, DX::AudioSampleType::Int16);
+
+		DX::SoftwareMixer mixer(SampleRate, 3);
+		CHECK(mixer.GetMaxVoices() == 3);
+
+		// Sounds at another rate or with no data can't be played.
+		auto wrongRate = sound.m_sound;
+		wrongRate.m_sampleRate = 44100;
+		CHECK(!mixer.Play(wrongRate, 0, 1.0f, 0.0f).IsValid());
+		auto noData = sound.m_sound;
+		noData.m_data = nullptr;
+		CHECK(!mixer.Play(noData, 0, 1.0f, 0.0f).IsValid());
+
+		DX::AudioVoiceHandle handles[3];
+		for (auto& handle : handles)
+		{
+			handle = mixer.Play(sound.m_sound, 0, 1.0f, 0.0f);
+			CHECK(handle.IsValid());
+		}
+		CHECK(!mixer.Play(sound.m_sound, 0, 1.0f, 0.0f).IsValid());
+		CHECK(mixer.GetActiveVoiceCount() == 3);
+
+		// Paused output is silence, and the voices carry on from the same place afterwards.
+		std::vector<ReferencePlay> plays(3);
+		for (auto& play : plays)
+		{
+			play.m_sound = &sound;
+			play.m_frames = ReferenceFrames(sound.m_sound, 0);
+			play.m_next = 0;
+			ReferenceGains(1, 1.0f, 0.0f, play.m_left, play.m_right);
+		}
+
+		std::vector<float> output(20 * 2);
+		std::vector<float> expected;
+		mixer.Render(output.data(), 10);
+		ReferenceMix(plays, expected, 10);
+		CHECK(IsClose(output[18], expected[18]));
+
+		mixer.Pause();
+		mixer.Render(output.data(), 20);
+		for (auto sample : output)
+		{
+			CHECK(sample == 0.0f);
+		}
+
+		mixer.Resume();
+		mixer.Stop(handles[1]);
+		plays.erase(plays.begin() + 1);
+		mixer.Render(output.data(), 20);
+		ReferenceMix(plays, expected, 20);
+		for (size_t i = 0; i < output.size(); i++)
+		{
+			CHECK(IsClose(output[i], expected[i]));
+		}
+
+		// The stopped voice is reused with a new generation, so its old handle no longer does anything.
+		mixer.Update();
+		CHECK(!mixer.IsPlaying(handles[1]));
+		auto reused = mixer.Play(sound.m_sound, 0, 1.0f, 0.0f);
+		CHECK(reused.IsValid() && reused.m_index == handles[1].m_index && reused.m_generation != handles[1].m_generation);
+		mixer.Stop(handles[1]);
+		mixer.SetVolumeAndPan(handles[1], 0.0f, 0.0f);
+		CHECK(mixer.IsPlaying(reused));
+
+		mixer.Render(output.data(), 20);
+		mixer.Update();
+		CHECK(mixer.IsPlaying(reused));
+
+		// The other two have reached the end of the sound by now.
+		CHECK(mixer.GetActiveVoiceCount() == 1);
+	}
+
+	// More commands than the ring holds between two Render calls are kept in order and applied later.
+	void TestCommandOverflow()
+	{
+		std::vector<float> ones(100000, 1.0f);
+		DX::AudioSound sound = {};
+		sound.m_data = ones.data();
+		sound.m_frameCount = 100000;
+		sound.m_channels = 2;
+		sound.m_sampleRate = SampleRate;
+		sound.m_sampleType = DX::AudioSampleType::Float32;
+
+		DX::SoftwareMixer mixer(SampleRate, 2);
+		auto handle = mixer.Play(sound, 0, 1.0f, 0.0f);
+		for (uint32_t i = 1; i <= 100; i++)
+		{
+			mixer.SetVolumeAndPan(handle, i / 100.0f, 0.0f);
+		}
+
+		// Each Update moves what fits into the ring; the last change wins once all of them have been through.
+		std::vector<float> output(8 * 2);
+		for (uint32_t i = 0; i < 100; i++)
+		{
+			mixer.Render(output.data(), 8);
+			mixer.Update();
+		}
+		CHECK(IsClose(output[14], 1.0f) && IsClose(output[15], 1.0f));
+
+		mixer.SetVolumeAndPan(handle, 0.25f, 0.0f);
+		for (uint32_t i = 0; i < 100; i++)
+		{
+			mixer.SetMasterVolume(1.0f);
+		}
+		mixer.SetMasterVolume(2.0f);
+		for (uint32_t i = 0; i < 100; i++)
+		{
+			mixer.Render(output.data(), 8);
+			mixer.Update();
+		}
+		CHECK(IsClose(output[14], 0.5f) && IsClose(output[15], 0.5f));
+	}
+
+	// Random plays of random sounds at constant gains, rendered in random sized pieces.
+	void TestRandomMixes()
+	{
+		PortableTests::Random random(25);
+		std::vector<TestSound> sounds(12);
+		for (uint32_t i = 0; i < sounds.size(); i++)
+		{
+			MakeSound(random, sounds[i], static_cast<uint32_t>(random.Range(1, 3000)), 1 + (i % 2),
+				(i % 4) < 2 ? DX::AudioSampleType::Int16 : DX::AudioSampleType::Float32);
+		}
+
+		for (uint32_t iteration = 0; iteration < 50; iteration++)
+		{
+			DX::SoftwareMixer mixer(SampleRate, 32);
+			std::vector<ReferencePlay> plays;
+			uint32_t playCount = static_cast<uint32_t>(random.Range(1, 32));
+			for (uint32_t i = 0; i < playCount; i++)
+			{
+				auto& sound = sounds[random.Range(0, static_cast<int32_t>(sounds.size()) - 1)];
+				sound.m_sound.m_loopBegin = static_cast<uint32_t>(random.Range(0, static_cast<int32_t>(sound.m_sound.m_frameCount) - 1));
+				sound.m_sound.m_loopLength = static_cast<uint32_t>(random.Range(0, static_cast<int32_t>(sound.m_sound.m_frameCount - sound.m_sound.m_loopBegin)));
+				uint32_t loopCount = static_cast<uint32_t>(random.Range(0, 3));
+				float volume = random.Range(0.0f, 1.0f);
+				float pan = random.Range(-1.0f, 1.0f);
+
+				CHECK(mixer.Play(sound.m_sound, loopCount, volume, pan).IsValid());
+
+				ReferencePlay play;
+				play.m_sound = &sound;
+				play.m_frames = ReferenceFrames(sound.m_sound, loopCount);
+				play.m_next = 0;
+				ReferenceGains(sound.m_sound.m_channels, volume, pan, play.m_left, play.m_right);
+				plays.push_back(play);
+			}
+
+			while (mixer.GetActiveVoiceCount() != 0)
+			{
+				uint32_t frameCount = static_cast<uint32_t>(random.Range(1, 700));
+				std::vector<float> output(static_cast<size_t>(frameCount) * 2);
+				std::vector<float> expected;
+				mixer.Render(output.data(), frameCount);
+				ReferenceMix(plays, expected, frameCount);
+				for (size_t i = 0; i < output.size(); i++)
+				{
+					CHECK(IsClose(output[i], expected[i], 1.0e-4f));
+				}
+				mixer.Update();
+			}
+		}
+	}
+
+	// Render on its own thread, as an audio device callback would, while the game thread plays, changes and stops voices.
+	void TestRenderThread()
+	{
+		PortableTests::Random random(26);
+		TestSound sound;
+		MakeSound(random, sound, 500, 2, DX::AudioSampleType::Int16);
+
+		DX::SoftwareMixer mixer(SampleRate, 16);
+		std::atomic<bool> done(false);
+		std::atomic<bool> finite(true);
+		std::thread renderThread([&]()
+		{
+			std::vector<float> output(256 * 2);
+			while (!done.load())
+			{
+				mixer.Render(output.data(), 256);
+				for (auto sample : output)
+				{
+					// Each voice adds at most 1 per channel.
+					if (!(std::fabs(sample) <= 16.0f))
+					{
+						finite.store(false);
+					}
+				}
+			}
+		});
+
+		std::vector<DX::AudioVoiceHandle> handles;
+		for (uint32_t i = 0; i < 20000; i++)
+		{
+			mixer.Update();
+			switch (random.Range(0, 3))
+			{
+			case 0:
+				{
+					auto handle = mixer.Play(sound.m_sound, random.Range(0, 4) == 0 ? DX::IAudioBackend::LoopInfinite : 0, 1.0f, 0.0f);
+					if (handle.IsValid())
+					{
+						handles.push_back(handle);
+					}
+				}
+				break;
+
+			case 1:
+				if (!handles.empty())
+				{
+					mixer.Stop(handles[random.Range(0, static_cast<int32_t>(handles.size()) - 1)]);
+				}
+				break;
+
+			case 2:
+				if (!handles.empty())
+				{
+					mixer.SetVolumeAndPan(handles[random.Range(0, static_cast<int32_t>(handles.size()) - 1)], random.Range(0.0f, 1.0f),
+						random.Range(-1.0f, 1.0f));
+				}
+				break;
+
+			default:
+				std::this_thread::yield();
+				break;
+			}
+		}
+
+		for (auto& handle : handles)
+		{
+			mixer.Stop(handle);
+		}
+
+		// Every voice comes back once Render has seen the stops.
+		for (uint32_t i = 0; i < 100000 && mixer.GetActiveVoiceCount() != 0; i++)
+		{
+			mixer.Update();
+			std::this_thread::yield();
+		}
+		done.store(true);
+		renderThread.join();
+
+		CHECK(mixer.GetActiveVoiceCount() == 0);
+		CHECK(finite.load());
+	}
+}
+
+int main()
+{
+	TestPanAndSampleTypes();
+	TestLoops();
+	TestGainRamps();
+	TestPauseAndVoices();
+	TestCommandOverflow();
+	TestRandomMixes();
+	TestRenderThread();
+
+	return PortableTests::Finish("SoftwareMixerTests");
+}
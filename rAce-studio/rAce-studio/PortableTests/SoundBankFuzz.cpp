@@ -0,0 +1,217 @@
+// Fuzzes DX::SoundBank::LoadFromMemory. Every input is copied into a heap block of exactly its size (which new aligns well past the 8 bytes that
+// LoadFromMemory needs) so that a sanitized build (PORTABLE_TESTS_SANITIZE) catches any read past the end, and every entry of a bank that loads
+// is checked to lie within the input and to be found by Find. As a ctest test it runs a fixed number of deterministic mutations (truncations,
+// bit flips, interesting offsets and sizes, and swapped or duplicated entries) of a few valid banks. Configured with -DPORTABLE_TESTS_LIBFUZZER=ON
+// (Clang only) it is built as a libFuzzer target instead; pass it a directory to use as the corpus.
+
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "SoundBank.h"
+#include "TestHelpers.h"
+
+namespace
+{
+	// Loads a copy of the input and checks the result.
+	void LoadAndCheck(const uint8_t* input, size_t size)
+	{
+		std::unique_ptr<uint8_t[]> data(new uint8_t[size + (size == 0 ? 1 : 0)]);
+		if (size != 0)
+		{
+			memcpy(data.get(), input, size);
+		}
+		auto begin = data.get();
+
+		DX::SoundBank bank;
+		if (!bank.LoadFromMemory(begin, size))
+		{
+			CHECK(bank.GetEntryCount() == 0);
+			return;
+		}
+
+		uint32_t sum = 0;
+		for (uint32_t index = 0; index < bank.GetEntryCount(); index++)
+		{
+			const auto& entry = bank.GetEntry(index);
+			CHECK(reinterpret_cast<const uint8_t*>(&entry) >= begin && reinterpret_cast<const uint8_t*>(&entry + 1) <= begin + size);
+			CHECK(index == 0 || bank.GetEntry(index - 1).m_nameHash < entry.m_nameHash);
+			CHECK(static_cast<uint64_t>(entry.m_nameOffset) + (static_cast<uint64_t>(entry.m_nameLength) * 2) <= size);
+			CHECK(entry.m_formatSize >= 16 && static_cast<uint64_t>(entry.m_formatOffset) + entry.m_formatSize <= size);
+			CHECK(static_cast<uint64_t>(entry.m_dataOffset) + entry.m_dataSize <= size);
+			CHECK((entry.m_dataOffset % DX::SoundBankDataAlignment) == 0);
+			CHECK(entry.m_loopBegin <= 0xFFFFFFFFU - entry.m_loopLength);
+			CHECK(bank.GetFormat(index)[12] != 0 || bank.GetFormat(index)[13] != 0);
+
+			uint32_t found = 0;
+			CHECK(bank.Find(entry.m_nameHash, found) && found == index);
+
+			// Touch every byte that the entry points at so that the sanitizer sees any range that is wrong.
+			auto name = reinterpret_cast<const uint8_t*>(bank.GetName(index));
+			for (uint32_t i = 0; i < entry.m_nameLength * 2; i++)
+			{
+				sum += name[i];
+			}
+			for (uint32_t i = 0; i < entry.m_formatSize; i++)
+			{
+				sum += bank.GetFormat(index)[i];
+			}
+			for (uint32_t i = 0; i < entry.m_dataSize; i++)
+			{
+				sum += bank.GetAudioData(index)[i];
+			}
+		}
+		volatile uint32_t sink = sum;
+		(void)sink;
+	}
+
+	// Builds a bank of count sounds with formatSize byte formats and dataSize bytes of audio data each (the last one gets a byte more so that the
+	// file ends with audio data).
+	std::vector<uint8_t> MakeBank(uint32_t count, uint32_t formatSize, uint32_t dataSize)
+	{
+		std::vector<DX::SoundBankSource> sources(count);
+		for (uint32_t i = 0; i < count; i++)
+		{
+			auto& source = sources[i];
+			source.m_name = L"sound" + std::to_wstring(i) + L".wav";
+			source.m_format.assign(formatSize, 0);
+			source.m_format[0] = 1;
+			source.m_format[2] = 1;
+			source.m_format[12] = 2;
+			source.m_format[14] = 16;
+			source.m_audioData.assign(dataSize + ((i + 1 == count) ? 1U : 0U), static_cast<uint8_t>(i));
+			source.m_loopBegin = (i % 2 == 0) ? i : 0;
+			source.m_loopLength = (i % 2 == 0) ? dataSize / 4 : 0;
+		}
+
+		std::vector<uint8_t> data;
+		CHECK(DX::SoundBank::SaveToMemory(sources, data));
+		return data;
+	}
+
+	// The offset of the first entry, and the size of each.
+	const size_t EntriesOffset = sizeof(DX::SoundBankFileHeader);
+	const size_t EntrySize = sizeof(DX::SoundBankEntry);
+
+	// Applies one random mutation.
+	void Mutate(PortableTests::Random& random, std::vector<uint8_t>& file)
+	{
+		switch (random.Range(0, 5))
+		{
+		case 0:
+			// Truncate.
+			file.resize(static_cast<size_t>(random.Range(0, static_cast<int32_t>(file.size()))));
+			break;
+
+		case 1:
+			// Flip some bits.
+			for (int flips = random.Range(1, 8); flips > 0 && !file.empty(); flips--)
+			{
+				file[static_cast<size_t>(random.Range(0, static_cast<int32_t>(file.size()) - 1))] ^= static_cast<uint8_t>(1 << random.Range(0, 7));
+			}
+			break;
+
+		case 2:
+			// Overwrite a 32-bit field of the header or an entry (most likely an offset or a size) with something interesting.
+			if (file.size() >= EntriesOffset)
+			{
+				const uint32_t values[] =
+				{
+					0, 1, 2, 8, 16, 64, static_cast<uint32_t>(file.size()), static_cast<uint32_t>(file.size()) - 1, static_cast<uint32_t>(file.size()) - 64,
+					0x7FFFFFFF, 0x80000000, 0xFFFFFFC0, 0xFFFFFFFF, random.Next()
+				};
+				auto value = values[random.Range(0, 13)];
+				auto fieldCount = static_cast<int32_t>(file.size() / 4);
+				auto field = static_cast<size_t>(random.Range(0, fieldCount < 64 ? fieldCount - 1 : 63));
+				memcpy(&file[field * 4], &value, 4);
+			}
+			break;
+
+		case 3:
+			// Swap two entries, which breaks the order of the hashes.
+			if (file.size() >= EntriesOffset + (2 * EntrySize))
+			{
+				uint32_t count;
+				memcpy(&count, &file[8], 4);
+				auto available = static_cast<uint32_t>((file.size() - EntriesOffset) / EntrySize);
+				count = (count < available) ? count : available;
+				if (count >= 2)
+				{
+					auto first = EntriesOffset + (static_cast<size_t>(random.Range(0, static_cast<int32_t>(count) - 1)) * EntrySize);
+					auto second = EntriesOffset + (static_cast<size_t>(random.Range(0, static_cast<int32_t>(count) - 1)) * EntrySize);
+					for (size_t i = 0; i < EntrySize; i++)
+					{
+						std::swap(file[first + i], file[second + i]);
+					}
+				}
+			}
+			break;
+
+		case 4:
+			// Copy one entry over another (e.g. two entries with the same hash, or one pointing at another's data).
+			if (file.size() >= EntriesOffset + (2 * EntrySize))
+			{
+				auto available = static_cast<int32_t>((file.size() - EntriesOffset) / EntrySize);
+				auto from = EntriesOffset + (static_cast<size_t>(random.Range(0, available - 1)) * EntrySize);
+				auto to = EntriesOffset + (static_cast<size_t>(random.Range(0, available - 1)) * EntrySize);
+				memmove(&file[to], &file[from], EntrySize);
+			}
+			break;
+
+		default:
+			// Change the entry count.
+			if (file.size() >= EntriesOffset)
+			{
+				auto count = static_cast<uint32_t>(random.Range(0, 12));
+				memcpy(&file[8], &count, 4);
+			}
+			break;
+		}
+	}
+}
+
+extern "C" int LLVMFuzzerTestOneInput(const uint8_t* data, size_t size)
+{
+	LoadAndCheck(data, size);
+	return 0;
+}
+
+#ifndef PORTABLE_TESTS_LIBFUZZER
+int main()
+{
+	std::vector<std::vector<uint8_t>> seeds;
+	seeds.push_back(MakeBank(0, 16, 0));
+	seeds.push_back(MakeBank(1, 16, 100));
+	seeds.push_back(MakeBank(3, 18, 64));
+	seeds.push_back(MakeBank(8, 50, 33));
+
+	// The seeds themselves load, and no truncation of them does (each one ends with audio data).
+	for (const auto& seed : seeds)
+	{
+		DX::SoundBank bank;
+		std::unique_ptr<uint8_t[]> copy(new uint8_t[seed.size()]);
+		memcpy(copy.get(), seed.data(), seed.size());
+		CHECK(bank.LoadFromMemory(copy.get(), seed.size()));
+		for (size_t size = 0; size < seed.size(); size++)
+		{
+			CHECK(!bank.LoadFromMemory(copy.get(), size));
+			LoadAndCheck(seed.data(), size);
+		}
+	}
+
+	PortableTests::Random random(17);
+	for (int iteration = 0; iteration < 200000; iteration++)
+	{
+		auto file = seeds[static_cast<size_t>(random.Range(0, static_cast<int32_t>(seeds.size()) - 1))];
+		for (int mutations = random.Range(1, 4); mutations > 0; mutations--)
+		{
+			Mutate(random, file);
+		}
+		LoadAndCheck(file.data(), file.size());
+	}
+
+	return PortableTests::Finish("SoundBankFuzz");
+}
+#endif
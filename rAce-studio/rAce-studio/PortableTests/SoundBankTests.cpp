@@ -0,0 +1,336 @@
+// Round trips sounds through the same steps as SoundBankBuilder and AudioEngine::LoadSoundBank: WAV files are parsed with DX::ParseWaveFile and
+// turned into sound bank sources the way SoundBankBuilder's ReadWaveFile does it (which can't be built here since it finds the files with Win32),
+// packed with DX::SoundBank::SaveToMemory, and then read back with LoadFromMemory and Find. Every name, format, loop and byte of audio data must
+// come back unchanged, every offset must have its documented alignment, and saving what was loaded must give the same sounds again.
+
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <vector>
+
+#include "AdpcmDecoder.h"
+#include "SoundBank.h"
+#include "TestHelpers.h"
+#include "WaveFile.h"
+
+namespace
+{
+	void Append16(std::vector<uint8_t>& data, uint16_t value)
+	{
+		data.push_back(static_cast<uint8_t>(value));
+		data.push_back(static_cast<uint8_t>(value >> 8));
+	}
+
+	void Append32(std::vector<uint8_t>& data, uint32_t value)
+	{
+		Append16(data, static_cast<uint16_t>(value));
+		Append16(data, static_cast<uint16_t>(value >> 16));
+	}
+
+	void AppendChunk(std::vector<uint8_t>& file, const char* id, const std::vector<uint8_t>& contents)
+	{
+		file.insert(file.end(), id, id + 4);
+		Append32(file, static_cast<uint32_t>(contents.size()));
+		file.insert(file.end(), contents.begin(), contents.end());
+		if ((contents.size() & 1) != 0)
+		{
+			file.push_back(0);
+		}
+	}
+
+	// Builds a 'fmt ' chunk. extra is appended after the 16 bytes of a PCMWAVEFORMAT, so pass the cbSize and the extension (if any) in it.
+	std::vector<uint8_t> MakeFormat(uint16_t formatTag, uint16_t channels, uint16_t blockAlign, uint16_t bitsPerSample, const std::vector<uint8_t>& extra)
+	{
+		std::vector<uint8_t> format;
+		Append16(format, formatTag);
+		Append16(format, channels);
+		Append32(format, 44100);
+		Append32(format, 44100U * blockAlign);
+		Append16(format, blockAlign);
+		Append16(format, bitsPerSample);
+		format.insert(format.end(), extra.begin(), extra.end());
+		return format;
+	}
+
+	// Builds a WAV file with random audio data and, if loopLength isn't zero, a 'smpl' chunk with one loop.
+	std::vector<uint8_t> MakeWaveFile(PortableTests::Random& random, const std::vector<uint8_t>& format, uint32_t dataSize, uint32_t loopBegin,
+		uint32_t loopLength)
+	{
+		// The RIFF size is filled in at the end.
+		const uint8_t header[12] = { 'R', 'I', 'F', 'F', 0, 0, 0, 0, 'W', 'A', 'V', 'E' };
+		std::vector<uint8_t> file(header, header + sizeof(header));
+		AppendChunk(file, "fmt ", format);
+
+		if (loopLength != 0)
+		{
+			std::vector<uint8_t> sample(36, 0);
+			sample[28] = 1;
+			Append32(sample, 0);
+			Append32(sample, 0);
+			Append32(sample, loopBegin);
+			Append32(sample, loopBegin + loopLength - 1);
+			Append32(sample, 0);
+			Append32(sample, 0);
+			AppendChunk(file, "smpl", sample);
+		}
+
+		std::vector<uint8_t> data(dataSize);
+		for (auto& byte : data)
+		{
+			byte = static_cast<uint8_t>(random.Next() >> 24);
+		}
+		AppendChunk(file, "data", data);
+
+		auto riffSize = static_cast<uint32_t>(file.size() - 8);
+		memcpy(&file[4], &riffSize, 4);
+		return file;
+	}
+
+	// Turns a WAV file into a sound bank source with the same checks as SoundBankBuilder's ReadWaveFile. Returns false if the builder would
+	// reject the file.
+	bool ReadWaveFile(const std::vector<uint8_t>& file, DX::SoundBankSource& source)
+	{
+		DX::WaveFileView wave;
+		if (!DX::ParseWaveFile(file.data(), file.size(), wave))
+		{
+			return false;
+		}
+
+		if (wave.m_formatTag == DX::WaveFormatMsAdpcm || wave.m_formatTag == DX::WaveFormatImaAdpcm)
+		{
+			DX::AdpcmFormat format;
+			if (!DX::ParseAdpcmFormat(wave.m_format, wave.m_formatSize, format))
+			{
+				return false;
+			}
+		}
+		else if (wave.m_formatTag != 1 && wave.m_formatTag != 3 && wave.m_formatTag != 0xFFFE)
+		{
+			return false;
+		}
+
+		source.m_format.assign(wave.m_format, wave.m_format + wave.m_formatSize);
+		source.m_audioData.assign(wave.m_audioData, wave.m_audioData + wave.m_audioDataSize);
+		source.m_loopBegin = wave.m_loopBegin;
+		source.m_loopLength = wave.m_loopLength;
+		return true;
+	}
+
+	// A copy of a file in memory that is aligned the way that a memory mapped view is.
+	class AlignedFile
+	{
+	public:
+		explicit AlignedFile(const std::vector<uint8_t>& data) :
+			m_words((data.size() + 7) / 8 + 1),
+			m_size(data.size())
+		{
+			if (!data.empty())
+			{
+				memcpy(m_words.data(), data.data(), data.size());
+			}
+		}
+
+		const uint8_t* GetData() const { return reinterpret_cast<const uint8_t*>(m_words.data()); }
+
+		size_t GetSize() const { return m_size; }
+
+	private:
+		std::vector<uint64_t>		m_words;
+		size_t						m_size;
+	};
+
+	// Returns true if a bank name (UTF-16 code units) is the same as a source name.
+	bool IsSameName(const uint16_t* name, uint32_t length, const std::wstring& expected)
+	{
+		if (length != expected.size())
+		{
+			return false;
+		}
+
+		for (uint32_t i = 0; i < length; i++)
+		{
+			if (name[i] != static_cast<uint16_t>(expected[i]))
+			{
+				return false;
+			}
+		}
+		return true;
+	}
+
+	// Builds the sounds that the round trip uses: PCM, float, extensible and IMA ADPCM, with and without loops, with odd and empty data, and with
+	// names in subdirectories and outside of ASCII. The last one has data so that the file ends with audio data.
+	void MakeSources(PortableTests::Random& random, std::vector<DX::SoundBankSource>& sources)
+	{
+		std::vector<uint8_t> noExtra;
+		std::vector<uint8_t> emptyExtra(2, 0);
+		std::vector<uint8_t> extensible(2, 0);
+		extensible[0] = 22;
+		extensible.resize(2 + 22, 0);
+		std::vector<uint8_t> imaAdpcm;
+		Append16(imaAdpcm, 2);
+		Append16(imaAdpcm, 65);
+
+		struct Sound
+		{
+			const wchar_t*			m_name;
+			std::vector<uint8_t>	m_format;
+			uint32_t				m_dataSize;
+			uint32_t				m_loopBegin;
+			uint32_t				m_loopLength;
+		};
+
+		const Sound sounds[] =
+		{
+			{ L"laser.wav", MakeFormat(1, 1, 2, 16, noExtra), 2000, 100, 500 },
+			{ L"somedir\\ball drop.wav", MakeFormat(1, 2, 4, 16, emptyExtra), 4001, 0, 0 },
+			{ L"Music\\Theme.wav", MakeFormat(3, 2, 8, 32, emptyExtra), 8000, 0, 1000 },
+			{ L"surround.wav", MakeFormat(0xFFFE, 6, 12, 16, extensible), 1200, 0, 0 },
+			{ L"empty.wav", MakeFormat(1, 1, 1, 8, noExtra), 0, 0, 0 },
+			{ L"\u00E9t\u00E9\\\u97F3.wav", MakeFormat(1, 1, 2, 16, noExtra), 63, 0, 0 },
+			{ L"ima.wav", MakeFormat(DX::WaveFormatImaAdpcm, 1, 36, 4, imaAdpcm), 36 * 10, 65, 130 }
+		};
+
+		for (const auto& sound : sounds)
+		{
+			DX::SoundBankSource source;
+			source.m_name = sound.m_name;
+			CHECK(ReadWaveFile(MakeWaveFile(random, sound.m_format, sound.m_dataSize, sound.m_loopBegin, sound.m_loopLength), source));
+			CHECK(source.m_loopBegin == (sound.m_loopLength != 0 ? sound.m_loopBegin : 0));
+			CHECK(source.m_loopLength == sound.m_loopLength);
+			sources.push_back(source);
+		}
+	}
+
+	// Saves the sources, loads the bank, and checks every sound.
+	void TestRoundTrip()
+	{
+		PortableTests::Random random(17);
+		std::vector<DX::SoundBankSource> sources;
+		MakeSources(random, sources);
+
+		std::vector<uint8_t> data;
+		CHECK(DX::SoundBank::SaveToMemory(sources, data));
+		AlignedFile file(data);
+
+		DX::SoundBank bank;
+		CHECK(bank.LoadFromMemory(file.GetData(), file.GetSize()));
+		CHECK(bank.GetEntryCount() == sources.size());
+
+		for (uint32_t index = 1; index < bank.GetEntryCount(); index++)
+		{
+			CHECK(bank.GetEntry(index - 1).m_nameHash < bank.GetEntry(index).m_nameHash);
+		}
+
+		for (const auto& source : sources)
+		{
+			// Names are found whatever their case and whichever slash they use.
+			std::wstring otherName(source.m_name);
+			for (auto& ch : otherName)
+			{
+				ch = (ch == L'\\') ? L'/' : ((ch >= L'a' && ch <= L'z') ? static_cast<wchar_t>(ch - L'a' + L'A') : ch);
+			}
+			uint32_t index = 0;
+			uint32_t otherIndex = 0;
+			CHECK(bank.Find(DX::HashSoundName(source.m_name.c_str(), source.m_name.size()), index));
+			CHECK(bank.Find(DX::HashSoundName(otherName.c_str(), otherName.size()), otherIndex));
+			CHECK(index == otherIndex);
+
+			const auto& entry = bank.GetEntry(index);
+			CHECK(IsSameName(bank.GetName(index), entry.m_nameLength, source.m_name));
+			CHECK(entry.m_formatSize == source.m_format.size());
+			CHECK(memcmp(bank.GetFormat(index), source.m_format.data(), source.m_format.size()) == 0);
+			CHECK(entry.m_dataSize == source.m_audioData.size());
+			CHECK(source.m_audioData.empty() || memcmp(bank.GetAudioData(index), source.m_audioData.data(), source.m_audioData.size()) == 0);
+			CHECK(entry.m_loopBegin == source.m_loopBegin && entry.m_loopLength == source.m_loopLength);
+			CHECK((entry.m_formatOffset % 8) == 0);
+			CHECK((entry.m_dataOffset % DX::SoundBankDataAlignment) == 0);
+			CHECK((reinterpret_cast<uintptr_t>(bank.GetAudioData(index)) % 8) == 0);
+
+		}
+
+		const wchar_t missing[] = L"missing.wav";
+		uint32_t index = 0;
+		CHECK(!bank.Find(DX::HashSoundName(missing, 11), index));
+
+		// Saving the loaded sounds again (in the bank's order) gives a bank of the same size with the same sounds.
+		std::vector<DX::SoundBankSource> loaded(bank.GetEntryCount());
+		for (uint32_t i = 0; i < bank.GetEntryCount(); i++)
+		{
+			const auto& entry = bank.GetEntry(i);
+			for (uint32_t j = 0; j < entry.m_nameLength; j++)
+			{
+				loaded[i].m_name.push_back(static_cast<wchar_t>(bank.GetName(i)[j]));
+			}
+			loaded[i].m_format.assign(bank.GetFormat(i), bank.GetFormat(i) + entry.m_formatSize);
+			loaded[i].m_audioData.assign(bank.GetAudioData(i), bank.GetAudioData(i) + entry.m_dataSize);
+			loaded[i].m_loopBegin = entry.m_loopBegin;
+			loaded[i].m_loopLength = entry.m_loopLength;
+		}
+		std::vector<uint8_t> resaved;
+		CHECK(DX::SoundBank::SaveToMemory(loaded, resaved));
+		CHECK(resaved.size() == data.size());
+
+		AlignedFile resavedFile(resaved);
+		DX::SoundBank resavedBank;
+		CHECK(resavedBank.LoadFromMemory(resavedFile.GetData(), resavedFile.GetSize()));
+		CHECK(resavedBank.GetEntryCount() == bank.GetEntryCount());
+		for (uint32_t i = 0; i < bank.GetEntryCount() && i < resavedBank.GetEntryCount(); i++)
+		{
+			const auto& entry = bank.GetEntry(i);
+			const auto& resavedEntry = resavedBank.GetEntry(i);
+			CHECK(resavedEntry.m_nameHash == entry.m_nameHash);
+			CHECK(resavedEntry.m_dataSize == entry.m_dataSize && resavedEntry.m_formatSize == entry.m_formatSize);
+			CHECK(memcmp(resavedBank.GetAudioData(i), bank.GetAudioData(i), entry.m_dataSize) == 0);
+			CHECK(memcmp(resavedBank.GetFormat(i), bank.GetFormat(i), entry.m_formatSize) == 0);
+		}
+	}
+
+	// Banks that SaveToMemory refuses to build or LoadFromMemory refuses to use.
+	void TestRejected()
+	{
+		PortableTests::Random random(23);
+		std::vector<DX::SoundBankSource> sources;
+		MakeSources(random, sources);
+
+		// Two names with the same hash (they only differ by case and slash).
+		auto duplicates = sources;
+		duplicates.push_back(sources[1]);
+		duplicates.back().m_name = L"SomeDir/Ball Drop.WAV";
+		std::vector<uint8_t> data;
+		CHECK(!DX::SoundBank::SaveToMemory(duplicates, data));
+
+		// An empty bank is fine.
+		std::vector<DX::SoundBankSource> none;
+		CHECK(DX::SoundBank::SaveToMemory(none, data));
+		AlignedFile emptyFile(data);
+		DX::SoundBank bank;
+		CHECK(bank.LoadFromMemory(emptyFile.GetData(), emptyFile.GetSize()));
+		CHECK(bank.GetEntryCount() == 0);
+		uint32_t index = 0;
+		CHECK(!bank.Find(0, index));
+
+		// The data must be aligned like a mapped view, and every truncation of a bank that ends with audio data is rejected.
+		CHECK(DX::SoundBank::SaveToMemory(sources, data));
+		std::vector<uint8_t> shifted(1, 0);
+		shifted.insert(shifted.end(), data.begin(), data.end());
+		AlignedFile shiftedFile(shifted);
+		CHECK(!bank.LoadFromMemory(shiftedFile.GetData() + 1, data.size()));
+		CHECK(bank.GetEntryCount() == 0);
+
+		AlignedFile file(data);
+		CHECK(!bank.LoadFromMemory(nullptr, data.size()));
+		for (size_t size = 0; size < data.size(); size++)
+		{
+			CHECK(!bank.LoadFromMemory(file.GetData(), size));
+		}
+		CHECK(bank.LoadFromMemory(file.GetData(), data.size()));
+	}
+}
+
+int main()
+{
+	TestRoundTrip();
+	TestRejected();
+
+	return PortableTests::Finish("SoundBankTests");
+}
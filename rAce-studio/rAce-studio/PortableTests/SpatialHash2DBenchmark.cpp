@@ -0,0 +1,122 @@
+// Measures a frame of DX::SpatialHash2D at 1k, 10k and 100k moving sprites: Clear, Add every sprite's bounds and FindPairs, the way the game
+// rebuilds the broad phase each frame. The sprites are 16 to 48 units across and move a few units a frame in a world whose area grows with the
+// sprite count, so each sprite overlaps a few others whatever the count. The brute force test of every pair is shown at 1k for comparison.
+// Run a release build. Usage: SpatialHash2DBenchmark
+
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <vector>
+
+#include "SpatialHash2D.h"
+#include "TestHelpers.h"
+
+namespace
+{
+	const uint32_t FrameCount = 50;
+	const float CellSize = 64.0f;
+
+	struct MovingSprite
+	{
+		float					m_x;
+		float					m_y;
+		float					m_velocityX;
+		float					m_velocityY;
+		float					m_size;
+	};
+
+	// Moves each sprite one frame, bouncing off the edges of the world.
+	void Move(std::vector<MovingSprite>& sprites, float worldSize)
+	{
+		for (auto& sprite : sprites)
+		{
+			sprite.m_x += sprite.m_velocityX;
+			sprite.m_y += sprite.m_velocityY;
+			if (sprite.m_x < 0.0f || sprite.m_x + sprite.m_size > worldSize)
+			{
+				sprite.m_velocityX = -sprite.m_velocityX;
+			}
+			if (sprite.m_y < 0.0f || sprite.m_y + sprite.m_size > worldSize)
+			{
+				sprite.m_velocityY = -sprite.m_velocityY;
+			}
+		}
+	}
+}
+
+int main()
+{
+	PortableTests::Random random(4);
+
+	const uint32_t spriteCounts[] = { 1000, 10000, 100000 };
+	for (auto spriteCount : spriteCounts)
+	{
+		// About 40 units of world per sprite in each direction.
+		float worldSize = 40.0f * std::sqrt(static_cast<float>(spriteCount)) * 2.0f;
+		std::vector<MovingSprite> sprites(spriteCount);
+		for (auto& sprite : sprites)
+		{
+			sprite.m_size = random.Range(16.0f, 48.0f);
+			sprite.m_x = random.Range(0.0f, worldSize - sprite.m_size);
+			sprite.m_y = random.Range(0.0f, worldSize - sprite.m_size);
+			sprite.m_velocityX = random.Range(-4.0f, 4.0f);
+			sprite.m_velocityY = random.Range(-4.0f, 4.0f);
+		}
+
+		DX::SpatialHash2D hash(CellSize);
+		hash.Reserve(spriteCount);
+		std::vector<DX::CollisionPair> pairs;
+		size_t pairCount = 0;
+
+		// The first frame allocates the hash's memory, which later frames reuse.
+		double bestTime = 1.0e30;
+		double totalTime = 0.0;
+		for (uint32_t frame = 0; frame <= FrameCount; frame++)
+		{
+			Move(sprites, worldSize);
+
+			double start = PortableTests::Seconds();
+			hash.Clear();
+			for (auto& sprite : sprites)
+			{
+				hash.Add(sprite.m_x, sprite.m_y, sprite.m_x + sprite.m_size, sprite.m_y + sprite.m_size);
+			}
+			hash.FindPairs(pairs);
+			double time = PortableTests::Seconds() - start;
+
+			if (frame != 0)
+			{
+				bestTime = time < bestTime ? time : bestTime;
+				totalTime += time;
+				pairCount += pairs.size();
+			}
+		}
+
+		printf("%6u sprites: %8.3f ms per frame (best %8.3f ms), %7.1f pairs per frame\n", spriteCount, totalTime * 1000.0 / FrameCount,
+			bestTime * 1000.0, static_cast<double>(pairCount) / FrameCount);
+
+		if (spriteCount == 1000)
+		{
+			// Every pair, the way the game tested them before there was a broad phase.
+			double start = PortableTests::Seconds();
+			size_t bruteForcePairs = 0;
+			for (uint32_t frame = 0; frame < FrameCount; frame++)
+			{
+				for (uint32_t one = 0; one < spriteCount; one++)
+				{
+					auto& a = sprites[one];
+					for (uint32_t two = one + 1; two < spriteCount; two++)
+					{
+						auto& b = sprites[two];
+						bruteForcePairs += (a.m_x <= b.m_x + b.m_size && b.m_x <= a.m_x + a.m_size && a.m_y <= b.m_y + b.m_size &&
+							b.m_y <= a.m_y + a.m_size) ? 1 : 0;
+					}
+				}
+			}
+			printf("%6u sprites: %8.3f ms per frame brute force, %7.1f pairs per frame\n", spriteCount,
+				(PortableTests::Seconds() - start) * 1000.0 / FrameCount, static_cast<double>(bruteForcePairs) / FrameCount);
+		}
+	}
+
+	return 0;
+}
@@ -0,0 +1,184 @@
+// Checks DX::SpatialHash2D::FindPairs against a brute force test of every pair of rectangles, for random rectangles at a spread of cell sizes:
+// from cells much larger than the rectangles down to cells so small that most rectangles touch more than MaxCellsPerSprite cells and are tested
+// outside of the grid. Also checks rectangles that only touch, empty and NaN rectangles, rectangles far outside the clamped cell range, that each
+// pair is reported once with the lower id first, and that a bad cell size is rejected.
+
+#include <algorithm>
+#include <cstdint>
+#include <limits>
+#include <stdexcept>
+#include <vector>
+
+#include "SpatialHash2D.h"
+#include "TestHelpers.h"
+
+namespace
+{
+	struct Bounds
+	{
+		float					Left;
+		float					Top;
+		float					Right;
+		float					Bottom;
+	};
+
+	bool IsLess(const DX::CollisionPair& one, const DX::CollisionPair& two)
+	{
+		return one.m_first < two.m_first || (one.m_first == two.m_first && one.m_second < two.m_second);
+	}
+
+	// Every pair of rectangles that overlap or touch, in order.
+	std::vector<DX::CollisionPair> ReferencePairs(const std::vector<Bounds>& bounds)
+	{
+		std::vector<DX::CollisionPair> pairs;
+		for (uint32_t one = 0; one < bounds.size(); one++)
+		{
+			for (uint32_t two = one + 1; two < bounds.size(); two++)
+			{
+				auto& a = bounds[one];
+				auto& b = bounds[two];
+				bool isEmpty = !(a.Left <= a.Right) || !(a.Top <= a.Bottom) || !(b.Left <= b.Right) || !(b.Top <= b.Bottom);
+				if (!isEmpty && a.Left <= b.Right && b.Left <= a.Right && a.Top <= b.Bottom && b.Top <= a.Bottom)
+				{
+					DX::CollisionPair pair = { one, two };
+					pairs.push_back(pair);
+				}
+			}
+		}
+
+		return pairs;
+	}
+
+	// Adds the rectangles to the hash and checks that it finds exactly the reference pairs, each once.
+	void CheckPairs(DX::SpatialHash2D& hash, const std::vector<Bounds>& bounds)
+	{
+		hash.Clear();
+		for (uint32_t i = 0; i < bounds.size(); i++)
+		{
+			CHECK(hash.Add(bounds[i]) == i);
+		}
+		CHECK(hash.GetCount() == bounds.size());
+
+		std::vector<DX::CollisionPair> pairs;
+		hash.FindPairs(pairs);
+		for (auto& pair : pairs)
+		{
+			CHECK(pair.m_first < pair.m_second);
+		}
+
+		std::sort(pairs.begin(), pairs.end(), IsLess);
+		auto expected = ReferencePairs(bounds);
+		CHECK(pairs.size() == expected.size());
+		for (size_t i = 0; i < pairs.size() && i < expected.size(); i++)
+		{
+			CHECK(pairs[i].m_first == expected[i].m_first && pairs[i].m_second == expected[i].m_second);
+		}
+	}
+
+	void TestRandom()
+	{
+		PortableTests::Random random(4);
+		const float cellSizes[] = { 1000.0f, 64.0f, 16.0f, 3.0f, 0.5f, 0.01f };
+		for (auto cellSize : cellSizes)
+		{
+			DX::SpatialHash2D hash(cellSize);
+			CHECK(hash.GetCellSize() == cellSize);
+			for (int iteration = 0; iteration < 20; iteration++)
+			{
+				std::vector<Bounds> bounds;
+				uint32_t count = static_cast<uint32_t>(random.Range(0, 300));
+				for (uint32_t i = 0; i < count; i++)
+				{
+					// Mostly sprite sized rectangles, some large ones, and some on a coarse grid so that edges line up exactly.
+					float width = random.Range(0, 9) == 0 ? random.Range(0.0f, 400.0f) : random.Range(0.0f, 40.0f);
+					float height = random.Range(0, 9) == 0 ? random.Range(0.0f, 400.0f) : random.Range(0.0f, 40.0f);
+					Bounds rectangle;
+					if (random.Range(0, 3) == 0)
+					{
+						rectangle.Left = static_cast<float>(random.Range(-20, 20) * 8);
+						rectangle.Top = static_cast<float>(random.Range(-20, 20) * 8);
+						width = static_cast<float>(random.Range(0, 4) * 8);
+						height = static_cast<float>(random.Range(0, 4) * 8);
+					}
+					else
+					{
+						rectangle.Left = random.Range(-500.0f, 500.0f);
+						rectangle.Top = random.Range(-500.0f, 500.0f);
+					}
+					rectangle.Right = rectangle.Left + width;
+					rectangle.Bottom = rectangle.Top + height;
+					bounds.push_back(rectangle);
+				}
+
+				CheckPairs(hash, bounds);
+			}
+		}
+	}
+
+	void TestSpecialRectangles()
+	{
+		const float infinity = std::numeric_limits<float>::infinity();
+		const float nan = std::numeric_limits<float>::quiet_NaN();
+
+		// Touching edges and corners overlap, the same as IsRectangleCollision.
+		DX::SpatialHash2D hash(10.0f);
+		std::vector<Bounds> bounds;
+		Bounds touching[] =
+		{
+			{ 0.0f, 0.0f, 10.0f, 10.0f }, { 10.0f, 0.0f, 20.0f, 10.0f }, { 20.0f, 10.0f, 30.0f, 20.0f }, { 5.0f, 10.0f, 5.0f, 10.0f },
+			{ 30.0001f, 0.0f, 40.0f, 5.0f }
+		};
+		bounds.assign(touching, touching + 5);
+		CheckPairs(hash, bounds);
+		std::vector<DX::CollisionPair> pairs;
+		hash.FindPairs(pairs);
+		CHECK(pairs.size() == 3);
+
+		// Empty rectangles (including the Left = +infinity, Right = -infinity of Rect::Empty) and NaNs get ids but never overlap anything, even
+		// an infinite rectangle.
+		Bounds special[] =
+		{
+			{ infinity, infinity, -infinity, -infinity }, { 0.0f, 0.0f, -1.0f, 5.0f }, { nan, 0.0f, 5.0f, 5.0f }, { 0.0f, 0.0f, 5.0f, nan },
+			{ -infinity, -infinity, infinity, infinity }, { 2.0f, 2.0f, 3.0f, 3.0f }
+		};
+		bounds.assign(special, special + 6);
+		CheckPairs(hash, bounds);
+		hash.FindPairs(pairs);
+		CHECK(pairs.size() == 1 && pairs[0].m_first == 4 && pairs[0].m_second == 5);
+
+		// Rectangles far outside the range of cell coordinates, and huge ones with tiny cells, which used to overflow the cell count.
+		DX::SpatialHash2D tinyCells(0.001f);
+		Bounds huge[] =
+		{
+			{ -1.0e30f, -1.0e30f, 1.0e30f, 1.0e30f }, { 1.0e20f, 1.0e20f, 1.0e20f, 1.0e20f }, { -3.0e9f, 0.0f, 3.0e9f, 1.0f },
+			{ -1.0e20f, -1.0e20f, -1.0e20f, -1.0e20f }, { 0.0f, 0.0f, 0.0005f, 0.0005f }, { 0.0f, 0.0f, 100.0f, 100.0f }
+		};
+		bounds.assign(huge, huge + 6);
+		CheckPairs(tinyCells, bounds);
+		CheckPairs(hash, bounds);
+
+		// Bad cell sizes are rejected.
+		const float badCellSizes[] = { 0.0f, -1.0f, nan };
+		for (auto cellSize : badCellSizes)
+		{
+			bool isThrown = false;
+			try
+			{
+				hash.SetCellSize(cellSize);
+			}
+			catch (const std::invalid_argument&)
+			{
+				isThrown = true;
+			}
+			CHECK(isThrown);
+		}
+	}
+}
+
+int main()
+{
+	TestRandom();
+	TestSpecialRectangles();
+
+	return PortableTests::Finish("SpatialHash2DTests");
+}
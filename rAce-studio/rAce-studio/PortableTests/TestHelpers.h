@@ -0,0 +1,78 @@
+#pragma once
+
+// Helpers shared by the portable tests and benchmarks. Each test is its own executable that returns a non-zero exit code if any check fails.
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+
+namespace PortableTests
+{
+	// The number of checks that have failed so far.
+	inline int& FailureCount()
+	{
+		static int failureCount = 0;
+		return failureCount;
+	}
+
+	inline void ReportFailure(const char* expression, const char* file, int line)
+	{
+		fprintf(stderr, "%s(%d): check failed: %s\n", file, line, expression);
+		FailureCount()++;
+	}
+
+	// Returns the exit code for main.
+	inline int Finish(const char* testName)
+	{
+		if (FailureCount() != 0)
+		{
+			fprintf(stderr, "%s: %d check(s) failed\n", testName, FailureCount());
+			return 1;
+		}
+
+		printf("%s: passed\n", testName);
+		return 0;
+	}
+
+	// A small, fast, deterministic random number generator (xorshift32) so that failures can be reproduced.
+	class Random
+	{
+	public:
+		explicit Random(uint32_t seed) :
+			m_state(seed != 0 ? seed : 1)
+		{
+		}
+
+		uint32_t Next()
+		{
+			m_state ^= m_state << 13;
+			m_state ^= m_state >> 17;
+			m_state ^= m_state << 5;
+			return m_state;
+		}
+
+		// Returns an integer in [low, high].
+		int32_t Range(int32_t low, int32_t high)
+		{
+			return low + static_cast<int32_t>(Next() % static_cast<uint32_t>(high - low + 1));
+		}
+
+		// Returns a real number in [low, high).
+		float Range(float low, float high)
+		{
+			return low + ((high - low) * static_cast<float>(Next() >> 8) / 16777216.0f);
+		}
+
+	private:
+		uint32_t				m_state;
+	};
+
+	// Returns the seconds since some arbitrary point. For benchmarks.
+	inline double Seconds()
+	{
+		return std::chrono::duration<double>(std::chrono::steady_clock::now().time_since_epoch()).count();
+	}
+}
+
+// Records a failure (and keeps going) if expression is false.
+#define CHECK(expression) \
+	((expression) ? static_cast<void>(0) : PortableTests::ReportFailure(#expression, __FILE__, __LINE__))
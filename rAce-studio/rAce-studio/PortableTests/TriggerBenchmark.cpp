@@ -0,0 +1,168 @@
+// Measures the cost of triggering thousands of sound effects per frame, the way AudioEngine does it, with the parts of the trigger path that
+// don't need XAudio2. AudioEngine itself can't be built here, so the benchmark has stand-ins for its containers:
+// - By name: the path from before SoundHandle. Each trigger looks its name up in a std::map with find and then again with operator[].
+// - By handle: the current path. GetSoundEffectHandle resolved each name once up front and each trigger indexes the array of sound effects
+//   (checking the handle's generation, like AudioEngine::GetSoundEffect), and then queues a Play command on the real DX::SpscRing, which the
+//   audio thread drains at the start of its next processing pass. The drain is timed separately.
+// Run a release build. Usage: TriggerBenchmark [<triggers per frame>]
+
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "SpscRing.h"
+#include "TestHelpers.h"
+
+namespace
+{
+	const uint32_t SoundEffectCount = 256;
+	const uint32_t FrameCount = 600;
+
+	// Stands in for AudioEngine's SoundEffect.
+	struct SoundEffect
+	{
+		uint32_t				m_handleGeneration;
+		uint32_t				m_playCount;
+		const uint8_t*			m_audioData;
+		uint32_t				m_audioDataSize;
+	};
+
+	// Stands in for AudioEngine's SoundHandle.
+	struct SoundHandle
+	{
+		uint32_t				m_index;
+		uint32_t				m_generation;
+	};
+
+	// The same size as AudioEngine's VoiceCommand (which holds an XAUDIO2_BUFFER and an XAUDIO2_BUFFER_WMA).
+	struct VoiceCommand
+	{
+		uint32_t				m_type;
+		void*					m_voice;
+		uint32_t				m_epoch;
+		uint32_t				m_playId;
+		uint32_t				m_value;
+		float					m_volume;
+		float					m_left;
+		float					m_right;
+		float					m_frequencyRatio;
+		uint8_t					m_buffer[48];
+		uint8_t					m_wmaBuffer[16];
+	};
+
+	SoundEffect* GetSoundEffect(const std::vector<std::unique_ptr<SoundEffect>>& soundEffects, SoundHandle handle)
+	{
+		if (handle.m_index >= soundEffects.size())
+		{
+			return nullptr;
+		}
+
+		auto soundEffect = soundEffects[handle.m_index].get();
+		return (soundEffect != nullptr && soundEffect->m_handleGeneration == handle.m_generation) ? soundEffect : nullptr;
+	}
+}
+
+int main(int argc, char* argv[])
+{
+	uint32_t triggersPerFrame = (argc > 1) ? static_cast<uint32_t>(atoi(argv[1])) : 5000;
+	if (triggersPerFrame == 0)
+	{
+		printf("Usage: TriggerBenchmark [<triggers per frame>]\n");
+		return 1;
+	}
+
+	std::vector<std::wstring> names;
+	for (uint32_t i = 0; i < SoundEffectCount; i++)
+	{
+		names.push_back(L"Assets\\Sounds\\effect_" + std::to_wstring(i) + L".wav");
+	}
+
+	// The sound effect that each trigger plays.
+	PortableTests::Random random(18);
+	std::vector<uint32_t> triggers(triggersPerFrame);
+	for (auto& trigger : triggers)
+	{
+		trigger = static_cast<uint32_t>(random.Range(0, SoundEffectCount - 1));
+	}
+
+	// By name.
+	std::map<std::wstring, std::unique_ptr<SoundEffect>> byName;
+	for (uint32_t i = 0; i < SoundEffectCount; i++)
+	{
+		byName[names[i]].reset(new SoundEffect());
+	}
+
+	auto start = PortableTests::Seconds();
+	for (uint32_t frame = 0; frame < FrameCount; frame++)
+	{
+		for (auto trigger : triggers)
+		{
+			const auto& name = names[trigger];
+			if (byName.find(name) != byName.end())
+			{
+				byName[name]->m_playCount++;
+			}
+		}
+	}
+	auto byNameTime = (PortableTests::Seconds() - start) / FrameCount;
+
+	// By handle, with the commands drained by an audio thread.
+	std::vector<std::unique_ptr<SoundEffect>> soundEffects;
+	std::vector<SoundHandle> handles;
+	for (uint32_t i = 0; i < SoundEffectCount; i++)
+	{
+		soundEffects.push_back(std::unique_ptr<SoundEffect>(new SoundEffect()));
+		soundEffects.back()->m_handleGeneration = i + 1;
+		SoundHandle handle = { i, i + 1 };
+		handles.push_back(handle);
+	}
+
+	// The ring is big enough for a frame's triggers, like AudioEngine's (which keeps any overflow on the game thread until the next Update). The
+	// audio thread's processing pass is run on this thread after each frame so that the timing doesn't depend on how the threads get scheduled.
+	DX::SpscRing<VoiceCommand> commands(triggersPerFrame);
+	uint64_t drained = 0;
+	uint64_t dropped = 0;
+	double drainTime = 0.0;
+	double byHandleTime = 0.0;
+	for (uint32_t frame = 0; frame < FrameCount; frame++)
+	{
+		start = PortableTests::Seconds();
+		for (auto trigger : triggers)
+		{
+			auto soundEffect = GetSoundEffect(soundEffects, handles[trigger]);
+			if (soundEffect != nullptr)
+			{
+				VoiceCommand command = {};
+				command.m_playId = ++soundEffect->m_playCount;
+				if (!commands.TryPush(command))
+				{
+					dropped++;
+				}
+			}
+		}
+		auto middle = PortableTests::Seconds();
+
+		VoiceCommand command;
+		while (commands.TryPop(command))
+		{
+			drained += (command.m_playId != 0) ? 1 : 0;
+		}
+
+		byHandleTime += middle - start;
+		drainTime += PortableTests::Seconds() - middle;
+	}
+	byHandleTime /= FrameCount;
+	drainTime /= FrameCount;
+
+	printf("%u triggers per frame over %u sound effects, %u frames\n", triggersPerFrame, SoundEffectCount, FrameCount);
+	printf("By name (std::map find + operator[]):            %8.1f us per frame\n", byNameTime * 1.0e6);
+	printf("By handle (array index + SpscRing push):         %8.1f us per frame\n", byHandleTime * 1.0e6);
+	printf("Audio thread draining the SpscRing:              %8.1f us per frame\n", drainTime * 1.0e6);
+	printf("Commands drained: %llu, dropped because the ring was full: %llu\n", static_cast<unsigned long long>(drained),
+		static_cast<unsigned long long>(dropped));
+	return 0;
+}
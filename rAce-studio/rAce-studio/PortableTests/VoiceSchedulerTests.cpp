@@ -0,0 +1,868 @@
+// Drives DX::VoiceScheduler with fake voices, the same way that AudioEngine's VoicePool drives it with XAudio2: the game thread acquires,
+// starts, stops and recreates voices and handles the notifications in Update, and the "audio thread" carries out the queued commands at the start
+// of each pass and then plays every running voice's buffer a pass closer to its end. Flushing a voice ends its queued buffers right away, like
+// XAudio2's FlushSourceBuffers, and recreating one drops them without ending them, like DestroyVoice. The voices can fail any call and raise
+// critical errors. Checks the stealing order, that the end of a stopped or stolen play (and every command queued for a voice before it was
+// recreated) never reaches the play that replaced it, and that with every voice playing the notification queue is exactly big enough.
+
+#include <atomic>
+#include <cstdint>
+#include <deque>
+#include <mutex>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+
+#include "TestHelpers.h"
+#include "VoiceScheduler.h"
+
+namespace
+{
+	// What a Play command carries in the tests: the number of passes that the play lasts and the sound that is played.
+	struct FakePlay
+	{
+		uint32_t				m_passes;
+		uint32_t				m_sound;
+	};
+
+	typedef DX::VoiceScheduler<FakePlay> Scheduler;
+
+	// The error code that the fake voices fail with.
+	const int32_t FakeError = -5;
+
+	// Fake voices in place of XAudio2's source voices. Only used on the audio thread (in Pass), apart from Recreate, which the game thread calls
+	// while holding the pass lock (the way DestroyVoice waits for the audio thread to be idle).
+	class FakeVoices
+	{
+	public:
+		explicit FakeVoices(Scheduler& scheduler) :
+			m_scheduler(scheduler),
+			m_voices(Scheduler::MaxVoices),
+			m_random(1),
+			m_failureRate(),
+			m_errorRate(),
+			m_passLock()
+		{
+		}
+
+		// Carries out the queued commands, plays every running voice for a pass, and raises errors at random if they are turned on.
+		void Pass()
+		{
+			std::lock_guard<std::mutex> lock(m_passLock);
+			m_scheduler.ExecuteCommands(*this);
+
+			for (uint32_t i = 0; i < m_voices.size(); i++)
+			{
+				auto& voice = m_voices[i];
+				if (!voice.m_running || voice.m_queue.empty())
+				{
+					continue;
+				}
+
+				if (m_errorRate != 0 && m_random.Range(0, static_cast<int32_t>(m_errorRate) - 1) == 0)
+				{
+					m_scheduler.OnVoiceError(i, FakeError);
+				}
+
+				if (--voice.m_queue.front().m_passesLeft == 0)
+				{
+					auto playId = voice.m_queue.front().m_playId;
+					voice.m_queue.pop_front();
+					voice.m_ended.push_back(playId);
+					m_scheduler.OnBufferEnd(i, playId);
+				}
+			}
+		}
+
+		// Destroys and recreates a voice: its queued buffers are dropped without ending. Called on the game thread, from the scheduler's
+		// RecreateVoice.
+		void Recreate(uint32_t voice)
+		{
+			std::lock_guard<std::mutex> lock(m_passLock);
+			auto& state = m_voices[voice];
+			for (auto& buffer : state.m_queue)
+			{
+				state.m_dropped.push_back(buffer.m_playId);
+			}
+			state.m_queue.clear();
+			state.m_running = false;
+			state.m_volume = 1.0f;
+			state.m_outputFlags = 0;
+			state.m_recreateCount++;
+		}
+
+		// Raises a critical error on a voice, like IXAudio2VoiceCallback::OnVoiceError. Audio thread only.
+		void RaiseError(uint32_t voice) { m_scheduler.OnVoiceError(voice, FakeError); }
+
+		// Makes the next call for a voice fail.
+		void FailNext(uint32_t voice) { m_voices[voice].m_failNext = true; }
+
+		// Makes one call in rate fail, and raises an error on one running voice in rate each pass. 0 turns them off.
+		void SetFailureRate(uint32_t rate) { m_failureRate = rate; }
+		void SetErrorRate(uint32_t rate) { m_errorRate = rate; }
+
+		// The calls that the scheduler makes (see VoiceScheduler::ExecuteCommands).
+		bool IsCreated(uint32_t) { return true; }
+
+		int32_t Submit(uint32_t voice, const FakePlay& play, uint32_t playId)
+		{
+			if (IsFailing(voice))
+			{
+				return FakeError;
+			}
+
+			QueuedBuffer buffer = { playId, (play.m_passes != 0) ? play.m_passes : 1, play.m_sound };
+			m_voices[voice].m_queue.push_back(buffer);
+			m_voices[voice].m_submitted.push_back(playId);
+			m_voices[voice].m_sounds.push_back(play.m_sound);
+			return 0;
+		}
+
+		int32_t Start(uint32_t voice)
+		{
+			if (IsFailing(voice))
+			{
+				return FakeError;
+			}
+
+			m_voices[voice].m_running = true;
+			return 0;
+		}
+
+		int32_t Stop(uint32_t voice, uint32_t flags)
+		{
+			if (IsFailing(voice))
+			{
+				return FakeError;
+			}
+
+			m_voices[voice].m_running = false;
+			m_voices[voice].m_stopFlags = flags;
+			return 0;
+		}
+
+		int32_t Flush(uint32_t voice)
+		{
+			if (IsFailing(voice))
+			{
+				return FakeError;
+			}
+
+			auto& state = m_voices[voice];
+			while (!state.m_queue.empty())
+			{
+				auto playId = state.m_queue.front().m_playId;
+				state.m_queue.pop_front();
+				state.m_ended.push_back(playId);
+				m_scheduler.OnBufferEnd(voice, playId);
+			}
+			return 0;
+		}
+
+		int32_t SetVolume(uint32_t voice, float volume)
+		{
+			if (IsFailing(voice))
+			{
+				return FakeError;
+			}
+
+			m_voices[voice].m_volume = volume;
+			return 0;
+		}
+
+		int32_t SetOutput(uint32_t voice, const Scheduler::Command& command)
+		{
+			if (IsFailing(voice))
+			{
+				return FakeError;
+			}
+
+			m_voices[voice].m_outputFlags = command.m_value;
+			m_voices[voice].m_attenuation = command.m_volume;
+			return 0;
+		}
+
+		// What happened to the voices. Only read these while no pass can run.
+		bool IsRunning(uint32_t voice) const { return m_voices[voice].m_running; }
+		size_t GetQueuedCount(uint32_t voice) const { return m_voices[voice].m_queue.size(); }
+		const std::vector<uint32_t>& GetSubmitted(uint32_t voice) const { return m_voices[voice].m_submitted; }
+		const std::vector<uint32_t>& GetSounds(uint32_t voice) const { return m_voices[voice].m_sounds; }
+		const std::vector<uint32_t>& GetEnded(uint32_t voice) const { return m_voices[voice].m_ended; }
+		const std::vector<uint32_t>& GetDropped(uint32_t voice) const { return m_voices[voice].m_dropped; }
+		float GetVolume(uint32_t voice) const { return m_voices[voice].m_volume; }
+		uint32_t GetOutputFlags(uint32_t voice) const { return m_voices[voice].m_outputFlags; }
+		float GetAttenuation(uint32_t voice) const { return m_voices[voice].m_attenuation; }
+		uint32_t GetStopFlags(uint32_t voice) const { return m_voices[voice].m_stopFlags; }
+
+		// Returns true if the play with playId ended (or was flushed) on a voice.
+		bool HasEnded(uint32_t voice, uint32_t playId) const
+		{
+			for (auto ended : m_voices[voice].m_ended)
+			{
+				if (ended == playId)
+				{
+					return true;
+				}
+			}
+			return false;
+		}
+
+	private:
+		struct QueuedBuffer
+		{
+			uint32_t				m_playId;
+			uint32_t				m_passesLeft;
+			uint32_t				m_sound;
+		};
+
+		struct Voice
+		{
+			Voice() :
+				m_queue(),
+				m_submitted(),
+				m_sounds(),
+				m_ended(),
+				m_dropped(),
+				m_running(),
+				m_failNext(),
+				m_volume(1.0f),
+				m_attenuation(1.0f),
+				m_outputFlags(),
+				m_stopFlags(),
+				m_recreateCount()
+			{
+			}
+
+			std::deque<QueuedBuffer>	m_queue;
+			std::vector<uint32_t>		m_submitted;
+			std::vector<uint32_t>		m_sounds;
+			std::vector<uint32_t>		m_ended;
+			std::vector<uint32_t>		m_dropped;
+			bool						m_running;
+			bool						m_failNext;
+			float						m_volume;
+			float						m_attenuation;
+			uint32_t					m_outputFlags;
+			uint32_t					m_stopFlags;
+			uint32_t					m_recreateCount;
+		};
+
+		bool IsFailing(uint32_t voice)
+		{
+			auto& state = m_voices[voice];
+			if (state.m_failNext)
+			{
+				state.m_failNext = false;
+				return true;
+			}
+
+			return m_failureRate != 0 && m_random.Range(0, static_cast<int32_t>(m_failureRate) - 1) == 0;
+		}
+
+		Scheduler&					m_scheduler;
+		std::vector<Voice>			m_voices;
+		PortableTests::Random		m_random;
+		uint32_t					m_failureRate;
+		uint32_t					m_errorRate;
+		std::mutex					m_passLock;
+	};
+
+	// Acquires a voice and starts a play on it, the way AudioEngine::StartSoundEffect does. Returns the voice, or NoVoice.
+	uint32_t Play(Scheduler& scheduler, uint32_t group, uint32_t priority, uint32_t sound, uint32_t passes, float attenuation = 0.0f)
+	{
+		auto voice = scheduler.Acquire(group, priority);
+		if (voice == Scheduler::NoVoice)
+		{
+			return voice;
+		}
+
+		if (attenuation != 0.0f)
+		{
+			scheduler.SetPositional(voice, 0.5f, 0.25f, attenuation, 1.0f);
+		}
+
+		FakePlay play = { passes, sound };
+		scheduler.Start(voice, play, sound, priority, 0);
+		return voice;
+	}
+
+	// Runs passes and updates until no voice in the scheduler is playing.
+	void RunToEnd(Scheduler& scheduler, FakeVoices& voices)
+	{
+		for (int pass = 0; pass < 10000; pass++)
+		{
+			voices.Pass();
+			scheduler.Update();
+
+			bool isPlaying = false;
+			for (uint32_t i = 0; i < scheduler.GetVoiceCount(); i++)
+			{
+				isPlaying = isPlaying || scheduler.IsStarted(i);
+			}
+
+			if (!isPlaying)
+			{
+				return;
+			}
+		}
+
+		CHECK(!"The voices never finished");
+	}
+
+	// Free voices are used first; then the lowest priority is stolen first, then the quietest (counting a positional play's attenuation), then
+	// the oldest. A voice playing a higher priority sound is never stolen, and other groups are never touched.
+	void TestStealingOrder()
+	{
+		Scheduler scheduler;
+		FakeVoices voices(scheduler);
+		auto group = scheduler.AddGroup(4);
+		auto other = scheduler.AddGroup(2);
+		CHECK(group == 0 && other == 1);
+		CHECK(scheduler.GetFirstVoice(other) == 4 && scheduler.GetVoiceCount() == 6);
+
+		uint32_t voice[4];
+		voice[0] = Play(scheduler, group, 1, 1, 100);
+		voice[1] = Play(scheduler, group, 2, 2, 100);
+		voice[2] = Play(scheduler, group, 2, 3, 100);
+		voice[3] = Play(scheduler, group, 2, 4, 100);
+		for (uint32_t i = 0; i < 4; i++)
+		{
+			CHECK(voice[i] < 4);
+			for (uint32_t j = 0; j < i; j++)
+			{
+				CHECK(voice[i] != voice[j]);
+			}
+		}
+		CHECK(scheduler.GetFreeVoiceCount(group) == 0);
+		voices.Pass();
+
+		// Nothing is playing a sound that is less important than priority 0.
+		CHECK(scheduler.Acquire(group, 0) == Scheduler::NoVoice);
+		CHECK(scheduler.CountSound(group, 1) == 1);
+
+		// The priority 1 sound goes first, even though every other voice is as loud and it isn't the oldest by much.
+		CHECK(Play(scheduler, group, 2, 5, 100) == voice[0]);
+
+		// Then the quietest of the priority 2 sounds.
+		scheduler.SetSoundVolume(group, 3, 0.5f);
+		CHECK(Play(scheduler, group, 2, 6, 100, 0.25f) == voice[2]);
+
+		// A positional play's attenuation counts, so the newest play is stolen again.
+		CHECK(Play(scheduler, group, 2, 7, 100) == voice[2]);
+
+		// Then the oldest.
+		CHECK(Play(scheduler, group, 2, 8, 100) == voice[1]);
+		CHECK(Play(scheduler, group, 2, 9, 100) == voice[3]);
+		CHECK(Play(scheduler, group, 2, 10, 100) == voice[0]);
+		CHECK(Play(scheduler, group, 3, 11, 100) == voice[2]);
+
+		// A stolen voice no longer counts for the sound it was playing, and the other group wasn't touched.
+		CHECK(scheduler.CountSound(group, 1) == 0 && scheduler.CountSound(group, 11) == 1);
+		CHECK(scheduler.GetFreeVoiceCount(other) == 2);
+
+		// Each steal stopped and flushed the voice before its next play, and only the last play of each voice is still queued.
+		voices.Pass();
+		scheduler.Update();
+		CHECK(scheduler.GetFreeVoiceCount(group) == 0);
+		for (uint32_t i = 0; i < 4; i++)
+		{
+			CHECK(voices.IsRunning(voice[i]) && voices.GetQueuedCount(voice[i]) == 1);
+			CHECK(voices.GetStopFlags(voice[i]) == 0);
+			auto& submitted = voices.GetSubmitted(voice[i]);
+			CHECK(!submitted.empty() && voices.GetEnded(voice[i]).size() == submitted.size() - 1);
+		}
+		CHECK(voices.GetSounds(voice[2]).back() == 11);
+
+		// The voice that was stolen for the positional play went back to the default output for the next one, and the volume that was set
+		// for sound 3 went back to 1.
+		CHECK(voices.GetOutputFlags(voice[2]) == Scheduler::DefaultOutputFlag);
+		CHECK(voices.GetVolume(voice[2]) == 1.0f && scheduler.GetVolume(voice[2]) == 1.0f);
+
+		// Stopping a sound stops its voices with the flags and frees them.
+		scheduler.StopSound(group, 11, 1);
+		CHECK(scheduler.GetFreeVoiceCount(group) == 1 && !scheduler.IsStarted(voice[2]));
+		voices.Pass();
+		CHECK(!voices.IsRunning(voice[2]) && voices.GetStopFlags(voice[2]) == 1);
+
+		RunToEnd(scheduler, voices);
+		CHECK(scheduler.GetFreeVoiceCount(group) == 4 && scheduler.GetFreeVoiceCount(other) == 2);
+
+		// A group can't take the scheduler past MaxVoices, and an empty group isn't allowed.
+		bool threw = false;
+		try
+		{
+			scheduler.AddGroup(Scheduler::MaxVoices - 5);
+		}
+		catch (const std::length_error&)
+		{
+			threw = true;
+		}
+		CHECK(threw && scheduler.GetGroupCount() == 2);
+
+		threw = false;
+		try
+		{
+			scheduler.AddGroup(0);
+		}
+		catch (const std::length_error&)
+		{
+			threw = true;
+		}
+		CHECK(threw && scheduler.AddGroup(Scheduler::MaxVoices - 6) == 2);
+	}
+
+	// Once a voice has been stolen, nothing that belongs to its old play reaches the new one: not its handle, not commands for its sound, not
+	// the end of its flushed buffer and not its errors. Once a voice has been recreated, none of the commands queued before are carried out.
+	void TestStaleAfterSteal()
+	{
+		Scheduler scheduler;
+		FakeVoices voices(scheduler);
+		auto group = scheduler.AddGroup(1);
+
+		auto voice = Play(scheduler, group, 0, 1, 10);
+		auto oldGeneration = scheduler.GetGeneration(voice);
+		voices.Pass();
+		CHECK(voices.GetSubmitted(voice).size() == 1);
+
+		// Steal the voice before its play has ended.
+		CHECK(Play(scheduler, group, 0, 2, 20) == voice);
+		auto generation = scheduler.GetGeneration(voice);
+		CHECK(!scheduler.IsPlaying(voice, oldGeneration) && scheduler.IsPlaying(voice, generation));
+
+		// Commands for the old sound don't touch the voice.
+		scheduler.SetSoundVolume(group, 1, 0.5f);
+		scheduler.StopSound(group, 1, 0);
+		CHECK(scheduler.GetVolume(voice) == 1.0f && scheduler.IsPlaying(voice, generation));
+
+		// The steal's Stop fails, so the old play's buffer stays queued ahead of the new one and its error comes back for the old play.
+		voices.FailNext(voice);
+		voices.Pass();
+		scheduler.Update();
+		CHECK(scheduler.TakeError(voice) == 0 && scheduler.IsPlaying(voice, generation));
+		CHECK(voices.GetQueuedCount(voice) == 2 && voices.GetVolume(voice) == 1.0f);
+
+		// The old play ends first, which mustn't free the voice.
+		for (int pass = 0; pass < 10; pass++)
+		{
+			voices.Pass();
+			scheduler.Update();
+		}
+		CHECK(voices.GetEnded(voice).size() == 1 && scheduler.IsPlaying(voice, generation));
+
+		// An error now belongs to the new play.
+		voices.RaiseError(voice);
+		scheduler.Update();
+		CHECK(scheduler.TakeError(voice) == FakeError && scheduler.TakeError(voice) == 0);
+		CHECK(scheduler.IsPlaying(voice, generation));
+
+		// Only one error is sent per play.
+		voices.RaiseError(voice);
+		scheduler.Update();
+		CHECK(scheduler.TakeError(voice) == 0);
+
+		RunToEnd(scheduler, voices);
+		CHECK(!scheduler.IsPlaying(voice, generation) && scheduler.GetFreeVoiceCount(group) == 1);
+		CHECK(voices.GetEnded(voice).size() == 2);
+
+		// Play, then queue a volume change and recreate the voice (as after a critical error) and restart the play on it, as
+		// AudioEngine::RestartFailedSoundEffects does. The volume change was queued for the old voice so it is skipped.
+		voice = Play(scheduler, group, 0, 3, 20);
+		voices.Pass();
+		CHECK(scheduler.GetReservedNotificationCount() == 2);
+		scheduler.SetSoundVolume(group, 3, 0.25f);
+		scheduler.RecreateVoice(voice, [&]() { voices.Recreate(voice); });
+		CHECK(scheduler.GetVolume(voice) == 1.0f);
+		FakePlay play = { 5, 3 };
+		scheduler.Start(voice, play, 3, 0, 0);
+		voices.Pass();
+		CHECK(voices.GetVolume(voice) == 1.0f);
+		CHECK(voices.GetDropped(voice).size() == 1 && voices.GetSubmitted(voice).size() == 4);
+		CHECK(scheduler.GetReservedNotificationCount() == 2);
+
+		// A play that was queued but not carried out before the voice was recreated is skipped too.
+		scheduler.Stop(voice, 0);
+		voice = Play(scheduler, group, 0, 4, 5);
+		scheduler.RecreateVoice(voice, [&]() { voices.Recreate(voice); });
+		voices.Pass();
+		CHECK(voices.GetSubmitted(voice).size() == 4 && !voices.IsRunning(voice));
+		scheduler.Update();
+		CHECK(scheduler.IsStarted(voice));
+		scheduler.Free(voice);
+
+		// The forgotten notifications gave their reservations back.
+		CHECK(scheduler.GetReservedNotificationCount() == 0);
+	}
+
+	// With MaxVoices voices playing, every notification that could follow fits in the queue, and a play waits (along with everything after it)
+	// while the game thread hasn't made room.
+	void TestReservationAtMaxVoices()
+	{
+		Scheduler scheduler;
+		FakeVoices voices(scheduler);
+		scheduler.AddGroup(Scheduler::MaxVoices / 2);
+		scheduler.AddGroup(Scheduler::MaxVoices / 4);
+		scheduler.AddGroup(Scheduler::MaxVoices / 4);
+		CHECK(scheduler.GetVoiceCount() == Scheduler::MaxVoices);
+
+		auto playAll = [&](uint32_t sound)
+		{
+			for (uint32_t group = 0; group < scheduler.GetGroupCount(); group++)
+			{
+				for (uint32_t i = 0; i < scheduler.GetGroupVoiceCount(group); i++)
+				{
+					CHECK(Play(scheduler, group, 0, sound, 1000) != Scheduler::NoVoice);
+				}
+			}
+		};
+
+		playAll(1);
+		voices.Pass();
+		CHECK(scheduler.GetReservedNotificationCount() == Scheduler::QueueCapacity);
+
+		// Every voice has an error and then ends, without the game thread handling any of it. Every notification fits.
+		for (uint32_t i = 0; i < Scheduler::MaxVoices; i++)
+		{
+			voices.RaiseError(i);
+		}
+		for (uint32_t i = 0; i < Scheduler::MaxVoices; i++)
+		{
+			voices.Flush(i);
+		}
+		CHECK(scheduler.GetReservedNotificationCount() == 0);
+		scheduler.Update();
+		for (uint32_t i = 0; i < Scheduler::MaxVoices; i++)
+		{
+			CHECK(scheduler.TakeError(i) == FakeError && !scheduler.IsStarted(i));
+		}
+
+		// Play everything again and then stop and restart every voice. The stops end MaxVoices plays whose notifications the game thread hasn't
+		// handled yet, so there isn't room for the first new play's notifications and it waits.
+		playAll(2);
+		voices.Pass();
+		CHECK(scheduler.GetReservedNotificationCount() == Scheduler::QueueCapacity);
+		for (uint32_t i = 0; i < Scheduler::MaxVoices; i++)
+		{
+			scheduler.Stop(i, 0);
+		}
+		playAll(3);
+		voices.Pass();
+		for (uint32_t i = 0; i < Scheduler::MaxVoices; i++)
+		{
+			CHECK(voices.GetSubmitted(i).size() == 2 && !voices.IsRunning(i));
+		}
+		CHECK(scheduler.GetReservedNotificationCount() == Scheduler::MaxVoices);
+
+		// The stale buffer ends don't free the new plays, and once they have been handled every play goes ahead.
+		scheduler.Update();
+		voices.Pass();
+		for (uint32_t i = 0; i < Scheduler::MaxVoices; i++)
+		{
+			CHECK(scheduler.IsStarted(i) && voices.GetSubmitted(i).size() == 3 && voices.IsRunning(i));
+		}
+		CHECK(scheduler.GetReservedNotificationCount() == Scheduler::QueueCapacity);
+
+		// Errors and ends for every voice fill the queue exactly, and none of them are lost.
+		for (uint32_t i = 0; i < Scheduler::MaxVoices; i++)
+		{
+			voices.RaiseError(i);
+			voices.Flush(i);
+		}
+		scheduler.Update();
+		for (uint32_t i = 0; i < Scheduler::MaxVoices; i++)
+		{
+			CHECK(scheduler.TakeError(i) == FakeError && !scheduler.IsStarted(i));
+		}
+		CHECK(scheduler.GetReservedNotificationCount() == 0);
+	}
+
+	// A play that the test is keeping track of.
+	struct TrackedPlay
+	{
+		uint32_t				m_voice;
+		uint32_t				m_generation;
+		uint32_t				m_playId;
+		uint32_t				m_sound;
+		uint32_t				m_group;
+	};
+
+	// Random plays, stops, volume and output changes, pauses, failures, errors and recreated voices. After every Update, each play that the game
+	// thread didn't stop (or lose to a steal or an error) is playing exactly until the fake voice has ended it.
+	void TestRandom(uint32_t seed)
+	{
+		PortableTests::Random random(seed);
+		Scheduler scheduler;
+		FakeVoices voices(scheduler);
+		voices.SetFailureRate(200);
+		voices.SetErrorRate(2000);
+
+		std::vector<uint32_t> groups;
+		groups.push_back(scheduler.AddGroup(8));
+		groups.push_back(scheduler.AddGroup(3));
+		groups.push_back(scheduler.AddGroup(16));
+
+		// The play ids that the scheduler gives out: one per Start, per voice.
+		std::vector<uint32_t> playIds(scheduler.GetVoiceCount(), 0);
+		std::vector<TrackedPlay> plays;
+
+		auto forget = [&plays](uint32_t voice)
+		{
+			for (size_t i = 0; i < plays.size(); i++)
+			{
+				if (plays[i].m_voice == voice)
+				{
+					plays[i] = plays.back();
+					plays.pop_back();
+					return;
+				}
+			}
+		};
+
+		bool paused = false;
+		for (int frame = 0; frame < 20000; frame++)
+		{
+			auto operationCount = random.Range(0, 5);
+			for (int operation = 0; operation < operationCount; operation++)
+			{
+				switch (random.Range(0, 9))
+				{
+				case 0:
+				case 1:
+				case 2:
+				case 3:
+					{
+						auto group = groups[static_cast<size_t>(random.Range(0, 2))];
+						auto sound = static_cast<uint32_t>(random.Range(1, 6));
+						auto attenuation = (random.Range(0, 3) == 0) ? random.Range(0.1f, 1.0f) : 0.0f;
+						auto voice = Play(scheduler, group, static_cast<uint32_t>(random.Range(0, 3)), sound, static_cast<uint32_t>(random.Range(1, 40)), attenuation);
+						if (voice != Scheduler::NoVoice)
+						{
+							forget(voice);
+							TrackedPlay play = { voice, scheduler.GetGeneration(voice), ++playIds[voice], sound, group };
+							plays.push_back(play);
+						}
+					}
+					break;
+
+				case 4:
+					if (!plays.empty())
+					{
+						auto play = plays[static_cast<size_t>(random.Range(0, static_cast<int32_t>(plays.size()) - 1))];
+						if (scheduler.IsPlaying(play.m_voice, play.m_generation))
+						{
+							scheduler.Stop(play.m_voice, 0);
+							forget(play.m_voice);
+						}
+					}
+					break;
+
+				case 5:
+					{
+						auto group = groups[static_cast<size_t>(random.Range(0, 2))];
+						auto sound = static_cast<uint32_t>(random.Range(1, 6));
+						scheduler.StopSound(group, sound, 0);
+						for (size_t i = plays.size(); i-- > 0;)
+						{
+							if (plays[i].m_group == group && plays[i].m_sound == sound)
+							{
+								plays[i] = plays.back();
+								plays.pop_back();
+							}
+						}
+						CHECK(scheduler.CountSound(group, sound) == 0);
+					}
+					break;
+
+				case 6:
+					scheduler.SetSoundVolume(groups[static_cast<size_t>(random.Range(0, 2))], static_cast<uint32_t>(random.Range(1, 6)), random.Range(0.0f, 1.0f));
+					break;
+
+				case 7:
+					if (!plays.empty())
+					{
+						auto& play = plays[static_cast<size_t>(random.Range(0, static_cast<int32_t>(plays.size()) - 1))];
+						if (scheduler.IsPlaying(play.m_voice, play.m_generation) && scheduler.IsPositional(play.m_voice))
+						{
+							scheduler.SetOutput(play.m_voice, random.Range(0.0f, 1.0f), random.Range(0.0f, 1.0f), random.Range(0.0f, 1.0f), random.Range(0.5f, 2.0f));
+						}
+					}
+					break;
+
+				case 8:
+					if (paused)
+					{
+						scheduler.Resume();
+					}
+					else
+					{
+						scheduler.Pause();
+					}
+					paused = !paused;
+					break;
+
+				default:
+					// Recreate a voice as if it had had an error, and restart its play on it.
+					if (!plays.empty())
+					{
+						auto& play = plays[static_cast<size_t>(random.Range(0, static_cast<int32_t>(plays.size()) - 1))];
+						auto voice = play.m_voice;
+						if (!scheduler.IsPlaying(voice, play.m_generation))
+						{
+							break;
+						}
+						scheduler.RecreateVoice(voice, [&]() { voices.Recreate(voice); });
+						FakePlay fakePlay = { 10, play.m_sound };
+						scheduler.Start(voice, fakePlay, play.m_sound, 0, 0);
+						play.m_playId = ++playIds[voice];
+					}
+					break;
+				}
+			}
+
+			voices.Pass();
+			scheduler.Update();
+			CHECK(scheduler.GetReservedNotificationCount() <= Scheduler::QueueCapacity);
+
+			// Handle the errors the way AudioEngine::RestartFailedSoundEffects does: recreate the voice and restart its play, or give up on it. A
+			// play can end in the same Update that brings its error.
+			for (uint32_t voice = 0; voice < scheduler.GetVoiceCount(); voice++)
+			{
+				if (scheduler.TakeError(voice) == 0 || !scheduler.IsStarted(voice))
+				{
+					continue;
+				}
+
+				scheduler.RecreateVoice(voice, [&]() { voices.Recreate(voice); });
+				if (random.Range(0, 1) == 0)
+				{
+					scheduler.Free(voice);
+					forget(voice);
+					continue;
+				}
+
+				FakePlay fakePlay = { 10, static_cast<uint32_t>(scheduler.GetSound(voice)) };
+				scheduler.Start(voice, fakePlay, scheduler.GetSound(voice), 0, scheduler.GetLoopCount(voice));
+				++playIds[voice];
+				for (auto& play : plays)
+				{
+					if (play.m_voice == voice)
+					{
+						play.m_playId = playIds[voice];
+					}
+				}
+			}
+
+			// Every tracked play is playing until its voice has ended it. A steal would have been forgotten when the voice was acquired.
+			for (size_t i = plays.size(); i-- > 0;)
+			{
+				auto& play = plays[i];
+				bool isPlaying = scheduler.IsPlaying(play.m_voice, play.m_generation);
+				CHECK(isPlaying == !voices.HasEnded(play.m_voice, play.m_playId));
+				if (!isPlaying)
+				{
+					plays[i] = plays.back();
+					plays.pop_back();
+				}
+			}
+		}
+
+		if (paused)
+		{
+			scheduler.Resume();
+		}
+		voices.SetFailureRate(0);
+		voices.SetErrorRate(0);
+		RunToEnd(scheduler, voices);
+		for (auto group : groups)
+		{
+			CHECK(scheduler.GetFreeVoiceCount(group) == scheduler.GetGroupVoiceCount(group));
+		}
+	}
+
+	// The game thread and the audio thread run at the same time, with the voices playing for a few passes each. Run it with ThreadSanitizer to
+	// check that the threads share nothing but the rings and the epochs.
+	void TestThreads()
+	{
+		Scheduler scheduler;
+		FakeVoices voices(scheduler);
+		voices.SetFailureRate(500);
+		voices.SetErrorRate(5000);
+		auto group = scheduler.AddGroup(32);
+
+		std::atomic<bool> exit(false);
+		std::thread audioThread([&]()
+		{
+			while (!exit.load())
+			{
+				voices.Pass();
+				std::this_thread::yield();
+			}
+		});
+
+		PortableTests::Random random(23);
+		for (int frame = 0; frame < 20000; frame++)
+		{
+			auto playCount = random.Range(0, 6);
+			for (int play = 0; play < playCount; play++)
+			{
+				Play(scheduler, group, static_cast<uint32_t>(random.Range(0, 3)), static_cast<uint32_t>(random.Range(1, 6)), static_cast<uint32_t>(random.Range(1, 20)));
+			}
+
+			if (random.Range(0, 7) == 0)
+			{
+				scheduler.StopSound(group, static_cast<uint32_t>(random.Range(1, 6)), 0);
+			}
+			scheduler.SetSoundVolume(group, static_cast<uint32_t>(random.Range(1, 6)), random.Range(0.0f, 1.0f));
+
+			scheduler.Update();
+			for (uint32_t voice = 0; voice < scheduler.GetVoiceCount(); voice++)
+			{
+				if (scheduler.TakeError(voice) != 0 && scheduler.IsStarted(voice))
+				{
+					scheduler.RecreateVoice(voice, [&]() { voices.Recreate(voice); });
+					scheduler.Free(voice);
+				}
+			}
+
+			if ((frame % 64) == 0)
+			{
+				std::this_thread::yield();
+			}
+		}
+
+		exit = true;
+		audioThread.join();
+
+		// Stop everything without failures, and let the buffers of any voices whose stops failed play out.
+		voices.SetFailureRate(0);
+		voices.SetErrorRate(0);
+		for (uint32_t sound = 1; sound <= 6; sound++)
+		{
+			scheduler.StopSound(group, sound, 0);
+		}
+		for (int pass = 0; pass < 100; pass++)
+		{
+			scheduler.Update();
+			voices.Pass();
+		}
+		scheduler.Update();
+
+		CHECK(scheduler.GetFreeVoiceCount(group) == 32);
+		for (uint32_t voice = 0; voice < 32; voice++)
+		{
+			CHECK(voices.GetQueuedCount(voice) == 0);
+		}
+		CHECK(scheduler.GetReservedNotificationCount() <= 32);
+	}
+}
+
+int main()
+{
+	TestStealingOrder();
+	TestStaleAfterSteal();
+	TestReservationAtMaxVoices();
+	TestRandom(1);
+	TestRandom(19);
+	TestThreads();
+
+	return PortableTests::Finish("VoiceSchedulerTests");
+}
@@ -0,0 +1,287 @@
+// Fuzzes DX::ParseWaveFile. Every input is copied into a heap block of exactly its size so that a sanitized build (PORTABLE_TESTS_SANITIZE) catches
+// any read past the end, and every result is checked to lie within the input. As a ctest test it runs a fixed number of deterministic mutations
+// (truncations, bit flips, random chunk sizes and spliced chunks) of a few valid files. Configured with -DPORTABLE_TESTS_LIBFUZZER=ON (Clang only)
+// it is built as a libFuzzer target instead; pass it a directory to use as the corpus.
+
+#include <cstdint>
+#include <cstring>
+#include <vector>
+
+#include "TestHelpers.h"
+#include "WaveFile.h"
+
+namespace
+{
+	// Parses a copy of the input and checks the result.
+	void ParseAndCheck(const uint8_t* input, size_t size)
+	{
+		std::vector<uint8_t> data(input, input + size);
+		auto begin = data.empty() ? nullptr : data.data();
+		auto end = begin + size;
+
+		DX::WaveFileView view;
+		if (!DX::ParseWaveFile(begin, size, view))
+		{
+			return;
+		}
+
+		CHECK(view.m_format != nullptr && view.m_format >= begin && view.m_formatSize >= 16);
+		CHECK(view.m_formatSize <= static_cast<size_t>(end - view.m_format));
+		CHECK(view.m_audioData != nullptr && view.m_audioData >= begin);
+		CHECK(view.m_audioDataSize <= static_cast<size_t>(end - view.m_audioData));
+		CHECK(view.m_channels != 0 && view.m_samplesPerSecond != 0 && view.m_blockAlign != 0);
+		if (view.m_seekTable != nullptr)
+		{
+			CHECK(view.m_seekTable >= begin && static_cast<size_t>(view.m_seekTableCount) * 4 <= static_cast<size_t>(end - view.m_seekTable));
+		}
+
+		// Touch every byte that the view points at so that the sanitizer sees any range that is wrong.
+		uint32_t sum = 0;
+		for (uint32_t i = 0; i < view.m_formatSize; i++)
+		{
+			sum += view.m_format[i];
+		}
+		for (uint32_t i = 0; i < view.m_audioDataSize; i++)
+		{
+			sum += view.m_audioData[i];
+		}
+		for (uint32_t i = 0; view.m_seekTable != nullptr && i < view.m_seekTableCount * 4; i++)
+		{
+			sum += view.m_seekTable[i];
+		}
+		volatile uint32_t sink = sum;
+		(void)sink;
+
+		// A loop always ends within 32 bits (which SoundBank requires), and a PCM loop is inside the data.
+		if (view.m_loopLength != 0)
+		{
+			CHECK(view.m_loopBegin <= 0xFFFFFFFFU - view.m_loopLength);
+			if (view.m_formatTag == 1)
+			{
+				CHECK(static_cast<uint64_t>(view.m_loopBegin) + view.m_loopLength <= view.m_audioDataSize / view.m_blockAlign);
+			}
+		}
+	}
+
+	void Append32(std::vector<uint8_t>& file, uint32_t value)
+	{
+		for (int i = 0; i < 4; i++)
+		{
+			file.push_back(static_cast<uint8_t>(value >> (i * 8)));
+		}
+	}
+
+	void AppendChunk(std::vector<uint8_t>& file, const char* id, const std::vector<uint8_t>& contents)
+	{
+		file.insert(file.end(), id, id + 4);
+		Append32(file, static_cast<uint32_t>(contents.size()));
+		file.insert(file.end(), contents.begin(), contents.end());
+		if ((contents.size() & 1) != 0)
+		{
+			file.push_back(0);
+		}
+	}
+
+	// Builds a WAVE file with a 'fmt ' chunk of formatSize bytes, a 'data' chunk, and optionally 'smpl' (with one loop from loopBegin to loopEnd,
+	// inclusive) and 'dpds' chunks. ADPCM formats get 1024 samples per 512 byte block.
+	std::vector<uint8_t> MakeWaveFile(uint16_t formatTag, uint32_t formatSize, uint32_t dataSize, bool sampleChunk, bool seekTable,
+		uint32_t loopBegin = 10, uint32_t loopEnd = 90)
+	{
+		std::vector<uint8_t> format(formatSize, 0);
+		format[0] = static_cast<uint8_t>(formatTag);
+		format[1] = static_cast<uint8_t>(formatTag >> 8);
+		format[2] = 2;
+		format[4] = 0x44;
+		format[5] = 0xAC;
+		format[12] = 4;
+		format[14] = 16;
+		if (formatSize >= 18)
+		{
+			format[16] = static_cast<uint8_t>(formatSize - 18);
+		}
+		if ((formatTag == 2 || formatTag == 0x11) && formatSize >= 20)
+		{
+			format[12] = 0;
+			format[13] = 2;
+			format[19] = 4;
+		}
+
+		// The RIFF size is filled in at the end.
+		const uint8_t header[12] = { 'R', 'I', 'F', 'F', 0, 0, 0, 0, 'W', 'A', 'V', 'E' };
+		std::vector<uint8_t> file(header, header + sizeof(header));
+		AppendChunk(file, "LIST", std::vector<uint8_t>(7, 'x'));
+		AppendChunk(file, "fmt ", format);
+		if (sampleChunk)
+		{
+			std::vector<uint8_t> sample(36 + 24, 0);
+			sample[28] = 1;
+			memcpy(&sample[36 + 8], &loopBegin, 4);
+			memcpy(&sample[36 + 12], &loopEnd, 4);
+			AppendChunk(file, "smpl", sample);
+		}
+		if (seekTable)
+		{
+			AppendChunk(file, "dpds", std::vector<uint8_t>(32, 1));
+		}
+		std::vector<uint8_t> data(dataSize);
+		for (uint32_t i = 0; i < dataSize; i++)
+		{
+			data[i] = static_cast<uint8_t>(i);
+		}
+		AppendChunk(file, "data", data);
+
+		auto riffSize = static_cast<uint32_t>(file.size() - 8);
+		memcpy(&file[4], &riffSize, 4);
+		return file;
+	}
+
+	// Applies one random mutation.
+	void Mutate(PortableTests::Random& random, std::vector<uint8_t>& file, const std::vector<std::vector<uint8_t>>& seeds)
+	{
+		switch (random.Range(0, 5))
+		{
+		case 0:
+			// Truncate.
+			file.resize(static_cast<size_t>(random.Range(0, static_cast<int32_t>(file.size()))));
+			break;
+
+		case 1:
+			// Flip some bits.
+			for (int flips = random.Range(1, 8); flips > 0 && !file.empty(); flips--)
+			{
+				file[static_cast<size_t>(random.Range(0, static_cast<int32_t>(file.size()) - 1))] ^= static_cast<uint8_t>(1 << random.Range(0, 7));
+			}
+			break;
+
+		case 2:
+			// Overwrite a 32-bit value (most likely a size) with something interesting.
+			if (file.size() >= 4)
+			{
+				const uint32_t values[] = { 0, 1, 15, 16, 17, 18, 0x7FFFFFFF, 0x80000000, 0xFFFFFFF0, 0xFFFFFFFF, random.Next() };
+				auto value = values[random.Range(0, 10)];
+				memcpy(&file[static_cast<size_t>(random.Range(0, static_cast<int32_t>(file.size()) - 4))], &value, 4);
+			}
+			break;
+
+		case 3:
+			// Splice in part of another file.
+			{
+				const auto& other = seeds[static_cast<size_t>(random.Range(0, static_cast<int32_t>(seeds.size()) - 1))];
+				auto from = static_cast<size_t>(random.Range(0, static_cast<int32_t>(other.size()) - 1));
+				auto count = static_cast<size_t>(random.Range(1, static_cast<int32_t>(other.size() - from)));
+				auto at = static_cast<size_t>(random.Range(0, static_cast<int32_t>(file.size())));
+				file.insert(file.begin() + at, other.begin() + from, other.begin() + from + count);
+			}
+			break;
+
+		case 4:
+			// Duplicate a run of bytes (e.g. a second 'fmt ' chunk).
+			if (!file.empty())
+			{
+				auto from = static_cast<size_t>(random.Range(0, static_cast<int32_t>(file.size()) - 1));
+				auto count = static_cast<size_t>(random.Range(1, static_cast<int32_t>(file.size() - from)));
+				std::vector<uint8_t> run(file.begin() + from, file.begin() + from + count);
+				file.insert(file.begin() + from, run.begin(), run.end());
+			}
+			break;
+
+		default:
+			// Make the RIFF size disagree with the file size.
+			if (file.size() >= 8)
+			{
+				auto riffSize = static_cast<uint32_t>(random.Range(0, static_cast<int32_t>(file.size()) + 64));
+				memcpy(&file[4], &riffSize, 4);
+			}
+			break;
+		}
+	}
+
+	// Parses a file with a loop and returns the loop, or (0, 0) if the parser dropped it.
+	void ParseLoop(const std::vector<uint8_t>& file, uint32_t& loopBegin, uint32_t& loopLength)
+	{
+		DX::WaveFileView view;
+		CHECK(DX::ParseWaveFile(file.data(), file.size(), view));
+		loopBegin = (view.m_loopLength != 0) ? view.m_loopBegin : 0;
+		loopLength = view.m_loopLength;
+	}
+
+	// Loops that run past the data or over every sample number. The PCM seed has 4 byte blocks, and the ADPCM one 1024 samples per 512 byte block.
+	void TestLoops()
+	{
+		uint32_t loopBegin = 0;
+		uint32_t loopLength = 0;
+
+		ParseLoop(MakeWaveFile(1, 16, 400, true, false, 10, 90), loopBegin, loopLength);
+		CHECK(loopBegin == 10 && loopLength == 81);
+		ParseLoop(MakeWaveFile(1, 16, 400, true, false, 0, 99), loopBegin, loopLength);
+		CHECK(loopBegin == 0 && loopLength == 100);
+		ParseLoop(MakeWaveFile(1, 16, 400, true, false, 0, 100), loopBegin, loopLength);
+		CHECK(loopLength == 0);
+		ParseLoop(MakeWaveFile(1, 16, 400, true, false, 0, 0xFFFFFFFF), loopBegin, loopLength);
+		CHECK(loopLength == 0);
+		ParseLoop(MakeWaveFile(1, 16, 400, true, false, 50, 49), loopBegin, loopLength);
+		CHECK(loopLength == 0);
+
+		// ADPCM loops are clamped to the last (possibly partial) block, so 0 to 0xFFFFFFFF loops the whole sound instead of wrapping to no loop.
+		ParseLoop(MakeWaveFile(2, 50, 1024, true, false, 0, 0xFFFFFFFF), loopBegin, loopLength);
+		CHECK(loopBegin == 0 && loopLength == 2048);
+		ParseLoop(MakeWaveFile(0x11, 20, 1000, true, false, 1024, 0xFFFFFFFF), loopBegin, loopLength);
+		CHECK(loopBegin == 1024 && loopLength == 1024);
+		ParseLoop(MakeWaveFile(2, 50, 1024, true, false, 1024, 2047), loopBegin, loopLength);
+		CHECK(loopBegin == 1024 && loopLength == 1024);
+		ParseLoop(MakeWaveFile(2, 50, 1024, true, false, 2048, 0xFFFFFFFF), loopBegin, loopLength);
+		CHECK(loopLength == 0);
+
+		// Other compressed formats can't be checked against the data, but the loop still has to end within 32 bits.
+		ParseLoop(MakeWaveFile(0x161, 18, 300, true, false, 0, 0xFFFFFFFF), loopBegin, loopLength);
+		CHECK(loopBegin == 0 && loopLength == 0xFFFFFFFF);
+		ParseLoop(MakeWaveFile(0x161, 18, 300, true, false, 0xFFFFFFFF, 0xFFFFFFFF), loopBegin, loopLength);
+		CHECK(loopLength == 0);
+		ParseLoop(MakeWaveFile(0x161, 18, 300, true, false, 5, 0xFFFFFFFF), loopBegin, loopLength);
+		CHECK(loopBegin == 5 && loopLength == 0xFFFFFFFA);
+	}
+}
+
+extern "C" int LLVMFuzzerTestOneInput(const uint8_t* data, size_t size)
+{
+	ParseAndCheck(data, size);
+	return 0;
+}
+
+#ifndef PORTABLE_TESTS_LIBFUZZER
+int main()
+{
+	std::vector<std::vector<uint8_t>> seeds;
+	seeds.push_back(MakeWaveFile(1, 16, 400, false, false));
+	seeds.push_back(MakeWaveFile(1, 18, 401, true, false));
+	seeds.push_back(MakeWaveFile(0xFFFE, 40, 64, true, false));
+	seeds.push_back(MakeWaveFile(2, 50, 512, false, false));
+	seeds.push_back(MakeWaveFile(0x161, 18, 300, false, true));
+
+	// The seeds themselves parse, and so does every truncation of them that still holds the chunks.
+	for (const auto& seed : seeds)
+	{
+		DX::WaveFileView view;
+		CHECK(DX::ParseWaveFile(seed.data(), seed.size(), view));
+		for (size_t size = 0; size <= seed.size(); size++)
+		{
+			ParseAndCheck(seed.data(), size);
+		}
+	}
+
+	TestLoops();
+
+	PortableTests::Random random(16);
+	for (int iteration = 0; iteration < 200000; iteration++)
+	{
+		auto file = seeds[static_cast<size_t>(random.Range(0, static_cast<int32_t>(seeds.size()) - 1))];
+		for (int mutations = random.Range(1, 4); mutations > 0; mutations--)
+		{
+			Mutate(random, file, seeds);
+		}
+		ParseAndCheck(file.data(), file.size());
+	}
+
+	return PortableTests::Finish("WaveFileFuzz");
+}
+#endif
@@ -0,0 +1,185 @@
+// SoundBankBuilder - Builds .sbank sound bank files from a directory of WAV files so that the game can load all of them with one call to
+// AudioEngine::LoadSoundBank (one file open and one mapping) instead of one LoadSoundEffect call per file.
+//
+// Usage: SoundBankBuilder <input directory> [<output file>]
+//
+// Every .wav file in the input directory and its subdirectories is added. Each sound is named by its path relative to the input directory (e.g.
+// "laser.wav" or "somedir\ball drop.wav"), which is the name that is then passed to AudioEngine::PlaySoundEffect. The output defaults to the input
+// directory name with a .sbank extension. Supported WAV formats are PCM, IEEE float, and MS-ADPCM (plus WAVE_FORMAT_EXTENSIBLE), which XAudio2
+// plays natively, and IMA ADPCM, which AudioEngine::LoadSoundBank decodes to PCM. xWMA is not supported since the bank has nowhere to keep its
+// seek table. The first loop in a file's 'smpl' chunk (if any) becomes the sound's loop region.
+
+#include <Windows.h>
+
+#include <cstdint>
+#include <cstdio>
+#include <fstream>
+#include <iterator>
+#include <string>
+#include <vector>
+
+#include "AdpcmDecoder.h"
+#include "SoundBank.h"
+#include "WaveFile.h"
+
+namespace
+{
+	const uint16_t WaveFormatPcm = 1;			// WAVE_FORMAT_PCM
+	const uint16_t WaveFormatIeeeFloat = 3;		// WAVE_FORMAT_IEEE_FLOAT
+	const uint16_t WaveFormatExtensible = 0xFFFE;	// WAVE_FORMAT_EXTENSIBLE
+
+	// Reads an entire file into memory. Returns false if the file can't be read.
+	bool ReadFileData(const std::wstring& filename, std::vector<uint8_t>& data)
+	{
+		std::ifstream file(filename, std::ios::binary);
+		if (!file)
+		{
+			return false;
+		}
+
+		data.assign(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+		return !file.bad();
+	}
+
+	// Returns true if filename ends with extension (case insensitive).
+	bool HasExtension(const std::wstring& filename, const wchar_t* extension)
+	{
+		auto length = wcslen(extension);
+		return filename.size() >= length && _wcsicmp(filename.c_str() + (filename.size() - length), extension) == 0;
+	}
+
+	// Finds every .wav file under a directory. The names are relative to root.
+	// root - The input directory, ending with a backslash.
+	// relative - The subdirectory to search, relative to root. Empty or ending with a backslash.
+	// names - Receives the relative names of the files.
+	void FindWaveFiles(const std::wstring& root, const std::wstring& relative, std::vector<std::wstring>& names)
+	{
+		WIN32_FIND_DATAW findData;
+		HANDLE find = FindFirstFileExW((root + relative + L"*").c_str(), FindExInfoStandard, &findData, FindExSearchNameMatch, nullptr, 0);
+		if (find == INVALID_HANDLE_VALUE)
+		{
+			return;
+		}
+
+		do
+		{
+			std::wstring name(findData.cFileName);
+			if ((findData.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY) != 0)
+			{
+				if (name != L"." && name != L"..")
+				{
+					FindWaveFiles(root, relative + name + L"\\", names);
+				}
+			}
+			else if (HasExtension(name, L".wav"))
+			{
+				names.push_back(relative + name);
+			}
+		}
+		while (FindNextFileW(find, &findData));
+
+		FindClose(find);
+	}
+
+	// Reads a WAV file into a sound bank source. Returns false and prints an error if the file can't be used.
+	bool ReadWaveFile(const std::wstring& filename, DX::SoundBankSource& source)
+	{
+		std::vector<uint8_t> data;
+		if (!ReadFileData(filename, data))
+		{
+			fwprintf(stderr, L"error: unable to read '%s'.\n", filename.c_str());
+			return false;
+		}
+
+		DX::WaveFileView wave;
+		if (!DX::ParseWaveFile(data.data(), data.size(), wave))
+		{
+			fwprintf(stderr, L"error: '%s' is not a valid WAV file.\n", filename.c_str());
+			return false;
+		}
+
+		if (wave.m_formatTag == DX::WaveFormatMsAdpcm || wave.m_formatTag == DX::WaveFormatImaAdpcm)
+		{
+			// Check the format now rather than when the game loads the bank.
+			DX::AdpcmFormat format;
+			if (!DX::ParseAdpcmFormat(wave.m_format, wave.m_formatSize, format))
+			{
+				fwprintf(stderr, L"error: '%s' has an ADPCM format that can't be decoded.\n", filename.c_str());
+				return false;
+			}
+
+			if (wave.m_formatTag == DX::WaveFormatMsAdpcm && wave.m_loopLength != 0 &&
+				((wave.m_loopBegin % format.m_samplesPerBlock) != 0 || (wave.m_loopLength % format.m_samplesPerBlock) != 0))
+			{
+				fwprintf(stderr, L"warning: the loop in '%s' is not on block boundaries, so the whole sound will loop instead.\n", filename.c_str());
+			}
+		}
+		else if (wave.m_formatTag != WaveFormatPcm && wave.m_formatTag != WaveFormatIeeeFloat && wave.m_formatTag != WaveFormatExtensible)
+		{
+			fwprintf(stderr, L"error: '%s' uses format 0x%04X, which can't be put in a sound bank.\n", filename.c_str(), wave.m_formatTag);
+			return false;
+		}
+
+		source.m_format.assign(wave.m_format, wave.m_format + wave.m_formatSize);
+		source.m_audioData.assign(wave.m_audioData, wave.m_audioData + wave.m_audioDataSize);
+		source.m_loopBegin = wave.m_loopBegin;
+		source.m_loopLength = wave.m_loopLength;
+
+		return true;
+	}
+}
+
+int wmain(int argc, wchar_t* argv[])
+{
+	if (argc < 2 || argc > 3)
+	{
+		fwprintf(stderr, L"Usage: SoundBankBuilder <input directory> [<output file>]\n");
+		return 1;
+	}
+
+	std::wstring input(argv[1]);
+	while (!input.empty() && (input.back() == L'\\' || input.back() == L'/'))
+	{
+		input.pop_back();
+	}
+
+	std::wstring output = (argc == 3) ? std::wstring(argv[2]) : input + L".sbank";
+
+	std::vector<std::wstring> names;
+	FindWaveFiles(input + L"\\", std::wstring(), names);
+	if (names.empty())
+	{
+		fwprintf(stderr, L"error: no .wav files were found in '%s'.\n", input.c_str());
+		return 1;
+	}
+
+	std::vector<DX::SoundBankSource> sources(names.size());
+	for (size_t i = 0; i < names.size(); ++i)
+	{
+		sources[i].m_name = names[i];
+		if (!ReadWaveFile(input + L"\\" + names[i], sources[i]))
+		{
+			return 1;
+		}
+	}
+
+	std::vector<uint8_t> data;
+	if (!DX::SoundBank::SaveToMemory(sources, data))
+	{
+		fwprintf(stderr, L"error: two of the file names have the same hash or the bank would be 4 GB or larger.\n");
+		return 1;
+	}
+
+	std::ofstream file(output, std::ios::binary | std::ios::trunc);
+	file.write(reinterpret_cast<const char*>(data.data()), data.size());
+	file.close();
+	if (!file)
+	{
+		fwprintf(stderr, L"error: unable to write '%s'.\n", output.c_str());
+		return 1;
+	}
+
+	wprintf(L"%s: %u sounds, %u bytes.\n", output.c_str(), static_cast<unsigned int>(sources.size()), static_cast<unsigned int>(data.size()));
+
+	return 0;
+}
@@ -0,0 +1,639 @@
+#include "AdpcmDecoder.h"
+
+#include <cstring>
+
+#if defined(_M_IX86) || defined(_M_X64) || defined(__SSE2__)
+#define ADPCM_DECODER_SSE2
+#include <emmintrin.h>
+#elif defined(_M_ARM) || defined(__ARM_NEON__) || defined(__ARM_NEON)
+#define ADPCM_DECODER_NEON
+#include <arm_neon.h>
+#endif
+
+namespace
+{
+	// The standard MS-ADPCM predictor coefficient pairs. A block's header picks one of them for each channel.
+	const int16_t MsAdpcmCoefficients[DX::MsAdpcmCoefficientCount][2] =
+	{
+		{ 256, 0 }, { 512, -256 }, { 0, 0 }, { 192, 64 }, { 240, 0 }, { 460, -208 }, { 392, -232 }
+	};
+
+	// Scales the MS-ADPCM step size (delta) after each nibble, in 1/256ths.
+	const int32_t MsAdpcmAdaptationTable[16] =
+	{
+		230, 230, 230, 230, 307, 409, 512, 614, 768, 614, 512, 409, 307, 230, 230, 230
+	};
+
+	// The smallest MS-ADPCM step size.
+	const int32_t MsAdpcmMinimumDelta = 16;
+
+	// The largest MS-ADPCM step size. Valid data never comes close; the limit only keeps the arithmetic of corrupt data from overflowing.
+	const int32_t MsAdpcmMaximumDelta = 0x7FFFFFFF / 768;
+
+	// The IMA ADPCM step sizes.
+	const int32_t ImaAdpcmStepTable[89] =
+	{
+		7, 8, 9, 10, 11, 12, 13, 14, 16, 17, 19, 21, 23, 25, 28, 31, 34, 37, 41, 45, 50, 55, 60, 66, 73, 80, 88, 97, 107, 118, 130, 143, 157, 173,
+		190, 209, 230, 253, 279, 307, 337, 371, 408, 449, 494, 544, 598, 658, 724, 796, 876, 963, 1060, 1166, 1282, 1411, 1552, 1707, 1878, 2066,
+		2272, 2499, 2749, 3024, 3327, 3660, 4026, 4428, 4871, 5358, 5894, 6484, 7132, 7845, 8630, 9493, 10442, 11487, 12635, 13899, 15289, 16818,
+		18500, 20350, 22385, 24623, 27086, 29794, 32767
+	};
+
+	// Moves the IMA ADPCM step index after each nibble.
+	const int32_t ImaAdpcmIndexTable[16] =
+	{
+		-1, -1, -1, -1, 2, 4, 6, 8, -1, -1, -1, -1, 2, 4, 6, 8
+	};
+
+	// The size of the fixed part of a WAVEFORMATEX, up to and including cbSize.
+	const size_t WaveFormatExSize = 18;
+
+	// Reads a little-endian 16-bit value.
+	inline uint16_t ReadUInt16(const uint8_t* data)
+	{
+		return static_cast<uint16_t>(data[0] | (data[1] << 8));
+	}
+
+	// Reads a little-endian 32-bit value.
+	inline uint32_t ReadUInt32(const uint8_t* data)
+	{
+		return static_cast<uint32_t>(data[0]) | (static_cast<uint32_t>(data[1]) << 8) | (static_cast<uint32_t>(data[2]) << 16) |
+			(static_cast<uint32_t>(data[3]) << 24);
+	}
+
+	// Clamps a value to the range of a 16-bit sample.
+	inline int32_t ClampSample(int32_t value)
+	{
+		return value < -32768 ? -32768 : (value > 32767 ? 32767 : value);
+	}
+
+	// Returns the size of a block's header in bytes.
+	inline size_t GetBlockHeaderSize(const DX::AdpcmFormat& format)
+	{
+		return static_cast<size_t>(format.m_formatTag == DX::WaveFormatMsAdpcm ? 7 : 4) * format.m_channels;
+	}
+
+	// Returns the number of sample frames in a block of blockSize bytes (which may be a short last block).
+	uint32_t GetBlockFrameCount(const DX::AdpcmFormat& format, size_t blockSize)
+	{
+		if (blockSize >= format.m_blockAlign)
+		{
+			return format.m_samplesPerBlock;
+		}
+
+		auto headerSize = GetBlockHeaderSize(format);
+		if (blockSize < headerSize)
+		{
+			return 0;
+		}
+
+		// The MS-ADPCM header holds two samples per channel and the nibbles follow one frame at a time. The IMA ADPCM header holds one and the
+		// nibbles follow in runs of 8 samples (4 bytes) per channel.
+		auto dataSize = blockSize - headerSize;
+		if (format.m_formatTag == DX::WaveFormatMsAdpcm)
+		{
+			return static_cast<uint32_t>(2 + ((dataSize * 2) / format.m_channels));
+		}
+
+		return static_cast<uint32_t>(1 + ((dataSize / (4 * format.m_channels)) * 8));
+	}
+
+	// The state of one channel of an MS-ADPCM block.
+	struct MsAdpcmChannel
+	{
+		// The last two samples.
+		int32_t						m_sample1;
+		int32_t						m_sample2;
+		// The step size.
+		int32_t						m_delta;
+		// The predictor coefficients.
+		int32_t						m_coefficient1;
+		int32_t						m_coefficient2;
+	};
+
+	// Reads the state of one channel from an MS-ADPCM block's header. An out of range predictor index (which only corrupt data has) uses the
+	// first coefficient pair.
+	inline void ReadMsAdpcmHeader(const uint8_t* block, uint32_t channels, uint32_t channel, MsAdpcmChannel& state)
+	{
+		uint32_t predictor = block[channel];
+		if (predictor >= DX::MsAdpcmCoefficientCount)
+		{
+			predictor = 0;
+		}
+
+		state.m_coefficient1 = MsAdpcmCoefficients[predictor][0];
+		state.m_coefficient2 = MsAdpcmCoefficients[predictor][1];
+		state.m_delta = static_cast<int16_t>(ReadUInt16(block + channels + (channel * 2)));
+		state.m_sample1 = static_cast<int16_t>(ReadUInt16(block + (channels * 3) + (channel * 2)));
+		state.m_sample2 = static_cast<int16_t>(ReadUInt16(block + (channels * 5) + (channel * 2)));
+	}
+
+	// Decodes one MS-ADPCM nibble.
+	inline int16_t DecodeMsAdpcmNibble(MsAdpcmChannel& state, uint32_t nibble)
+	{
+		int32_t predicted = ((state.m_sample1 * state.m_coefficient1) + (state.m_sample2 * state.m_coefficient2)) >> 8;
+		int32_t sample = ClampSample(predicted + (static_cast<int32_t>(nibble ^ 8) - 8) * state.m_delta);
+
+		state.m_sample2 = state.m_sample1;
+		state.m_sample1 = sample;
+
+		int32_t delta = (MsAdpcmAdaptationTable[nibble] * state.m_delta) >> 8;
+		state.m_delta = delta < MsAdpcmMinimumDelta ? MsAdpcmMinimumDelta : (delta > MsAdpcmMaximumDelta ? MsAdpcmMaximumDelta : delta);
+
+		return static_cast<int16_t>(sample);
+	}
+
+	// Decodes the first frameCount frames of an MS-ADPCM block. The header supplies the first two frames and the nibbles the rest; nibble k
+	// belongs to channel k % channels and the high nibble of each byte comes first.
+	void DecodeMsAdpcmBlock(const DX::AdpcmFormat& format, const uint8_t* block, uint32_t frameCount, int16_t* destination)
+	{
+		uint32_t channels = format.m_channels;
+		MsAdpcmChannel states[2];
+
+		for (uint32_t channel = 0; channel < channels; ++channel)
+		{
+			ReadMsAdpcmHeader(block, channels, channel, states[channel]);
+
+			// The older sample comes first.
+			destination[channel] = static_cast<int16_t>(states[channel].m_sample2);
+			if (frameCount > 1)
+			{
+				destination[channels + channel] = static_cast<int16_t>(states[channel].m_sample1);
+			}
+		}
+
+		auto nibbles = block + (7 * channels);
+		uint32_t nibbleCount = (frameCount > 2) ? (frameCount - 2) * channels : 0;
+		destination += 2 * channels;
+
+		// A byte's high nibble belongs to the first channel and its low nibble to the last, which for a mono block is the same channel.
+		auto& high = states[0];
+		auto& low = states[channels - 1];
+		for (uint32_t i = 0; i + 1 < nibbleCount; i += 2)
+		{
+			uint32_t byte = nibbles[i >> 1];
+			destination[i] = DecodeMsAdpcmNibble(high, byte >> 4);
+			destination[i + 1] = DecodeMsAdpcmNibble(low, byte & 0x0F);
+		}
+
+		// A short mono block can end half way through a byte.
+		if ((nibbleCount & 1) != 0)
+		{
+			destination[nibbleCount - 1] = DecodeMsAdpcmNibble(high, nibbles[nibbleCount >> 1] >> 4);
+		}
+	}
+
+	// Decodes the first frameCount frames of an IMA ADPCM block. The header supplies the first frame. The nibbles follow in runs of 4 bytes per
+	// channel, each holding the next 8 samples of that channel, low nibble first. IMA ADPCM's step size comes from a table indexed by the
+	// channel's state, which SSE2 and NEON have no gather for, so its channels are always decoded one at a time.
+	void DecodeImaAdpcmBlock(const DX::AdpcmFormat& format, const uint8_t* block, uint32_t frameCount, int16_t* destination)
+	{
+		uint32_t channels = format.m_channels;
+
+		for (uint32_t channel = 0; channel < channels; ++channel)
+		{
+			auto header = block + (channel * 4);
+			int32_t sample = static_cast<int16_t>(ReadUInt16(header));
+			int32_t index = header[2] > 88 ? 88 : header[2];
+
+			destination[channel] = static_cast<int16_t>(sample);
+
+			for (uint32_t frame = 1; frame < frameCount; ++frame)
+			{
+				// Frame f is nibble (f - 1) % 8 of its run of 8, and the runs of the channels are interleaved.
+				uint32_t run = (frame - 1) >> 3;
+				uint32_t position = (frame - 1) & 7;
+				uint8_t byte = block[(4 * channels) + (run * 4 * channels) + (channel * 4) + (position >> 1)];
+				uint32_t nibble = (position & 1) ? (byte >> 4) : (byte & 0x0F);
+
+				int32_t step = ImaAdpcmStepTable[index];
+				int32_t difference = step >> 3;
+				if (nibble & 4)
+				{
+					difference += step;
+				}
+				if (nibble & 2)
+				{
+					difference += step >> 1;
+				}
+				if (nibble & 1)
+				{
+					difference += step >> 2;
+				}
+
+				sample = ClampSample((nibble & 8) ? sample - difference : sample + difference);
+				index += ImaAdpcmIndexTable[nibble];
+				index = index < 0 ? 0 : (index > 88 ? 88 : index);
+
+				destination[(frame * channels) + channel] = static_cast<int16_t>(sample);
+			}
+		}
+	}
+
+	// Decodes the first frameCount frames of a block.
+	void DecodeBlock(const DX::AdpcmFormat& format, const uint8_t* block, uint32_t frameCount, int16_t* destination)
+	{
+		if (format.m_formatTag == DX::WaveFormatMsAdpcm)
+		{
+			DecodeMsAdpcmBlock(format, block, frameCount, destination);
+		}
+		else
+		{
+			DecodeImaAdpcmBlock(format, block, frameCount, destination);
+		}
+	}
+
+#if defined(ADPCM_DECODER_SSE2) || defined(ADPCM_DECODER_NEON)
+	// The number of channel streams (one channel of one block) in a SIMD vector.
+	const uint32_t StreamsPerVector = 4;
+
+	// The number of channel streams that are decoded side by side: eight blocks of a mono format or four blocks of a stereo one. Each stream
+	// only depends on its own previous samples, so two vectors of them keep the processor busy while each waits for its last result.
+	const uint32_t StreamsPerGroup = 2 * StreamsPerVector;
+
+	// The number of frames of a group that are decoded before they are copied out of the group's scratch buffer.
+	const uint32_t FramesPerChunk = 64;
+
+#if defined(ADPCM_DECODER_SSE2)
+	typedef __m128i Int32x4;
+	typedef __m128i LaneMask;
+
+	// Multiplies 32-bit lanes, keeping the low 32 bits (SSE2 has no _mm_mullo_epi32).
+	inline __m128i MultiplyLow(__m128i left, __m128i right)
+	{
+		__m128i even = _mm_mul_epu32(left, right);
+		__m128i odd = _mm_mul_epu32(_mm_srli_epi64(left, 32), _mm_srli_epi64(right, 32));
+		return _mm_unpacklo_epi32(_mm_shuffle_epi32(even, _MM_SHUFFLE(0, 0, 2, 0)), _mm_shuffle_epi32(odd, _MM_SHUFFLE(0, 0, 2, 0)));
+	}
+
+	// Picks each 32-bit lane from whenTrue where mask is all ones and from whenFalse where it is zero.
+	inline __m128i Select(__m128i mask, __m128i whenTrue, __m128i whenFalse)
+	{
+		return _mm_or_si128(_mm_and_si128(mask, whenTrue), _mm_andnot_si128(mask, whenFalse));
+	}
+
+	// Returns a mask with all ones in the lanes where high is true.
+	inline __m128i MakeLaneMask(bool lane0, bool lane1, bool lane2, bool lane3)
+	{
+		return _mm_setr_epi32(lane0 ? -1 : 0, lane1 ? -1 : 0, lane2 ? -1 : 0, lane3 ? -1 : 0);
+	}
+
+	// Loads one byte per lane.
+	inline __m128i LoadBytes(const uint8_t* const* bytes, uint32_t offset)
+	{
+		return _mm_setr_epi32(bytes[0][offset], bytes[1][offset], bytes[2][offset], bytes[3][offset]);
+	}
+#else
+	typedef int32x4_t Int32x4;
+	typedef uint32x4_t LaneMask;
+
+	// Returns a mask with all ones in the lanes where high is true. (NEON vectors can't be brace initialized portably.)
+	inline uint32x4_t MakeLaneMask(bool lane0, bool lane1, bool lane2, bool lane3)
+	{
+		const uint32_t lanes[4] = { lane0 ? ~0U : 0U, lane1 ? ~0U : 0U, lane2 ? ~0U : 0U, lane3 ? ~0U : 0U };
+		return vld1q_u32(lanes);
+	}
+
+	// Loads one byte per lane.
+	inline int32x4_t LoadBytes(const uint8_t* const* bytes, uint32_t offset)
+	{
+		int32x4_t result = vdupq_n_s32(bytes[0][offset]);
+		result = vsetq_lane_s32(bytes[1][offset], result, 1);
+		result = vsetq_lane_s32(bytes[2][offset], result, 2);
+		return vsetq_lane_s32(bytes[3][offset], result, 3);
+	}
+#endif
+
+	// The state of StreamsPerVector MS-ADPCM channel streams, one per lane.
+	struct MsAdpcmLanes
+	{
+#if defined(ADPCM_DECODER_SSE2)
+		// Each lane holds the stream's (coefficient1, coefficient2) pair as 16-bit values so that _mm_madd_epi16 can do the whole prediction.
+		__m128i						m_coefficients;
+#else
+		int32x4_t					m_coefficient1;
+		int32x4_t					m_coefficient2;
+#endif
+		Int32x4						m_sample1;
+		Int32x4						m_sample2;
+		Int32x4						m_delta;
+	};
+
+	// Loads the state of StreamsPerVector streams into lanes.
+	inline void LoadLanes(const MsAdpcmChannel* states, MsAdpcmLanes& lanes)
+	{
+		int32_t values[5][StreamsPerVector];
+		for (uint32_t lane = 0; lane < StreamsPerVector; ++lane)
+		{
+			values[0][lane] = states[lane].m_coefficient1;
+			values[1][lane] = states[lane].m_coefficient2;
+			values[2][lane] = states[lane].m_sample1;
+			values[3][lane] = states[lane].m_sample2;
+			values[4][lane] = states[lane].m_delta;
+		}
+
+#if defined(ADPCM_DECODER_SSE2)
+		__m128i coefficient1 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(values[0]));
+		__m128i coefficient2 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(values[1]));
+		lanes.m_coefficients = _mm_or_si128(_mm_and_si128(coefficient1, _mm_set1_epi32(0xFFFF)), _mm_slli_epi32(coefficient2, 16));
+		lanes.m_sample1 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(values[2]));
+		lanes.m_sample2 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(values[3]));
+		lanes.m_delta = _mm_loadu_si128(reinterpret_cast<const __m128i*>(values[4]));
+#else
+		lanes.m_coefficient1 = vld1q_s32(values[0]);
+		lanes.m_coefficient2 = vld1q_s32(values[1]);
+		lanes.m_sample1 = vld1q_s32(values[2]);
+		lanes.m_sample2 = vld1q_s32(values[3]);
+		lanes.m_delta = vld1q_s32(values[4]);
+#endif
+	}
+
+	// Decodes one nibble in every lane, the same way as DecodeMsAdpcmNibble, and stores the samples.
+	// lanes - The streams' state.
+	// bytes - The byte that holds each lane's nibble.
+	// lowNibble - The lanes whose nibble is the low one.
+	// destination - Receives the StreamsPerVector samples.
+	inline void DecodeLanes(MsAdpcmLanes& lanes, Int32x4 bytes, LaneMask lowNibble, int16_t* destination)
+	{
+#if defined(ADPCM_DECODER_SSE2)
+		const __m128i eight = _mm_set1_epi32(8);
+		__m128i nibble = Select(lowNibble, _mm_and_si128(bytes, _mm_set1_epi32(0x0F)), _mm_srli_epi32(bytes, 4));
+		__m128i signedNibble = _mm_sub_epi32(_mm_xor_si128(nibble, eight), eight);
+
+		// The adaptation factor only depends on the size of the signed nibble: 230 up to 3 and then 307, 409, 512, 614 and 768.
+		__m128i sign = _mm_srai_epi32(signedNibble, 31);
+		__m128i magnitude = _mm_sub_epi32(_mm_xor_si128(signedNibble, sign), sign);
+		__m128i adaptation = _mm_add_epi32(_mm_set1_epi32(230), _mm_and_si128(_mm_cmpgt_epi32(magnitude, _mm_set1_epi32(3)), _mm_set1_epi32(77)));
+		adaptation = _mm_add_epi32(adaptation, _mm_and_si128(_mm_cmpgt_epi32(magnitude, _mm_set1_epi32(4)), _mm_set1_epi32(102)));
+		adaptation = _mm_add_epi32(adaptation, _mm_and_si128(_mm_cmpgt_epi32(magnitude, _mm_set1_epi32(5)), _mm_set1_epi32(103)));
+		adaptation = _mm_add_epi32(adaptation, _mm_and_si128(_mm_cmpgt_epi32(magnitude, _mm_set1_epi32(6)), _mm_set1_epi32(102)));
+		adaptation = _mm_add_epi32(adaptation, _mm_and_si128(_mm_cmpgt_epi32(magnitude, _mm_set1_epi32(7)), _mm_set1_epi32(154)));
+
+		__m128i history = _mm_or_si128(_mm_and_si128(lanes.m_sample1, _mm_set1_epi32(0xFFFF)), _mm_slli_epi32(lanes.m_sample2, 16));
+		__m128i predicted = _mm_srai_epi32(_mm_madd_epi16(history, lanes.m_coefficients), 8);
+		__m128i sample = _mm_add_epi32(predicted, MultiplyLow(signedNibble, lanes.m_delta));
+
+		// Saturating to 16 bits is the clamp.
+		__m128i packed = _mm_packs_epi32(sample, sample);
+		_mm_storel_epi64(reinterpret_cast<__m128i*>(destination), packed);
+
+		lanes.m_sample2 = lanes.m_sample1;
+		lanes.m_sample1 = _mm_srai_epi32(_mm_unpacklo_epi16(packed, packed), 16);
+
+		__m128i delta = _mm_srai_epi32(MultiplyLow(adaptation, lanes.m_delta), 8);
+		delta = Select(_mm_cmplt_epi32(delta, _mm_set1_epi32(MsAdpcmMinimumDelta)), _mm_set1_epi32(MsAdpcmMinimumDelta), delta);
+		lanes.m_delta = Select(_mm_cmpgt_epi32(delta, _mm_set1_epi32(MsAdpcmMaximumDelta)), _mm_set1_epi32(MsAdpcmMaximumDelta), delta);
+#else
+		const int32x4_t eight = vdupq_n_s32(8);
+		int32x4_t nibble = vbslq_s32(lowNibble, vandq_s32(bytes, vdupq_n_s32(0x0F)), vshrq_n_s32(bytes, 4));
+		int32x4_t signedNibble = vsubq_s32(veorq_s32(nibble, eight), eight);
+
+		// The adaptation factor only depends on the size of the signed nibble: 230 up to 3 and then 307, 409, 512, 614 and 768.
+		int32x4_t magnitude = vabsq_s32(signedNibble);
+		int32x4_t adaptation = vaddq_s32(vdupq_n_s32(230), vandq_s32(vreinterpretq_s32_u32(vcgtq_s32(magnitude, vdupq_n_s32(3))), vdupq_n_s32(77)));
+		adaptation = vaddq_s32(adaptation, vandq_s32(vreinterpretq_s32_u32(vcgtq_s32(magnitude, vdupq_n_s32(4))), vdupq_n_s32(102)));
+		adaptation = vaddq_s32(adaptation, vandq_s32(vreinterpretq_s32_u32(vcgtq_s32(magnitude, vdupq_n_s32(5))), vdupq_n_s32(103)));
+		adaptation = vaddq_s32(adaptation, vandq_s32(vreinterpretq_s32_u32(vcgtq_s32(magnitude, vdupq_n_s32(6))), vdupq_n_s32(102)));
+		adaptation = vaddq_s32(adaptation, vandq_s32(vreinterpretq_s32_u32(vcgtq_s32(magnitude, vdupq_n_s32(7))), vdupq_n_s32(154)));
+
+		int32x4_t predicted = vshrq_n_s32(vmlaq_s32(vmulq_s32(lanes.m_sample1, lanes.m_coefficient1), lanes.m_sample2, lanes.m_coefficient2), 8);
+		int32x4_t sample = vmlaq_s32(predicted, signedNibble, lanes.m_delta);
+
+		// Saturating to 16 bits is the clamp.
+		int16x4_t packed = vqmovn_s32(sample);
+		vst1_s16(destination, packed);
+
+		lanes.m_sample2 = lanes.m_sample1;
+		lanes.m_sample1 = vmovl_s16(packed);
+
+		int32x4_t delta = vshrq_n_s32(vmulq_s32(adaptation, lanes.m_delta), 8);
+		lanes.m_delta = vminq_s32(vmaxq_s32(delta, vdupq_n_s32(MsAdpcmMinimumDelta)), vdupq_n_s32(MsAdpcmMaximumDelta));
+#endif
+	}
+
+	// Decodes a group of whole MS-ADPCM blocks (StreamsPerGroup / channels of them, or fewer at the end of the data) with one channel of one
+	// block in each SIMD lane. Every lane reads the same byte offset in its block for a frame: a mono block has two frames per byte (high nibble
+	// first) and a stereo block has one, with the first channel in the high nibble. So only the byte fetch is done per lane; the nibbles, the
+	// adaptation factors and the prediction are all worked out for every lane at once. The samples go to a scratch buffer with the lanes side by
+	// side and are copied out in chunks.
+	// format - The format of the blocks.
+	// blocks - The first block's data.
+	// blockCount - The number of blocks in the group.
+	// destination - Receives the first block's samples.
+	void DecodeMsAdpcmGroup(const DX::AdpcmFormat& format, const uint8_t* blocks, uint32_t blockCount, int16_t* destination)
+	{
+		uint32_t channels = format.m_channels;
+		uint32_t samplesPerBlock = format.m_samplesPerBlock;
+		uint32_t streamCount = blockCount * channels;
+
+		// Lanes past streamCount decode the last stream again and are never copied out.
+		const uint8_t* nibbles[StreamsPerGroup];
+		MsAdpcmChannel states[StreamsPerGroup];
+		for (uint32_t lane = 0; lane < StreamsPerGroup; ++lane)
+		{
+			uint32_t stream = lane < streamCount ? lane : streamCount - 1;
+			uint32_t channel = stream % channels;
+			auto block = blocks + (static_cast<size_t>(stream / channels) * format.m_blockAlign);
+
+			ReadMsAdpcmHeader(block, channels, channel, states[lane]);
+			nibbles[lane] = block + (7 * channels);
+
+			if (lane < streamCount)
+			{
+				auto output = destination + (static_cast<size_t>(stream / channels) * samplesPerBlock * channels) + channel;
+				output[0] = static_cast<int16_t>(states[lane].m_sample2);
+				output[channels] = static_cast<int16_t>(states[lane].m_sample1);
+			}
+		}
+
+		MsAdpcmLanes first;
+		MsAdpcmLanes second;
+		LoadLanes(states, first);
+		LoadLanes(states + StreamsPerVector, second);
+
+		// In a stereo group the second channel of each block takes the low nibble. In a mono group every lane takes the same nibble, which
+		// alternates by frame.
+		const LaneMask allHigh = MakeLaneMask(false, false, false, false);
+		const LaneMask allLow = MakeLaneMask(true, true, true, true);
+		const LaneMask stereoLow = MakeLaneMask(false, true, false, true);
+
+		int16_t scratch[FramesPerChunk * StreamsPerGroup];
+
+		for (uint32_t firstFrame = 2; firstFrame < samplesPerBlock; firstFrame += FramesPerChunk)
+		{
+			uint32_t frameCount = (samplesPerBlock - firstFrame) < FramesPerChunk ? samplesPerBlock - firstFrame : FramesPerChunk;
+
+			for (uint32_t i = 0; i < frameCount; ++i)
+			{
+				uint32_t nibbleIndex = firstFrame + i - 2;
+				uint32_t offset = (channels == 1) ? (nibbleIndex >> 1) : nibbleIndex;
+				LaneMask lowNibble = (channels == 2) ? stereoLow : ((nibbleIndex & 1) ? allLow : allHigh);
+
+				DecodeLanes(first, LoadBytes(nibbles, offset), lowNibble, scratch + (i * StreamsPerGroup));
+				DecodeLanes(second, LoadBytes(nibbles + StreamsPerVector, offset), lowNibble, scratch + (i * StreamsPerGroup) + StreamsPerVector);
+			}
+
+			// Copy the chunk out one block at a time. A stereo block's two channels sit in adjacent lanes, so each of its frames is copied whole.
+			for (uint32_t block = 0; block < blockCount; ++block)
+			{
+				auto output = destination + (((static_cast<size_t>(block) * samplesPerBlock) + firstFrame) * channels);
+				auto input = scratch + (block * channels);
+				if (channels == 2)
+				{
+					for (uint32_t i = 0; i < frameCount; ++i)
+					{
+						memcpy(output + (i * 2), input + (i * StreamsPerGroup), 2 * sizeof(int16_t));
+					}
+				}
+				else
+				{
+					for (uint32_t i = 0; i < frameCount; ++i)
+					{
+						output[i] = input[i * StreamsPerGroup];
+					}
+				}
+			}
+		}
+	}
+#endif
+}
+
+bool DX::ParseAdpcmFormat(
+	const uint8_t* format,
+	size_t formatSize,
+	AdpcmFormat& result
+	)
+{
+	// Both formats extend a WAVEFORMATEX with the number of samples per block.
+	if (format == nullptr || formatSize < WaveFormatExSize + 2)
+	{
+		return false;
+	}
+
+	AdpcmFormat parsed;
+	parsed.m_formatTag = ReadUInt16(format);
+	parsed.m_channels = ReadUInt16(format + 2);
+	parsed.m_samplesPerSecond = ReadUInt32(format + 4);
+	parsed.m_blockAlign = ReadUInt16(format + 12);
+	parsed.m_samplesPerBlock = ReadUInt16(format + WaveFormatExSize);
+	uint16_t bitsPerSample = ReadUInt16(format + 14);
+
+	if ((parsed.m_formatTag != WaveFormatMsAdpcm && parsed.m_formatTag != WaveFormatImaAdpcm) ||
+		parsed.m_channels < 1 || parsed.m_channels > 2 || parsed.m_samplesPerSecond == 0 || bitsPerSample != 4)
+	{
+		return false;
+	}
+
+	size_t headerSize = GetBlockHeaderSize(parsed);
+	if (parsed.m_blockAlign <= headerSize)
+	{
+		return false;
+	}
+
+	if (parsed.m_formatTag == WaveFormatMsAdpcm)
+	{
+		// The samples per block must be what the block size holds (XAudio2 rejects anything else), and the coefficients must be the standard ones.
+		size_t expected = 2 + (((parsed.m_blockAlign - headerSize) * 2) / parsed.m_channels);
+		if (parsed.m_samplesPerBlock != expected || formatSize < WaveFormatExSize + 4 + (MsAdpcmCoefficientCount * 4) ||
+			ReadUInt16(format + WaveFormatExSize + 2) != MsAdpcmCoefficientCount)
+		{
+			return false;
+		}
+
+		for (uint32_t i = 0; i < MsAdpcmCoefficientCount; ++i)
+		{
+			auto pair = format + WaveFormatExSize + 4 + (i * 4);
+			if (static_cast<int16_t>(ReadUInt16(pair)) != MsAdpcmCoefficients[i][0] || static_cast<int16_t>(ReadUInt16(pair + 2)) != MsAdpcmCoefficients[i][1])
+			{
+				return false;
+			}
+		}
+	}
+	else
+	{
+		// The data after the header must be whole runs of 8 samples per channel.
+		size_t runSize = 4 * parsed.m_channels;
+		if (((parsed.m_blockAlign - headerSize) % runSize) != 0 ||
+			parsed.m_samplesPerBlock != 1 + (((parsed.m_blockAlign - headerSize) / runSize) * 8))
+		{
+			return false;
+		}
+	}
+
+	result = parsed;
+	return true;
+}
+
+uint64_t DX::GetAdpcmFrameCount(
+	const AdpcmFormat& format,
+	size_t size
+	)
+{
+	return (static_cast<uint64_t>(size / format.m_blockAlign) * format.m_samplesPerBlock) + GetBlockFrameCount(format, size % format.m_blockAlign);
+}
+
+uint32_t DX::DecodeAdpcmBlock(
+	const AdpcmFormat& format,
+	const uint8_t* block,
+	size_t blockSize,
+	int16_t* destination
+	)
+{
+	uint32_t frameCount = GetBlockFrameCount(format, blockSize);
+	if (frameCount != 0)
+	{
+		DecodeBlock(format, block, frameCount, destination);
+	}
+
+	return frameCount;
+}
+
+void DX::DecodeAdpcmBlocks(
+	const AdpcmFormat& format,
+	const uint8_t* blocks,
+	size_t blockCount,
+	int16_t* destination
+	)
+{
+#if defined(ADPCM_DECODER_SSE2) || defined(ADPCM_DECODER_NEON)
+	if (format.m_formatTag == WaveFormatMsAdpcm)
+	{
+		size_t blocksPerGroup = StreamsPerGroup / format.m_channels;
+		size_t groupSamples = blocksPerGroup * format.m_samplesPerBlock * format.m_channels;
+		for (size_t block = 0; block < blockCount; block += blocksPerGroup)
+		{
+			auto count = static_cast<uint32_t>((blockCount - block) < blocksPerGroup ? blockCount - block : blocksPerGroup);
+			DecodeMsAdpcmGroup(format, blocks + (block * format.m_blockAlign), count, destination + ((block / blocksPerGroup) * groupSamples));
+		}
+
+		return;
+	}
+#endif
+
+	size_t blockSamples = static_cast<size_t>(format.m_samplesPerBlock) * format.m_channels;
+	for (size_t i = 0; i < blockCount; ++i)
+	{
+		DecodeBlock(format, blocks + (i * format.m_blockAlign), format.m_samplesPerBlock, destination + (i * blockSamples));
+	}
+}
+
+uint64_t DX::DecodeAdpcm(
+	const AdpcmFormat& format,
+	const uint8_t* data,
+	size_t size,
+	int16_t* destination
+	)
+{
+	size_t blockCount = size / format.m_blockAlign;
+	DecodeAdpcmBlocks(format, data, blockCount, destination);
+
+	uint64_t frameCount = static_cast<uint64_t>(blockCount) * format.m_samplesPerBlock;
+	size_t remainder = size % format.m_blockAlign;
+	if (remainder != 0)
+	{
+		frameCount += DecodeAdpcmBlock(format, data + (blockCount * format.m_blockAlign), remainder,
+			destination + static_cast<size_t>(frameCount * format.m_channels));
+	}
+
+	return frameCount;
+}
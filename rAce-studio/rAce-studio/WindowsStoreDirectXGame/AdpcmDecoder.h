@@ -0,0 +1,94 @@
+#pragma once
+
+// Portable (see README_PORTABLE.txt). SoundBankBuilder uses it to check ADPCM files before adding them to a bank.
+#include <cstddef>
+#include <cstdint>
+
+namespace DX
+{
+	// WAVE_FORMAT_ADPCM. Microsoft ADPCM, which XAudio2 plays natively.
+	const uint16_t WaveFormatMsAdpcm = 0x0002;
+
+	// WAVE_FORMAT_IMA_ADPCM (also known as WAVE_FORMAT_DVI_ADPCM). XAudio2 can't play it so it has to be decoded first.
+	const uint16_t WaveFormatImaAdpcm = 0x0011;
+
+	// The number of predictor coefficient pairs in an MS-ADPCM format. Encoders always write the same seven standard pairs and XAudio2 accepts
+	// no others.
+	const uint32_t MsAdpcmCoefficientCount = 7;
+
+	// The parts of an ADPCM 'fmt ' chunk that are needed to decode it. Both formats store audio in blocks of m_blockAlign bytes that each start
+	// with a header holding the decoder state, so every block can be decoded on its own.
+	struct AdpcmFormat
+	{
+		// WaveFormatMsAdpcm or WaveFormatImaAdpcm.
+		uint16_t					m_formatTag;
+		// The number of channels. 1 or 2.
+		uint16_t					m_channels;
+		// The sample rate.
+		uint32_t					m_samplesPerSecond;
+		// The size of a block in bytes.
+		uint16_t					m_blockAlign;
+		// The number of sample frames in a whole block.
+		uint16_t					m_samplesPerBlock;
+	};
+
+	// Reads an ADPCM format from the contents of a 'fmt ' chunk. Every read is checked against formatSize.
+	// format - The contents of the 'fmt ' chunk (an ADPCMWAVEFORMAT or an IMAADPCMWAVEFORMAT). Does not need to be aligned.
+	// formatSize - The size of the chunk in bytes.
+	// result - Receives the format. Only valid if the function returns true.
+	// Returns true if the chunk is a mono or stereo MS-ADPCM format with the standard coefficients or an IMA ADPCM format, and its block size and
+	// samples per block agree.
+	bool ParseAdpcmFormat(
+		const uint8_t* format,
+		size_t formatSize,
+		AdpcmFormat& result
+		);
+
+	// Returns the number of sample frames in size bytes of ADPCM data: the whole blocks plus whatever a short last block holds.
+	// format - The format of the data.
+	// size - The size of the data in bytes.
+	uint64_t GetAdpcmFrameCount(
+		const AdpcmFormat& format,
+		size_t size
+		);
+
+	// Decodes one block to interleaved 16-bit PCM.
+	// format - The format of the block.
+	// block - The block's data.
+	// blockSize - The size of the block in bytes. Normally m_blockAlign; the last block of the data may be shorter. Extra bytes are ignored.
+	// destination - Receives the samples. Must have room for GetAdpcmFrameCount(format, blockSize) frames.
+	// Returns the number of frames written.
+	uint32_t DecodeAdpcmBlock(
+		const AdpcmFormat& format,
+		const uint8_t* block,
+		size_t blockSize,
+		int16_t* destination
+		);
+
+	// Decodes a run of whole blocks to interleaved 16-bit PCM. The channels of several blocks are decoded side by side with SIMD since each one
+	// is independent of the others (the state only carries from sample to sample within a block's channel). Each block only writes its own
+	// frames so different runs of the same data can be decoded on different threads at the same time.
+	// format - The format of the blocks.
+	// blocks - The first block's data.
+	// blockCount - The number of blocks. Each one is m_blockAlign bytes.
+	// destination - Receives the samples, m_samplesPerBlock frames per block.
+	void DecodeAdpcmBlocks(
+		const AdpcmFormat& format,
+		const uint8_t* blocks,
+		size_t blockCount,
+		int16_t* destination
+		);
+
+	// Decodes ADPCM data (e.g. the contents of a 'data' chunk) to interleaved 16-bit PCM.
+	// format - The format of the data.
+	// data - The data.
+	// size - The size of the data in bytes.
+	// destination - Receives the samples. Must have room for GetAdpcmFrameCount(format, size) frames.
+	// Returns the number of frames written.
+	uint64_t DecodeAdpcm(
+		const AdpcmFormat& format,
+		const uint8_t* data,
+		size_t size,
+		int16_t* destination
+		);
+}
@@ -0,0 +1,300 @@
+#include "AlphaCollision.h"
+
+#include <algorithm>
+#include <cmath>
+
+#if defined(_M_IX86) || defined(_M_X64) || defined(__SSE2__)
+#define ALPHA_COLLISION_SSE2
+#include <emmintrin.h>
+#elif defined(_M_ARM) || defined(__ARM_NEON__) || defined(__ARM_NEON)
+#define ALPHA_COLLISION_NEON
+#include <arm_neon.h>
+#endif
+
+namespace
+{
+	// Narrows the range of columns [first, last] of a row of sprite one to the columns whose position in sprite two on one axis,
+	// rowStart + (column * step), is in [low, high]. If no column is in range (including when the range of positions is empty because low is
+	// greater than high) then first will end up greater than last.
+	// rowStart - The position of column 0 on this axis.
+	// step - The amount that the position changes from one column to the next on this axis.
+	// low, high - The range of positions.
+	// first, last - The range of columns to narrow. These are real numbers; round first up and last down to get whole columns.
+	inline void ClipColumnRange(
+		double rowStart,
+		double step,
+		double low,
+		double high,
+		double& first,
+		double& last
+		)
+	{
+		// The inner (safe) range shrinks by the margin on both sides so it is empty for sprites that are only a texel or two across.
+		if (low > high)
+		{
+			first = 1.0;
+			last = 0.0;
+			return;
+		}
+
+		if (step == 0.0)
+		{
+			// Every column has the same position so either they're all in range or none of them are.
+			if (rowStart < low || rowStart > high)
+			{
+				first = 1.0;
+				last = 0.0;
+			}
+			return;
+		}
+
+		// A negative step runs through the positions backwards, so the low position gives the high column.
+		auto lowColumn = (low - rowStart) / step;
+		auto highColumn = (high - rowStart) / step;
+		if (lowColumn > highColumn)
+		{
+			std::swap(lowColumn, highColumn);
+		}
+
+		first = std::max(first, lowColumn);
+		last = std::min(last, highColumn);
+	}
+}
+
+bool DX::IsRowAlphaOverlap(
+	const uint8_t* rowOne,
+	const uint8_t* rowTwo,
+	uint32_t texelCount
+	)
+{
+	uint32_t i = 0;
+
+#if defined(ALPHA_COLLISION_SSE2)
+	// Each 32-bit lane holds one BGRA texel so masking with 0xFF000000 leaves just the alpha byte.
+	const __m128i alphaMask = _mm_set1_epi32(static_cast<int>(0xFF000000));
+	const __m128i zero = _mm_setzero_si128();
+
+	// A lane ends up all ones if the texel from either sprite is transparent (i.e. the texels can't collide). We then AND four groups of four
+	// texels together such that any lane that isn't all ones means that at least one of the 16 texels collided.
+	for (; i + 16 <= texelCount; i += 16)
+	{
+		auto offset = i * 4;
+		__m128i noHit = _mm_or_si128(
+			_mm_cmpeq_epi32(_mm_and_si128(_mm_loadu_si128(reinterpret_cast<const __m128i*>(rowOne + offset)), alphaMask), zero),
+			_mm_cmpeq_epi32(_mm_and_si128(_mm_loadu_si128(reinterpret_cast<const __m128i*>(rowTwo + offset)), alphaMask), zero)
+			);
+		noHit = _mm_and_si128(noHit, _mm_or_si128(
+			_mm_cmpeq_epi32(_mm_and_si128(_mm_loadu_si128(reinterpret_cast<const __m128i*>(rowOne + offset + 16)), alphaMask), zero),
+			_mm_cmpeq_epi32(_mm_and_si128(_mm_loadu_si128(reinterpret_cast<const __m128i*>(rowTwo + offset + 16)), alphaMask), zero)
+			));
+		noHit = _mm_and_si128(noHit, _mm_or_si128(
+			_mm_cmpeq_epi32(_mm_and_si128(_mm_loadu_si128(reinterpret_cast<const __m128i*>(rowOne + offset + 32)), alphaMask), zero),
+			_mm_cmpeq_epi32(_mm_and_si128(_mm_loadu_si128(reinterpret_cast<const __m128i*>(rowTwo + offset + 32)), alphaMask), zero)
+			));
+		noHit = _mm_and_si128(noHit, _mm_or_si128(
+			_mm_cmpeq_epi32(_mm_and_si128(_mm_loadu_si128(reinterpret_cast<const __m128i*>(rowOne + offset + 48)), alphaMask), zero),
+			_mm_cmpeq_epi32(_mm_and_si128(_mm_loadu_si128(reinterpret_cast<const __m128i*>(rowTwo + offset + 48)), alphaMask), zero)
+			));
+
+		if (_mm_movemask_epi8(noHit) != 0xFFFF)
+		{
+			return true;
+		}
+	}
+
+	// Handle any remaining groups of four texels the same way.
+	for (; i + 4 <= texelCount; i += 4)
+	{
+		auto offset = i * 4;
+		__m128i noHit = _mm_or_si128(
+			_mm_cmpeq_epi32(_mm_and_si128(_mm_loadu_si128(reinterpret_cast<const __m128i*>(rowOne + offset)), alphaMask), zero),
+			_mm_cmpeq_epi32(_mm_and_si128(_mm_loadu_si128(reinterpret_cast<const __m128i*>(rowTwo + offset)), alphaMask), zero)
+			);
+
+		if (_mm_movemask_epi8(noHit) != 0xFFFF)
+		{
+			return true;
+		}
+	}
+#elif defined(ALPHA_COLLISION_NEON)
+	// Each 32-bit lane holds one BGRA texel. vtstq_u32 sets a lane to all ones if the alpha byte is non-zero, so ANDing the results for both
+	// sprites leaves a lane set only where the texels collide. We OR two groups of four texels together and check whether any lane is set.
+	const uint32x4_t alphaMask = vdupq_n_u32(0xFF000000);
+
+	for (; i + 8 <= texelCount; i += 8)
+	{
+		auto offset = i * 4;
+		uint32x4_t hit = vandq_u32(
+			vtstq_u32(vld1q_u32(reinterpret_cast<const uint32_t*>(rowOne + offset)), alphaMask),
+			vtstq_u32(vld1q_u32(reinterpret_cast<const uint32_t*>(rowTwo + offset)), alphaMask)
+			);
+		hit = vorrq_u32(hit, vandq_u32(
+			vtstq_u32(vld1q_u32(reinterpret_cast<const uint32_t*>(rowOne + offset + 16)), alphaMask),
+			vtstq_u32(vld1q_u32(reinterpret_cast<const uint32_t*>(rowTwo + offset + 16)), alphaMask)
+			));
+
+		uint32x2_t halves = vorr_u32(vget_low_u32(hit), vget_high_u32(hit));
+		if (vget_lane_u32(vpmax_u32(halves, halves), 0) != 0)
+		{
+			return true;
+		}
+	}
+#endif
+
+	// Test whatever is left one texel at a time.
+	return IsRowAlphaOverlapScalar(rowOne + (i * 4), rowTwo + (i * 4), texelCount - i);
+}
+
+bool DX::IsRowAlphaOverlapScalar(
+	const uint8_t* rowOne,
+	const uint8_t* rowTwo,
+	uint32_t texelCount
+	)
+{
+	// Byte 3 of each texel is the alpha value (BGRA ordering).
+	for (uint32_t i = 0; i < texelCount; i++)
+	{
+		if ((rowOne[(i * 4) + 3] != 0) && (rowTwo[(i * 4) + 3] != 0))
+		{
+			return true;
+		}
+	}
+
+	return false;
+}
+
+bool DX::IsTransformedAlphaCollision(
+	const uint8_t* dataOne,
+	uint32_t texOneWidth,
+	uint32_t columnCount,
+	uint32_t rowCount,
+	const uint8_t* dataTwo,
+	int32_t texTwoWidth,
+	int32_t texTwoHeight,
+	TexelVector origin,
+	TexelVector stepX,
+	TexelVector stepY
+	)
+{
+	if (columnCount == 0)
+	{
+		return false;
+	}
+
+	TexelVector yPositionInSpriteTwo = origin;
+	auto lastColumn = static_cast<double>(columnCount - 1);
+
+	for (uint32_t spriteOneY = 0; spriteOneY < rowCount; spriteOneY++)
+	{
+		// Each addition of stepX can be off by half of an ulp of the result so bound the total error across the row and keep at least one texel
+		// of margin on top of that. The positions are rounded to the nearest texel so texels from -0.5 to (width - 0.5) are inside of sprite two.
+		double rowX = yPositionInSpriteTwo.x;
+		double rowY = yPositionInSpriteTwo.y;
+		double endX = rowX + (lastColumn * stepX.x);
+		double endY = rowY + (lastColumn * stepX.y);
+		auto largest = std::max(std::max(std::fabs(rowX), std::fabs(endX)), std::max(std::fabs(rowY), std::fabs(endY))) +
+			std::max(std::fabs(static_cast<double>(stepX.x)), std::fabs(static_cast<double>(stepX.y)));
+		auto margin = 1.0 + (static_cast<double>(columnCount) * largest / 8388608.0);
+
+		// The columns that might land inside of sprite two...
+		double first = 0.0;
+		double last = lastColumn;
+		ClipColumnRange(rowX, stepX.x, -0.5 - margin, (texTwoWidth - 0.5) + margin, first, last);
+		ClipColumnRange(rowY, stepX.y, -0.5 - margin, (texTwoHeight - 0.5) + margin, first, last);
+
+		// ... and the columns that definitely do.
+		double safeFirst = 0.0;
+		double safeLast = lastColumn;
+		ClipColumnRange(rowX, stepX.x, -0.5 + margin, (texTwoWidth - 0.5) - margin, safeFirst, safeLast);
+		ClipColumnRange(rowY, stepX.y, -0.5 + margin, (texTwoHeight - 0.5) - margin, safeFirst, safeLast);
+
+		if (first <= last)
+		{
+			auto startColumn = static_cast<uint32_t>(std::ceil(first));
+			auto endColumn = static_cast<uint32_t>(std::floor(last)) + 1;
+			auto safeStartColumn = endColumn;
+			auto safeEndColumn = endColumn;
+			if (safeFirst <= safeLast)
+			{
+				safeStartColumn = std::min(std::max(static_cast<uint32_t>(std::ceil(safeFirst)), startColumn), endColumn);
+				safeEndColumn = std::min(std::max(static_cast<uint32_t>(std::floor(safeLast)) + 1, safeStartColumn), endColumn);
+			}
+
+			// Start at the beginning of the row for sprite two and step to the first column that might be inside of sprite two.
+			TexelVector positionInSpriteTwo = yPositionInSpriteTwo;
+			for (uint32_t spriteOneX = 0; spriteOneX < startColumn; spriteOneX++)
+			{
+				positionInSpriteTwo.x += stepX.x;
+				positionInSpriteTwo.y += stepX.y;
+			}
+
+			auto rowOne = dataOne + (spriteOneY * texOneWidth * 4) + 3;
+			auto spriteOneX = startColumn;
+
+			// Tests the texel at spriteOneX with bounds checking and then moves to the next one.
+			auto testCheckedTexel = [&]() -> bool
+			{
+				// Round to the nearest pixel. Note that since sprite two values might be negative and we're using integer truncation, we need
+				// to add 0.5f to get to the nearest pixel if it's positive and -0.5f if it's negative.
+				int32_t spriteTwoX = static_cast<int32_t>(positionInSpriteTwo.x + (positionInSpriteTwo.x > 0.0f ? 0.5f : -0.5f));
+				int32_t spriteTwoY = static_cast<int32_t>(positionInSpriteTwo.y + (positionInSpriteTwo.y > 0.0f ? 0.5f : -0.5f));
+
+				bool isCollision = (spriteTwoX >= 0) && (spriteTwoX < texTwoWidth) && (spriteTwoY >= 0) && (spriteTwoY < texTwoHeight) &&
+					(rowOne[spriteOneX * 4] != 0) && (dataTwo[(spriteTwoX * 4 + spriteTwoY * texTwoWidth * 4) + 3] != 0);
+
+				positionInSpriteTwo.x += stepX.x;
+				positionInSpriteTwo.y += stepX.y;
+				spriteOneX++;
+
+				return isCollision;
+			};
+
+			// The columns before the safe range need bounds checks.
+			while (spriteOneX < safeStartColumn)
+			{
+				if (testCheckedTexel())
+				{
+					return true;
+				}
+			}
+
+			// The safe range doesn't need bounds checks. Test it in groups of 16 texels, combining the results without branching, and only
+			// check for a collision at the end of each group.
+			while (spriteOneX < safeEndColumn)
+			{
+				auto groupEnd = std::min(spriteOneX + 16, safeEndColumn);
+				int isCollision = 0;
+				for (; spriteOneX < groupEnd; spriteOneX++)
+				{
+					int32_t spriteTwoX = static_cast<int32_t>(positionInSpriteTwo.x + (positionInSpriteTwo.x > 0.0f ? 0.5f : -0.5f));
+					int32_t spriteTwoY = static_cast<int32_t>(positionInSpriteTwo.y + (positionInSpriteTwo.y > 0.0f ? 0.5f : -0.5f));
+
+					isCollision |= static_cast<int>(rowOne[spriteOneX * 4] != 0) & static_cast<int>(dataTwo[(spriteTwoX * 4 + spriteTwoY * texTwoWidth * 4) + 3] != 0);
+
+					positionInSpriteTwo.x += stepX.x;
+					positionInSpriteTwo.y += stepX.y;
+				}
+
+				if (isCollision != 0)
+				{
+					return true;
+				}
+			}
+
+			// The columns after the safe range need bounds checks. Anything past endColumn can't be inside of sprite two so the row ends there.
+			while (spriteOneX < endColumn)
+			{
+				if (testCheckedTexel())
+				{
+					return true;
+				}
+			}
+		}
+
+		// Move to the next sprite two row.
+		yPositionInSpriteTwo.x += stepY.x;
+		yPositionInSpriteTwo.y += stepY.y;
+	}
+
+	return false;
+}
@@ -0,0 +1,63 @@
+#pragma once
+
+// Portable (see README_PORTABLE.txt) so that the row kernel and the transformed scan can be checked and benchmarked against the original per texel
+// loops outside of the game.
+#include <cstdint>
+
+namespace DX
+{
+	// A position in, or a step across, sprite two's local space (texels). Has the same layout as DirectX::XMFLOAT2.
+	struct TexelVector
+	{
+		float					x;
+		float					y;
+	};
+
+	// Returns true if any texel in a row of B8G8R8A8 texels from sprite one has a non-zero alpha value at the same index as a texel with a
+	// non-zero alpha value in the matching row from sprite two. This is the row test behind the B8G8R8A8 version of IsPixelPerfectCollision. On
+	// SSE2 targets it tests 16 texels per loop iteration (then groups of 4) and on NEON targets 8 texels per loop iteration; any remaining texels
+	// (and all texels on other targets) are tested one at a time.
+	// rowOne - A pointer to the first texel in the row for sprite one.
+	// rowTwo - A pointer to the first texel in the row for sprite two.
+	// texelCount - The number of texels to test in each row.
+	bool IsRowAlphaOverlap(
+		const uint8_t* rowOne,
+		const uint8_t* rowTwo,
+		uint32_t texelCount
+		);
+
+	// The same test as IsRowAlphaOverlap, one texel at a time on every target. For checking and benchmarking the SIMD versions against.
+	bool IsRowAlphaOverlapScalar(
+		const uint8_t* rowOne,
+		const uint8_t* rowTwo,
+		uint32_t texelCount
+		);
+
+	// The scan behind the B8G8R8A8 version of IsTransformedPixelPerfectCollision (see CollisionDetection2D.h), once the transform from sprite one to
+	// sprite two has been calculated. Returns true if any texel of sprite one with a non-zero alpha value lands on (rounds to) a texel of sprite two
+	// with a non-zero alpha value.
+	// Each row of sprite one is clipped analytically to the columns that can land inside of sprite two so the columns (and rows) that can't
+	// are never tested. Positions in sprite two are still found by adding stepX once per column, exactly like the original per texel loop did,
+	// since that is the only way to get results that match it bit for bit; the columns before the clipped range just do those additions.
+	// Within the clipped range, the columns that are far enough inside of sprite two that rounding and floating point error can't take them outside
+	// are tested without any bounds checks or branches; only the few columns at each end of the range are bounds checked. Sprites that are too
+	// small to have any such columns (two texels or fewer across) are bounds checked throughout.
+	// dataOne, dataTwo - The B8G8R8A8 texture data of the sprites.
+	// texOneWidth - The width, in texels, of sprite one's rows in dataOne.
+	// columnCount, rowCount - The number of columns and rows of sprite one to test.
+	// texTwoWidth, texTwoHeight - The size of sprite two in texels.
+	// origin - The position in sprite two of sprite one's (0, 0) texel.
+	// stepX, stepY - The amounts that the position in sprite two changes when moving one column right or one row down in sprite one.
+	bool IsTransformedAlphaCollision(
+		const uint8_t* dataOne,
+		uint32_t texOneWidth,
+		uint32_t columnCount,
+		uint32_t rowCount,
+		const uint8_t* dataTwo,
+		int32_t texTwoWidth,
+		int32_t texTwoHeight,
+		TexelVector origin,
+		TexelVector stepX,
+		TexelVector stepY
+		);
+}
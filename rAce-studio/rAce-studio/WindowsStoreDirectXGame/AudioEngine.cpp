@@ -1,11 +1,19 @@
 #include "pch.h"
 #include "AudioEngine.h"
 
+#include "AdpcmDecoder.h"
 #include "DirectXHelper.h"
 #include "MediaStreamer.h"
+#include "SampleRateConverter.h"
+#include "SoundBank.h"
+#include "StreamingSoundEffect.h"
 
+#include <cmath>
+#include <float.h>
 #include <mfapi.h>
 #include <mfmediaengine.h>
+#include <ppl.h>
+#include <set>
 #if !defined(WINAPI_FAMILY) || (WINAPI_FAMILY != WINAPI_FAMILY_PHONE_APP)
 #include <Mferror.h>
 #endif
@@ -14,6 +22,204 @@
 #undef max
 
 using namespace Microsoft::WRL;
+
+namespace
+{
+	// Reads one byte from each page of some data so that the pages are resident before XAudio2's processing thread first reads them.
+	void TouchPages(const uint8* data, size_t size)
+	{
+		volatile uint8 touch = 0;
+		for (size_t offset = 0; offset < size; offset += 4096)
+		{
+			touch ^= data[offset];
+		}
+	}
+
+	// WAVE_FORMAT_WMAUDIO2 and WAVE_FORMAT_WMAUDIO3, the xWMA formats.
+	const uint16 WaveFormatWmaAudio2 = 0x0161;
+	const uint16 WaveFormatWmaAudio3 = 0x0162;
+
+	// The number of ADPCM blocks that each task decodes when a sound effect is decoded at load time. Sound effects with fewer blocks than this
+	// are decoded on the calling thread.
+	const size_t AdpcmBlocksPerTask = 256;
+
+	// Decodes ADPCM data to 16-bit PCM. The blocks are independent so large sound effects are split into runs of blocks that are decoded in
+	// parallel. parallel_for doesn't return until every run is done.
+	// format - The format of the data.
+	// data - The data.
+	// size - The size of the data in bytes.
+	// destination - Receives the samples. Must have room for DX::GetAdpcmFrameCount(format, size) frames.
+	void DecodeAdpcmData(const DX::AdpcmFormat& format, const uint8* data, size_t size, int16* destination)
+	{
+		size_t blockCount = size / format.m_blockAlign;
+		if (blockCount <= AdpcmBlocksPerTask)
+		{
+			DX::DecodeAdpcm(format, data, size, destination);
+			return;
+		}
+
+		size_t blockSamples = static_cast<size_t>(format.m_samplesPerBlock) * format.m_channels;
+		auto taskCount = static_cast<uint32>((blockCount + AdpcmBlocksPerTask - 1) / AdpcmBlocksPerTask);
+		concurrency::parallel_for(0U, taskCount, [=](uint32 task)
+		{
+			size_t firstBlock = task * AdpcmBlocksPerTask;
+			size_t count = std::min(AdpcmBlocksPerTask, blockCount - firstBlock);
+			DX::DecodeAdpcmBlocks(format, data + (firstBlock * format.m_blockAlign), count, destination + (firstBlock * blockSamples));
+		});
+
+		// A short last block.
+		size_t remainder = size % format.m_blockAlign;
+		if (remainder != 0)
+		{
+			DX::DecodeAdpcmBlock(format, data + (blockCount * format.m_blockAlign), remainder, destination + (blockCount * blockSamples));
+		}
+	}
+
+	// Returns true if a format is one that SampleRateConverter can convert: 16-bit PCM or 32-bit float.
+	inline bool IsConvertibleFormat(const WAVEFORMATEX& waveFormat)
+	{
+		return (waveFormat.wFormatTag == WAVE_FORMAT_PCM && waveFormat.wBitsPerSample == 16) ||
+			(waveFormat.wFormatTag == WAVE_FORMAT_IEEE_FLOAT && waveFormat.wBitsPerSample == 32);
+	}
+
+	// Sets up a sound effect's audio buffer for its data and the format in its m_waveFormat. PCM, IEEE float and MS-ADPCM data is played in
+	// place (MS-ADPCM is trimmed to whole blocks), IMA ADPCM is decoded to 16-bit PCM since XAudio2 can't play it, and xWMA gets its seek
+	// table. 16-bit PCM (including decoded IMA ADPCM) and 32-bit float data is then converted to the output rate if a converter is passed in.
+	// A loop region that the format can't use is dropped so that the whole sound effect loops instead. Only touches the one sound effect, so
+	// different sound effects can be prepared on different threads at the same time.
+	// soundEffect - The sound effect. Its m_waveFormat, loop region, (for xWMA) m_seekTable and its raw data (m_audioBuffer.pAudioData and
+	// AudioBytes) must already be set.
+	// converter - The converter from the sound effect's sample rate to the output rate, or nullptr to keep the sound effect's rate.
+	void PrepareSoundEffectData(SoundEffect* soundEffect, const DX::SampleRateConverter* converter)
+	{
+		auto data = static_cast<const uint8*>(soundEffect->m_audioBuffer.pAudioData);
+		uint32 size = soundEffect->m_audioBuffer.AudioBytes;
+		uint16 formatTag = reinterpret_cast<const WAVEFORMATEX*>(soundEffect->m_waveFormat.data())->wFormatTag;
+
+		ZeroMemory(&soundEffect->m_audioBuffer, sizeof(soundEffect->m_audioBuffer));
+		ZeroMemory(&soundEffect->m_wmaBuffer, sizeof(soundEffect->m_wmaBuffer));
+		soundEffect->m_decodedData.clear();
+
+		if (formatTag == DX::WaveFormatMsAdpcm || formatTag == DX::WaveFormatImaAdpcm)
+		{
+			DX::AdpcmFormat format;
+			DX::ThrowIfFailed(
+				(DX::ParseAdpcmFormat(soundEffect->m_waveFormat.data(), soundEffect->m_waveFormat.size(), format) ? S_OK : E_FAIL), __FILEW__, __LINE__
+				);
+
+			// Loop regions aren't checked against the data by the WAV parser for compressed formats, so check them here.
+			auto frameCount = DX::GetAdpcmFrameCount(format, size);
+			if (soundEffect->m_loopLength != 0 && static_cast<uint64>(soundEffect->m_loopBegin) + soundEffect->m_loopLength > frameCount)
+			{
+				soundEffect->m_loopBegin = 0;
+				soundEffect->m_loopLength = 0;
+			}
+
+			if (formatTag == DX::WaveFormatMsAdpcm)
+			{
+				// XAudio2 plays MS-ADPCM natively but only whole blocks of it, and it can only loop on block boundaries.
+				size = (size / format.m_blockAlign) * format.m_blockAlign;
+				if ((soundEffect->m_loopBegin % format.m_samplesPerBlock) != 0 || (soundEffect->m_loopLength % format.m_samplesPerBlock) != 0)
+				{
+#if defined(_DEBUG)
+					OutputDebugStringW(std::wstring(L"The loop region of '").append(soundEffect->m_name->Data()).append(L"' is not on block boundaries. The whole sound effect will loop instead.\n").c_str());
+#endif
+					soundEffect->m_loopBegin = 0;
+					soundEffect->m_loopLength = 0;
+				}
+			}
+			else
+			{
+				// Decode IMA ADPCM to 16-bit PCM, which is four times the size, and play that instead.
+				DX::ThrowIfFailed(
+					((frameCount * format.m_channels * sizeof(int16) <= 0xFFFFFFFFU) ? S_OK : E_FAIL), __FILEW__, __LINE__
+					);
+				soundEffect->m_decodedData.resize(static_cast<size_t>(frameCount * format.m_channels * sizeof(int16)));
+				DecodeAdpcmData(format, data, size, reinterpret_cast<int16*>(soundEffect->m_decodedData.data()));
+
+				WAVEFORMATEX pcmFormat;
+				pcmFormat.wFormatTag = WAVE_FORMAT_PCM;
+				pcmFormat.nChannels = format.m_channels;
+				pcmFormat.nSamplesPerSec = format.m_samplesPerSecond;
+				pcmFormat.nBlockAlign = static_cast<WORD>(format.m_channels * sizeof(int16));
+				pcmFormat.nAvgBytesPerSec = pcmFormat.nSamplesPerSec * pcmFormat.nBlockAlign;
+				pcmFormat.wBitsPerSample = 16;
+				pcmFormat.cbSize = 0;
+
+				auto pcmFormatBytes = reinterpret_cast<const uint8*>(&pcmFormat);
+				soundEffect->m_waveFormat.assign(pcmFormatBytes, pcmFormatBytes + sizeof(pcmFormat));
+
+				// Nothing else needs the mapping now. The data of a sound bank stays mapped for the bank's other sound effects.
+				soundEffect->m_soundEffectFile.reset();
+
+				data = soundEffect->m_decodedData.data();
+				size = static_cast<uint32>(soundEffect->m_decodedData.size());
+			}
+		}
+		else if (formatTag == WaveFormatWmaAudio2 || formatTag == WaveFormatWmaAudio3)
+		{
+			// XAudio2 plays xWMA natively but needs the seek table from the file's 'dpds' chunk, and xWMA buffers can only loop as a whole.
+			DX::ThrowIfFailed(
+				(!soundEffect->m_seekTable.empty() ? S_OK : E_FAIL), __FILEW__, __LINE__
+				);
+			soundEffect->m_wmaBuffer.pDecodedPacketCumulativeBytes = soundEffect->m_seekTable.data();
+			soundEffect->m_wmaBuffer.PacketCount = static_cast<UINT32>(soundEffect->m_seekTable.size());
+			soundEffect->m_loopBegin = 0;
+			soundEffect->m_loopLength = 0;
+		}
+
+		// Convert 16-bit PCM (including decoded IMA ADPCM) and 32-bit float data to the output rate.
+		auto waveFormat = reinterpret_cast<WAVEFORMATEX*>(soundEffect->m_waveFormat.data());
+		if (converter != nullptr && waveFormat->nSamplesPerSec == converter->GetInputRate() && IsConvertibleFormat(*waveFormat))
+		{
+			uint32 frameCount = size / waveFormat->nBlockAlign;
+			auto outputFrameCount = converter->GetOutputFrameCount(frameCount);
+			DX::ThrowIfFailed(
+				((outputFrameCount * waveFormat->nBlockAlign <= 0xFFFFFFFFU) ? S_OK : E_FAIL), __FILEW__, __LINE__
+				);
+
+			std::vector<uint8> converted(static_cast<size_t>(outputFrameCount * waveFormat->nBlockAlign));
+			if (waveFormat->wBitsPerSample == 16)
+			{
+				converter->Convert(reinterpret_cast<const int16*>(data), frameCount, waveFormat->nChannels, reinterpret_cast<int16*>(converted.data()));
+			}
+			else
+			{
+				converter->Convert(reinterpret_cast<const float*>(data), frameCount, waveFormat->nChannels, reinterpret_cast<float*>(converted.data()));
+			}
+
+			soundEffect->m_decodedData.swap(converted);
+			soundEffect->m_soundEffectFile.reset();
+
+			waveFormat->nSamplesPerSec = converter->GetOutputRate();
+			waveFormat->nAvgBytesPerSec = waveFormat->nSamplesPerSec * waveFormat->nBlockAlign;
+
+			if (soundEffect->m_loopLength != 0)
+			{
+				auto loopBegin = converter->ConvertFramePosition(soundEffect->m_loopBegin);
+				auto loopEnd = std::min(converter->ConvertFramePosition(static_cast<uint64>(soundEffect->m_loopBegin) + soundEffect->m_loopLength), outputFrameCount);
+				soundEffect->m_loopBegin = static_cast<uint32>(loopBegin);
+				soundEffect->m_loopLength = (loopEnd > loopBegin) ? static_cast<uint32>(loopEnd - loopBegin) : 0U;
+				if (soundEffect->m_loopLength == 0)
+				{
+					soundEffect->m_loopBegin = 0;
+				}
+			}
+
+			data = soundEffect->m_decodedData.data();
+			size = static_cast<uint32>(soundEffect->m_decodedData.size());
+		}
+
+		// Touch each page of the data now so that the first play doesn't take the page faults on XAudio2's processing thread.
+		TouchPages(data, size);
+
+		soundEffect->m_soundEffectBufferLength = size;
+		soundEffect->m_soundEffectSampleRate = reinterpret_cast<const WAVEFORMATEX*>(soundEffect->m_waveFormat.data())->nSamplesPerSec;
+		soundEffect->m_audioBuffer.AudioBytes = size;
+		soundEffect->m_audioBuffer.Flags = XAUDIO2_END_OF_STREAM; // The XAUDIO2_END_OF_STREAM flag must be set or the source voices will never mark themselves as done playing.
+		soundEffect->m_audioBuffer.pAudioData = data;
+	}
+}
 using namespace WindowsStoreDirectXGame;
 
 MediaFoundationStartupShutdown::MediaFoundationStartupShutdown() :
@@ -138,14 +344,299 @@ void MediaEngineNotify::InitializeVariables()
 	m_previousMusicFinished = false;
 }
 
+void __stdcall SourceVoice::OnBufferEnd(void* pBufferContext)
+{
+	m_pool->OnBufferEnd(this, static_cast<uint32>(reinterpret_cast<uintptr_t>(pBufferContext)));
+}
+
+void __stdcall SourceVoice::OnLoopEnd(void* pBufferContext)
+{
+	UNREFERENCED_PARAMETER(pBufferContext);
+
+	m_pool->OnLoopEnd(this);
+}
+
+void __stdcall SourceVoice::OnVoiceError(void* pBufferContext, HRESULT Error)
+{
+	UNREFERENCED_PARAMETER(pBufferContext);
+
+	m_pool->OnVoiceError(this, Error);
+}
+
+static_assert(DX::VoiceScheduler<VoicePlay>::LoopInfinite == XAUDIO2_LOOP_INFINITE, "The scheduler counts loops down like XAudio2 does.");
+
+struct VoicePool::XAudio2Voices
+{
+	explicit XAudio2Voices(VoicePool* pool) :
+		m_pool(pool)
+	{
+	}
+
+	IXAudio2SourceVoice* Get(uint32 voice) const { return m_pool->m_voices[voice]->m_soundEffectSourceVoice.Get(); }
+
+	bool IsCreated(uint32 voice) const { return Get(voice) != nullptr; }
+
+	int32 Submit(uint32 voice, const VoicePlay& play, uint32 playId) const
+	{
+		// The play id goes in the buffer context so that OnBufferEnd can pass it back.
+		XAUDIO2_BUFFER buffer = play.m_buffer;
+		buffer.pContext = reinterpret_cast<void*>(static_cast<uintptr_t>(playId));
+		return Get(voice)->SubmitSourceBuffer(&buffer, (play.m_wmaBuffer.PacketCount != 0) ? &play.m_wmaBuffer : nullptr);
+	}
+
+	int32 Start(uint32 voice) const { return Get(voice)->Start(); }
+	int32 Stop(uint32 voice, uint32 flags) const { return Get(voice)->Stop(flags); }
+	int32 Flush(uint32 voice) const { return Get(voice)->FlushSourceBuffers(); }
+	int32 SetVolume(uint32 voice, float volume) const { return Get(voice)->SetVolume(volume); }
+
+	int32 SetOutput(uint32 voice, const Scheduler::Command& command) const
+	{
+		return m_pool->SetOutput(Get(voice), m_pool->m_voices[voice].get(), command);
+	}
+
+	VoicePool*		m_pool;
+};
+
+VoicePool::VoicePool() :
+	m_engine(),
+	m_outputChannels(),
+	m_waveFormats(),
+	m_voices(),
+	m_voicesPerFormat(DefaultVoicesPerFormat),
+	m_scheduler()
+{
+}
+
+void VoicePool::SetVoicesPerFormat(uint32 count)
+{
+	if (count == 0 || count > MaxVoices)
+	{
+		throw ref new Platform::InvalidArgumentException(L"count");
+	}
+
+	m_voicesPerFormat = count;
+}
+
+uint32 VoicePool::AddFormat(const std::vector<uint8>& waveFormat)
+{
+	// There are only ever a handful of formats so a linear search is fine. This is only done when sound effects are loaded.
+	for (uint32 i = 0; i < m_waveFormats.size(); ++i)
+	{
+		if (m_waveFormats[i] == waveFormat)
+		{
+			return i;
+		}
+	}
+
+	if (m_voices.size() + m_voicesPerFormat > MaxVoices)
+	{
+		throw ref new Platform::FailureException();
+	}
+
+	auto group = m_scheduler.AddGroup(m_voicesPerFormat);
+	m_waveFormats.push_back(waveFormat);
+
+	for (uint32 i = 0; i < m_voicesPerFormat; ++i)
+	{
+		std::unique_ptr<SourceVoice> sourceVoice(new SourceVoice());
+		sourceVoice->m_pool = this;
+		sourceVoice->m_index = static_cast<uint32>(m_voices.size());
+		sourceVoice->m_channels = reinterpret_cast<const WAVEFORMATEX*>(waveFormat.data())->nChannels;
+		m_voices.push_back(std::move(sourceVoice));
+	}
+
+	// Create the voices now rather than the first time they are played.
+	if (m_engine != nullptr)
+	{
+		for (uint32 i = 0; i < m_voicesPerFormat; ++i)
+		{
+			CreateVoice(m_voices[m_scheduler.GetFirstVoice(group) + i].get());
+		}
+	}
+
+	return group;
+}
+
+void VoicePool::CreateVoices(IXAudio2* engine, uint32 outputChannels)
+{
+	m_engine = engine;
+	m_outputChannels = outputChannels;
+
+	for (auto& sv : m_voices)
+	{
+		CreateVoice(sv.get());
+	}
+}
+
+void VoicePool::DestroyVoices()
+{
+	m_scheduler.DestroyVoices([this](uint32 voice) { m_voices[voice]->m_soundEffectSourceVoice.Reset(); });
+
+	m_engine = nullptr;
+}
+
+SourceVoice* VoicePool::AcquireVoice(uint32 group, uint32 priority)
+{
+	auto voice = m_scheduler.Acquire(group, priority);
+	return (voice != Scheduler::NoVoice) ? m_voices[voice].get() : nullptr;
+}
+
+void VoicePool::StartVoice(
+	SourceVoice* sv,
+	const XAUDIO2_BUFFER& buffer,
+	const XAUDIO2_BUFFER_WMA& wmaBuffer,
+	SoundHandle soundEffect,
+	uint32 priority,
+	uint32 loopCount
+	)
+{
+	VoicePlay play;
+	play.m_buffer = buffer;
+	play.m_wmaBuffer = wmaBuffer;
+	m_scheduler.Start(sv->m_index, play, GetSoundId(soundEffect), priority, loopCount);
+}
+
+void VoicePool::ReleaseVoices(
+	uint32 group,
+	SoundHandle soundEffect
+	)
+{
+	auto sound = GetSoundId(soundEffect);
+	auto firstVoice = m_scheduler.GetFirstVoice(group);
+
+	for (uint32 i = firstVoice; i < firstVoice + m_scheduler.GetGroupVoiceCount(group); ++i)
+	{
+		if (m_scheduler.IsStarted(i) && m_scheduler.GetSound(i) == sound)
+		{
+			// Stopping a voice doesn't guarantee that XAudio2 is done with its buffer but destroying it does. See xaudio2_voice_ptr.
+			RecreateVoice(m_voices[i].get());
+			FreeVoice(m_voices[i].get());
+		}
+	}
+}
+
+SoundHandle VoicePool::GetVoiceSoundEffect(SourceVoice* sv) const
+{
+	auto sound = m_scheduler.GetSound(sv->m_index);
+
+	SoundHandle soundEffect;
+	soundEffect.m_index = static_cast<uint32>(sound >> 32);
+	soundEffect.m_generation = static_cast<uint32>(sound);
+	return soundEffect;
+}
+
+void VoicePool::RecreateVoice(SourceVoice* sv)
+{
+	// The scheduler makes the audio thread skip the commands that were queued for the old voice. DestroyVoice waits for the audio thread to be
+	// idle, so once it returns the audio thread can't be in the middle of one of them either.
+	m_scheduler.RecreateVoice(sv->m_index, [this, sv]()
+	{
+		sv->m_soundEffectSourceVoice.Reset();
+
+		if (m_engine != nullptr)
+		{
+			CreateVoice(sv);
+		}
+	});
+}
+
+void VoicePool::CreateVoice(SourceVoice* sv)
+{
+	// Destroy the old voice (if any) first since operator& doesn't.
+	sv->m_soundEffectSourceVoice.Reset();
+
+	// Create an IXAudio2SourceVoice with the group's format. We use the default values for flags and maxFrequency so
+	// that we can set our source voice to be the IXAudio2VoiceCallback. So 0U and 2.0f aren't magic numbers, they're just
+	// the defaults that XAudio2 would give us anyway if we didn't need to set an IXAudio2VoiceCallback. You could change
+	// them, though there are unlikely to be any flags you would want.
+	const auto& waveFormat = m_waveFormats[m_scheduler.GetGroup(sv->m_index)];
+	DX::ThrowIfFailed(
+		m_engine->CreateSourceVoice(&sv->m_soundEffectSourceVoice, reinterpret_cast<const WAVEFORMATEX*>(waveFormat.data()), 0U, 2.0f, sv), __FILEW__, __LINE__
+		);
+
+	// Keep the default output matrix so that a voice can go back to it after a positional play. No command that reads it can be queued for
+	// the voice until this returns.
+	sv->m_defaultOutputMatrix.resize(sv->m_channels * m_outputChannels);
+	sv->m_soundEffectSourceVoice->GetOutputMatrix(nullptr, sv->m_channels, m_outputChannels, sv->m_defaultOutputMatrix.data());
+}
+
+void VoicePool::ExecuteCommands()
+{
+	XAudio2Voices voices(this);
+	m_scheduler.ExecuteCommands(voices);
+}
+
+HRESULT VoicePool::SetOutput(IXAudio2SourceVoice* voice, SourceVoice* sv, const Scheduler::Command& command)
+{
+	if ((command.m_value & Scheduler::DefaultOutputFlag) != 0)
+	{
+		HRESULT hr = voice->SetOutputMatrix(nullptr, sv->m_channels, m_outputChannels, sv->m_defaultOutputMatrix.data());
+		return SUCCEEDED(hr) ? voice->SetFrequencyRatio(1.0f) : hr;
+	}
+
+	if ((command.m_value & Scheduler::OutputMatrixFlag) != 0)
+	{
+		// The matrix has one row per output channel and one column per voice channel. Positional plays only have one or two channels. The
+		// left and right gains go to the first two output channels (front left and front right in every speaker layout), and a mono output
+		// gets the default mix scaled by the attenuation.
+		float matrix[2 * XAUDIO2_MAX_AUDIO_CHANNELS];
+		uint32 size = sv->m_channels * m_outputChannels;
+		if (m_outputChannels < 2)
+		{
+			for (uint32 i = 0; i < size; ++i)
+			{
+				matrix[i] = sv->m_defaultOutputMatrix[i] * command.m_volume;
+			}
+		}
+		else
+		{
+			std::fill(matrix, matrix + size, 0.0f);
+			matrix[0] = command.m_left;
+			matrix[sv->m_channels + (sv->m_channels - 1)] = command.m_right;
+		}
+
+		HRESULT hr = voice->SetOutputMatrix(nullptr, sv->m_channels, m_outputChannels, matrix);
+		if (FAILED(hr))
+		{
+			return hr;
+		}
+	}
+
+	if ((command.m_value & Scheduler::FrequencyRatioFlag) != 0)
+	{
+		return voice->SetFrequencyRatio(command.m_frequencyRatio);
+	}
+
+	return S_OK;
+}
+
 AudioEngine::AudioEngine() :
 	m_soundEffectsEngineCallbacks(),
 	m_musicEngine(),
+	m_nextMusicEngine(),
 	m_soundEffectsEngine(),
 	m_mediaEngineNotify(),
+	m_nextMediaEngineNotify(),
 	m_masteringVoice(),
-	m_soundEffectsMap(),
+	m_soundEffectIndices(),
+	m_soundEffects(),
+	m_freeSoundEffectIndices(),
+	m_sampleRateConverters(),
+	m_nextSoundEffectGeneration(),
+	m_voicePool(),
+	m_listener(),
+	m_positionalAudioSettings(),
+	m_positionalBatch(),
+	m_positionalVoices(),
+	m_streamingSoundEffectsMap(),
 	m_musicQueue(),
+	m_nextMusicFilename(),
+	m_nextMusicFailed(),
+	m_musicCrossfadeDuration(),
+	m_musicFadeDuration(),
+	m_musicFading(),
+	m_lastMusicTime(),
+	m_musicUpdateInterval(),
 	m_mediaFoundationStartupShutdown(),
 	m_musicDisabledNoMediaFoundation(),
 	m_musicOff(),
@@ -156,10 +647,18 @@ AudioEngine::AudioEngine() :
 	m_musicIsPaused(),
 	m_musicPosition(-1.0) // We use a negative number to denote that we do not need to seek to any particular point.
 {
+	// The audio thread carries out the voice pool's commands at the start of each processing pass.
+	m_soundEffectsEngineCallbacks.m_voicePool = &m_voicePool;
+
+	// Every voice could be playing positionally at once.
+	m_positionalBatch.Reserve(VoicePool::MaxVoices);
+	m_positionalVoices.reserve(VoicePool::MaxVoices);
 }
 
 AudioEngine::~AudioEngine()
 {
+	// Stop the audio thread before the voice pool (which it uses) is destroyed.
+	ShutdownSoundEffectsEngine();
 }
 
 void AudioEngine::InitializeSoundEffectsEngine()
@@ -213,6 +712,12 @@ void AudioEngine::InitializeSoundEffectsEngine()
 			m_soundEffectsEngine->StartEngine(), __FILEW__, __LINE__
 			);
 
+		// Create the pooled source voices for the formats of the sound effects that are already loaded. Their output matrices have a row for
+		// each of the mastering voice's channels.
+		XAUDIO2_VOICE_DETAILS masteringDetails;
+		m_masteringVoice->GetVoiceDetails(&masteringDetails);
+		m_voicePool.CreateVoices(m_soundEffectsEngine.Get(), masteringDetails.InputChannels);
+
 		m_soundEffectsOff = false;
 
 		SetSoundEffectsVolume(m_soundEffectsVolume);
@@ -240,10 +745,13 @@ void AudioEngine::InitializeSoundEffectsEngine()
 
 void AudioEngine::ShutdownSoundEffectsEngine()
 {
-	// Clear all source voices (if any) in the sound effects std::map.
-	for (auto& voice : m_soundEffectsMap)
+	// Destroy the pooled source voices (if any). The pool remembers their formats so that they are created again with the next engine.
+	m_voicePool.DestroyVoices();
+
+	// Destroy the source voices of the streaming sound effects. They are created again the next time each one is played.
+	for (auto& item : m_streamingSoundEffectsMap)
 	{
-		voice.second->m_sourceVoices.clear();
+		item.second->DestroyVoice();
 	}
 
 	// Reset the mastering voice (if any).
@@ -259,6 +767,9 @@ void AudioEngine::ShutdownSoundEffectsEngine()
 	// Reset the IXaudio2 engine (if any).
 	m_soundEffectsEngine.Reset();
 
+	// There is no audio thread now, so drop the voice commands that it didn't get to.
+	m_voicePool.DiscardCommands();
+
 	// Note that sound effects are off.
 	m_soundEffectsOff = true;
 }
@@ -276,77 +787,21 @@ void AudioEngine::InitializeMusicEngine()
 	if (!m_musicDisabledNoMediaFoundation)
 	{
 		ComPtr<IMFMediaEngineClassFactory> mediaEngineFactory;
-		ComPtr<IMFAttributes> mediaEngineAttributes;
-		ComPtr<IMFMediaEngine> mfMediaEngine;
-		ComPtr<IUnknown> notifyAsIUnknown;
 #if !defined(_DEBUG)
 		// In a debug build we want any failures to throw so we can know about them. In a release build you should use the various
 		// catch statements to log the problem instead (and then re-throw or continue without music, depending on your preference).
 		try
 		{
 #endif
-			// Create the class factory for the Media Engine, from which we will create a media engine.
+			// Create the class factory for the Media Engine, from which we will create the media engines.
 			DX::ThrowIfFailed(
 				CoCreateInstance(CLSID_MFMediaEngineClassFactory, nullptr, CLSCTX_INPROC_SERVER, IID_PPV_ARGS(&mediaEngineFactory)), __FILEW__, __LINE__
 				);
 
-			// Define configuration attributes for the media engine.
-			UINT32 meAttrInitialSize = 1;
-#if defined(WINAPI_FAMILY) && (WINAPI_FAMILY == WINAPI_FAMILY_PHONE_APP)
-			meAttrInitialSize = 2;
-#endif
-			DX::ThrowIfFailed(
-				MFCreateAttributes(&mediaEngineAttributes, meAttrInitialSize), __FILEW__, __LINE__
-				);
-
-			// Create an instance of MediaEngineNotify. This call does all sorts of COM stuff automatically, which is why we 
-			// use Microsoft::WRL::RuntimeClass<T> rather than writing our own COM class.
-			m_mediaEngineNotify = Make<MediaEngineNotify>();
-
-			// Since we're using the RuntimeClass<T>'s constructor, we must call our InitializeVariables member function before proceeding.
-			m_mediaEngineNotify->InitializeVariables();
-
-			// To set our IMFMediaEngineNotify callback, we need to cast it as an IUnknown. Since it's a COM object at it's core, this is fine.
-			DX::ThrowIfFailed(
-				m_mediaEngineNotify.As(&notifyAsIUnknown), __FILEW__, __LINE__
-				);
-			DX::ThrowIfFailed(
-				mediaEngineAttributes->SetUnknown(MF_MEDIA_ENGINE_CALLBACK, notifyAsIUnknown.Get()), __FILEW__, __LINE__
-				);
-
-#if defined(WINAPI_FAMILY) && (WINAPI_FAMILY == WINAPI_FAMILY_PHONE_APP)
-			// If you wish to use this with a Windows Phone 8 project, we need to create this as a Frame-server mode media engine
-			// rather than as an Audio mode media engine. See http://msdn.microsoft.com/en-us/library/hh447921(v=vs.85).aspx for
-			// more details about these. Frame-server mode requires that we set the MF_MEDIA_ENGINE_VIDEO_OUTPUT_FORMAT attribute.
-			DX::ThrowIfFailed(
-				mediaEngineAttributes->SetUINT32(MF_MEDIA_ENGINE_VIDEO_OUTPUT_FORMAT, static_cast<UINT32>(DXGI_FORMAT_B8G8R8A8_UNORM))
-				);
-#endif
-
-			DWORD mfFlags = 0;
-#if !defined(WINAPI_FAMILY) || (WINAPI_FAMILY != WINAPI_FAMILY_PHONE_APP)
-			mfFlags |= MF_MEDIA_ENGINE_AUDIOONLY;
-#endif
-			// Create the media engine.
-			DX::ThrowIfFailed(
-				mediaEngineFactory->CreateInstance(mfFlags, mediaEngineAttributes.Get(), &mfMediaEngine), __FILEW__, __LINE__
-				);
-
-			// What we actually want is an IMFMediaEngineEx but there is no way to directly get one of those. Windows 8 returns an
-			// object that implements that interface when we call IMFMediaEngineClassFactory::CreateInstance though, so we can use
-			// ComPtr's As member function to QI (QueryInterface) the desired IMFMediaEngineEx and store the result in our class
-			// member variable.
-			mfMediaEngine.As(&m_musicEngine);
-
-			// Turn off autoplay such that merely setting a source alone will not start music playing instantly.
-			DX::ThrowIfFailed(
-				m_musicEngine->SetAutoPlay(FALSE), __FILEW__, __LINE__
-				);
-
-			// Turn looping off. We handle it ourselves.
-			DX::ThrowIfFailed(
-				m_musicEngine->SetLoop(FALSE), __FILEW__, __LINE__
-				);
+			// Create two media engines: one plays the current song while the other opens the next one ahead of time (see PrepareNextMusic)
+			// so that it can start without the gap that opening a file causes.
+			CreateMusicEngine(mediaEngineFactory.Get(), m_musicEngine, m_mediaEngineNotify);
+			CreateMusicEngine(mediaEngineFactory.Get(), m_nextMusicEngine, m_nextMediaEngineNotify);
 
 			// Once the music engine has been successfully created, we note that music is no longer off.
 			m_musicOff = false;
@@ -362,13 +817,7 @@ void AudioEngine::InitializeMusicEngine()
 
 
 			// Set music to off; this way if it was just a temporary issue, the user will be able to re-enable music and move forward.
-			m_mediaEngineNotify.Reset();
-
-			if (m_musicEngine != nullptr)
-			{
-				m_musicEngine->Shutdown(); // Ignore HRESULT since we can't do anything if it fails anyway.
-				m_musicEngine.Reset();
-			}
+			DestroyMusicEngines();
 
 			m_mediaFoundationStartupShutdown.Shutdown();
 			m_musicOff = true;
@@ -379,13 +828,7 @@ void AudioEngine::InitializeMusicEngine()
 
 
 			// Set music to off; this way if it was just a temporary issue, the user will be able to re-enable music and move forward.
-			m_mediaEngineNotify.Reset();
-
-			if (m_musicEngine != nullptr)
-			{
-				m_musicEngine->Shutdown(); // Ignore HRESULT since we can't do anything if it fails anyway.
-				m_musicEngine.Reset();
-			}
+			DestroyMusicEngines();
 
 			m_mediaFoundationStartupShutdown.Shutdown();
 			m_musicOff = true;
@@ -394,27 +837,119 @@ void AudioEngine::InitializeMusicEngine()
 	}
 }
 
-void AudioEngine::ShutdownMusicEngine()
+void AudioEngine::CreateMusicEngine(
+	IMFMediaEngineClassFactory* mediaEngineFactory,
+	ComPtr<IMFMediaEngineEx>& musicEngine,
+	ComPtr<MediaEngineNotify>& mediaEngineNotify
+	)
 {
-	m_mediaEngineNotify.Reset();
-
-	if (m_musicEngine != nullptr)
-	{
-		m_musicEngine->Shutdown(); // Ignore HRESULT since we can't do anything if it fails anyway.
-		m_musicEngine.Reset();
-	}
+	ComPtr<IMFAttributes> mediaEngineAttributes;
+	ComPtr<IMFMediaEngine> mfMediaEngine;
+	ComPtr<IUnknown> notifyAsIUnknown;
 
-	m_mediaFoundationStartupShutdown.Shutdown();
+	// Define configuration attributes for the media engine.
+	UINT32 meAttrInitialSize = 1;
+#if defined(WINAPI_FAMILY) && (WINAPI_FAMILY == WINAPI_FAMILY_PHONE_APP)
+	meAttrInitialSize = 2;
+#endif
+	DX::ThrowIfFailed(
+		MFCreateAttributes(&mediaEngineAttributes, meAttrInitialSize), __FILEW__, __LINE__
+		);
 
-	m_musicOff = true;
-}
+	// Create an instance of MediaEngineNotify. This call does all sorts of COM stuff automatically, which is why we 
+	// use Microsoft::WRL::RuntimeClass<T> rather than writing our own COM class.
+	mediaEngineNotify = Make<MediaEngineNotify>();
 
-UpdateErrorCodes AudioEngine::Update()
-{
-	UpdateErrorCodes result = UpdateErrorCodes::None;
+	// Since we're using the RuntimeClass<T>'s constructor, we must call our InitializeVariables member function before proceeding.
+	mediaEngineNotify->InitializeVariables();
 
-	// Process an error in the sound effects engine.
-	if (m_soundEffectsEngineCallbacks.m_error != S_OK)
+	// To set our IMFMediaEngineNotify callback, we need to cast it as an IUnknown. Since it's a COM object at it's core, this is fine.
+	DX::ThrowIfFailed(
+		mediaEngineNotify.As(&notifyAsIUnknown), __FILEW__, __LINE__
+		);
+	DX::ThrowIfFailed(
+		mediaEngineAttributes->SetUnknown(MF_MEDIA_ENGINE_CALLBACK, notifyAsIUnknown.Get()), __FILEW__, __LINE__
+		);
+
+#if defined(WINAPI_FAMILY) && (WINAPI_FAMILY == WINAPI_FAMILY_PHONE_APP)
+	// If you wish to use this with a Windows Phone 8 project, we need to create this as a Frame-server mode media engine
+	// rather than as an Audio mode media engine. See http://msdn.microsoft.com/en-us/library/hh447921(v=vs.85).aspx for
+	// more details about these. Frame-server mode requires that we set the MF_MEDIA_ENGINE_VIDEO_OUTPUT_FORMAT attribute.
+	DX::ThrowIfFailed(
+		mediaEngineAttributes->SetUINT32(MF_MEDIA_ENGINE_VIDEO_OUTPUT_FORMAT, static_cast<UINT32>(DXGI_FORMAT_B8G8R8A8_UNORM))
+		);
+#endif
+
+	DWORD mfFlags = 0;
+#if !defined(WINAPI_FAMILY) || (WINAPI_FAMILY != WINAPI_FAMILY_PHONE_APP)
+	mfFlags |= MF_MEDIA_ENGINE_AUDIOONLY;
+#endif
+	// Create the media engine.
+	DX::ThrowIfFailed(
+		mediaEngineFactory->CreateInstance(mfFlags, mediaEngineAttributes.Get(), &mfMediaEngine), __FILEW__, __LINE__
+		);
+
+	// What we actually want is an IMFMediaEngineEx but there is no way to directly get one of those. Windows 8 returns an
+	// object that implements that interface when we call IMFMediaEngineClassFactory::CreateInstance though, so we can use
+	// ComPtr's As member function to QI (QueryInterface) the desired IMFMediaEngineEx.
+	DX::ThrowIfFailed(
+		mfMediaEngine.As(&musicEngine), __FILEW__, __LINE__
+		);
+
+	// Turn off autoplay such that merely setting a source alone will not start music playing instantly.
+	DX::ThrowIfFailed(
+		musicEngine->SetAutoPlay(FALSE), __FILEW__, __LINE__
+		);
+
+	// Turn looping off. We handle it ourselves.
+	DX::ThrowIfFailed(
+		musicEngine->SetLoop(FALSE), __FILEW__, __LINE__
+		);
+
+	// Load as much of a source as possible once Load is called, so that the next song is decoding before it is needed.
+	DX::ThrowIfFailed(
+		musicEngine->SetPreload(MF_MEDIA_ENGINE_PRELOAD_AUTOMATIC), __FILEW__, __LINE__
+		);
+}
+
+void AudioEngine::DestroyMusicEngines()
+{
+	m_mediaEngineNotify.Reset();
+	m_nextMediaEngineNotify.Reset();
+
+	if (m_musicEngine != nullptr)
+	{
+		m_musicEngine->Shutdown(); // Ignore HRESULT since we can't do anything if it fails anyway.
+		m_musicEngine.Reset();
+	}
+
+	if (m_nextMusicEngine != nullptr)
+	{
+		m_nextMusicEngine->Shutdown(); // Ignore HRESULT since we can't do anything if it fails anyway.
+		m_nextMusicEngine.Reset();
+	}
+
+	// Nothing has been opened ahead of time and nothing is fading out any more.
+	m_nextMusicFilename = nullptr;
+	m_nextMusicFailed = false;
+	m_musicFading = false;
+}
+
+void AudioEngine::ShutdownMusicEngine()
+{
+	DestroyMusicEngines();
+
+	m_mediaFoundationStartupShutdown.Shutdown();
+
+	m_musicOff = true;
+}
+
+UpdateErrorCodes AudioEngine::Update()
+{
+	UpdateErrorCodes result = UpdateErrorCodes::None;
+
+	// Process an error in the sound effects engine.
+	if (m_soundEffectsEngineCallbacks.m_error != S_OK)
 	{
 		// Handle error. (The following is default code that you may want to change based on your own testing and circumstances.)
 		// Reset value.
@@ -430,57 +965,26 @@ UpdateErrorCodes AudioEngine::Update()
 		result = result | UpdateErrorCodes::SoundEffectsEngine;
 	}
 
+	// Hand the voice commands that didn't fit in the queue to the audio thread and handle its notifications: the source voices of the sound
+	// effects that finished playing go back to the voice pool's free lists and the ones that failed are marked for RestartFailedSoundEffects.
+	m_voicePool.Update();
+
 	// Restart any failed sound effect source voices. You might not want to run this every time AudioEngine::Update is called.
-	// Since this scans all voices in all sound effects that have been created, if you wind up with a lot of sound effects it
+	// Since this scans every voice in the voice pool, if you wind up with a lot of wave formats (or voices per format) it
 	// could eventually become a time sink. Further, you might simply not want some sound effects to restart if they suffer a
 	// critical error since it may desynchronize the sound from the gameplay. The implementation of RestartFailedSoundEffects
 	// in this sample is a general purpose demonstration of how you might go about handling failed sound effects. You should
 	// tailor it for your game's needs or even disable it if that's what is best for your game.
 	RestartFailedSoundEffects();
 
+	// Move the positional sound effects to where they are now, all in one batch.
+	UpdatePositionalVoices();
+
 	// Process notifications from the music engine.
 	if (m_mediaEngineNotify != nullptr)
 	{
-		// Previous music has finished playing. Move on or loop, as appropriate. The volume test sound only plays when the game is
-		// paused, which should pause the current music (thereby setting m_musicIsPaused == true) such that we don't need to worry
-		// about that messing up the queue.
-		if (m_mediaEngineNotify->m_previousMusicFinished && m_musicIsPlaying && !m_musicIsPaused)
-		{
-			// Make sure the queue wasn't emptied.
-			if (!m_musicQueue.empty())
-			{
-				// Get a reference to the item at the front of the queue without removing it.
-				auto& currentMusic = m_musicQueue.front();
-
-				// Tracks whether or not we should call PlayMusic when we're done processing.
-				bool shouldPlay = false;
-
-				// If the music is not supposed to loop or is done looping, remove it from the queue and
-				// set shouldPlay equal to the music queue not being empty AND the new music piece
-				// being set to autoplay.
-				if (currentMusic.LoopCount == 0)
-				{
-					m_musicQueue.pop();
-					shouldPlay = !m_musicQueue.empty() && m_musicQueue.front().AutoPlayAfterPreviousMusic;
-				}
-				else
-				{
-					// A negative LoopCount means to loop infinitely. If it's positive, decrement the loop count
-					// so that it will stop looping and proceed to the next music piece when it reaches zero.
-					if (currentMusic.LoopCount > 0)
-					{
-						--currentMusic.LoopCount;
-					}
-					shouldPlay = true;
-				}
-
-				// Play the music if we're supposed to.
-				if (shouldPlay)
-				{
-					PlayMusic();
-				}
-			}
-		}
+		// Move on to the next song (or loop) when the current one ends, crossfading if set, and open the song after it ahead of time.
+		UpdateMusicQueue();
 
 		// When MediaEngine is ready, then check to see if we should seek to a particular position in the playing
 		// music and if so seek to it.
@@ -569,6 +1073,285 @@ UpdateErrorCodes AudioEngine::Update()
 	return result;
 }
 
+void AudioEngine::UpdateMusicQueue()
+{
+	// Carry on with the crossfade that is in progress, if any.
+	if (m_musicFading)
+	{
+		UpdateMusicCrossfade();
+	}
+
+	// If the spare music engine couldn't open the next song, remember that so that the song is opened again when it is time to play it
+	// (StartMusic does that) rather than over and over again here.
+	if (m_nextMediaEngineNotify->m_errorOccurred)
+	{
+		m_nextMediaEngineNotify->m_errorOccurred = false;
+		m_nextMusicFailed = true;
+	}
+
+	// The volume test sound only plays when the game is paused, which should pause the current music (thereby setting
+	// m_musicIsPaused == true) such that we don't need to worry about that messing up the queue.
+	if (m_musicIsPlaying && !m_musicIsPaused)
+	{
+		if (m_mediaEngineNotify->m_previousMusicFinished)
+		{
+			// Previous music has finished playing before the next music could be started ahead of its end (e.g. because the next music
+			// wasn't buffered in time, the length of the previous music wasn't known or it was an empty entry). Move on or loop, as appropriate.
+			if (AdvanceMusicQueue())
+			{
+				StartMusic(0.0);
+			}
+		}
+		else if (IsNextMusicReady())
+		{
+			// Measure how often Update is called, using the music's own clock. Seeks and new songs (which move the position backwards) and
+			// long stalls are left out.
+			double position = m_musicEngine->GetCurrentTime();
+			if (position > m_lastMusicTime && (position - m_lastMusicTime) < 0.25)
+			{
+				m_musicUpdateInterval = position - m_lastMusicTime;
+			}
+			m_lastMusicTime = position;
+
+			// Start the next music when the time left in the current music is down to the crossfade. GetDuration returns NaN until the
+			// length is known and infinity for music that has no end, in which case the music is left to end on its own.
+			double duration = m_musicEngine->GetDuration();
+			double remaining = duration - position;
+			if (_finite(duration) != 0 && remaining <= m_musicCrossfadeDuration + (m_musicUpdateInterval / 2.0))
+			{
+				// With no crossfade the current music still plays out what is left of it (less than an update interval), fading into the
+				// start of the next music over that time rather than being cut off.
+				double crossfadeDuration = std::max(remaining, 0.0);
+				if (m_musicCrossfadeDuration > 0.0)
+				{
+					crossfadeDuration = std::min(crossfadeDuration, m_musicCrossfadeDuration);
+				}
+
+				if (AdvanceMusicQueue())
+				{
+					StartMusic(crossfadeDuration);
+				}
+			}
+		}
+	}
+
+	// Open the next music ahead of time. The spare music engine is busy until the crossfade (if any) is over.
+	if (!m_musicFading)
+	{
+		PrepareNextMusic();
+	}
+}
+
+bool AudioEngine::AdvanceMusicQueue()
+{
+	// Make sure the queue wasn't emptied.
+	if (m_musicQueue.empty())
+	{
+		return false;
+	}
+
+	// Get a reference to the item at the front of the queue without removing it.
+	auto& currentMusic = m_musicQueue.front();
+
+	// Tracks whether or not we should play the music when we're done processing.
+	bool shouldPlay = false;
+
+	// If the music is not supposed to loop or is done looping, remove it from the queue and
+	// set shouldPlay equal to the music queue not being empty AND the new music piece
+	// being set to autoplay.
+	if (currentMusic.LoopCount == 0)
+	{
+		m_musicQueue.pop_front();
+		shouldPlay = !m_musicQueue.empty() && m_musicQueue.front().AutoPlayAfterPreviousMusic;
+	}
+	else
+	{
+		// A negative LoopCount means to loop infinitely. If it's positive, decrement the loop count
+		// so that it will stop looping and proceed to the next music piece when it reaches zero.
+		if (currentMusic.LoopCount > 0)
+		{
+			--currentMusic.LoopCount;
+		}
+		shouldPlay = true;
+	}
+
+	return shouldPlay;
+}
+
+Platform::String^ AudioEngine::GetNextMusicFilename()
+{
+	if (m_musicQueue.empty())
+	{
+		return nullptr;
+	}
+
+	// Mirrors AdvanceMusicQueue: music that still has loops to go plays again, otherwise the one after it plays if it is set to autoplay.
+	auto& currentMusic = m_musicQueue.front();
+	Platform::String^ filename = nullptr;
+	if (currentMusic.LoopCount != 0)
+	{
+		filename = currentMusic.Filename;
+	}
+	else if (m_musicQueue.size() > 1 && m_musicQueue[1].AutoPlayAfterPreviousMusic)
+	{
+		filename = m_musicQueue[1].Filename;
+	}
+
+	// Empty entries are silence, so there is nothing to open.
+	return (filename == nullptr || filename->IsEmpty()) ? nullptr : filename;
+}
+
+void AudioEngine::PrepareNextMusic()
+{
+	auto filename = GetNextMusicFilename();
+
+	// Nothing to do if there is no next music or it is already open (or failed to open).
+	if (filename == nullptr || (m_nextMusicFilename != nullptr && Platform::String::CompareOrdinal(filename, m_nextMusicFilename) == 0))
+	{
+		return;
+	}
+
+	// Start loading the music in the spare engine. It stays paused (autoplay is off) until StartMusic plays it. Errors are reported
+	// asynchronously through m_nextMediaEngineNotify and handled by UpdateMusicQueue.
+	m_nextMediaEngineNotify->InitializeVariables();
+
+	HRESULT hr = m_nextMusicEngine->SetSource(const_cast<wchar_t*>(filename->Data()));
+	if (SUCCEEDED(hr))
+	{
+		hr = m_nextMusicEngine->Load();
+	}
+
+	m_nextMusicFilename = filename;
+	m_nextMusicFailed = FAILED(hr);
+}
+
+bool AudioEngine::IsNextMusicReady()
+{
+	if (m_musicFading || m_nextMusicFailed || m_nextMusicFilename == nullptr)
+	{
+		return false;
+	}
+
+	// The queue might have changed since the music was opened.
+	auto filename = GetNextMusicFilename();
+	if (filename == nullptr || Platform::String::CompareOrdinal(filename, m_nextMusicFilename) != 0)
+	{
+		return false;
+	}
+
+	return m_nextMusicEngine->GetReadyState() >= MF_MEDIA_ENGINE_READY_HAVE_FUTURE_DATA;
+}
+
+void AudioEngine::StartMusic(double crossfadeDuration)
+{
+	// Get the first item from the queue.
+	auto filename = m_musicQueue.front().Filename;
+
+	if (!filename->IsEmpty())
+	{
+		// The spare engine is needed to play the music, so stop any music that is still fading out in it.
+		if (m_musicFading)
+		{
+			FinishMusicCrossfade();
+		}
+
+		// Open the music in the spare engine unless PrepareNextMusic already has.
+		if (m_nextMusicFailed || m_nextMusicFilename == nullptr || Platform::String::CompareOrdinal(filename, m_nextMusicFilename) != 0)
+		{
+			m_nextMediaEngineNotify->InitializeVariables();
+
+			// SetSource takes a BSTR, which is a COM data type which Platform::String's data imitates for our purposes. (Both are
+			// pointers to immutable wide character strings with their length stored as an integer value before the wide character 
+			// data begins and which are allocated in the system heap.)
+			DX::ThrowIfFailed(
+				m_nextMusicEngine->SetSource(const_cast<wchar_t*>(filename->Data())), __FILEW__, __LINE__
+				);
+		}
+		m_nextMusicFilename = nullptr;
+		m_nextMusicFailed = false;
+
+		// The spare engine becomes the current one and the engine that was playing becomes the spare.
+		m_musicEngine.Swap(m_nextMusicEngine);
+		m_mediaEngineNotify.Swap(m_nextMediaEngineNotify);
+
+		// Mark m_previousMusicFinished false in MediaEngineNotify.
+		m_mediaEngineNotify->m_previousMusicFinished = false;
+		m_lastMusicTime = 0.0;
+
+		// Only fade out music that is actually still playing.
+		bool fadeOut = crossfadeDuration > 0.0 && m_nextMusicEngine->IsPaused() == FALSE && m_nextMusicEngine->IsEnded() == FALSE;
+
+		// Play the music, starting silent if it fades in.
+		DX::ThrowIfFailed(
+			m_musicEngine->SetVolume(fadeOut ? 0.0 : GetMusicEngineVolume()), __FILEW__, __LINE__
+			);
+		DX::ThrowIfFailed(
+			m_musicEngine->Play(), __FILEW__, __LINE__
+			);
+
+		if (fadeOut)
+		{
+			m_musicFadeDuration = crossfadeDuration;
+			m_musicFading = true;
+		}
+		else if (m_nextMusicEngine->IsPaused() == FALSE)
+		{
+			// Stop the music that was playing.
+			DX::ThrowIfFailed(
+				m_nextMusicEngine->Pause(), __FILEW__, __LINE__
+				);
+		}
+	}
+	else
+	{
+		// Stop any currently playing music.
+		if (m_musicFading)
+		{
+			FinishMusicCrossfade();
+		}
+
+		if (m_musicEngine->IsPaused() == FALSE)
+		{
+			DX::ThrowIfFailed(
+				m_musicEngine->Pause(), __FILEW__, __LINE__
+				);
+		}
+
+		// Mark m_previousMusicFinished true in MediaEngineNotify. This will cause the empty item to be processed by Update and
+		// removed if/when necessary.
+		m_mediaEngineNotify->m_previousMusicFinished = true;
+	}
+
+	m_musicIsPlaying = true;
+	m_musicIsPaused = false;
+}
+
+void AudioEngine::UpdateMusicCrossfade()
+{
+	// The new music's position is the crossfade's clock, so the fade starts when the new music is actually heard.
+	double progress = (m_musicFadeDuration > 0.0) ? (m_musicEngine->GetCurrentTime() / m_musicFadeDuration) : 1.0;
+	if (progress >= 1.0)
+	{
+		FinishMusicCrossfade();
+		return;
+	}
+
+	// Equal power, so the overall loudness stays the same through the crossfade.
+	double angle = std::max(progress, 0.0) * DirectX::XM_PIDIV2;
+	double volume = GetMusicEngineVolume();
+	m_musicEngine->SetVolume(volume * std::sin(angle));
+	m_nextMusicEngine->SetVolume(volume * std::cos(angle));
+}
+
+void AudioEngine::FinishMusicCrossfade()
+{
+	m_musicFading = false;
+
+	// Ignore the HRESULTs: the music that faded out may already have ended, and the volume is set again by the next SetMusicVolume anyway.
+	m_nextMusicEngine->Pause();
+	m_musicEngine->SetVolume(GetMusicEngineVolume());
+}
+
 void AudioEngine::AddMusicToQueue(Platform::String^ filename, int loopCount)
 {
 	AddMusicToQueue(filename, loopCount, true);
@@ -589,7 +1372,7 @@ void AudioEngine::AddMusicToQueue(Platform::String^ filename, int loopCount, boo
 	entry.Filename = music;
 	entry.LoopCount = loopCount;
 	entry.AutoPlayAfterPreviousMusic = autoPlayAfterPreviousMusic;
-	m_musicQueue.push(entry);
+	m_musicQueue.push_back(entry);
 
 
 #if defined(_DEBUG)
@@ -619,10 +1402,7 @@ void AudioEngine::AddMusicToQueue(Platform::String^ filename, int loopCount, boo
 
 void AudioEngine::ClearMusicQueue()
 {
-	while (!m_musicQueue.empty())
-	{
-		m_musicQueue.pop();
-	}
+	m_musicQueue.clear();
 }
 
 void AudioEngine::MoveToNextMusicInQueue()
@@ -630,7 +1410,7 @@ void AudioEngine::MoveToNextMusicInQueue()
 	// Remove the front song if the queue is not empty.
 	if (!m_musicQueue.empty())
 	{
-		m_musicQueue.pop();
+		m_musicQueue.pop_front();
 	}
 
 	// Do nothing if Media Foundation failed to startup or music is set to off.
@@ -642,14 +1422,19 @@ void AudioEngine::MoveToNextMusicInQueue()
 	if (m_musicQueue.empty())
 	{
 		// Stop the current music.
+		if (m_musicFading)
+		{
+			FinishMusicCrossfade();
+		}
+
 		DX::ThrowIfFailed(
 			m_musicEngine->Pause(), __FILEW__, __LINE__
 			);
 	}
 	else
 	{
-		// Play the new current song.
-		PlayMusic();
+		// Play the new current song, crossfading with the old one.
+		StartMusic((m_musicIsPlaying && !m_musicIsPaused) ? m_musicCrossfadeDuration : 0.0);
 	}
 }
 
@@ -671,43 +1456,8 @@ void AudioEngine::PlayMusic()
 		return;
 	}
 
-	// Get the first item from the queue.
-	auto filename = m_musicQueue.front().Filename;
-
-	if (!filename->IsEmpty())
-	{
-		// Mark m_previousMusicFinished false in MediaEngineNotify.
-		m_mediaEngineNotify->m_previousMusicFinished = false;
-
-		// SetSource takes a BSTR, which is a COM data type which Platform::String's data imitates for our purposes. (Both are
-		// pointers to immutable wide character strings with their length stored as an integer value before the wide character 
-		// data begins and which are allocated in the system heap.)
-		DX::ThrowIfFailed(
-			m_musicEngine->SetSource(const_cast<wchar_t*>(filename->Data())), __FILEW__, __LINE__
-			);
-
-		// Play the music.
-		DX::ThrowIfFailed(
-			m_musicEngine->Play(), __FILEW__, __LINE__
-			);
-	}
-	else
-	{
-		// Stop any currently playing music.
-		if (m_musicEngine->IsPaused() == FALSE)
-		{
-			DX::ThrowIfFailed(
-				m_musicEngine->Pause(), __FILEW__, __LINE__
-				);
-		}
-
-		// Mark m_previousMusicFinished true in MediaEngineNotify. This will cause the empty item to be processed by Update and
-		// removed if/when necessary.
-		m_mediaEngineNotify->m_previousMusicFinished = true;
-	}
-
-	m_musicIsPlaying = true;
-	m_musicIsPaused = false;
+	// Play the first item from the queue. The song is started in the spare music engine, which has usually opened it already.
+	StartMusic(0.0);
 }
 
 void AudioEngine::PlayMusicVolumeTestSound()
@@ -740,6 +1490,11 @@ void AudioEngine::PlayMusicVolumeTestSound()
 
 #endif
 
+	if (m_musicFading)
+	{
+		FinishMusicCrossfade();
+	}
+
 	DX::ThrowIfFailed(
 		m_musicEngine->Pause(), __FILEW__, __LINE__
 		);
@@ -761,73 +1516,280 @@ void AudioEngine::PlaySoundEffectsVolumeTestSound()
 	PlaySoundEffect("volume_test.wav");
 }
 
-void AudioEngine::LoadSoundEffect(Platform::String^ filename)
-{
-	// Loads the specified file as a sound effect.
-	LoadSoundEffect(filename, false);
+void AudioEngine::LoadSoundEffect(Platform::String^ filename)
+{
+	// Loads the specified file as a sound effect.
+	LoadSoundEffect(filename, false);
+}
+
+void AudioEngine::LoadSoundEffect(Platform::String^ filename, bool forceReload)
+{
+	if (!forceReload)
+	{
+		// Check to see if the filename exists as a key already. If so skip reloading the file.
+		if (m_soundEffectIndices.find(filename) != m_soundEffectIndices.end())
+		{
+#if defined(_DEBUG)
+			OutputDebugStringW(std::wstring(L"File '").append(filename->Data()).append(L"' is already loaded. Skipping...\n").c_str());
+#endif
+			return;
+		}
+	}
+
+	std::vector<std::unique_ptr<SoundEffect>> soundEffects;
+	soundEffects.push_back(MapSoundEffect(filename));
+	FinishLoadingSoundEffects(soundEffects);
+}
+
+void AudioEngine::LoadSoundEffects(const std::vector<Platform::String^>& filenames)
+{
+	// Map every file first and then decode and convert them all at once, which spreads the work across threads. Nothing is added to the sound
+	// effects until the whole batch has loaded, so a file that fails part way through leaves them as they were.
+	std::vector<std::unique_ptr<SoundEffect>> soundEffects;
+	soundEffects.reserve(filenames.size());
+	std::set<Platform::String^> batchNames;
+
+	for (auto filename : filenames)
+	{
+		// Skip the files that are already loaded (and ones that are listed twice), the same as LoadSoundEffect does.
+		if (m_soundEffectIndices.find(filename) != m_soundEffectIndices.end() || !batchNames.insert(filename).second)
+		{
+#if defined(_DEBUG)
+			OutputDebugStringW(std::wstring(L"File '").append(filename->Data()).append(L"' is already loaded. Skipping...\n").c_str());
+#endif
+			continue;
+		}
+
+		soundEffects.push_back(MapSoundEffect(filename));
+	}
+
+	FinishLoadingSoundEffects(soundEffects);
+}
+
+std::unique_ptr<SoundEffect> AudioEngine::MapSoundEffect(Platform::String^ filename)
+{
+	// Create a new sound effect using the filename as the key. It isn't added until FinishLoadingSoundEffects has loaded it.
+	std::unique_ptr<SoundEffect> soundEffect(new SoundEffect());
+	soundEffect->m_name = filename;
+
+	// Use a MediaStreamer instance to map the file and find the data we require to create source voices for the sound effect. The sound effect
+	// takes over the mapping so that the audio buffer can point straight at the data in it (moving a MemoryMappedFile doesn't move the view).
+	MediaStreamer soundEffectStream;
+	soundEffectStream.Initialize(filename->Data());
+	soundEffect->m_soundEffectFile = std::make_shared<MemoryMappedFile>(soundEffectStream.DetachFile());
+
+	// Keep the whole format since compressed formats extend the WAVEFORMATEX.
+	soundEffect->m_waveFormat = soundEffectStream.GetWaveFormat();
+	soundEffect->m_seekTable = soundEffectStream.GetSeekTable();
+	soundEffect->m_loopBegin = soundEffectStream.GetLoopBegin();
+	soundEffect->m_loopLength = soundEffectStream.GetLoopLength();
+
+	// The raw data. FinishLoadingSoundEffects sets the audio buffer up from it.
+	ZeroMemory(&soundEffect->m_audioBuffer, sizeof(soundEffect->m_audioBuffer));
+	soundEffect->m_audioBuffer.pAudioData = soundEffectStream.GetData();
+	soundEffect->m_audioBuffer.AudioBytes = soundEffectStream.GetMaxStreamLengthInBytes();
+
+	return soundEffect;
+}
+
+void AudioEngine::LoadSoundBank(Platform::String^ filename)
+{
+	// Map the bank. Every sound effect from the bank shares the mapping.
+	auto bankFile = std::make_shared<MemoryMappedFile>();
+	bankFile->Open(filename->Data());
+
+	DX::SoundBank bank;
+	DX::ThrowIfFailed(
+		(bank.LoadFromMemory(bankFile->GetData(), bankFile->GetSize()) ? S_OK : E_FAIL), __FILEW__, __LINE__
+		);
+
+	// Nothing is added to the sound effects until the whole bank has loaded, so an entry that fails leaves them as they were.
+	std::vector<std::unique_ptr<SoundEffect>> soundEffects;
+	soundEffects.reserve(bank.GetEntryCount());
+	std::set<Platform::String^> batchNames;
+
+	for (uint32 i = 0; i < bank.GetEntryCount(); ++i)
+	{
+		auto& entry = bank.GetEntry(i);
+		auto name = ref new Platform::String(reinterpret_cast<const wchar_t*>(bank.GetName(i)), entry.m_nameLength);
+
+		// Check to see if the name exists as a key already (or is in the bank twice). If so skip it, the same as LoadSoundEffect does.
+		if (m_soundEffectIndices.find(name) != m_soundEffectIndices.end() || !batchNames.insert(name).second)
+		{
+#if defined(_DEBUG)
+			OutputDebugStringW(std::wstring(L"Sound effect '").append(name->Data()).append(L"' is already loaded. Skipping...\n").c_str());
+#endif
+			continue;
+		}
+
+		std::unique_ptr<SoundEffect> soundEffect(new SoundEffect());
+		soundEffect->m_name = name;
+
+		// Copy the format (it's small) and pad it to a whole WAVEFORMATEX in case it is a PCMWAVEFORMAT with no cbSize.
+		auto format = bank.GetFormat(i);
+		soundEffect->m_waveFormat.assign(format, format + entry.m_formatSize);
+		if (soundEffect->m_waveFormat.size() < sizeof(WAVEFORMATEX))
+		{
+			soundEffect->m_waveFormat.resize(sizeof(WAVEFORMATEX), 0);
+		}
+
+		soundEffect->m_soundEffectFile = bankFile;
+		soundEffect->m_loopBegin = entry.m_loopBegin;
+		soundEffect->m_loopLength = entry.m_loopLength;
+
+		// The raw data. FinishLoadingSoundEffects sets the audio buffer up from it.
+		ZeroMemory(&soundEffect->m_audioBuffer, sizeof(soundEffect->m_audioBuffer));
+		soundEffect->m_audioBuffer.pAudioData = bank.GetAudioData(i);
+		soundEffect->m_audioBuffer.AudioBytes = entry.m_dataSize;
+		soundEffects.push_back(std::move(soundEffect));
+	}
+
+	// Decode and convert the sound effects that need it in parallel.
+	FinishLoadingSoundEffects(soundEffects);
+}
+
+const DX::SampleRateConverter* AudioEngine::GetSampleRateConverter(uint32 inputRate)
+{
+	// Sound effects are converted to the rate that the mastering voice mixes at. Without a mastering voice the rate isn't known yet, so they are
+	// kept as they are (and XAudio2 resamples them per voice if the rates turn out to differ).
+	if (m_masteringVoice == nullptr)
+	{
+		return nullptr;
+	}
+
+	XAUDIO2_VOICE_DETAILS details;
+	m_masteringVoice->GetVoiceDetails(&details);
+	if (details.InputSampleRate == inputRate)
+	{
+		return nullptr;
+	}
+
+	auto& converter = m_sampleRateConverters[inputRate];
+	if (converter == nullptr || converter->GetOutputRate() != details.InputSampleRate)
+	{
+		converter.reset(new DX::SampleRateConverter());
+		if (!converter->Initialize(inputRate, details.InputSampleRate))
+		{
+			// An unusual pair of rates. Leave it to XAudio2.
+			converter.reset();
+		}
+	}
+
+	return converter.get();
 }
 
-void AudioEngine::LoadSoundEffect(Platform::String^ filename, bool forceReload)
+void AudioEngine::FinishLoadingSoundEffects(std::vector<std::unique_ptr<SoundEffect>>& soundEffects)
 {
-	if (!forceReload)
+	// Look up the converters first since the cache isn't thread safe. Only the formats that are converted need one.
+	std::vector<const DX::SampleRateConverter*> converters(soundEffects.size());
+	for (size_t i = 0; i < soundEffects.size(); ++i)
 	{
-		// Check to see if the filename exists as a key already. If so skip reloading the file.
-		if (m_soundEffectsMap.find(filename) != m_soundEffectsMap.end())
+		auto waveFormat = reinterpret_cast<const WAVEFORMATEX*>(soundEffects[i]->m_waveFormat.data());
+		if (IsConvertibleFormat(*waveFormat) || waveFormat->wFormatTag == DX::WaveFormatImaAdpcm)
 		{
-#if defined(_DEBUG)
-			OutputDebugStringW(std::wstring(L"File '").append(filename->Data()).append(L"' is already loaded. Skipping...\n").c_str());
-#endif
-			return;
+			converters[i] = GetSampleRateConverter(waveFormat->nSamplesPerSec);
 		}
 	}
 
-	// Create a new sound effect using the filename as the key. Since we're working with a unique_ptr, we don't need to worry
-	// about destroying any old entry since a unique_ptr will destroy itself when it goes out of scope.
-	m_soundEffectsMap[filename] = std::unique_ptr<SoundEffect>(new SoundEffect());
+	// Decoding and converting are the slow part of loading, and each sound effect is independent of the others, so do them in parallel.
+	// parallel_for doesn't return until every sound effect is done, and rethrows the first exception that any of them threw.
+	concurrency::parallel_for(size_t(0), soundEffects.size(), [&](size_t i)
+	{
+		PrepareSoundEffectData(soundEffects[i].get(), converters[i]);
+	});
 
-	// Get a reference to the sound effect.
-	auto& soundEffect = m_soundEffectsMap[filename];
+	// Adding a format to the voice pool can create voices, so that is done on this thread. A format that is added before a later one throws is
+	// left in the pool, which only costs its idle voices.
+	for (auto& soundEffect : soundEffects)
+	{
+		soundEffect->m_voiceGroup = m_voicePool.AddFormat(soundEffect->m_waveFormat);
+	}
 
-	// C++ does not zero everything out by default, so we are zeroing out the XAUDIO2_BUFFER in the sound effect we created to
-	// ensure that its member variables have the values we want.
-	ZeroMemory(&soundEffect->m_audioBuffer, sizeof(soundEffect->m_audioBuffer));
+	// Everything that can fail has succeeded, so now add the sound effects (replacing any that are already loaded under the same names).
+	for (auto& soundEffect : soundEffects)
+	{
+		AddSoundEffect(std::move(soundEffect));
+	}
+}
 
-	// Use a MediaStreamer instance to load and store all the data we require to create source voices for the sound effect.
-	MediaStreamer soundEffectStream;
-	soundEffectStream.Initialize(filename->Data());
+SoundEffect* AudioEngine::AddSoundEffect(std::unique_ptr<SoundEffect> soundEffect)
+{
+	auto name = soundEffect->m_name;
+	auto item = m_soundEffectIndices.find(name);
+	if (item != m_soundEffectIndices.end())
+	{
+		// Replace the existing sound effect but keep its slot, generation and priority so that its handles stay valid. Any voices that are
+		// playing the old sound effect are released first since its data is unmapped when the unique_ptr is replaced.
+		auto& slot = m_soundEffects[item->second];
+		SoundHandle handle;
+		handle.m_index = item->second;
+		handle.m_generation = slot->m_handleGeneration;
+		m_voicePool.ReleaseVoices(slot->m_voiceGroup, handle);
+
+		soundEffect->m_handleGeneration = slot->m_handleGeneration;
+		soundEffect->m_priority = slot->m_priority;
+		slot = std::move(soundEffect);
+		return slot.get();
+	}
+
+	soundEffect->m_handleGeneration = m_nextSoundEffectGeneration++;
 
-	uint32 bufferLength = soundEffectStream.GetMaxStreamLengthInBytes();
-	soundEffect->m_soundEffectBufferData = std::unique_ptr<uint8>(new uint8[bufferLength]);
-	soundEffectStream.ReadAll(soundEffect->m_soundEffectBufferData.get(), bufferLength, &soundEffect->m_soundEffectBufferLength);
-	soundEffect->m_waveFormatEx = soundEffectStream.GetOutputWaveFormatEx();
-	soundEffect->m_soundEffectSampleRate = soundEffectStream.GetOutputWaveFormatEx().nSamplesPerSec;
-	soundEffect->m_audioBuffer.AudioBytes = soundEffect->m_soundEffectBufferLength;
-	soundEffect->m_audioBuffer.Flags = XAUDIO2_END_OF_STREAM; // The XAUDIO2_END_OF_STREAM flag must be set or the source voices will never mark themselves as done playing.
-	soundEffect->m_audioBuffer.pAudioData = soundEffect->m_soundEffectBufferData.get();
+	uint32 index;
+	if (!m_freeSoundEffectIndices.empty())
+	{
+		index = m_freeSoundEffectIndices.back();
+		m_freeSoundEffectIndices.pop_back();
+		m_soundEffects[index] = std::move(soundEffect);
+	}
+	else
+	{
+		index = static_cast<uint32>(m_soundEffects.size());
+		m_soundEffects.push_back(std::move(soundEffect));
+	}
+
+	m_soundEffectIndices[name] = index;
+	return m_soundEffects[index].get();
 }
 
-void AudioEngine::UnloadSoundEffect(Platform::String^ filename)
+SoundHandle AudioEngine::GetSoundEffectHandle(Platform::String^ filename)
 {
-	// If the filename exists as a key in the sound effect map, erase its entry.
-	if (m_soundEffectsMap.find(filename) != m_soundEffectsMap.end())
+	SoundHandle handle;
+
+	auto item = m_soundEffectIndices.find(filename);
+	if (item == m_soundEffectIndices.end())
 	{
-		auto& soundEffect = m_soundEffectsMap[filename];
+#if defined(_DEBUG)
+		throw ref new Platform::InvalidArgumentException(L"filename");
+#endif
+		return handle;
+	}
 
-		// Stop all source voices immediately.
-		for (auto& sv : soundEffect->m_sourceVoices)
-		{
-			if (sv->m_soundEffectStarted)
-			{
-				DX::ThrowIfFailed(
-					sv->m_soundEffectSourceVoice->Stop(), __FILEW__, __LINE__
-					);
-			}
-		}
+	handle.m_index = item->second;
+	handle.m_generation = m_soundEffects[item->second]->m_handleGeneration;
+	return handle;
+}
 
-		// Erase the sound effect. The use of the xaudio2_voice_ptr<T> template class will ensure that any voices are destroyed properly.
-		// Voice destruction can take some time and will fail if some other voice is sending data to this voice (very unlikely for the
-		// intended use of SoundEffect) such that resources could silently leak. See: http://msdn.microsoft.com/en-us/library/microsoft.directx_sdk.ixaudio2voice.ixaudio2voice.destroyvoice(v=vs.85).aspx
-		m_soundEffectsMap.erase(filename);
+void AudioEngine::UnloadSoundEffect(Platform::String^ filename)
+{
+	// If the filename exists as a key in the sound effect map, erase its entry and free its slot.
+	auto item = m_soundEffectIndices.find(filename);
+	if (item != m_soundEffectIndices.end())
+	{
+		auto index = item->second;
+		auto& soundEffect = m_soundEffects[index];
+
+		// Release the pooled source voices that are playing the sound effect. They are destroyed (so that XAudio2 is done with the data) and
+		// recreated, which can take some time. Voice destruction will fail if some other voice is sending data to this voice (very unlikely
+		// for the intended use of SoundEffect) such that resources could silently leak. See: http://msdn.microsoft.com/en-us/library/microsoft.directx_sdk.ixaudio2voice.ixaudio2voice.destroyvoice(v=vs.85).aspx
+		SoundHandle handle;
+		handle.m_index = index;
+		handle.m_generation = soundEffect->m_handleGeneration;
+		m_voicePool.ReleaseVoices(soundEffect->m_voiceGroup, handle);
+
+		// Erase the sound effect. Any handles to it become stale since the slot is null until it is reused (with a new generation).
+		soundEffect.reset();
+		m_freeSoundEffectIndices.push_back(index);
+		m_soundEffectIndices.erase(item);
 	}
 }
 
@@ -860,74 +1822,224 @@ void AudioEngine::PlaySoundEffect(Platform::String^ filename, uint32 loopCount,
 		return;
 	}
 
+	// Look the sound effect up and play it through its handle. Code that plays a sound effect often should get its handle once instead.
+	PlaySoundEffect(GetSoundEffectHandle(filename), loopCount, maxInstances);
+}
+
+void AudioEngine::PlaySoundEffect(SoundHandle handle, uint32 loopCount, uint32 maxInstances)
+{
+	StartSoundEffect(handle, loopCount, maxInstances, nullptr, nullptr);
+}
+
+VoiceHandle AudioEngine::PlaySoundEffect(
+	SoundHandle handle,
+	uint32 loopCount,
+	uint32 maxInstances,
+	const DirectX::XMFLOAT3& position,
+	const DirectX::XMFLOAT3& velocity
+	)
+{
+	VoiceHandle voice;
+
+	auto sv = StartSoundEffect(handle, loopCount, maxInstances, &position, &velocity);
+	if (sv != nullptr)
+	{
+		voice.m_index = sv->m_index;
+		voice.m_generation = m_voicePool.GetVoiceGeneration(sv);
+	}
+
+	return voice;
+}
+
+SourceVoice* AudioEngine::StartSoundEffect(
+	SoundHandle handle,
+	uint32 loopCount,
+	uint32 maxInstances,
+	const DirectX::XMFLOAT3* position,
+	const DirectX::XMFLOAT3* velocity
+	)
+{
+	if (m_soundEffectsOff)
+	{
+		return nullptr;
+	}
+
 	// Make sure the sound effect exists.
-	if (m_soundEffectsMap.find(filename) == m_soundEffectsMap.end())
+	auto soundEffect = GetSoundEffect(handle);
+	if (soundEffect == nullptr)
 	{
 #if defined(_DEBUG)
-		throw ref new Platform::InvalidArgumentException(L"filename");
+		throw ref new Platform::InvalidArgumentException(L"handle");
 #endif
-		return;
+		return nullptr;
 	}
 
-	// Get a reference to the sound effect.
-	auto& soundEffect = m_soundEffectsMap[filename];
-
 	// A maxInstances value greater than 0 means we should cap the number of concurrently playing instances of this sound effect. This
 	// can be helpful since playing the same effect many times at once can create distortions and other bad sounding results.
-	if (maxInstances > 0U)
+	if (maxInstances > 0U && m_voicePool.CountVoices(soundEffect->m_voiceGroup, handle) >= maxInstances)
 	{
-		// Count the number of instances that are currently playing and return if it meets or exceeds the specified max instances cap.
-		if (static_cast<uint32>(
-			std::count_if(soundEffect->m_sourceVoices.begin(), soundEffect->m_sourceVoices.end(), [] (std::unique_ptr<SourceVoice>& voice) { return voice->m_soundEffectStarted == true; })
-			) >= maxInstances)
-		{
-			return;
-		}
+		return nullptr;
 	}
 
-	// See if we have a source voice that's already been created that is no longer in use.
-	auto voice = std::find_if(soundEffect->m_sourceVoices.begin(), soundEffect->m_sourceVoices.end(), [] (std::unique_ptr<SourceVoice>& voice) { return voice->m_soundEffectStarted == false; });
+	// Take a voice from the pool. It was created when the sound effect was loaded so nothing is allocated or created here. If every voice
+	// for the sound effect's format is playing something more important, the sound effect isn't played.
+	auto sv = m_voicePool.AcquireVoice(soundEffect->m_voiceGroup, soundEffect->m_priority);
+	if (sv == nullptr)
+	{
+		return nullptr;
+	}
 
-	// If we don't, we need to create a new one.
-	if (voice == soundEffect->m_sourceVoices.end())
+	// Work out a positional play's gains now rather than in the next Update so that it doesn't start out centered at full volume.
+	if (position != nullptr && sv->m_channels <= 2)
 	{
-		// Create a unique_ptr to a SourceVoice.
-		std::unique_ptr<SourceVoice> sourceVoice(new SourceVoice());
+		sv->m_position = *position;
+		sv->m_velocity = *velocity;
+
+		m_positionalBatch.Clear();
+		m_positionalBatch.Add(*position, *velocity, sv->m_channels == 2);
+		m_positionalBatch.Compute(m_listener, m_positionalAudioSettings);
+		m_voicePool.SetVoicePositional(
+			sv,
+			m_positionalBatch.GetLeftGain(0),
+			m_positionalBatch.GetRightGain(0),
+			m_positionalBatch.GetAttenuation(0),
+			m_positionalBatch.GetFrequencyRatio(0)
+			);
+	}
+
+	// Start the source voice.
+	StartSourceVoice(soundEffect, sv, handle, loopCount);
+
+	return sv;
+}
+
+void AudioEngine::SetVoicePosition(VoiceHandle voice, const DirectX::XMFLOAT3& position, const DirectX::XMFLOAT3& velocity)
+{
+	auto sv = m_voicePool.GetPlayingVoice(voice);
+	if (sv == nullptr || !m_voicePool.IsVoicePositional(sv))
+	{
+		return;
+	}
 
-		// Get a pointer to the SourceVoice contained by the unique_ptr. This lets us continue to manipulate it after we have added it to 
-		// the source voices collection since we will be using std::move to add it (which will leave sourceVoice as a dead item.
-		auto sv = sourceVoice.get();
+	sv->m_position = position;
+	sv->m_velocity = velocity;
+}
 
-		// Move the newly created source voice into the source voices collection.
-		// Note that we need std::move here since if it was missing we would be trying to create a copy of the newly created unique_ptr
-		// and unique_ptr instances cannot have copies of themselves (hence the name).
-		soundEffect->m_sourceVoices.push_back(std::move(sourceVoice));
-		sourceVoice = nullptr;
+void AudioEngine::StopVoice(VoiceHandle voice, bool playTails)
+{
+	auto sv = m_voicePool.GetPlayingVoice(voice);
+	if (sv == nullptr)
+	{
+		return;
+	}
 
-		// Set the loop count.
-		soundEffect->m_audioBuffer.LoopCount = loopCount;
+	m_voicePool.StopVoice(sv, playTails);
+}
 
-		// Create the source voice. This creates the IXAudio2SourceVoice object.
-		CreateSourceVoice(soundEffect, sv);
+bool AudioEngine::IsVoicePlaying(VoiceHandle voice) const
+{
+	return m_voicePool.GetPlayingVoice(voice) != nullptr;
+}
 
-		// Start the source voice.
-		StartSourceVoice(soundEffect, sv, loopCount);
+void AudioEngine::UpdatePositionalVoices()
+{
+	if (m_soundEffectsOff)
+	{
+		return;
 	}
-	else
+
+	// Gather the emitters of the positional plays into the batch, packed, so that they can be computed four at a time.
+	m_positionalBatch.Clear();
+	m_positionalVoices.clear();
+	for (uint32 i = 0; i < m_voicePool.GetVoiceCount(); ++i)
+	{
+		auto sv = m_voicePool.GetVoice(i);
+		if (m_voicePool.IsVoiceStarted(sv) && m_voicePool.IsVoicePositional(sv))
+		{
+			m_positionalBatch.Add(sv->m_position, sv->m_velocity, sv->m_channels == 2);
+			m_positionalVoices.push_back(sv);
+		}
+	}
+
+	if (m_positionalVoices.empty())
 	{
-		// We already have a suitable SourceVoice, so take the iterator we got, dereference it with * (giving us the std::unique_ptr) and
-		// use get to get the pointer to the source voice.
-		auto sv = (*voice).get();
+		return;
+	}
 
-		// Start the source voice.
-		StartSourceVoice(soundEffect, sv, loopCount);
+	m_positionalBatch.Compute(m_listener, m_positionalAudioSettings);
+
+	// Queue one command for each voice whose output has changed enough to be heard.
+	for (uint32 i = 0; i < m_positionalBatch.GetCount(); ++i)
+	{
+		m_voicePool.SetVoiceOutput(
+			m_positionalVoices[i],
+			m_positionalBatch.GetLeftGain(i),
+			m_positionalBatch.GetRightGain(i),
+			m_positionalBatch.GetAttenuation(i),
+			m_positionalBatch.GetFrequencyRatio(i)
+			);
 	}
 }
 
 void AudioEngine::StopSoundEffect(Platform::String^ filename, bool playTails)
+{
+	StopSoundEffect(GetSoundEffectHandle(filename), playTails);
+}
+
+void AudioEngine::StopSoundEffect(SoundHandle handle, bool playTails)
 {
 	// Ensure that the sound effect exists.
-	if (m_soundEffectsMap.find(filename) == m_soundEffectsMap.end())
+	auto soundEffect = GetSoundEffect(handle);
+	if (soundEffect == nullptr)
+	{
+#if defined(_DEBUG)
+		throw ref new Platform::InvalidArgumentException(L"handle");
+#endif
+		return;
+	}
+
+	// Stop all of the source voices that are playing it and return them to the pool.
+	m_voicePool.StopVoices(soundEffect->m_voiceGroup, handle, playTails);
+}
+
+void AudioEngine::LoadStreamingSoundEffect(Platform::String^ filename)
+{
+	// Check to see if the filename exists as a key already. If so skip reopening the file.
+	if (m_streamingSoundEffectsMap.find(filename) != m_streamingSoundEffectsMap.end())
+	{
+#if defined(_DEBUG)
+		OutputDebugStringW(std::wstring(L"File '").append(filename->Data()).append(L"' is already loaded. Skipping...\n").c_str());
+#endif
+		return;
+	}
+
+	// Open the file and read its header. The voice is created when the sound effect is first played.
+	std::unique_ptr<StreamingSoundEffect> streamingSoundEffect(new StreamingSoundEffect());
+	streamingSoundEffect->Open(filename->Data());
+
+	m_streamingSoundEffectsMap[filename] = std::move(streamingSoundEffect);
+}
+
+void AudioEngine::UnloadStreamingSoundEffect(Platform::String^ filename)
+{
+	// If the filename exists as a key in the streaming sound effect map, erase its entry. The StreamingSoundEffect destructor stops the voice,
+	// waits for any read in progress, destroys the voice, and closes the file.
+	if (m_streamingSoundEffectsMap.find(filename) != m_streamingSoundEffectsMap.end())
+	{
+		m_streamingSoundEffectsMap.erase(filename);
+	}
+}
+
+void AudioEngine::PlayStreamingSoundEffect(Platform::String^ filename, uint32 loopCount)
+{
+	if (m_soundEffectsOff)
+	{
+		return;
+	}
+
+	// Make sure the streaming sound effect exists.
+	auto item = m_streamingSoundEffectsMap.find(filename);
+	if (item == m_streamingSoundEffectsMap.end())
 	{
 #if defined(_DEBUG)
 		throw ref new Platform::InvalidArgumentException(L"filename");
@@ -935,41 +2047,71 @@ void AudioEngine::StopSoundEffect(Platform::String^ filename, bool playTails)
 		return;
 	}
 
-	// Get a reference to the sound effect.
-	auto& soundEffect = m_soundEffectsMap[filename];
+	auto& streamingSoundEffect = item->second;
+
+	// Create the source voice if this is the first time the sound effect has been played (or the sound effects engine was restarted).
+	if (!streamingSoundEffect->HasVoice())
+	{
+		streamingSoundEffect->CreateVoice(m_soundEffectsEngine.Get());
+	}
 
-	UINT32 flags = playTails ? XAUDIO2_PLAY_TAILS : 0U;
+	streamingSoundEffect->Play(loopCount);
+}
 
-	// Stop all source voices.
-	for (auto& sv : soundEffect->m_sourceVoices)
+void AudioEngine::StopStreamingSoundEffect(Platform::String^ filename, bool playTails)
+{
+	// Ensure that the streaming sound effect exists.
+	auto item = m_streamingSoundEffectsMap.find(filename);
+	if (item == m_streamingSoundEffectsMap.end())
 	{
-		if (sv->m_soundEffectStarted)
-		{
-			DX::ThrowIfFailed(
-				sv->m_soundEffectSourceVoice->Stop(flags), __FILEW__, __LINE__
-				);
-		}
+#if defined(_DEBUG)
+		throw ref new Platform::InvalidArgumentException(L"filename");
+#endif
+		return;
 	}
 
+	item->second->Stop(playTails);
+}
 
+void AudioEngine::SetSoundEffectPriority(Platform::String^ filename, uint32 priority)
+{
+	SetSoundEffectPriority(GetSoundEffectHandle(filename), priority);
 }
 
-void AudioEngine::ClearUnusedSourceVoices(Platform::String^ filename)
+void AudioEngine::SetSoundEffectPriority(SoundHandle handle, uint32 priority)
 {
 	// Ensure that the sound effect exists.
-	if (m_soundEffectsMap.find(filename) == m_soundEffectsMap.end())
+	auto soundEffect = GetSoundEffect(handle);
+	if (soundEffect == nullptr)
 	{
 #if defined(_DEBUG)
-		throw ref new Platform::InvalidArgumentException(L"filename");
+		throw ref new Platform::InvalidArgumentException(L"handle");
+#endif
+		return;
+	}
+
+	// Instances that are already playing keep the priority they were started with.
+	soundEffect->m_priority = priority;
+}
+
+void AudioEngine::SetSoundEffectVolume(SoundHandle handle, float volume)
+{
+	// Ensure that the sound effect exists.
+	auto soundEffect = GetSoundEffect(handle);
+	if (soundEffect == nullptr)
+	{
+#if defined(_DEBUG)
+		throw ref new Platform::InvalidArgumentException(L"handle");
 #endif
 		return;
 	}
 
-	// Get a reference to the sound effect.
-	auto& soundEffect = m_soundEffectsMap[filename];
+	m_voicePool.SetVoicesVolume(soundEffect->m_voiceGroup, handle, volume);
+}
 
-	// Use std::remove_if to clear out all of the source voices that are not listed as started.
-	std::remove_if(soundEffect->m_sourceVoices.rbegin(), soundEffect->m_sourceVoices.rend(), [] (std::unique_ptr<SourceVoice>& voice) { return voice->m_soundEffectStarted == false; });
+void AudioEngine::SetSoundEffectVoicesPerFormat(uint32 count)
+{
+	m_voicePool.SetVoicesPerFormat(count);
 }
 
 bool AudioEngine::GetNoMediaFoundation()
@@ -1043,9 +2185,28 @@ void AudioEngine::SetMusicVolume(double volume)
 		return;
 	}
 
+	// During a crossfade UpdateMusicCrossfade sets both engines' volumes from the new music volume.
+	if (!m_musicFading)
+	{
+		m_musicEngine->SetVolume(GetMusicEngineVolume());
+	}
+}
+
+double AudioEngine::GetMusicEngineVolume() const
+{
 	// We work with volumes from 0.0 to 100.0 externally, but internally those values need to be normalized between 0.0 and 1.0.
 	// They could go higher but that would risk distortion.
-	m_musicEngine->SetVolume(std::max(0.0, std::min(1.0, volume / 100.0)));
+	return std::max(0.0, std::min(1.0, m_musicVolume / 100.0));
+}
+
+double AudioEngine::GetMusicCrossfadeDuration()
+{
+	return m_musicCrossfadeDuration;
+}
+
+void AudioEngine::SetMusicCrossfadeDuration(double seconds)
+{
+	m_musicCrossfadeDuration = std::max(0.0, seconds);
 }
 
 double AudioEngine::GetSoundEffectsVolume()
@@ -1086,6 +2247,12 @@ double AudioEngine::PauseMusic()
 		return m_musicPosition;
 	}
 
+	// Stop the music that is fading out (if any). Resuming only resumes the current music.
+	if (m_musicFading)
+	{
+		FinishMusicCrossfade();
+	}
+
 	// Get the current position of the music.
 	m_musicPosition = m_musicEngine->GetCurrentTime();
 
@@ -1166,30 +2333,23 @@ void AudioEngine::PauseSoundEffects()
 		return;
 	}
 
-	// Loop through all of the sound effects.
-	for (auto& item : m_soundEffectsMap)
-	{
-		// Get a reference to the current sound effect.
-		auto& soundEffect = item.second;
+	// Stop all of the started source voices in the voice pool. Any failure comes back as an error notification.
+	m_voicePool.PauseVoices();
 
-		// Loop through all of the source voices and stop all of the started source voices.
-		for (auto& voice : soundEffect->m_sourceVoices)
-		{
-			if (voice->m_soundEffectStarted)
-			{
+	// Pause the streaming sound effects that are playing.
+	for (auto& item : m_streamingSoundEffectsMap)
+	{
 #if defined(_DEBUG)
-				DX::ThrowIfFailed(
-					voice->m_soundEffectSourceVoice->Stop(), __FILEW__, __LINE__
-					);
+		DX::ThrowIfFailed(
+			item.second->Pause(), __FILEW__, __LINE__
+			);
 #else
-				HRESULT hr = voice->m_soundEffectSourceVoice->Stop();
-				if (FAILED(hr))
-				{
-					// Log the error.
-				}
-#endif
-			}
+		HRESULT hr = item.second->Pause();
+		if (FAILED(hr))
+		{
+			// Log the error.
 		}
+#endif
 	}
 }
 
@@ -1200,76 +2360,37 @@ void AudioEngine::ResumeSoundEffects()
 		return;
 	}
 
-	// Loop through all of the sound effects.
-	for (auto& item : m_soundEffectsMap)
-	{
-		// Get a reference to the current sound effect.
-		auto& soundEffect = item.second;
+	// Restart all of the source voices in the voice pool that are listed as started. Any failure comes back as an error notification.
+	m_voicePool.ResumeVoices();
 
-		// Loop through all of the source voices and restart any that are listed as started.
-		for (auto& voice : soundEffect->m_sourceVoices)
-		{
-			if (voice->m_soundEffectStarted)
-			{
+	// Resume the streaming sound effects that were paused.
+	for (auto& item : m_streamingSoundEffectsMap)
+	{
 #if defined(_DEBUG)
-				DX::ThrowIfFailed(
-					voice->m_soundEffectSourceVoice->Start(), __FILEW__, __LINE__
-					);
+		DX::ThrowIfFailed(
+			item.second->Resume(), __FILEW__, __LINE__
+			);
 #else
-				HRESULT hr = voice->m_soundEffectSourceVoice->Start();
-				if (FAILED(hr))
-				{
-					// Log the error.
-				}
-#endif
-			}
+		HRESULT hr = item.second->Resume();
+		if (FAILED(hr))
+		{
+			// Log the error.
 		}
+#endif
 	}
 }
 
-void AudioEngine::CreateSourceVoice(std::unique_ptr<SoundEffect>& soundEffect, SourceVoice* sv)
-{
-	// Set the source voices error tracking variables to their default values.
-	sv->m_criticalError = false;
-	sv->m_hresult = S_OK;
-
-	// Set started to false.
-	sv->m_soundEffectStarted = false;
-
-	// Create an IXAudio2SourceVoice using the sound effect's data. We use the default values for flags and maxFrequency so
-	// that we can set our source voice to be the IXAudio2VoiceCallback. So 0U and 2.0f aren't magic numbers, they're just
-	// the defaults that XAudio2 would give us anyway if we didn't need to set an IXAudio2VoiceCallback. You could change
-	// them, though there are unlikely to be any flags you would want.
-	DX::ThrowIfFailed(
-		m_soundEffectsEngine->CreateSourceVoice(&sv->m_soundEffectSourceVoice, &soundEffect->m_waveFormatEx, 0U, 2.0f, sv), __FILEW__, __LINE__
-		);
-}
-
-void AudioEngine::StartSourceVoice(std::unique_ptr<SoundEffect>& soundEffect, SourceVoice* sv, uint32 loopCount)
+void AudioEngine::StartSourceVoice(SoundEffect* soundEffect, SourceVoice* sv, SoundHandle handle, uint32 loopCount)
 {
-	// Reset the error values to their defaults.
-	sv->m_criticalError = false;
-	sv->m_hresult = S_OK;
-
-	// Set the loop count that lets us restart a sound effect with the proper number of remaining loops in case it needs recreating.
-	sv->m_soundEffectLoopCount = loopCount;
-
-	// Set the loop count for the audio buffer.
-	soundEffect->m_audioBuffer.LoopCount = sv->m_soundEffectLoopCount;
-
-	// Submit the data buffer for the source voice so that there's something to play.
-	DX::ThrowIfFailed(
-		sv->m_soundEffectSourceVoice->SubmitSourceBuffer(&soundEffect->m_audioBuffer), __FILEW__, __LINE__
-		);
-
-	// Start the source voice.
-	DX::ThrowIfFailed(
-		sv->m_soundEffectSourceVoice->Start(), __FILEW__, __LINE__
-		);
-
-	// Mark the source voice as started. Note that this is not thread safe since we check this value to see if a source voice is
-	// in use. As such, each sound effect should be used synchronously from the same thread.
-	sv->m_soundEffectStarted = true;
+	// Copy the audio buffer and set its loop count. XAudio2 requires the loop region to be zero when the loop count is.
+	XAUDIO2_BUFFER buffer = soundEffect->m_audioBuffer;
+	buffer.LoopCount = loopCount;
+	buffer.LoopBegin = (loopCount != 0) ? soundEffect->m_loopBegin : 0U;
+	buffer.LoopLength = (loopCount != 0) ? soundEffect->m_loopLength : 0U;
+
+	// Queue the play for the audio thread. Note that this is not thread safe since the pool tracks which voices are in use and there is only
+	// one producer for its command queue. As such, sound effects should be played synchronously from the same thread.
+	m_voicePool.StartVoice(sv, buffer, soundEffect->m_wmaBuffer, handle, soundEffect->m_priority, loopCount);
 }
 
 void AudioEngine::RestartFailedSoundEffects()
@@ -1279,58 +2400,95 @@ void AudioEngine::RestartFailedSoundEffects()
 		return;
 	}
 
-	// Loop through all the sound effects.
-	for (auto& item : m_soundEffectsMap)
+	// Loop through all of the source voices in the voice pool.
+	for (uint32 i = 0; i < m_voicePool.GetVoiceCount(); ++i)
 	{
-		// Get a reference to the current sound effect.
-		auto& soundEffect = item.second;
+		auto sv = m_voicePool.GetVoice(i);
 
-		// If none of the voices in this sound effect had a critical error, continue to the next sound effect.
-		if (std::count_if(soundEffect->m_sourceVoices.cbegin(), soundEffect->m_sourceVoices.cend(), [](const std::unique_ptr<SourceVoice>& voice) { return voice->m_criticalError; }) <= 0)
+		// Taking the error clears it, so an error that is reported after this is handled on the next update.
+		HRESULT hr = m_voicePool.TakeVoiceError(sv);
+		if (hr == S_OK)
 		{
 			continue;
 		}
 
-		// Loop through all of the source voices for the current sound effect.
-		for (auto& sv : soundEffect->m_sourceVoices)
+		// The sound effect that the voice was playing (nullptr if the voice was idle or the sound effect has been unloaded).
+		bool started = m_voicePool.IsVoiceStarted(sv);
+		auto soundEffectHandle = m_voicePool.GetVoiceSoundEffect(sv);
+		auto soundEffect = started ? GetSoundEffect(soundEffectHandle) : nullptr;
+
+#if defined(_DEBUG)
+		// Write out a debug message.
+		std::wstringstream str;
+
+		str << L"Failure with instance of sound effect '" <<
+			(soundEffect != nullptr ? soundEffect->m_name->Data() : L"(none)") <<
+			std::hex <<
+			std::uppercase <<
+			L"'. HRESULT = 0x" <<
+			static_cast<unsigned long>(hr) <<
+			L".\n";
+
+		OutputDebugStringW(str.str().c_str());
+#endif
+		// Only try restarting for HRESULTs that we comprehend. Otherwise we might
+		// just continue to create errors.
+		if (hr == XAUDIO2_E_INVALID_CALL ||
+			hr == XAUDIO2_E_DEVICE_INVALIDATED)
 		{
-			if (sv->m_criticalError)
+			// Try to create a new voice in place of the error voice and play the sound effect on it again.
+			m_voicePool.RecreateVoice(sv);
+			if (soundEffect != nullptr)
+			{
+				StartSourceVoice(soundEffect, sv, soundEffectHandle, m_voicePool.GetVoiceLoopCount(sv));
+			}
+			else if (started)
 			{
-				// Store the HRESULT so we can clear it before we try to restart the voice.
-				HRESULT hr = sv->m_hresult;
+				m_voicePool.FreeVoice(sv);
+			}
+		}
+		else if (started)
+		{
+			m_voicePool.FreeVoice(sv);
+		}
+	}
+
+	// Loop through all the streaming sound effects.
+	for (auto& item : m_streamingSoundEffectsMap)
+	{
+		auto& streamingSoundEffect = item.second;
+
+		// Taking the error clears it, so an error that is reported after this is handled on the next update.
+		HRESULT hr = streamingSoundEffect->TakeCriticalError();
+		if (hr == S_OK)
+		{
+			continue;
+		}
 
 #if defined(_DEBUG)
-				// Write out a debug message.
-				std::wstringstream str;
-
-				str << L"Failure with instance of sound effect '" <<
-					item.first->Data() <<
-					std::hex <<
-					std::uppercase <<
-					L"'. HRESULT = 0x" <<
-					static_cast<unsigned long>(hr) <<
-					L".\n";
-
-				OutputDebugStringW(str.str().c_str());
+		// Write out a debug message.
+		std::wstringstream str;
+
+		str << L"Failure with streaming sound effect '" <<
+			item.first->Data() <<
+			std::hex <<
+			std::uppercase <<
+			L"'. HRESULT = 0x" <<
+			static_cast<unsigned long>(hr) <<
+			L".\n";
+
+		OutputDebugStringW(str.str().c_str());
 #endif
-				// Reset the error tracking variables to their default values.
-				sv->m_criticalError = false;
-				sv->m_hresult = S_OK;
-
-				// Only try restarting for HRESULTs that we comprehend. Otherwise we might
-				// just continue to create errors.
-				if (hr == XAUDIO2_E_INVALID_CALL ||
-					hr == XAUDIO2_E_DEVICE_INVALIDATED)
-				{
-					// Try to create a new voice based on the error voice.
-					CreateSourceVoice(soundEffect, sv.get());
-					StartSourceVoice(soundEffect, sv.get(), sv.get()->m_soundEffectLoopCount);
-				}
-				else
-				{
-					sv->m_soundEffectStarted = false;
-				}
-			}
+		// Only try restarting for HRESULTs that we comprehend. The stream restarts from the beginning since the voice's buffers are lost.
+		if (hr == XAUDIO2_E_INVALID_CALL ||
+			hr == XAUDIO2_E_DEVICE_INVALIDATED)
+		{
+			streamingSoundEffect->CreateVoice(m_soundEffectsEngine.Get());
+			streamingSoundEffect->Play(streamingSoundEffect->GetLoopCount());
+		}
+		else
+		{
+			streamingSoundEffect->Stop(false);
 		}
 	}
 }
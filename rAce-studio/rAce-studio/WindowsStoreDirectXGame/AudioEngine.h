@@ -1,5 +1,10 @@
 #pragma once
 
+#include "MemoryMappedFile.h"
+#include "PositionalAudio.h"
+#include "SampleRateConverter.h"
+#include "VoiceScheduler.h"
+
 // An implementation of IMFMediaEngineNotify for tracking IMFMediaEngine events such as when the engine is ready to seek and when it encounters an error.
 // For simplicity we use the Microsoft::WRL::RuntimeClass template class to implement all the COM bits for us since IMFMediaEngineNotify implementations
 // must be COM objects.
@@ -122,19 +127,98 @@ protected:
 	T*				m_voice;
 };
 
-// SourceVoice serves as a self-contained IXAudio2SourceVoice complete with its own IXAudio2VoiceCallback implementation.
+// Identifies a loaded sound effect. Get one from AudioEngine::GetSoundEffectHandle, which looks the name up once, and then play the sound effect
+// with it as often as you like: a handle is an index into the engine's array of sound effects so using one costs no lookup at all. A handle
+// becomes invalid (and is ignored) once its sound effect is unloaded, even if the slot is reused by another sound effect. Reloading a sound
+// effect with forceReload keeps its handles valid.
+struct SoundHandle
+{
+	// The index that marks a handle that doesn't refer to any sound effect.
+	static const uint32 InvalidIndex = 0xFFFFFFFF;
+
+	// Constructor. Creates an invalid handle.
+	SoundHandle() :
+		m_index(InvalidIndex),
+		m_generation()
+	{
+	}
+
+	// Returns true if the handle was returned for a loaded sound effect (which may have been unloaded since).
+	bool IsValid() const { return m_index != InvalidIndex; }
+
+	// The index of the sound effect in the engine's array of sound effects.
+	uint32										m_index;
+	// The generation of the sound effect. See SoundEffect::m_handleGeneration.
+	uint32										m_generation;
+};
+
+// Identifies one play of a sound effect on a voice from the AudioEngine's VoicePool, so that the play can be moved (see
+// AudioEngine::SetVoicePosition) or stopped on its own. A handle becomes invalid (and is ignored) once its play has ended or been stopped, or its
+// voice has been stolen for another play, even though the voice is reused.
+struct VoiceHandle
+{
+	// The index that marks a handle that doesn't refer to any play.
+	static const uint32 InvalidIndex = 0xFFFFFFFF;
+
+	// Constructor. Creates an invalid handle.
+	VoiceHandle() :
+		m_index(InvalidIndex),
+		m_generation()
+	{
+	}
+
+	// Returns true if the handle was returned for a play (which may have ended since).
+	bool IsValid() const { return m_index != InvalidIndex; }
+
+	// The index of the voice in the VoicePool.
+	uint32										m_index;
+	// The generation of the voice when the play started. See VoicePool::GetVoiceGeneration.
+	uint32										m_generation;
+};
+
+class VoicePool;
+
+// What a Play command carries to the audio thread. See VoicePool::StartVoice.
+struct VoicePlay
+{
+	// The buffer to submit. Its pContext is replaced with the play id when it is submitted.
+	XAUDIO2_BUFFER								m_buffer;
+	// The seek table to submit with the buffer of an xWMA sound effect. PacketCount is zero for every other format.
+	XAUDIO2_BUFFER_WMA							m_wmaBuffer;
+};
+
+// SourceVoice serves as a self-contained IXAudio2SourceVoice complete with its own IXAudio2VoiceCallback implementation. SourceVoice instances
+// belong to a VoicePool and are reused by every sound effect that has the same wave format. The pool's bookkeeping for the voice (whether it is
+// playing, what, and the state the audio thread keeps for it) lives in the pool's DX::VoiceScheduler, under the voice's index; the callbacks
+// pass the voice's events on to it.
 struct SourceVoice : public IXAudio2VoiceCallback
 {
-	// The source voice.
+	// Constructor.
+	SourceVoice() :
+		m_soundEffectSourceVoice(),
+		m_pool(),
+		m_index(),
+		m_channels(),
+		m_defaultOutputMatrix(),
+		m_position(),
+		m_velocity()
+	{
+	}
+
+	// The source voice. Created and destroyed on the game thread, used on the audio thread.
 	xaudio2_voice_ptr<IXAudio2SourceVoice>		m_soundEffectSourceVoice;
-	// Tracking variable for SourceVoice instance reuse.
-	bool										m_soundEffectStarted;
-	// Tracking variable for the loop count. Decrements each loop unless set to XAUDIO2_LOOP_INFINITE.
-	uint32										m_soundEffectLoopCount;
-	// Set to true via the IXAudio2VoiceCallback::OnVoiceError implementation when a critical error was encountered.
-	bool										m_criticalError;
-	// If m_criticalError is true, contains the HRESULT of the error that was encountered. Default value should be S_OK.
-	HRESULT										m_hresult;
+	// The pool that the voice belongs to.
+	VoicePool*									m_pool;
+	// The index of the voice in its pool (and in the pool's scheduler). Never changes.
+	uint32										m_index;
+	// The number of channels in the voice's format. Never changes.
+	uint32										m_channels;
+	// The output matrix that XAudio2 gave the voice when it was created, which a play that isn't positional goes back to. Written by the game
+	// thread when the voice is created, before any command that reads it can be queued.
+	std::vector<float>							m_defaultOutputMatrix;
+	// The position and velocity of a positional play, in world units (and per second). Only used on the game thread.
+	DirectX::XMFLOAT3							m_position;
+	DirectX::XMFLOAT3							m_velocity;
 
 	// Called just before this voice's processing pass begins.
 	virtual void __declspec(nothrow) __stdcall OnVoiceProcessingPassStart(UINT32 BytesRequired) override { UNREFERENCED_PARAMETER(BytesRequired); }
@@ -144,67 +228,88 @@ struct SourceVoice : public IXAudio2VoiceCallback
 
 	// Called when this voice has just finished playing a buffer stream
 	// (as marked with the XAUDIO2_END_OF_STREAM flag on the last buffer).
-	virtual void __declspec(nothrow) __stdcall OnStreamEnd() override
-	{
-		m_soundEffectStarted = false;
-	}
+	virtual void __declspec(nothrow) __stdcall OnStreamEnd() override { }
 
 	// Called when this voice is about to start processing a new buffer.
 	virtual void __declspec(nothrow) __stdcall OnBufferStart(void* pBufferContext) override { UNREFERENCED_PARAMETER(pBufferContext); }
 
 	// Called when this voice has just finished processing a buffer.
-	// The buffer can now be reused or destroyed.
-	virtual void __declspec(nothrow) __stdcall OnBufferEnd(void* pBufferContext) override { UNREFERENCED_PARAMETER(pBufferContext); }
-
-	// Called when this voice has just reached the end position of a loop.
-	virtual void __declspec(nothrow) __stdcall OnLoopEnd(void* pBufferContext) override
-	{
-		UNREFERENCED_PARAMETER(pBufferContext);
+	// The buffer can now be reused or destroyed. Also called for flushed buffers. Sends a BufferEnd notification.
+	virtual void __declspec(nothrow) __stdcall OnBufferEnd(void* pBufferContext) override;
 
-		if (m_soundEffectLoopCount != XAUDIO2_LOOP_INFINITE)
-		{
-			--m_soundEffectLoopCount;
-		}
-	}
+	// Called when this voice has just reached the end position of a loop. Counts down the loops that are left.
+	virtual void __declspec(nothrow) __stdcall OnLoopEnd(void* pBufferContext) override;
 
 	// Called in the event of a critical error during voice processing,
 	// such as a failing xAPO or an error from the hardware XMA decoder.
 	// The voice may have to be destroyed and re-created to recover from
 	// the error.  The callback arguments report which buffer was being
-	// processed when the error occurred, and its HRESULT code.
-	virtual void __declspec(nothrow) __stdcall OnVoiceError(void* pBufferContext, HRESULT Error) override
-	{
-		UNREFERENCED_PARAMETER(pBufferContext);
+	// processed when the error occurred, and its HRESULT code. Sends an
+	// Error notification.
+	virtual void __declspec(nothrow) __stdcall OnVoiceError(void* pBufferContext, HRESULT Error) override;
 
-		m_criticalError = true;
-		m_hresult = Error;
-	}
+private:
+	// Disable copy constructor.
+	SourceVoice(const SourceVoice&);
+	// Disable copy assignment.
+	SourceVoice& operator=(const SourceVoice&);
 };
 
-// Holds the data loaded from a sound effect file and the SourceVoice instance(s) created from it.
+// Holds the data loaded from a sound effect file. The sound effect is played on voices from the AudioEngine's VoicePool.
 struct SoundEffect
 {
 	SoundEffect() :
+		m_name(),
+		m_handleGeneration(),
 		m_audioBuffer(),
-		m_waveFormatEx(),
-		m_sourceVoices(),
-		m_soundEffectBufferData(),
-		m_soundEffectBufferLength()
+		m_wmaBuffer(),
+		m_waveFormat(),
+		m_soundEffectFile(),
+		m_decodedData(),
+		m_seekTable(),
+		m_voiceGroup(),
+		m_priority(),
+		m_soundEffectBufferLength(),
+		m_soundEffectSampleRate(),
+		m_loopBegin(),
+		m_loopLength()
 	{
 	}
 
+	// The name the sound effect was loaded under (its filename or its name in a sound bank).
+	Platform::String^							m_name;
+	// Distinguishes this sound effect from earlier ones that used the same slot so that stale SoundHandle values are rejected.
+	uint32										m_handleGeneration;
 	// Stores the data used in calling IXAudio2SourceVoice::SubmitSourceBuffer
 	XAUDIO2_BUFFER								m_audioBuffer;
-	// Stores the wave format data we need to create a source voice for this sound effect.
-	WAVEFORMATEX								m_waveFormatEx;
-	// The collection of SourceVoice instances that serves as a pool.
-	std::vector<std::unique_ptr<SourceVoice>>	m_sourceVoices;
-	// The sound effect data itself.
-	std::unique_ptr<uint8>						m_soundEffectBufferData;
+	// The seek table that is passed along with m_audioBuffer for an xWMA sound effect. Points at m_seekTable. PacketCount is zero for every
+	// other format.
+	XAUDIO2_BUFFER_WMA							m_wmaBuffer;
+	// Stores the wave format data we need to create a source voice for this sound effect. A WAVEFORMATEX or one of its extensions (e.g. an
+	// ADPCMWAVEFORMAT), so it is kept as bytes. Always at least sizeof(WAVEFORMATEX) bytes.
+	std::vector<uint8>							m_waveFormat;
+	// The file that holds the sound effect data: its own .wav file, or a sound bank that is shared by all of the sound effects in it.
+	// m_audioBuffer.pAudioData points inside its mapping (unless the data had to be decoded) so the sound effect data is never copied. The
+	// AudioEngine releases the voices that are playing the sound effect before it destroys the sound effect.
+	std::shared_ptr<MemoryMappedFile>			m_soundEffectFile;
+	// The sound effect data decoded to 16-bit PCM, for formats that XAudio2 can't play (IMA ADPCM), and/or converted to the mastering voice's
+	// sample rate. m_audioBuffer.pAudioData points at it instead of at the mapping when it isn't empty, and m_waveFormat is its format.
+	std::vector<uint8>							m_decodedData;
+	// The cumulative number of decoded bytes after each packet of an xWMA sound effect (its 'dpds' chunk). Empty for every other format.
+	std::vector<uint32>							m_seekTable;
+	// The group of voices in the VoicePool that has this sound effect's wave format.
+	uint32										m_voiceGroup;
+	// The priority of the sound effect. When every voice of its format is busy, playing it steals a voice from a sound effect whose
+	// priority is the same or lower.
+	uint32										m_priority;
 	// The length of the sound effect data.
 	uint32										m_soundEffectBufferLength;
 	// The sample rate of the sound effect data.
 	uint32										m_soundEffectSampleRate;
+	// The first sample of the loop region. Only used when the sound effect is played with a non-zero loop count.
+	uint32										m_loopBegin;
+	// The number of samples in the loop region. 0 means the whole sound effect loops.
+	uint32										m_loopLength;
 
 private:
 	// Disable copy constructor.
@@ -213,19 +318,285 @@ private:
 	SoundEffect& operator=(const SoundEffect&);
 };
 
-// Implements IXAudio2EngineCallback. This implementation records the HRESULT of any critical error. It
-// does nothing else.
+// A pool of source voices that is shared by all of the sound effects. A source voice can only play data in the format it was created with, so
+// the pool has a group of voices for each distinct wave format. A group's voices are created when the first sound effect with its format is
+// loaded (or when the sound effects engine is created), never while playing.
+//
+// The bookkeeping (the free lists, voice stealing, and the lock-free command and notification queues between the game thread and XAudio2's
+// processing thread) is done by a DX::VoiceScheduler, which is portable so that PortableTests can drive it with fake voices. The pool owns the
+// XAudio2 side: it creates and destroys the voices, and carries the scheduler's commands out on them at the start of each processing pass (see
+// ExecuteCommands). The game thread never calls the voices' XAudio2 methods apart from creating and destroying them.
+class VoicePool
+{
+public:
+	// The number of voices that are created for each wave format unless SetVoicesPerFormat is called.
+	static const uint32 DefaultVoicesPerFormat = 16;
+
+	// The most voices the pool can hold, across all formats. See DX::VoiceScheduler::MaxVoices.
+	static const uint32 MaxVoices = DX::VoiceScheduler<VoicePlay>::MaxVoices;
+
+	// Constructor.
+	VoicePool();
+
+	// Sets the number of voices to create for each wave format. Only affects the formats that are added after the call.
+	// count - The number of voices per format. Must be at least 1 and at most MaxVoices.
+	void SetVoicesPerFormat(uint32 count);
+
+	// Returns the number of voices that are created for each wave format.
+	uint32 GetVoicesPerFormat() const { return m_voicesPerFormat; }
+
+	// Returns the index of the group for a wave format, adding a group if there isn't one yet. The voices of a new group are created right
+	// away if the pool has an engine. Throws Platform::FailureException if the group's voices would take the pool past MaxVoices.
+	// waveFormat - The wave format (a WAVEFORMATEX or one of its extensions).
+	uint32 AddFormat(const std::vector<uint8>& waveFormat);
+
+	// Creates the voices of every group. Call this after the sound effects engine has been created.
+	// engine - The sound effects engine.
+	// outputChannels - The number of channels of the mastering voice, which the voices' output matrices are built for.
+	void CreateVoices(IXAudio2* engine, uint32 outputChannels);
+
+	// Destroys every voice, keeping the groups so that CreateVoices can create them again. Call this before the sound effects engine is destroyed.
+	void DestroyVoices();
+
+	// Throws away the commands that the audio thread didn't get to and resets the audio thread state. Call this after the sound effects engine
+	// has been destroyed (and before another one is created), when no audio thread can be running.
+	void DiscardCommands() { m_scheduler.DiscardCommands(); }
+
+	// Returns a voice from a group to play a sound effect on, or nullptr if every voice in the group is playing a higher priority sound effect.
+	// The voice comes from the free list if it has one. Otherwise a voice is stolen (and a command to stop it is queued). Pass the voice to StartVoice.
+	// group - The index of the group.
+	// priority - The priority of the sound effect that is to be played.
+	SourceVoice* AcquireVoice(uint32 group, uint32 priority);
+
+	// Makes the next play of a voice returned by AcquireVoice positional, with the output that StartVoice queues before the play. Set the
+	// voice's m_position and m_velocity too.
+	// sv - The voice.
+	// left - The gain of the left output channel.
+	// right - The gain of the right output channel.
+	// attenuation - The attenuation alone. Used as the gain when the output is mono.
+	// frequencyRatio - The frequency ratio.
+	void SetVoicePositional(
+		SourceVoice* sv,
+		float left,
+		float right,
+		float attenuation,
+		float frequencyRatio
+		)
+	{
+		m_scheduler.SetPositional(sv->m_index, left, right, attenuation, frequencyRatio);
+	}
+
+	// Queues the command to submit a sound effect's buffer to a voice returned by AcquireVoice and start it. A positional play's output (see
+	// SetVoicePositional) is queued first; any other play's output goes back to the defaults if a positional play changed it.
+	// sv - The voice.
+	// buffer - The sound effect's buffer. Its pContext is replaced with the voice's play id.
+	// wmaBuffer - The seek table of an xWMA sound effect. Its PacketCount is zero for every other format.
+	// soundEffect - The sound effect's handle.
+	// priority - The sound effect's priority.
+	// loopCount - The loop count of the buffer.
+	void StartVoice(
+		SourceVoice* sv,
+		const XAUDIO2_BUFFER& buffer,
+		const XAUDIO2_BUFFER_WMA& wmaBuffer,
+		SoundHandle soundEffect,
+		uint32 priority,
+		uint32 loopCount
+		);
+
+	// Queues commands to stop every voice in a group that is playing a sound effect and returns the voices to the free list.
+	// group - The index of the sound effect's group.
+	// soundEffect - The sound effect's handle.
+	// playTails - If true, any tailing effects (such as reverb) will be allowed to play.
+	void StopVoices(
+		uint32 group,
+		SoundHandle soundEffect,
+		bool playTails
+		)
+	{
+		m_scheduler.StopSound(group, GetSoundId(soundEffect), playTails ? XAUDIO2_PLAY_TAILS : 0U);
+	}
+
+	// Queues commands to set the volume of every voice in a group that is playing a sound effect.
+	// group - The index of the sound effect's group.
+	// soundEffect - The sound effect's handle.
+	// volume - The volume, as an amplitude multiplier (1.0 is unchanged).
+	void SetVoicesVolume(
+		uint32 group,
+		SoundHandle soundEffect,
+		float volume
+		)
+	{
+		m_scheduler.SetSoundVolume(group, GetSoundId(soundEffect), volume);
+	}
+
+	// Destroys and recreates every voice in a group that is playing a sound effect so that none of them can read its data any longer. Call this
+	// before freeing the data. Destroying a voice can block for several milliseconds.
+	// group - The index of the sound effect's group.
+	// soundEffect - The sound effect's handle.
+	void ReleaseVoices(
+		uint32 group,
+		SoundHandle soundEffect
+		);
+
+	// Queues a command to stop a voice and returns it to the free list.
+	// sv - The voice. Must be playing.
+	// playTails - If true, any tailing effects (such as reverb) will be allowed to play.
+	void StopVoice(
+		SourceVoice* sv,
+		bool playTails
+		)
+	{
+		m_scheduler.Stop(sv->m_index, playTails ? XAUDIO2_PLAY_TAILS : 0U);
+	}
+
+	// Queues a single command that sets the parts of a positional voice's output that have changed noticeably since they were last set.
+	// sv - The voice.
+	// left - The gain of the left output channel.
+	// right - The gain of the right output channel.
+	// attenuation - The attenuation alone. Used as the gain when the output is mono.
+	// frequencyRatio - The frequency ratio.
+	void SetVoiceOutput(
+		SourceVoice* sv,
+		float left,
+		float right,
+		float attenuation,
+		float frequencyRatio
+		)
+	{
+		m_scheduler.SetOutput(sv->m_index, left, right, attenuation, frequencyRatio);
+	}
+
+	// Returns the voice of a play, or nullptr if the handle is invalid or the play has ended (as of the last Update) or been stopped.
+	// voice - The play's handle.
+	SourceVoice* GetPlayingVoice(VoiceHandle voice) const
+	{
+		return m_scheduler.IsPlaying(voice.m_index, voice.m_generation) ? m_voices[voice.m_index].get() : nullptr;
+	}
+
+	// Returns the number of voices in a group that are playing a sound effect. Plays that ended since the last Update are still counted.
+	// group - The index of the sound effect's group.
+	// soundEffect - The sound effect's handle.
+	uint32 CountVoices(
+		uint32 group,
+		SoundHandle soundEffect
+		) const
+	{
+		return m_scheduler.CountSound(group, GetSoundId(soundEffect));
+	}
+
+	// Handles the notifications from the audio thread (returning the voices whose plays ended to their free lists and recording the errors) and
+	// queues any commands that didn't fit in the command queue earlier. AudioEngine::Update calls this once per frame.
+	void Update() { m_scheduler.Update(); }
+
+	// Queues commands to stop all of the voices that are playing.
+	void PauseVoices() { m_scheduler.Pause(); }
+
+	// Queues commands to start all of the voices that are playing again.
+	void ResumeVoices() { m_scheduler.Resume(); }
+
+	// Destroys and recreates a voice (e.g. after a critical error). The voice stays out of the free list.
+	// sv - The voice.
+	void RecreateVoice(SourceVoice* sv);
+
+	// Returns a voice to its group's free list without stopping it. Use for a voice that can't be played any longer, e.g. after a critical error.
+	// sv - The voice.
+	void FreeVoice(SourceVoice* sv) { m_scheduler.Free(sv->m_index); }
+
+	// Returns the number of voices in the pool.
+	uint32 GetVoiceCount() const { return static_cast<uint32>(m_voices.size()); }
+
+	// Returns a voice by its index in the pool. index must be less than GetVoiceCount().
+	SourceVoice* GetVoice(uint32 index) const { return m_voices[index].get(); }
+
+	// Returns true from the time a voice is taken from its group's free list until it is returned to it.
+	bool IsVoiceStarted(SourceVoice* sv) const { return m_scheduler.IsStarted(sv->m_index); }
+
+	// Returns true if a voice's play is positional: AudioEngine::Update pans, attenuates and doppler shifts it from m_position and m_velocity.
+	bool IsVoicePositional(SourceVoice* sv) const { return m_scheduler.IsPositional(sv->m_index); }
+
+	// Returns the generation of a voice, which is bumped each time the voice is taken for a new play. See VoiceHandle.
+	uint32 GetVoiceGeneration(SourceVoice* sv) const { return m_scheduler.GetGeneration(sv->m_index); }
+
+	// Returns the handle of the sound effect that a voice is playing (or last played).
+	SoundHandle GetVoiceSoundEffect(SourceVoice* sv) const;
+
+	// Returns the loop count that a voice was started with, or the number of loops that were left when it had a critical error.
+	uint32 GetVoiceLoopCount(SourceVoice* sv) const { return m_scheduler.GetLoopCount(sv->m_index); }
+
+	// Returns the HRESULT of a voice's last critical error and clears it, or returns S_OK if the voice has had no error since it was started
+	// (or since the last call).
+	HRESULT TakeVoiceError(SourceVoice* sv) { return m_scheduler.TakeError(sv->m_index); }
+
+	// Carries out the queued commands. Only called on the audio thread, from SoundEffectsEngineCallbacks::OnProcessingPassStart.
+	void ExecuteCommands();
+
+	// Passes a voice's callbacks on to the scheduler. Only called on the audio thread, from the SourceVoice callbacks.
+	void OnBufferEnd(SourceVoice* sv, uint32 playId) { m_scheduler.OnBufferEnd(sv->m_index, playId); }
+	void OnLoopEnd(SourceVoice* sv) { m_scheduler.OnLoopEnd(sv->m_index); }
+	void OnVoiceError(SourceVoice* sv, HRESULT hr) { m_scheduler.OnVoiceError(sv->m_index, hr); }
+
+private:
+	// Disable copy constructor.
+	VoicePool(const VoicePool&);
+	// Disable copy assignment.
+	VoicePool& operator=(const VoicePool&);
+
+	typedef DX::VoiceScheduler<VoicePlay> Scheduler;
+
+	// Carries the scheduler's commands out on the XAudio2 voices. See DX::VoiceScheduler::ExecuteCommands.
+	struct XAudio2Voices;
+
+	// Returns the scheduler's id for a sound effect: its handle's index and generation.
+	static uint64 GetSoundId(SoundHandle soundEffect)
+	{
+		return (static_cast<uint64>(soundEffect.m_index) << 32) | soundEffect.m_generation;
+	}
+
+	// Creates the IXAudio2SourceVoice of a voice.
+	void CreateVoice(SourceVoice* sv);
+
+	// Sets a voice's output matrix and/or frequency ratio on the audio thread.
+	HRESULT SetOutput(IXAudio2SourceVoice* voice, SourceVoice* sv, const Scheduler::Command& command);
+
+	// The sound effects engine, or nullptr if it hasn't been created.
+	IXAudio2*									m_engine;
+
+	// The number of channels of the mastering voice.
+	uint32										m_outputChannels;
+
+	// The wave format of each group.
+	std::vector<std::vector<uint8>>				m_waveFormats;
+
+	// Every voice in the pool, in group order.
+	std::vector<std::unique_ptr<SourceVoice>>	m_voices;
+
+	// The number of voices to create for each wave format.
+	uint32										m_voicesPerFormat;
+
+	// The bookkeeping of the voices, indexed like m_voices, and the queues between the game thread and the audio thread.
+	Scheduler									m_scheduler;
+};
+
+// Implements IXAudio2EngineCallback. This implementation records the HRESULT of any critical error and has the voice pool (if any) carry out
+// the queued voice commands at the start of each processing pass. It does nothing else.
 class SoundEffectsEngineCallbacks : public IXAudio2EngineCallback
 {
 public:
 	// Constructor.
 	SoundEffectsEngineCallbacks() :
-		m_error(S_OK)
+		m_error(S_OK),
+		m_voicePool()
 	{
 	}
 
 	// Called by XAudio2 just before an audio processing pass begins.
-	virtual void __declspec(nothrow) __stdcall OnProcessingPassStart() override { }
+	virtual void __declspec(nothrow) __stdcall OnProcessingPassStart() override
+	{
+		if (m_voicePool != nullptr)
+		{
+			m_voicePool->ExecuteCommands();
+		}
+	}
 
 	// Called just after an audio processing pass ends.
 	virtual void __declspec(nothrow) __stdcall OnProcessingPassEnd() override { }
@@ -240,8 +611,14 @@ public:
 	// Default value should be S_OK. Reset it to that after processing any error so that
 	// you can check for FAILED(...->m_error) to determine if an error occurred.
 	HRESULT					m_error;
+
+	// The voice pool whose commands are carried out on the audio thread. Set before the callbacks are registered.
+	VoicePool*				m_voicePool;
 };
 
+// A sound effect that is streamed from its file rather than loaded into memory. See StreamingSoundEffect.h.
+class StreamingSoundEffect;
+
 namespace WindowsStoreDirectXGame
 {
 	[Platform::Metadata::FlagsAttribute()]
@@ -298,6 +675,7 @@ namespace WindowsStoreDirectXGame
 		void ClearMusicQueue();
 
 		// Moves to the next song in the music queue, ignoring any loop count settings for the currently playing song, and plays the new current song.
+		// The new song crossfades with the old one if a crossfade is set (see SetMusicCrossfadeDuration).
 		void MoveToNextMusicInQueue();
 
 		// Plays the first song in the music queue, if any.
@@ -309,7 +687,8 @@ namespace WindowsStoreDirectXGame
 		// Plays the volume test sound through the sound effects engine. Used in volume settings.
 		void PlaySoundEffectsVolumeTestSound();
 
-		// Loads a sound effect file. If the file is already loaded, this function call will be disregarded.
+		// Loads a sound effect file. If the file is already loaded, this function call will be disregarded. The file can be PCM, IEEE float,
+		// MS-ADPCM or xWMA, which XAudio2 plays natively, or IMA ADPCM, which is decoded to PCM when it is loaded.
 		// filename - The relative path and full file name of the sound effect, e.g. "laser.wav" or "somedir\\ball drop.wav"
 		void LoadSoundEffect(Platform::String^ filename);
 
@@ -318,6 +697,14 @@ namespace WindowsStoreDirectXGame
 		// forceReload - If true then the file will be reloaded even if it has already been loaded. If false then if the file is already loaded, this function call will be disregarded.
 		void LoadSoundEffect(Platform::String^ filename, bool forceReload);
 
+		// Loads every sound effect in a .sbank sound bank file (see SoundBankBuilder). The bank is memory mapped once and each sound effect's audio
+		// buffer points straight into the mapping. Each sound effect is added under its name in the bank (e.g. "laser.wav" or "somedir\\ball drop.wav")
+		// so it is played, stopped and unloaded exactly like one loaded with LoadSoundEffect. Sound effects that are already loaded are skipped. The
+		// mapping stays open until every sound effect from the bank has been unloaded. If any sound effect in the bank fails to load (the exception
+		// is passed on), none of them are added.
+		// filename - The relative path and full file name of the sound bank, e.g. "effects.sbank"
+		void LoadSoundBank(Platform::String^ filename);
+
 		// USE CAREFULLY. Unloads a sound effect file (if loaded), freeing all resources associated with it. To avoid potentially blocking the game, this should
 		// be called from a separate thread that can safely be blocked from continuing to execute for up to several milliseconds (potentially longer). This should
 		// also never be called when you might use this sound effect again within the next minute or so since you could wind up colliding the creation and
@@ -335,7 +722,8 @@ namespace WindowsStoreDirectXGame
 		// loopCount - The number of times to loop the sound effect. If infinite looping is desired, use XAUDIO2_LOOP_INFINITE. 0 means play once (i.e. loop zero times).
 		void PlaySoundEffect(Platform::String^ filename, uint32 loopCount);
 
-		// Plays the specified sound effect. The sound effect must have been loaded with LoadSoundEffect prior to this call.
+		// Plays the specified sound effect. The sound effect must have been loaded with LoadSoundEffect prior to this call. The name is looked up on
+		// every call, so for sound effects that are played often get a handle with GetSoundEffectHandle and play it with that instead.
 		// filename - The relative path and full file name of the sound effect, e.g. "laser.wav" or "somedir\\ball drop.wav"
 		// loopCount - The number of times to loop the sound effect. If infinite looping is desired, use XAUDIO2_LOOP_INFINITE. 0 means play once (i.e. loop zero times).
 		// maxInstances - The maximum concurrent instances of the effect. If this effect is playing less than maxInstances times this call will play the effect, otherwise this call will be ignored. A value of 0 means no limit on maximum concurrent instances.
@@ -346,12 +734,40 @@ namespace WindowsStoreDirectXGame
 		// playTails - If true, any tailing effects (such as reverb) will be allowed to play. If false, the effect instances will be stopped instantly. Will not cause further buffering either way.
 		void StopSoundEffect(Platform::String^ filename, bool playTails);
 
-		// USE CAREFULLY. Removes unused source voices for the specified sound effect file. To avoid potentially blocking the game, this should be called
-		// from a separate thread that can safely be blocked from continuing to execute for up to several milliseconds (potentially longer).
-		// This should also never be called when you might use this sound effect again within the next minute or so since you could wind up attempting to 
-		// use a voice that is about to be destroyed giving unknown (but assuredly bad) results.
-		// filename - The loaded sound effect file for which you want to clear unused source voices.
-		void ClearUnusedSourceVoices(Platform::String^ filename);
+		// Opens a sound effect file for streaming. Only the file's header is read; the audio data is read from the file a buffer at a time while it
+		// plays so a streaming sound effect only holds a few buffers in memory. Use this for long sounds such as ambience loops. A streaming sound effect
+		// plays one instance at a time. If the file is already open, this function call will be disregarded.
+		// filename - The relative path and full file name of the sound effect, e.g. "wind.wav" or "somedir\\rain.wav"
+		void LoadStreamingSoundEffect(Platform::String^ filename);
+
+		// Unloads a streaming sound effect (if loaded), stopping it and closing its file. Waits for any read of the file that is in progress to finish.
+		// filename - The relative path and full file name of the sound effect, e.g. "wind.wav" or "somedir\\rain.wav"
+		void UnloadStreamingSoundEffect(Platform::String^ filename);
+
+		// Plays the specified streaming sound effect from the start, restarting it if it is already playing. The sound effect must have been loaded
+		// with LoadStreamingSoundEffect prior to this call.
+		// filename - The relative path and full file name of the sound effect, e.g. "wind.wav" or "somedir\\rain.wav"
+		// loopCount - The number of times to loop the sound effect. If infinite looping is desired, use XAUDIO2_LOOP_INFINITE. 0 means play once (i.e. loop zero times).
+		void PlayStreamingSoundEffect(Platform::String^ filename, uint32 loopCount);
+
+		// Stops the specified streaming sound effect.
+		// filename - The relative path and full file name of the sound effect, e.g. "wind.wav" or "somedir\\rain.wav"
+		// playTails - If true, the buffers that have already been read and any tailing effects (such as reverb) will be allowed to play. If false, the effect will be stopped instantly. Will not cause further reading either way.
+		void StopStreamingSoundEffect(Platform::String^ filename, bool playTails);
+
+		// Sets the priority of a sound effect. Sound effects play on a shared pool of source voices with a fixed number of voices per wave format.
+		// When every voice for a sound effect's format is busy, playing it steals the voice of the lowest priority sound effect that is playing
+		// (the quietest and then the oldest one if there is a tie) provided that its priority is no higher. Otherwise the sound effect is not played.
+		// filename - The relative path and full file name of the sound effect, e.g. "laser.wav" or "somedir\\ball drop.wav"
+		// priority - The priority. Higher values are more important. Sound effects start with a priority of 0.
+		void SetSoundEffectPriority(Platform::String^ filename, uint32 priority);
+
+		// Sets the number of source voices that are created for each wave format of the sound effects that are loaded. This is the most sound
+		// effects of one format that can play at once. Only affects formats that are first loaded after the call, so call it before loading any
+		// sound effects. The default is 16. The pool holds at most 512 voices in all, so loading a sound effect with a new format fails once the
+		// formats use them all up.
+		// count - The number of voices per format. Must be at least 1 and at most 512.
+		void SetSoundEffectVoicesPerFormat(uint32 count);
 
 		// Returns true when media foundation could not be started.
 		bool GetNoMediaFoundation();
@@ -383,6 +799,14 @@ namespace WindowsStoreDirectXGame
 		// volume - Should be a value between 0.0 and 100.0, inclusive. Values will be clamped internally.
 		void SetMusicVolume(double volume);
 
+		// Returns the length, in seconds, of the crossfade between one song in the music queue and the next.
+		double GetMusicCrossfadeDuration();
+
+		// Sets the length of the crossfade between one song in the music queue and the next (including a song looping back to its start). The
+		// next song is always opened ahead of time in a second music engine, so with no crossfade it starts as the current one ends.
+		// seconds - The length of the crossfade in seconds. 0.0 (the default) means no crossfade. Negative values are treated as 0.0.
+		void SetMusicCrossfadeDuration(double seconds);
+
 		// Returns sound effects volume from a range of 0.0 to 100.0.
 		double GetSoundEffectsVolume();
 
@@ -432,16 +856,180 @@ namespace WindowsStoreDirectXGame
 		// are off.
 		IXAudio2* SoundEffectsEngine() const { return m_soundEffectsEngine.Get(); }
 
+		// Looks up a loaded sound effect by name and returns a handle to it. Do this once (e.g. after loading) and keep the handle: playing a sound
+		// effect through its handle is an array index rather than a string lookup. Returns an invalid handle if the sound effect isn't loaded.
+		// filename - The relative path and full file name of the sound effect, e.g. "laser.wav" or "somedir\\ball drop.wav"
+		SoundHandle GetSoundEffectHandle(Platform::String^ filename);
+
+		// Loads several sound effect files, the same as calling LoadSoundEffect for each one except that their data is decoded and converted to
+		// the output sample rate in parallel. Files that are already loaded are skipped. If any of the files fails to load (the exception is
+		// passed on), none of them are added.
+		// filenames - The relative paths and full file names of the sound effects.
+		void LoadSoundEffects(const std::vector<Platform::String^>& filenames);
+
+		// Plays the specified sound effect. Invalid and stale handles are ignored.
+		// handle - The sound effect's handle from GetSoundEffectHandle.
+		// loopCount - The number of times to loop the sound effect. If infinite looping is desired, use XAUDIO2_LOOP_INFINITE. 0 means play once (i.e. loop zero times).
+		// maxInstances - The maximum concurrent instances of the effect. A value of 0 means no limit on maximum concurrent instances.
+		void PlaySoundEffect(SoundHandle handle, uint32 loopCount, uint32 maxInstances);
+
+		// Stops all instances of the specified sound effect. Invalid and stale handles are ignored.
+		// handle - The sound effect's handle from GetSoundEffectHandle.
+		// playTails - If true, any tailing effects (such as reverb) will be allowed to play. If false, the effect instances will be stopped instantly.
+		void StopSoundEffect(SoundHandle handle, bool playTails);
+
+		// Sets the priority of a sound effect. See SetSoundEffectPriority(Platform::String^, uint32). Invalid and stale handles are ignored.
+		// handle - The sound effect's handle from GetSoundEffectHandle.
+		// priority - The priority. Higher values are more important.
+		void SetSoundEffectPriority(SoundHandle handle, uint32 priority);
+
+		// Sets the volume of every instance of a sound effect that is currently playing. Instances that are started later play at full volume.
+		// The change is queued for the audio thread so this never waits for XAudio2. Invalid and stale handles are ignored.
+		// handle - The sound effect's handle from GetSoundEffectHandle.
+		// volume - The volume, as an amplitude multiplier (1.0 is unchanged, 0.0 is silent).
+		void SetSoundEffectVolume(SoundHandle handle, float volume);
+
+		// Plays a sound effect at a position. The play is attenuated with distance from the listener, panned by its direction and doppler shifted
+		// by its speed relative to the listener (see SetListener and SetPositionalAudioSettings). Its gains are worked out before it starts and
+		// then again for every positional play at once in each Update. Sound effects with more than two channels play unpositioned. Returns a
+		// handle to the play, or an invalid handle if it wasn't played.
+		// handle - The sound effect's handle from GetSoundEffectHandle.
+		// loopCount - The number of times to loop the sound effect. If infinite looping is desired, use XAUDIO2_LOOP_INFINITE. 0 means play once (i.e. loop zero times).
+		// maxInstances - The maximum concurrent instances of the effect. A value of 0 means no limit on maximum concurrent instances.
+		// position - The position, in world units.
+		// velocity - The velocity, in world units per second. Only used for doppler.
+		VoiceHandle PlaySoundEffect(
+			SoundHandle handle,
+			uint32 loopCount,
+			uint32 maxInstances,
+			const DirectX::XMFLOAT3& position,
+			const DirectX::XMFLOAT3& velocity
+			);
+
+		// Moves a positional play. The change takes effect in the next Update. Invalid handles and plays that have ended are ignored.
+		// voice - The play's handle from PlaySoundEffect.
+		// position - The position, in world units.
+		// velocity - The velocity, in world units per second.
+		void SetVoicePosition(VoiceHandle voice, const DirectX::XMFLOAT3& position, const DirectX::XMFLOAT3& velocity);
+
+		// Stops one play. Invalid handles and plays that have ended are ignored.
+		// voice - The play's handle from PlaySoundEffect.
+		// playTails - If true, any tailing effects (such as reverb) will be allowed to play. If false, the play will be stopped instantly.
+		void StopVoice(VoiceHandle voice, bool playTails);
+
+		// Returns true if a play hasn't ended yet, as of the last Update.
+		// voice - The play's handle from PlaySoundEffect.
+		bool IsVoicePlaying(VoiceHandle voice) const;
+
+		// Sets the listener that positional plays are heard from. Takes effect in the next Update.
+		void SetListener(const DX::AudioListener& listener) { m_listener = listener; }
+
+		// Returns the listener.
+		const DX::AudioListener& GetListener() const { return m_listener; }
+
+		// Sets how distance and speed affect positional plays. Takes effect in the next Update.
+		void SetPositionalAudioSettings(const DX::PositionalAudioSettings& settings) { m_positionalAudioSettings = settings; }
+
+		// Returns the positional audio settings.
+		const DX::PositionalAudioSettings& GetPositionalAudioSettings() const { return m_positionalAudioSettings; }
+
 	private:
 		// Disable copying.
 		AudioEngine(const AudioEngine%); // % is the ref class reference token (the equivalent of &).
 		AudioEngine% operator=(const AudioEngine%);
 
-		// Creates a new source voice for a sound effect.
-		void CreateSourceVoice(std::unique_ptr<SoundEffect>& soundEffect, SourceVoice* sv);
+		// Creates a sound effect for a file and maps the file. The sound effect's audio buffer points at the raw data, ready for
+		// FinishLoadingSoundEffects. The sound effect isn't added yet.
+		// filename - The relative path and full file name of the sound effect.
+		std::unique_ptr<SoundEffect> MapSoundEffect(Platform::String^ filename);
+
+		// Finishes loading sound effects whose name, format, loop region, seek table and raw data (in m_audioBuffer) have been set. Each one is
+		// decoded if XAudio2 can't play it and converted to the mastering voice's sample rate if it can be (see GetSampleRateConverter), in
+		// parallel across the sound effects, and then added to the voice pool. Only once all of that has succeeded are they added with
+		// AddSoundEffect, so if any of them throws, none of them are added and the sound effects that are already loaded are left alone.
+		// soundEffects - The sound effects. Once every one of them has loaded they are moved out, leaving null pointers behind.
+		void FinishLoadingSoundEffects(std::vector<std::unique_ptr<SoundEffect>>& soundEffects);
+
+		// Returns the converter from a sample rate to the mastering voice's sample rate, or nullptr if the rates are the same, there is no
+		// mastering voice yet, or the pair of rates can't be converted. Converters are built once per rate and kept.
+		// inputRate - The sample rate of the sound effect.
+		const DX::SampleRateConverter* GetSampleRateConverter(uint32 inputRate);
+
+		// Takes a voice from the voice pool and plays a sound effect on it, at a position if position isn't null. Returns the voice, or nullptr
+		// if the sound effect wasn't played.
+		SourceVoice* StartSoundEffect(
+			SoundHandle handle,
+			uint32 loopCount,
+			uint32 maxInstances,
+			const DirectX::XMFLOAT3* position,
+			const DirectX::XMFLOAT3* velocity
+			);
+
+		// Starts a source voice from the voice pool for a sound effect.
+		void StartSourceVoice(SoundEffect* soundEffect, SourceVoice* sv, SoundHandle handle, uint32 loopCount);
+
+		// Works out the gains and frequency ratios of every positional play in one batch and queues the ones that have changed. Called by Update.
+		void UpdatePositionalVoices();
+
+		// Returns the sound effect that a handle refers to, or nullptr if the handle is invalid or stale.
+		SoundEffect* GetSoundEffect(SoundHandle handle) const
+		{
+			if (handle.m_index >= m_soundEffects.size())
+			{
+				return nullptr;
+			}
+
+			auto soundEffect = m_soundEffects[handle.m_index].get();
+			return (soundEffect != nullptr && soundEffect->m_handleGeneration == handle.m_generation) ? soundEffect : nullptr;
+		}
+
+		// Adds a loaded sound effect under its m_name and returns it. If a sound effect with that name is already loaded it is replaced in its
+		// slot (keeping its handles valid), otherwise a free slot is used or a new one is added.
+		// soundEffect - The sound effect, ready to play.
+		SoundEffect* AddSoundEffect(std::unique_ptr<SoundEffect> soundEffect);
+
+		// Creates a music engine and the MediaEngineNotify that receives its events. Throws if either can't be created.
+		// mediaEngineFactory - The Media Engine class factory.
+		// musicEngine - Receives the music engine.
+		// mediaEngineNotify - Receives the music engine's MediaEngineNotify.
+		void CreateMusicEngine(
+			IMFMediaEngineClassFactory* mediaEngineFactory,
+			Microsoft::WRL::ComPtr<IMFMediaEngineEx>& musicEngine,
+			Microsoft::WRL::ComPtr<MediaEngineNotify>& mediaEngineNotify
+			);
+
+		// Shuts down and releases the music engines and their MediaEngineNotify objects.
+		void DestroyMusicEngines();
+
+		// Returns the music volume normalized to the range the music engines use (0.0 to 1.0).
+		double GetMusicEngineVolume() const;
+
+		// Handles the music queue's transitions. Called by Update.
+		void UpdateMusicQueue();
+
+		// Moves the music queue on after the current song has finished playing (or is about to), removing it or counting down its loops. Returns
+		// true if the new front of the queue should be played.
+		bool AdvanceMusicQueue();
+
+		// Returns the full path of the song that AdvanceMusicQueue would play next, or nullptr if it wouldn't play one (or it is an empty entry).
+		Platform::String^ GetNextMusicFilename();
+
+		// Opens the song that will play next in the spare music engine so that it is ready to start without a gap.
+		void PrepareNextMusic();
+
+		// Returns true if the spare music engine has opened the song that will play next and has enough of it buffered to start at once.
+		bool IsNextMusicReady();
 
-		// Starts a source voice for a sound effect.
-		void StartSourceVoice(std::unique_ptr<SoundEffect>& soundEffect, SourceVoice* sv, uint32 loopCount);
+		// Plays the first song in the music queue on the spare music engine (using the song that PrepareNextMusic opened when it matches) and then
+		// swaps the engines. The song that was playing either stops or fades out over the crossfade.
+		// crossfadeDuration - The length of the crossfade in seconds. 0.0 stops the old song at once.
+		void StartMusic(double crossfadeDuration);
+
+		// Sets the volumes of the two music engines for the crossfade that is in progress, and ends it once it is done.
+		void UpdateMusicCrossfade();
+
+		// Stops the song that is fading out and gives the current song the full music volume.
+		void FinishMusicCrossfade();
 
 		// This function does the following:
 		// if (m_musicOff || m_musicDisabledNoMediaFoundation || !m_musicIsPlaying)
@@ -452,23 +1040,78 @@ namespace WindowsStoreDirectXGame
 		// An instance of the class that handles callbacks for the sound effects engine. Basically an error-recording implementation of IXAudio2EngineCallback.
 		SoundEffectsEngineCallbacks												m_soundEffectsEngineCallbacks;
 
-		// The music engine, which is an IMFMediaEngineEx object.
+		// The music engine, which is an IMFMediaEngineEx object. This is the engine that plays the current song in the music queue.
 		Microsoft::WRL::ComPtr<IMFMediaEngineEx>								m_musicEngine;
 
+		// The spare music engine. It opens the next song ahead of time (see PrepareNextMusic) and, during a crossfade, plays the song that is
+		// fading out. The two engines swap roles every time a song starts.
+		Microsoft::WRL::ComPtr<IMFMediaEngineEx>								m_nextMusicEngine;
+
 		// The sound effects engine, which is an IXAudio2 object.
 		Microsoft::WRL::ComPtr<IXAudio2>										m_soundEffectsEngine;
 
 		// An instance of the class that handles callbacks for the music engine. Handles things ranging from seeking to errors and more.
 		Microsoft::WRL::ComPtr<MediaEngineNotify>								m_mediaEngineNotify;
 
+		// The MediaEngineNotify of the spare music engine.
+		Microsoft::WRL::ComPtr<MediaEngineNotify>								m_nextMediaEngineNotify;
+
 		// The mastering voice for the sound effects engine. This is what all other voices feed into.
 		xaudio2_voice_ptr<IXAudio2MasteringVoice>								m_masteringVoice;
 
-		// The filename-indexed dictionary of sound effects.
-		std::map<Platform::String^, std::unique_ptr<SoundEffect>>				m_soundEffectsMap;
+		// The filename-indexed dictionary of sound effect slot indices. Only used to turn names into handles; see GetSoundEffectHandle.
+		std::map<Platform::String^, uint32>										m_soundEffectIndices;
+
+		// The sound effects, indexed by SoundHandle::m_index. The slot of an unloaded sound effect is null until it is reused.
+		std::vector<std::unique_ptr<SoundEffect>>								m_soundEffects;
+
+		// The indices of the null slots in m_soundEffects.
+		std::vector<uint32>														m_freeSoundEffectIndices;
+
+		// The converters that sound effects are converted to the mastering voice's sample rate with, keyed by the sound effects' sample rate.
+		std::map<uint32, std::unique_ptr<DX::SampleRateConverter>>				m_sampleRateConverters;
+
+		// The generation to give the next sound effect that is added to a slot.
+		uint32																	m_nextSoundEffectGeneration;
+
+		// The source voices that the sound effects play on. Declared after the sound effects and the mastering voice so that the voices are
+		// destroyed before the sound effect data is unmapped and before the mastering voice is destroyed.
+		VoicePool																m_voicePool;
+
+		// Where positional plays are heard from, and how distance and speed affect them.
+		DX::AudioListener														m_listener;
+		DX::PositionalAudioSettings												m_positionalAudioSettings;
+
+		// The emitters of the positional plays, computed together, and the voices they belong to (in the same order). Reserved for every voice
+		// the pool can hold so that Update never allocates.
+		DX::PositionalAudioBatch												m_positionalBatch;
+		std::vector<SourceVoice*>												m_positionalVoices;
+
+		// The filename-indexed dictionary of streaming sound effects.
+		std::map<Platform::String^, std::unique_ptr<StreamingSoundEffect>>		m_streamingSoundEffectsMap;
+
+		// The song queue for music. A deque rather than a queue so that the song after the current one can be looked at to open it ahead of time.
+		std::deque<MusicQueueEntry>												m_musicQueue;
+
+		// The full path of the song that the spare music engine has opened, or nullptr if it hasn't opened one.
+		Platform::String^														m_nextMusicFilename;
+
+		// Set to true if the spare music engine failed to open m_nextMusicFilename. The song is then opened again when it is time to play it.
+		bool																	m_nextMusicFailed;
+
+		// The length of the crossfade between songs, in seconds.
+		double																	m_musicCrossfadeDuration;
+
+		// The length of the crossfade that is in progress, in seconds.
+		double																	m_musicFadeDuration;
+
+		// Set to true while the spare music engine is fading out the previous song.
+		bool																	m_musicFading;
 
-		// The song queue for music.
-		std::queue<MusicQueueEntry>												m_musicQueue;
+		// The current song's position at the last Update and the time between the last two Updates (both in seconds). The next song is started
+		// half an update interval before the current one ends, so that it starts as close to the end as Update's timing allows.
+		double																	m_lastMusicTime;
+		double																	m_musicUpdateInterval;
 
 		// Ensures that Media Foundation startup and shutdown is properly handled.
 		MediaFoundationStartupShutdown											m_mediaFoundationStartupShutdown;
@@ -0,0 +1,113 @@
+#include "AudioStreamScheduler.h"
+
+DX::AudioStreamScheduler::AudioStreamScheduler() :
+	m_bufferCount(),
+	m_bufferSize(),
+	m_dataLength(),
+	m_loopBegin(),
+	m_loopEnd(),
+	m_loopsRemaining(),
+	m_position(),
+	m_nextBuffer(),
+	m_endOfStream(),
+	m_inUseCount(0)
+{
+}
+
+void DX::AudioStreamScheduler::Initialize(
+	uint32_t bufferCount,
+	uint32_t bufferSize,
+	uint32_t blockAlign,
+	uint64_t dataLength,
+	uint64_t loopBegin,
+	uint64_t loopLength,
+	uint32_t loopCount
+	)
+{
+	if (blockAlign == 0)
+	{
+		blockAlign = 1;
+	}
+
+	m_bufferCount = bufferCount;
+	m_bufferSize = (bufferSize < blockAlign) ? blockAlign : bufferSize - (bufferSize % blockAlign);
+
+	// Only whole blocks are ever read so any partial block at the end of the data is ignored.
+	m_dataLength = dataLength - (dataLength % blockAlign);
+	m_loopBegin = loopBegin - (loopBegin % blockAlign);
+	if (m_loopBegin >= m_dataLength)
+	{
+		m_loopBegin = 0;
+	}
+	m_loopEnd = (loopLength == 0) ? m_dataLength : m_loopBegin + loopLength - (loopLength % blockAlign);
+	if (m_loopEnd > m_dataLength || m_loopEnd <= m_loopBegin)
+	{
+		m_loopEnd = m_dataLength;
+	}
+
+	Reset(loopCount);
+}
+
+void DX::AudioStreamScheduler::Rewind(uint32_t loopCount)
+{
+	m_loopsRemaining = loopCount;
+	m_position = 0;
+	m_endOfStream = (m_dataLength == 0);
+}
+
+void DX::AudioStreamScheduler::Reset(uint32_t loopCount)
+{
+	m_inUseCount.store(0);
+	m_nextBuffer = 0;
+	Rewind(loopCount);
+}
+
+bool DX::AudioStreamScheduler::GetNextChunk(AudioStreamChunk& chunk)
+{
+	if (m_endOfStream || m_inUseCount.load() >= m_bufferCount)
+	{
+		return false;
+	}
+
+	// Read up to the end of the loop region while there are loops left, otherwise up to the end of the data.
+	bool looping = (m_loopsRemaining != 0 && m_position < m_loopEnd);
+	auto end = looping ? m_loopEnd : m_dataLength;
+	auto remaining = end - m_position;
+
+	chunk.m_buffer = m_nextBuffer;
+	chunk.m_offset = m_position;
+	chunk.m_byteCount = (remaining < m_bufferSize) ? static_cast<uint32_t>(remaining) : m_bufferSize;
+	chunk.m_endOfStream = false;
+
+	m_position += chunk.m_byteCount;
+	if (m_position == end)
+	{
+		if (looping)
+		{
+			m_position = m_loopBegin;
+			if (m_loopsRemaining != LoopInfinite)
+			{
+				m_loopsRemaining--;
+			}
+		}
+		else
+		{
+			chunk.m_endOfStream = true;
+			m_endOfStream = true;
+		}
+	}
+
+	m_nextBuffer = (m_nextBuffer + 1) % m_bufferCount;
+	m_inUseCount++;
+
+	return true;
+}
+
+void DX::AudioStreamScheduler::OnBufferEnd()
+{
+	// Guard against extra calls (e.g. for buffers that were submitted before a Reset) so that the count can't wrap around.
+	auto count = m_inUseCount.load();
+	while (count > 0 && !m_inUseCount.compare_exchange_weak(count, count - 1))
+	{
+	}
+}
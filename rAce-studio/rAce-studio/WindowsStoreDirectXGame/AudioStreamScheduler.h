@@ -0,0 +1,125 @@
+#pragma once
+
+// Portable (see README_PORTABLE.txt) so that the buffering logic can be driven by a fake voice.
+#include <atomic>
+#include <cstdint>
+
+namespace DX
+{
+	// A chunk of a stream that the reader should read into one of the stream's buffers and then submit to the voice.
+	struct AudioStreamChunk
+	{
+		// The index of the buffer to read into.
+		uint32_t					m_buffer;
+		// The offset of the chunk from the start of the audio data, in bytes.
+		uint64_t					m_offset;
+		// The number of bytes to read. Always a whole number of blocks.
+		uint32_t					m_byteCount;
+		// True if this is the last chunk of the stream (i.e. submit it with XAUDIO2_END_OF_STREAM).
+		bool						m_endOfStream;
+	};
+
+	// Decides which part of a streamed sound goes into which buffer. A streamed sound is played from a small ring of fixed size buffers (two or
+	// three is normal) rather than from one buffer holding all of its data. The reader asks for the next chunk whenever a buffer is free, reads
+	// the chunk into that buffer, and submits it to the voice. When the voice finishes playing a buffer it tells the scheduler, which frees the
+	// buffer for the next chunk. The voice plays buffers in the order they were submitted so the buffers are simply used round robin.
+	// Looping is done here rather than by the voice: when the read position reaches the end of the loop region it jumps back to the start of it,
+	// and chunks never straddle the end of the loop region. GetNextChunk must only be called from one thread at a time (the reader); OnBufferEnd
+	// may be called from another thread (the voice's callback thread).
+	class AudioStreamScheduler
+	{
+	public:
+		// The loop count that means loop forever.
+		static const uint32_t LoopInfinite = 0xFFFFFFFF;
+
+		// Constructor. Call Initialize before using the instance.
+		AudioStreamScheduler();
+
+		// Sets up the stream and rewinds it to the start.
+		// bufferCount - The number of buffers in the ring. Must be greater than zero.
+		// bufferSize - The size of each buffer in bytes. Rounded down to a whole number of blocks (but never less than one block).
+		// blockAlign - The size of one block of audio data in bytes (WAVEFORMATEX::nBlockAlign). Chunks never split a block.
+		// dataLength - The length of the audio data in bytes.
+		// loopBegin - The start of the loop region, in bytes from the start of the audio data.
+		// loopLength - The length of the loop region in bytes. 0 means loop from loopBegin to the end of the data.
+		// loopCount - The number of times to play the loop region again after the first time through. 0 means play once. Use LoopInfinite to loop forever.
+		void Initialize(
+			uint32_t bufferCount,
+			uint32_t bufferSize,
+			uint32_t blockAlign,
+			uint64_t dataLength,
+			uint64_t loopBegin,
+			uint64_t loopLength,
+			uint32_t loopCount
+			);
+
+		// Rewinds the stream to the start with a new loop count. Every buffer must have been returned with OnBufferEnd (or the voice flushed and the
+		// in use count forgotten with Reset).
+		// loopCount - The number of times to play the loop region again after the first time through.
+		void Rewind(uint32_t loopCount);
+
+		// Forgets every buffer that is in use (e.g. after the voice's buffers were flushed) and rewinds the stream.
+		// loopCount - The number of times to play the loop region again after the first time through.
+		void Reset(uint32_t loopCount);
+
+		// Gets the next chunk to read if a buffer is free and the stream hasn't ended. The buffer counts as in use from now until OnBufferEnd.
+		// chunk - Receives the chunk.
+		// Returns true if there is a chunk to read, false if every buffer is in use or the whole stream has been handed out.
+		bool GetNextChunk(AudioStreamChunk& chunk);
+
+		// Frees the oldest buffer in use. Call this when the voice has finished playing a buffer (IXAudio2VoiceCallback::OnBufferEnd).
+		void OnBufferEnd();
+
+		// Returns true if the whole stream has been handed out and every buffer has been played. Call it from the reader's thread (or while holding
+		// whatever keeps the reader out), since GetNextChunk sets the end of stream flag without any synchronization.
+		bool IsFinished() const { return m_endOfStream && m_inUseCount.load() == 0; }
+
+		// Returns the number of buffers that are being read or are waiting to be played.
+		uint32_t GetInUseCount() const { return m_inUseCount.load(); }
+
+		// Returns the number of buffers in the ring.
+		uint32_t GetBufferCount() const { return m_bufferCount; }
+
+		// Returns the size of each buffer in bytes.
+		uint32_t GetBufferSize() const { return m_bufferSize; }
+
+		// Returns the number of loops left to play (or LoopInfinite).
+		uint32_t GetLoopsRemaining() const { return m_loopsRemaining; }
+
+	private:
+		// Disable copy constructor.
+		AudioStreamScheduler(const AudioStreamScheduler&);
+		// Disable copy assignment.
+		AudioStreamScheduler& operator=(const AudioStreamScheduler&);
+
+		// The number of buffers in the ring.
+		uint32_t					m_bufferCount;
+
+		// The size of each buffer in bytes (a whole number of blocks).
+		uint32_t					m_bufferSize;
+
+		// The length of the audio data in bytes.
+		uint64_t					m_dataLength;
+
+		// The start of the loop region in bytes.
+		uint64_t					m_loopBegin;
+
+		// The end of the loop region in bytes.
+		uint64_t					m_loopEnd;
+
+		// The number of loops left to play (or LoopInfinite).
+		uint32_t					m_loopsRemaining;
+
+		// The offset of the next chunk to hand out.
+		uint64_t					m_position;
+
+		// The buffer that the next chunk goes into.
+		uint32_t					m_nextBuffer;
+
+		// True once the chunk marked as the end of the stream has been handed out.
+		bool						m_endOfStream;
+
+		// The number of buffers that are in use. Incremented by the reader and decremented by the voice's callback thread.
+		std::atomic<uint32_t>		m_inUseCount;
+	};
+}
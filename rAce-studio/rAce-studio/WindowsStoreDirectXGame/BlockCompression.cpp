@@ -0,0 +1,870 @@
+#include "BlockCompression.h"
+
+#include <cstring>
+
+#if defined(_M_IX86) || defined(_M_X64) || defined(__SSE2__)
+#define BLOCK_COMPRESSION_SSE2
+#include <emmintrin.h>
+#elif defined(_M_ARM) || defined(__ARM_NEON__) || defined(__ARM_NEON)
+#define BLOCK_COMPRESSION_NEON
+#include <arm_neon.h>
+#endif
+
+namespace
+{
+	// Expands a 5-bit channel to 8 bits by replicating its high bits into the low bits (so 0 maps to 0 and 31 maps to 255).
+	const uint8_t Expand5To8[32] =
+	{
+		0, 8, 16, 24, 33, 41, 49, 57, 66, 74, 82, 90, 99, 107, 115, 123,
+		132, 140, 148, 156, 165, 173, 181, 189, 198, 206, 214, 222, 231, 239, 247, 255
+	};
+
+	// Expands a 6-bit channel to 8 bits by replicating its high bits into the low bits (so 0 maps to 0 and 63 maps to 255).
+	const uint8_t Expand6To8[64] =
+	{
+		0, 4, 8, 12, 16, 20, 24, 28, 32, 36, 40, 44, 48, 52, 56, 60,
+		65, 69, 73, 77, 81, 85, 89, 93, 97, 101, 105, 109, 113, 117, 121, 125,
+		130, 134, 138, 142, 146, 150, 154, 158, 162, 166, 170, 174, 178, 182, 186, 190,
+		195, 199, 203, 207, 211, 215, 219, 223, 227, 231, 235, 239, 243, 247, 251, 255
+	};
+
+	// Decodes one 4x4 block. Every decoder for a format has this signature so that the block row loop only picks the decoder once.
+	typedef void (*BlockDecoder)(const uint8_t* block, uint8_t* destination, size_t destinationRowPitch);
+
+	// Packs four channels into a B8G8R8A8 texel (blue in the lowest byte, which is the first byte in memory).
+	inline uint32_t PackBGRA(uint32_t b, uint32_t g, uint32_t r, uint32_t a)
+	{
+		return b | (g << 8) | (r << 16) | (a << 24);
+	}
+
+	// Builds the four colors of a BC1 style color block (the whole of a BC1 block or the second half of a BC3 block) as B8G8R8A8 texels.
+	// block - The color block.
+	// allowTransparent - True for BC1, where color0 <= color1 selects three colors plus transparent black. BC3 color blocks always use four colors.
+	// alpha - The alpha value of the opaque colors.
+	// palette - Receives the colors, in index order.
+	inline void GetColorPalette(const uint8_t* block, bool allowTransparent, uint32_t alpha, uint32_t palette[4])
+	{
+		uint32_t color0 = block[0] | (block[1] << 8);
+		uint32_t color1 = block[2] | (block[3] << 8);
+
+		uint32_t b0 = Expand5To8[color0 & 0x1F];
+		uint32_t g0 = Expand6To8[(color0 >> 5) & 0x3F];
+		uint32_t r0 = Expand5To8[color0 >> 11];
+		uint32_t b1 = Expand5To8[color1 & 0x1F];
+		uint32_t g1 = Expand6To8[(color1 >> 5) & 0x3F];
+		uint32_t r1 = Expand5To8[color1 >> 11];
+
+		palette[0] = PackBGRA(b0, g0, r0, alpha);
+		palette[1] = PackBGRA(b1, g1, r1, alpha);
+
+		if (!allowTransparent || color0 > color1)
+		{
+			// Colors 2 and 3 are 1/3 and 2/3 of the way from color 0 to color 1.
+			palette[2] = PackBGRA(((2 * b0) + b1 + 1) / 3, ((2 * g0) + g1 + 1) / 3, ((2 * r0) + r1 + 1) / 3, alpha);
+			palette[3] = PackBGRA((b0 + (2 * b1) + 1) / 3, (g0 + (2 * g1) + 1) / 3, (r0 + (2 * r1) + 1) / 3, alpha);
+		}
+		else
+		{
+			// Color 2 is halfway between colors 0 and 1 and color 3 is transparent black.
+			palette[2] = PackBGRA((b0 + b1 + 1) / 2, (g0 + g1 + 1) / 2, (r0 + r1 + 1) / 2, alpha);
+			palette[3] = 0;
+		}
+	}
+
+	// Builds the eight alpha values of a BC3 style alpha block.
+	// block - The alpha block.
+	// palette - Receives the alpha values, in index order.
+	inline void GetAlphaPalette(const uint8_t* block, uint8_t palette[8])
+	{
+		uint32_t alpha0 = block[0];
+		uint32_t alpha1 = block[1];
+		palette[0] = static_cast<uint8_t>(alpha0);
+		palette[1] = static_cast<uint8_t>(alpha1);
+
+		if (alpha0 > alpha1)
+		{
+			// All six remaining values are interpolated.
+			for (uint32_t i = 1; i < 7; i++)
+			{
+				palette[i + 1] = static_cast<uint8_t>((((7 - i) * alpha0) + (i * alpha1) + 3) / 7);
+			}
+		}
+		else
+		{
+			// Four values are interpolated and the last two are fully transparent and fully opaque.
+			for (uint32_t i = 1; i < 5; i++)
+			{
+				palette[i + 1] = static_cast<uint8_t>((((5 - i) * alpha0) + (i * alpha1) + 2) / 5);
+			}
+			palette[6] = 0;
+			palette[7] = 255;
+		}
+	}
+
+	// Converts a signed channel value of numerator / (denominator * 127) to a byte, rounding once. Negative values become zero, the same as
+	// writing them to a UNORM render target would.
+	inline uint8_t SignedToByte(int32_t numerator, int32_t denominator)
+	{
+		if (numerator <= 0)
+		{
+			return 0;
+		}
+
+		auto scale = denominator * 127;
+		return static_cast<uint8_t>(((numerator * 255) + (scale / 2)) / scale);
+	}
+
+	// Builds the eight values of a BC4_SNORM style block, converted to bytes with SignedToByte. The endpoints are signed bytes where both -128
+	// and -127 mean -1.0. The interpolation is done on the signed values and each result is only rounded once, when it is converted.
+	// block - The block.
+	// palette - Receives the values, in index order.
+	inline void GetSignedAlphaPalette(const uint8_t* block, uint8_t palette[8])
+	{
+		int32_t alpha0 = static_cast<int8_t>(block[0]);
+		int32_t alpha1 = static_cast<int8_t>(block[1]);
+		bool hasEightValues = alpha0 > alpha1;
+		alpha0 = (alpha0 == -128) ? -127 : alpha0;
+		alpha1 = (alpha1 == -128) ? -127 : alpha1;
+		palette[0] = SignedToByte(alpha0, 1);
+		palette[1] = SignedToByte(alpha1, 1);
+
+		if (hasEightValues)
+		{
+			for (int32_t i = 1; i < 7; i++)
+			{
+				palette[i + 1] = SignedToByte(((7 - i) * alpha0) + (i * alpha1), 7);
+			}
+		}
+		else
+		{
+			// Four values are interpolated and the last two are -1.0 and 1.0.
+			for (int32_t i = 1; i < 5; i++)
+			{
+				palette[i + 1] = SignedToByte(((5 - i) * alpha0) + (i * alpha1), 5);
+			}
+			palette[6] = 0;
+			palette[7] = 255;
+		}
+	}
+
+	// Looks up the alpha value of each of the 16 texels of a BC3 style alpha block.
+	// block - The alpha block.
+	// isSigned - True for a BC4_SNORM or BC5_SNORM style block with signed endpoints (see GetSignedAlphaPalette).
+	// alphas - Receives the alpha values in row order.
+	inline void DecodeAlphaBlock(const uint8_t* block, bool isSigned, uint8_t alphas[16])
+	{
+		uint8_t palette[8];
+		if (isSigned)
+		{
+			GetSignedAlphaPalette(block, palette);
+		}
+		else
+		{
+			GetAlphaPalette(block, palette);
+		}
+
+		// The remaining 6 bytes are a 3 bits per texel index map.
+		uint64_t indices = 0;
+		for (uint32_t i = 0; i < 6; i++)
+		{
+			indices |= static_cast<uint64_t>(block[2 + i]) << (8 * i);
+		}
+
+		for (uint32_t i = 0; i < 16; i++)
+		{
+			alphas[i] = palette[(indices >> (3 * i)) & 7];
+		}
+	}
+
+	// Writes the 16 texels of a color block given its palette. Each texel's 2-bit index picks its palette entry. On x86/x64 (SSE2) and ARM (NEON)
+	// each row of 4 texels is built in one register by splitting the indices into their low and high bits and using them as select masks, so the
+	// whole block is decoded without branches or per texel loads. If alphas isn't nullptr then each texel's alpha is ORed in from it (the palette
+	// must have zero alpha).
+	// palette - The four colors of the block.
+	// indices - The 2 bits per texel index map (texel 0 in the lowest bits).
+	// alphas - The alpha value of each texel in row order, or nullptr.
+	// destination - Receives the texels.
+	// destinationRowPitch - The number of bytes between the start of each row of the destination.
+	inline void WriteColorBlock(
+		const uint32_t palette[4],
+		uint32_t indices,
+		const uint8_t* alphas,
+		uint8_t* destination,
+		size_t destinationRowPitch
+		)
+	{
+#if defined(BLOCK_COMPRESSION_SSE2)
+		// Bit 0 and bit 1 of each texel's index for the 4 texels of a row (one texel per 32-bit lane).
+		const __m128i lowBits = _mm_setr_epi32(1, 4, 16, 64);
+		const __m128i highBits = _mm_setr_epi32(2, 8, 32, 128);
+		const __m128i zero = _mm_setzero_si128();
+
+		const __m128i color0 = _mm_set1_epi32(static_cast<int>(palette[0]));
+		const __m128i color2 = _mm_set1_epi32(static_cast<int>(palette[2]));
+		const __m128i difference01 = _mm_set1_epi32(static_cast<int>(palette[0] ^ palette[1]));
+		const __m128i difference23 = _mm_set1_epi32(static_cast<int>(palette[2] ^ palette[3]));
+
+		for (uint32_t y = 0; y < 4; y++)
+		{
+			__m128i rowIndices = _mm_set1_epi32(static_cast<int>((indices >> (8 * y)) & 0xFF));
+			__m128i lowMask = _mm_cmpeq_epi32(_mm_and_si128(rowIndices, lowBits), lowBits);
+			__m128i highMask = _mm_cmpeq_epi32(_mm_and_si128(rowIndices, highBits), highBits);
+
+			// Select between colors 0 and 1 and between colors 2 and 3 with the low bit, then between those with the high bit.
+			__m128i low = _mm_xor_si128(color0, _mm_and_si128(difference01, lowMask));
+			__m128i high = _mm_xor_si128(color2, _mm_and_si128(difference23, lowMask));
+			__m128i texels = _mm_xor_si128(low, _mm_and_si128(_mm_xor_si128(low, high), highMask));
+
+			if (alphas != nullptr)
+			{
+				// Widen the row's 4 alpha bytes to the top byte of each lane.
+				int32_t rowAlphas;
+				memcpy(&rowAlphas, alphas + (4 * y), sizeof(rowAlphas));
+				__m128i alpha = _mm_unpacklo_epi8(zero, _mm_cvtsi32_si128(rowAlphas));
+				texels = _mm_or_si128(texels, _mm_unpacklo_epi16(zero, alpha));
+			}
+
+			_mm_storeu_si128(reinterpret_cast<__m128i*>(destination + (y * destinationRowPitch)), texels);
+		}
+#elif defined(BLOCK_COMPRESSION_NEON)
+		static const uint32_t lowBitValues[4] = { 1, 4, 16, 64 };
+		static const uint32_t highBitValues[4] = { 2, 8, 32, 128 };
+		const uint32x4_t lowBits = vld1q_u32(lowBitValues);
+		const uint32x4_t highBits = vld1q_u32(highBitValues);
+
+		const uint32x4_t color0 = vdupq_n_u32(palette[0]);
+		const uint32x4_t color1 = vdupq_n_u32(palette[1]);
+		const uint32x4_t color2 = vdupq_n_u32(palette[2]);
+		const uint32x4_t color3 = vdupq_n_u32(palette[3]);
+
+		for (uint32_t y = 0; y < 4; y++)
+		{
+			uint32x4_t rowIndices = vdupq_n_u32((indices >> (8 * y)) & 0xFF);
+			uint32x4_t lowMask = vtstq_u32(rowIndices, lowBits);
+			uint32x4_t highMask = vtstq_u32(rowIndices, highBits);
+
+			// Select between colors 0 and 1 and between colors 2 and 3 with the low bit, then between those with the high bit.
+			uint32x4_t texels = vbslq_u32(highMask, vbslq_u32(lowMask, color3, color2), vbslq_u32(lowMask, color1, color0));
+
+			if (alphas != nullptr)
+			{
+				// Widen the row's 4 alpha bytes to the top byte of each lane.
+				uint32_t rowAlphas;
+				memcpy(&rowAlphas, alphas + (4 * y), sizeof(rowAlphas));
+				uint32x4_t alpha = vmovl_u16(vget_low_u16(vmovl_u8(vreinterpret_u8_u32(vdup_n_u32(rowAlphas)))));
+				texels = vorrq_u32(texels, vshlq_n_u32(alpha, 24));
+			}
+
+			vst1q_u8(destination + (y * destinationRowPitch), vreinterpretq_u8_u32(texels));
+		}
+#else
+		for (uint32_t y = 0; y < 4; y++)
+		{
+			uint32_t row[4];
+			for (uint32_t x = 0; x < 4; x++)
+			{
+				row[x] = palette[(indices >> (2 * ((y * 4) + x))) & 3];
+				if (alphas != nullptr)
+				{
+					row[x] |= static_cast<uint32_t>(alphas[(y * 4) + x]) << 24;
+				}
+			}
+
+			// The texels were packed with blue in the lowest byte so on little-endian targets they can be copied as is.
+			memcpy(destination + (y * destinationRowPitch), row, sizeof(row));
+		}
+#endif
+	}
+
+	// Reads the 2 bits per texel index map of a color block.
+	inline uint32_t GetColorIndices(const uint8_t* block)
+	{
+		return block[4] | (block[5] << 8) | (block[6] << 16) | (static_cast<uint32_t>(block[7]) << 24);
+	}
+
+	void DecodeBC1BlockBGRA(const uint8_t* block, uint8_t* destination, size_t destinationRowPitch)
+	{
+		uint32_t palette[4];
+		GetColorPalette(block, true, 0xFF, palette);
+		WriteColorBlock(palette, GetColorIndices(block), nullptr, destination, destinationRowPitch);
+	}
+
+	void DecodeBC3BlockBGRA(const uint8_t* block, uint8_t* destination, size_t destinationRowPitch)
+	{
+		uint8_t alphas[16];
+		DecodeAlphaBlock(block, false, alphas);
+
+		uint32_t palette[4];
+		GetColorPalette(block + 8, false, 0, palette);
+		WriteColorBlock(palette, GetColorIndices(block + 8), alphas, destination, destinationRowPitch);
+	}
+
+	void DecodeBC1BlockAlpha(const uint8_t* block, uint8_t* destination, size_t destinationRowPitch)
+	{
+		uint32_t color0 = block[0] | (block[1] << 8);
+		uint32_t color1 = block[2] | (block[3] << 8);
+
+		// Only index 3 in a block where color0 <= color1 is transparent so most blocks are entirely opaque.
+		if (color0 > color1)
+		{
+			for (uint32_t y = 0; y < 4; y++)
+			{
+				memset(destination + (y * destinationRowPitch), 0xFF, 4);
+			}
+			return;
+		}
+
+		auto indices = GetColorIndices(block);
+		for (uint32_t y = 0; y < 4; y++)
+		{
+			auto row = destination + (y * destinationRowPitch);
+			for (uint32_t x = 0; x < 4; x++)
+			{
+				row[x] = (((indices >> (2 * ((y * 4) + x))) & 3) == 3) ? 0 : 0xFF;
+			}
+		}
+	}
+
+	void DecodeBC3BlockAlpha(const uint8_t* block, uint8_t* destination, size_t destinationRowPitch)
+	{
+		uint8_t alphas[16];
+		DecodeAlphaBlock(block, false, alphas);
+
+		for (uint32_t y = 0; y < 4; y++)
+		{
+			memcpy(destination + (y * destinationRowPitch), alphas + (4 * y), 4);
+		}
+	}
+
+	// Shared implementation of the BC4 and BC4_SNORM decoders.
+	inline void DecodeBC4Block(const uint8_t* block, bool isSigned, uint8_t* destination, size_t destinationRowPitch)
+	{
+		uint8_t alphas[16];
+		DecodeAlphaBlock(block, isSigned, alphas);
+
+		// Every texel is white so all four palette entries are the same and only the alpha values differ.
+		const uint32_t palette[4] = { 0x00FFFFFF, 0x00FFFFFF, 0x00FFFFFF, 0x00FFFFFF };
+		WriteColorBlock(palette, 0, alphas, destination, destinationRowPitch);
+	}
+
+	// Shared implementation of the BC4 and BC4_SNORM alpha only decoders.
+	inline void DecodeBC4BlockAlphaOnly(const uint8_t* block, bool isSigned, uint8_t* destination, size_t destinationRowPitch)
+	{
+		uint8_t alphas[16];
+		DecodeAlphaBlock(block, isSigned, alphas);
+
+		for (uint32_t y = 0; y < 4; y++)
+		{
+			memcpy(destination + (y * destinationRowPitch), alphas + (4 * y), 4);
+		}
+	}
+
+	// Shared implementation of the BC5 and BC5_SNORM decoders.
+	inline void DecodeBC5Block(const uint8_t* block, bool isSigned, uint8_t* destination, size_t destinationRowPitch)
+	{
+		uint8_t reds[16];
+		uint8_t greens[16];
+		DecodeAlphaBlock(block, isSigned, reds);
+		DecodeAlphaBlock(block + 8, isSigned, greens);
+
+		for (uint32_t y = 0; y < 4; y++)
+		{
+			uint32_t row[4];
+			for (uint32_t x = 0; x < 4; x++)
+			{
+				row[x] = PackBGRA(0, greens[(y * 4) + x], reds[(y * 4) + x], 0xFF);
+			}
+			memcpy(destination + (y * destinationRowPitch), row, sizeof(row));
+		}
+	}
+
+	void DecodeBC4BlockBGRA(const uint8_t* block, uint8_t* destination, size_t destinationRowPitch)
+	{
+		DecodeBC4Block(block, false, destination, destinationRowPitch);
+	}
+
+	void DecodeBC4BlockAlpha(const uint8_t* block, uint8_t* destination, size_t destinationRowPitch)
+	{
+		// BC4 blocks are laid out exactly like BC3 alpha blocks.
+		DecodeBC4BlockAlphaOnly(block, false, destination, destinationRowPitch);
+	}
+
+	void DecodeBC4SnormBlockBGRA(const uint8_t* block, uint8_t* destination, size_t destinationRowPitch)
+	{
+		DecodeBC4Block(block, true, destination, destinationRowPitch);
+	}
+
+	void DecodeBC4SnormBlockAlpha(const uint8_t* block, uint8_t* destination, size_t destinationRowPitch)
+	{
+		DecodeBC4BlockAlphaOnly(block, true, destination, destinationRowPitch);
+	}
+
+	void DecodeBC5BlockBGRA(const uint8_t* block, uint8_t* destination, size_t destinationRowPitch)
+	{
+		DecodeBC5Block(block, false, destination, destinationRowPitch);
+	}
+
+	void DecodeBC5SnormBlockBGRA(const uint8_t* block, uint8_t* destination, size_t destinationRowPitch)
+	{
+		DecodeBC5Block(block, true, destination, destinationRowPitch);
+	}
+
+	void DecodeBC5BlockAlpha(const uint8_t* /*block*/, uint8_t* destination, size_t destinationRowPitch)
+	{
+		// BC5 has no alpha channel (signed or not).
+		for (uint32_t y = 0; y < 4; y++)
+		{
+			memset(destination + (y * destinationRowPitch), 0xFF, 4);
+		}
+	}
+
+	// The layout of each BC7 block mode. See "BC7 Format Mode Reference" in the Direct3D 11 documentation.
+	struct BC7Mode
+	{
+		// The number of subsets (each subset has its own pair of endpoints).
+		uint8_t		m_subsetCount;
+		// The number of bits in the partition number, which picks the subset of each texel.
+		uint8_t		m_partitionBits;
+		// The number of bits in the rotation, which swaps alpha with one of the color channels after interpolating.
+		uint8_t		m_rotationBits;
+		// The number of bits in the index selector, which swaps the color and alpha index sets (mode 4 only).
+		uint8_t		m_indexSelectionBits;
+		// The number of bits in each color endpoint channel, not counting the p-bit.
+		uint8_t		m_colorBits;
+		// The number of bits in each alpha endpoint, not counting the p-bit. Zero if the mode has no alpha (which makes it opaque).
+		uint8_t		m_alphaBits;
+		// True if each endpoint has its own p-bit (a shared low bit for all of its channels).
+		uint8_t		m_hasEndpointPBits;
+		// True if both endpoints of each subset share a p-bit.
+		uint8_t		m_hasSharedPBits;
+		// The number of bits in each primary index.
+		uint8_t		m_indexBits;
+		// The number of bits in each secondary index. Zero if the mode has only one index set.
+		uint8_t		m_secondaryIndexBits;
+	};
+
+	const BC7Mode BC7Modes[8] =
+	{
+		{ 3, 4, 0, 0, 4, 0, 1, 0, 3, 0 },
+		{ 2, 6, 0, 0, 6, 0, 0, 1, 3, 0 },
+		{ 3, 6, 0, 0, 5, 0, 0, 0, 2, 0 },
+		{ 2, 6, 0, 0, 7, 0, 1, 0, 2, 0 },
+		{ 1, 0, 2, 1, 5, 6, 0, 0, 2, 3 },
+		{ 1, 0, 2, 0, 7, 8, 0, 0, 2, 2 },
+		{ 1, 0, 0, 0, 7, 7, 1, 0, 4, 0 },
+		{ 2, 6, 0, 0, 5, 5, 1, 0, 2, 0 }
+	};
+
+	// The two subset partitions. Bit n is the subset of texel n.
+	const uint16_t BC7Partitions2[64] =
+	{
+		0xCCCC, 0x8888, 0xEEEE, 0xECC8, 0xC880, 0xFEEC, 0xFEC8, 0xEC80, 0xC800, 0xFFEC, 0xFE80, 0xE800, 0xFFE8, 0xFF00, 0xFFF0, 0xF000,
+		0xF710, 0x008E, 0x7100, 0x08CE, 0x008C, 0x7310, 0x3100, 0x8CCE, 0x088C, 0x3110, 0x6666, 0x366C, 0x17E8, 0x0FF0, 0x718E, 0x399C,
+		0xAAAA, 0xF0F0, 0x5A5A, 0x33CC, 0x3C3C, 0x55AA, 0x9696, 0xA55A, 0x73CE, 0x13C8, 0x324C, 0x3BDC, 0x6996, 0xC33C, 0x9966, 0x0660,
+		0x0272, 0x04E4, 0x4E40, 0x2720, 0xC936, 0x936C, 0x39C6, 0x639C, 0x9336, 0x9CC6, 0x817E, 0xE718, 0xCCF0, 0x0FCC, 0x7744, 0xEE22
+	};
+
+	// The three subset partitions. Bits (2n, 2n + 1) are the subset of texel n.
+	const uint32_t BC7Partitions3[64] =
+	{
+		0xAA685050, 0x6A5A5040, 0x5A5A4200, 0x5450A0A8, 0xA5A50000, 0xA0A05050, 0x5555A0A0, 0x5A5A5050,
+		0xAA550000, 0xAA555500, 0xAAAA5500, 0x90909090, 0x94949494, 0xA4A4A4A4, 0xA9A59450, 0x2A0A4250,
+		0xA5945040, 0x0A425054, 0xA5A5A500, 0x55A0A0A0, 0xA8A85454, 0x6A6A4040, 0xA4A45000, 0x1A1A0500,
+		0x0050A4A4, 0xAAA59090, 0x14696914, 0x69691400, 0xA08585A0, 0xAA821414, 0x50A4A450, 0x6A5A0200,
+		0xA9A58000, 0x5090A0A8, 0xA8A09050, 0x24242424, 0x00AA5500, 0x24924924, 0x24499224, 0x50A50A50,
+		0x500AA550, 0xAAAA4444, 0x66660000, 0xA5A0A5A0, 0x50A050A0, 0x69286928, 0x44AAAA44, 0x66666600,
+		0xAA444444, 0x54A854A8, 0x95809580, 0x96969600, 0xA85454A8, 0x80959580, 0xAA141414, 0x96960000,
+		0xAAAA1414, 0xA05050A0, 0xA0A5A5A0, 0x96000000, 0x40804080, 0xA9A8A9A8, 0xAAAAAA44, 0x2A4A5254
+	};
+
+	// The anchor texel of the second subset of each two subset partition. The anchor texel of each subset stores its index with one less bit
+	// (the high bit is implied to be zero). Texel 0 is always the anchor of the first subset.
+	const uint8_t BC7Anchors2[64] =
+	{
+		15, 15, 15, 15, 15, 15, 15, 15, 15, 15, 15, 15, 15, 15, 15, 15,
+		15, 2, 8, 2, 2, 8, 8, 15, 2, 8, 2, 2, 8, 8, 2, 2,
+		15, 15, 6, 8, 2, 8, 15, 15, 2, 8, 2, 2, 2, 15, 15, 6,
+		6, 2, 6, 8, 15, 15, 2, 2, 15, 15, 15, 15, 15, 2, 2, 15
+	};
+
+	// The anchor texels of the second and third subsets of each three subset partition.
+	const uint8_t BC7Anchors3[64][2] =
+	{
+		{ 3, 15 }, { 3, 8 }, { 15, 8 }, { 15, 3 }, { 8, 15 }, { 3, 15 }, { 15, 3 }, { 15, 8 },
+		{ 8, 15 }, { 8, 15 }, { 6, 15 }, { 6, 15 }, { 6, 15 }, { 5, 15 }, { 3, 15 }, { 3, 8 },
+		{ 3, 15 }, { 3, 8 }, { 8, 15 }, { 15, 3 }, { 3, 15 }, { 3, 8 }, { 6, 15 }, { 10, 8 },
+		{ 5, 3 }, { 8, 15 }, { 8, 6 }, { 6, 10 }, { 8, 15 }, { 5, 15 }, { 15, 10 }, { 15, 8 },
+		{ 8, 15 }, { 15, 3 }, { 3, 15 }, { 5, 10 }, { 6, 10 }, { 10, 8 }, { 8, 9 }, { 15, 10 },
+		{ 15, 6 }, { 3, 15 }, { 15, 8 }, { 5, 15 }, { 15, 3 }, { 15, 6 }, { 15, 6 }, { 15, 8 },
+		{ 3, 15 }, { 15, 3 }, { 5, 15 }, { 5, 15 }, { 5, 15 }, { 8, 15 }, { 5, 15 }, { 10, 15 },
+		{ 5, 15 }, { 10, 15 }, { 8, 15 }, { 13, 15 }, { 15, 3 }, { 12, 15 }, { 3, 15 }, { 3, 8 }
+	};
+
+	// The interpolation weights (out of 64) for 2, 3, and 4 bit indices.
+	const uint8_t BC7Weights2[4] = { 0, 21, 43, 64 };
+	const uint8_t BC7Weights3[8] = { 0, 9, 18, 27, 37, 46, 55, 64 };
+	const uint8_t BC7Weights4[16] = { 0, 4, 9, 13, 17, 21, 26, 30, 34, 38, 43, 47, 51, 55, 60, 64 };
+
+	// Returns the interpolation weights for indices with the given number of bits.
+	inline const uint8_t* GetBC7Weights(uint32_t indexBits)
+	{
+		return (indexBits == 2) ? BC7Weights2 : ((indexBits == 3) ? BC7Weights3 : BC7Weights4);
+	}
+
+	// Reads the fields of a BC7 block in order, starting at bit 0 of byte 0.
+	class BC7BitReader
+	{
+	public:
+		explicit BC7BitReader(const uint8_t* block) :
+			m_low(),
+			m_high()
+		{
+			for (uint32_t i = 0; i < 8; i++)
+			{
+				m_low |= static_cast<uint64_t>(block[i]) << (8 * i);
+				m_high |= static_cast<uint64_t>(block[i + 8]) << (8 * i);
+			}
+		}
+
+		// Reads the next field. count must be less than 32.
+		uint32_t Read(uint32_t count)
+		{
+			if (count == 0)
+			{
+				return 0;
+			}
+
+			auto value = static_cast<uint32_t>(m_low & ((1ULL << count) - 1ULL));
+			m_low = (m_low >> count) | (m_high << (64 - count));
+			m_high >>= count;
+			return value;
+		}
+
+	private:
+		// The unread bits. The next field starts at bit 0 of m_low.
+		uint64_t		m_low;
+		uint64_t		m_high;
+	};
+
+	// Expands an endpoint channel with the given number of bits to 8 bits by replicating its high bits into the low bits.
+	inline uint32_t ExpandBC7Endpoint(uint32_t value, uint32_t bits)
+	{
+		value <<= (8 - bits);
+		return value | (value >> bits);
+	}
+
+	// Returns the index of the BC7 mode of a block (the number of zero bits before the first set bit) or 8 if the block has no mode bit.
+	inline uint32_t GetBC7Mode(const uint8_t* block)
+	{
+		uint32_t mode = 0;
+		while (mode < 8 && (block[0] & (1 << mode)) == 0)
+		{
+			mode++;
+		}
+		return mode;
+	}
+
+	void DecodeBC7BlockBGRA(const uint8_t* block, uint8_t* destination, size_t destinationRowPitch)
+	{
+		auto modeIndex = GetBC7Mode(block);
+
+		// Blocks with no mode bit are reserved and decode as transparent black.
+		if (modeIndex == 8)
+		{
+			for (uint32_t y = 0; y < 4; y++)
+			{
+				memset(destination + (y * destinationRowPitch), 0, 16);
+			}
+			return;
+		}
+
+		const auto& mode = BC7Modes[modeIndex];
+		BC7BitReader reader(block);
+		reader.Read(modeIndex + 1);
+
+		auto partition = reader.Read(mode.m_partitionBits);
+		auto rotation = reader.Read(mode.m_rotationBits);
+		auto indexSelection = reader.Read(mode.m_indexSelectionBits);
+
+		// The endpoints of each subset in R, G, B, A order. The channels of each endpoint are stored one after another: every red value, then every
+		// green value, and so on.
+		uint32_t endpoints[3][2][4];
+		for (uint32_t channel = 0; channel < 4; channel++)
+		{
+			auto bits = (channel < 3) ? mode.m_colorBits : mode.m_alphaBits;
+			for (uint32_t subset = 0; subset < mode.m_subsetCount; subset++)
+			{
+				endpoints[subset][0][channel] = reader.Read(bits);
+				endpoints[subset][1][channel] = reader.Read(bits);
+			}
+		}
+
+		// The p-bits become the low bit of every channel of their endpoints.
+		uint32_t colorBits = mode.m_colorBits;
+		uint32_t alphaBits = mode.m_alphaBits;
+		if (mode.m_hasEndpointPBits || mode.m_hasSharedPBits)
+		{
+			for (uint32_t subset = 0; subset < mode.m_subsetCount; subset++)
+			{
+				uint32_t pBits[2];
+				pBits[0] = reader.Read(1);
+				pBits[1] = mode.m_hasSharedPBits ? pBits[0] : reader.Read(1);
+				for (uint32_t endpoint = 0; endpoint < 2; endpoint++)
+				{
+					for (uint32_t channel = 0; channel < 4; channel++)
+					{
+						endpoints[subset][endpoint][channel] = (endpoints[subset][endpoint][channel] << 1) | pBits[endpoint];
+					}
+				}
+			}
+			colorBits++;
+			alphaBits = (alphaBits != 0) ? alphaBits + 1 : 0;
+		}
+
+		for (uint32_t subset = 0; subset < mode.m_subsetCount; subset++)
+		{
+			for (uint32_t endpoint = 0; endpoint < 2; endpoint++)
+			{
+				auto& value = endpoints[subset][endpoint];
+				value[0] = ExpandBC7Endpoint(value[0], colorBits);
+				value[1] = ExpandBC7Endpoint(value[1], colorBits);
+				value[2] = ExpandBC7Endpoint(value[2], colorBits);
+				value[3] = (alphaBits != 0) ? ExpandBC7Endpoint(value[3], alphaBits) : 255;
+			}
+		}
+
+		// Work out the subset of each texel and which texels are anchors.
+		uint32_t subsets[16];
+		uint32_t anchorMask = 1;
+		for (uint32_t i = 0; i < 16; i++)
+		{
+			switch (mode.m_subsetCount)
+			{
+			case 2:
+				subsets[i] = (BC7Partitions2[partition] >> i) & 1;
+				break;
+			case 3:
+				subsets[i] = (BC7Partitions3[partition] >> (2 * i)) & 3;
+				break;
+			default:
+				subsets[i] = 0;
+				break;
+			}
+		}
+
+		if (mode.m_subsetCount == 2)
+		{
+			anchorMask |= 1 << BC7Anchors2[partition];
+		}
+		else if (mode.m_subsetCount == 3)
+		{
+			anchorMask |= (1 << BC7Anchors3[partition][0]) | (1 << BC7Anchors3[partition][1]);
+		}
+
+		uint32_t indices[16];
+		for (uint32_t i = 0; i < 16; i++)
+		{
+			indices[i] = reader.Read(mode.m_indexBits - ((anchorMask >> i) & 1));
+		}
+
+		// Modes 4 and 5 have a second index set (whose only anchor is texel 0). Color uses the first set and alpha the second unless the index
+		// selector swaps them.
+		uint32_t secondaryIndices[16];
+		const uint32_t* colorIndices = indices;
+		const uint32_t* alphaIndices = indices;
+		auto colorWeights = GetBC7Weights(mode.m_indexBits);
+		auto alphaWeights = colorWeights;
+		if (mode.m_secondaryIndexBits != 0)
+		{
+			for (uint32_t i = 0; i < 16; i++)
+			{
+				secondaryIndices[i] = reader.Read(mode.m_secondaryIndexBits - ((i == 0) ? 1 : 0));
+			}
+
+			if (indexSelection == 0)
+			{
+				alphaIndices = secondaryIndices;
+				alphaWeights = GetBC7Weights(mode.m_secondaryIndexBits);
+			}
+			else
+			{
+				colorIndices = secondaryIndices;
+				colorWeights = GetBC7Weights(mode.m_secondaryIndexBits);
+			}
+		}
+
+		for (uint32_t y = 0; y < 4; y++)
+		{
+			uint32_t row[4];
+			for (uint32_t x = 0; x < 4; x++)
+			{
+				auto i = (y * 4) + x;
+				const auto& endpoint0 = endpoints[subsets[i]][0];
+				const auto& endpoint1 = endpoints[subsets[i]][1];
+				uint32_t colorWeight = colorWeights[colorIndices[i]];
+				uint32_t alphaWeight = alphaWeights[alphaIndices[i]];
+
+				uint32_t channels[4];
+				channels[0] = (((64 - colorWeight) * endpoint0[0]) + (colorWeight * endpoint1[0]) + 32) >> 6;
+				channels[1] = (((64 - colorWeight) * endpoint0[1]) + (colorWeight * endpoint1[1]) + 32) >> 6;
+				channels[2] = (((64 - colorWeight) * endpoint0[2]) + (colorWeight * endpoint1[2]) + 32) >> 6;
+				channels[3] = (((64 - alphaWeight) * endpoint0[3]) + (alphaWeight * endpoint1[3]) + 32) >> 6;
+
+				// Rotation 1, 2, or 3 swaps alpha with red, green, or blue.
+				if (rotation != 0)
+				{
+					auto swap = channels[rotation - 1];
+					channels[rotation - 1] = channels[3];
+					channels[3] = swap;
+				}
+
+				row[x] = PackBGRA(channels[2], channels[1], channels[0], channels[3]);
+			}
+			memcpy(destination + (y * destinationRowPitch), row, sizeof(row));
+		}
+	}
+
+	void DecodeBC7BlockAlpha(const uint8_t* block, uint8_t* destination, size_t destinationRowPitch)
+	{
+		auto modeIndex = GetBC7Mode(block);
+
+		// Modes 0 to 3 have no alpha so they are always opaque and there's no need to decode the block.
+		if (modeIndex < 4)
+		{
+			for (uint32_t y = 0; y < 4; y++)
+			{
+				memset(destination + (y * destinationRowPitch), 0xFF, 4);
+			}
+			return;
+		}
+
+		uint8_t texels[4 * 4 * 4];
+		DecodeBC7BlockBGRA(block, texels, 16);
+		for (uint32_t i = 0; i < 16; i++)
+		{
+			destination[((i / 4) * destinationRowPitch) + (i % 4)] = texels[(i * 4) + 3];
+		}
+	}
+
+	// Returns the decoder for a format.
+	// format - The block format.
+	// alphaOnly - True for the alpha only decoder, false for the B8G8R8A8 decoder.
+	BlockDecoder GetBlockDecoder(DX::BlockFormat format, bool alphaOnly)
+	{
+		switch (format)
+		{
+		case DX::BlockFormat::BC1:
+			return alphaOnly ? DecodeBC1BlockAlpha : DecodeBC1BlockBGRA;
+		case DX::BlockFormat::BC3:
+			return alphaOnly ? DecodeBC3BlockAlpha : DecodeBC3BlockBGRA;
+		case DX::BlockFormat::BC4:
+			return alphaOnly ? DecodeBC4BlockAlpha : DecodeBC4BlockBGRA;
+		case DX::BlockFormat::BC5:
+			return alphaOnly ? DecodeBC5BlockAlpha : DecodeBC5BlockBGRA;
+		case DX::BlockFormat::BC4Snorm:
+			return alphaOnly ? DecodeBC4SnormBlockAlpha : DecodeBC4SnormBlockBGRA;
+		case DX::BlockFormat::BC5Snorm:
+			return alphaOnly ? DecodeBC5BlockAlpha : DecodeBC5SnormBlockBGRA;
+		case DX::BlockFormat::BC7:
+			return alphaOnly ? DecodeBC7BlockAlpha : DecodeBC7BlockBGRA;
+		default:
+			return nullptr;
+		}
+	}
+
+	// Decodes a range of block rows with a decoder. See DX::DecodeBlockRowsBGRA.
+	// bytesPerTexel - The size of a destination texel (4 for B8G8R8A8 or 1 for alpha only).
+	void DecodeBlockRows(
+		BlockDecoder decoder,
+		uint32_t blockSize,
+		uint32_t bytesPerTexel,
+		const uint8_t* source,
+		size_t sourceRowPitch,
+		uint32_t width,
+		uint32_t height,
+		uint32_t firstBlockRow,
+		uint32_t blockRowCount,
+		uint8_t* destination
+		)
+	{
+		auto blocksPerRow = (width + 3) / 4;
+		auto destinationRowPitch = static_cast<size_t>(width) * bytesPerTexel;
+		auto blockWidthInBytes = 4 * bytesPerTexel;
+
+		for (uint32_t blockRow = firstBlockRow; blockRow < firstBlockRow + blockRowCount; blockRow++)
+		{
+			auto y = blockRow * 4;
+			auto rowCount = (height - y < 4) ? (height - y) : 4;
+			auto block = source + (blockRow * sourceRowPitch);
+			auto row = destination + (y * destinationRowPitch);
+
+			for (uint32_t blockColumn = 0; blockColumn < blocksPerRow; blockColumn++, block += blockSize)
+			{
+				auto x = blockColumn * 4;
+				auto columnCount = (width - x < 4) ? (width - x) : 4;
+
+				if (rowCount == 4 && columnCount == 4)
+				{
+					decoder(block, row + (x * bytesPerTexel), destinationRowPitch);
+					continue;
+				}
+
+				// The block hangs over the edge of the image so decode it to the side and copy the part that is inside the image.
+				uint8_t texels[4 * 4 * 4];
+				decoder(block, texels, blockWidthInBytes);
+				for (uint32_t i = 0; i < rowCount; i++)
+				{
+					memcpy(row + (i * destinationRowPitch) + (x * bytesPerTexel), texels + (i * blockWidthInBytes), columnCount * bytesPerTexel);
+				}
+			}
+		}
+	}
+}
+
+void DX::DecodeBlockBGRA(
+	BlockFormat format,
+	const uint8_t* block,
+	uint8_t* destination,
+	size_t destinationRowPitch
+	)
+{
+	GetBlockDecoder(format, false)(block, destination, destinationRowPitch);
+}
+
+void DX::DecodeBlockAlpha(
+	BlockFormat format,
+	const uint8_t* block,
+	uint8_t* destination,
+	size_t destinationRowPitch
+	)
+{
+	GetBlockDecoder(format, true)(block, destination, destinationRowPitch);
+}
+
+void DX::DecodeBlockRowsBGRA(
+	BlockFormat format,
+	const uint8_t* source,
+	size_t sourceRowPitch,
+	uint32_t width,
+	uint32_t height,
+	uint32_t firstBlockRow,
+	uint32_t blockRowCount,
+	uint8_t* destination
+	)
+{
+	DecodeBlockRows(GetBlockDecoder(format, false), GetBlockSizeInBytes(format), 4, source, sourceRowPitch, width, height, firstBlockRow, blockRowCount, destination);
+}
+
+void DX::DecodeBlockRowsAlpha(
+	BlockFormat format,
+	const uint8_t* source,
+	size_t sourceRowPitch,
+	uint32_t width,
+	uint32_t height,
+	uint32_t firstBlockRow,
+	uint32_t blockRowCount,
+	uint8_t* destination
+	)
+{
+	DecodeBlockRows(GetBlockDecoder(format, true), GetBlockSizeInBytes(format), 1, source, sourceRowPitch, width, height, firstBlockRow, blockRowCount, destination);
+}
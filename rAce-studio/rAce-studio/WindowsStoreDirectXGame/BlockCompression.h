@@ -0,0 +1,103 @@
+#pragma once
+
+// Portable (see README_PORTABLE.txt). CollisionMaskBuilder uses it to decode block compressed DDS files.
+#include <cstddef>
+#include <cstdint>
+
+namespace DX
+{
+	// The block compressed formats that can be decoded on the CPU. Every format stores each 4x4 block of texels in a fixed number of bytes.
+	enum class BlockFormat
+	{
+		// DXGI_FORMAT_BC1_UNORM. Two B5G6R5 colors plus two interpolated colors, with optional 1-bit alpha. 8 bytes per block.
+		BC1,
+		// DXGI_FORMAT_BC3_UNORM. BC1 style color plus two 8-bit alpha values with six interpolated alpha values. 16 bytes per block.
+		BC3,
+		// DXGI_FORMAT_BC4_UNORM. A single channel stored the same way as BC3 alpha. 8 bytes per block. The channel is decoded as alpha (with
+		// white color) since a single channel texture used for collision is an alpha mask.
+		BC4,
+		// DXGI_FORMAT_BC5_UNORM. Red and green channels each stored the same way as BC3 alpha. 16 bytes per block. Decodes as opaque.
+		BC5,
+		// DXGI_FORMAT_BC4_SNORM. BC4 with signed endpoints. Negative values decode as zero and 1.0 as 255, the same as rendering the texture to
+		// a B8G8R8A8_UNORM target (which is what GetTexture2DCollisionData does) would give.
+		BC4Snorm,
+		// DXGI_FORMAT_BC5_SNORM. BC5 with signed endpoints, decoded like BC4Snorm. Decodes as opaque.
+		BC5Snorm,
+		// DXGI_FORMAT_BC7_UNORM. Eight block modes with up to three subsets, each with their own endpoints. 16 bytes per block.
+		BC7
+	};
+
+	// Returns the number of bytes used to store each 4x4 block of texels.
+	// format - The block format.
+	inline uint32_t GetBlockSizeInBytes(BlockFormat format)
+	{
+		return (format == BlockFormat::BC1 || format == BlockFormat::BC4 || format == BlockFormat::BC4Snorm) ? 8 : 16;
+	}
+
+	// Decodes a single 4x4 block to B8G8R8A8 texels.
+	// format - The format of the block.
+	// block - The block's data.
+	// destination - Receives the texels. The first texel of the block is written here.
+	// destinationRowPitch - The number of bytes between the start of each row of the destination.
+	void DecodeBlockBGRA(
+		BlockFormat format,
+		const uint8_t* block,
+		uint8_t* destination,
+		size_t destinationRowPitch
+		);
+
+	// Decodes only the alpha channel of a single 4x4 block, one byte per texel. This is all that collision masks need and skips the color work.
+	// format - The format of the block.
+	// block - The block's data.
+	// destination - Receives the alpha values. The first texel of the block is written here.
+	// destinationRowPitch - The number of bytes between the start of each row of the destination.
+	void DecodeBlockAlpha(
+		BlockFormat format,
+		const uint8_t* block,
+		uint8_t* destination,
+		size_t destinationRowPitch
+		);
+
+	// Decodes a range of block rows (each block row is 4 texel rows) of an image to B8G8R8A8 texels. Each block row only touches its own texel
+	// rows so different ranges of the same image can be decoded on different threads at the same time. Blocks that hang over the right or bottom
+	// edge of the image (when the width or height isn't a multiple of 4) are clipped.
+	// format - The format of the image.
+	// source - The first block of the image (i.e. block row 0, not firstBlockRow).
+	// sourceRowPitch - The number of bytes between the start of each block row of the source (e.g. D3D11_MAPPED_SUBRESOURCE::RowPitch).
+	// width - The width of the image in texels.
+	// height - The height of the image in texels.
+	// firstBlockRow - The first block row to decode.
+	// blockRowCount - The number of block rows to decode.
+	// destination - The first texel of the image (i.e. texel row 0). Rows are width * 4 bytes with no padding between them.
+	void DecodeBlockRowsBGRA(
+		BlockFormat format,
+		const uint8_t* source,
+		size_t sourceRowPitch,
+		uint32_t width,
+		uint32_t height,
+		uint32_t firstBlockRow,
+		uint32_t blockRowCount,
+		uint8_t* destination
+		);
+
+	// Decodes only the alpha channel of a range of block rows of an image, one byte per texel. The result can be passed straight to
+	// CollisionMask::CreateFromAlpha. See DecodeBlockRowsBGRA for details.
+	// format - The format of the image.
+	// source - The first block of the image (i.e. block row 0, not firstBlockRow).
+	// sourceRowPitch - The number of bytes between the start of each block row of the source.
+	// width - The width of the image in texels.
+	// height - The height of the image in texels.
+	// firstBlockRow - The first block row to decode.
+	// blockRowCount - The number of block rows to decode.
+	// destination - The first texel of the image (i.e. texel row 0). Rows are width bytes with no padding between them.
+	void DecodeBlockRowsAlpha(
+		BlockFormat format,
+		const uint8_t* source,
+		size_t sourceRowPitch,
+		uint32_t width,
+		uint32_t height,
+		uint32_t firstBlockRow,
+		uint32_t blockRowCount,
+		uint8_t* destination
+		);
+}
@@ -0,0 +1,167 @@
+#include "pch.h"
+#include "CollisionDataReadback.h"
+#include "CollisionDetection2D.h"
+
+DX::CollisionDataReadback::CollisionDataReadback() :
+	m_scheduler(),
+	m_slots()
+{
+}
+
+void DX::CollisionDataReadback::Initialize(
+	uint32 slotCount,
+	uint32 frameLatency
+	)
+{
+	if (slotCount == 0)
+	{
+		throw ref new Platform::InvalidArgumentException(L"slotCount");
+	}
+
+	m_scheduler.Initialize(slotCount, frameLatency);
+	m_slots.clear();
+	m_slots.resize(slotCount);
+}
+
+void DX::CollisionDataReadback::Reset()
+{
+	m_scheduler.Reset();
+	for (auto& slot : m_slots)
+	{
+		slot.m_stagingTexture = nullptr;
+		slot.m_callback = nullptr;
+	}
+}
+
+bool DX::CollisionDataReadback::Request(
+	_In_ ID3D11Device* device,
+	_In_ ID3D11DeviceContext* context,
+	_In_ ID3D11ShaderResourceView* textureSRV,
+	Callback callback,
+	_In_opt_z_ const wchar_t* filename,
+	_In_ unsigned long lineNumber
+	)
+{
+	// If null filename was passed in, use an empty string.
+	if (filename == nullptr)
+	{
+		filename = L"";
+	}
+
+	// Extract the ID3D11Texture2D from the SRV so that we can get its desc.
+	Microsoft::WRL::ComPtr<ID3D11Resource> resource;
+	Microsoft::WRL::ComPtr<ID3D11Texture2D> texture;
+	textureSRV->GetResource(&resource);
+	DX::ThrowIfFailed(
+		resource.As(&texture), filename, lineNumber
+		);
+
+	D3D11_TEXTURE2D_DESC desc = {};
+	texture->GetDesc(&desc);
+
+	if (desc.SampleDesc.Count > 1 || desc.SampleDesc.Quality > 0)
+	{
+		DX::ThrowIfFailed(E_NOTIMPL, filename, lineNumber);
+	}
+
+	// Check the format now so that the error is thrown to the caller rather than from a later Update.
+	DX::ValidateTexture2DCollisionDataFormat(desc, filename, lineNumber);
+
+	// Don't claim the slot until its staging texture exists; if CreateTexture2D throws the slot has to stay free or Update would map a null
+	// texture.
+	auto slotIndex = m_scheduler.GetNextSlot();
+	if (slotIndex == ReadbackScheduler::NoSlot)
+	{
+		return false;
+	}
+
+	// The staging texture matches the texture's format but is configured for CPU read access (see GetTexture2DCollisionDataNoRender).
+	desc.Usage = D3D11_USAGE_STAGING;
+	desc.CPUAccessFlags = D3D11_CPU_ACCESS_READ;
+	desc.BindFlags = 0;
+	desc.MiscFlags = 0;
+
+	// Reuse the slot's staging texture if it matches, otherwise replace it.
+	auto& slot = m_slots[slotIndex];
+	if (slot.m_stagingTexture == nullptr || memcmp(&slot.m_desc, &desc, sizeof(desc)) != 0)
+	{
+		slot.m_stagingTexture = nullptr;
+		DX::ThrowIfFailed(
+			device->CreateTexture2D(
+			&desc,
+			nullptr,
+			&slot.m_stagingTexture
+			), filename, lineNumber
+			);
+		slot.m_desc = desc;
+	}
+
+	// Queue the copy. The GPU does it some time later and Update picks up the result.
+	context->CopyResource(slot.m_stagingTexture.Get(), texture.Get());
+	slot.m_callback = std::move(callback);
+	m_scheduler.Submit();
+
+	return true;
+}
+
+void DX::CollisionDataReadback::Update(_In_ ID3D11DeviceContext* context)
+{
+	// The scheduler only frees a slot once TryComplete returns, so the data and callbacks are collected first and the callbacks are called once
+	// polling is done. That way a callback that calls Request can reuse the slot that it came from.
+	std::vector<CompletedReadback> completed;
+	HRESULT error = S_OK;
+	m_scheduler.AdvanceFrame();
+	m_scheduler.Poll([this, context, &completed, &error](uint32 slot) -> bool
+	{
+		return TryComplete(context, slot, completed, error);
+	});
+
+	for (auto& readback : completed)
+	{
+		readback.m_callback(readback.m_data.get(), readback.m_width, readback.m_height);
+	}
+
+	DX::ThrowIfFailed(error, __FILEW__, __LINE__);
+}
+
+bool DX::CollisionDataReadback::TryComplete(
+	_In_ ID3D11DeviceContext* context,
+	uint32 slotIndex,
+	std::vector<CompletedReadback>& completed,
+	HRESULT& error
+	)
+{
+	auto& slot = m_slots[slotIndex];
+
+	// With D3D11_MAP_FLAG_DO_NOT_WAIT the runtime returns DXGI_ERROR_WAS_STILL_DRAWING rather than blocking if the copy hasn't finished.
+	D3D11_MAPPED_SUBRESOURCE mappedResource;
+	auto hr = context->Map(slot.m_stagingTexture.Get(), 0, D3D11_MAP_READ, D3D11_MAP_FLAG_DO_NOT_WAIT, &mappedResource);
+	if (hr == DXGI_ERROR_WAS_STILL_DRAWING)
+	{
+		return false;
+	}
+
+	// Throwing from here would leave the slot pending, and every later Update would try (and fail) to map it again. Instead drop the readback,
+	// free the slot, and let Update throw the error once polling is done.
+	if (FAILED(hr))
+	{
+		slot.m_callback = nullptr;
+		error = FAILED(error) ? error : hr;
+		return true;
+	}
+
+	CompletedReadback readback;
+	readback.m_data = DX::GetTexture2DCollisionDataFromMappedData(slot.m_desc, mappedResource);
+	context->Unmap(slot.m_stagingTexture.Get(), 0);
+
+	readback.m_width = slot.m_desc.Width;
+	readback.m_height = slot.m_desc.Height;
+	readback.m_callback = std::move(slot.m_callback);
+	slot.m_callback = nullptr;
+	if (readback.m_callback)
+	{
+		completed.push_back(std::move(readback));
+	}
+
+	return true;
+}
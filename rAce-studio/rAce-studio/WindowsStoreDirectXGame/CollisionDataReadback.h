@@ -0,0 +1,143 @@
+#pragma once
+
+#include <Windows.h>
+#include <wrl\client.h>
+
+#include <d3d11_1.h>
+
+#include <functional>
+#include <memory>
+#include <utility>
+#include <vector>
+
+#include "ReadbackScheduler.h"
+
+namespace DX
+{
+	// Reads collision data back from textures without stalling. GetTexture2DCollisionDataNoRender copies a texture to a staging texture and maps it
+	// straight away, which blocks the calling thread until the GPU has caught up. CollisionDataReadback instead copies the texture into one of a
+	// ring of staging textures and returns. Each frame, Update maps the staging textures whose copies were issued frameLatency frames ago using
+	// D3D11_MAP_FLAG_DO_NOT_WAIT, converts the data to B8G8R8A8 (the same way as GetTexture2DCollisionDataNoRender), and calls the callback that
+	// was passed to Request. Copies that the GPU hasn't finished yet are simply tried again on the next Update.
+	// All of the methods use the immediate context so they must be called from the rendering thread.
+	class CollisionDataReadback
+	{
+	public:
+		// The function called when a readback completes.
+		// data - The pixel data in BGRA format (see GetTexture2DCollisionDataNoRender). The data is only valid until the callback returns so copy it or
+		//        build a CollisionMask from it.
+		// width - The width of the texture in texels.
+		// height - The height of the texture in texels.
+		typedef std::function<void (const uint8* data, uint32 width, uint32 height)> Callback;
+
+		// Constructor. Call Initialize before using the instance.
+		CollisionDataReadback();
+
+		// Move constructor.
+		CollisionDataReadback(CollisionDataReadback&& value) :
+			m_scheduler(),
+			m_slots()
+		{
+			// Invoke the move assignment operator.
+			*this = std::move(value);
+		}
+
+		// Move assignment operator.
+		CollisionDataReadback& operator=(CollisionDataReadback&& value)
+		{
+			if (this != &value)
+			{
+				m_scheduler = std::move(value.m_scheduler);
+				m_slots.swap(value.m_slots);
+			}
+
+			return *this;
+		}
+
+		// Sets the size of the ring. Any pending readbacks are dropped without calling their callbacks.
+		// slotCount - The maximum number of readbacks that can be pending at once. Each slot keeps its staging texture around for reuse.
+		// frameLatency - The number of frames (calls to Update) to wait before trying to map a copy. 2 is usually enough for the GPU to have finished.
+		void Initialize(
+			uint32 slotCount = 4,
+			uint32 frameLatency = 2
+			);
+
+		// Drops every pending readback without calling their callbacks and releases the staging textures. Call this when the device is lost.
+		void Reset();
+
+		// Copies a texture into a staging texture and queues it to be read back. Returns false (without doing anything) if every slot is pending, in
+		// which case try again after the next Update.
+		// device - The game's ID3D11Device.
+		// context - The immediate context.
+		// textureSRV - An SRV of the ID3D11Texture2D resource whose data you want. Supports the formats listed for GetTexture2DCollisionDataNoRender.
+		// callback - Called from a later Update once the data has been read back.
+		// filename - Pass __FILEW__ for this parameter (or nullptr if you don't want the file name thrown used in any exception messages).
+		// lineNumber - Pass __LINE__ for this parameter to know which line of your game's code an exception came from. Helps with debugging.
+		// Throws the same exceptions as GetTexture2DCollisionDataNoRender if the texture can't be read back.
+		bool Request(
+			_In_ ID3D11Device* device,
+			_In_ ID3D11DeviceContext* context,
+			_In_ ID3D11ShaderResourceView* textureSRV,
+			Callback callback,
+			_In_opt_z_ const wchar_t* filename,
+			_In_ unsigned long lineNumber
+			);
+
+		// Collects the readbacks whose data is ready and calls their callbacks. Call this once per frame. Each readback's slot is freed before its
+		// callback is called, so callbacks may call Request even when every slot was pending.
+		// context - The immediate context.
+		// Throws a Platform::COMException with the HRESULT if mapping a staging texture fails for any reason other than the copy not having finished
+		// (e.g. DXGI_ERROR_DEVICE_REMOVED). That readback is dropped without calling its callback and its slot is freed. The error is thrown after
+		// the callbacks of the readbacks that did complete have been called.
+		void Update(_In_ ID3D11DeviceContext* context);
+
+		// Returns the number of readbacks that have been requested but whose callbacks haven't been called yet.
+		uint32 GetPendingCount() const { return m_scheduler.GetPendingCount(); }
+
+	private:
+		// Disable copy constructor.
+		CollisionDataReadback(const CollisionDataReadback&);
+		// Disable copy assignment.
+		CollisionDataReadback& operator=(const CollisionDataReadback&);
+
+		// A staging texture in the ring along with the readback that is using it.
+		struct Slot
+		{
+			// The staging texture. It is reused by later readbacks of textures with the same size and format.
+			Microsoft::WRL::ComPtr<ID3D11Texture2D>		m_stagingTexture;
+			// The desc of the staging texture.
+			D3D11_TEXTURE2D_DESC						m_desc;
+			// The callback of the pending readback.
+			Callback									m_callback;
+		};
+
+		// A readback whose data has been read back but whose callback hasn't been called yet.
+		struct CompletedReadback
+		{
+			// The pixel data in BGRA format.
+			std::unique_ptr<uint8>						m_data;
+			// The width of the texture in texels.
+			uint32										m_width;
+			// The height of the texture in texels.
+			uint32										m_height;
+			// The callback of the readback.
+			Callback									m_callback;
+		};
+
+		// Maps a slot without waiting and moves its data and callback into completed. Returns false if the GPU hasn't finished the copy yet. If the
+		// map fails for any other reason the slot's callback is dropped, error receives the HRESULT (unless it already holds an earlier one), and
+		// true is returned so that the slot is freed.
+		bool TryComplete(
+			_In_ ID3D11DeviceContext* context,
+			uint32 slot,
+			std::vector<CompletedReadback>& completed,
+			HRESULT& error
+			);
+
+		// Decides which slots are ready to be mapped.
+		ReadbackScheduler				m_scheduler;
+
+		// The ring of staging textures. The indices match the scheduler's slots.
+		std::vector<Slot>				m_slots;
+	};
+}
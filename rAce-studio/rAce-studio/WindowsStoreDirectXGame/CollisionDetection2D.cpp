@@ -1,5 +1,351 @@
 #include "pch.h"
 #include "CollisionDetection2D.h"
+#include "AlphaCollision.h"
+#include "BlockCompression.h"
+#include "MemoryMappedFile.h"
+
+#include <ppl.h>
+
+namespace
+{
+	// The number of block rows (each is 4 texel rows) of a block compressed texture that GetTexture2DCollisionDataNoRender decodes in each parallel
+	// task. Textures with no more block rows than this are decoded on the calling thread.
+	const uint32 BlockRowsPerDecodeTask = 16;
+
+	// Scans the world space rectangle [left, right) x [top, bottom) row by row, 64 texels at a time, and returns true if any texel in it is opaque
+	// or translucent in both masks. The rectangle must be inside of both masks.
+	// maskOne, maskTwo - The collision masks of the two sprites.
+	// oneX, oneY, twoX, twoY - The integer world space positions of the upper left corners of the two sprites.
+	bool IsMaskRowCollision(
+		_In_ const DX::CollisionMask& maskOne,
+		_In_ int oneX,
+		_In_ int oneY,
+		_In_ const DX::CollisionMask& maskTwo,
+		_In_ int twoX,
+		_In_ int twoY,
+		_In_ int left,
+		_In_ int top,
+		_In_ int right,
+		_In_ int bottom
+		)
+	{
+		for (int y = top; y < bottom; y++)
+		{
+			auto rowOne = static_cast<uint32_t>(y - oneY);
+			auto rowTwo = static_cast<uint32_t>(y - twoY);
+
+			// Test the row 64 texels at a time. GetRowBits lines the bits of both masks up so that bit 0 of each is the texel at x.
+			for (int x = left; x < right; x += 64)
+			{
+				auto count = right - x;
+				uint64_t bits = maskOne.GetRowBits(rowOne, static_cast<uint32_t>(x - oneX)) &
+					maskTwo.GetRowBits(rowTwo, static_cast<uint32_t>(x - twoX));
+
+				// Mask off anything past the right edge of the rectangle.
+				if (count < 64)
+				{
+					bits &= (1ULL << count) - 1ULL;
+				}
+
+				// Any bit that is still set is a texel that is opaque or translucent in both sprites.
+				if (bits != 0ULL)
+				{
+					return true;
+				}
+			}
+		}
+
+		return false;
+	}
+
+	// Hierarchical version of IsMaskRowCollision. The rectangle is first tested against the coarse levels of both masks: if either sprite has
+	// nothing opaque in it there can't be a collision, and if both sprites are completely opaque in it there must be one. Otherwise the rectangle
+	// is split in half along its longer side and each half is tested the same way until it is small enough that scanning the rows is cheaper.
+	// The parameters are the same as for IsMaskRowCollision.
+	bool IsMaskRegionCollision(
+		_In_ const DX::CollisionMask& maskOne,
+		_In_ int oneX,
+		_In_ int oneY,
+		_In_ const DX::CollisionMask& maskTwo,
+		_In_ int twoX,
+		_In_ int twoY,
+		_In_ int left,
+		_In_ int top,
+		_In_ int right,
+		_In_ int bottom
+		)
+	{
+		auto width = right - left;
+		auto height = bottom - top;
+		auto smallest = min(width, height);
+
+		// Blocks that are too big for the rectangle would make the coarse tests useless so just scan small or thin rectangles.
+		if (smallest < 8)
+		{
+			return IsMaskRowCollision(maskOne, oneX, oneY, maskTwo, twoX, twoY, left, top, right, bottom);
+		}
+
+		// Use the coarsest level whose blocks are no more than a quarter of the rectangle's smaller side.
+		uint32_t level = (smallest >= 32) ? 3 : ((smallest >= 16) ? 2 : 1);
+
+		if (!maskOne.MayContainOpaque(level, left - oneX, top - oneY, right - oneX, bottom - oneY) ||
+			!maskTwo.MayContainOpaque(level, left - twoX, top - twoY, right - twoX, bottom - twoY))
+		{
+			return false;
+		}
+
+		if (maskOne.IsAllOpaque(level, left - oneX, top - oneY, right - oneX, bottom - oneY) &&
+			maskTwo.IsAllOpaque(level, left - twoX, top - twoY, right - twoX, bottom - twoY))
+		{
+			return true;
+		}
+
+		// A 64x8 rectangle is only 8 word tests so there's no point in splitting any further.
+		if (width * height <= 512)
+		{
+			return IsMaskRowCollision(maskOne, oneX, oneY, maskTwo, twoX, twoY, left, top, right, bottom);
+		}
+
+		if (width >= height)
+		{
+			auto middle = left + (width / 2);
+			return IsMaskRegionCollision(maskOne, oneX, oneY, maskTwo, twoX, twoY, left, top, middle, bottom) ||
+				IsMaskRegionCollision(maskOne, oneX, oneY, maskTwo, twoX, twoY, middle, top, right, bottom);
+		}
+
+		auto middle = top + (height / 2);
+		return IsMaskRegionCollision(maskOne, oneX, oneY, maskTwo, twoX, twoY, left, top, right, middle) ||
+			IsMaskRegionCollision(maskOne, oneX, oneY, maskTwo, twoX, twoY, left, middle, right, bottom);
+	}
+
+	// Narrows the range of times [first, last] to the times at which start + ((end - start) * t) >= 0. If there are none then first ends up
+	// greater than last.
+	// start - The value at time 0.
+	// end - The value at time 1.
+	// first, last - The range of times to narrow.
+	inline void ClipTimeRange(
+		_In_ float start,
+		_In_ float end,
+		_Inout_ float& first,
+		_Inout_ float& last
+		)
+	{
+		auto slope = end - start;
+		if (slope == 0.0f)
+		{
+			if (start < 0.0f)
+			{
+				first = 1.0f;
+				last = 0.0f;
+			}
+		}
+		else if (slope > 0.0f)
+		{
+			first = max(first, -start / slope);
+		}
+		else
+		{
+			last = min(last, -start / slope);
+		}
+	}
+
+	// Finds the range of times, from 0 to 1, during which two rectangles that move (and change size) linearly from their start to their end
+	// rectangles overlap. Returns false if they never overlap. Touching edges count as overlapping, the same as Rect::IntersectsWith.
+	// spriteOneStart, spriteOneEnd - The first rectangle at time 0 and time 1.
+	// spriteTwoStart, spriteTwoEnd - The second rectangle at time 0 and time 1.
+	// first, last - Receive the first and last times at which the rectangles overlap.
+	bool GetSweptRectangleOverlap(
+		_In_ const Windows::Foundation::Rect& spriteOneStart,
+		_In_ const Windows::Foundation::Rect& spriteOneEnd,
+		_In_ const Windows::Foundation::Rect& spriteTwoStart,
+		_In_ const Windows::Foundation::Rect& spriteTwoEnd,
+		_Out_ float& first,
+		_Out_ float& last
+		)
+	{
+		first = 0.0f;
+		last = 1.0f;
+
+		if (spriteOneStart.IsEmpty || spriteOneEnd.IsEmpty || spriteTwoStart.IsEmpty || spriteTwoEnd.IsEmpty)
+		{
+			return false;
+		}
+
+		// Every edge moves linearly so each of the four conditions for overlapping is a linear function of time.
+		ClipTimeRange(spriteTwoStart.Right - spriteOneStart.Left, spriteTwoEnd.Right - spriteOneEnd.Left, first, last);
+		ClipTimeRange(spriteOneStart.Right - spriteTwoStart.Left, spriteOneEnd.Right - spriteTwoEnd.Left, first, last);
+		ClipTimeRange(spriteTwoStart.Bottom - spriteOneStart.Top, spriteTwoEnd.Bottom - spriteOneEnd.Top, first, last);
+		ClipTimeRange(spriteOneStart.Bottom - spriteTwoStart.Top, spriteOneEnd.Bottom - spriteTwoEnd.Top, first, last);
+
+		return first <= last;
+	}
+
+	// The parts of a sprite's world transform that IsSweptTransformedPixelPerfectCollision interpolates. Interpolating these rather than the
+	// matrices themselves keeps the in between transforms free of shearing and makes the sprite rotate about its center.
+	struct SweptPose
+	{
+		// The scale.
+		DirectX::XMVECTOR		m_scale;
+		// The rotation as a quaternion.
+		DirectX::XMVECTOR		m_rotation;
+		// The world space position of the center of the sprite.
+		DirectX::XMVECTOR		m_center;
+	};
+
+	// Breaks a sprite's world transform up into a SweptPose. Returns false if the matrix can't be decomposed (e.g. it has a zero scale).
+	// center - The center of the sprite in its local space, i.e. (width / 2, height / 2).
+	// worldTransform - The sprite's world transform.
+	// pose - Receives the pose.
+	bool GetSweptPose(
+		_In_ DirectX::FXMVECTOR center,
+		_In_ DirectX::CXMMATRIX worldTransform,
+		_Out_ SweptPose& pose
+		)
+	{
+		DirectX::XMVECTOR translation;
+		if (!DirectX::XMMatrixDecompose(&pose.m_scale, &pose.m_rotation, &translation, worldTransform))
+		{
+			return false;
+		}
+
+		pose.m_center = DirectX::XMVector3TransformCoord(center, worldTransform);
+		return true;
+	}
+
+	// Rebuilds a world transform from a pose that is part way between two poses.
+	// center - The center of the sprite in its local space.
+	// start, end - The poses at time 0 and time 1.
+	// t - The time.
+	DirectX::XMMATRIX GetSweptTransform(
+		_In_ DirectX::FXMVECTOR center,
+		_In_ const SweptPose& start,
+		_In_ const SweptPose& end,
+		_In_ float t
+		)
+	{
+		auto scale = DirectX::XMVectorLerp(start.m_scale, end.m_scale, t);
+		auto rotation = DirectX::XMQuaternionSlerp(start.m_rotation, end.m_rotation, t);
+		auto position = DirectX::XMVectorLerp(start.m_center, end.m_center, t);
+
+		// Move the center to the origin, scale and rotate about it, and then move it to its position.
+		return DirectX::XMMatrixTranslationFromVector(DirectX::XMVectorNegate(center)) *
+			DirectX::XMMatrixScalingFromVector(scale) *
+			DirectX::XMMatrixRotationQuaternion(rotation) *
+			DirectX::XMMatrixTranslationFromVector(position);
+	}
+
+	// Returns the largest distance that any corner of sprite one moves, measured in sprite two's texels, between two pairs of transforms.
+	// spriteOneWidth, spriteOneHeight - The size of sprite one in texels.
+	// oneToTwoStart, oneToTwoEnd - The transforms from sprite one's local space to sprite two's local space at time 0 and time 1.
+	float GetLargestCornerMovement(
+		_In_ float spriteOneWidth,
+		_In_ float spriteOneHeight,
+		_In_ DirectX::CXMMATRIX oneToTwoStart,
+		_In_ DirectX::CXMMATRIX oneToTwoEnd
+		)
+	{
+		const DirectX::XMVECTOR corners[4] =
+		{
+			DirectX::XMVectorSet(0.0f, 0.0f, 0.0f, 1.0f),
+			DirectX::XMVectorSet(spriteOneWidth, 0.0f, 0.0f, 1.0f),
+			DirectX::XMVectorSet(0.0f, spriteOneHeight, 0.0f, 1.0f),
+			DirectX::XMVectorSet(spriteOneWidth, spriteOneHeight, 0.0f, 1.0f)
+		};
+
+		float largest = 0.0f;
+		for (int i = 0; i < 4; i++)
+		{
+			auto movement = DirectX::XMVectorSubtract(DirectX::XMVector2Transform(corners[i], oneToTwoEnd), DirectX::XMVector2Transform(corners[i], oneToTwoStart));
+			largest = max(largest, DirectX::XMVectorGetX(DirectX::XMVector2Length(movement)));
+		}
+
+		return largest;
+	}
+
+	// Returns a lower bound on the distance, in sprite two's texels, between the opaque texels of sprite one and the opaque texels of sprite two,
+	// using only the coarse levels of the masks. Returns 0 if the coarse levels can't show a gap of at least a texel. Distances greater than
+	// maxGap are returned as maxGap.
+	// Sprite one is walked in 8x8 blocks like the mask version of IsTransformedPixelPerfectCollision. Each opaque block's footprint in sprite two
+	// (the same rounded out rectangle that that test uses) is grown by a candidate gap, which starts at the smallest gap found so far and is halved
+	// until sprite two's coarse levels say that the grown footprint is empty. Growing an axis aligned rectangle by g on every side covers every
+	// point within g of it, so the result is never more than the real distance.
+	// spriteOneMask, spriteTwoMask - The collision masks. Must not be empty.
+	// transformOneToTwo - Transforms sprite one's local space to sprite two's local space.
+	// maxGap - The largest gap to look for. Must be a power of two.
+	int GetCoarseMaskGap(
+		_In_ const DX::CollisionMask& spriteOneMask,
+		_In_ DirectX::CXMMATRIX transformOneToTwo,
+		_In_ const DX::CollisionMask& spriteTwoMask,
+		_In_ int maxGap
+		)
+	{
+		const DirectX::XMFLOAT2 fUnitX(1.0f, 0.0f);
+		const DirectX::XMFLOAT2 fUnitY(0.0f, 1.0f);
+		DirectX::XMFLOAT2 stepX;
+		DirectX::XMFLOAT2 stepY;
+		DirectX::XMFLOAT2 origin;
+		DirectX::XMStoreFloat2(&stepX, DirectX::XMVector2TransformNormal(DirectX::XMLoadFloat2(&fUnitX), transformOneToTwo));
+		DirectX::XMStoreFloat2(&stepY, DirectX::XMVector2TransformNormal(DirectX::XMLoadFloat2(&fUnitY), transformOneToTwo));
+		DirectX::XMStoreFloat2(&origin, DirectX::XMVector2Transform(DirectX::XMVectorZero(), transformOneToTwo));
+
+		const int blockSize = 1 << DX::CollisionMask::CoarseLevelCount;
+		auto spriteOneWidth = static_cast<int>(spriteOneMask.GetWidth());
+		auto spriteOneHeight = static_cast<int>(spriteOneMask.GetHeight());
+		int gap = maxGap;
+
+		for (int blockTop = 0; blockTop < spriteOneHeight; blockTop += blockSize)
+		{
+			auto blockBottom = min(blockTop + blockSize, spriteOneHeight);
+
+			for (int blockLeft = 0; blockLeft < spriteOneWidth; blockLeft += blockSize)
+			{
+				auto blockRight = min(blockLeft + blockSize, spriteOneWidth);
+				if (!spriteOneMask.MayContainOpaque(DX::CollisionMask::CoarseLevelCount, blockLeft, blockTop, blockRight, blockBottom))
+				{
+					continue;
+				}
+
+				auto lastX = static_cast<float>(blockRight - 1);
+				auto lastY = static_cast<float>(blockBottom - 1);
+				float cornersX[4] =
+				{
+					origin.x + (stepX.x * blockLeft) + (stepY.x * blockTop),
+					origin.x + (stepX.x * lastX) + (stepY.x * blockTop),
+					origin.x + (stepX.x * blockLeft) + (stepY.x * lastY),
+					origin.x + (stepX.x * lastX) + (stepY.x * lastY)
+				};
+				float cornersY[4] =
+				{
+					origin.y + (stepX.y * blockLeft) + (stepY.y * blockTop),
+					origin.y + (stepX.y * lastX) + (stepY.y * blockTop),
+					origin.y + (stepX.y * blockLeft) + (stepY.y * lastY),
+					origin.y + (stepX.y * lastX) + (stepY.y * lastY)
+				};
+				auto footprintLeft = static_cast<int>(floorf(min(min(cornersX[0], cornersX[1]), min(cornersX[2], cornersX[3])))) - 1;
+				auto footprintTop = static_cast<int>(floorf(min(min(cornersY[0], cornersY[1]), min(cornersY[2], cornersY[3])))) - 1;
+				auto footprintRight = static_cast<int>(ceilf(max(max(cornersX[0], cornersX[1]), max(cornersX[2], cornersX[3])))) + 2;
+				auto footprintBottom = static_cast<int>(ceilf(max(max(cornersY[0], cornersY[1]), max(cornersY[2], cornersY[3])))) + 2;
+
+				// Use blocks no bigger than the candidate gap so that the coarse test stays reasonably tight.
+				for (; gap > 0; gap /= 2)
+				{
+					uint32_t level = (gap >= 8) ? 3 : ((gap >= 4) ? 2 : 1);
+					if (!spriteTwoMask.MayContainOpaque(level, footprintLeft - gap, footprintTop - gap, footprintRight + gap, footprintBottom + gap))
+					{
+						break;
+					}
+				}
+
+				if (gap == 0)
+				{
+					return 0;
+				}
+			}
+		}
+
+		return gap;
+	}
+}
 
 std::unique_ptr<uint8> DX::GetTexture2DCollisionDataNoRender(
 	_In_ ID3D11Device* device,
@@ -32,6 +378,9 @@ std::unique_ptr<uint8> DX::GetTexture2DCollisionDataNoRender(
 		DX::ThrowIfFailed(E_NOTIMPL, filename, lineNumber);
 	}
 
+	// Make sure that we can convert the texture's format before doing any work.
+	DX::ValidateTexture2DCollisionDataFormat(desc, filename, lineNumber);
+
 	// Create a texture that matches the input texture's format but which is configured for CPU read access. This requires that
 	// the texture have a D3D11_USAGE_STAGING usage and the only thing you can do with staging usage textures is use them with
 	// ID3D11DeviceContext::CopyResource, CopySubresource, Map, and Unmap. Think of staging textures as being bridges between the 
@@ -53,67 +402,134 @@ std::unique_ptr<uint8> DX::GetTexture2DCollisionDataNoRender(
 	// Copy the render target's data to the staging texture.
 	context->CopyResource(stagingTexture.Get(), texture.Get());
 
-	// The number of bytes in a B8G8R8A8 pixel.
-	const uint32 bytesPerBGRAPixel = 4;
+	// Map the staging texture so that we can read out its data.
+	D3D11_MAPPED_SUBRESOURCE mappedResource;
+	DX::ThrowIfFailed(
+		context->Map(stagingTexture.Get(), 0, D3D11_MAP_READ, 0, &mappedResource), filename, lineNumber
+		);
 
-	// Process the data based on the format of the incoming texture.
+	// Convert the data to B8G8R8A8.
+	auto result = DX::GetTexture2DCollisionDataFromMappedData(desc, mappedResource);
+
+	// Unmap the staging texture now that we are done with it.
+	context->Unmap(stagingTexture.Get(), 0);
+
+	// Return the result.
+	return std::move(result);
+}
+
+void DX::ValidateTexture2DCollisionDataFormat(
+	_In_ const D3D11_TEXTURE2D_DESC& desc,
+	_In_opt_z_ const wchar_t* filename,
+	_In_ unsigned long lineNumber
+	)
+{
+	// If null filename was passed in, use an empty string.
+	if (filename == nullptr)
+	{
+		filename = L"";
+	}
+
+	const wchar_t* formatName;
 	switch (desc.Format)
 	{
 	case DXGI_FORMAT_B8G8R8A8_UNORM:
-		{
-			// Calculate the byte size of the data once and reuse the value. Since the texture is B8G8R8A8 (a 32-bit format) we must multiply
-			// by 4 to account for the memory size of each pixel.
-			auto resultSizeInBytes = desc.Width * desc.Height * bytesPerBGRAPixel;
-			auto rowSizeInBytes = desc.Width * bytesPerBGRAPixel;
+	case DXGI_FORMAT_R8G8B8A8_UNORM:
+	case DXGI_FORMAT_R32G32B32A32_FLOAT:
+		return;
 
-			// Create and zero out the result smart pointer byte array.
-			std::unique_ptr<uint8> result(new uint8[resultSizeInBytes]);
-			//ZeroMemory(result.get(), resultSizeInBytes);
+	case DXGI_FORMAT_BC1_UNORM:
+		formatName = L"BC1";
+		break;
+	case DXGI_FORMAT_BC3_UNORM:
+		formatName = L"BC3";
+		break;
+	case DXGI_FORMAT_BC4_UNORM:
+		formatName = L"BC4";
+		break;
+	case DXGI_FORMAT_BC5_UNORM:
+		formatName = L"BC5";
+		break;
+	case DXGI_FORMAT_BC4_SNORM:
+		formatName = L"BC4_SNORM";
+		break;
+	case DXGI_FORMAT_BC5_SNORM:
+		formatName = L"BC5_SNORM";
+		break;
+	case DXGI_FORMAT_BC7_UNORM:
+		formatName = L"BC7";
+		break;
 
-			// Map the staging texture so that we can read out its data.
-			D3D11_MAPPED_SUBRESOURCE mappedResource;
-			DX::ThrowIfFailed(
-				context->Map(stagingTexture.Get(), 0, D3D11_MAP_READ, 0, &mappedResource), filename, lineNumber
-				);
+	default:
+#if defined(_DEBUG)
+		assert("ValidateTexture2DCollisionDataFormat called with an unhandled DXGI_FORMAT.");
+#endif
+		// Use the COM HRESULT error ERROR_GRAPHICS_INVALID_PIXELFORMAT as it's the closest HRESULT to our problem.
+		DX::ThrowIfFailed(ERROR_GRAPHICS_INVALID_PIXELFORMAT, filename, lineNumber);
+		return;
+	}
 
-			auto resultPtr = result.get();
+	// Validate that the block compressed texture's width and height are multiples of 4. Add in a check for a zero width/height as well even though that shouldn't ever happen.
+	if ((desc.Width % 4) != 0 || (desc.Height % 4) != 0 || desc.Width == 0 || desc.Height == 0)
+	{
+#if defined(_DEBUG)
+		OutputDebugStringW(
+			std::wstring(L"The dimensions of a ").append(
+			formatName).append(
+			L" texture must be greater than zero and multiples of 4. The texture data passed has the following dimensions: ").append(
+			std::to_wstring(desc.Width)).append(
+			L"x").append(
+			std::to_wstring(desc.Height)).append(
+			L".").append(
+			(desc.Width % 4 != 0) ? L" The width is not divisible by 4." : L"").append(
+			(desc.Height % 4 != 0) ? L" The height is not divisible by 4." : L"").append(L"\n").c_str()
+			);
+#else
+		UNREFERENCED_PARAMETER(formatName);
+#endif
+		DX::ThrowIfFailed(E_INVALIDARG, filename, lineNumber);
+	}
+}
 
+std::unique_ptr<uint8> DX::GetTexture2DCollisionDataFromMappedData(
+	_In_ const D3D11_TEXTURE2D_DESC& desc,
+	_In_ const D3D11_MAPPED_SUBRESOURCE& mappedResource
+	)
+{
+	// The number of bytes in a B8G8R8A8 pixel.
+	const uint32 bytesPerBGRAPixel = 4;
+
+	// Calculate the byte size of the data once and reuse the value. Since the result is B8G8R8A8 (a 32-bit format) we must multiply
+	// by 4 to account for the memory size of each pixel.
+	auto resultSizeInBytes = desc.Width * desc.Height * bytesPerBGRAPixel;
+	auto rowSizeInBytes = desc.Width * bytesPerBGRAPixel;
+
+	// Create the result smart pointer byte array. Every byte is written below so there is no need to zero it out.
+	std::unique_ptr<uint8> result(new uint8[resultSizeInBytes]);
+	auto resultPtr = result.get();
+
+	// Process the data based on the format of the incoming texture.
+	switch (desc.Format)
+	{
+	case DXGI_FORMAT_B8G8R8A8_UNORM:
+		{
 			// We have to copy row by row since the RowPitch could be greater than desc.Width * 4 (e.g. if the runtime needed to place padding in between rows for some reason).
 			for (unsigned int i = 0; i < desc.Height; ++i)
 			{
 				// We know that the mapped data can be viewed as byte data so we can use reinterpret_cast to cast it to byte data such that we can offset correctly.
-				memcpy_s(resultPtr + (i * rowSizeInBytes), resultSizeInBytes - (i * rowSizeInBytes), reinterpret_cast<uint8 *>(mappedResource.pData) + (i * mappedResource.RowPitch), desc.Width * 4); 
+				memcpy_s(resultPtr + (i * rowSizeInBytes), resultSizeInBytes - (i * rowSizeInBytes), reinterpret_cast<uint8 *>(mappedResource.pData) + (i * mappedResource.RowPitch), rowSizeInBytes); 
 			}
-
-			// Unmap the staging texture now that we are done with it.
-			context->Unmap(stagingTexture.Get(), 0);
-
-			// Return the result.
-			return std::move(result);
 		}
+		break;
 
 	case DXGI_FORMAT_R8G8B8A8_UNORM:
 		{
-			// Calculate the byte size of the data once and reuse the value. Since the texture is B8G8R8A8 (a 32-bit format) we must multiply
-			// by 4 to account for the memory size of each pixel.
-			auto resultSizeInBytes = desc.Width * desc.Height * bytesPerBGRAPixel;
-			auto rowSizeInBytes = desc.Width * bytesPerBGRAPixel;
-
-			// Create and zero out the result smart pointer byte array.
-			std::unique_ptr<uint8> result(new uint8[resultSizeInBytes]);
-
-			// Map the staging texture so that we can read out its data.
-			D3D11_MAPPED_SUBRESOURCE mappedResource;
-			DX::ThrowIfFailed(
-				context->Map(stagingTexture.Get(), 0, D3D11_MAP_READ, 0, &mappedResource), filename, lineNumber
-				);
-			auto resultPtr = result.get();
 			// We have to copy row by row since the RowPitch could be greater than desc.Width * 4 (e.g. if the runtime needed to place padding in between rows for some reason).
 			for (unsigned int i = 0; i < desc.Height; ++i)
 			{
 				auto indexOffset = i * rowSizeInBytes;
 				// We know that the mapped data can be viewed as byte data so we can use reinterpret_cast to cast it to byte data such that we can offset correctly.
-				memcpy_s(resultPtr + indexOffset, resultSizeInBytes - (i * rowSizeInBytes), reinterpret_cast<uint8 *>(mappedResource.pData) + (i * mappedResource.RowPitch), desc.Width * 4); 
+				memcpy_s(resultPtr + indexOffset, resultSizeInBytes - indexOffset, reinterpret_cast<uint8 *>(mappedResource.pData) + (i * mappedResource.RowPitch), rowSizeInBytes); 
 				// Swizzle r and b.
 				for (unsigned int j = 0; j < desc.Width; ++j)
 				{
@@ -123,362 +539,109 @@ std::unique_ptr<uint8> DX::GetTexture2DCollisionDataNoRender(
 					*(resultPtr + widthOffset + 2) = r;
 				}
 			}
-			// Unmap the staging texture now that we are done with it.
-			context->Unmap(stagingTexture.Get(), 0);
-
-			// Return the result.
-			return std::move(result);
 		}
-
+		break;
 
 	case DXGI_FORMAT_R32G32B32A32_FLOAT:
 		{
-			// There are four channels in an R32B32G32A32 texture.
+			// There are four channels in an R32B32G32A32 texture. Convert each row straight out of the mapped data (the RowPitch could be greater
+			// than the row size for the same reason as above).
 			const uint32 componentsPerUnit = 4;
-			auto resourceDataSizeInUnitsPerPixel = desc.Width * desc.Height * componentsPerUnit;
-			auto unitSizeInBytes = sizeof(float);
-			auto resourceDataSizeInBytes = resourceDataSizeInUnitsPerPixel * unitSizeInBytes;
-			auto rowSizeInBytes = desc.Width * componentsPerUnit * unitSizeInBytes;
-
-			// Allocate the float array for the extracted data.
-			std::unique_ptr<float> resourceData(new float[resourceDataSizeInUnitsPerPixel]);
-
-			// Map the staging texture so that we can read out its data.
-			D3D11_MAPPED_SUBRESOURCE mappedResource;
-			DX::ThrowIfFailed(
-				context->Map(stagingTexture.Get(), 0, D3D11_MAP_READ, 0, &mappedResource), filename, lineNumber
-				);
-
-			// We have to copy row by row since the RowPitch could be greater than desc.Width * 4 (e.g. if the runtime needed to place padding in between rows for some reason).
 			for (unsigned int i = 0; i < desc.Height; i++)
 			{
-				// We know that the mapped data can be viewed as byte data so we can use reinterpret_cast to cast it to byte data such that we can offset correctly.
-				// Because the destination is not a byte (uint8), we need to cast it to uint8 to get proper pointer offsets in order to ensure that all data is written to its correct memory location.
-				memcpy_s(reinterpret_cast<uint8 *>(resourceData.get()) + (i * rowSizeInBytes), resourceDataSizeInBytes - (i * rowSizeInBytes), (reinterpret_cast<uint8 *>(mappedResource.pData) + (i * mappedResource.RowPitch)), rowSizeInBytes); 
-			}
-
-			// Unmap the staging texture now that we are done with it.
-			context->Unmap(stagingTexture.Get(), 0);
-
-			// Calculate the byte size of the data once and reuse the value. Since the texture is B8G8R8A8 (a 32-bit format) we must multiply
-			// by 4 to account for the memory size of each pixel.
-			auto resultSizeInBytes = desc.Width * desc.Height * 4;
-
-			// Create and zero out the result smart pointer byte array.
-			std::unique_ptr<uint8> result(new uint8[resultSizeInBytes]);
-			ZeroMemory(result.get(), resultSizeInBytes);
-
-			auto resultDataPtr = result.get();
-			auto resourceDataPtr = resourceData.get();
-			for (unsigned int i = 0; i < desc.Width * desc.Height; i += bytesPerBGRAPixel)
-			{
-				DirectX::XMFLOAT4 value(resourceDataPtr[i + 2], resourceDataPtr[i + 1], resourceDataPtr[i + 0], resourceDataPtr[i + 3]);
-				DirectX::PackedVector::XMUBYTEN4 byteData;
-				DirectX::PackedVector::XMStoreUByteN4(&byteData, DirectX::XMLoadFloat4(&value));
-				resultDataPtr[i + 0] = byteData.x;
-				resultDataPtr[i + 1] = byteData.y;
-				resultDataPtr[i + 2] = byteData.z;
-				resultDataPtr[i + 3] = byteData.w;
+				auto sourceRow = reinterpret_cast<const float *>(reinterpret_cast<uint8 *>(mappedResource.pData) + (i * mappedResource.RowPitch));
+				auto resultRow = resultPtr + (i * rowSizeInBytes);
+				for (unsigned int j = 0; j < desc.Width; j++)
+				{
+					auto source = sourceRow + (j * componentsPerUnit);
+					DirectX::XMFLOAT4 value(source[2], source[1], source[0], source[3]);
+					DirectX::PackedVector::XMUBYTEN4 byteData;
+					DirectX::PackedVector::XMStoreUByteN4(&byteData, DirectX::XMLoadFloat4(&value));
+					resultRow[(j * bytesPerBGRAPixel) + 0] = byteData.x;
+					resultRow[(j * bytesPerBGRAPixel) + 1] = byteData.y;
+					resultRow[(j * bytesPerBGRAPixel) + 2] = byteData.z;
+					resultRow[(j * bytesPerBGRAPixel) + 3] = byteData.w;
+				}
 			}
-
-			// Return the result.
-			return std::move(result);
 		}
+		break;
 
 	case DXGI_FORMAT_BC1_UNORM:
-		// Intentional fall-through. BC1 and BC3 are the same in most of their color compression (BC1 alpha introduces a slight BC1-specific variant) so we avoid code duplication this way.
+		// Intentional fall-through. Every block compressed format is decoded the same way (only the decoder for each 4x4 block differs) so we avoid code duplication this way.
 	case DXGI_FORMAT_BC3_UNORM:
+		// Intentional fall-through.
+	case DXGI_FORMAT_BC4_UNORM:
+		// Intentional fall-through.
+	case DXGI_FORMAT_BC5_UNORM:
+		// Intentional fall-through.
+	case DXGI_FORMAT_BC4_SNORM:
+		// Intentional fall-through.
+	case DXGI_FORMAT_BC5_SNORM:
+		// Intentional fall-through.
+	case DXGI_FORMAT_BC7_UNORM:
 		{
-			// Since we're processing either BC1 or BC3 data we need to know which we're working with.
-			const bool isBC3 = desc.Format == DXGI_FORMAT_BC3_UNORM;
-
-			// BC1 and BC3 both operate by compressing and decompressing pixel data in 4x4 blocks. This serves as our recognition of that.
-			const uint32 pixelsPerBlockDimension = 4;
-			// BC1 has 8 bytes of data per 4x4 block; BC3 has 16 bytes per 4x4 block (the extra 8 are for its alpha encoding).
-			uint32 bytesPerBlock = isBC3 ? 16 : 8;
-
-			// Validate that the BC1/3 texture's width and height are multiples of 4. Add in a check for a zero width/height as well even though that shouldn't ever happen.
-			if ((desc.Width % 4) != 0 || (desc.Height % 4) != 0 || desc.Width == 0 || desc.Height == 0)
+			// Work out which block compressed format we're working with.
+			DX::BlockFormat format;
+			switch (desc.Format)
 			{
-#if defined(_DEBUG)
-				OutputDebugStringW(
-					std::wstring(L"The dimensions of a ").append(
-					isBC3 ? L"BC3" : L"BC1").append(
-					L" texture must be greater than zero and multiples of 4. The texture data passed has the following dimensions: ").append(
-					std::to_wstring(desc.Width)).append(
-					L"x").append(
-					std::to_wstring(desc.Height)).append(
-					L".").append(
-					(desc.Width % 4 != 0) ? L" The width is not divisible by 4." : L"").append(
-					(desc.Height % 4 != 0) ? L" The height is not divisible by 4." : L"").append(L"\n").c_str()
-					);
-#endif
-				DX::ThrowIfFailed(E_INVALIDARG, filename, lineNumber);
+			case DXGI_FORMAT_BC1_UNORM:
+				format = DX::BlockFormat::BC1;
+				break;
+			case DXGI_FORMAT_BC3_UNORM:
+				format = DX::BlockFormat::BC3;
+				break;
+			case DXGI_FORMAT_BC4_UNORM:
+				format = DX::BlockFormat::BC4;
+				break;
+			case DXGI_FORMAT_BC5_UNORM:
+				format = DX::BlockFormat::BC5;
+				break;
+			case DXGI_FORMAT_BC4_SNORM:
+				format = DX::BlockFormat::BC4Snorm;
+				break;
+			case DXGI_FORMAT_BC5_SNORM:
+				format = DX::BlockFormat::BC5Snorm;
+				break;
+			default:
+				format = DX::BlockFormat::BC7;
+				break;
 			}
 
-			// Figure out how many bytes we need for the BC1/BC3 compressed pixel data by calculating the number of blocks and multiplying it by the bytes per block.
-			auto resourceDataSizeInBytes = ((desc.Width / pixelsPerBlockDimension) * (desc.Height / pixelsPerBlockDimension)) * bytesPerBlock;				
-			// Calculate how many bytes there are in a row. For our purposes here, a row is presumed to have a 4 pixel height such that this is a row of blocks, not of pixels.
-			auto rowSizeInBytes = (desc.Width / pixelsPerBlockDimension) * bytesPerBlock;
-
-			// Allocate the byte array for the extracted data.
-			std::unique_ptr<uint8> resourceData(new uint8[resourceDataSizeInBytes]);
+			// Block compressed formats all operate by compressing and decompressing pixel data in 4x4 blocks. This serves as our recognition of that.
+			const uint32 pixelsPerBlockDimension = 4;
 
-			// Map the staging texture so that we can read out its data.
-			D3D11_MAPPED_SUBRESOURCE mappedResource;
-			DX::ThrowIfFailed(
-				context->Map(stagingTexture.Get(), 0, D3D11_MAP_READ, 0, &mappedResource), filename, lineNumber
-				);
+			// The blocks are decoded straight out of the mapped data (the decoder steps through it using the RowPitch) so there is no intermediate copy.
+			auto source = reinterpret_cast<const uint8 *>(mappedResource.pData);
+			auto sourceRowPitch = static_cast<size_t>(mappedResource.RowPitch);
+			auto blockRowCount = desc.Height / pixelsPerBlockDimension;
 
-			// We have to copy row by row since the RowPitch could be greater than the row size in bytes (e.g. if the runtime needed to place padding in between rows for some reason).
-			// Remember that we are operating on rows of blocks here, not rows of pixels.
-			for (unsigned int i = 0; i < (desc.Height / pixelsPerBlockDimension); i++)
+			if (blockRowCount <= BlockRowsPerDecodeTask)
 			{
-				// We know that the mapped data can be viewed as byte data so we can use reinterpret_cast to cast it to byte data such that we can offset correctly.
-				memcpy_s(resourceData.get() + (i * rowSizeInBytes), resourceDataSizeInBytes - (i * rowSizeInBytes), reinterpret_cast<uint8 *>(mappedResource.pData) + (i * mappedResource.RowPitch), rowSizeInBytes);
+				DX::DecodeBlockRowsBGRA(format, source, sourceRowPitch, desc.Width, desc.Height, 0, blockRowCount, resultPtr);
 			}
-
-			// Unmap the staging texture now that we are done with it.
-			context->Unmap(stagingTexture.Get(), 0);
-
-			// Calculate the byte size of the data once and reuse the value. Since the texture is B8G8R8A8 (a 32-bit format) we must multiply
-			// by 4 to account for the memory size of each pixel.
-			auto resultSizeInBytes = desc.Width * desc.Height * bytesPerBGRAPixel;
-
-			// Create and zero out the result smart pointer byte array.
-			std::unique_ptr<uint8> result(new uint8[resultSizeInBytes]);
-			ZeroMemory(result.get(), resultSizeInBytes);
-
-			auto resultDataPtr = result.get();
-			auto resourceDataPtr = resourceData.get();
-
-			// Loop through the data block by block.
-			for (unsigned int i = 0; i < (desc.Width / pixelsPerBlockDimension) * (desc.Height / pixelsPerBlockDimension) * bytesPerBlock; i += bytesPerBlock)
+			else
 			{
-				// This stores the appropriate alpha value for the pixel.
-				uint8 alphaValue;
-
-				// BC3 alpha values.
-				uint8 alpha0 = 0;
-				uint8 alpha1 = 0;
-				uint8 alpha2 = 0;
-				uint8 alpha3 = 0;
-				uint8 alpha4 = 0;
-				uint8 alpha5 = 0;
-				uint8 alpha6 = 0;
-				uint8 alpha7 = 0;
-
-				// Two bytes of the 8 bytes of alpha data are for alpha0 and alpha1. The remaining 6 bytes operate as a 3bpp map to tell us which alpha value to use for each pixel in the block.
-				uint64 alphamap = 0ULL;
-
-				if (isBC3)
-				{
-					// BC3 uses two stored alpha values and either 6 interpolated values or 4 interpolated values (with the remaining two being completely transparent and completely opaque).
-					// We initialize these to remove warnings about using possibly uninitialized values since the compiler's analyzer doesn't pick up that these values are all definitely
-					// initialized in an "if (isBC3) { ... }" block and are only used in an "if (isBC3) { ... }" block.
-					
-					// Extract the two stored alpha values.
-					alpha0 = resourceDataPtr[i + 0];
-					alpha1 = resourceDataPtr[i + 1];
-
-					// Alpha interpolation depends on whether or not the first bytes is larger than the second.
-					if (alpha0 > alpha1)
-					{
-						// If the first is larger than the second then all remaining values are interpolated.
-						alpha2 = static_cast<uint8>((6 * alpha0 + 1 * alpha1 + 3) / 7);
-						alpha3 = static_cast<uint8>((5 * alpha0 + 2 * alpha1 + 3) / 7);
-						alpha4 = static_cast<uint8>((4 * alpha0 + 3 * alpha1 + 3) / 7);
-						alpha5 = static_cast<uint8>((3 * alpha0 + 4 * alpha1 + 3) / 7);
-						alpha6 = static_cast<uint8>((2 * alpha0 + 5 * alpha1 + 3) / 7);
-						alpha7 = static_cast<uint8>((1 * alpha0 + 6 * alpha1 + 3) / 7);
-					}
-					else
-					{
-						// Otherwise only four are interpolates with the last two being fully transparent and opaque, respectively.
-						alpha2 = static_cast<uint8>((4 * alpha0 + 1 * alpha1 + 2) / 5);
-						alpha3 = static_cast<uint8>((3 * alpha0 + 2 * alpha1 + 2) / 5);
-						alpha4 = static_cast<uint8>((2 * alpha0 + 3 * alpha1 + 2) / 5);
-						alpha5 = static_cast<uint8>((1 * alpha0 + 4 * alpha1 + 2) / 5);
-						alpha6 = 0;
-						alpha7 = 255;
-					}
-
-					// Make the remaining six bytes into a uint64 (unsigned long long) so we can use bit shifting to extract values.
-					alphamap =
-						static_cast<uint64>(MAKELONG(MAKEWORD(resourceDataPtr[i + 2], resourceDataPtr[i + 3]), MAKEWORD(resourceDataPtr[i + 4], resourceDataPtr[i + 5]))) |
-						(static_cast<uint64>(MAKELONG(MAKEWORD(resourceDataPtr[i + 6], resourceDataPtr[i + 7]), MAKEWORD(0, 0))) << 32);
-				}
-
-				// For BC3 we extract the color data starting at byte 8 (the first 8 bytes are for alpha). For BC1 we extract it starting at byte 0 (alpha is opaque or completely transparent).
-				uint32 bcTypeOffset = isBC3 ? 8 : 0;
-
-				// The first two colors are stored as B5G6R5 UINT data, allowing them to be packed into 2 bytes each (4 bytes total).
-				auto color0 = MAKEWORD(resourceDataPtr[i + bcTypeOffset + 0], resourceDataPtr[i + bcTypeOffset + 1]);
-				auto color1 = MAKEWORD(resourceDataPtr[i + bcTypeOffset + 2], resourceDataPtr[i + bcTypeOffset + 3]);
-
-				// The remaining 4 bytes are a 2bpp map that tells us which one of the four colors to use for each of the 16 pixels in the block.
-				auto colormap = MAKELONG(
-					MAKEWORD(resourceDataPtr[i + bcTypeOffset + 4], resourceDataPtr[i + bcTypeOffset + 5]),
-					MAKEWORD(resourceDataPtr[i + bcTypeOffset + 6], resourceDataPtr[i + bcTypeOffset + 7])
-					);
-
-				// Put the color into an XMU565 so we can load it as a vector and convert it to B8G8R8 UNORM data.
-				DirectX::PackedVector::XMU565 pack565Color0(color0);
-				DirectX::PackedVector::XMU565 pack565Color1(color1);
-
-				// To convert to B8G8R8X8 UNORM from B5G6R5 UINT, we load a color as an XMVECTOR then divide it by (31, 63, 31) (the max values of a 5 bit number, 6 bit number,
-				// and 5 bit number, respectively).
-				DirectX::XMVECTOR vecColor0 = DirectX::XMVectorDivide(DirectX::PackedVector::XMLoadU565(&pack565Color0), DirectX::XMVectorSet(31.0f, 63.0f, 31.0f, 1.0f));
-				DirectX::XMVECTOR vecColor1 = DirectX::XMVectorDivide(DirectX::PackedVector::XMLoadU565(&pack565Color1), DirectX::XMVectorSet(31.0f, 63.0f, 31.0f, 1.0f));
-
-				// Used to store the B8G8R8X8 UNORM color data.
-				DirectX::PackedVector::XMUBYTEN4 c0;
-				DirectX::PackedVector::XMUBYTEN4 c1;
-				DirectX::PackedVector::XMUBYTEN4 c2;
-				DirectX::PackedVector::XMUBYTEN4 c3;
-
-				// The first two color are always the stored colors.
-				DirectX::PackedVector::XMStoreUByteN4(&c0, vecColor0);
-				DirectX::PackedVector::XMStoreUByteN4(&c1, vecColor1);
-
-				if (isBC3 || (color0 > color1))
-				{
-					// If we're working with BC3 or if the uint16 value of color0 is greater than color 1, the remaining two colors are interpolated from the stored colors.
-					// Color 2 is 1/3 of the way between colors 0 and 1.
-					DirectX::PackedVector::XMStoreUByteN4(&c2, DirectX::XMVectorLerp(vecColor0, vecColor1, 1.0f / 3.0f));
-					// Color 3 is 2/3 of the way between colors 0 and 1.
-					DirectX::PackedVector::XMStoreUByteN4(&c3, DirectX::XMVectorLerp(vecColor0, vecColor1, 2.0f / 3.0f));
-				}
-				else
-				{
-					// If we're working with BC1 and the uint16 value of color 0 is less than or equal to color 1, then there is at least one transparent pixel in the block
-					// such that only one color is interpolated and the other is (transparent black.
-					// Color 2 is 1/2 of the way between colors 0 and 1.
-					DirectX::PackedVector::XMStoreUByteN4(&c2, DirectX::XMVectorLerp(vecColor0, vecColor1, 0.5f));
-					// Color 3 is transparent black. 
-					c3 = DirectX::PackedVector::XMUBYTEN4(0U);
-				}
-
-				// Precalculate the current row (in pixel rows) so we can properly offset into our result array.
-				int currentRow = (i / ((desc.Width / pixelsPerBlockDimension))) / bytesPerBlock * pixelsPerBlockDimension;
-				// Precalculate the current column offset (in pixels) so we can properly offset into our result array.
-				int currentColumnOffset = (i % ((desc.Width / pixelsPerBlockDimension) * bytesPerBlock)) / bytesPerBlock * pixelsPerBlockDimension;
-
-				// Loop through the current block's 4x4 grid of pixels.
-				for (int y = 0; y < pixelsPerBlockDimension; y++)
+				// Each block row only writes to its own four rows of the result, so large textures (e.g. sprite atlases) are split into groups of block
+				// rows that are decoded in parallel. parallel_for doesn't return until every group is done so the data stays mapped until then.
+				auto taskCount = (blockRowCount + BlockRowsPerDecodeTask - 1) / BlockRowsPerDecodeTask;
+				auto width = desc.Width;
+				auto height = desc.Height;
+				concurrency::parallel_for(0U, taskCount, [=](uint32 task)
 				{
-					for (int x = 0; x < pixelsPerBlockDimension; x++)
-					{
-						// For BC3, which alpha to use for each pixel is stored in a bitmap, with 3 bits for each pixel. For
-						// more info, see: http://msdn.microsoft.com/en-us/library/windows/desktop/bb206238(v=vs.85).aspx .
-						if (isBC3)
-						{
-							switch (alphamap & 7) // 7 in binary is 111
-							{
-							case 0:
-								alphaValue = alpha0;
-								break;
-							case 1:
-								alphaValue = alpha1;
-								break;
-							case 2:
-								alphaValue = alpha2;
-								break;
-							case 3:
-								alphaValue = alpha3;
-								break;
-							case 4:
-								alphaValue = alpha4;
-								break;
-							case 5:
-								alphaValue = alpha5;
-								break;
-							case 6:
-								alphaValue = alpha6;
-								break;
-							case 7:
-								alphaValue = alpha7;
-								break;
-							default:
-								throw Platform::Exception::CreateException(E_UNEXPECTED);
-							}
-						}
-						else
-						{
-							// For BC1, a pixel is either opaque or transparent. For the first 3 pixel colors, it's always opaque. For the
-							// fourth color it's opaque if the uint16 value of color0 is greater than color 1, otherwise it's transparent. For
-							// more info, see: http://msdn.microsoft.com/en-us/library/windows/desktop/bb147243(v=vs.85).aspx .
-							switch (colormap & 3) // 3 in binary is 11
-							{
-							case 0:
-								// Intentional fall-through.
-							case 1:
-								// Intentional fall-through.
-							case 2:
-								alphaValue = 0xFF;
-								break;
-							case 3:
-								alphaValue = (color0 > color1) ? 0xFF : 0x0;
-								break;
-							default:
-								throw Platform::Exception::CreateException(E_UNEXPECTED);
-							}
-						}
-
-						// Calculate the result array index offset (in bytes) for the current pixel so that we write the data to the proper place.
-						int index = ((currentRow * desc.Width * bytesPerBGRAPixel) + (y * desc.Width * bytesPerBGRAPixel)) + (currentColumnOffset * bytesPerBGRAPixel) + (x * bytesPerBGRAPixel);
-
-						// For BC1 and BC3, which color to use for each pixel is stored in a bitmap, with 2 bits for each pixel. For more
-						// info, see: http://msdn.microsoft.com/en-us/library/bb694531(v=vs.85).aspx .
-						switch (colormap & 3)
-						{
-						case 0:
-							resultDataPtr[index + 0] = c0.x;
-							resultDataPtr[index + 1] = c0.y;
-							resultDataPtr[index + 2] = c0.z;
-							resultDataPtr[index + 3] = alphaValue;
-							break;
-						case 1:
-							resultDataPtr[index + 0] = c1.x;
-							resultDataPtr[index + 1] = c1.y;
-							resultDataPtr[index + 2] = c1.z;
-							resultDataPtr[index + 3] = alphaValue;
-							break;
-						case 2:
-							resultDataPtr[index + 0] = c2.x;
-							resultDataPtr[index + 1] = c2.y;
-							resultDataPtr[index + 2] = c2.z;
-							resultDataPtr[index + 3] = alphaValue;
-							break;
-						case 3:
-							resultDataPtr[index + 0] = c3.x;
-							resultDataPtr[index + 1] = c3.y;
-							resultDataPtr[index + 2] = c3.z;
-							resultDataPtr[index + 3] = alphaValue;
-							break;
-						default:
-							throw Platform::Exception::CreateException(E_UNEXPECTED);
-						}
-						// Shift the color bitmap two bits to the right so we're ready for the next pixel.
-						colormap >>= 2;
-						// Shift the alpha bitmap three bits to the right so we're ready for the next pixel.
-						alphamap >>= 3;
-					}
-				}
+					auto firstBlockRow = task * BlockRowsPerDecodeTask;
+					DX::DecodeBlockRowsBGRA(format, source, sourceRowPitch, width, height, firstBlockRow, min(BlockRowsPerDecodeTask, blockRowCount - firstBlockRow), resultPtr);
+				});
 			}
-
-			// Return the result.
-			return std::move(result);
 		}
+		break;
 
 	default:
-#if defined(_DEBUG)
-		assert("GetTexture2DCollisionDataNoRender called with an unhandled DXGI_FORMAT.");
-#endif
-		// Use the COM HRESULT error ERROR_GRAPHICS_INVALID_PIXELFORMAT as it's the closest HRESULT to our problem.
-		DX::ThrowIfFailed(ERROR_GRAPHICS_INVALID_PIXELFORMAT, filename, lineNumber);
+		// ValidateTexture2DCollisionDataFormat rejects every other format.
 		return nullptr;
 	}
+
+	// Return the result.
+	return std::move(result);
 }
 
 std::unique_ptr<uint8> DX::GetTexture2DCollisionData(
@@ -601,6 +764,20 @@ std::unique_ptr<uint8> DX::GetTexture2DCollisionData(
 	return std::move(result);
 }
 
+void DX::LoadCollisionMask(
+	_In_z_ const wchar_t* filename,
+	_Out_ CollisionMask& mask
+	)
+{
+	MemoryMappedFile file;
+	file.Open(filename);
+
+	if (!mask.LoadFromMemory(file.GetData(), file.GetSize()))
+	{
+		throw Platform::Exception::CreateException(HRESULT_FROM_WIN32(ERROR_INVALID_DATA));
+	}
+}
+
 bool DX::IsPixelPerfectCollision(
 	_In_ const std::unique_ptr<uint8>& spriteOneTextureData,
 	_In_ Windows::Foundation::Rect& spriteOnePosition,
@@ -629,26 +806,28 @@ bool DX::IsPixelPerfectCollision(
 		auto spriteTwoY = static_cast<int>(spriteTwoPosition.Y);
 		auto spriteTwoWidth = static_cast<int>(spriteTwoPosition.Width);
 
-		// Check every point within the intersection bounds.
+		// Each row of the intersection is a contiguous run of texels in both sprites so we can test a whole row at a time.
+		auto pixelCount = right - left;
+		if (pixelCount <= 0)
+		{
+			return false;
+		}
+
+		// Check every row within the intersection bounds.
 		for (int y = top; y < bottom; y++)
 		{
-			for (int x = left; x < right; x++)
-			{
-				// Calculate the ((y * width) + x) value to get the pixel position then multiply by 4 because each pixel is four bytes then
-				// add 3 to get the alpha value for the pixel. (Note: BGRA ordering means B = + 0, G = + 1, R = + 2, A = + 3).
-				auto alphaOne = spriteOneData[(((x - spriteOneX) +
-					((y - spriteOneY) * spriteOneWidth)) * 4) + 3];
+			// Calculate the ((y * width) + x) value to get the position of the first pixel in the row then multiply by 4 because each
+			// pixel is four bytes.
+			auto rowOne = spriteOneData + (((left - spriteOneX) + ((y - spriteOneY) * spriteOneWidth)) * 4);
 
-				// Same formula as alphaOne just with sprite two.
-				auto alphaTwo = spriteTwoData[(((x - spriteTwoX) +
-					((y - spriteTwoY) * spriteTwoWidth)) * 4) + 3];
+			// Same formula as rowOne just with sprite two.
+			auto rowTwo = spriteTwoData + (((left - spriteTwoX) + ((y - spriteTwoY) * spriteTwoWidth)) * 4);
 
-				// Check to see if both pixels have any alpha (i.e. aren't transparent).
-				if ((alphaOne != 0) && (alphaTwo != 0))
-				{
-					// If so, an intersection has been found so we return true.
-					return true;
-				}
+			// Check to see if any pair of pixels in the row both have any alpha (i.e. aren't transparent).
+			if (DX::IsRowAlphaOverlap(rowOne, rowTwo, static_cast<uint32_t>(pixelCount)))
+			{
+				// If so, an intersection has been found so we return true.
+				return true;
 			}
 		}
 	}
@@ -657,6 +836,38 @@ bool DX::IsPixelPerfectCollision(
 	return false;
 }
 
+bool DX::IsPixelPerfectCollision(
+	_In_ const CollisionMask& spriteOneMask,
+	_In_ Windows::Foundation::Rect& spriteOnePosition,
+	_In_ const CollisionMask& spriteTwoMask,
+	_In_ Windows::Foundation::Rect& spriteTwoPosition
+	)
+{
+	// Start by performing a simple intersection test between the two rectangles since looping the pixels would be a waste if no pixels could possibly overlap.
+	if (spriteOneMask.IsEmpty() || spriteTwoMask.IsEmpty() || !spriteOnePosition.IntersectsWith(spriteTwoPosition))
+	{
+		return false;
+	}
+
+	// Get the needed parameters as ints.
+	auto spriteOneX = static_cast<int>(spriteOnePosition.X);
+	auto spriteOneY = static_cast<int>(spriteOnePosition.Y);
+	auto spriteTwoX = static_cast<int>(spriteTwoPosition.X);
+	auto spriteTwoY = static_cast<int>(spriteTwoPosition.Y);
+
+	// Find the bounds of the rectangle intersection. We also clamp them to the masks so that a position whose width or height doesn't quite
+	// match its mask can never read outside of the mask data.
+	int top = max(static_cast<int>(max(spriteOnePosition.Top, spriteTwoPosition.Top)), max(spriteOneY, spriteTwoY));
+	int bottom = min(static_cast<int>(min(spriteOnePosition.Bottom, spriteTwoPosition.Bottom)),
+		min(spriteOneY + static_cast<int>(spriteOneMask.GetHeight()), spriteTwoY + static_cast<int>(spriteTwoMask.GetHeight())));
+	int left = max(static_cast<int>(max(spriteOnePosition.Left, spriteTwoPosition.Left)), max(spriteOneX, spriteTwoX));
+	int right = min(static_cast<int>(min(spriteOnePosition.Right, spriteTwoPosition.Right)),
+		min(spriteOneX + static_cast<int>(spriteOneMask.GetWidth()), spriteTwoX + static_cast<int>(spriteTwoMask.GetWidth())));
+
+	// Descend through the mask pyramids, only scanning the parts of the intersection where both sprites might be opaque.
+	return IsMaskRegionCollision(spriteOneMask, spriteOneX, spriteOneY, spriteTwoMask, spriteTwoX, spriteTwoY, left, top, right, bottom);
+}
+
 Windows::Foundation::Rect DX::GetTransformedBoundingRectangle(
 	_In_ Windows::Foundation::Rect boundingRectangle,
 	_In_ DirectX::CXMMATRIX transformationMatrix
@@ -732,56 +943,436 @@ bool DX::IsTransformedPixelPerfectCollision(
 	DirectX::XMFLOAT2 yPositionInSpriteTwo;
 	DirectX::XMStoreFloat2(&yPositionInSpriteTwo, DirectX::XMVector2Transform(DirectX::XMVectorZero(), transformOneToTwo));
 
-	// Get pointers for the texture data to avoid paying the cost of calling get() repeatedly within the loop.
-	auto dataOne = spriteOneTextureData.get();
-	auto dataTwo = spriteTwoTextureData.get();
+	// The original loops ran while the column (row) was less than the width (height) so a fractional size includes the partial texel.
+	auto columnCount = (spriteOneTextureWidth > 0.0f) ? static_cast<unsigned int>(ceilf(spriteOneTextureWidth)) : 0U;
+	auto rowCount = (spriteOneTextureHeight > 0.0f) ? static_cast<unsigned int>(ceilf(spriteOneTextureHeight)) : 0U;
 
-	// Get sprite two's width and height as int values to avoid unnecessary casting within the loop.
-	auto texOneWidth = static_cast<unsigned int>(spriteOneTextureWidth);
-	auto texTwoWidth = static_cast<int>(spriteTwoTextureWidth);
-	auto texTwoHeight = static_cast<int>(spriteTwoTextureHeight);
+	DX::TexelVector origin = { yPositionInSpriteTwo.x, yPositionInSpriteTwo.y };
+	DX::TexelVector columnStep = { stepX.x, stepX.y };
+	DX::TexelVector rowStep = { stepY.x, stepY.y };
+	return DX::IsTransformedAlphaCollision(spriteOneTextureData.get(), static_cast<uint32>(spriteOneTextureWidth), columnCount, rowCount,
+		spriteTwoTextureData.get(), static_cast<int32>(spriteTwoTextureWidth), static_cast<int32>(spriteTwoTextureHeight), origin, columnStep, rowStep);
+}
 
-	// Loop through sprite one by row.
-	for (unsigned int spriteOneY = 0; spriteOneY < spriteOneTextureHeight; spriteOneY++)
+bool DX::IsTransformedPixelPerfectCollision(
+	_In_ const CollisionMask& spriteOneMask,
+	_In_ DirectX::CXMMATRIX spriteOneWorldTransform,
+	_In_ const CollisionMask& spriteTwoMask,
+	_In_ DirectX::CXMMATRIX spriteTwoWorldTransform
+	)
+{
+	if (spriteOneMask.IsEmpty() || spriteTwoMask.IsEmpty())
+	{
+		return false;
+	}
+
+	// Create a matrix to transform coordinates from sprite one local to sprite two local.
+	DirectX::XMMATRIX transformOneToTwo = spriteOneWorldTransform * DirectX::XMMatrixInverse(nullptr, spriteTwoWorldTransform);
+
+	// Calculate the values we need to add to a sprite two coordinate when we move one pixel column right and one pixel row down in sprite one's local space.
+	const DirectX::XMFLOAT2 fUnitX(1.0f, 0.0f);
+	const DirectX::XMFLOAT2 fUnitY(0.0f, 1.0f);
+	DirectX::XMFLOAT2 stepX;
+	DirectX::XMFLOAT2 stepY;
+	DirectX::XMStoreFloat2(&stepX, DirectX::XMVector2TransformNormal(DirectX::XMLoadFloat2(&fUnitX), transformOneToTwo));
+	DirectX::XMStoreFloat2(&stepY, DirectX::XMVector2TransformNormal(DirectX::XMLoadFloat2(&fUnitY), transformOneToTwo));
+
+	// The coordinate in sprite two's local space that corresponds with sprite one's upper left (0,0).
+	DirectX::XMFLOAT2 origin;
+	DirectX::XMStoreFloat2(&origin, DirectX::XMVector2Transform(DirectX::XMVectorZero(), transformOneToTwo));
+
+	// Walk sprite one in 8x8 blocks (the coarsest level of its mask pyramid) so that whole blocks can be skipped.
+	const int blockSize = 1 << CollisionMask::CoarseLevelCount;
+	auto spriteOneWidth = static_cast<int>(spriteOneMask.GetWidth());
+	auto spriteOneHeight = static_cast<int>(spriteOneMask.GetHeight());
+
+	for (int blockTop = 0; blockTop < spriteOneHeight; blockTop += blockSize)
 	{
-		// Start at the beginning of the row for sprite two.
-		DirectX::XMFLOAT2 positionInSpriteTwo = yPositionInSpriteTwo;
+		auto blockBottom = min(blockTop + blockSize, spriteOneHeight);
 
-		// Loop through sprite one by column.
-		for (unsigned int spriteOneX = 0; spriteOneX < spriteOneTextureWidth; spriteOneX++)
+		for (int blockLeft = 0; blockLeft < spriteOneWidth; blockLeft += blockSize)
 		{
-			// Round to the nearest pixel. Note that since sprite two values might be negative and we're using integer truncation, we need 
-			// to add 0.5f to get to the nearest pixel if it's positive and -0.5f if it's negative. We don't care what we add if it's zero since
-			// it will always truncate to zero.
-			int spriteTwoX = static_cast<int>(positionInSpriteTwo.x + (positionInSpriteTwo.x > 0.0f ? 0.5f : -0.5f));
-			int spriteTwoY = static_cast<int>(positionInSpriteTwo.y + (positionInSpriteTwo.y > 0.0f ? 0.5f : -0.5f));
+			auto blockRight = min(blockLeft + blockSize, spriteOneWidth);
 
-			// Check to make sure the transformed coordinates are within the bounds of sprite two; if not there can't be a collision.
-			if ((spriteTwoX >= 0) && (spriteTwoX < texTwoWidth) &&
-				(spriteTwoY >= 0) && (spriteTwoY < texTwoHeight))
+			// Skip blocks of sprite one that are completely transparent. Since the rectangle is exactly one block this test is exact.
+			if (!spriteOneMask.MayContainOpaque(CollisionMask::CoarseLevelCount, blockLeft, blockTop, blockRight, blockBottom))
 			{
-				// Get the alphas of the overlapping pixels.
-				auto alphaOne = dataOne[(spriteOneX * 4 + spriteOneY * texOneWidth * 4) + 3];
-				auto alphaTwo = dataTwo[(spriteTwoX * 4 + spriteTwoY * texTwoWidth * 4) + 3];
+				continue;
+			}
 
-				// Check to see if both pixels have any alpha (i.e. aren't transparent).
-				if (alphaOne != 0 && alphaTwo != 0)
+			// Find the rectangle in sprite two's local space that the block's texels can land in. The texels are transformed to
+			// origin + (x * stepX) + (y * stepY) and then rounded so we take the bounds of the four corners, round outward, and
+			// then add a texel on each side to cover any floating point differences.
+			auto lastX = static_cast<float>(blockRight - 1);
+			auto lastY = static_cast<float>(blockBottom - 1);
+			float cornersX[4] =
+			{
+				origin.x + (stepX.x * blockLeft) + (stepY.x * blockTop),
+				origin.x + (stepX.x * lastX) + (stepY.x * blockTop),
+				origin.x + (stepX.x * blockLeft) + (stepY.x * lastY),
+				origin.x + (stepX.x * lastX) + (stepY.x * lastY)
+			};
+			float cornersY[4] =
+			{
+				origin.y + (stepX.y * blockLeft) + (stepY.y * blockTop),
+				origin.y + (stepX.y * lastX) + (stepY.y * blockTop),
+				origin.y + (stepX.y * blockLeft) + (stepY.y * lastY),
+				origin.y + (stepX.y * lastX) + (stepY.y * lastY)
+			};
+			auto minX = min(min(cornersX[0], cornersX[1]), min(cornersX[2], cornersX[3]));
+			auto maxX = max(max(cornersX[0], cornersX[1]), max(cornersX[2], cornersX[3]));
+			auto minY = min(min(cornersY[0], cornersY[1]), min(cornersY[2], cornersY[3]));
+			auto maxY = max(max(cornersY[0], cornersY[1]), max(cornersY[2], cornersY[3]));
+			auto footprintLeft = static_cast<int>(floorf(minX)) - 1;
+			auto footprintTop = static_cast<int>(floorf(minY)) - 1;
+			auto footprintRight = static_cast<int>(ceilf(maxX)) + 2;
+			auto footprintBottom = static_cast<int>(ceilf(maxY)) + 2;
+
+			// If sprite two has nothing opaque where this block lands then nothing in the block can collide.
+			if (!spriteTwoMask.MayContainOpaque(2, footprintLeft, footprintTop, footprintRight, footprintBottom))
+			{
+				continue;
+			}
+
+			// If sprite two is completely opaque where this block lands then the opaque texel(s) we know are in the block must collide.
+			if (spriteTwoMask.IsAllOpaque(1, footprintLeft, footprintTop, footprintRight, footprintBottom))
+			{
+				return true;
+			}
+
+			// Otherwise test the opaque texels of the block one at a time.
+			auto blockWidth = blockRight - blockLeft;
+			uint64_t columnMask = (1ULL << blockWidth) - 1ULL;
+
+			for (int spriteOneY = blockTop; spriteOneY < blockBottom; spriteOneY++)
+			{
+				// Calculate the start of the row in sprite two's local space directly rather than by accumulating steps so that we can jump straight to
+				// any texel in the row.
+				float rowX = origin.x + (stepY.x * spriteOneY);
+				float rowY = origin.y + (stepY.y * spriteOneY);
+
+				// Only visit the texels of sprite one that are opaque or translucent. Each pass through the loop clears the lowest set bit.
+				for (uint64_t bits = spriteOneMask.GetRowBits(static_cast<uint32_t>(spriteOneY), static_cast<uint32_t>(blockLeft)) & columnMask; bits != 0ULL; bits &= bits - 1ULL)
 				{
-					// If so, an intersection has been found so we return true.
-					return true;
+					auto spriteOneX = static_cast<float>(blockLeft + static_cast<int>(LowestSetBitIndex(bits)));
+					float positionX = rowX + (stepX.x * spriteOneX);
+					float positionY = rowY + (stepX.y * spriteOneX);
+
+					// Round to the nearest pixel the same way that the B8G8R8A8 version does. IsOpaque treats anything outside of sprite two as transparent.
+					int spriteTwoX = static_cast<int>(positionX + (positionX > 0.0f ? 0.5f : -0.5f));
+					int spriteTwoY = static_cast<int>(positionY + (positionY > 0.0f ? 0.5f : -0.5f));
+
+					if (spriteTwoMask.IsOpaque(spriteTwoX, spriteTwoY))
+					{
+						return true;
+					}
 				}
 			}
+		}
+	}
+
+	// If none of the overlapping pixels were opaque in both sprites, there's no collision so return false.
+	return false;
+}
+
+bool DX::IsTransformedPolygonCollision(
+	_In_ const CollisionPolygons& spriteOnePolygons,
+	_In_ DirectX::CXMMATRIX spriteOneWorldTransform,
+	_In_ const CollisionPolygons& spriteTwoPolygons,
+	_In_ DirectX::CXMMATRIX spriteTwoWorldTransform
+	)
+{
+	if (spriteOnePolygons.IsEmpty() || spriteTwoPolygons.IsEmpty())
+	{
+		return false;
+	}
+
+	// Create a matrix to transform coordinates from sprite one local to sprite two local.
+	DirectX::XMMATRIX transformOneToTwo = spriteOneWorldTransform * DirectX::XMMatrixInverse(nullptr, spriteTwoWorldTransform);
 
-			// Move to the next sprite two pixel in the row.
-			positionInSpriteTwo.x += stepX.x;
-			positionInSpriteTwo.y += stepX.y;
+	const DirectX::XMFLOAT2 fUnitX(1.0f, 0.0f);
+	const DirectX::XMFLOAT2 fUnitY(0.0f, 1.0f);
+	DirectX::XMFLOAT2 stepX;
+	DirectX::XMFLOAT2 stepY;
+	DirectX::XMStoreFloat2(&stepX, DirectX::XMVector2TransformNormal(DirectX::XMLoadFloat2(&fUnitX), transformOneToTwo));
+	DirectX::XMStoreFloat2(&stepY, DirectX::XMVector2TransformNormal(DirectX::XMLoadFloat2(&fUnitY), transformOneToTwo));
+
+	DirectX::XMFLOAT2 origin;
+	DirectX::XMStoreFloat2(&origin, DirectX::XMVector2Transform(DirectX::XMVectorZero(), transformOneToTwo));
+
+	// Move each of sprite one's pieces into sprite two's local space so that sprite two's pieces (and their bounding rectangles) can be used as is.
+	// Pieces have at most MaxPieceVertices vertices so this is done in a buffer on the stack rather than allocating a copy of every vertex.
+	auto vertices = spriteOnePolygons.GetVertices();
+	auto spriteTwoVertices = spriteTwoPolygons.GetVertices();
+	PolygonVertex pieceOneVertices[CollisionPolygons::MaxPieceVertices];
+	for (uint32 pieceOneIndex = 0; pieceOneIndex < spriteOnePolygons.GetPieceCount(); pieceOneIndex++)
+	{
+		const auto& pieceOne = spriteOnePolygons.GetPiece(pieceOneIndex);
+		auto pieceOneVertexCount = min(pieceOne.m_vertexCount, CollisionPolygons::MaxPieceVertices);
+		for (uint32 i = 0; i < pieceOneVertexCount; i++)
+		{
+			const auto& vertex = vertices[pieceOne.m_firstVertex + i];
+			pieceOneVertices[i].x = origin.x + (stepX.x * vertex.x) + (stepY.x * vertex.y);
+			pieceOneVertices[i].y = origin.y + (stepX.y * vertex.x) + (stepY.y * vertex.y);
+		}
+
+		float left = pieceOneVertices[0].x;
+		float right = left;
+		float top = pieceOneVertices[0].y;
+		float bottom = top;
+		for (uint32 i = 1; i < pieceOneVertexCount; i++)
+		{
+			left = min(left, pieceOneVertices[i].x);
+			right = max(right, pieceOneVertices[i].x);
+			top = min(top, pieceOneVertices[i].y);
+			bottom = max(bottom, pieceOneVertices[i].y);
 		}
 
-		// Move to the next sprite two row
-		yPositionInSpriteTwo.x += stepY.x;
-		yPositionInSpriteTwo.y += stepY.y;
+		for (uint32 pieceTwoIndex = 0; pieceTwoIndex < spriteTwoPolygons.GetPieceCount(); pieceTwoIndex++)
+		{
+			const auto& pieceTwo = spriteTwoPolygons.GetPiece(pieceTwoIndex);
+			if (right < pieceTwo.m_left || pieceTwo.m_right < left || bottom < pieceTwo.m_top || pieceTwo.m_bottom < top)
+			{
+				continue;
+			}
+
+			if (IsConvexPolygonOverlap(pieceOneVertices, pieceOneVertexCount, spriteTwoVertices + pieceTwo.m_firstVertex, pieceTwo.m_vertexCount))
+			{
+				return true;
+			}
+		}
+	}
+
+	return false;
+}
+
+bool DX::IsTransformedPolygonCollision(
+	_In_ const CollisionPolygons& spriteOnePolygons,
+	_In_ const CollisionMask& spriteOneMask,
+	_In_ DirectX::CXMMATRIX spriteOneWorldTransform,
+	_In_ const CollisionPolygons& spriteTwoPolygons,
+	_In_ const CollisionMask& spriteTwoMask,
+	_In_ DirectX::CXMMATRIX spriteTwoWorldTransform
+	)
+{
+	return IsTransformedPolygonCollision(spriteOnePolygons, spriteOneWorldTransform, spriteTwoPolygons, spriteTwoWorldTransform) &&
+		IsTransformedPixelPerfectCollision(spriteOneMask, spriteOneWorldTransform, spriteTwoMask, spriteTwoWorldTransform);
+}
+
+bool DX::IsSweptRectangleCollision(
+	_In_ const Windows::Foundation::Rect& spriteOneStart,
+	_In_ const Windows::Foundation::Rect& spriteOneEnd,
+	_In_ const Windows::Foundation::Rect& spriteTwoStart,
+	_In_ const Windows::Foundation::Rect& spriteTwoEnd,
+	_Out_ float& timeOfImpact
+	)
+{
+	float last;
+	if (!GetSweptRectangleOverlap(spriteOneStart, spriteOneEnd, spriteTwoStart, spriteTwoEnd, timeOfImpact, last))
+	{
+		timeOfImpact = 1.0f;
+		return false;
+	}
+
+	return true;
+}
+
+bool DX::IsSweptTransformedPixelPerfectCollision(
+	_In_ const CollisionMask& spriteOneMask,
+	_In_ DirectX::CXMMATRIX spriteOneStartTransform,
+	_In_ DirectX::CXMMATRIX spriteOneEndTransform,
+	_In_ const CollisionMask& spriteTwoMask,
+	_In_ DirectX::CXMMATRIX spriteTwoStartTransform,
+	_In_ DirectX::CXMMATRIX spriteTwoEndTransform,
+	_Out_ float& timeOfImpact,
+	_In_ unsigned int maxSteps
+	)
+{
+	timeOfImpact = 1.0f;
+	if (spriteOneMask.IsEmpty() || spriteTwoMask.IsEmpty())
+	{
+		return false;
+	}
+
+	auto spriteOneWidth = static_cast<float>(spriteOneMask.GetWidth());
+	auto spriteOneHeight = static_cast<float>(spriteOneMask.GetHeight());
+	auto spriteTwoWidth = static_cast<float>(spriteTwoMask.GetWidth());
+	auto spriteTwoHeight = static_cast<float>(spriteTwoMask.GetHeight());
+	Windows::Foundation::Rect spriteOneBounds(0.0f, 0.0f, spriteOneWidth, spriteOneHeight);
+	Windows::Foundation::Rect spriteTwoBounds(0.0f, 0.0f, spriteTwoWidth, spriteTwoHeight);
+
+	// Break the transforms up so that the times in between can be interpolated. If that isn't possible then just test the end transforms.
+	auto spriteOneCenter = DirectX::XMVectorSet(spriteOneWidth * 0.5f, spriteOneHeight * 0.5f, 0.0f, 1.0f);
+	auto spriteTwoCenter = DirectX::XMVectorSet(spriteTwoWidth * 0.5f, spriteTwoHeight * 0.5f, 0.0f, 1.0f);
+	SweptPose spriteOneStart, spriteOneEnd, spriteTwoStart, spriteTwoEnd;
+	if (!GetSweptPose(spriteOneCenter, spriteOneStartTransform, spriteOneStart) || !GetSweptPose(spriteOneCenter, spriteOneEndTransform, spriteOneEnd) ||
+		!GetSweptPose(spriteTwoCenter, spriteTwoStartTransform, spriteTwoStart) || !GetSweptPose(spriteTwoCenter, spriteTwoEndTransform, spriteTwoEnd))
+	{
+		if (IsTransformedPixelPerfectCollision(spriteOneMask, spriteOneStartTransform, spriteTwoMask, spriteTwoStartTransform))
+		{
+			timeOfImpact = 0.0f;
+			return true;
+		}
+
+		return IsTransformedPixelPerfectCollision(spriteOneMask, spriteOneEndTransform, spriteTwoMask, spriteTwoEndTransform);
+	}
+
+	// Gets the transforms at time t. The original transforms are used at the ends so that the results there exactly match
+	// IsTransformedPixelPerfectCollision.
+	auto getTransforms = [&](float t, DirectX::XMMATRIX& spriteOneTransform, DirectX::XMMATRIX& spriteTwoTransform)
+	{
+		if (t <= 0.0f)
+		{
+			spriteOneTransform = spriteOneStartTransform;
+			spriteTwoTransform = spriteTwoStartTransform;
+		}
+		else if (t >= 1.0f)
+		{
+			spriteOneTransform = spriteOneEndTransform;
+			spriteTwoTransform = spriteTwoEndTransform;
+		}
+		else
+		{
+			spriteOneTransform = GetSweptTransform(spriteOneCenter, spriteOneStart, spriteOneEnd, t);
+			spriteTwoTransform = GetSweptTransform(spriteTwoCenter, spriteTwoStart, spriteTwoEnd, t);
+		}
+	};
+
+	// Find how fast (in texels of the other sprite per unit of time) the texels of each sprite move relative to the other sprite. The texel that
+	// moves furthest is always a corner since the movement is an affine function of the position. The movement along the way isn't a straight
+	// line when the sprites rotate so the corners are followed over eight equal intervals and the fastest interval is used; each chord is then
+	// within about 1% of its arc for rotations of up to half a turn per frame, and the speeds are padded by 1/16th to cover that.
+	const unsigned int speedIntervals = 8;
+	float speedOne = 0.0f;
+	float speedTwo = 0.0f;
+	{
+		DirectX::XMMATRIX previousOne = spriteOneStartTransform;
+		DirectX::XMMATRIX previousTwo = spriteTwoStartTransform;
+		for (unsigned int interval = 1; interval <= speedIntervals; interval++)
+		{
+			DirectX::XMMATRIX currentOne, currentTwo;
+			getTransforms(static_cast<float>(interval) / speedIntervals, currentOne, currentTwo);
+
+			auto oneToTwoPrevious = previousOne * DirectX::XMMatrixInverse(nullptr, previousTwo);
+			auto oneToTwoCurrent = currentOne * DirectX::XMMatrixInverse(nullptr, currentTwo);
+			auto twoToOnePrevious = previousTwo * DirectX::XMMatrixInverse(nullptr, previousOne);
+			auto twoToOneCurrent = currentTwo * DirectX::XMMatrixInverse(nullptr, currentOne);
+			speedOne = max(speedOne, GetLargestCornerMovement(spriteOneWidth, spriteOneHeight, oneToTwoPrevious, oneToTwoCurrent));
+			speedTwo = max(speedTwo, GetLargestCornerMovement(spriteTwoWidth, spriteTwoHeight, twoToOnePrevious, twoToOneCurrent));
+
+			previousOne = currentOne;
+			previousTwo = currentTwo;
+		}
+
+		speedOne *= speedIntervals * 1.0625f;
+		speedTwo *= speedIntervals * 1.0625f;
+	}
+
+	// If the sprites don't move relative to each other then the start transforms give the answer for the whole frame.
+	if (speedOne < 1.0e-4f && speedTwo < 1.0e-4f)
+	{
+		if (IsTransformedPixelPerfectCollision(spriteOneMask, spriteOneStartTransform, spriteTwoMask, spriteTwoStartTransform))
+		{
+			timeOfImpact = 0.0f;
+			return true;
+		}
+
+		return false;
+	}
+
+	// If neither sprite rotates or changes scale then the bounding rectangles move linearly, so the swept rectangle test finds exactly when they
+	// overlap and only that window needs to be searched.
+	float firstTime = 0.0f;
+	float lastTime = 1.0f;
+	const DirectX::XMVECTOR epsilon = DirectX::XMVectorReplicate(1.0e-5f);
+	if (DirectX::XMVector4NearEqual(spriteOneStart.m_scale, spriteOneEnd.m_scale, epsilon) &&
+		DirectX::XMVector4NearEqual(spriteOneStart.m_rotation, spriteOneEnd.m_rotation, epsilon) &&
+		DirectX::XMVector4NearEqual(spriteTwoStart.m_scale, spriteTwoEnd.m_scale, epsilon) &&
+		DirectX::XMVector4NearEqual(spriteTwoStart.m_rotation, spriteTwoEnd.m_rotation, epsilon))
+	{
+		if (!GetSweptRectangleOverlap(GetTransformedBoundingRectangle(spriteOneBounds, spriteOneStartTransform), GetTransformedBoundingRectangle(spriteOneBounds, spriteOneEndTransform),
+			GetTransformedBoundingRectangle(spriteTwoBounds, spriteTwoStartTransform), GetTransformedBoundingRectangle(spriteTwoBounds, spriteTwoEndTransform), firstTime, lastTime))
+		{
+			return false;
+		}
+	}
+
+	// Conservative advancement. At each time the coarse levels of the masks give a lower bound on the gap between the sprites (in sprite two's
+	// texels) and no texel of sprite one can cross that gap in less than gap / speedOne, so the search jumps straight there. Only once the
+	// coarse levels can't show a gap is the full mask test run, and if it finds no collision the search moves on by the time it takes a texel
+	// of either sprite to move one texel of the other, like the old fixed steps did.
+	// The coarse gap is capped so that a single jump can't step over the whole of a sprite that is moving fast relative to its size.
+	const int maxGap = 128;
+	auto texelTime = 1.0f / max(speedOne, speedTwo);
+	auto t = firstTime;
+	float clearTime = -1.0f;
+	bool isTimeExact = true;
+
+	for (unsigned int step = 0; step < max(maxSteps, 1U); step++)
+	{
+		DirectX::XMMATRIX spriteOneTransform, spriteTwoTransform;
+		getTransforms(t, spriteOneTransform, spriteTwoTransform);
+
+		auto gap = GetCoarseMaskGap(spriteOneMask, spriteOneTransform * DirectX::XMMatrixInverse(nullptr, spriteTwoTransform), spriteTwoMask, maxGap);
+		if (gap == 0)
+		{
+			if (IsTransformedPixelPerfectCollision(spriteOneMask, spriteOneTransform, spriteTwoMask, spriteTwoTransform))
+			{
+				// The last step was a whole texel of movement so the sprites can have first touched anywhere in it. Narrow it down with a few
+				// rounds of bisection, which puts the time within 1/16th of a texel of movement of the first time that the masks overlap.
+				if (!isTimeExact && clearTime >= 0.0f)
+				{
+					for (int round = 0; round < 4; round++)
+					{
+						auto middle = (clearTime + t) * 0.5f;
+						getTransforms(middle, spriteOneTransform, spriteTwoTransform);
+						if (IsTransformedPixelPerfectCollision(spriteOneMask, spriteOneTransform, spriteTwoMask, spriteTwoTransform))
+						{
+							t = middle;
+						}
+						else
+						{
+							clearTime = middle;
+						}
+					}
+				}
+
+				timeOfImpact = t;
+				return true;
+			}
+
+			clearTime = t;
+			isTimeExact = false;
+			t += texelTime;
+		}
+		else
+		{
+			clearTime = t;
+			isTimeExact = true;
+			t += static_cast<float>(gap) / max(speedOne, 1.0e-4f);
+		}
+
+		if (t >= lastTime)
+		{
+			if (clearTime >= lastTime)
+			{
+				return false;
+			}
+
+			// Always finish on the last time so that a collision there is never missed.
+			t = lastTime;
+		}
+	}
+
+	// The search ran out of steps while the sprites were close together. Test the end of the window so that a sprite can't end the frame inside
+	// of the other without being reported.
+	DirectX::XMMATRIX spriteOneTransform, spriteTwoTransform;
+	getTransforms(lastTime, spriteOneTransform, spriteTwoTransform);
+	if (IsTransformedPixelPerfectCollision(spriteOneMask, spriteOneTransform, spriteTwoMask, spriteTwoTransform))
+	{
+		timeOfImpact = lastTime;
+		return true;
 	}
 
-	// If none of the overlapping pixels were opaque in both sprites, there's no collision so return false.
 	return false;
 }
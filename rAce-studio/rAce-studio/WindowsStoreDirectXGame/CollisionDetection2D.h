@@ -10,6 +10,8 @@
 #include <memory>
 
 #include "SpriteBatch.h"
+#include "CollisionMask.h"
+#include "CollisionPolygons.h"
 #include "Texture2D.h"
 #include "RenderTarget2D.h"
 #include "Utility.h"
@@ -26,6 +28,10 @@ namespace DX
 	// DXGI_FORMAT_R32G32B32A32_FLOAT
 	// DXGI_FORMAT_BC1_UNORM
 	// DXGI_FORMAT_BC3_UNORM
+	// DXGI_FORMAT_BC4_UNORM (the single channel is returned as the alpha value with white color since it is treated as an alpha mask)
+	// DXGI_FORMAT_BC5_UNORM (always opaque)
+	// DXGI_FORMAT_BC4_SNORM and DXGI_FORMAT_BC5_SNORM (as the _UNORM formats, with negative values returned as zero)
+	// DXGI_FORMAT_BC7_UNORM
 	// Parameters:
 	// device - The game's ID3D11Device.
 	// context - The ID3D11DeviceContext being used with the SpriteBatch instance (typically the immediate context).
@@ -43,6 +49,28 @@ namespace DX
 		_In_ unsigned long lineNumber
 		);
 
+	// Checks that GetTexture2DCollisionDataFromMappedData can convert a texture. The formats are the ones listed for GetTexture2DCollisionDataNoRender.
+	// desc - The desc of the texture.
+	// filename - Pass __FILEW__ for this parameter (or nullptr if you don't want the file name thrown used in any exception messages).
+	// lineNumber - Pass __LINE__ for this parameter to know which line of your game's code an exception came from. Helps with debugging.
+	// Throws a Platform::COMException with an HRESULT of ERROR_GRAPHICS_INVALID_PIXELFORMAT if the format isn't supported or E_INVALIDARG if the
+	// texture is block compressed and its dimensions aren't multiples of 4.
+	void ValidateTexture2DCollisionDataFormat(
+		_In_ const D3D11_TEXTURE2D_DESC& desc,
+		_In_opt_z_ const wchar_t* filename,
+		_In_ unsigned long lineNumber
+		);
+
+	// Converts the data of a mapped staging texture to B8G8R8A8 format. This is the second half of GetTexture2DCollisionDataNoRender, split out so that
+	// the data can also be read back without waiting for the GPU (see CollisionDataReadback). Call ValidateTexture2DCollisionDataFormat first.
+	// desc - The desc of the staging texture.
+	// mappedResource - The mapped data of subresource 0 of the staging texture.
+	// Return value - The pixel data in BGRA format, or nullptr if the format isn't supported.
+	std::unique_ptr<uint8> GetTexture2DCollisionDataFromMappedData(
+		_In_ const D3D11_TEXTURE2D_DESC& desc,
+		_In_ const D3D11_MAPPED_SUBRESOURCE& mappedResource
+		);
+
 	// Returns the pixel data in B8G8R8A8 format of any texture (regardless of format). Note that the context's state (e.g. render targets, view ports, shaders, etc.) will be modified since this 
 	// data method involves drawing the texture to a temporary render target, copying the data to a second texture (which has CPU read access), and then maps that to read the texture data. This
 	// operation will take a non-trivial amount of time so it should be avoided during gameplay. This function requires the immediate context and so it will block the UI thread until it completes.
@@ -63,6 +91,18 @@ namespace DX
 		_In_ unsigned long lineNumber
 		);
 
+	// Loads a collision mask from a .cmask file built offline by the CollisionMaskBuilder tool. The file is memory mapped, copied into the mask and
+	// checked (see CollisionMask::LoadFromMemory) so unlike GetTexture2DCollisionData and GetTexture2DCollisionDataNoRender this doesn't touch the
+	// GPU and is cheap enough to call from a loading task on any thread.
+	// filename - The .cmask file. Relative paths are relative to the app's installed location.
+	// mask - Receives the collision mask.
+	// Throws a Platform::Exception with the Win32 error as an HRESULT if the file can't be opened, or with an HRESULT of ERROR_INVALID_DATA
+	// (as an HRESULT) if it isn't a valid .cmask file.
+	void LoadCollisionMask(
+		_In_z_ const wchar_t* filename,
+		_Out_ CollisionMask& mask
+		);
+
 	// Performs a rectangle collision check and returns true if there is a collision, false if not..
 	// spriteOnePosition - The position for the first sprite.
 	// spriteTwoPosition - The position for the second sprite.
@@ -113,6 +153,21 @@ namespace DX
 		_In_ Windows::Foundation::Rect& spriteTwoPosition
 		);
 
+	// Performs non-transformed pixel perfect collision detection using 1-bit collision masks. The intersection is first tested against the coarse levels
+	// of both masks so that regions where either sprite is transparent (or where both are opaque) are resolved with a few block checks. The remaining
+	// rows are tested 64 texels at a time.
+	// spriteOneMask - The collision mask for the first sprite.
+	// spriteOnePosition - The position for the first sprite. Note that the width and height must match the first mask's width and height. Use IsTransformedPixelPerfectCollision if you need scaling.
+	// spriteTwoMask - The collision mask for the second sprite.
+	// spriteTwoPosition - The position for the second sprite. Note that the width and height must match the second mask's width and height. Use IsTransformedPixelPerfectCollision if you need scaling.
+	// Returns true if collision was detected, false if not.
+	bool IsPixelPerfectCollision(
+		_In_ const CollisionMask& spriteOneMask,
+		_In_ Windows::Foundation::Rect& spriteOnePosition,
+		_In_ const CollisionMask& spriteTwoMask,
+		_In_ Windows::Foundation::Rect& spriteTwoPosition
+		);
+
 	// Gets the bounding rectangle for a sprite which has been transformed (by scaling, rotating, translating, or some combination thereof).
 	// boundingRectangle - The untransformed bounding rectangle of the sprite. Should be (0, 0, width, height).
 	// transformationMatrix - The matrix which combines all the transforms for the rectangle. Right hand coordinate system so the transform order should be translate for origin offset, scale, rotate (Z axis), translate for position.
@@ -122,6 +177,7 @@ namespace DX
 		);
 
 	// Performs transformed (scaling, rotation, translation (including non (0,0) origin), or any combination thereof) pixel perfect collision detection.
+	// Each row of the first sprite is clipped to the columns that can land inside of the second sprite, so texels that can't overlap it are skipped.
 	// spriteOneTextureData - The texture data for the first sprite.
 	// spriteOneTextureWidth - The unscaled pixel width of the texture for the first sprite.
 	// spriteOneTextureHeight - The unscaled pixel height of the texture for the first sprite.
@@ -141,4 +197,109 @@ namespace DX
 		_In_ float spriteTwoTextureHeight,
 		_In_ DirectX::CXMMATRIX spriteTwoWorldTransform
 		);
+
+	// Performs transformed (scaling, rotation, translation (including non (0,0) origin), or any combination thereof) pixel perfect collision detection
+	// using 1-bit collision masks. The first sprite is walked in 8x8 blocks. Transparent blocks are skipped, and blocks that land on a part of the second
+	// sprite that is completely transparent (or completely opaque) are resolved without looking at individual texels. Within the remaining blocks only
+	// the opaque texels of the first sprite are transformed into the second sprite's space. The width and height of each sprite's texture come from its mask.
+	// spriteOneMask - The collision mask for the first sprite.
+	// spriteOneWorldTransform - The transform matrix for the first sprite. Right hand coordinate system so the transform order should be translate for origin offset, scale, rotate (Z axis), translate for position.
+	// spriteTwoMask - The collision mask for the second sprite.
+	// spriteTwoWorldTransform - The transform matrix for the second sprite. Right hand coordinate system so the transform order should be translate for origin offset, scale, rotate (Z axis), translate for position.
+	// Returns true if collision was detected, false if not.
+	bool IsTransformedPixelPerfectCollision(
+		_In_ const CollisionMask& spriteOneMask,
+		_In_ DirectX::CXMMATRIX spriteOneWorldTransform,
+		_In_ const CollisionMask& spriteTwoMask,
+		_In_ DirectX::CXMMATRIX spriteTwoWorldTransform
+		);
+
+	// Performs transformed (scaling, rotation, translation (including non (0,0) origin), or any combination thereof) collision detection using the
+	// convex pieces of each sprite's CollisionPolygons. Sprite one's vertices are transformed into sprite two's local space, pieces whose bounding
+	// rectangles don't overlap are skipped, and the rest are tested with the separating axis theorem. This is much cheaper than the pixel perfect
+	// tests but is only as accurate as the polygons (see CollisionPolygons for how the tolerance and holes affect them).
+	// spriteOnePolygons - The collision polygons for the first sprite.
+	// spriteOneWorldTransform - The transform matrix for the first sprite. Right hand coordinate system so the transform order should be translate for origin offset, scale, rotate (Z axis), translate for position.
+	// spriteTwoPolygons - The collision polygons for the second sprite.
+	// spriteTwoWorldTransform - The transform matrix for the second sprite. Right hand coordinate system so the transform order should be translate for origin offset, scale, rotate (Z axis), translate for position.
+	// Returns true if collision was detected, false if not.
+	bool IsTransformedPolygonCollision(
+		_In_ const CollisionPolygons& spriteOnePolygons,
+		_In_ DirectX::CXMMATRIX spriteOneWorldTransform,
+		_In_ const CollisionPolygons& spriteTwoPolygons,
+		_In_ DirectX::CXMMATRIX spriteTwoWorldTransform
+		);
+
+	// Performs transformed polygon collision detection and then refines any hit with the transformed pixel perfect test, so the result matches
+	// IsTransformedPixelPerfectCollision except that overlaps which the polygons miss aren't reported. The polygons can miss an overlap that is
+	// within the tolerance that they were built with plus a quarter of a texel's diagonal (about 0.35 texels, the corner that marching squares
+	// cuts off each corner texel) of each sprite's polygons, in that sprite's texels, and miss every overlap with a region that the
+	// simplification dropped (see CollisionPolygons). Most pairs that don't collide are rejected by the cheap polygon test without looking at
+	// any texels.
+	// spriteOnePolygons - The collision polygons for the first sprite.
+	// spriteOneMask - The collision mask for the first sprite (the one its polygons were built from).
+	// spriteOneWorldTransform - The transform matrix for the first sprite. Right hand coordinate system so the transform order should be translate for origin offset, scale, rotate (Z axis), translate for position.
+	// spriteTwoPolygons - The collision polygons for the second sprite.
+	// spriteTwoMask - The collision mask for the second sprite (the one its polygons were built from).
+	// spriteTwoWorldTransform - The transform matrix for the second sprite. Right hand coordinate system so the transform order should be translate for origin offset, scale, rotate (Z axis), translate for position.
+	// Returns true if collision was detected, false if not.
+	bool IsTransformedPolygonCollision(
+		_In_ const CollisionPolygons& spriteOnePolygons,
+		_In_ const CollisionMask& spriteOneMask,
+		_In_ DirectX::CXMMATRIX spriteOneWorldTransform,
+		_In_ const CollisionPolygons& spriteTwoPolygons,
+		_In_ const CollisionMask& spriteTwoMask,
+		_In_ DirectX::CXMMATRIX spriteTwoWorldTransform
+		);
+
+	// Performs swept (continuous) rectangle collision detection. Each rectangle moves (and grows or shrinks) linearly from its start rectangle to
+	// its end rectangle over the frame and the function finds the earliest time at which they overlap. Use this for fast moving sprites that could
+	// pass through each other completely between one frame and the next.
+	// spriteOneStart - The bounding rectangle of the first sprite at the start of the frame (e.g. from GetTransformedBoundingRectangle).
+	// spriteOneEnd - The bounding rectangle of the first sprite at the end of the frame.
+	// spriteTwoStart - The bounding rectangle of the second sprite at the start of the frame.
+	// spriteTwoEnd - The bounding rectangle of the second sprite at the end of the frame.
+	// timeOfImpact - Receives the time, from 0.0f (start) to 1.0f (end), at which the rectangles first overlap. Set to 1.0f if they never do.
+	// Returns true if the rectangles overlap at any time during the frame, false if not.
+	bool IsSweptRectangleCollision(
+		_In_ const Windows::Foundation::Rect& spriteOneStart,
+		_In_ const Windows::Foundation::Rect& spriteOneEnd,
+		_In_ const Windows::Foundation::Rect& spriteTwoStart,
+		_In_ const Windows::Foundation::Rect& spriteTwoEnd,
+		_Out_ float& timeOfImpact
+		);
+
+	// Performs swept (continuous) transformed pixel perfect collision detection using 1-bit collision masks. The sprites move from their start
+	// transforms to their end transforms (scale and position are interpolated linearly and rotation is interpolated about each sprite's center).
+	// The time of impact is found by conservative advancement: the coarse levels of the masks give a lower bound on the gap between the sprites
+	// and the search jumps ahead by the time it takes any texel to cross that gap, so the full mask test is only run once the sprites are within
+	// about a texel of each other. From there the search moves a texel of movement at a time, and when the masks overlap a few rounds of
+	// bisection narrow the time down. If neither sprite rotates or changes scale the swept rectangle test limits the search to the window in which
+	// the bounding rectangles overlap. Times 0.0f and 1.0f use the transforms that are passed in so they give exactly the same results as
+	// IsTransformedPixelPerfectCollision.
+	// Accuracy: the reported time is never earlier than a time at which the masks are found not to overlap and is within 1/16th of a texel of
+	// movement of the first time that they do. Thin parts of a sprite (about a texel wide) can still be missed if they only overlap the other
+	// sprite in between two texel steps, as with the static test when a sprite is scaled up so that its texels are more than a texel apart in the
+	// other sprite. The speed bound that the jumps use follows the corners of each sprite over eight intervals of the frame, which is padded to
+	// stay conservative for rotations of up to half a turn per frame.
+	// spriteOneMask - The collision mask for the first sprite.
+	// spriteOneStartTransform - The transform matrix for the first sprite at the start of the frame (i.e. the previous frame's transform).
+	// spriteOneEndTransform - The transform matrix for the first sprite at the end of the frame (i.e. the current transform).
+	// spriteTwoMask - The collision mask for the second sprite.
+	// spriteTwoStartTransform - The transform matrix for the second sprite at the start of the frame.
+	// spriteTwoEndTransform - The transform matrix for the second sprite at the end of the frame.
+	// timeOfImpact - Receives the time, from 0.0f (start) to 1.0f (end), at which the sprites first collide (see above). Set to 1.0f if they don't.
+	// maxSteps - The largest number of times that the search advances. If the sprites stay close together without colliding for longer than
+	// that then the rest of the frame is only checked at its end.
+	// Returns true if collision was detected, false if not.
+	bool IsSweptTransformedPixelPerfectCollision(
+		_In_ const CollisionMask& spriteOneMask,
+		_In_ DirectX::CXMMATRIX spriteOneStartTransform,
+		_In_ DirectX::CXMMATRIX spriteOneEndTransform,
+		_In_ const CollisionMask& spriteTwoMask,
+		_In_ DirectX::CXMMATRIX spriteTwoStartTransform,
+		_In_ DirectX::CXMMATRIX spriteTwoEndTransform,
+		_Out_ float& timeOfImpact,
+		_In_ unsigned int maxSteps = 64
+		);
 }
@@ -0,0 +1,468 @@
+#include "CollisionMask.h"
+
+#include <cstring>
+
+namespace
+{
+	// Gathers the even bits (0, 2, 4, ..., 62) of a 64-bit value into the low 32 bits of the result.
+	inline uint64_t CompressEvenBits(uint64_t value)
+	{
+		value &= 0x5555555555555555ULL;
+		value = (value | (value >> 1)) & 0x3333333333333333ULL;
+		value = (value | (value >> 2)) & 0x0F0F0F0F0F0F0F0FULL;
+		value = (value | (value >> 4)) & 0x00FF00FF00FF00FFULL;
+		value = (value | (value >> 8)) & 0x0000FFFF0000FFFFULL;
+		value = (value | (value >> 16)) & 0x00000000FFFFFFFFULL;
+		return value;
+	}
+
+	// Halves a row of bits (2 bits in, 1 bit out). If combineWithOr is true a result bit is set when either source bit is set, otherwise it is set
+	// only when both source bits are set.
+	// source - The source row. Must have sourceWords words.
+	// sourceWords - The number of words in the source row.
+	// destination - The destination row. Must have (sourceWords + 1) / 2 words.
+	inline void HalveRow(const uint64_t* source, uint32_t sourceWords, uint64_t* destination, bool combineWithOr)
+	{
+		for (uint32_t i = 0; i < sourceWords; i += 2)
+		{
+			uint64_t low = source[i];
+			uint64_t high = (i + 1 < sourceWords) ? source[i + 1] : 0ULL;
+
+			// Combine each pair of horizontally adjacent bits into the even bit of the pair.
+			low = combineWithOr ? (low | (low >> 1)) : (low & (low >> 1));
+			high = combineWithOr ? (high | (high >> 1)) : (high & (high >> 1));
+
+			destination[i / 2] = CompressEvenBits(low) | (CompressEvenBits(high) << 32);
+		}
+	}
+
+	// Returns a mask with bits [first, last] set within the word that starts at bit wordStart. Bits outside the word are ignored.
+	inline uint64_t RangeMask(uint32_t wordStart, uint32_t first, uint32_t last)
+	{
+		auto low = (first > wordStart) ? (first - wordStart) : 0;
+		auto high = (last < wordStart + 63) ? (last - wordStart) : 63;
+		uint64_t mask = (high == 63) ? ~0ULL : ((1ULL << (high + 1)) - 1ULL);
+		return mask & ~((1ULL << low) - 1ULL);
+	}
+}
+
+DX::CollisionMask::CollisionMask() :
+	m_width(),
+	m_height(),
+	m_wordsPerRow(),
+	m_bits(),
+	m_levels(),
+	m_boundsLeft(),
+	m_boundsTop(),
+	m_boundsRight(),
+	m_boundsBottom()
+{
+}
+
+void DX::CollisionMask::CreateFromBGRA(
+	const uint8_t* data,
+	uint32_t width,
+	uint32_t height
+	)
+{
+	// B8G8R8A8 texels are four bytes each with the alpha value in the last byte.
+	CreateFromBytes(data, width, height, 4, 3);
+}
+
+void DX::CollisionMask::CreateFromAlpha(
+	const uint8_t* data,
+	uint32_t width,
+	uint32_t height
+	)
+{
+	CreateFromBytes(data, width, height, 1, 0);
+}
+
+void DX::CollisionMask::Reset()
+{
+	m_width = 0;
+	m_height = 0;
+	m_wordsPerRow = 0;
+	std::vector<uint64_t>().swap(m_bits);
+	std::vector<Level>().swap(m_levels);
+	m_boundsLeft = 0;
+	m_boundsTop = 0;
+	m_boundsRight = 0;
+	m_boundsBottom = 0;
+}
+
+void DX::CollisionMask::SaveToMemory(std::vector<uint8_t>& data) const
+{
+	CollisionMaskFileHeader header;
+	header.m_magic = CollisionMaskFileMagic;
+	header.m_version = CollisionMaskFileVersion;
+	header.m_width = m_width;
+	header.m_height = m_height;
+	header.m_levelCount = m_bits.empty() ? 0 : CoarseLevelCount;
+	header.m_reserved = 0;
+	header.m_boundsLeft = m_boundsLeft;
+	header.m_boundsTop = m_boundsTop;
+	header.m_boundsRight = m_boundsRight;
+	header.m_boundsBottom = m_boundsBottom;
+
+	auto wordCount = m_bits.size();
+	for (auto& level : m_levels)
+	{
+		wordCount += level.m_any.size() + level.m_all.size();
+	}
+
+	data.resize(sizeof(header) + (wordCount * sizeof(uint64_t)));
+	auto destination = data.data();
+	std::memcpy(destination, &header, sizeof(header));
+	destination += sizeof(header);
+
+	// Copies a run of words into the file data.
+	auto writeWords = [&destination](const std::vector<uint64_t>& words)
+	{
+		if (!words.empty())
+		{
+			std::memcpy(destination, words.data(), words.size() * sizeof(uint64_t));
+			destination += words.size() * sizeof(uint64_t);
+		}
+	};
+
+	writeWords(m_bits);
+	for (auto& level : m_levels)
+	{
+		writeWords(level.m_any);
+		writeWords(level.m_all);
+	}
+}
+
+bool DX::CollisionMask::LoadFromMemory(
+	const void* data,
+	size_t size
+	)
+{
+	Reset();
+
+	CollisionMaskFileHeader header;
+	if (data == nullptr || size < sizeof(header))
+	{
+		return false;
+	}
+
+	std::memcpy(&header, data, sizeof(header));
+	if (header.m_magic != CollisionMaskFileMagic || header.m_version != CollisionMaskFileVersion || header.m_reserved != 0)
+	{
+		return false;
+	}
+
+	// An empty mask is just a header.
+	if (header.m_width == 0 || header.m_height == 0)
+	{
+		return (header.m_width == 0 && header.m_height == 0 && header.m_levelCount == 0 && size == sizeof(header));
+	}
+
+	if (header.m_levelCount != CoarseLevelCount ||
+		header.m_boundsRight > header.m_width || header.m_boundsBottom > header.m_height ||
+		header.m_boundsLeft > header.m_boundsRight || header.m_boundsTop > header.m_boundsBottom)
+	{
+		return false;
+	}
+
+	// Work out the layout of every level from the size and make sure that the file holds exactly that much data. The sizes are calculated in
+	// 64 bits so that a corrupt header can't overflow them.
+	uint64_t wordsPerRow = (static_cast<uint64_t>(header.m_width) + 63) / 64;
+	uint64_t totalWords = wordsPerRow * header.m_height;
+	uint64_t levelWidth = header.m_width;
+	uint64_t levelHeight = header.m_height;
+	for (uint32_t i = 0; i < CoarseLevelCount; ++i)
+	{
+		levelWidth = (levelWidth + 1) / 2;
+		levelHeight = (levelHeight + 1) / 2;
+		totalWords += 2 * ((levelWidth + 63) / 64) * levelHeight;
+	}
+
+	if (static_cast<uint64_t>(size) != sizeof(header) + (totalWords * sizeof(uint64_t)))
+	{
+		return false;
+	}
+
+	auto source = static_cast<const uint8_t*>(data) + sizeof(header);
+
+	// Copies a run of words out of the file data.
+	auto readWords = [&source](std::vector<uint64_t>& words, size_t count)
+	{
+		words.resize(count);
+		std::memcpy(words.data(), source, count * sizeof(uint64_t));
+		source += count * sizeof(uint64_t);
+	};
+
+	m_width = header.m_width;
+	m_height = header.m_height;
+	m_wordsPerRow = static_cast<uint32_t>(wordsPerRow);
+	readWords(m_bits, static_cast<size_t>(m_wordsPerRow) * m_height);
+
+	// The collision tests AND whole words together, so any bits set past the width would show up as hits outside of the texture.
+	auto widthInLastWord = m_width & 63;
+	if (widthInLastWord != 0)
+	{
+		auto padding = ~((1ULL << widthInLastWord) - 1ULL);
+		for (uint32_t y = 0; y < m_height; ++y)
+		{
+			if ((m_bits[(y * m_wordsPerRow) + m_wordsPerRow - 1] & padding) != 0ULL)
+			{
+				Reset();
+				return false;
+			}
+		}
+	}
+
+	// Rebuild the coarse levels and the bounds from the full resolution mask and make sure that the file's copies match. Building them is
+	// cheap next to reading the file, and a mismatch means that the file is corrupt.
+	CreateLevels();
+	CreateBounds();
+
+	bool isValid = (m_boundsLeft == header.m_boundsLeft && m_boundsTop == header.m_boundsTop &&
+		m_boundsRight == header.m_boundsRight && m_boundsBottom == header.m_boundsBottom);
+	for (auto& level : m_levels)
+	{
+		auto count = level.m_any.size() * sizeof(uint64_t);
+		isValid = isValid && std::memcmp(level.m_any.data(), source, count) == 0 && std::memcmp(level.m_all.data(), source + count, count) == 0;
+		source += 2 * count;
+	}
+
+	if (!isValid)
+	{
+		Reset();
+	}
+
+	return isValid;
+}
+
+void DX::CollisionMask::CreateFromBytes(
+	const uint8_t* data,
+	uint32_t width,
+	uint32_t height,
+	uint32_t bytesPerTexel,
+	uint32_t alphaOffset
+	)
+{
+	Reset();
+
+	if (data == nullptr || width == 0 || height == 0)
+	{
+		return;
+	}
+
+	m_width = width;
+	m_height = height;
+	// Round up to a whole number of words per row. The padding bits are left as zero.
+	m_wordsPerRow = (width + 63) / 64;
+	m_bits.assign(static_cast<size_t>(m_wordsPerRow) * height, 0ULL);
+
+	auto alpha = data + alphaOffset;
+
+	for (uint32_t y = 0; y < height; ++y)
+	{
+		auto row = &m_bits[y * m_wordsPerRow];
+
+		for (uint32_t wordIndex = 0; wordIndex < m_wordsPerRow; ++wordIndex)
+		{
+			// Build each word in a register and then store it once.
+			auto firstX = wordIndex * 64;
+			auto lastX = (firstX + 64 < width) ? (firstX + 64) : width;
+			uint64_t word = 0ULL;
+
+			for (auto x = firstX; x < lastX; ++x)
+			{
+				word |= static_cast<uint64_t>(alpha[((y * width) + x) * bytesPerTexel] != 0) << (x - firstX);
+			}
+
+			row[wordIndex] = word;
+		}
+	}
+
+	// Build the coarse levels that the collision tests use to skip over empty (or fully opaque) regions.
+	CreateLevels();
+	CreateBounds();
+}
+
+void DX::CollisionMask::CreateBounds()
+{
+	uint32_t left = m_width;
+	uint32_t top = m_height;
+	uint32_t right = 0;
+	uint32_t bottom = 0;
+
+	for (uint32_t y = 0; y < m_height; ++y)
+	{
+		auto row = GetRow(y);
+
+		for (uint32_t word = 0; word < m_wordsPerRow; ++word)
+		{
+			if (row[word] != 0ULL)
+			{
+				auto first = (word * 64) + LowestSetBitIndex(row[word]);
+				auto last = (word * 64) + HighestSetBitIndex(row[word]);
+				left = (first < left) ? first : left;
+				right = (last + 1 > right) ? last + 1 : right;
+				top = (y < top) ? y : top;
+				bottom = y + 1;
+			}
+		}
+	}
+
+	if (right == 0)
+	{
+		// There are no opaque texels.
+		left = top = 0;
+	}
+
+	m_boundsLeft = left;
+	m_boundsTop = top;
+	m_boundsRight = right;
+	m_boundsBottom = bottom;
+}
+
+void DX::CollisionMask::CreateLevels()
+{
+	m_levels.resize(CoarseLevelCount);
+
+	// The previous level starts as the full resolution mask, where "any" and "all" are the same thing.
+	auto previousWidth = m_width;
+	auto previousHeight = m_height;
+	auto previousWordsPerRow = m_wordsPerRow;
+	const uint64_t* previousAny = m_bits.data();
+	const uint64_t* previousAll = m_bits.data();
+
+	std::vector<uint64_t> rowAny(m_wordsPerRow);
+	std::vector<uint64_t> rowAll(m_wordsPerRow);
+
+	for (auto& level : m_levels)
+	{
+		level.m_width = (previousWidth + 1) / 2;
+		level.m_height = (previousHeight + 1) / 2;
+		level.m_wordsPerRow = (level.m_width + 63) / 64;
+		level.m_any.assign(static_cast<size_t>(level.m_wordsPerRow) * level.m_height, 0ULL);
+		level.m_all.assign(static_cast<size_t>(level.m_wordsPerRow) * level.m_height, 0ULL);
+
+		for (uint32_t y = 0; y < level.m_height; ++y)
+		{
+			// Combine each pair of rows first. If the height is odd the last row pairs up with an implicit transparent row, so its blocks can
+			// still have "any" set but never "all".
+			auto rowOne = y * 2;
+			auto rowTwo = rowOne + 1;
+			for (uint32_t i = 0; i < previousWordsPerRow; ++i)
+			{
+				auto anyOne = previousAny[(rowOne * previousWordsPerRow) + i];
+				auto allOne = previousAll[(rowOne * previousWordsPerRow) + i];
+				auto anyTwo = (rowTwo < previousHeight) ? previousAny[(rowTwo * previousWordsPerRow) + i] : 0ULL;
+				auto allTwo = (rowTwo < previousHeight) ? previousAll[(rowTwo * previousWordsPerRow) + i] : 0ULL;
+				rowAny[i] = anyOne | anyTwo;
+				rowAll[i] = allOne & allTwo;
+			}
+
+			// Then combine each pair of columns. The padding bits past the width are zero, so a block that hangs off the right edge never has "all" set.
+			HalveRow(rowAny.data(), previousWordsPerRow, &level.m_any[y * level.m_wordsPerRow], true);
+			HalveRow(rowAll.data(), previousWordsPerRow, &level.m_all[y * level.m_wordsPerRow], false);
+		}
+
+		previousWidth = level.m_width;
+		previousHeight = level.m_height;
+		previousWordsPerRow = level.m_wordsPerRow;
+		previousAny = level.m_any.data();
+		previousAll = level.m_all.data();
+	}
+}
+
+bool DX::CollisionMask::MayContainOpaque(
+	uint32_t level,
+	int32_t left,
+	int32_t top,
+	int32_t right,
+	int32_t bottom
+	) const
+{
+	// Only the part of the rectangle that is inside of the mask can contain anything.
+	left = (left > 0) ? left : 0;
+	top = (top > 0) ? top : 0;
+	right = (right < static_cast<int32_t>(m_width)) ? right : static_cast<int32_t>(m_width);
+	bottom = (bottom < static_cast<int32_t>(m_height)) ? bottom : static_cast<int32_t>(m_height);
+
+	return TestRange(level, left, top, right, bottom, false);
+}
+
+bool DX::CollisionMask::IsAllOpaque(
+	uint32_t level,
+	int32_t left,
+	int32_t top,
+	int32_t right,
+	int32_t bottom
+	) const
+{
+	// Anything outside of the mask is transparent.
+	if (left < 0 || top < 0 || right > static_cast<int32_t>(m_width) || bottom > static_cast<int32_t>(m_height))
+	{
+		return false;
+	}
+
+	return TestRange(level, left, top, right, bottom, true);
+}
+
+bool DX::CollisionMask::TestRange(
+	uint32_t level,
+	int32_t left,
+	int32_t top,
+	int32_t right,
+	int32_t bottom,
+	bool testAll
+	) const
+{
+	if (m_bits.empty() || left >= right || top >= bottom)
+	{
+		return false;
+	}
+
+	if (level > CoarseLevelCount)
+	{
+		level = CoarseLevelCount;
+	}
+
+	// Convert the texel rectangle into the (inclusive) range of blocks that it touches at this level.
+	auto firstX = static_cast<uint32_t>(left) >> level;
+	auto lastX = static_cast<uint32_t>(right - 1) >> level;
+	auto firstY = static_cast<uint32_t>(top) >> level;
+	auto lastY = static_cast<uint32_t>(bottom - 1) >> level;
+
+	const uint64_t* bits = m_bits.data();
+	auto wordsPerRow = m_wordsPerRow;
+	if (level > 0)
+	{
+		auto& coarse = m_levels[level - 1];
+		bits = testAll ? coarse.m_all.data() : coarse.m_any.data();
+		wordsPerRow = coarse.m_wordsPerRow;
+	}
+
+	for (auto y = firstY; y <= lastY; ++y)
+	{
+		auto row = bits + (y * wordsPerRow);
+
+		for (auto word = firstX >> 6; word <= (lastX >> 6); ++word)
+		{
+			auto mask = RangeMask(word * 64, firstX, lastX);
+
+			if (testAll)
+			{
+				// A single clear bit means that at least one block isn't fully opaque.
+				if ((row[word] & mask) != mask)
+				{
+					return false;
+				}
+			}
+			else if ((row[word] & mask) != 0ULL)
+			{
+				return true;
+			}
+		}
+	}
+
+	// If we're testing "all" then every bit was set. If we're testing "any" then none were.
+	return testAll;
+}
@@ -0,0 +1,335 @@
+#pragma once
+
+// Portable (see README_PORTABLE.txt). CollisionMaskBuilder uses it to build .cmask files.
+#include <cstddef>
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+
+namespace DX
+{
+	// Returns the index of the lowest set bit in a non-zero 64-bit value.
+	// value - The value to scan. Must not be zero.
+	inline uint32_t LowestSetBitIndex(uint64_t value)
+	{
+#if defined(_MSC_VER) && defined(_M_X64)
+		unsigned long index;
+		_BitScanForward64(&index, value);
+		return static_cast<uint32_t>(index);
+#elif defined(_MSC_VER)
+		// _BitScanForward64 only exists on 64-bit targets so scan each half separately.
+		unsigned long index;
+		if (_BitScanForward(&index, static_cast<unsigned long>(value)))
+		{
+			return static_cast<uint32_t>(index);
+		}
+		_BitScanForward(&index, static_cast<unsigned long>(value >> 32));
+		return static_cast<uint32_t>(index) + 32;
+#else
+		return static_cast<uint32_t>(__builtin_ctzll(value));
+#endif
+	}
+
+	// Returns the index of the highest set bit in a non-zero 64-bit value.
+	// value - The value to scan. Must not be zero.
+	inline uint32_t HighestSetBitIndex(uint64_t value)
+	{
+#if defined(_MSC_VER) && defined(_M_X64)
+		unsigned long index;
+		_BitScanReverse64(&index, value);
+		return static_cast<uint32_t>(index);
+#elif defined(_MSC_VER)
+		// _BitScanReverse64 only exists on 64-bit targets so scan each half separately.
+		unsigned long index;
+		if (_BitScanReverse(&index, static_cast<unsigned long>(value >> 32)))
+		{
+			return static_cast<uint32_t>(index) + 32;
+		}
+		_BitScanReverse(&index, static_cast<unsigned long>(value));
+		return static_cast<uint32_t>(index);
+#else
+		return 63 - static_cast<uint32_t>(__builtin_clzll(value));
+#endif
+	}
+
+	// A 1-bit per texel collision mask. A set bit means that the texel has a non-zero alpha value (i.e. isn't transparent). Each row is stored
+	// as a run of 64-bit words where texel x of the row is bit (x % 64) of word (x / 64). Any bits past the width of the texture are always zero
+	// so whole words can be ANDed together without masking off the padding. Compared to the B8G8R8A8 data returned by GetTexture2DCollisionData
+	// and GetTexture2DCollisionDataNoRender this uses 1/32nd of the memory and lets the collision tests work on 64 texels at a time.
+	// The mask also keeps a small pyramid of coarse levels. Coarse level n has two bits for each (2^n x 2^n) block of texels: an "any opaque" bit
+	// and an "all opaque" bit. These let the collision tests reject (or accept) whole regions with a few block checks before looking at texels.
+	// Masks can be saved to and loaded from the .cmask format (see SaveToMemory) so that they can be built offline by the CollisionMaskBuilder tool
+	// rather than reading textures back from the GPU at load time.
+	class CollisionMask
+	{
+	public:
+		// The number of coarse levels stored above the full resolution mask (level 0). Levels 1, 2, and 3 have 2x2, 4x4, and 8x8 texel blocks.
+		static const uint32_t CoarseLevelCount = 3;
+
+		// Constructor. Creates an empty mask. Use CreateFromBGRA or CreateFromAlpha to fill it in.
+		CollisionMask();
+
+		// Move constructor.
+		CollisionMask(CollisionMask&& value) :
+			m_width(),
+			m_height(),
+			m_wordsPerRow(),
+			m_bits(),
+			m_levels(),
+			m_boundsLeft(),
+			m_boundsTop(),
+			m_boundsRight(),
+			m_boundsBottom()
+		{
+			// Invoke the move assignment operator.
+			*this = std::move(value);
+		}
+
+		// Move assignment operator.
+		CollisionMask& operator=(CollisionMask&& value)
+		{
+			if (this != &value)
+			{
+				m_width = value.m_width;
+				m_height = value.m_height;
+				m_wordsPerRow = value.m_wordsPerRow;
+				m_bits.swap(value.m_bits);
+				m_levels.swap(value.m_levels);
+				m_boundsLeft = value.m_boundsLeft;
+				m_boundsTop = value.m_boundsTop;
+				m_boundsRight = value.m_boundsRight;
+				m_boundsBottom = value.m_boundsBottom;
+			}
+
+			return *this;
+		}
+
+		// Builds the mask from B8G8R8A8 texel data such as the data returned by GetTexture2DCollisionData and GetTexture2DCollisionDataNoRender.
+		// Once the mask has been created the B8G8R8A8 data is no longer needed for collision detection and can be released.
+		// data - The texel data. Must contain width * height texels with no padding between rows.
+		// width - The width of the texture in texels.
+		// height - The height of the texture in texels.
+		void CreateFromBGRA(
+			const uint8_t* data,
+			uint32_t width,
+			uint32_t height
+			);
+
+		// Builds the mask from 8-bit alpha data (one byte per texel).
+		// data - The alpha data. Must contain width * height bytes with no padding between rows.
+		// width - The width of the texture in texels.
+		// height - The height of the texture in texels.
+		void CreateFromAlpha(
+			const uint8_t* data,
+			uint32_t width,
+			uint32_t height
+			);
+
+		// Writes the mask in the .cmask format. The format is a CollisionMaskFileHeader followed by the full resolution mask words and then the
+		// "any" and "all" words of each coarse level in order. Everything is little-endian and every array starts on an 8 byte boundary, so
+		// LoadFromMemory can copy each array out with a single memcpy.
+		// data - Receives the file data. Any existing contents are replaced.
+		void SaveToMemory(std::vector<uint8_t>& data) const;
+
+		// Reads a mask in the .cmask format, such as from a memory mapped file. The words are copied into the mask, so the data can be released
+		// afterwards. Returns false (and leaves the mask empty) if the data isn't a valid .cmask file. As well as the header and the size, this
+		// checks that the padding bits past the width are zero and that the coarse levels and the opaque bounds match the full resolution mask,
+		// since the collision tests rely on all three and would otherwise report hits (or misses) that aren't in the mask.
+		// data - The file data.
+		// size - The size of the file data in bytes.
+		bool LoadFromMemory(
+			const void* data,
+			size_t size
+			);
+
+		// Releases the mask data and returns the mask to its empty state.
+		void Reset();
+
+		// Returns true if the mask has no data.
+		bool IsEmpty() const { return m_bits.empty(); }
+
+		// Returns the width of the mask in texels.
+		uint32_t GetWidth() const { return m_width; }
+
+		// Returns the height of the mask in texels.
+		uint32_t GetHeight() const { return m_height; }
+
+		// Returns the number of 64-bit words that make up each row.
+		uint32_t GetWordsPerRow() const { return m_wordsPerRow; }
+
+		// Returns a pointer to the first word of row y. y must be less than the height.
+		const uint64_t* GetRow(uint32_t y) const { return &m_bits[y * m_wordsPerRow]; }
+
+		// Gets the smallest rectangle that contains every opaque or translucent texel. right and bottom are exclusive. If the mask has no opaque
+		// texels then the rectangle is (0, 0, 0, 0). This is useful for tightening the bounds that are given to a broad phase.
+		void GetOpaqueBounds(
+			uint32_t& left,
+			uint32_t& top,
+			uint32_t& right,
+			uint32_t& bottom
+			) const
+		{
+			left = m_boundsLeft;
+			top = m_boundsTop;
+			right = m_boundsRight;
+			bottom = m_boundsBottom;
+		}
+
+		// Returns the amount of memory, in bytes, used by the mask data.
+		size_t GetSizeInBytes() const { return m_bits.size() * sizeof(uint64_t); }
+
+		// Returns true if the texel at (x, y) is opaque or translucent. Coordinates outside of the mask are treated as transparent.
+		bool IsOpaque(int32_t x, int32_t y) const
+		{
+			if (x < 0 || y < 0 || static_cast<uint32_t>(x) >= m_width || static_cast<uint32_t>(y) >= m_height)
+			{
+				return false;
+			}
+
+			return ((m_bits[(y * m_wordsPerRow) + (x >> 6)] >> (x & 63)) & 1ULL) != 0;
+		}
+
+		// Returns 64 bits of row y starting at texel x, such that bit 0 of the result is texel x. Texels past the end of the row read as zero.
+		// y - The row. Must be less than the height.
+		// x - The first texel.
+		uint64_t GetRowBits(uint32_t y, uint32_t x) const
+		{
+			auto row = GetRow(y);
+			auto word = x >> 6;
+			auto shift = x & 63;
+
+			uint64_t bits = (word < m_wordsPerRow) ? (row[word] >> shift) : 0ULL;
+			if (shift != 0 && (word + 1) < m_wordsPerRow)
+			{
+				bits |= row[word + 1] << (64 - shift);
+			}
+
+			return bits;
+		}
+
+		// Returns false if there are definitely no opaque or translucent texels in the rectangle [left, right) x [top, bottom). The test is done with
+		// the blocks of the specified level so it can return true when the only opaque texels are in a block that the rectangle only partially covers.
+		// Level 0 is exact. Parts of the rectangle that are outside of the mask are ignored.
+		// level - The level to test with, from 0 to CoarseLevelCount.
+		// left, top, right, bottom - The rectangle in texels. right and bottom are exclusive.
+		bool MayContainOpaque(
+			uint32_t level,
+			int32_t left,
+			int32_t top,
+			int32_t right,
+			int32_t bottom
+			) const;
+
+		// Returns true if every texel in the rectangle [left, right) x [top, bottom) is definitely opaque or translucent. The test is done with the
+		// blocks of the specified level so it can return false when the rectangle only partially covers a block that has transparent texels.
+		// Level 0 is exact. Returns false if the rectangle is empty or extends outside of the mask.
+		// level - The level to test with, from 0 to CoarseLevelCount.
+		// left, top, right, bottom - The rectangle in texels. right and bottom are exclusive.
+		bool IsAllOpaque(
+			uint32_t level,
+			int32_t left,
+			int32_t top,
+			int32_t right,
+			int32_t bottom
+			) const;
+
+	private:
+		// A coarse level of the mask pyramid. Uses the same row layout as the full resolution mask with one bit per block.
+		struct Level
+		{
+			// The width of the level in blocks.
+			uint32_t				m_width;
+			// The height of the level in blocks.
+			uint32_t				m_height;
+			// The number of 64-bit words in each row.
+			uint32_t				m_wordsPerRow;
+			// A set bit means that at least one texel in the block is opaque or translucent.
+			std::vector<uint64_t>	m_any;
+			// A set bit means that every texel in the block is opaque or translucent. Blocks that hang off the edge of the mask are never set.
+			std::vector<uint64_t>	m_all;
+		};
+
+		// Disable copy constructor.
+		CollisionMask(const CollisionMask&);
+		// Disable copy assignment.
+		CollisionMask& operator=(const CollisionMask&);
+
+		// Shared implementation of CreateFromBGRA and CreateFromAlpha.
+		void CreateFromBytes(
+			const uint8_t* data,
+			uint32_t width,
+			uint32_t height,
+			uint32_t bytesPerTexel,
+			uint32_t alphaOffset
+			);
+
+		// Builds the coarse levels from the full resolution mask.
+		void CreateLevels();
+
+		// Finds the opaque bounds from the full resolution mask.
+		void CreateBounds();
+
+		// Shared implementation of MayContainOpaque and IsAllOpaque. Tests whether any (or all) of the bits in the rectangle are set.
+		bool TestRange(
+			uint32_t level,
+			int32_t left,
+			int32_t top,
+			int32_t right,
+			int32_t bottom,
+			bool testAll
+			) const;
+
+		// The width of the mask in texels.
+		uint32_t				m_width;
+
+		// The height of the mask in texels.
+		uint32_t				m_height;
+
+		// The number of 64-bit words in each row.
+		uint32_t				m_wordsPerRow;
+
+		// The mask bits, stored row after row.
+		std::vector<uint64_t>	m_bits;
+
+		// The coarse levels. m_levels[0] is level 1 (2x2 blocks).
+		std::vector<Level>		m_levels;
+
+		// The bounds of the opaque texels. See GetOpaqueBounds.
+		uint32_t				m_boundsLeft;
+		uint32_t				m_boundsTop;
+		uint32_t				m_boundsRight;
+		uint32_t				m_boundsBottom;
+	};
+
+	// The header at the start of a .cmask file.
+	struct CollisionMaskFileHeader
+	{
+		// Must be CollisionMaskFileMagic.
+		uint32_t				m_magic;
+		// Must be CollisionMaskFileVersion.
+		uint32_t				m_version;
+		// The width of the mask in texels.
+		uint32_t				m_width;
+		// The height of the mask in texels.
+		uint32_t				m_height;
+		// The number of coarse levels that follow the full resolution mask. Must be CollisionMask::CoarseLevelCount.
+		uint32_t				m_levelCount;
+		// Reserved. Must be zero.
+		uint32_t				m_reserved;
+		// The opaque bounds. See CollisionMask::GetOpaqueBounds.
+		uint32_t				m_boundsLeft;
+		uint32_t				m_boundsTop;
+		uint32_t				m_boundsRight;
+		uint32_t				m_boundsBottom;
+	};
+
+	// The first four bytes of a .cmask file ("CMSK").
+	const uint32_t CollisionMaskFileMagic = 0x4B534D43;
+
+	// The version of the .cmask format that this code reads and writes.
+	const uint32_t CollisionMaskFileVersion = 1;
+}
@@ -0,0 +1,594 @@
+#include "CollisionPolygons.h"
+
+#include <cmath>
+#include <unordered_map>
+
+namespace
+{
+	// Outline points lie on a grid of half texels so they are stored with doubled (and offset, to keep them positive) coordinates while tracing.
+	// This is the offset that is added to the doubled coordinates.
+	const int32_t TraceOffset = 2;
+
+	// Packs a doubled outline point into a key.
+	inline uint64_t PackTracePoint(
+		int32_t doubledX,
+		int32_t doubledY
+		)
+	{
+		return (static_cast<uint64_t>(doubledX + TraceOffset) << 32) | static_cast<uint64_t>(doubledY + TraceOffset);
+	}
+
+	// Unpacks a key made by PackTracePoint into a vertex in texel coordinates.
+	inline DX::PolygonVertex UnpackTracePoint(uint64_t key)
+	{
+		DX::PolygonVertex vertex;
+		vertex.x = static_cast<float>(static_cast<int32_t>(key >> 32) - TraceOffset) * 0.5f;
+		vertex.y = static_cast<float>(static_cast<int32_t>(key & 0xFFFFFFFFULL) - TraceOffset) * 0.5f;
+		return vertex;
+	}
+
+	// Returns the z component of the cross product of (b - a) and (c - b). Positive if a, b, c turn counter-clockwise (in a y up coordinate system).
+	inline float Cross(
+		const DX::PolygonVertex& a,
+		const DX::PolygonVertex& b,
+		const DX::PolygonVertex& c
+		)
+	{
+		return ((b.x - a.x) * (c.y - b.y)) - ((b.y - a.y) * (c.x - b.x));
+	}
+
+	// Returns twice the signed area of a polygon. Positive if it is wound counter-clockwise (in a y up coordinate system).
+	float GetDoubleSignedArea(const std::vector<DX::PolygonVertex>& polygon)
+	{
+		float area = 0.0f;
+		for (size_t i = 0, j = polygon.size() - 1; i < polygon.size(); j = i++)
+		{
+			area += (polygon[j].x * polygon[i].y) - (polygon[i].x * polygon[j].y);
+		}
+		return area;
+	}
+
+	// Traces the outlines of the opaque regions of a mask with marching squares. Each cell of the march has the centers of four texels as its
+	// corners, and the cells cover a border of transparent texels around the mask so that every outline is closed. Walking around a cell's corners
+	// (top left, top right, bottom right, bottom left), the outline leaves the cell where the walk goes from an opaque corner to a transparent one and
+	// enters where it goes from transparent to opaque. Each exit is joined to the next entry, which keeps the opaque region on the same side of every
+	// segment (so outer outlines have a positive area and holes a negative one) and joins diagonally touching texels into one region.
+	// mask - The mask to trace.
+	// outlines - Receives the outlines.
+	void TraceOutlines(
+		const DX::CollisionMask& mask,
+		std::vector<std::vector<DX::PolygonVertex>>& outlines
+		)
+	{
+		auto width = static_cast<int32_t>(mask.GetWidth());
+		auto height = static_cast<int32_t>(mask.GetHeight());
+
+		// Every outline point starts exactly one segment and ends exactly one segment, so the segments can be stored as a map from start to end.
+		std::unordered_map<uint64_t, uint64_t> segments;
+
+		for (int32_t cellY = -1; cellY < height; cellY++)
+		{
+			for (int32_t cellX = -1; cellX < width; cellX++)
+			{
+				bool corners[4] =
+				{
+					mask.IsOpaque(cellX, cellY),
+					mask.IsOpaque(cellX + 1, cellY),
+					mask.IsOpaque(cellX + 1, cellY + 1),
+					mask.IsOpaque(cellX, cellY + 1)
+				};
+
+				if (corners[0] == corners[1] && corners[1] == corners[2] && corners[2] == corners[3])
+				{
+					continue;
+				}
+
+				// The crossing points on the top, right, bottom, and left edges, in doubled coordinates.
+				uint64_t crossings[4] =
+				{
+					PackTracePoint((cellX * 2) + 1, cellY * 2),
+					PackTracePoint((cellX * 2) + 2, (cellY * 2) + 1),
+					PackTracePoint((cellX * 2) + 1, (cellY * 2) + 2),
+					PackTracePoint(cellX * 2, (cellY * 2) + 1)
+				};
+
+				for (int edge = 0; edge < 4; edge++)
+				{
+					if (!corners[edge] || corners[(edge + 1) % 4])
+					{
+						continue;
+					}
+
+					// This edge is an exit. Find the next entry.
+					for (int next = 1; next < 4; next++)
+					{
+						auto entry = (edge + next) % 4;
+						if (!corners[entry] && corners[(entry + 1) % 4])
+						{
+							segments[crossings[edge]] = crossings[entry];
+							break;
+						}
+					}
+				}
+			}
+		}
+
+		// Follow the segments around each loop, removing them as we go.
+		while (!segments.empty())
+		{
+			std::vector<DX::PolygonVertex> outline;
+			auto start = segments.begin()->first;
+			auto point = start;
+			do
+			{
+				auto segment = segments.find(point);
+				if (segment == segments.end())
+				{
+					break;
+				}
+				outline.push_back(UnpackTracePoint(point));
+				point = segment->second;
+				segments.erase(segment);
+			}
+			while (point != start);
+
+			if (outline.size() >= 3)
+			{
+				outlines.push_back(std::move(outline));
+			}
+		}
+	}
+
+	// Returns the squared distance from a point to the segment from a to b.
+	float GetSquaredDistanceToSegment(
+		const DX::PolygonVertex& point,
+		const DX::PolygonVertex& a,
+		const DX::PolygonVertex& b
+		)
+	{
+		auto abX = b.x - a.x;
+		auto abY = b.y - a.y;
+		auto apX = point.x - a.x;
+		auto apY = point.y - a.y;
+		auto lengthSquared = (abX * abX) + (abY * abY);
+		auto t = (lengthSquared > 0.0f) ? ((apX * abX) + (apY * abY)) / lengthSquared : 0.0f;
+		t = (t < 0.0f) ? 0.0f : ((t > 1.0f) ? 1.0f : t);
+		auto dX = apX - (abX * t);
+		auto dY = apY - (abY * t);
+		return (dX * dX) + (dY * dY);
+	}
+
+	// Simplifies a closed outline with the Douglas-Peucker algorithm. The outline is split into two chains at its first vertex and the vertex
+	// furthest from it, and then each chain is recursively split at its vertex that is furthest from the chain's end to end segment until every
+	// vertex is within the tolerance. An explicit stack is used since outlines can have many thousands of vertices.
+	// outline - The outline to simplify.
+	// tolerance - The largest distance that a removed vertex may be from the simplified outline.
+	// simplified - Receives the simplified outline.
+	void SimplifyOutline(
+		const std::vector<DX::PolygonVertex>& outline,
+		float tolerance,
+		std::vector<DX::PolygonVertex>& simplified
+		)
+	{
+		simplified.clear();
+
+		auto count = outline.size();
+		size_t furthest = 0;
+		float furthestDistance = -1.0f;
+		for (size_t i = 1; i < count; i++)
+		{
+			auto dX = outline[i].x - outline[0].x;
+			auto dY = outline[i].y - outline[0].y;
+			auto distance = (dX * dX) + (dY * dY);
+			if (distance > furthestDistance)
+			{
+				furthest = i;
+				furthestDistance = distance;
+			}
+		}
+
+		std::vector<bool> keep(count, false);
+		keep[0] = true;
+		keep[furthest] = true;
+
+		// Chains are (first, last) pairs of indices. An index of count means vertex 0 (the end of the second chain).
+		auto toleranceSquared = tolerance * tolerance;
+		std::vector<std::pair<size_t, size_t>> chains;
+		chains.push_back(std::make_pair(static_cast<size_t>(0), furthest));
+		chains.push_back(std::make_pair(furthest, count));
+		while (!chains.empty())
+		{
+			auto chain = chains.back();
+			chains.pop_back();
+
+			const auto& a = outline[chain.first];
+			const auto& b = outline[chain.second % count];
+			size_t split = 0;
+			float splitDistance = toleranceSquared;
+			for (auto i = chain.first + 1; i < chain.second; i++)
+			{
+				auto distance = GetSquaredDistanceToSegment(outline[i], a, b);
+				if (distance > splitDistance)
+				{
+					split = i;
+					splitDistance = distance;
+				}
+			}
+
+			if (split != 0)
+			{
+				keep[split] = true;
+				chains.push_back(std::make_pair(chain.first, split));
+				chains.push_back(std::make_pair(split, chain.second));
+			}
+		}
+
+		for (size_t i = 0; i < count; i++)
+		{
+			if (keep[i])
+			{
+				simplified.push_back(outline[i]);
+			}
+		}
+	}
+
+	// Returns true if a point is inside of (or on the edge of) a counter-clockwise triangle.
+	inline bool IsInTriangle(
+		const DX::PolygonVertex& point,
+		const DX::PolygonVertex& a,
+		const DX::PolygonVertex& b,
+		const DX::PolygonVertex& c
+		)
+	{
+		return Cross(a, b, point) >= 0.0f && Cross(b, c, point) >= 0.0f && Cross(c, a, point) >= 0.0f;
+	}
+
+	// Splits a simple counter-clockwise polygon into triangles by ear clipping. A vertex is an ear if it is convex and no reflex vertex lies in the
+	// triangle it makes with its neighbors, in which case the triangle can be cut off. Collinear vertices are dropped without making a triangle.
+	// If the simplification has made the polygon self-intersecting and no ear can be found, the first convex vertex is clipped anyway.
+	// polygon - The polygon.
+	// triangles - Receives the triangles as triples of indices into the polygon.
+	void Triangulate(
+		const std::vector<DX::PolygonVertex>& polygon,
+		std::vector<uint32_t>& triangles
+		)
+	{
+		std::vector<uint32_t> remaining;
+		for (uint32_t i = 0; i < static_cast<uint32_t>(polygon.size()); i++)
+		{
+			remaining.push_back(i);
+		}
+
+		while (remaining.size() >= 3)
+		{
+			auto count = remaining.size();
+			size_t ear = count;
+			size_t fallback = count;
+
+			for (size_t i = 0; i < count; i++)
+			{
+				const auto& previous = polygon[remaining[(i + count - 1) % count]];
+				const auto& current = polygon[remaining[i]];
+				const auto& next = polygon[remaining[(i + 1) % count]];
+				auto turn = Cross(previous, current, next);
+
+				// Drop collinear vertices straight away.
+				if (turn == 0.0f)
+				{
+					ear = i;
+					break;
+				}
+
+				if (turn < 0.0f)
+				{
+					continue;
+				}
+
+				if (fallback == count)
+				{
+					fallback = i;
+				}
+
+				bool isEar = true;
+				for (size_t j = 0; j < count && isEar; j++)
+				{
+					if (j == i || j == (i + 1) % count || j == (i + count - 1) % count)
+					{
+						continue;
+					}
+
+					const auto& other = polygon[remaining[j]];
+					const auto& otherPrevious = polygon[remaining[(j + count - 1) % count]];
+					const auto& otherNext = polygon[remaining[(j + 1) % count]];
+					if (Cross(otherPrevious, other, otherNext) <= 0.0f && IsInTriangle(other, previous, current, next))
+					{
+						isEar = false;
+					}
+				}
+
+				if (isEar)
+				{
+					ear = i;
+					break;
+				}
+			}
+
+			if (ear == count)
+			{
+				if (fallback == count)
+				{
+					// Nothing is convex so what is left has no area.
+					break;
+				}
+				ear = fallback;
+			}
+
+			const auto& previous = polygon[remaining[(ear + count - 1) % count]];
+			const auto& next = polygon[remaining[(ear + 1) % count]];
+			if (Cross(previous, polygon[remaining[ear]], next) > 0.0f)
+			{
+				triangles.push_back(remaining[(ear + count - 1) % count]);
+				triangles.push_back(remaining[ear]);
+				triangles.push_back(remaining[(ear + 1) % count]);
+			}
+			remaining.erase(remaining.begin() + ear);
+		}
+	}
+
+	// Returns true if every vertex of a polygon (given as indices) turns counter-clockwise or goes straight on.
+	bool IsConvex(
+		const std::vector<DX::PolygonVertex>& polygon,
+		const std::vector<uint32_t>& piece
+		)
+	{
+		auto count = piece.size();
+		for (size_t i = 0; i < count; i++)
+		{
+			if (Cross(polygon[piece[(i + count - 1) % count]], polygon[piece[i]], polygon[piece[(i + 1) % count]]) < 0.0f)
+			{
+				return false;
+			}
+		}
+		return true;
+	}
+
+	// Merges the triangles from Triangulate into convex pieces with the Hertel-Mehlhorn algorithm: each diagonal (an edge shared by two pieces) is
+	// removed if the piece it leaves behind is still convex and has no more than CollisionPolygons::MaxPieceVertices vertices.
+	// polygon - The polygon that was triangulated.
+	// triangles - The triangles from Triangulate.
+	// pieces - Receives the convex pieces as lists of indices into the polygon.
+	void MergeTriangles(
+		const std::vector<DX::PolygonVertex>& polygon,
+		const std::vector<uint32_t>& triangles,
+		std::vector<std::vector<uint32_t>>& pieces
+		)
+	{
+		pieces.clear();
+		for (size_t i = 0; i + 2 < triangles.size(); i += 3)
+		{
+			std::vector<uint32_t> triangle(&triangles[i], &triangles[i] + 3);
+			pieces.push_back(std::move(triangle));
+		}
+
+		// Maps each directed edge (start << 32 | end) to the piece that has it.
+		std::unordered_map<uint64_t, size_t> edges;
+		for (size_t piece = 0; piece < pieces.size(); piece++)
+		{
+			for (size_t i = 0; i < pieces[piece].size(); i++)
+			{
+				edges[(static_cast<uint64_t>(pieces[piece][i]) << 32) | pieces[piece][(i + 1) % pieces[piece].size()]] = piece;
+			}
+		}
+
+		for (size_t piece = 0; piece < pieces.size(); piece++)
+		{
+			// Keep trying the edges of this piece until none of them can be removed. Pieces that have been merged away are left empty.
+			bool merged = true;
+			while (merged && !pieces[piece].empty())
+			{
+				merged = false;
+				auto& current = pieces[piece];
+				for (size_t i = 0; i < current.size() && !merged; i++)
+				{
+					auto a = current[i];
+					auto b = current[(i + 1) % current.size()];
+					auto neighbor = edges.find((static_cast<uint64_t>(b) << 32) | a);
+					if (neighbor == edges.end() || neighbor->second == piece)
+					{
+						continue;
+					}
+
+					// The merged piece goes from b around the current piece to a, and then from a around the neighbor back to b.
+					auto& other = pieces[neighbor->second];
+					std::vector<uint32_t> candidate;
+					for (size_t j = 0; j < current.size(); j++)
+					{
+						candidate.push_back(current[(i + 1 + j) % current.size()]);
+					}
+					size_t otherA = 0;
+					while (other[otherA] != a)
+					{
+						otherA++;
+					}
+					for (size_t j = 1; j + 1 < other.size(); j++)
+					{
+						candidate.push_back(other[(otherA + j) % other.size()]);
+					}
+
+					if (candidate.size() > DX::CollisionPolygons::MaxPieceVertices || !IsConvex(polygon, candidate))
+					{
+						continue;
+					}
+
+					edges.erase((static_cast<uint64_t>(a) << 32) | b);
+					edges.erase((static_cast<uint64_t>(b) << 32) | a);
+					for (size_t j = 0; j < candidate.size(); j++)
+					{
+						edges[(static_cast<uint64_t>(candidate[j]) << 32) | candidate[(j + 1) % candidate.size()]] = piece;
+					}
+					other.clear();
+					current.swap(candidate);
+					merged = true;
+				}
+			}
+		}
+	}
+
+	// Returns true if the projections of two polygons onto the normals of the first polygon's edges are separated on any of them.
+	bool HasSeparatingEdge(
+		const DX::PolygonVertex* first,
+		uint32_t firstCount,
+		const DX::PolygonVertex* second,
+		uint32_t secondCount
+		)
+	{
+		for (uint32_t i = 0, j = firstCount - 1; i < firstCount; j = i++)
+		{
+			auto axisX = first[j].y - first[i].y;
+			auto axisY = first[i].x - first[j].x;
+
+			auto firstMin = (first[0].x * axisX) + (first[0].y * axisY);
+			auto firstMax = firstMin;
+			for (uint32_t k = 1; k < firstCount; k++)
+			{
+				auto projection = (first[k].x * axisX) + (first[k].y * axisY);
+				firstMin = (projection < firstMin) ? projection : firstMin;
+				firstMax = (projection > firstMax) ? projection : firstMax;
+			}
+
+			auto secondMin = (second[0].x * axisX) + (second[0].y * axisY);
+			auto secondMax = secondMin;
+			for (uint32_t k = 1; k < secondCount; k++)
+			{
+				auto projection = (second[k].x * axisX) + (second[k].y * axisY);
+				secondMin = (projection < secondMin) ? projection : secondMin;
+				secondMax = (projection > secondMax) ? projection : secondMax;
+			}
+
+			if (firstMax < secondMin || secondMax < firstMin)
+			{
+				return true;
+			}
+		}
+
+		return false;
+	}
+}
+
+DX::CollisionPolygons::CollisionPolygons() :
+	m_width(),
+	m_height(),
+	m_vertices(),
+	m_pieces()
+{
+}
+
+void DX::CollisionPolygons::CreateFromMask(
+	const CollisionMask& mask,
+	float tolerance,
+	float minimumArea
+	)
+{
+	Reset();
+	m_width = mask.GetWidth();
+	m_height = mask.GetHeight();
+
+	if (mask.IsEmpty())
+	{
+		return;
+	}
+
+	std::vector<std::vector<PolygonVertex>> outlines;
+	TraceOutlines(mask, outlines);
+
+	std::vector<PolygonVertex> simplified;
+	std::vector<uint32_t> triangles;
+	std::vector<std::vector<uint32_t>> pieces;
+	std::vector<PolygonVertex> pieceVertices;
+	for (const auto& outline : outlines)
+	{
+		// Holes (negative area) are filled in by skipping them.
+		auto area = GetDoubleSignedArea(outline) * 0.5f;
+		if (area <= 0.0f || area < minimumArea)
+		{
+			continue;
+		}
+
+		SimplifyOutline(outline, tolerance, simplified);
+		if (simplified.size() < 3 || GetDoubleSignedArea(simplified) <= 0.0f)
+		{
+			continue;
+		}
+
+		triangles.clear();
+		Triangulate(simplified, triangles);
+		MergeTriangles(simplified, triangles, pieces);
+
+		for (const auto& piece : pieces)
+		{
+			if (piece.empty())
+			{
+				continue;
+			}
+
+			// Drop any vertices that go straight on since they don't add anything to the separating axis tests.
+			pieceVertices.clear();
+			auto count = piece.size();
+			for (size_t i = 0; i < count; i++)
+			{
+				if (Cross(simplified[piece[(i + count - 1) % count]], simplified[piece[i]], simplified[piece[(i + 1) % count]]) != 0.0f)
+				{
+					pieceVertices.push_back(simplified[piece[i]]);
+				}
+			}
+
+			if (pieceVertices.size() >= 3)
+			{
+				AddPiece(pieceVertices);
+			}
+		}
+	}
+}
+
+void DX::CollisionPolygons::Reset()
+{
+	m_width = 0;
+	m_height = 0;
+	m_vertices.clear();
+	m_pieces.clear();
+}
+
+void DX::CollisionPolygons::AddPiece(const std::vector<PolygonVertex>& vertices)
+{
+	Piece piece;
+	piece.m_firstVertex = static_cast<uint32_t>(m_vertices.size());
+	piece.m_vertexCount = static_cast<uint32_t>(vertices.size());
+	piece.m_left = piece.m_right = vertices[0].x;
+	piece.m_top = piece.m_bottom = vertices[0].y;
+
+	for (const auto& vertex : vertices)
+	{
+		piece.m_left = (vertex.x < piece.m_left) ? vertex.x : piece.m_left;
+		piece.m_right = (vertex.x > piece.m_right) ? vertex.x : piece.m_right;
+		piece.m_top = (vertex.y < piece.m_top) ? vertex.y : piece.m_top;
+		piece.m_bottom = (vertex.y > piece.m_bottom) ? vertex.y : piece.m_bottom;
+		m_vertices.push_back(vertex);
+	}
+
+	m_pieces.push_back(piece);
+}
+
+bool DX::IsConvexPolygonOverlap(
+	const PolygonVertex* first,
+	uint32_t firstCount,
+	const PolygonVertex* second,
+	uint32_t secondCount
+	)
+{
+	if (firstCount == 0 || secondCount == 0)
+	{
+		return false;
+	}
+
+	return !HasSeparatingEdge(first, firstCount, second, secondCount) && !HasSeparatingEdge(second, secondCount, first, firstCount);
+}
@@ -0,0 +1,153 @@
+#pragma once
+
+// Portable (see README_PORTABLE.txt). Depends on CollisionMask, whose masks it traces.
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+#include "CollisionMask.h"
+
+namespace DX
+{
+	// A vertex of a collision polygon in the sprite's local space (texels). Texel (x, y) is centered on (x, y), the same as for the pixel perfect tests.
+	struct PolygonVertex
+	{
+		float					x;
+		float					y;
+	};
+
+	// An approximation of a sprite's opaque area as a set of convex polygons. Testing a few convex polygons against each other with the separating
+	// axis theorem is far cheaper than a pixel perfect test, so the polygons make a good narrow phase in their own right, with the pixel perfect test
+	// kept as an optional final refinement (see IsTransformedPolygonCollision in CollisionDetection2D.h).
+	// The polygons are built from a CollisionMask in three steps:
+	// 1. Marching squares traces the outline of each opaque region. The outline passes halfway between opaque and transparent texel centers,
+	//    which follows the edges of the texels except at corners, where it cuts across each corner texel (up to a quarter of a texel's diagonal
+	//    inside of its corner). Texels that only touch diagonally are part of the same region, the same as the pixel perfect tests treat them.
+	// 2. Douglas-Peucker simplification removes every outline vertex that is within the tolerance of the simplified outline. A region that
+	//    simplifies to less than a triangle (one that is no more than about twice the tolerance across, such as a single texel when the tolerance
+	//    is 0.5) is dropped.
+	// 3. Ear clipping splits each simplified outline into triangles and then Hertel-Mehlhorn merges triangles back together wherever the result is
+	//    still convex (and no more than MaxPieceVertices vertices), which gives no more than four times the minimum number of convex pieces when
+	//    that limit isn't reached.
+	// Holes in the opaque regions are filled in, so sprites with holes can report collisions in the hole that the pixel perfect test wouldn't. Use
+	// the pixel perfect test as the refinement for those sprites. Build the polygons once at load time; they don't change with the sprite's transform.
+	class CollisionPolygons
+	{
+	public:
+		// The largest number of vertices that a piece can have. Merges that would make a bigger piece are skipped, which keeps pieces small enough
+		// for the collision tests to transform them into a fixed size buffer on the stack.
+		static const uint32_t MaxPieceVertices = 16;
+
+		// A convex piece. Its vertices are stored counter-clockwise (in a y up coordinate system; clockwise on screen) in GetVertices.
+		struct Piece
+		{
+			// The index of the piece's first vertex.
+			uint32_t				m_firstVertex;
+			// The number of vertices in the piece.
+			uint32_t				m_vertexCount;
+			// The bounding rectangle of the piece.
+			float					m_left;
+			float					m_top;
+			float					m_right;
+			float					m_bottom;
+		};
+
+		// Constructor. Creates an empty set of polygons. Use CreateFromMask to fill it in.
+		CollisionPolygons();
+
+		// Move constructor.
+		CollisionPolygons(CollisionPolygons&& value) :
+			m_width(),
+			m_height(),
+			m_vertices(),
+			m_pieces()
+		{
+			// Invoke the move assignment operator.
+			*this = std::move(value);
+		}
+
+		// Move assignment operator.
+		CollisionPolygons& operator=(CollisionPolygons&& value)
+		{
+			if (this != &value)
+			{
+				m_width = value.m_width;
+				m_height = value.m_height;
+				m_vertices.swap(value.m_vertices);
+				m_pieces.swap(value.m_pieces);
+			}
+
+			return *this;
+		}
+
+		// Builds the polygons from a collision mask.
+		// mask - The collision mask of the sprite.
+		// tolerance - How far (in texels) the simplified outline may stray from the traced outline. Larger values give fewer vertices and pieces.
+		// minimumArea - Opaque regions whose traced outlines enclose less than this area (in square texels) are dropped. Use this to ignore specks.
+		void CreateFromMask(
+			const CollisionMask& mask,
+			float tolerance = 1.0f,
+			float minimumArea = 0.0f
+			);
+
+		// Removes every piece.
+		void Reset();
+
+		// Returns true if there are no pieces (the mask was completely transparent or the polygons haven't been created).
+		bool IsEmpty() const { return m_pieces.empty(); }
+
+		// Returns the width of the mask that the polygons were built from, in texels.
+		uint32_t GetWidth() const { return m_width; }
+
+		// Returns the height of the mask that the polygons were built from, in texels.
+		uint32_t GetHeight() const { return m_height; }
+
+		// Returns the number of convex pieces.
+		uint32_t GetPieceCount() const { return static_cast<uint32_t>(m_pieces.size()); }
+
+		// Returns a convex piece.
+		// index - The index of the piece. Must be less than GetPieceCount.
+		const Piece& GetPiece(uint32_t index) const { return m_pieces[index]; }
+
+		// Returns the number of vertices in all of the pieces.
+		uint32_t GetVertexCount() const { return static_cast<uint32_t>(m_vertices.size()); }
+
+		// Returns the vertices of all of the pieces. Each piece's vertices are the range given by its m_firstVertex and m_vertexCount.
+		const PolygonVertex* GetVertices() const { return m_vertices.empty() ? nullptr : &m_vertices[0]; }
+
+	private:
+		// Disable copy constructor.
+		CollisionPolygons(const CollisionPolygons&);
+		// Disable copy assignment.
+		CollisionPolygons& operator=(const CollisionPolygons&);
+
+		// Adds a convex piece and works out its bounding rectangle.
+		void AddPiece(const std::vector<PolygonVertex>& vertices);
+
+		// The width of the mask in texels.
+		uint32_t					m_width;
+
+		// The height of the mask in texels.
+		uint32_t					m_height;
+
+		// The vertices of every piece, piece after piece.
+		std::vector<PolygonVertex>	m_vertices;
+
+		// The convex pieces.
+		std::vector<Piece>			m_pieces;
+	};
+
+	// Tests two convex polygons for overlap with the separating axis theorem. Each edge normal of both polygons is tried as an axis and the polygons
+	// overlap if their projections onto every axis overlap. The polygons may be wound either way but must be in the same coordinate space.
+	// first - The vertices of the first polygon.
+	// firstCount - The number of vertices in the first polygon.
+	// second - The vertices of the second polygon.
+	// secondCount - The number of vertices in the second polygon.
+	// Returns true if the polygons overlap (or touch), false if not.
+	bool IsConvexPolygonOverlap(
+		const PolygonVertex* first,
+		uint32_t firstCount,
+		const PolygonVertex* second,
+		uint32_t secondCount
+		);
+}
@@ -0,0 +1,113 @@
+#include "pch.h"
+#include "CollisionWorld.h"
+#include "CollisionDetection2D.h"
+
+#include <ppl.h>
+
+using namespace DirectX;
+
+namespace
+{
+	// Batches with no more than this many groups of 64 pairs are tested on the calling thread since the cost of scheduling the work would
+	// be larger than the cost of the tests.
+	const uint32 SerialGroupCount = 1;
+}
+
+DX::CollisionWorld::CollisionWorld() :
+	m_bodies(),
+	m_freeBodies()
+{
+}
+
+uint32 DX::CollisionWorld::AddBody(const CollisionMask& mask)
+{
+	uint32 id;
+	if (!m_freeBodies.empty())
+	{
+		id = m_freeBodies.back();
+		m_freeBodies.pop_back();
+	}
+	else
+	{
+		id = static_cast<uint32>(m_bodies.size());
+		m_bodies.push_back(Body());
+	}
+
+	auto& body = m_bodies[id];
+	body.m_mask = &mask;
+	XMStoreFloat4x4(&body.m_worldTransform, XMMatrixIdentity());
+
+	return id;
+}
+
+void DX::CollisionWorld::RemoveBody(uint32 id)
+{
+	m_bodies[id].m_mask = nullptr;
+	m_freeBodies.push_back(id);
+}
+
+void DX::CollisionWorld::SetTransform(
+	uint32 id,
+	CXMMATRIX worldTransform
+	)
+{
+	XMStoreFloat4x4(&m_bodies[id].m_worldTransform, worldTransform);
+}
+
+void DX::CollisionWorld::QueryPairs(
+	_In_reads_(pairCount) const CollisionPair* pairs,
+	uint32 pairCount,
+	std::vector<uint64>& hits
+	) const
+{
+	// Each group of 64 pairs fills in one word of the bitset, so no two groups ever write to the same word and no locking is needed.
+	auto groupCount = (pairCount + 63) / 64;
+	hits.assign(groupCount, 0ULL);
+
+	if (groupCount <= SerialGroupCount)
+	{
+		for (uint32 group = 0; group < groupCount; group++)
+		{
+			hits[group] = QueryPairGroup(pairs + (group * 64), min(64U, pairCount - (group * 64)));
+		}
+		return;
+	}
+
+	// The Concurrency Runtime divides the range between its worker threads and idle workers steal groups from busy ones, which keeps every core
+	// busy even though some pairs (e.g. large sprites that overlap a lot) take much longer to test than others.
+	auto hitsData = &hits[0];
+	concurrency::parallel_for(0U, groupCount, [this, pairs, pairCount, hitsData](uint32 group)
+	{
+		hitsData[group] = QueryPairGroup(pairs + (group * 64), min(64U, pairCount - (group * 64)));
+	});
+}
+
+uint64 DX::CollisionWorld::QueryPairGroup(
+	_In_reads_(pairCount) const CollisionPair* pairs,
+	uint32 pairCount
+	) const
+{
+	uint64 bits = 0ULL;
+
+	for (uint32 i = 0; i < pairCount; i++)
+	{
+		auto& bodyOne = m_bodies[pairs[i].m_first];
+		auto& bodyTwo = m_bodies[pairs[i].m_second];
+
+		// Pairs that refer to removed bodies never collide.
+		if (bodyOne.m_mask == nullptr || bodyTwo.m_mask == nullptr)
+		{
+			continue;
+		}
+
+		auto worldTransformOne = XMLoadFloat4x4(&bodyOne.m_worldTransform);
+		auto worldTransformTwo = XMLoadFloat4x4(&bodyTwo.m_worldTransform);
+
+		if (IsTransformedPixelPerfectCollision(*bodyOne.m_mask, worldTransformOne, *bodyTwo.m_mask, worldTransformTwo))
+		{
+			bits |= 1ULL << i;
+		}
+	}
+
+	return bits;
+}
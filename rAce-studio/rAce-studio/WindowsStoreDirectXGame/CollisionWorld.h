@@ -0,0 +1,127 @@
+#pragma once
+
+#include <DirectXMath.h>
+
+#include <utility>
+#include <vector>
+
+#include "CollisionMask.h"
+#include "SpatialHash2D.h"
+
+namespace DX
+{
+	// Runs the narrow phase of 2D collision detection for batches of sprite pairs. Each sprite is added to the world as a body, which is its
+	// CollisionMask plus its current world transform. Each frame you update the transforms, get the candidate pairs from a broad phase
+	// (SpatialHash2D or SweepAndPrune2D), and pass them all to QueryPairs at once. QueryPairs splits the pairs into groups and runs the
+	// transformed pixel perfect tests for the groups with concurrency::parallel_for, so the Concurrency Runtime's work stealing scheduler spreads
+	// them across every core rather than running thousands of tests one after another on the calling thread.
+	class CollisionWorld
+	{
+	public:
+		// Constructor.
+		CollisionWorld();
+
+		// Move constructor.
+		CollisionWorld(CollisionWorld&& value) :
+			m_bodies(),
+			m_freeBodies()
+		{
+			// Invoke the move assignment operator.
+			*this = std::move(value);
+		}
+
+		// Move assignment operator.
+		CollisionWorld& operator=(CollisionWorld&& value)
+		{
+			if (this != &value)
+			{
+				m_bodies.swap(value.m_bodies);
+				m_freeBodies.swap(value.m_freeBodies);
+			}
+
+			return *this;
+		}
+
+		// Adds a body and returns its id. Ids of removed bodies are reused. The transform starts out as the identity matrix.
+		// mask - The collision mask of the sprite. The world only keeps a pointer to the mask so the mask must not be destroyed or moved while the
+		//        body exists. Several bodies can share the same mask.
+		uint32 AddBody(const CollisionMask& mask);
+
+		// Removes a body.
+		// id - The id returned by AddBody.
+		void RemoveBody(uint32 id);
+
+		// Sets the world transform of a body.
+		// id - The id returned by AddBody.
+		// worldTransform - The transform matrix for the sprite. Right hand coordinate system so the transform order should be translate for origin offset, scale, rotate (Z axis), translate for position.
+		void SetTransform(
+			uint32 id,
+			DirectX::CXMMATRIX worldTransform
+			);
+
+		// Tests a batch of pairs of bodies with IsTransformedPixelPerfectCollision. Small batches are tested on the calling thread; larger batches
+		// are tested in parallel. Either way this does not return until every pair has been tested. Don't add, remove, or change the bodies (or their
+		// masks) from another thread while this is running.
+		// pairs - The pairs to test. The ids are the ones returned by AddBody (so if you add every body to the broad phase in the same order, the
+		//         broad phase's ids will match).
+		// pairCount - The number of pairs.
+		// hits - Receives a bit for each pair: bit (i % 64) of hits[i / 64] is set if pair i collides. Use IsHit to read it. The vector's memory is
+		//        reused so keep the same vector around from frame to frame.
+		void QueryPairs(
+			_In_reads_(pairCount) const CollisionPair* pairs,
+			uint32 pairCount,
+			std::vector<uint64>& hits
+			) const;
+
+		// Tests a batch of pairs of bodies. See the other overload.
+		// pairs - The pairs to test.
+		// hits - Receives a bit for each pair.
+		void QueryPairs(
+			const std::vector<CollisionPair>& pairs,
+			std::vector<uint64>& hits
+			) const
+		{
+			QueryPairs(pairs.empty() ? nullptr : &pairs[0], static_cast<uint32>(pairs.size()), hits);
+		}
+
+		// Returns true if pair index of the batch collided.
+		// hits - The bits returned by QueryPairs.
+		// index - The index of the pair in the batch.
+		static bool IsHit(
+			const std::vector<uint64>& hits,
+			uint32 index
+			)
+		{
+			return ((hits[index >> 6] >> (index & 63)) & 1ULL) != 0;
+		}
+
+	private:
+		// Disable copy constructor.
+		CollisionWorld(const CollisionWorld&);
+		// Disable copy assignment.
+		CollisionWorld& operator=(const CollisionWorld&);
+
+		// A sprite in the world.
+		struct Body
+		{
+			// The sprite's collision mask, or nullptr if the body has been removed.
+			const CollisionMask*		m_mask;
+			// The sprite's world transform.
+			DirectX::XMFLOAT4X4			m_worldTransform;
+		};
+
+		// Tests the pairs that make up one word of the hits bitset and returns the word.
+		// pairs - The first pair of the word.
+		// pairCount - The number of pairs in the word (at most 64).
+		uint64 QueryPairGroup(
+			_In_reads_(pairCount) const CollisionPair* pairs,
+			uint32 pairCount
+			) const;
+
+		// The bodies, indexed by id.
+		std::vector<Body>				m_bodies;
+
+		// The ids of removed bodies that can be reused.
+		std::vector<uint32>				m_freeBodies;
+	};
+}
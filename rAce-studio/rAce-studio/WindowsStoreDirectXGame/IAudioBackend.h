@@ -0,0 +1,100 @@
+#pragma once
+
+// Portable (see README_PORTABLE.txt).
+#include <cstdint>
+
+namespace DX
+{
+	// The sample types that an IAudioBackend can play.
+	enum class AudioSampleType : uint32_t
+	{
+		// Signed 16-bit integer samples (WAVE_FORMAT_PCM with 16 bits per sample).
+		Int16,
+		// 32-bit float samples (WAVE_FORMAT_IEEE_FLOAT).
+		Float32,
+	};
+
+	// A sound that is already in memory, in the form that a backend plays it from. The backend only reads the data, so it must stay valid until
+	// every voice that plays it has finished (see IAudioBackend::IsPlaying).
+	struct AudioSound
+	{
+		// The interleaved samples. Must be aligned to the size of one sample.
+		const void*					m_data;
+		// The number of sample frames (one sample per channel).
+		uint32_t					m_frameCount;
+		// The number of channels. 1 or 2.
+		uint32_t					m_channels;
+		// The sample rate.
+		uint32_t					m_sampleRate;
+		// The type of each sample.
+		AudioSampleType				m_sampleType;
+		// The first frame of the loop region. Only used when the sound is played with a non-zero loop count.
+		uint32_t					m_loopBegin;
+		// The number of frames in the loop region. 0 means loop from m_loopBegin to the end of the sound.
+		uint32_t					m_loopLength;
+	};
+
+	// Identifies one play of a sound on a backend. The generation tells plays that reused the same voice apart, so a handle to a play that has
+	// finished is simply ignored.
+	struct AudioVoiceHandle
+	{
+		AudioVoiceHandle() : m_index(0xFFFFFFFF), m_generation(0) {}
+
+		// Returns true if the handle refers to a play (which may have finished since).
+		bool IsValid() const { return m_index != 0xFFFFFFFF; }
+
+		// The index of the voice.
+		uint32_t					m_index;
+		// The voice's generation when the play started.
+		uint32_t					m_generation;
+	};
+
+	// The interface between the AudioEngine's sound effect logic and whatever actually mixes the voices. Every method is called from the game
+	// thread; a backend that mixes on another thread hands the work over without blocking. Plays are fire and forget: a voice goes back to the
+	// backend by itself once its sound ends (or it is stopped), which the game thread sees in the next call to Update.
+	//
+	// AudioEngine deliberately doesn't sit on this interface. An AudioSound is 16-bit or float PCM with one or two channels at the backend's one
+	// sample rate, but the engine plays MS-ADPCM and xWMA that XAudio2 decodes itself, multichannel sounds, and voices that are created per
+	// wave format. Routing it through IAudioBackend would mean decoding all of that to PCM up front and giving up XAudio2's per-format voices.
+	// Instead the engine's voice logic is in VoiceScheduler, which is portable and is tested headless with fake voices, and IAudioBackend is
+	// the seam for mixing: its only implementation is SoftwareMixer, which PortableTests tests against a reference mix and benchmarks.
+	class IAudioBackend
+	{
+	public:
+		// The loop count that means loop forever. The same value as XAUDIO2_LOOP_INFINITE.
+		static const uint32_t LoopInfinite = 255;
+
+		virtual ~IAudioBackend() {}
+
+		// Starts playing a sound. Returns an invalid handle if every voice is busy or the backend can't play the sound's format.
+		// sound - The sound. Its data must stay valid until the play has finished.
+		// loopCount - The number of times to play the loop region again after the first time through. Use LoopInfinite to loop forever.
+		// volume - The volume, as an amplitude multiplier.
+		// pan - The position from -1 (left) to 1 (right). 0 is centered.
+		virtual AudioVoiceHandle Play(const AudioSound& sound, uint32_t loopCount, float volume, float pan) = 0;
+
+		// Stops a play. Handles to plays that have already finished are ignored.
+		virtual void Stop(AudioVoiceHandle voice) = 0;
+
+		// Changes the volume and pan of a play. Handles to plays that have already finished are ignored.
+		// voice - The play.
+		// volume - The volume, as an amplitude multiplier.
+		// pan - The position from -1 (left) to 1 (right). 0 is centered.
+		virtual void SetVolumeAndPan(AudioVoiceHandle voice, float volume, float pan) = 0;
+
+		// Sets the volume that every voice is scaled by.
+		virtual void SetMasterVolume(float volume) = 0;
+
+		// Pauses every voice. Paused voices keep their place.
+		virtual void Pause() = 0;
+
+		// Resumes every voice after Pause.
+		virtual void Resume() = 0;
+
+		// Returns true if a play has not finished yet, as of the last call to Update.
+		virtual bool IsPlaying(AudioVoiceHandle voice) const = 0;
+
+		// Collects the voices whose plays have finished. Call once per frame.
+		virtual void Update() = 0;
+	};
+}
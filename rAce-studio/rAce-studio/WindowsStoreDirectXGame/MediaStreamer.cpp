@@ -8,17 +8,18 @@
 #include "pch.h"
 #include "DirectXHelper.h"
 #include "MediaStreamer.h"
-
-#ifndef MAKEFOURCC
-    #define MAKEFOURCC(ch0, ch1, ch2, ch3)                              \
-                ((uint32)(byte)(ch0) | ((uint32)(byte)(ch1) << 8) |       \
-                ((uint32)(byte)(ch2) << 16) | ((uint32)(byte)(ch3) << 24 ))
-#endif /* defined(MAKEFOURCC) */
+#include "WaveFile.h"
 
 MediaStreamer::MediaStreamer() :
+    m_waveFormat(sizeof(WAVEFORMATEX), 0),
+    m_seekTable(),
+    m_file(),
+    m_data(nullptr),
+    m_dataLength(0),
+    m_loopBegin(0),
+    m_loopLength(0),
     m_offset(0)
 {
-    ZeroMemory(&m_waveFormat, sizeof(m_waveFormat));
 }
 
 MediaStreamer::~MediaStreamer()
@@ -27,83 +28,50 @@ MediaStreamer::~MediaStreamer()
 
 void MediaStreamer::Initialize(_In_ const WCHAR* url)
 {
-    BasicReaderWriter^ reader = ref new BasicReaderWriter();
-    Platform::Array<byte>^ data = reader->ReadData(ref new Platform::String(url));
-    UINT32 length = data->Length;
-    const byte* dataPtr = data->Data;
-    UINT32 offset = 0;
-
-    DWORD riffDataSize = 0;
-
-    auto ReadChunk = [&](DWORD fourcc, DWORD& outChunkSize, DWORD& outChunkPos) -> HRESULT
+    // Map the file rather than reading it so that the audio data is used in place.
+    m_file.Open(url);
+    m_data = nullptr;
+    m_dataLength = 0;
+
+    // Locate the 'fmt ' and 'data' chunks. ParseWaveFile checks every chunk against the size of the file.
+    DX::WaveFileView wave;
+    DX::ThrowIfFailed((DX::ParseWaveFile(m_file.GetData(), m_file.GetSize(), wave) ? S_OK : E_FAIL), __FILEW__, __LINE__);
+
+    // Copy the whole 'fmt ' chunk (compressed formats extend the WAVEFORMATEX). A PCMWAVEFORMAT chunk has no cbSize so it is padded with zeros.
+    m_waveFormat.assign(wave.m_format, wave.m_format + wave.m_formatSize);
+    if (m_waveFormat.size() < sizeof(WAVEFORMATEX))
     {
-        while (true)
-        {
-            if (offset + sizeof(DWORD) * 2 >= length)
-            {
-                return E_FAIL;
-            }
-
-            // Read two DWORDs.
-            DWORD chunkType = *reinterpret_cast<const DWORD*>(&dataPtr[offset]);
-            DWORD chunkSize = *reinterpret_cast<const DWORD*>(&dataPtr[offset + sizeof(DWORD)]);
-            offset += sizeof(DWORD) * 2;
-
-            if (chunkType == MAKEFOURCC('R', 'I', 'F', 'F'))
-            {
-                riffDataSize = chunkSize;
-                chunkSize = sizeof(DWORD);
-                outChunkSize = sizeof(DWORD);
-                outChunkPos = offset;
-            }
-            else
-            {
-                outChunkSize = chunkSize;
-                outChunkPos = offset;
-            }
-
-            offset += chunkSize;
+        m_waveFormat.resize(sizeof(WAVEFORMATEX), 0);
+    }
 
-            if (chunkType == fourcc)
-            {
-                return S_OK;
-            }
-        }
-    };
+    // Point at the 'data' chunk inside the mapping.
+    m_data = wave.m_audioData;
+    m_dataLength = wave.m_audioDataSize;
+    m_loopBegin = wave.m_loopBegin;
+    m_loopLength = wave.m_loopLength;
 
-    // Locate riff chunk, check the file type.
-    DWORD chunkSize = 0;
-    DWORD chunkPos = 0;
-
-    DX::ThrowIfFailed(ReadChunk(MAKEFOURCC('R', 'I', 'F', 'F'), chunkSize, chunkPos), __FILEW__, __LINE__);
-    if (*reinterpret_cast<const DWORD *>(&dataPtr[chunkPos]) != MAKEFOURCC('W', 'A', 'V', 'E')) DX::ThrowIfFailed(E_FAIL, __FILEW__, __LINE__);
-
-    // Locate 'fmt ' chunk, copy to WAVEFORMATEXTENSIBLE.
-    DX::ThrowIfFailed(ReadChunk(MAKEFOURCC('f', 'm', 't', ' '), chunkSize, chunkPos), __FILEW__, __LINE__);
-    DX::ThrowIfFailed(((chunkSize <= sizeof(m_waveFormat)) ? S_OK : E_FAIL), __FILEW__, __LINE__);
-    CopyMemory(&m_waveFormat, &dataPtr[chunkPos], chunkSize);
-
-    // Locate the 'data' chunk and copy its contents to a buffer.
-    DX::ThrowIfFailed(ReadChunk(MAKEFOURCC('d', 'a', 't', 'a'), chunkSize, chunkPos), __FILEW__, __LINE__);
-    m_data.resize(chunkSize);
-    CopyMemory(m_data.data(), &dataPtr[chunkPos], chunkSize);
+    m_seekTable.resize(wave.m_seekTableCount);
+    if (wave.m_seekTableCount != 0)
+    {
+        CopyMemory(m_seekTable.data(), wave.m_seekTable, wave.m_seekTableCount * sizeof(uint32));
+    }
 
     m_offset = 0;
 }
 
 void MediaStreamer::ReadAll(uint8* buffer, uint32 maxBufferSize, uint32* bufferLength)
 {
-    UINT32 toCopy = static_cast<UINT32>(m_data.size()) - m_offset;
+    UINT32 toCopy = m_dataLength - m_offset;
     if (toCopy > maxBufferSize) toCopy = maxBufferSize;
 
-    CopyMemory(buffer, m_data.data(), toCopy);
+    CopyMemory(buffer, m_data + m_offset, toCopy);
     *bufferLength = toCopy;
 
     m_offset += toCopy;
-    if (m_offset > m_data.size()) m_offset = static_cast<UINT32>(m_data.size());
+    if (m_offset > m_dataLength) m_offset = m_dataLength;
 }
 
 void MediaStreamer::Restart()
 {
     m_offset = 0;
-}
\ No newline at end of file
+}
@@ -8,15 +8,21 @@
 #pragma once
 
 #include "BasicReaderWriter.h"
-#include <vector>
+#include "MemoryMappedFile.h"
 
+// Reads a WAV file through a memory mapped view of it. The audio data is never copied: GetData points into the mapping, and DetachFile hands the
+// mapping over to whoever needs the data to outlive the MediaStreamer (e.g. a sound effect whose XAUDIO2_BUFFER points at it).
 class MediaStreamer
 {
 private:
-    WAVEFORMATEX      m_waveFormat;
-    uint32            m_maxStreamLengthInBytes;
-    std::vector<byte> m_data;
-    UINT32            m_offset;
+    std::vector<uint8>  m_waveFormat;
+    std::vector<uint32> m_seekTable;
+    MemoryMappedFile    m_file;
+    const uint8*        m_data;
+    uint32              m_dataLength;
+    uint32              m_loopBegin;
+    uint32              m_loopLength;
+    UINT32              m_offset;
 
 public:
     BasicReaderWriter^ m_reader;
@@ -26,13 +32,52 @@ public:
     ~MediaStreamer();
 
     WAVEFORMATEX& GetOutputWaveFormatEx()
+    {
+        return *reinterpret_cast<WAVEFORMATEX*>(m_waveFormat.data());
+    }
+
+    // Returns the whole 'fmt ' chunk, which for a compressed format (e.g. an ADPCMWAVEFORMAT) is larger than a WAVEFORMATEX. Always at least
+    // sizeof(WAVEFORMATEX) bytes; a PCMWAVEFORMAT chunk is padded with a zero cbSize.
+    const std::vector<uint8>& GetWaveFormat() const
     {
         return m_waveFormat;
     }
 
+    // Returns the first sample of the loop in the file's 'smpl' chunk. Only valid if GetLoopLength is not zero.
+    uint32 GetLoopBegin() const
+    {
+        return m_loopBegin;
+    }
+
+    // Returns the number of samples in the loop in the file's 'smpl' chunk, or zero if the file has no loop.
+    uint32 GetLoopLength() const
+    {
+        return m_loopLength;
+    }
+
+    // Returns the xWMA seek table from the file's 'dpds' chunk (the cumulative number of decoded bytes after each packet), or an empty table if
+    // the file has none. The values are copied out of the mapping since XAudio2 needs them aligned.
+    const std::vector<uint32>& GetSeekTable() const
+    {
+        return m_seekTable;
+    }
+
     UINT32 GetMaxStreamLengthInBytes()
     {
-        return static_cast<UINT32>(m_data.size());
+        return m_dataLength;
+    }
+
+    // Returns a pointer to the audio data inside the mapped file. Valid until the MediaStreamer is destroyed or reinitialized, or for as long as
+    // the file returned by DetachFile stays open.
+    const uint8* GetData() const
+    {
+        return m_data;
+    }
+
+    // Gives up ownership of the mapped file. GetData and ReadAll keep working for as long as the returned file stays open.
+    MemoryMappedFile DetachFile()
+    {
+        return std::move(m_file);
     }
 
     void Initialize(_In_ const WCHAR* url);
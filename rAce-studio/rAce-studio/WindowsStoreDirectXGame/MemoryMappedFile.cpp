@@ -0,0 +1,110 @@
+#include "pch.h"
+#include "MemoryMappedFile.h"
+
+namespace
+{
+	// Throws a Platform::Exception for the calling thread's last Win32 error.
+	void ThrowLastError()
+	{
+		throw Platform::Exception::CreateException(HRESULT_FROM_WIN32(GetLastError()));
+	}
+}
+
+MemoryMappedFile::MemoryMappedFile() :
+	m_file(INVALID_HANDLE_VALUE),
+	m_mapping(nullptr),
+	m_data(nullptr),
+	m_size()
+{
+}
+
+MemoryMappedFile::~MemoryMappedFile()
+{
+	Close();
+}
+
+void MemoryMappedFile::Open(_In_ LPCWSTR filename)
+{
+	Close();
+
+	if (filename == nullptr)
+	{
+		throw ref new Platform::InvalidArgumentException(L"filename");
+	}
+
+	// Relative paths are relative to the installed location, like BasicReaderWriter.
+	Platform::String^ path = ref new Platform::String(filename);
+	if (path->Length() < 2 || filename[1] != L':')
+	{
+		path = Platform::String::Concat(Platform::String::Concat(Windows::ApplicationModel::Package::Current->InstalledLocation->Path, "\\"), path);
+	}
+
+	CREATEFILE2_EXTENDED_PARAMETERS extendedParams = {0};
+	extendedParams.dwSize = sizeof(CREATEFILE2_EXTENDED_PARAMETERS);
+	extendedParams.dwFileAttributes = FILE_ATTRIBUTE_NORMAL;
+	extendedParams.dwFileFlags = FILE_FLAG_RANDOM_ACCESS;
+	extendedParams.dwSecurityQosFlags = SECURITY_ANONYMOUS;
+	extendedParams.lpSecurityAttributes = nullptr;
+	extendedParams.hTemplateFile = nullptr;
+
+	m_file = CreateFile2(path->Data(), GENERIC_READ, FILE_SHARE_READ, OPEN_EXISTING, &extendedParams);
+	if (m_file == INVALID_HANDLE_VALUE)
+	{
+		ThrowLastError();
+	}
+
+	FILE_STANDARD_INFO fileInfo = {0};
+	if (!GetFileInformationByHandleEx(m_file, FileStandardInfo, &fileInfo, sizeof(fileInfo)))
+	{
+		ThrowLastError();
+	}
+
+	if (static_cast<uint64>(fileInfo.EndOfFile.QuadPart) > static_cast<uint64>(SIZE_MAX))
+	{
+		Close();
+		throw ref new Platform::OutOfMemoryException();
+	}
+
+	m_size = static_cast<size_t>(fileInfo.EndOfFile.QuadPart);
+
+	// A file mapping can't be created for an empty file, so leave m_data as nullptr.
+	if (m_size == 0)
+	{
+		return;
+	}
+
+	m_mapping = CreateFileMappingFromApp(m_file, nullptr, PAGE_READONLY, 0, nullptr);
+	if (m_mapping == nullptr)
+	{
+		ThrowLastError();
+	}
+
+	m_data = MapViewOfFileFromApp(m_mapping, FILE_MAP_READ, 0, 0);
+	if (m_data == nullptr)
+	{
+		ThrowLastError();
+	}
+}
+
+void MemoryMappedFile::Close()
+{
+	if (m_data != nullptr)
+	{
+		UnmapViewOfFile(m_data);
+		m_data = nullptr;
+	}
+
+	if (m_mapping != nullptr)
+	{
+		CloseHandle(m_mapping);
+		m_mapping = nullptr;
+	}
+
+	if (m_file != INVALID_HANDLE_VALUE)
+	{
+		CloseHandle(m_file);
+		m_file = INVALID_HANDLE_VALUE;
+	}
+
+	m_size = 0;
+}
@@ -0,0 +1,77 @@
+#pragma once
+
+#include <Windows.h>
+
+#include <utility>
+
+// A read-only memory mapped view of an entire file. Mapping a file avoids copying it into a buffer (the pages are read from disk as they are
+// touched) so it is a cheap way to load data files that are used in place, such as .cmask collision masks.
+class MemoryMappedFile
+{
+public:
+	// Constructor. Does not open a file. Use Open to do that.
+	MemoryMappedFile();
+
+	// Destructor. Closes the file if it is open.
+	~MemoryMappedFile();
+
+	// Move constructor.
+	MemoryMappedFile(MemoryMappedFile&& value) :
+		m_file(INVALID_HANDLE_VALUE),
+		m_mapping(nullptr),
+		m_data(nullptr),
+		m_size()
+	{
+		// Invoke the move assignment operator.
+		*this = std::move(value);
+	}
+
+	// Move assignment operator.
+	MemoryMappedFile& operator=(MemoryMappedFile&& value)
+	{
+		if (this != &value)
+		{
+			std::swap(m_file, value.m_file);
+			std::swap(m_mapping, value.m_mapping);
+			std::swap(m_data, value.m_data);
+			std::swap(m_size, value.m_size);
+		}
+
+		return *this;
+	}
+
+	// Opens and maps a file. Any file that is already open is closed first. Throws a Platform::Exception with the Win32 error as an HRESULT if
+	// the file can't be opened or mapped.
+	// filename - The file to open. Relative paths are relative to the app's installed location (the same as BasicReaderWriter).
+	void Open(_In_ LPCWSTR filename);
+
+	// Unmaps and closes the file. Does nothing if no file is open.
+	void Close();
+
+	// Returns true if a file is open.
+	bool IsOpen() const { return m_file != INVALID_HANDLE_VALUE; }
+
+	// Returns a pointer to the start of the file's data. Returns nullptr if no file is open or the file is empty.
+	const void* GetData() const { return m_data; }
+
+	// Returns the size of the file in bytes.
+	size_t GetSize() const { return m_size; }
+
+private:
+	// Disable copy constructor.
+	MemoryMappedFile(const MemoryMappedFile&);
+	// Disable copy assignment.
+	MemoryMappedFile& operator=(const MemoryMappedFile&);
+
+	// The file.
+	HANDLE						m_file;
+
+	// The file mapping object. nullptr for an empty file since empty files can't be mapped.
+	HANDLE						m_mapping;
+
+	// The mapped view of the file.
+	const void*					m_data;
+
+	// The size of the file in bytes.
+	size_t						m_size;
+};
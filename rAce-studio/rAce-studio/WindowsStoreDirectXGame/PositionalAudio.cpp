@@ -0,0 +1,178 @@
+#include "pch.h"
+#include "PositionalAudio.h"
+
+#undef min
+#undef max
+
+DX::PositionalAudioBatch::PositionalAudioBatch() :
+	m_count(),
+	m_positionX(),
+	m_positionY(),
+	m_positionZ(),
+	m_velocityX(),
+	m_velocityY(),
+	m_velocityZ(),
+	m_stereo(),
+	m_left(),
+	m_right(),
+	m_attenuation(),
+	m_frequencyRatio()
+{
+}
+
+void DX::PositionalAudioBatch::Reserve(uint32 capacity)
+{
+	// Compute pads the arrays to a multiple of four, so leave room for that too.
+	size_t padded = (static_cast<size_t>(capacity) + 3) & ~static_cast<size_t>(3);
+
+	m_positionX.reserve(padded);
+	m_positionY.reserve(padded);
+	m_positionZ.reserve(padded);
+	m_velocityX.reserve(padded);
+	m_velocityY.reserve(padded);
+	m_velocityZ.reserve(padded);
+	m_stereo.reserve(padded);
+	m_left.reserve(padded);
+	m_right.reserve(padded);
+	m_attenuation.reserve(padded);
+	m_frequencyRatio.reserve(padded);
+}
+
+void DX::PositionalAudioBatch::Clear()
+{
+	m_count = 0;
+
+	m_positionX.clear();
+	m_positionY.clear();
+	m_positionZ.clear();
+	m_velocityX.clear();
+	m_velocityY.clear();
+	m_velocityZ.clear();
+	m_stereo.clear();
+}
+
+uint32 DX::PositionalAudioBatch::Add(const DirectX::XMFLOAT3& position, const DirectX::XMFLOAT3& velocity, bool stereo)
+{
+	// Drop the padding that the last Compute added (if Add is called again without a Clear).
+	m_positionX.resize(m_count);
+	m_positionY.resize(m_count);
+	m_positionZ.resize(m_count);
+	m_velocityX.resize(m_count);
+	m_velocityY.resize(m_count);
+	m_velocityZ.resize(m_count);
+	m_stereo.resize(m_count);
+
+	m_positionX.push_back(position.x);
+	m_positionY.push_back(position.y);
+	m_positionZ.push_back(position.z);
+	m_velocityX.push_back(velocity.x);
+	m_velocityY.push_back(velocity.y);
+	m_velocityZ.push_back(velocity.z);
+	m_stereo.push_back(stereo ? 0xFFFFFFFFU : 0U);
+
+	return m_count++;
+}
+
+void DX::PositionalAudioBatch::Compute(const AudioListener& listener, const PositionalAudioSettings& settings)
+{
+	// Pad the arrays to a whole number of groups of four. The padding is computed along with the rest and then ignored.
+	size_t padded = (static_cast<size_t>(m_count) + 3) & ~static_cast<size_t>(3);
+	m_positionX.resize(padded, 0.0f);
+	m_positionY.resize(padded, 0.0f);
+	m_positionZ.resize(padded, 0.0f);
+	m_velocityX.resize(padded, 0.0f);
+	m_velocityY.resize(padded, 0.0f);
+	m_velocityZ.resize(padded, 0.0f);
+	m_stereo.resize(padded, 0U);
+	m_left.resize(padded);
+	m_right.resize(padded);
+	m_attenuation.resize(padded);
+	m_frequencyRatio.resize(padded);
+
+	// The listener's right axis. Up doesn't have to be at right angles to forward since only their cross product is used.
+	DirectX::XMFLOAT3 rightAxis;
+	DirectX::XMStoreFloat3(&rightAxis, DirectX::XMVector3Normalize(DirectX::XMVector3Cross(DirectX::XMLoadFloat3(&listener.m_up), DirectX::XMLoadFloat3(&listener.m_forward))));
+
+	// Everything that is the same for every emitter, splatted across the four lanes.
+	auto listenerX = DirectX::XMVectorReplicate(listener.m_position.x);
+	auto listenerY = DirectX::XMVectorReplicate(listener.m_position.y);
+	auto listenerZ = DirectX::XMVectorReplicate(listener.m_position.z);
+	auto listenerVelocityX = DirectX::XMVectorReplicate(listener.m_velocity.x);
+	auto listenerVelocityY = DirectX::XMVectorReplicate(listener.m_velocity.y);
+	auto listenerVelocityZ = DirectX::XMVectorReplicate(listener.m_velocity.z);
+	auto rightX = DirectX::XMVectorReplicate(rightAxis.x);
+	auto rightY = DirectX::XMVectorReplicate(rightAxis.y);
+	auto rightZ = DirectX::XMVectorReplicate(rightAxis.z);
+
+	float minDistance = std::max(settings.m_minDistance, 0.0001f);
+	auto minDistanceVector = DirectX::XMVectorReplicate(minDistance);
+	auto maxDistanceVector = DirectX::XMVectorReplicate(std::max(settings.m_maxDistance, minDistance));
+	auto inverseMinDistance = DirectX::XMVectorReplicate(1.0f / minDistance);
+	auto rolloff = DirectX::XMVectorReplicate(std::max(settings.m_rolloffFactor, 0.0f));
+
+	// The speeds along the line between the emitter and the listener are scaled by the doppler factor and kept under half the speed of sound
+	// so that the ratio can't blow up.
+	float speedOfSound = std::max(settings.m_speedOfSound, 0.0001f);
+	auto speedOfSoundVector = DirectX::XMVectorReplicate(speedOfSound);
+	auto dopplerFactor = DirectX::XMVectorReplicate(std::max(settings.m_dopplerFactor, 0.0f));
+	auto maxSpeed = DirectX::XMVectorReplicate(speedOfSound * 0.5f);
+	auto minSpeed = DirectX::XMVectorNegate(maxSpeed);
+	auto maxRatio = DirectX::XMVectorReplicate(MaxDopplerFrequencyRatio);
+	auto minRatio = DirectX::XMVectorReplicate(1.0f / MaxDopplerFrequencyRatio);
+
+	auto epsilon = DirectX::XMVectorReplicate(0.0001f);
+	auto one = DirectX::XMVectorSplatOne();
+	auto quarterPi = DirectX::XMVectorReplicate(DirectX::XM_PIDIV4);
+
+	for (size_t i = 0; i < padded; i += 4)
+	{
+		// The offset from the listener to the emitter and its length.
+		auto offsetX = DirectX::XMVectorSubtract(DirectX::XMLoadFloat4(reinterpret_cast<const DirectX::XMFLOAT4*>(&m_positionX[i])), listenerX);
+		auto offsetY = DirectX::XMVectorSubtract(DirectX::XMLoadFloat4(reinterpret_cast<const DirectX::XMFLOAT4*>(&m_positionY[i])), listenerY);
+		auto offsetZ = DirectX::XMVectorSubtract(DirectX::XMLoadFloat4(reinterpret_cast<const DirectX::XMFLOAT4*>(&m_positionZ[i])), listenerZ);
+		auto distanceSquared = DirectX::XMVectorMultiplyAdd(offsetZ, offsetZ, DirectX::XMVectorMultiplyAdd(offsetY, offsetY, DirectX::XMVectorMultiply(offsetX, offsetX)));
+		auto distance = DirectX::XMVectorSqrt(distanceSquared);
+
+		// An emitter right on top of the listener has no direction, so it is centered and has no doppler.
+		auto inverseDistance = DirectX::XMVectorSelect(DirectX::XMVectorZero(), DirectX::XMVectorReciprocal(distance), DirectX::XMVectorGreater(distance, epsilon));
+
+		// Attenuation: minDistance / (minDistance + rolloff * (distance - minDistance)), with the distance clamped to the range.
+		auto clampedDistance = DirectX::XMVectorClamp(distance, minDistanceVector, maxDistanceVector);
+		auto attenuation = DirectX::XMVectorDivide(minDistanceVector, DirectX::XMVectorMultiplyAdd(rolloff, DirectX::XMVectorSubtract(clampedDistance, minDistanceVector), minDistanceVector));
+
+		// Pan: the sine of the angle between straight ahead and the emitter, in the plane of the listener's right axis. It eases to the center
+		// inside the minimum distance so that a sound passing through the listener doesn't jump from one side to the other.
+		auto side = DirectX::XMVectorMultiplyAdd(offsetZ, rightZ, DirectX::XMVectorMultiplyAdd(offsetY, rightY, DirectX::XMVectorMultiply(offsetX, rightX)));
+		auto pan = DirectX::XMVectorMultiply(DirectX::XMVectorMultiply(side, inverseDistance), DirectX::XMVectorSaturate(DirectX::XMVectorMultiply(distance, inverseMinDistance)));
+		pan = DirectX::XMVectorClamp(pan, DirectX::XMVectorNegate(one), one);
+
+		// Mono: constant power, so a sound keeps the same loudness as it moves across. Stereo: balance, which turns one side down.
+		DirectX::XMVECTOR monoRight;
+		DirectX::XMVECTOR monoLeft;
+		DirectX::XMVectorSinCos(&monoRight, &monoLeft, DirectX::XMVectorMultiply(DirectX::XMVectorAdd(pan, one), quarterPi));
+		auto stereoLeft = DirectX::XMVectorMin(one, DirectX::XMVectorSubtract(one, pan));
+		auto stereoRight = DirectX::XMVectorMin(one, DirectX::XMVectorAdd(one, pan));
+
+		auto stereo = DirectX::XMLoadInt4(&m_stereo[i]);
+		auto leftGain = DirectX::XMVectorMultiply(DirectX::XMVectorSelect(monoLeft, stereoLeft, stereo), attenuation);
+		auto rightGain = DirectX::XMVectorMultiply(DirectX::XMVectorSelect(monoRight, stereoRight, stereo), attenuation);
+
+		// Doppler: (c + listener speed towards the emitter) / (c + emitter speed away from the listener).
+		auto listenerSpeed = DirectX::XMVectorMultiplyAdd(offsetZ, listenerVelocityZ, DirectX::XMVectorMultiplyAdd(offsetY, listenerVelocityY, DirectX::XMVectorMultiply(offsetX, listenerVelocityX)));
+		listenerSpeed = DirectX::XMVectorClamp(DirectX::XMVectorMultiply(DirectX::XMVectorMultiply(listenerSpeed, inverseDistance), dopplerFactor), minSpeed, maxSpeed);
+
+		auto velocityX = DirectX::XMLoadFloat4(reinterpret_cast<const DirectX::XMFLOAT4*>(&m_velocityX[i]));
+		auto velocityY = DirectX::XMLoadFloat4(reinterpret_cast<const DirectX::XMFLOAT4*>(&m_velocityY[i]));
+		auto velocityZ = DirectX::XMLoadFloat4(reinterpret_cast<const DirectX::XMFLOAT4*>(&m_velocityZ[i]));
+		auto emitterSpeed = DirectX::XMVectorMultiplyAdd(offsetZ, velocityZ, DirectX::XMVectorMultiplyAdd(offsetY, velocityY, DirectX::XMVectorMultiply(offsetX, velocityX)));
+		emitterSpeed = DirectX::XMVectorClamp(DirectX::XMVectorMultiply(DirectX::XMVectorMultiply(emitterSpeed, inverseDistance), dopplerFactor), minSpeed, maxSpeed);
+
+		auto frequencyRatio = DirectX::XMVectorDivide(DirectX::XMVectorAdd(speedOfSoundVector, listenerSpeed), DirectX::XMVectorAdd(speedOfSoundVector, emitterSpeed));
+		frequencyRatio = DirectX::XMVectorClamp(frequencyRatio, minRatio, maxRatio);
+
+		DirectX::XMStoreFloat4(reinterpret_cast<DirectX::XMFLOAT4*>(&m_left[i]), leftGain);
+		DirectX::XMStoreFloat4(reinterpret_cast<DirectX::XMFLOAT4*>(&m_right[i]), rightGain);
+		DirectX::XMStoreFloat4(reinterpret_cast<DirectX::XMFLOAT4*>(&m_attenuation[i]), attenuation);
+		DirectX::XMStoreFloat4(reinterpret_cast<DirectX::XMFLOAT4*>(&m_frequencyRatio[i]), frequencyRatio);
+	}
+}
@@ -0,0 +1,129 @@
+#pragma once
+
+#include <DirectXMath.h>
+#include <vector>
+
+namespace DX
+{
+	// The highest frequency ratio that doppler can produce (and one over it is the lowest). Matches the maxFrequencyRatio that the VoicePool's
+	// source voices are created with.
+	const float MaxDopplerFrequencyRatio = 2.0f;
+
+	// Where the sound is heard from. The axes use left-handed coordinates (the same as Camera's LH matrices): with the defaults, +x is to the
+	// listener's right, +y is up and +z is straight ahead. A 2D game can leave the listener at its defaults and give its sounds positions with a
+	// z of 0, so that x alone decides the pan.
+	struct AudioListener
+	{
+		// Constructor. Places the listener at the origin facing +z with +y up, standing still.
+		AudioListener() :
+			m_position(0.0f, 0.0f, 0.0f),
+			m_velocity(0.0f, 0.0f, 0.0f),
+			m_forward(0.0f, 0.0f, 1.0f),
+			m_up(0.0f, 1.0f, 0.0f)
+		{
+		}
+
+		// The position, in world units.
+		DirectX::XMFLOAT3			m_position;
+		// The velocity, in world units per second. Only used for doppler.
+		DirectX::XMFLOAT3			m_velocity;
+		// The direction the listener faces. Doesn't need to be normalized.
+		DirectX::XMFLOAT3			m_forward;
+		// The listener's up direction. Doesn't need to be normalized or exactly at right angles to m_forward.
+		DirectX::XMFLOAT3			m_up;
+	};
+
+	// How distance and speed affect positional sounds. The defaults suit a world measured in meters.
+	struct PositionalAudioSettings
+	{
+		// Constructor. Sets the defaults.
+		PositionalAudioSettings() :
+			m_minDistance(1.0f),
+			m_maxDistance(100.0f),
+			m_rolloffFactor(1.0f),
+			m_dopplerFactor(1.0f),
+			m_speedOfSound(343.0f)
+		{
+		}
+
+		// Sounds closer than this play at full volume (and are panned less and less towards the center as they get closer). Must be greater
+		// than zero.
+		float						m_minDistance;
+		// Sounds further away than this get no quieter.
+		float						m_maxDistance;
+		// How quickly sounds get quieter with distance. 1 is the inverse distance law (6 dB quieter each time the distance doubles), 0 turns
+		// attenuation off.
+		float						m_rolloffFactor;
+		// Scales the doppler effect. 1 is realistic, 0 turns it off.
+		float						m_dopplerFactor;
+		// The speed of sound, in world units per second.
+		float						m_speedOfSound;
+	};
+
+	// Computes the gains and frequency ratios of many positional sounds at once. Each frame the AudioEngine clears the batch, adds the emitter
+	// of every positional voice that is playing, and computes them all together. The emitters are kept as a structure of arrays (one array per
+	// component) so that Compute works on four of them at a time with DirectXMath, with no shuffling.
+	//
+	// Attenuation is inverse distance clamped to the minimum and maximum distances, scaled by the rolloff factor. Mono sounds are panned by the
+	// sine of their angle from straight ahead with a constant power pan law; stereo sounds are balanced instead so that both channels are kept.
+	// Doppler uses the speeds of the emitter and the listener along the line between them.
+	class PositionalAudioBatch
+	{
+	public:
+		// Constructor.
+		PositionalAudioBatch();
+
+		// Reserves room for a number of emitters so that adding up to that many never allocates.
+		// capacity - The most emitters the batch will hold.
+		void Reserve(uint32 capacity);
+
+		// Removes every emitter.
+		void Clear();
+
+		// Adds an emitter and returns its index in the batch.
+		// position - The position, in world units.
+		// velocity - The velocity, in world units per second.
+		// stereo - True for a stereo sound (which is balanced rather than panned).
+		uint32 Add(const DirectX::XMFLOAT3& position, const DirectX::XMFLOAT3& velocity, bool stereo);
+
+		// Computes the gains and frequency ratio of every emitter.
+		// listener - The listener.
+		// settings - The attenuation and doppler settings.
+		void Compute(const AudioListener& listener, const PositionalAudioSettings& settings);
+
+		// Returns the number of emitters.
+		uint32 GetCount() const { return m_count; }
+
+		// Returns the gain of an emitter's left output channel, including attenuation. Only valid after Compute.
+		float GetLeftGain(uint32 index) const { return m_left[index]; }
+
+		// Returns the gain of an emitter's right output channel, including attenuation. Only valid after Compute.
+		float GetRightGain(uint32 index) const { return m_right[index]; }
+
+		// Returns an emitter's attenuation alone. Only valid after Compute.
+		float GetAttenuation(uint32 index) const { return m_attenuation[index]; }
+
+		// Returns an emitter's frequency ratio (1 is unchanged). Only valid after Compute.
+		float GetFrequencyRatio(uint32 index) const { return m_frequencyRatio[index]; }
+
+	private:
+		// The number of emitters. The arrays are padded to a multiple of four by Compute.
+		uint32						m_count;
+
+		// The emitters' positions and velocities, one array per component.
+		std::vector<float>			m_positionX;
+		std::vector<float>			m_positionY;
+		std::vector<float>			m_positionZ;
+		std::vector<float>			m_velocityX;
+		std::vector<float>			m_velocityY;
+		std::vector<float>			m_velocityZ;
+		// All bits set for a stereo emitter, zero for a mono one (a select mask).
+		std::vector<uint32>			m_stereo;
+
+		// The results.
+		std::vector<float>			m_left;
+		std::vector<float>			m_right;
+		std::vector<float>			m_attenuation;
+		std::vector<float>			m_frequencyRatio;
+	};
+}
@@ -0,0 +1,52 @@
+#include "ReadbackScheduler.h"
+
+DX::ReadbackScheduler::ReadbackScheduler() :
+	m_submitFrames(),
+	m_frameLatency(),
+	m_frame(),
+	m_oldest(),
+	m_pendingCount()
+{
+}
+
+void DX::ReadbackScheduler::Initialize(
+	uint32_t slotCount,
+	uint32_t frameLatency
+	)
+{
+	m_submitFrames.assign(slotCount, 0ULL);
+	m_frameLatency = frameLatency;
+	Reset();
+}
+
+void DX::ReadbackScheduler::Reset()
+{
+	m_frame = 0;
+	m_oldest = 0;
+	m_pendingCount = 0;
+}
+
+uint32_t DX::ReadbackScheduler::GetNextSlot() const
+{
+	auto slotCount = static_cast<uint32_t>(m_submitFrames.size());
+	if (m_pendingCount >= slotCount)
+	{
+		return NoSlot;
+	}
+
+	return (m_oldest + m_pendingCount) % slotCount;
+}
+
+uint32_t DX::ReadbackScheduler::Submit()
+{
+	auto slot = GetNextSlot();
+	if (slot == NoSlot)
+	{
+		return NoSlot;
+	}
+
+	m_submitFrames[slot] = m_frame;
+	m_pendingCount++;
+
+	return slot;
+}
@@ -0,0 +1,128 @@
+#pragma once
+
+// Portable (see README_PORTABLE.txt) so that the frame latency logic can be driven by a fake device.
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+namespace DX
+{
+	// Decides when GPU to CPU readbacks can be collected. Each readback uses one slot of a ring (e.g. one staging texture). A copy is submitted into
+	// the next free slot and the slot is only polled once frameLatency frames have gone by, which is normally long enough for the GPU to have
+	// finished the copy so that mapping the slot doesn't stall. The GPU finishes copies in the order that they were submitted, so slots are polled
+	// oldest first and polling stops at the first slot that isn't ready yet. The scheduler doesn't know anything about Direct3D; the caller does the
+	// copy and the map (see CollisionDataReadback).
+	class ReadbackScheduler
+	{
+	public:
+		// The value returned by GetNextSlot and Submit when every slot is in use.
+		static const uint32_t NoSlot = 0xFFFFFFFF;
+
+		// Constructor. The scheduler has no slots until Initialize is called.
+		ReadbackScheduler();
+
+		// Move constructor.
+		ReadbackScheduler(ReadbackScheduler&& value) :
+			m_submitFrames(),
+			m_frameLatency(),
+			m_frame(),
+			m_oldest(),
+			m_pendingCount()
+		{
+			// Invoke the move assignment operator.
+			*this = std::move(value);
+		}
+
+		// Move assignment operator.
+		ReadbackScheduler& operator=(ReadbackScheduler&& value)
+		{
+			if (this != &value)
+			{
+				m_submitFrames.swap(value.m_submitFrames);
+				m_frameLatency = value.m_frameLatency;
+				m_frame = value.m_frame;
+				m_oldest = value.m_oldest;
+				m_pendingCount = value.m_pendingCount;
+			}
+
+			return *this;
+		}
+
+		// Sets the number of slots and the latency. Any pending readbacks are forgotten.
+		// slotCount - The number of slots in the ring. Must be greater than zero.
+		// frameLatency - The number of calls to AdvanceFrame after a submit before its slot is polled.
+		void Initialize(
+			uint32_t slotCount,
+			uint32_t frameLatency
+			);
+
+		// Forgets every pending readback and resets the frame count.
+		void Reset();
+
+		// Returns the slot that the next call to Submit will claim, without claiming it, or NoSlot if every slot is still pending. This lets the
+		// caller set the slot up (e.g. create its staging texture) before claiming it, so that a failure part way through doesn't leave a claimed
+		// slot with nothing in it.
+		uint32_t GetNextSlot() const;
+
+		// Claims the next slot for a readback that is being submitted this frame. Returns the slot, or NoSlot if every slot is still pending (in which
+		// case try again next frame).
+		uint32_t Submit();
+
+		// Moves on to the next frame. Call this once per frame, before Poll.
+		void AdvanceFrame() { m_frame++; }
+
+		// Polls the pending slots that are old enough, oldest first. tryComplete is called with each slot's index and must return true if the readback
+		// was collected (which frees the slot) or false if the data isn't ready yet (which stops polling until the next call). Returns the number of
+		// readbacks that were collected. tryComplete may call Submit.
+		// tryComplete - A function or lambda with the signature bool (uint32_t slot).
+		template <typename TryComplete>
+		uint32_t Poll(TryComplete tryComplete)
+		{
+			uint32_t completedCount = 0;
+			while (m_pendingCount > 0)
+			{
+				auto slot = m_oldest;
+				if (m_frame - m_submitFrames[slot] < m_frameLatency || !tryComplete(slot))
+				{
+					break;
+				}
+
+				m_oldest = (m_oldest + 1) % static_cast<uint32_t>(m_submitFrames.size());
+				m_pendingCount--;
+				completedCount++;
+			}
+
+			return completedCount;
+		}
+
+		// Returns the number of slots.
+		uint32_t GetSlotCount() const { return static_cast<uint32_t>(m_submitFrames.size()); }
+
+		// Returns the number of readbacks that have been submitted but not collected.
+		uint32_t GetPendingCount() const { return m_pendingCount; }
+
+		// Returns the number of times that AdvanceFrame has been called since the scheduler was initialized or reset.
+		uint64_t GetFrame() const { return m_frame; }
+
+	private:
+		// Disable copy constructor.
+		ReadbackScheduler(const ReadbackScheduler&);
+		// Disable copy assignment.
+		ReadbackScheduler& operator=(const ReadbackScheduler&);
+
+		// The frame that each slot was submitted in.
+		std::vector<uint64_t>			m_submitFrames;
+
+		// The number of frames to wait before polling a slot.
+		uint32_t						m_frameLatency;
+
+		// The current frame.
+		uint64_t						m_frame;
+
+		// The oldest pending slot. The pending slots follow it in ring order.
+		uint32_t						m_oldest;
+
+		// The number of pending slots.
+		uint32_t						m_pendingCount;
+	};
+}
@@ -0,0 +1,282 @@
+#include "SampleRateConverter.h"
+
+#include <cmath>
+
+#if defined(_M_IX86) || defined(_M_X64) || defined(__SSE2__)
+#define SAMPLE_RATE_CONVERTER_SSE2
+#include <emmintrin.h>
+#elif defined(_M_ARM) || defined(__ARM_NEON__) || defined(__ARM_NEON)
+#define SAMPLE_RATE_CONVERTER_NEON
+#include <arm_neon.h>
+#endif
+
+namespace
+{
+	const double Pi = 3.14159265358979323846;
+
+	// The Kaiser window's shape parameter. 8 gives a stopband about 80 dB down.
+	const double KaiserBeta = 8.0;
+
+	// The cutoff as a fraction of the lower Nyquist frequency. The transition band sits just below and above it.
+	const double CutoffFraction = 0.9;
+
+	// Returns the greatest common divisor of two numbers.
+	uint32_t GreatestCommonDivisor(uint32_t a, uint32_t b)
+	{
+		while (b != 0)
+		{
+			uint32_t remainder = a % b;
+			a = b;
+			b = remainder;
+		}
+
+		return a;
+	}
+
+	// Returns the zeroth order modified Bessel function of the first kind, which the Kaiser window is made of. The series converges quickly for
+	// the arguments that are used here.
+	double BesselI0(double x)
+	{
+		double sum = 1.0;
+		double term = 1.0;
+		double quarterSquare = (x * x) / 4.0;
+		for (int k = 1; k < 64; ++k)
+		{
+			term *= quarterSquare / (static_cast<double>(k) * k);
+			sum += term;
+			if (term < sum * 1e-12)
+			{
+				break;
+			}
+		}
+
+		return sum;
+	}
+
+	// Returns the dot product of count floats (a multiple of 4).
+	inline float DotProduct(const float* samples, const float* taps, uint32_t count)
+	{
+#if defined(SAMPLE_RATE_CONVERTER_SSE2)
+		// Two accumulators so that each add doesn't wait for the one before.
+		__m128 first = _mm_setzero_ps();
+		__m128 second = _mm_setzero_ps();
+		uint32_t i = 0;
+		for (; i + 8 <= count; i += 8)
+		{
+			first = _mm_add_ps(first, _mm_mul_ps(_mm_loadu_ps(samples + i), _mm_loadu_ps(taps + i)));
+			second = _mm_add_ps(second, _mm_mul_ps(_mm_loadu_ps(samples + i + 4), _mm_loadu_ps(taps + i + 4)));
+		}
+		if (i < count)
+		{
+			first = _mm_add_ps(first, _mm_mul_ps(_mm_loadu_ps(samples + i), _mm_loadu_ps(taps + i)));
+		}
+
+		__m128 sum = _mm_add_ps(first, second);
+		sum = _mm_add_ps(sum, _mm_movehl_ps(sum, sum));
+		sum = _mm_add_ss(sum, _mm_shuffle_ps(sum, sum, _MM_SHUFFLE(1, 1, 1, 1)));
+		return _mm_cvtss_f32(sum);
+#elif defined(SAMPLE_RATE_CONVERTER_NEON)
+		float32x4_t first = vdupq_n_f32(0.0f);
+		float32x4_t second = vdupq_n_f32(0.0f);
+		uint32_t i = 0;
+		for (; i + 8 <= count; i += 8)
+		{
+			first = vmlaq_f32(first, vld1q_f32(samples + i), vld1q_f32(taps + i));
+			second = vmlaq_f32(second, vld1q_f32(samples + i + 4), vld1q_f32(taps + i + 4));
+		}
+		if (i < count)
+		{
+			first = vmlaq_f32(first, vld1q_f32(samples + i), vld1q_f32(taps + i));
+		}
+
+		float32x4_t sum = vaddq_f32(first, second);
+		float32x2_t half = vadd_f32(vget_low_f32(sum), vget_high_f32(sum));
+		return vget_lane_f32(vpadd_f32(half, half), 0);
+#else
+		float sum = 0.0f;
+		for (uint32_t i = 0; i < count; ++i)
+		{
+			sum += samples[i] * taps[i];
+		}
+
+		return sum;
+#endif
+	}
+
+	// Converts a float sample in the -1 to 1 range to a rounded and clamped 16-bit sample.
+	inline int16_t ToInt16(float value)
+	{
+		float scaled = value * 32768.0f;
+		scaled = scaled < -32768.0f ? -32768.0f : (scaled > 32767.0f ? 32767.0f : scaled);
+		return static_cast<int16_t>(std::floor(scaled + 0.5f));
+	}
+}
+
+DX::SampleRateConverter::SampleRateConverter() :
+	m_inputRate(0),
+	m_outputRate(0),
+	m_up(0),
+	m_down(0),
+	m_tapCount(0),
+	m_taps()
+{
+}
+
+bool DX::SampleRateConverter::Initialize(uint32_t inputRate, uint32_t outputRate)
+{
+	m_inputRate = 0;
+	m_outputRate = 0;
+	m_up = 0;
+	m_down = 0;
+	m_tapCount = 0;
+	m_taps.clear();
+
+	if (inputRate == 0 || outputRate == 0)
+	{
+		return false;
+	}
+
+	uint32_t divisor = GreatestCommonDivisor(inputRate, outputRate);
+	uint32_t up = outputRate / divisor;
+	uint32_t down = inputRate / divisor;
+	if (up > MaxPhases)
+	{
+		return false;
+	}
+
+	// Converting down, the cutoff drops with the output's Nyquist frequency so the filter has to be longer (in input samples) by the same ratio.
+	double scale = (up < down) ? static_cast<double>(up) / down : 1.0;
+	uint32_t tapCount = static_cast<uint32_t>(std::ceil(BaseTapCount / scale));
+	tapCount = (tapCount + 3) & ~3U;
+
+	// The cutoff in cycles per input sample.
+	double cutoff = 0.5 * CutoffFraction * scale;
+	double halfLength = tapCount / 2.0;
+	double windowScale = 1.0 / BesselI0(KaiserBeta);
+
+	m_taps.resize(static_cast<size_t>(up) * tapCount);
+	std::vector<double> values(tapCount);
+	for (uint32_t phase = 0; phase < up; ++phase)
+	{
+		double fraction = static_cast<double>(phase) / up;
+		float* taps = &m_taps[static_cast<size_t>(phase) * tapCount];
+
+		double sum = 0.0;
+		for (uint32_t k = 0; k < tapCount; ++k)
+		{
+			// The distance from the output sample to this tap's input sample, in input samples.
+			double x = (static_cast<double>(k) - (halfLength - 1.0)) - fraction;
+			double sinc = (x == 0.0) ? 1.0 : std::sin(2.0 * Pi * cutoff * x) / (2.0 * Pi * cutoff * x);
+			double ratio = x / halfLength;
+			double window = (ratio * ratio < 1.0) ? BesselI0(KaiserBeta * std::sqrt(1.0 - (ratio * ratio))) * windowScale : 0.0;
+
+			values[k] = sinc * window;
+			sum += values[k];
+		}
+
+		for (uint32_t k = 0; k < tapCount; ++k)
+		{
+			taps[k] = static_cast<float>(values[k] / sum);
+		}
+	}
+
+	m_inputRate = inputRate;
+	m_outputRate = outputRate;
+	m_up = up;
+	m_down = down;
+	m_tapCount = tapCount;
+
+	return true;
+}
+
+uint64_t DX::SampleRateConverter::GetOutputFrameCount(uint64_t inputFrameCount) const
+{
+	if (m_up == 0)
+	{
+		return 0;
+	}
+
+	// Output frame n lies at input frame n * down / up, and every output frame up to the last input frame is produced.
+	return ((inputFrameCount * m_up) + m_down - 1) / m_down;
+}
+
+uint64_t DX::SampleRateConverter::ConvertFramePosition(uint64_t inputFrame) const
+{
+	if (m_down == 0)
+	{
+		return 0;
+	}
+
+	return ((inputFrame * m_up) + (m_down / 2)) / m_down;
+}
+
+void DX::SampleRateConverter::ConvertChannel(const float* padded, size_t outputFrameCount, float* output) const
+{
+	// Walk the input in whole samples plus a phase, so there is no drift however long the sound is.
+	size_t inputFrame = 0;
+	uint32_t phase = 0;
+	size_t firstTap = m_tapCount - ((m_tapCount / 2) - 1);
+
+	for (size_t frame = 0; frame < outputFrameCount; ++frame)
+	{
+		output[frame] = DotProduct(padded + firstTap + inputFrame, &m_taps[static_cast<size_t>(phase) * m_tapCount], m_tapCount);
+
+		phase += m_down;
+		inputFrame += phase / m_up;
+		phase %= m_up;
+	}
+}
+
+void DX::SampleRateConverter::Convert(const int16_t* input, size_t frameCount, uint32_t channels, int16_t* output) const
+{
+	if (m_up == 0 || channels == 0)
+	{
+		return;
+	}
+
+	size_t outputFrameCount = static_cast<size_t>(GetOutputFrameCount(frameCount));
+	std::vector<float> padded(frameCount + (2 * static_cast<size_t>(m_tapCount)), 0.0f);
+	std::vector<float> converted(outputFrameCount);
+
+	for (uint32_t channel = 0; channel < channels; ++channel)
+	{
+		for (size_t i = 0; i < frameCount; ++i)
+		{
+			padded[m_tapCount + i] = input[(i * channels) + channel] * (1.0f / 32768.0f);
+		}
+
+		ConvertChannel(padded.data(), outputFrameCount, converted.data());
+
+		for (size_t i = 0; i < outputFrameCount; ++i)
+		{
+			output[(i * channels) + channel] = ToInt16(converted[i]);
+		}
+	}
+}
+
+void DX::SampleRateConverter::Convert(const float* input, size_t frameCount, uint32_t channels, float* output) const
+{
+	if (m_up == 0 || channels == 0)
+	{
+		return;
+	}
+
+	size_t outputFrameCount = static_cast<size_t>(GetOutputFrameCount(frameCount));
+	std::vector<float> padded(frameCount + (2 * static_cast<size_t>(m_tapCount)), 0.0f);
+	std::vector<float> converted(outputFrameCount);
+
+	for (uint32_t channel = 0; channel < channels; ++channel)
+	{
+		for (size_t i = 0; i < frameCount; ++i)
+		{
+			padded[m_tapCount + i] = input[(i * channels) + channel];
+		}
+
+		ConvertChannel(padded.data(), outputFrameCount, converted.data());
+
+		for (size_t i = 0; i < outputFrameCount; ++i)
+		{
+			output[(i * channels) + channel] = converted[i];
+		}
+	}
+}
@@ -0,0 +1,82 @@
+#pragma once
+
+// Portable (see README_PORTABLE.txt) so that assets can also be converted offline.
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace DX
+{
+	// Converts whole sounds from one sample rate to another with a polyphase windowed sinc filter, so that sounds can be normalized to the
+	// output rate once (offline or when they are loaded) instead of being resampled by every voice that plays them.
+	//
+	// The ratio is reduced to up / down (e.g. 44100 to 48000 is 160 / 147) and the filter is stored as one set of taps per phase, so each output
+	// sample is a single dot product of the input around it with the taps of its phase. The taps are a Kaiser windowed sinc with its cutoff just
+	// under the lower of the two Nyquist frequencies, normalized so that each phase has unity gain at DC. The dot products use SSE2 (x86/x64) or
+	// NEON (ARM), with a scalar fallback. Convert only reads the converter, so one converter can be shared by several threads (e.g. to convert
+	// many sounds at the same rate in parallel).
+	class SampleRateConverter
+	{
+	public:
+		// The most phases a converter can have. Rate pairs whose reduced ratio needs more (which only happens for unusual rates) are rejected.
+		static const uint32_t MaxPhases = 4096;
+
+		// The number of taps per phase when converting up. Converting down widens the filter by the ratio so that it keeps the same transition band
+		// relative to the output rate.
+		static const uint32_t BaseTapCount = 64;
+
+		// Constructor. Call Initialize before using the instance.
+		SampleRateConverter();
+
+		// Builds the filter for a pair of rates. Returns false (and leaves the converter unusable) if either rate is zero or the reduced ratio
+		// needs more than MaxPhases phases.
+		// inputRate - The sample rate of the sounds that will be converted.
+		// outputRate - The sample rate to convert them to.
+		bool Initialize(uint32_t inputRate, uint32_t outputRate);
+
+		// Returns the input sample rate.
+		uint32_t GetInputRate() const { return m_inputRate; }
+
+		// Returns the output sample rate.
+		uint32_t GetOutputRate() const { return m_outputRate; }
+
+		// Returns the number of taps per phase.
+		uint32_t GetTapCount() const { return m_tapCount; }
+
+		// Returns the number of output frames that inputFrameCount input frames convert to.
+		uint64_t GetOutputFrameCount(uint64_t inputFrameCount) const;
+
+		// Returns the output frame that lines up with an input frame (rounded to the nearest). Used to move loop points.
+		uint64_t ConvertFramePosition(uint64_t inputFrame) const;
+
+		// Converts a whole sound. The input is treated as silence before its start and after its end.
+		// input - The interleaved input samples.
+		// frameCount - The number of input frames.
+		// channels - The number of channels. Any number is allowed; each one is converted separately.
+		// output - Receives GetOutputFrameCount(frameCount) interleaved frames. 16-bit output is rounded and clamped.
+		void Convert(const int16_t* input, size_t frameCount, uint32_t channels, int16_t* output) const;
+		void Convert(const float* input, size_t frameCount, uint32_t channels, float* output) const;
+
+	private:
+		// Converts one channel that has already been spread out into padded, planar floats.
+		// padded - The channel's samples with m_tapCount zeros before and after them.
+		// outputFrameCount - The number of output frames.
+		// output - Receives the samples, one per output frame.
+		void ConvertChannel(const float* padded, size_t outputFrameCount, float* output) const;
+
+		// The rates.
+		uint32_t							m_inputRate;
+		uint32_t							m_outputRate;
+
+		// The reduced ratio: every m_down input frames become m_up output frames. m_up is also the number of phases.
+		uint32_t							m_up;
+		uint32_t							m_down;
+
+		// The number of taps per phase. Always a multiple of 4.
+		uint32_t							m_tapCount;
+
+		// The taps, m_tapCount per phase, for phases 0 to m_up - 1. Phase p holds the taps for an output sample that lies p / m_up of the way
+		// from one input sample to the next. Tap k of a phase applies to the input sample k - (m_tapCount / 2 - 1) from the one before.
+		std::vector<float>					m_taps;
+	};
+}
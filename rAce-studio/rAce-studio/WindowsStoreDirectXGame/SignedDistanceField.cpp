@@ -0,0 +1,506 @@
+#include "pch.h"
+#include "SignedDistanceField.h"
+
+#include <ppl.h>
+
+using namespace DirectX;
+
+namespace
+{
+	// The squared distance given to texels that haven't found a feature yet. It is finite (rather than infinity) so that the parabola
+	// intersections in DistanceTransform1D never compute infinity minus infinity.
+	const float FarSquaredDistance = 1e20f;
+
+	// The number of columns (in the first pass) or rows (in the second pass) that each parallel task transforms.
+	const uint32 LinesPerTask = 32;
+
+	// Queries that cover no more than this many rows of 8x8 blocks are run on the calling thread since the cost of scheduling the work would be
+	// larger than the cost of the lookups.
+	const uint32 SerialBlockRowCount = 2;
+
+	// The scratch buffers for transforming one line of the grid.
+	struct LineScratch
+	{
+		// Constructor.
+		// length - The length of the longest line that will be transformed.
+		explicit LineScratch(uint32 length) :
+			m_input(length),
+			m_output(length),
+			m_parabolas(length),
+			m_boundaries(length + 1)
+		{
+		}
+
+		std::vector<float>		m_input;
+		std::vector<float>		m_output;
+		std::vector<int>		m_parabolas;
+		std::vector<float>		m_boundaries;
+	};
+
+	// The one dimensional squared distance transform from Felzenszwalb and Huttenlocher's "Distance Transforms of Sampled Functions". Each sample
+	// is the apex of a parabola and the output is the lower envelope of the parabolas, which is found in a single pass by keeping the parabolas
+	// that are part of the envelope on a stack along with the points where they intersect.
+	// scratch - The input samples are read from m_input and the result is written to m_output.
+	// count - The number of samples in the line.
+	void DistanceTransform1D(
+		LineScratch& scratch,
+		uint32 count
+		)
+	{
+		const float* f = &scratch.m_input[0];
+		float* d = &scratch.m_output[0];
+		int* v = &scratch.m_parabolas[0];
+		float* z = &scratch.m_boundaries[0];
+
+		int k = 0;
+		v[0] = 0;
+		z[0] = -FarSquaredDistance;
+		z[1] = FarSquaredDistance;
+
+		for (int q = 1; q < static_cast<int>(count); q++)
+		{
+			// Pop the parabolas that the new one hides. z[0] is far enough below zero that the first parabola is never popped.
+			float s;
+			for (;;)
+			{
+				auto p = v[k];
+				s = ((f[q] + static_cast<float>(q * q)) - (f[p] + static_cast<float>(p * p))) / static_cast<float>(2 * (q - p));
+				if (s > z[k])
+				{
+					break;
+				}
+				k--;
+			}
+
+			k++;
+			v[k] = q;
+			z[k] = s;
+			z[k + 1] = FarSquaredDistance;
+		}
+
+		k = 0;
+		for (int q = 0; q < static_cast<int>(count); q++)
+		{
+			while (z[k + 1] < static_cast<float>(q))
+			{
+				k++;
+			}
+			auto offset = static_cast<float>(q - v[k]);
+			d[q] = (offset * offset) + f[v[k]];
+		}
+	}
+
+	// Returns the uniform scale of a transform (the square root of the area scale of its upper 2x2 part).
+	float GetUniformScale(CXMMATRIX transform)
+	{
+		XMFLOAT4X4 matrix;
+		XMStoreFloat4x4(&matrix, transform);
+		return sqrtf(fabsf((matrix._11 * matrix._22) - (matrix._12 * matrix._21)));
+	}
+
+	// The deepest texel found by a task of GetPenetration.
+	struct DeepestTexel
+	{
+		// The signed distance of the texel in the second sprite's field.
+		float					m_distance;
+		// The texel of the first sprite.
+		int						m_x;
+		int						m_y;
+	};
+}
+
+DX::SignedDistanceField::SignedDistanceField() :
+	m_width(),
+	m_height(),
+	m_distances()
+{
+}
+
+void DX::SignedDistanceField::CreateFromBGRA(
+	_In_reads_(width * height * 4) const uint8* data,
+	uint32 width,
+	uint32 height
+	)
+{
+	if (data == nullptr)
+	{
+		throw ref new Platform::InvalidArgumentException(L"data");
+	}
+
+	std::vector<uint8> inside(width * height);
+	for (uint32 i = 0; i < width * height; i++)
+	{
+		inside[i] = (data[(i * 4) + 3] != 0) ? 1 : 0;
+	}
+
+	Create(inside, width, height);
+}
+
+void DX::SignedDistanceField::CreateFromMask(const CollisionMask& mask)
+{
+	if (mask.IsEmpty())
+	{
+		throw ref new Platform::InvalidArgumentException(L"mask");
+	}
+
+	auto width = mask.GetWidth();
+	auto height = mask.GetHeight();
+	std::vector<uint8> inside(width * height);
+	for (uint32 y = 0; y < height; y++)
+	{
+		for (uint32 x = 0; x < width; x++)
+		{
+			inside[(y * width) + x] = mask.IsOpaque(static_cast<int32_t>(x), static_cast<int32_t>(y)) ? 1 : 0;
+		}
+	}
+
+	Create(inside, width, height);
+}
+
+void DX::SignedDistanceField::Reset()
+{
+	m_width = 0;
+	m_height = 0;
+	std::vector<float>().swap(m_distances);
+}
+
+void DX::SignedDistanceField::Create(
+	const std::vector<uint8>& inside,
+	uint32 width,
+	uint32 height
+	)
+{
+	if (width == 0 || height == 0)
+	{
+		Reset();
+		return;
+	}
+
+	m_width = width;
+	m_height = height;
+	m_distances.resize(width * height);
+
+	// Two squared distance grids are transformed at the same time: the distance from each outside texel to the nearest inside texel and the
+	// distance from each inside texel to the nearest outside texel. Each starts out as zero on its feature texels and "far" everywhere else.
+	std::vector<float> toInside(width * height);
+	std::vector<float> toOutside(width * height);
+	for (uint32 i = 0; i < width * height; i++)
+	{
+		toInside[i] = (inside[i] != 0) ? 0.0f : FarSquaredDistance;
+		toOutside[i] = (inside[i] != 0) ? FarSquaredDistance : 0.0f;
+	}
+
+	auto insideData = &inside[0];
+	auto toInsideData = &toInside[0];
+	auto toOutsideData = &toOutside[0];
+	auto distancesData = &m_distances[0];
+	auto longestLine = max(width, height);
+
+	// First pass: transform every column. The results are written back into the grids.
+	auto columnTaskCount = (width + LinesPerTask - 1) / LinesPerTask;
+	concurrency::parallel_for(0U, columnTaskCount, [=](uint32 task)
+	{
+		LineScratch scratch(longestLine);
+		auto lastColumn = min((task + 1) * LinesPerTask, width);
+		for (auto x = task * LinesPerTask; x < lastColumn; x++)
+		{
+			float* grids[2] = { toInsideData, toOutsideData };
+			for (auto grid : grids)
+			{
+				for (uint32 y = 0; y < height; y++)
+				{
+					scratch.m_input[y] = grid[(y * width) + x];
+				}
+				DistanceTransform1D(scratch, height);
+				for (uint32 y = 0; y < height; y++)
+				{
+					grid[(y * width) + x] = scratch.m_output[y];
+				}
+			}
+		}
+	});
+
+	// Second pass: transform every row, which gives the exact squared Euclidean distances, and convert them to signed distances.
+	auto rowTaskCount = (height + LinesPerTask - 1) / LinesPerTask;
+	concurrency::parallel_for(0U, rowTaskCount, [=](uint32 task)
+	{
+		LineScratch scratch(longestLine);
+		std::vector<float> toInsideRow(width);
+		auto lastRow = min((task + 1) * LinesPerTask, height);
+		for (auto y = task * LinesPerTask; y < lastRow; y++)
+		{
+			auto rowStart = y * width;
+
+			memcpy(&scratch.m_input[0], toInsideData + rowStart, width * sizeof(float));
+			DistanceTransform1D(scratch, width);
+			memcpy(&toInsideRow[0], &scratch.m_output[0], width * sizeof(float));
+
+			memcpy(&scratch.m_input[0], toOutsideData + rowStart, width * sizeof(float));
+			DistanceTransform1D(scratch, width);
+
+			for (uint32 x = 0; x < width; x++)
+			{
+				// The edge is halfway between an inside texel and an outside one, so half a texel is taken off of the distance between their centers.
+				if (insideData[rowStart + x] != 0)
+				{
+					// Everything past the edge of the texture is transparent, so an inside texel is never further from the outside than the border.
+					auto toBorder = static_cast<float>(min(min(x, width - 1 - x), min(y, height - 1 - y)) + 1);
+					distancesData[rowStart + x] = 0.5f - min(sqrtf(scratch.m_output[x]), toBorder);
+				}
+				else
+				{
+					distancesData[rowStart + x] = sqrtf(toInsideRow[x]) - 0.5f;
+				}
+			}
+		}
+	});
+}
+
+float DX::SignedDistanceField::SampleDistance(
+	float x,
+	float y
+	) const
+{
+	// Clamp the point to the rectangle covered by the texel centers and account for the part that was clamped off separately.
+	auto clampedX = max(0.0f, min(x, static_cast<float>(m_width - 1)));
+	auto clampedY = max(0.0f, min(y, static_cast<float>(m_height - 1)));
+	auto offsetX = x - clampedX;
+	auto offsetY = y - clampedY;
+
+	auto x0 = static_cast<uint32>(clampedX);
+	auto y0 = static_cast<uint32>(clampedY);
+	auto x1 = min(x0 + 1, m_width - 1);
+	auto y1 = min(y0 + 1, m_height - 1);
+	auto tx = clampedX - static_cast<float>(x0);
+	auto ty = clampedY - static_cast<float>(y0);
+
+	auto top = GetDistance(x0, y0) + ((GetDistance(x1, y0) - GetDistance(x0, y0)) * tx);
+	auto bottom = GetDistance(x0, y1) + ((GetDistance(x1, y1) - GetDistance(x0, y1)) * tx);
+	auto distance = top + ((bottom - top) * ty);
+
+	if (offsetX != 0.0f || offsetY != 0.0f)
+	{
+		distance += sqrtf((offsetX * offsetX) + (offsetY * offsetY));
+	}
+
+	return distance;
+}
+
+DirectX::XMFLOAT2 DX::SignedDistanceField::SampleNormal(
+	float x,
+	float y
+	) const
+{
+	// Central differences one texel either side of the point.
+	XMFLOAT2 gradient(SampleDistance(x + 1.0f, y) - SampleDistance(x - 1.0f, y), SampleDistance(x, y + 1.0f) - SampleDistance(x, y - 1.0f));
+
+	auto length = sqrtf((gradient.x * gradient.x) + (gradient.y * gradient.y));
+	if (length < 1e-6f)
+	{
+		return XMFLOAT2(0.0f, 0.0f);
+	}
+
+	return XMFLOAT2(gradient.x / length, gradient.y / length);
+}
+
+bool DX::SignedDistanceField::GetCirclePenetration(
+	const DirectX::XMFLOAT2& center,
+	float radius,
+	_Out_ float& depth,
+	_Out_ DirectX::XMFLOAT2& normal
+	) const
+{
+	depth = 0.0f;
+	normal = XMFLOAT2(0.0f, 0.0f);
+
+	if (IsEmpty())
+	{
+		return false;
+	}
+
+	auto penetration = radius - SampleDistance(center.x, center.y);
+	if (penetration <= 0.0f)
+	{
+		return false;
+	}
+
+	depth = penetration;
+	normal = SampleNormal(center.x, center.y);
+	return true;
+}
+
+bool DX::SignedDistanceField::GetTransformedCirclePenetration(
+	const DirectX::XMFLOAT2& center,
+	float radius,
+	DirectX::CXMMATRIX worldTransform,
+	_Out_ float& depth,
+	_Out_ DirectX::XMFLOAT2& normal
+	) const
+{
+	depth = 0.0f;
+	normal = XMFLOAT2(0.0f, 0.0f);
+
+	auto scale = GetUniformScale(worldTransform);
+	if (IsEmpty() || scale <= 0.0f)
+	{
+		return false;
+	}
+
+	// Move the circle into the sprite's local space, where distances are measured in texels.
+	XMFLOAT2 localCenter;
+	XMStoreFloat2(&localCenter, XMVector2Transform(XMLoadFloat2(&center), XMMatrixInverse(nullptr, worldTransform)));
+
+	float localDepth;
+	XMFLOAT2 localNormal;
+	if (!GetCirclePenetration(localCenter, radius / scale, localDepth, localNormal))
+	{
+		return false;
+	}
+
+	depth = localDepth * scale;
+	XMStoreFloat2(&normal, XMVector2Normalize(XMVector2TransformNormal(XMLoadFloat2(&localNormal), worldTransform)));
+	return true;
+}
+
+bool DX::GetPenetration(
+	_In_ const CollisionMask& spriteOneMask,
+	_In_ DirectX::CXMMATRIX spriteOneWorldTransform,
+	_In_ const SignedDistanceField& spriteTwoField,
+	_In_ DirectX::CXMMATRIX spriteTwoWorldTransform,
+	_Out_ float& depth,
+	_Out_ DirectX::XMFLOAT2& normal,
+	_Out_ DirectX::XMFLOAT2& contactPoint
+	)
+{
+	depth = 0.0f;
+	normal = XMFLOAT2(0.0f, 0.0f);
+	contactPoint = XMFLOAT2(0.0f, 0.0f);
+
+	if (spriteOneMask.IsEmpty() || spriteTwoField.IsEmpty())
+	{
+		return false;
+	}
+
+	// Create a matrix to transform coordinates from sprite one local to sprite two local, and the steps for one texel right and one texel down
+	// (the same as IsTransformedPixelPerfectCollision).
+	XMMATRIX transformOneToTwo = spriteOneWorldTransform * XMMatrixInverse(nullptr, spriteTwoWorldTransform);
+
+	const XMFLOAT2 fUnitX(1.0f, 0.0f);
+	const XMFLOAT2 fUnitY(0.0f, 1.0f);
+	XMFLOAT2 stepX;
+	XMFLOAT2 stepY;
+	XMStoreFloat2(&stepX, XMVector2TransformNormal(XMLoadFloat2(&fUnitX), transformOneToTwo));
+	XMStoreFloat2(&stepY, XMVector2TransformNormal(XMLoadFloat2(&fUnitY), transformOneToTwo));
+
+	XMFLOAT2 origin;
+	XMStoreFloat2(&origin, XMVector2Transform(XMVectorZero(), transformOneToTwo));
+
+	const int blockSize = 1 << CollisionMask::CoarseLevelCount;
+	auto spriteOneWidth = static_cast<int>(spriteOneMask.GetWidth());
+	auto spriteOneHeight = static_cast<int>(spriteOneMask.GetHeight());
+	auto blockRowCount = static_cast<uint32>((spriteOneHeight + blockSize - 1) / blockSize);
+
+	// Each row of blocks records its deepest texel in its own entry so that the rows can be scanned in parallel without locking.
+	std::vector<DeepestTexel> deepest(blockRowCount);
+	auto deepestData = &deepest[0];
+	auto field = &spriteTwoField;
+	auto mask = &spriteOneMask;
+
+	auto scanBlockRow = [=](uint32 blockRow)
+	{
+		// Only negative distances (texels inside of sprite two) are of interest.
+		DeepestTexel result = { 0.0f, 0, 0 };
+
+		auto blockTop = static_cast<int>(blockRow) * blockSize;
+		auto blockBottom = min(blockTop + blockSize, spriteOneHeight);
+
+		for (int blockLeft = 0; blockLeft < spriteOneWidth; blockLeft += blockSize)
+		{
+			auto blockRight = min(blockLeft + blockSize, spriteOneWidth);
+
+			if (!mask->MayContainOpaque(CollisionMask::CoarseLevelCount, blockLeft, blockTop, blockRight, blockBottom))
+			{
+				continue;
+			}
+
+			// The distance changes by at most one per texel, so if the distance at the block's center minus the distance to its furthest corner
+			// can't beat the deepest texel so far (or isn't inside of sprite two at all) then no texel of the block can. A texel of slack covers the
+			// interpolation between the texels of the field.
+			auto centerX = static_cast<float>(blockLeft + blockRight - 1) * 0.5f;
+			auto centerY = static_cast<float>(blockTop + blockBottom - 1) * 0.5f;
+			auto halfWidth = static_cast<float>(blockRight - blockLeft - 1) * 0.5f;
+			auto halfHeight = static_cast<float>(blockBottom - blockTop - 1) * 0.5f;
+			auto cornerOffsetA = XMFLOAT2((stepX.x * halfWidth) + (stepY.x * halfHeight), (stepX.y * halfWidth) + (stepY.y * halfHeight));
+			auto cornerOffsetB = XMFLOAT2((stepX.x * halfWidth) - (stepY.x * halfHeight), (stepX.y * halfWidth) - (stepY.y * halfHeight));
+			auto blockRadius = sqrtf(max((cornerOffsetA.x * cornerOffsetA.x) + (cornerOffsetA.y * cornerOffsetA.y),
+				(cornerOffsetB.x * cornerOffsetB.x) + (cornerOffsetB.y * cornerOffsetB.y))) + 1.0f;
+			auto centerDistance = field->SampleDistance(origin.x + (stepX.x * centerX) + (stepY.x * centerY), origin.y + (stepX.y * centerX) + (stepY.y * centerY));
+			if (centerDistance - blockRadius >= result.m_distance)
+			{
+				continue;
+			}
+
+			auto blockWidth = blockRight - blockLeft;
+			uint64_t columnMask = (1ULL << blockWidth) - 1ULL;
+
+			for (int spriteOneY = blockTop; spriteOneY < blockBottom; spriteOneY++)
+			{
+				float rowX = origin.x + (stepY.x * spriteOneY);
+				float rowY = origin.y + (stepY.y * spriteOneY);
+
+				for (uint64_t bits = mask->GetRowBits(static_cast<uint32_t>(spriteOneY), static_cast<uint32_t>(blockLeft)) & columnMask; bits != 0ULL; bits &= bits - 1ULL)
+				{
+					auto spriteOneX = blockLeft + static_cast<int>(LowestSetBitIndex(bits));
+					auto distance = field->SampleDistance(rowX + (stepX.x * spriteOneX), rowY + (stepX.y * spriteOneX));
+					if (distance < result.m_distance)
+					{
+						result.m_distance = distance;
+						result.m_x = spriteOneX;
+						result.m_y = spriteOneY;
+					}
+				}
+			}
+		}
+
+		deepestData[blockRow] = result;
+	};
+
+	if (blockRowCount <= SerialBlockRowCount)
+	{
+		for (uint32 blockRow = 0; blockRow < blockRowCount; blockRow++)
+		{
+			scanBlockRow(blockRow);
+		}
+	}
+	else
+	{
+		concurrency::parallel_for(0U, blockRowCount, scanBlockRow);
+	}
+
+	DeepestTexel result = { 0.0f, 0, 0 };
+	for (auto& rowResult : deepest)
+	{
+		if (rowResult.m_distance < result.m_distance)
+		{
+			result = rowResult;
+		}
+	}
+
+	if (result.m_distance >= 0.0f)
+	{
+		return false;
+	}
+
+	// The normal is the direction out of sprite two at the deepest texel, moved into world space.
+	auto spriteOneX = static_cast<float>(result.m_x);
+	auto spriteOneY = static_cast<float>(result.m_y);
+	auto localNormal = spriteTwoField.SampleNormal(origin.x + (stepX.x * spriteOneX) + (stepY.x * spriteOneY), origin.y + (stepX.y * spriteOneX) + (stepY.y * spriteOneY));
+
+	depth = -result.m_distance * GetUniformScale(spriteTwoWorldTransform);
+	XMStoreFloat2(&normal, XMVector2Normalize(XMVector2TransformNormal(XMLoadFloat2(&localNormal), spriteTwoWorldTransform)));
+
+	const XMFLOAT2 texel(spriteOneX, spriteOneY);
+	XMStoreFloat2(&contactPoint, XMVector2Transform(XMLoadFloat2(&texel), spriteOneWorldTransform));
+
+	return true;
+}
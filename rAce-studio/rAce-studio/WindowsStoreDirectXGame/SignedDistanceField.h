@@ -0,0 +1,181 @@
+#pragma once
+
+#include <DirectXMath.h>
+
+#include <utility>
+#include <vector>
+
+#include "CollisionMask.h"
+
+namespace DX
+{
+	// A signed distance field for a sprite. Each texel stores the distance, in texels, from the texel's center to the edge of the sprite's opaque
+	// area: positive outside of the sprite, negative inside, and zero halfway between an opaque texel and a transparent one. Texel (x, y) is
+	// centered on (x, y) in the sprite's local space, which is the same convention the pixel perfect tests in CollisionDetection2D use.
+	// The pixel perfect tests can only say whether two sprites overlap. Physics response also needs to know how far they overlap and which way to
+	// push them apart, and working that out from the alpha data means scanning outward from the contact for the nearest transparent texel, over and
+	// over again. The distance field answers both questions with a few lookups instead: the depth is the (negated) distance and the contact
+	// normal is the gradient of the field.
+	// The field is built with the linear time exact Euclidean distance transform of Felzenszwalb and Huttenlocher, which runs a one dimensional
+	// transform down every column and then across every row. Each column (and row) is independent so the passes are run with
+	// concurrency::parallel_for. Build the field once at load time from the data returned by GetTexture2DCollisionDataNoRender (or from a
+	// CollisionMask) and keep it with the sprite's other collision data.
+	class SignedDistanceField
+	{
+	public:
+		// Constructor. The field is empty until one of the Create methods is called.
+		SignedDistanceField();
+
+		// Move constructor.
+		SignedDistanceField(SignedDistanceField&& value) :
+			m_width(),
+			m_height(),
+			m_distances()
+		{
+			// Invoke the move assignment operator.
+			*this = std::move(value);
+		}
+
+		// Move assignment operator.
+		SignedDistanceField& operator=(SignedDistanceField&& value)
+		{
+			if (this != &value)
+			{
+				m_width = value.m_width;
+				m_height = value.m_height;
+				m_distances.swap(value.m_distances);
+			}
+
+			return *this;
+		}
+
+		// Builds the field from B8G8R8A8 data. Texels with a non-zero alpha value are inside of the sprite.
+		// data - The texture data returned by GetTexture2DCollisionData or GetTexture2DCollisionDataNoRender.
+		// width - The width of the texture in texels.
+		// height - The height of the texture in texels.
+		void CreateFromBGRA(
+			_In_reads_(width * height * 4) const uint8* data,
+			uint32 width,
+			uint32 height
+			);
+
+		// Builds the field from a collision mask. Texels whose bits are set are inside of the sprite.
+		// mask - The collision mask. Must not be empty.
+		void CreateFromMask(const CollisionMask& mask);
+
+		// Releases the field's memory.
+		void Reset();
+
+		// Returns true if the field hasn't been created.
+		bool IsEmpty() const { return m_distances.empty(); }
+
+		// Returns the width of the field in texels.
+		uint32 GetWidth() const { return m_width; }
+
+		// Returns the height of the field in texels.
+		uint32 GetHeight() const { return m_height; }
+
+		// Returns the signed distance stored for a texel.
+		// x - The column of the texel. Must be less than the width.
+		// y - The row of the texel. Must be less than the height.
+		float GetDistance(
+			uint32 x,
+			uint32 y
+			) const
+		{
+			return m_distances[(y * m_width) + x];
+		}
+
+		// Returns the signed distance at a point in the sprite's local space by interpolating between the four nearest texels. Points outside of the
+		// texture are clamped to its edge and the distance from the edge is added, which gives a distance that is never less than the real one.
+		// x - The x coordinate in the sprite's local space (texels).
+		// y - The y coordinate in the sprite's local space (texels).
+		float SampleDistance(
+			float x,
+			float y
+			) const;
+
+		// Returns the direction in which the distance increases fastest at a point in the sprite's local space (i.e. the direction out of the
+		// sprite), as a unit vector. Returns (0, 0) if the field is flat at the point.
+		// x - The x coordinate in the sprite's local space (texels).
+		// y - The y coordinate in the sprite's local space (texels).
+		DirectX::XMFLOAT2 SampleNormal(
+			float x,
+			float y
+			) const;
+
+		// Finds how far a circle in the sprite's local space has penetrated the sprite.
+		// center - The center of the circle in the sprite's local space.
+		// radius - The radius of the circle in texels.
+		// depth - Receives how far the circle has to move along the normal to stop touching the sprite. Zero if the circle isn't touching it.
+		// normal - Receives the contact normal: the unit direction that pushes the circle out of the sprite.
+		// Returns true if the circle overlaps the sprite, false if not.
+		bool GetCirclePenetration(
+			const DirectX::XMFLOAT2& center,
+			float radius,
+			_Out_ float& depth,
+			_Out_ DirectX::XMFLOAT2& normal
+			) const;
+
+		// Finds how far a circle in world space has penetrated the sprite. The sprite's transform may rotate it and scale it uniformly; with
+		// non-uniform scaling the result is only approximate.
+		// center - The center of the circle in world space.
+		// radius - The radius of the circle in world units.
+		// worldTransform - The transform matrix for the sprite. Right hand coordinate system so the transform order should be translate for origin offset, scale, rotate (Z axis), translate for position.
+		// depth - Receives the penetration depth in world units. Zero if the circle isn't touching the sprite.
+		// normal - Receives the contact normal in world space: the unit direction that pushes the circle out of the sprite.
+		// Returns true if the circle overlaps the sprite, false if not.
+		bool GetTransformedCirclePenetration(
+			const DirectX::XMFLOAT2& center,
+			float radius,
+			DirectX::CXMMATRIX worldTransform,
+			_Out_ float& depth,
+			_Out_ DirectX::XMFLOAT2& normal
+			) const;
+
+	private:
+		// Disable copy constructor.
+		SignedDistanceField(const SignedDistanceField&);
+		// Disable copy assignment.
+		SignedDistanceField& operator=(const SignedDistanceField&);
+
+		// Runs the distance transform over a grid of inside flags and stores the signed distances.
+		// inside - One byte per texel, non-zero for texels that are inside of the sprite.
+		void Create(
+			const std::vector<uint8>& inside,
+			uint32 width,
+			uint32 height
+			);
+
+		// The width of the field in texels.
+		uint32					m_width;
+
+		// The height of the field in texels.
+		uint32					m_height;
+
+		// The signed distance of each texel, row by row.
+		std::vector<float>		m_distances;
+	};
+
+	// Finds how far one sprite has penetrated another. Every opaque texel of the first sprite is looked up in the second sprite's distance field and
+	// the deepest one gives the depth and normal. The first sprite is walked in 8x8 blocks: blocks that are transparent or that are far enough
+	// outside of the second sprite that none of their texels can reach it are skipped, so only the blocks near the contact are scanned. The rows
+	// of blocks are scanned in parallel.
+	// spriteOneMask - The collision mask for the first sprite.
+	// spriteOneWorldTransform - The transform matrix for the first sprite. Right hand coordinate system so the transform order should be translate for origin offset, scale, rotate (Z axis), translate for position.
+	// spriteTwoField - The signed distance field for the second sprite.
+	// spriteTwoWorldTransform - The transform matrix for the second sprite. Should only scale uniformly (see GetTransformedCirclePenetration).
+	// depth - Receives the penetration depth in world units. Zero if the sprites aren't touching.
+	// normal - Receives the contact normal in world space: the unit direction to move the first sprite to push it out of the second.
+	// contactPoint - Receives the world space position of the deepest texel of the first sprite.
+	// Returns true if the sprites overlap, false if not.
+	bool GetPenetration(
+		_In_ const CollisionMask& spriteOneMask,
+		_In_ DirectX::CXMMATRIX spriteOneWorldTransform,
+		_In_ const SignedDistanceField& spriteTwoField,
+		_In_ DirectX::CXMMATRIX spriteTwoWorldTransform,
+		_Out_ float& depth,
+		_Out_ DirectX::XMFLOAT2& normal,
+		_Out_ DirectX::XMFLOAT2& contactPoint
+		);
+}
@@ -0,0 +1,544 @@
+#include "SoftwareMixer.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+#if defined(_M_IX86) || defined(_M_X64) || defined(__SSE2__)
+#define SOFTWARE_MIXER_SSE2
+#include <emmintrin.h>
+#elif defined(_M_ARM) || defined(__ARM_NEON__) || defined(__ARM_NEON)
+#define SOFTWARE_MIXER_NEON
+#include <arm_neon.h>
+#endif
+
+namespace
+{
+	// Converts a 16-bit sample to the -1 to 1 range.
+	const float Int16Scale = 1.0f / 32768.0f;
+
+	// The number of commands the ring holds per voice. A play, a stop and a couple of gain changes per voice between two Render calls fit
+	// without spilling into the overflow list.
+	const size_t CommandsPerVoice = 4;
+
+	// Reads one sample of either type as a float in the -1 to 1 range.
+	inline float ReadSample(const void* data, DX::AudioSampleType type, size_t index)
+	{
+		if (type == DX::AudioSampleType::Int16)
+		{
+			return static_cast<const int16_t*>(data)[index] * Int16Scale;
+		}
+
+		return static_cast<const float*>(data)[index];
+	}
+
+	// Mixes frames with the scalar code. Used for whatever the SIMD loop leaves over, and for everything on other targets.
+	// source - The first frame's samples.
+	// type - The type of the samples.
+	// channels - The number of channels in the source. 1 or 2.
+	// output - The first frame of interleaved stereo output to add to.
+	// frameCount - The number of frames.
+	// left, right - The gains for the first frame. Advanced by the steps for each frame.
+	// leftStep, rightStep - The change in the gains per frame.
+	void MixFramesScalar(const void* source, DX::AudioSampleType type, uint32_t channels, float* output, uint32_t frameCount,
+		float& left, float& right, float leftStep, float rightStep)
+	{
+		for (uint32_t frame = 0; frame < frameCount; ++frame)
+		{
+			float sourceLeft = ReadSample(source, type, frame * channels);
+			float sourceRight = (channels == 2) ? ReadSample(source, type, (frame * 2) + 1) : sourceLeft;
+
+			output[frame * 2] += sourceLeft * left;
+			output[(frame * 2) + 1] += sourceRight * right;
+
+			left += leftStep;
+			right += rightStep;
+		}
+	}
+
+#if defined(SOFTWARE_MIXER_SSE2)
+	typedef __m128 Float4;
+
+	inline __m128 LoadGains(float left, float right, float leftStep, float rightStep)
+	{
+		return _mm_setr_ps(left, right, left + leftStep, right + rightStep);
+	}
+
+	inline __m128 Add(__m128 left, __m128 right) { return _mm_add_ps(left, right); }
+
+	// Adds samples times gains to four floats of output.
+	inline void Accumulate(float* output, __m128 samples, __m128 gains)
+	{
+		_mm_storeu_ps(output, _mm_add_ps(_mm_loadu_ps(output), _mm_mul_ps(samples, gains)));
+	}
+
+	// Loads four 16-bit samples as floats in the -1 to 1 range.
+	inline __m128 LoadInt16(const int16_t* source)
+	{
+		__m128i samples = _mm_loadl_epi64(reinterpret_cast<const __m128i*>(source));
+		return _mm_mul_ps(_mm_cvtepi32_ps(_mm_srai_epi32(_mm_unpacklo_epi16(samples, samples), 16)), _mm_set1_ps(Int16Scale));
+	}
+
+	inline __m128 LoadFloat(const float* source) { return _mm_loadu_ps(source); }
+
+	// Turns four mono samples into two vectors of stereo frames: (s0 s0 s1 s1) and (s2 s2 s3 s3).
+	inline void DuplicateMono(__m128 samples, __m128& first, __m128& second)
+	{
+		first = _mm_unpacklo_ps(samples, samples);
+		second = _mm_unpackhi_ps(samples, samples);
+	}
+#elif defined(SOFTWARE_MIXER_NEON)
+	typedef float32x4_t Float4;
+
+	inline float32x4_t LoadGains(float left, float right, float leftStep, float rightStep)
+	{
+		const float gains[4] = { left, right, left + leftStep, right + rightStep };
+		return vld1q_f32(gains);
+	}
+
+	inline float32x4_t Add(float32x4_t left, float32x4_t right) { return vaddq_f32(left, right); }
+
+	// Adds samples times gains to four floats of output.
+	inline void Accumulate(float* output, float32x4_t samples, float32x4_t gains)
+	{
+		vst1q_f32(output, vmlaq_f32(vld1q_f32(output), samples, gains));
+	}
+
+	// Loads four 16-bit samples as floats in the -1 to 1 range.
+	inline float32x4_t LoadInt16(const int16_t* source)
+	{
+		return vmulq_n_f32(vcvtq_f32_s32(vmovl_s16(vld1_s16(source))), Int16Scale);
+	}
+
+	inline float32x4_t LoadFloat(const float* source) { return vld1q_f32(source); }
+
+	// Turns four mono samples into two vectors of stereo frames: (s0 s0 s1 s1) and (s2 s2 s3 s3).
+	inline void DuplicateMono(float32x4_t samples, float32x4_t& first, float32x4_t& second)
+	{
+		float32x4x2_t zipped = vzipq_f32(samples, samples);
+		first = zipped.val[0];
+		second = zipped.val[1];
+	}
+#endif
+
+#if defined(SOFTWARE_MIXER_SSE2) || defined(SOFTWARE_MIXER_NEON)
+	// Loads the four samples at source, whatever their type.
+	inline Float4 LoadSamples(const void* source, DX::AudioSampleType type, size_t index)
+	{
+		if (type == DX::AudioSampleType::Int16)
+		{
+			return LoadInt16(static_cast<const int16_t*>(source) + index);
+		}
+
+		return LoadFloat(static_cast<const float*>(source) + index);
+	}
+
+	// Mixes frames four at a time. Each output vector holds two stereo frames, so the gains are kept as (left, right, left + step,
+	// right + step) and advanced by two steps per vector. The frames that don't make a whole group of four are left for MixFramesScalar.
+	// The parameters are the same as MixFramesScalar's. Returns the number of frames that were mixed.
+	uint32_t MixFramesSimd(const void* source, DX::AudioSampleType type, uint32_t channels, float* output, uint32_t frameCount,
+		float& left, float& right, float leftStep, float rightStep)
+	{
+		uint32_t groupCount = frameCount / 4;
+		if (groupCount == 0)
+		{
+			return 0;
+		}
+
+		Float4 gains = LoadGains(left, right, leftStep, rightStep);
+		// Every lane moves on by two frames' worth of step. (LoadGains adds the step to the upper lanes itself, so they get no extra step here.)
+		const Float4 step = LoadGains(2.0f * leftStep, 2.0f * rightStep, 0.0f, 0.0f);
+
+		if (channels == 1)
+		{
+			for (uint32_t group = 0; group < groupCount; ++group)
+			{
+				Float4 first;
+				Float4 second;
+				DuplicateMono(LoadSamples(source, type, group * 4), first, second);
+
+				Accumulate(output + (group * 8), first, gains);
+				gains = Add(gains, step);
+				Accumulate(output + (group * 8) + 4, second, gains);
+				gains = Add(gains, step);
+			}
+		}
+		else
+		{
+			for (uint32_t group = 0; group < groupCount; ++group)
+			{
+				Accumulate(output + (group * 8), LoadSamples(source, type, group * 8), gains);
+				gains = Add(gains, step);
+				Accumulate(output + (group * 8) + 4, LoadSamples(source, type, (group * 8) + 4), gains);
+				gains = Add(gains, step);
+			}
+		}
+
+		// Work the gains for the next frame out directly rather than reading them back out of the vector, so the result doesn't depend on how
+		// the frames were split between the SIMD and scalar code any more than rounding already makes it.
+		uint32_t mixed = groupCount * 4;
+		left += leftStep * mixed;
+		right += rightStep * mixed;
+
+		return mixed;
+	}
+#endif
+
+	// Mixes frames with the fastest code the target has.
+	void MixFrames(const void* source, DX::AudioSampleType type, uint32_t channels, float* output, uint32_t frameCount,
+		float& left, float& right, float leftStep, float rightStep)
+	{
+		uint32_t mixed = 0;
+#if defined(SOFTWARE_MIXER_SSE2) || defined(SOFTWARE_MIXER_NEON)
+		mixed = MixFramesSimd(source, type, channels, output, frameCount, left, right, leftStep, rightStep);
+#endif
+
+		if (mixed < frameCount)
+		{
+			size_t sampleSize = (type == DX::AudioSampleType::Int16) ? sizeof(int16_t) : sizeof(float);
+			MixFramesScalar(static_cast<const uint8_t*>(source) + (static_cast<size_t>(mixed) * channels * sampleSize), type, channels,
+				output + (static_cast<size_t>(mixed) * 2), frameCount - mixed, left, right, leftStep, rightStep);
+		}
+	}
+}
+
+DX::SoftwareMixer::SoftwareMixer(uint32_t sampleRate, uint32_t maxVoices) :
+	m_sampleRate(sampleRate),
+	m_voices(maxVoices),
+	m_freeVoices(),
+	m_overflowCommands(),
+	m_commands(static_cast<size_t>(maxVoices) * CommandsPerVoice),
+	m_finished(maxVoices),
+	m_mixVoices(maxVoices),
+	m_activeVoices(),
+	m_masterVolume(1.0f),
+	m_renderedMasterVolume(1.0f),
+	m_paused(false)
+{
+	// Hand out the lowest voices first.
+	m_freeVoices.reserve(maxVoices);
+	for (uint32_t i = maxVoices; i > 0; --i)
+	{
+		m_freeVoices.push_back(i - 1);
+	}
+
+	m_activeVoices.reserve(maxVoices);
+	m_overflowCommands.reserve(static_cast<size_t>(maxVoices) * CommandsPerVoice);
+
+	for (auto& voice : m_voices)
+	{
+		voice.m_generation = 0;
+		voice.m_channels = 0;
+		voice.m_playing = false;
+	}
+}
+
+DX::SoftwareMixer::~SoftwareMixer()
+{
+}
+
+DX::AudioVoiceHandle DX::SoftwareMixer::Play(const AudioSound& sound, uint32_t loopCount, float volume, float pan)
+{
+	AudioVoiceHandle handle;
+
+	if (m_freeVoices.empty() || sound.m_data == nullptr || sound.m_frameCount == 0 || sound.m_channels < 1 || sound.m_channels > 2 ||
+		sound.m_sampleRate != m_sampleRate)
+	{
+		return handle;
+	}
+
+	uint32_t index = m_freeVoices.back();
+	m_freeVoices.pop_back();
+
+	auto& voice = m_voices[index];
+	++voice.m_generation;
+	voice.m_channels = sound.m_channels;
+	voice.m_playing = true;
+
+	MixerCommand command;
+	std::memset(&command, 0, sizeof(command));
+	command.m_type = CommandType::Play;
+	command.m_voice = index;
+	command.m_generation = voice.m_generation;
+	command.m_loopCount = loopCount;
+	command.m_sound = sound;
+	GetGains(sound.m_channels, volume, pan, command.m_left, command.m_right);
+	QueueCommand(command);
+
+	handle.m_index = index;
+	handle.m_generation = voice.m_generation;
+	return handle;
+}
+
+void DX::SoftwareMixer::Stop(AudioVoiceHandle voice)
+{
+	if (!IsPlaying(voice))
+	{
+		return;
+	}
+
+	// The voice stays out of the free list until Render confirms that it has stopped mixing it.
+	MixerCommand command;
+	std::memset(&command, 0, sizeof(command));
+	command.m_type = CommandType::Stop;
+	command.m_voice = voice.m_index;
+	command.m_generation = voice.m_generation;
+	QueueCommand(command);
+}
+
+void DX::SoftwareMixer::SetVolumeAndPan(AudioVoiceHandle voice, float volume, float pan)
+{
+	if (!IsPlaying(voice))
+	{
+		return;
+	}
+
+	MixerCommand command;
+	std::memset(&command, 0, sizeof(command));
+	command.m_type = CommandType::SetGains;
+	command.m_voice = voice.m_index;
+	command.m_generation = voice.m_generation;
+	GetGains(m_voices[voice.m_index].m_channels, volume, pan, command.m_left, command.m_right);
+	QueueCommand(command);
+}
+
+void DX::SoftwareMixer::SetMasterVolume(float volume)
+{
+	MixerCommand command;
+	std::memset(&command, 0, sizeof(command));
+	command.m_type = CommandType::SetMasterVolume;
+	command.m_left = volume;
+	QueueCommand(command);
+}
+
+void DX::SoftwareMixer::Pause()
+{
+	MixerCommand command;
+	std::memset(&command, 0, sizeof(command));
+	command.m_type = CommandType::Pause;
+	QueueCommand(command);
+}
+
+void DX::SoftwareMixer::Resume()
+{
+	MixerCommand command;
+	std::memset(&command, 0, sizeof(command));
+	command.m_type = CommandType::Resume;
+	QueueCommand(command);
+}
+
+bool DX::SoftwareMixer::IsPlaying(AudioVoiceHandle voice) const
+{
+	return voice.m_index < m_voices.size() && m_voices[voice.m_index].m_playing && m_voices[voice.m_index].m_generation == voice.m_generation;
+}
+
+void DX::SoftwareMixer::Update()
+{
+	uint32_t index;
+	while (m_finished.TryPop(index))
+	{
+		m_voices[index].m_playing = false;
+		m_freeVoices.push_back(index);
+	}
+
+	// Move as many of the overflowed commands into the ring as now fit, keeping their order.
+	size_t moved = 0;
+	while (moved < m_overflowCommands.size() && m_commands.TryPush(m_overflowCommands[moved]))
+	{
+		++moved;
+	}
+	m_overflowCommands.erase(m_overflowCommands.begin(), m_overflowCommands.begin() + moved);
+}
+
+void DX::SoftwareMixer::Render(float* output, uint32_t frameCount)
+{
+	ProcessCommands();
+
+	std::memset(output, 0, static_cast<size_t>(frameCount) * OutputChannels * sizeof(float));
+	if (m_paused || frameCount == 0)
+	{
+		return;
+	}
+
+	// Mix every active voice, dropping the ones that end from the packed list as it goes (the last one is moved into the gap).
+	size_t i = 0;
+	while (i < m_activeVoices.size())
+	{
+		uint32_t index = m_activeVoices[i];
+		if (MixVoiceFrames(m_mixVoices[index], output, frameCount))
+		{
+			++i;
+			continue;
+		}
+
+		m_activeVoices[i] = m_activeVoices.back();
+		m_activeVoices.pop_back();
+		m_finished.TryPush(index);
+	}
+
+	m_renderedMasterVolume = m_masterVolume;
+}
+
+void DX::SoftwareMixer::GetGains(uint32_t channels, float volume, float pan, float& left, float& right)
+{
+	pan = (pan < -1.0f) ? -1.0f : ((pan > 1.0f) ? 1.0f : pan);
+
+	if (channels == 1)
+	{
+		// Constant power: the sum of the squares of the gains stays the same wherever the sound is panned.
+		const float quarterPi = 0.785398163f;
+		float angle = (pan + 1.0f) * quarterPi;
+		left = volume * std::cos(angle);
+		right = volume * std::sin(angle);
+	}
+	else
+	{
+		// Balance: turn the far channel down and leave the near one alone.
+		left = volume * ((pan > 0.0f) ? 1.0f - pan : 1.0f);
+		right = volume * ((pan < 0.0f) ? 1.0f + pan : 1.0f);
+	}
+}
+
+void DX::SoftwareMixer::QueueCommand(const MixerCommand& command)
+{
+	// Keep the commands in order: once one has overflowed the rest follow it until Update moves them into the queue.
+	if (!m_overflowCommands.empty() || !m_commands.TryPush(command))
+	{
+		m_overflowCommands.push_back(command);
+	}
+}
+
+void DX::SoftwareMixer::ProcessCommands()
+{
+	MixerCommand command;
+	while (m_commands.TryPop(command))
+	{
+		switch (command.m_type)
+		{
+		case CommandType::Play:
+			{
+				auto& voice = m_mixVoices[command.m_voice];
+				auto& sound = command.m_sound;
+
+				voice.m_sound = sound;
+				voice.m_generation = command.m_generation;
+				voice.m_position = 0;
+				voice.m_left = command.m_left;
+				voice.m_right = command.m_right;
+				voice.m_targetLeft = command.m_left;
+				voice.m_targetRight = command.m_right;
+				voice.m_started = false;
+
+				// A loop region that doesn't fit in the sound is clipped to it, and an empty one covers the rest of the sound.
+				uint32_t loopBegin = (sound.m_loopBegin < sound.m_frameCount) ? sound.m_loopBegin : 0U;
+				uint32_t loopLength = (sound.m_loopLength != 0 && sound.m_loopLength <= sound.m_frameCount - loopBegin) ?
+					sound.m_loopLength : sound.m_frameCount - loopBegin;
+				voice.m_sound.m_loopBegin = loopBegin;
+				voice.m_loopEnd = (command.m_loopCount != 0) ? loopBegin + loopLength : sound.m_frameCount;
+				voice.m_loopsLeft = command.m_loopCount;
+
+				m_activeVoices.push_back(command.m_voice);
+			}
+			break;
+
+		case CommandType::Stop:
+			{
+				// The voice may have ended by itself since the command was queued, in which case it is already gone.
+				auto& voice = m_mixVoices[command.m_voice];
+				if (voice.m_generation != command.m_generation)
+				{
+					break;
+				}
+
+				auto active = std::find(m_activeVoices.begin(), m_activeVoices.end(), command.m_voice);
+				if (active != m_activeVoices.end())
+				{
+					*active = m_activeVoices.back();
+					m_activeVoices.pop_back();
+					m_finished.TryPush(command.m_voice);
+				}
+			}
+			break;
+
+		case CommandType::SetGains:
+			{
+				auto& voice = m_mixVoices[command.m_voice];
+				if (voice.m_generation == command.m_generation)
+				{
+					voice.m_targetLeft = command.m_left;
+					voice.m_targetRight = command.m_right;
+				}
+			}
+			break;
+
+		case CommandType::SetMasterVolume:
+			m_masterVolume = command.m_left;
+			break;
+
+		case CommandType::Pause:
+			m_paused = true;
+			break;
+
+		case CommandType::Resume:
+			m_paused = false;
+			break;
+		}
+	}
+}
+
+bool DX::SoftwareMixer::MixVoiceFrames(MixVoice& voice, float* output, uint32_t frameCount)
+{
+	// Ramp from the gains the last Render ended with to the targets over this call. A voice's first Render starts at its targets.
+	float startMaster = voice.m_started ? m_renderedMasterVolume : m_masterVolume;
+	float left = voice.m_started ? voice.m_left * startMaster : voice.m_targetLeft * m_masterVolume;
+	float right = voice.m_started ? voice.m_right * startMaster : voice.m_targetRight * m_masterVolume;
+	float leftStep = ((voice.m_targetLeft * m_masterVolume) - left) / frameCount;
+	float rightStep = ((voice.m_targetRight * m_masterVolume) - right) / frameCount;
+
+	voice.m_left = voice.m_targetLeft;
+	voice.m_right = voice.m_targetRight;
+	voice.m_started = true;
+
+	auto& sound = voice.m_sound;
+	size_t sampleSize = (sound.m_sampleType == AudioSampleType::Int16) ? sizeof(int16_t) : sizeof(float);
+	uint32_t done = 0;
+
+	while (done < frameCount)
+	{
+		// Mix up to the end of the loop region (or of the sound), then jump back or stop.
+		uint32_t count = voice.m_loopEnd - voice.m_position;
+		if (count > frameCount - done)
+		{
+			count = frameCount - done;
+		}
+
+		auto source = static_cast<const uint8_t*>(sound.m_data) + (static_cast<size_t>(voice.m_position) * sound.m_channels * sampleSize);
+		MixFrames(source, sound.m_sampleType, sound.m_channels, output + (static_cast<size_t>(done) * OutputChannels), count,
+			left, right, leftStep, rightStep);
+
+		done += count;
+		voice.m_position += count;
+
+		if (voice.m_position == voice.m_loopEnd)
+		{
+			if (voice.m_loopsLeft == 0)
+			{
+				// The loop count has run out, so play whatever follows the loop region and then end.
+				if (voice.m_loopEnd == sound.m_frameCount)
+				{
+					return false;
+				}
+				voice.m_loopEnd = sound.m_frameCount;
+				continue;
+			}
+
+			voice.m_position = sound.m_loopBegin;
+			if (voice.m_loopsLeft != LoopInfinite)
+			{
+				--voice.m_loopsLeft;
+			}
+		}
+	}
+
+	return true;
+}
@@ -0,0 +1,166 @@
+#pragma once
+
+// Portable (see README_PORTABLE.txt). It needs no device or thread of its own, so it can render headless.
+#include <cstdint>
+#include <vector>
+
+#include "IAudioBackend.h"
+#include "SpscRing.h"
+
+namespace DX
+{
+	// A portable IAudioBackend that mixes its voices in software into 32-bit float stereo. Whoever owns the output calls Render with a buffer to
+	// fill (an audio device callback, or a test or benchmark that just wants the samples), so the mixer has no thread or device of its own.
+	//
+	// The game thread and the render thread never share a voice. The game thread sends play, stop and gain commands over a lock-free single
+	// producer single consumer ring (see SpscRing) and Render carries them out before it mixes. Render keeps its own packed list of the active
+	// voices and sends the index of each voice that finishes back over a second ring, which Update drains to return the voices to the free list.
+	// A voice is only reused after that, so every play gets exactly one finish notification and the second ring can never fill up.
+	//
+	// The mixing itself is SSE2 (x86/x64) or NEON (ARM), with a scalar fallback: each voice's samples are converted to float, scaled by the
+	// voice's left and right gains and added to the output, four frames at a time. Gain changes are ramped over one Render call so they don't
+	// click. Sounds must already be at the mixer's sample rate; Play fails for any other rate.
+	//
+	// The game doesn't use the mixer (see IAudioBackend for why); AudioEngine plays everything through XAudio2. It runs headless in PortableTests'
+	// SoftwareMixerTests and SoftwareMixerBenchmark, which test and profile the mixing without Windows.
+	class SoftwareMixer : public IAudioBackend
+	{
+	public:
+		// The number of output channels. The output is always interleaved stereo.
+		static const uint32_t OutputChannels = 2;
+
+		// Constructor. Allocates everything the mixer will ever need, so neither Render nor any of the game thread methods allocate.
+		// sampleRate - The output sample rate. Every sound that is played must have this rate.
+		// maxVoices - The most voices that can play at once.
+		SoftwareMixer(uint32_t sampleRate, uint32_t maxVoices);
+
+		virtual ~SoftwareMixer();
+
+		// Returns the output sample rate.
+		uint32_t GetSampleRate() const { return m_sampleRate; }
+
+		// Returns the most voices that can play at once.
+		uint32_t GetMaxVoices() const { return static_cast<uint32_t>(m_voices.size()); }
+
+		// Returns the number of voices that are playing, as of the last call to Update.
+		uint32_t GetActiveVoiceCount() const { return static_cast<uint32_t>(m_voices.size() - m_freeVoices.size()); }
+
+		virtual AudioVoiceHandle Play(const AudioSound& sound, uint32_t loopCount, float volume, float pan) override;
+		virtual void Stop(AudioVoiceHandle voice) override;
+		virtual void SetVolumeAndPan(AudioVoiceHandle voice, float volume, float pan) override;
+		virtual void SetMasterVolume(float volume) override;
+		virtual void Pause() override;
+		virtual void Resume() override;
+		virtual bool IsPlaying(AudioVoiceHandle voice) const override;
+		virtual void Update() override;
+
+		// Mixes the next frameCount frames of every playing voice into output. Paused output is silence. Call from one thread at a time (it can
+		// be a different thread to the game thread).
+		// output - Receives frameCount frames of interleaved stereo. Overwritten, not added to. Does not need to be aligned.
+		// frameCount - The number of frames to render.
+		void Render(float* output, uint32_t frameCount);
+
+	private:
+		// The kinds of MixerCommand.
+		enum class CommandType : uint32_t
+		{
+			Play,
+			Stop,
+			SetGains,
+			SetMasterVolume,
+			Pause,
+			Resume,
+		};
+
+		// A command from the game thread to Render.
+		struct MixerCommand
+		{
+			CommandType				m_type;
+			// The voice. Unused by the commands that aren't for a voice.
+			uint32_t				m_voice;
+			// The generation of the play the command is for. Render skips commands for any other play.
+			uint32_t				m_generation;
+			// Play: the loop count.
+			uint32_t				m_loopCount;
+			// Play and SetGains: the left and right gains. SetMasterVolume: the volume is in m_left.
+			float					m_left;
+			float					m_right;
+			// Play: the sound.
+			AudioSound				m_sound;
+		};
+
+		// The game thread's view of a voice.
+		struct GameVoice
+		{
+			// Bumped each time the voice starts a play.
+			uint32_t				m_generation;
+			// The number of channels in the sound that is playing, which decides the pan law.
+			uint32_t				m_channels;
+			// True from Play until Update sees the play's finish notification.
+			bool					m_playing;
+		};
+
+		// Render's view of a voice. Only Render touches these.
+		struct MixVoice
+		{
+			// The sound that is playing.
+			AudioSound				m_sound;
+			// The generation of the play.
+			uint32_t				m_generation;
+			// The next frame to mix.
+			uint32_t				m_position;
+			// The end of the loop region (exclusive).
+			uint32_t				m_loopEnd;
+			// The number of times left to jump back to the start of the loop region, or LoopInfinite.
+			uint32_t				m_loopsLeft;
+			// The gains that the last Render ended with and the gains that the next one ramps to (before the master volume is applied).
+			float					m_left;
+			float					m_right;
+			float					m_targetLeft;
+			float					m_targetRight;
+			// True once a Render has mixed the voice (the first one starts at the target gains instead of ramping up to them).
+			bool					m_started;
+		};
+
+		// Turns a volume and a pan into left and right gains. Mono sounds are panned with constant power; stereo sounds are balanced.
+		static void GetGains(uint32_t channels, float volume, float pan, float& left, float& right);
+
+		// Queues a command for Render, keeping the commands in order.
+		void QueueCommand(const MixerCommand& command);
+
+		// Carries out the commands that the game thread has queued. Render only.
+		void ProcessCommands();
+
+		// Mixes frameCount frames of one voice into output and advances it. Returns false if the voice's sound has ended. Render only.
+		bool MixVoiceFrames(MixVoice& voice, float* output, uint32_t frameCount);
+
+		// Disable copy constructor.
+		SoftwareMixer(const SoftwareMixer&);
+		// Disable copy assignment.
+		SoftwareMixer& operator=(const SoftwareMixer&);
+
+		// The output sample rate.
+		uint32_t							m_sampleRate;
+
+		// Game thread state: each voice's generation and the voices that aren't playing.
+		std::vector<GameVoice>				m_voices;
+		std::vector<uint32_t>				m_freeVoices;
+
+		// Commands that didn't fit in m_commands, oldest first. Update moves them into the ring as it empties.
+		std::vector<MixerCommand>			m_overflowCommands;
+
+		// Game thread to Render.
+		SpscRing<MixerCommand>				m_commands;
+
+		// Render to game thread: the index of each voice whose play has finished.
+		SpscRing<uint32_t>					m_finished;
+
+		// Render state: every voice, the indices of the active ones (packed, in no particular order), the master volume and the master
+		// volume that the last Render ended with (for ramping), and whether the output is paused.
+		std::vector<MixVoice>				m_mixVoices;
+		std::vector<uint32_t>				m_activeVoices;
+		float								m_masterVolume;
+		float								m_renderedMasterVolume;
+		bool								m_paused;
+	};
+}
@@ -0,0 +1,230 @@
+#include "SoundBank.h"
+
+#include <algorithm>
+#include <cstring>
+
+namespace
+{
+	// Rounds a value up to a multiple of alignment (a power of two).
+	inline uint64_t AlignUp(uint64_t value, uint64_t alignment)
+	{
+		return (value + alignment - 1) & ~(alignment - 1);
+	}
+
+	// The alignment of each format in the file.
+	const uint32_t FormatAlignment = 8;
+
+	// The size of a PCMWAVEFORMAT, the shortest valid format.
+	const uint32_t MinimumFormatSize = 16;
+
+	// Returns true if [offset, offset + size) lies within a file of fileSize bytes.
+	inline bool IsInFile(uint64_t offset, uint64_t size, uint64_t fileSize)
+	{
+		return offset <= fileSize && size <= fileSize - offset;
+	}
+}
+
+uint64_t DX::HashSoundName(
+	const wchar_t* name,
+	size_t length
+	)
+{
+	uint64_t hash = 14695981039346656037ULL;
+	for (size_t i = 0; i < length; ++i)
+	{
+		auto ch = static_cast<uint16_t>(name[i]);
+		if (ch >= L'A' && ch <= L'Z')
+		{
+			ch = static_cast<uint16_t>(ch - L'A' + L'a');
+		}
+		else if (ch == L'/')
+		{
+			ch = L'\\';
+		}
+
+		// Hash both bytes of the code unit so that the result doesn't depend on the size of wchar_t.
+		hash = (hash ^ (ch & 0xFF)) * 1099511628211ULL;
+		hash = (hash ^ (ch >> 8)) * 1099511628211ULL;
+	}
+
+	return hash;
+}
+
+DX::SoundBank::SoundBank() :
+	m_data(nullptr),
+	m_entries(nullptr),
+	m_entryCount()
+{
+}
+
+bool DX::SoundBank::SaveToMemory(
+	const std::vector<SoundBankSource>& sources,
+	std::vector<uint8_t>& data
+	)
+{
+	data.clear();
+
+	// The entries are sorted by name hash so that Find can use a binary search.
+	std::vector<SoundBankEntry> entries(sources.size());
+	std::vector<size_t> order(sources.size());
+	for (size_t i = 0; i < sources.size(); ++i)
+	{
+		entries[i].m_nameHash = HashSoundName(sources[i].m_name.c_str(), sources[i].m_name.size());
+		order[i] = i;
+	}
+	std::sort(order.begin(), order.end(), [&entries](size_t left, size_t right) { return entries[left].m_nameHash < entries[right].m_nameHash; });
+
+	for (size_t i = 1; i < order.size(); ++i)
+	{
+		if (entries[order[i]].m_nameHash == entries[order[i - 1]].m_nameHash)
+		{
+			return false;
+		}
+	}
+
+	// Lay out the file: header, entries, names, formats, audio data.
+	uint64_t offset = sizeof(SoundBankFileHeader) + (static_cast<uint64_t>(sources.size()) * sizeof(SoundBankEntry));
+	for (size_t i = 0; i < sources.size(); ++i)
+	{
+		entries[i].m_nameOffset = static_cast<uint32_t>(offset);
+		entries[i].m_nameLength = static_cast<uint32_t>(sources[i].m_name.size());
+		offset += sources[i].m_name.size() * sizeof(uint16_t);
+	}
+	for (size_t i = 0; i < sources.size(); ++i)
+	{
+		offset = AlignUp(offset, FormatAlignment);
+		entries[i].m_formatOffset = static_cast<uint32_t>(offset);
+		entries[i].m_formatSize = static_cast<uint32_t>(sources[i].m_format.size());
+		offset += sources[i].m_format.size();
+	}
+	for (size_t i = 0; i < sources.size(); ++i)
+	{
+		offset = AlignUp(offset, SoundBankDataAlignment);
+		entries[i].m_dataOffset = static_cast<uint32_t>(offset);
+		entries[i].m_dataSize = static_cast<uint32_t>(sources[i].m_audioData.size());
+		entries[i].m_loopBegin = sources[i].m_loopLength != 0 ? sources[i].m_loopBegin : 0;
+		entries[i].m_loopLength = sources[i].m_loopLength;
+		offset += sources[i].m_audioData.size();
+	}
+
+	// The offsets are 32-bit.
+	if (offset > 0xFFFFFFFFULL)
+	{
+		return false;
+	}
+
+	data.assign(static_cast<size_t>(offset), 0);
+
+	SoundBankFileHeader header;
+	header.m_magic = SoundBankFileMagic;
+	header.m_version = SoundBankFileVersion;
+	header.m_entryCount = static_cast<uint32_t>(sources.size());
+	header.m_reserved = 0;
+	std::memcpy(data.data(), &header, sizeof(header));
+
+	for (size_t i = 0; i < order.size(); ++i)
+	{
+		auto& source = sources[order[i]];
+		auto& entry = entries[order[i]];
+		std::memcpy(data.data() + sizeof(header) + (i * sizeof(SoundBankEntry)), &entry, sizeof(entry));
+
+		// Names are written one code unit at a time since wchar_t isn't 16 bits everywhere.
+		for (size_t j = 0; j < source.m_name.size(); ++j)
+		{
+			auto ch = static_cast<uint16_t>(source.m_name[j]);
+			std::memcpy(data.data() + entry.m_nameOffset + (j * sizeof(uint16_t)), &ch, sizeof(ch));
+		}
+
+		if (!source.m_format.empty())
+		{
+			std::memcpy(data.data() + entry.m_formatOffset, source.m_format.data(), source.m_format.size());
+		}
+
+		if (!source.m_audioData.empty())
+		{
+			std::memcpy(data.data() + entry.m_dataOffset, source.m_audioData.data(), source.m_audioData.size());
+		}
+	}
+
+	return true;
+}
+
+bool DX::SoundBank::LoadFromMemory(
+	const void* data,
+	size_t size
+	)
+{
+	Reset();
+
+	SoundBankFileHeader header;
+	if (data == nullptr || size < sizeof(header) || (reinterpret_cast<uintptr_t>(data) % FormatAlignment) != 0)
+	{
+		return false;
+	}
+
+	std::memcpy(&header, data, sizeof(header));
+	if (header.m_magic != SoundBankFileMagic || header.m_version != SoundBankFileVersion || header.m_reserved != 0 ||
+		!IsInFile(sizeof(header), static_cast<uint64_t>(header.m_entryCount) * sizeof(SoundBankEntry), size))
+	{
+		return false;
+	}
+
+	auto bytes = static_cast<const uint8_t*>(data);
+	auto entries = reinterpret_cast<const SoundBankEntry*>(bytes + sizeof(header));
+
+	for (uint32_t i = 0; i < header.m_entryCount; ++i)
+	{
+		auto& entry = entries[i];
+
+		if ((i > 0 && entry.m_nameHash <= entries[i - 1].m_nameHash) ||
+			(entry.m_nameOffset % sizeof(uint16_t)) != 0 ||
+			!IsInFile(entry.m_nameOffset, static_cast<uint64_t>(entry.m_nameLength) * sizeof(uint16_t), size) ||
+			(entry.m_formatOffset % FormatAlignment) != 0 ||
+			entry.m_formatSize < MinimumFormatSize ||
+			!IsInFile(entry.m_formatOffset, entry.m_formatSize, size) ||
+			(entry.m_dataOffset % SoundBankDataAlignment) != 0 ||
+			!IsInFile(entry.m_dataOffset, entry.m_dataSize, size) ||
+			(entry.m_loopLength == 0 && entry.m_loopBegin != 0) ||
+			entry.m_loopBegin > 0xFFFFFFFFU - entry.m_loopLength)
+		{
+			return false;
+		}
+
+		// The block alignment (WAVEFORMATEX::nBlockAlign) must not be zero.
+		uint16_t blockAlign;
+		std::memcpy(&blockAlign, bytes + entry.m_formatOffset + 12, sizeof(blockAlign));
+		if (blockAlign == 0)
+		{
+			return false;
+		}
+	}
+
+	m_data = bytes;
+	m_entries = entries;
+	m_entryCount = header.m_entryCount;
+
+	return true;
+}
+
+void DX::SoundBank::Reset()
+{
+	m_data = nullptr;
+	m_entries = nullptr;
+	m_entryCount = 0;
+}
+
+bool DX::SoundBank::Find(
+	uint64_t nameHash,
+	uint32_t& index
+	) const
+{
+	auto end = m_entries + m_entryCount;
+	auto entry = std::lower_bound(m_entries, end, nameHash, [](const SoundBankEntry& left, uint64_t right) { return left.m_nameHash < right; });
+	if (entry == end || entry->m_nameHash != nameHash)
+	{
+		return false;
+	}
+
+	index = static_cast<uint32_t>(entry - m_entries);
+	return true;
+}
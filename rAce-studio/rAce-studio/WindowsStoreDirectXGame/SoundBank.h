@@ -0,0 +1,139 @@
+#pragma once
+
+// Portable (see README_PORTABLE.txt). SoundBankBuilder uses it to write .sbank files.
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace DX
+{
+	// The header at the start of a .sbank sound bank file. It is followed by m_entryCount SoundBankEntry structures (sorted by name hash), then the
+	// names, then the formats, and then the audio data. Everything is little-endian.
+	struct SoundBankFileHeader
+	{
+		// Must be SoundBankFileMagic.
+		uint32_t				m_magic;
+		// Must be SoundBankFileVersion.
+		uint32_t				m_version;
+		// The number of sounds in the bank.
+		uint32_t				m_entryCount;
+		// Reserved. Must be zero.
+		uint32_t				m_reserved;
+	};
+
+	// Describes one sound in a .sbank file. The offsets are from the start of the file.
+	struct SoundBankEntry
+	{
+		// The hash of the sound's name. See HashSoundName.
+		uint64_t				m_nameHash;
+		// The offset and length (in UTF-16 code units, with no terminator) of the sound's name, e.g. "somedir\\laser.wav".
+		uint32_t				m_nameOffset;
+		uint32_t				m_nameLength;
+		// The offset and size of the sound's format (the contents of its WAV file's 'fmt ' chunk). The offset is a multiple of 8.
+		uint32_t				m_formatOffset;
+		uint32_t				m_formatSize;
+		// The offset and size of the sound's audio data. The offset is a multiple of SoundBankDataAlignment.
+		uint32_t				m_dataOffset;
+		uint32_t				m_dataSize;
+		// The first sample and the number of samples of the sound's loop region. Both are zero if the sound has no loop region.
+		uint32_t				m_loopBegin;
+		uint32_t				m_loopLength;
+	};
+
+	// The first four bytes of a .sbank file ("SBNK").
+	const uint32_t SoundBankFileMagic = 0x4B4E4253;
+
+	// The version of the .sbank format that this code reads and writes.
+	const uint32_t SoundBankFileVersion = 1;
+
+	// The alignment of each sound's audio data in a .sbank file. A cache line, so that SIMD code can read the data in place.
+	const uint32_t SoundBankDataAlignment = 64;
+
+	// Hashes a sound's name (64-bit FNV-1a). The hash is case insensitive for ASCII letters and treats '/' the same as '\\' so that "Sounds/Laser.wav"
+	// and "sounds\\laser.wav" find the same sound.
+	// name - The name. Each character is used as a UTF-16 code unit.
+	// length - The number of characters in the name.
+	uint64_t HashSoundName(
+		const wchar_t* name,
+		size_t length
+		);
+
+	// A sound to put in a sound bank. Used by SoundBank::SaveToMemory.
+	struct SoundBankSource
+	{
+		// The sound's name, e.g. "somedir\\laser.wav".
+		std::wstring			m_name;
+		// The contents of the sound's 'fmt ' chunk.
+		std::vector<uint8_t>	m_format;
+		// The sound's audio data.
+		std::vector<uint8_t>	m_audioData;
+		// The first sample of the sound's loop region.
+		uint32_t				m_loopBegin;
+		// The number of samples in the sound's loop region, or zero for no loop region.
+		uint32_t				m_loopLength;
+	};
+
+	// A read-only view of a .sbank sound bank, normally one that has been memory mapped. A sound bank holds many sounds in one file so that
+	// loading them costs one file open instead of one per sound, and each sound's audio data can be played straight from the mapping. The
+	// SoundBank does not copy the file data, so the data must outlive it.
+	class SoundBank
+	{
+	public:
+		// Constructor. Creates an empty bank.
+		SoundBank();
+
+		// Builds a .sbank file. Returns false if two of the sounds have the same name hash (or the file would be 4 GB or larger).
+		// sources - The sounds to put in the bank. They can be in any order.
+		// data - Receives the file data. Any existing contents are replaced.
+		static bool SaveToMemory(
+			const std::vector<SoundBankSource>& sources,
+			std::vector<uint8_t>& data
+			);
+
+		// Uses the data of a .sbank file (such as a memory mapped file) without copying it. Returns false (and leaves the bank empty) if the data
+		// isn't a valid .sbank file. Every offset is checked against size so any data can be passed in safely.
+		// data - The file data. Must be aligned to at least 8 bytes (a memory mapped view always is).
+		// size - The size of the file data in bytes.
+		bool LoadFromMemory(
+			const void* data,
+			size_t size
+			);
+
+		// Returns the bank to its empty state. Does not touch the file data.
+		void Reset();
+
+		// Returns the number of sounds in the bank.
+		uint32_t GetEntryCount() const { return m_entryCount; }
+
+		// Returns the entry of the sound at an index. index must be less than GetEntryCount().
+		const SoundBankEntry& GetEntry(uint32_t index) const { return m_entries[index]; }
+
+		// Returns the sound's name (m_nameLength UTF-16 code units with no terminator).
+		const uint16_t* GetName(uint32_t index) const { return reinterpret_cast<const uint16_t*>(m_data + m_entries[index].m_nameOffset); }
+
+		// Returns the sound's format (m_formatSize bytes, starting with a WAVEFORMATEX or a PCMWAVEFORMAT).
+		const uint8_t* GetFormat(uint32_t index) const { return m_data + m_entries[index].m_formatOffset; }
+
+		// Returns the sound's audio data (m_dataSize bytes).
+		const uint8_t* GetAudioData(uint32_t index) const { return m_data + m_entries[index].m_dataOffset; }
+
+		// Finds a sound by its name hash with a binary search. Returns false if the bank doesn't have the sound.
+		// nameHash - The hash of the sound's name. See HashSoundName.
+		// index - Receives the index of the sound.
+		bool Find(
+			uint64_t nameHash,
+			uint32_t& index
+			) const;
+
+	private:
+		// The file data.
+		const uint8_t*				m_data;
+
+		// The entries inside the file data.
+		const SoundBankEntry*		m_entries;
+
+		// The number of entries.
+		uint32_t					m_entryCount;
+	};
+}
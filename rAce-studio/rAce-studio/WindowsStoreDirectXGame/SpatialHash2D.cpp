@@ -0,0 +1,224 @@
+#include "SpatialHash2D.h"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <stdexcept>
+
+namespace
+{
+	// Cell coordinates are clamped to this range so that sprites that are very far away (or have huge bounds) can't overflow an int.
+	const float MaxCellCoordinate = 1048576.0f;
+
+	// Returns the cell coordinate that a world space coordinate falls in.
+	// value - The world space coordinate.
+	// inverseCellSize - 1.0f / the cell size.
+	inline int GetCellCoordinate(float value, float inverseCellSize)
+	{
+		auto cell = std::floor(value * inverseCellSize);
+		return static_cast<int>(std::min(std::max(cell, -MaxCellCoordinate), MaxCellCoordinate));
+	}
+}
+
+DX::SpatialHash2D::SpatialHash2D(float cellSize) :
+	m_cellSize(),
+	m_inverseCellSize(),
+	m_sprites(),
+	m_oversizedIds(),
+	m_entryCount(),
+	m_entries(),
+	m_bucketStarts()
+{
+	SetCellSize(cellSize);
+}
+
+void DX::SpatialHash2D::SetCellSize(float cellSize)
+{
+	if (!(cellSize > 0.0f))
+	{
+		throw std::invalid_argument("cellSize");
+	}
+
+	m_cellSize = cellSize;
+	m_inverseCellSize = 1.0f / cellSize;
+	Clear();
+}
+
+void DX::SpatialHash2D::Clear()
+{
+	m_sprites.clear();
+	m_oversizedIds.clear();
+	m_entryCount = 0;
+}
+
+uint32_t DX::SpatialHash2D::Add(
+	float left,
+	float top,
+	float right,
+	float bottom
+	)
+{
+	auto id = static_cast<uint32_t>(m_sprites.size());
+
+	Sprite sprite;
+	if (!(left <= right) || !(top <= bottom))
+	{
+		// Give the sprite NaN bounds, which fail every comparison in IsOverlap (even against infinite bounds), and an empty range of cells so that
+		// it is never recorded anywhere.
+		sprite.m_left = sprite.m_top = sprite.m_right = sprite.m_bottom = std::numeric_limits<float>::quiet_NaN();
+		sprite.m_cellLeft = sprite.m_cellTop = 0;
+		sprite.m_cellRight = sprite.m_cellBottom = -1;
+	}
+	else
+	{
+		sprite.m_left = left;
+		sprite.m_top = top;
+		sprite.m_right = right;
+		sprite.m_bottom = bottom;
+		sprite.m_cellLeft = GetCellCoordinate(left, m_inverseCellSize);
+		sprite.m_cellTop = GetCellCoordinate(top, m_inverseCellSize);
+		sprite.m_cellRight = GetCellCoordinate(right, m_inverseCellSize);
+		sprite.m_cellBottom = GetCellCoordinate(bottom, m_inverseCellSize);
+
+		// The clamped coordinates keep each span within 2^21 + 1 cells, so the product fits in 64 bits.
+		auto cellCount = static_cast<uint64_t>(sprite.m_cellRight - sprite.m_cellLeft + 1) *
+			static_cast<uint64_t>(sprite.m_cellBottom - sprite.m_cellTop + 1);
+		if (cellCount > MaxCellsPerSprite)
+		{
+			// Leave it out of the grid; FindPairs tests it against every other rectangle.
+			sprite.m_cellLeft = sprite.m_cellTop = 0;
+			sprite.m_cellRight = sprite.m_cellBottom = -1;
+			m_oversizedIds.push_back(id);
+		}
+		else
+		{
+			m_entryCount += static_cast<size_t>(cellCount);
+		}
+	}
+
+	m_sprites.push_back(sprite);
+
+	return id;
+}
+
+void DX::SpatialHash2D::FindPairs(std::vector<CollisionPair>& pairs)
+{
+	pairs.clear();
+
+	auto spriteCount = static_cast<uint32_t>(m_sprites.size());
+
+	// The oversized rectangles aren't in the grid, so test each of them against every rectangle. Two oversized rectangles are only tested from
+	// the one with the lower id so that the pair is only reported once.
+	for (auto oversizedId : m_oversizedIds)
+	{
+		auto& oversized = m_sprites[oversizedId];
+		for (uint32_t id = 0; id < spriteCount; id++)
+		{
+			if (id == oversizedId || !IsOverlap(oversized, m_sprites[id]))
+			{
+				continue;
+			}
+
+			if (id < oversizedId && std::binary_search(m_oversizedIds.begin(), m_oversizedIds.end(), id))
+			{
+				continue;
+			}
+
+			CollisionPair pair;
+			pair.m_first = std::min(oversizedId, id);
+			pair.m_second = std::max(oversizedId, id);
+			pairs.push_back(pair);
+		}
+	}
+
+	if (m_entryCount == 0)
+	{
+		return;
+	}
+
+	// Use at least twice as many buckets as entries so that most occupied buckets only hold a single cell.
+	uint32_t bucketCount = 64;
+	while (bucketCount < m_entryCount * 2 && bucketCount < 0x40000000U)
+	{
+		bucketCount <<= 1;
+	}
+	auto bucketMask = bucketCount - 1;
+
+	// Group the entries by bucket with a counting sort. First count the entries in each bucket...
+	m_bucketStarts.assign(static_cast<size_t>(bucketCount) + 1, 0);
+	for (auto& sprite : m_sprites)
+	{
+		for (int cellY = sprite.m_cellTop; cellY <= sprite.m_cellBottom; cellY++)
+		{
+			for (int cellX = sprite.m_cellLeft; cellX <= sprite.m_cellRight; cellX++)
+			{
+				m_bucketStarts[GetBucket(cellX, cellY, bucketMask)]++;
+			}
+		}
+	}
+
+	// ... then turn the counts into the end of each bucket...
+	for (uint32_t i = 1; i < bucketCount; i++)
+	{
+		m_bucketStarts[i] += m_bucketStarts[i - 1];
+	}
+	m_bucketStarts[bucketCount] = m_entryCount;
+
+	// ... and then fill each bucket from the back. When this finishes m_bucketStarts[i] is the start of bucket i.
+	m_entries.resize(m_entryCount);
+	for (uint32_t id = 0; id < spriteCount; id++)
+	{
+		auto& sprite = m_sprites[id];
+		for (int cellY = sprite.m_cellTop; cellY <= sprite.m_cellBottom; cellY++)
+		{
+			for (int cellX = sprite.m_cellLeft; cellX <= sprite.m_cellRight; cellX++)
+			{
+				auto& entry = m_entries[--m_bucketStarts[GetBucket(cellX, cellY, bucketMask)]];
+				entry.m_id = id;
+				entry.m_cellX = cellX;
+				entry.m_cellY = cellY;
+			}
+		}
+	}
+
+	// Test the rectangles that share a cell against each other.
+	for (uint32_t bucket = 0; bucket < bucketCount; bucket++)
+	{
+		auto end = m_bucketStarts[bucket + 1];
+		for (auto i = m_bucketStarts[bucket]; i < end; i++)
+		{
+			auto& entryOne = m_entries[i];
+			auto& spriteOne = m_sprites[entryOne.m_id];
+
+			for (auto j = i + 1; j < end; j++)
+			{
+				auto& entryTwo = m_entries[j];
+
+				// Skip entries for a different cell that just happens to hash to the same bucket.
+				if (entryOne.m_cellX != entryTwo.m_cellX || entryOne.m_cellY != entryTwo.m_cellY)
+				{
+					continue;
+				}
+
+				auto& spriteTwo = m_sprites[entryTwo.m_id];
+				if (!IsOverlap(spriteOne, spriteTwo))
+				{
+					continue;
+				}
+
+				// Two overlapping rectangles can share several cells. To report each pair only once, only report it from the cell that contains the
+				// top left corner of the overlap. That corner is inside of both rectangles so both of them are always recorded in that cell.
+				if (GetCellCoordinate(std::max(spriteOne.m_left, spriteTwo.m_left), m_inverseCellSize) != entryOne.m_cellX ||
+					GetCellCoordinate(std::max(spriteOne.m_top, spriteTwo.m_top), m_inverseCellSize) != entryOne.m_cellY)
+				{
+					continue;
+				}
+
+				CollisionPair pair;
+				pair.m_first = std::min(entryOne.m_id, entryTwo.m_id);
+				pair.m_second = std::max(entryOne.m_id, entryTwo.m_id);
+				pairs.push_back(pair);
+			}
+		}
+	}
+}
@@ -0,0 +1,179 @@
+#pragma once
+
+// Portable (see README_PORTABLE.txt) so that it can be checked against a brute force search and benchmarked with synthetic sprites.
+#include <cstddef>
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+namespace DX
+{
+	// A pair of sprites whose bounding rectangles overlap. The values are the ids returned by SpatialHash2D::Add (or the equivalent for other
+	// broad phase classes). m_first is always less than m_second.
+	struct CollisionPair
+	{
+		// The id of the first sprite.
+		uint32_t				m_first;
+		// The id of the second sprite.
+		uint32_t				m_second;
+	};
+
+	// A broad phase for 2D collision detection. Each frame you Clear the hash, Add the bounding rectangle of every sprite, and then call FindPairs
+	// to get the pairs of sprites whose rectangles overlap. Only those pairs need to be passed to the pixel perfect tests in CollisionDetection2D,
+	// rather than testing every sprite against every other sprite.
+	// Internally the world is divided into a uniform grid of square cells. Each rectangle is recorded in every cell that it touches and the cells
+	// are hashed into a table of buckets (so the world does not need to have fixed bounds). Only rectangles that share a cell are tested against
+	// each other. The cell size should be roughly the size of a typical sprite: if it is much smaller then large sprites will be recorded in a lot
+	// of cells and if it is much larger then lots of sprites that aren't near each other will share cells. A rectangle that would touch more than
+	// MaxCellsPerSprite cells isn't recorded in the grid at all; it is tested against every other rectangle instead, which is cheaper at that size
+	// and keeps the number of cell entries bounded however large the rectangle or small the cell size.
+	class SpatialHash2D
+	{
+	public:
+		// The most cells that a rectangle can touch and still be recorded in the grid.
+		static const uint32_t MaxCellsPerSprite = 1024;
+
+		// Constructor.
+		// cellSize - The width and height of each grid cell in world units. Must be greater than zero (otherwise std::invalid_argument is thrown).
+		explicit SpatialHash2D(float cellSize = 64.0f);
+
+		// Move constructor.
+		SpatialHash2D(SpatialHash2D&& value) :
+			m_cellSize(),
+			m_inverseCellSize(),
+			m_sprites(),
+			m_oversizedIds(),
+			m_entryCount(),
+			m_entries(),
+			m_bucketStarts()
+		{
+			// Invoke the move assignment operator.
+			*this = std::move(value);
+		}
+
+		// Move assignment operator.
+		SpatialHash2D& operator=(SpatialHash2D&& value)
+		{
+			if (this != &value)
+			{
+				m_cellSize = value.m_cellSize;
+				m_inverseCellSize = value.m_inverseCellSize;
+				m_sprites.swap(value.m_sprites);
+				m_oversizedIds.swap(value.m_oversizedIds);
+				m_entryCount = value.m_entryCount;
+				m_entries.swap(value.m_entries);
+				m_bucketStarts.swap(value.m_bucketStarts);
+			}
+
+			return *this;
+		}
+
+		// Changes the cell size. This clears the hash.
+		// cellSize - The width and height of each grid cell in world units. Must be greater than zero (otherwise std::invalid_argument is thrown).
+		void SetCellSize(float cellSize);
+
+		// Returns the width and height of each grid cell in world units.
+		float GetCellSize() const { return m_cellSize; }
+
+		// Removes all of the rectangles. The memory that was allocated is kept so that rebuilding the hash each frame doesn't allocate.
+		void Clear();
+
+		// Reserves space for the specified number of rectangles.
+		void Reserve(uint32_t count) { m_sprites.reserve(count); }
+
+		// Adds a bounding rectangle and returns its id. Ids start at zero and go up by one for each call to Add after a call to Clear, so if you add
+		// your sprites in order the id is the sprite's index. Empty rectangles (left greater than right or top greater than bottom, or any NaN) get
+		// an id but never collide with anything.
+		// left, top, right, bottom - The edges of the sprite's bounding rectangle in world space.
+		uint32_t Add(
+			float left,
+			float top,
+			float right,
+			float bottom
+			);
+
+		// Adds a Windows::Foundation::Rect (e.g. from GetTransformedBoundingRectangle), or anything else with Left, Top, Right and Bottom, and
+		// returns its id. Rect::Empty has a Left of +infinity and a Right of -infinity so it is added as an empty rectangle.
+		// bounds - The bounding rectangle of the sprite in world space.
+		template <typename RectType>
+		uint32_t Add(const RectType& bounds)
+		{
+			return Add(bounds.Left, bounds.Top, bounds.Right, bounds.Bottom);
+		}
+
+		// Returns the number of rectangles that have been added since the last call to Clear.
+		uint32_t GetCount() const { return static_cast<uint32_t>(m_sprites.size()); }
+
+		// Finds every pair of rectangles that overlap. Each pair is reported once, with the lower id first. Rectangles whose edges only touch are
+		// reported as overlapping, the same as IsRectangleCollision.
+		// pairs - Receives the pairs. It is cleared first, but its memory is reused so keep the same vector around from frame to frame.
+		void FindPairs(std::vector<CollisionPair>& pairs);
+
+	private:
+		// Disable copy constructor.
+		SpatialHash2D(const SpatialHash2D&);
+		// Disable copy assignment.
+		SpatialHash2D& operator=(const SpatialHash2D&);
+
+		// A rectangle that has been added to the hash along with the range of cells that it touches.
+		struct Sprite
+		{
+			// The bounds of the rectangle.
+			float					m_left;
+			float					m_top;
+			float					m_right;
+			float					m_bottom;
+			// The range of cells (inclusive) that the rectangle touches. If the rectangle is empty, or touches more than MaxCellsPerSprite cells,
+			// then m_cellRight is less than m_cellLeft.
+			int						m_cellLeft;
+			int						m_cellTop;
+			int						m_cellRight;
+			int						m_cellBottom;
+		};
+
+		// A record of a rectangle touching a cell. The entries are grouped by bucket.
+		struct Entry
+		{
+			// The id of the rectangle.
+			uint32_t				m_id;
+			// The cell. Different cells can hash to the same bucket so this is needed to tell them apart.
+			int						m_cellX;
+			int						m_cellY;
+		};
+
+		// Returns the bucket for a cell.
+		// cellX, cellY - The cell coordinates.
+		// bucketMask - The number of buckets minus one. The number of buckets is always a power of two.
+		static uint32_t GetBucket(int cellX, int cellY, uint32_t bucketMask)
+		{
+			return ((static_cast<uint32_t>(cellX) * 73856093U) ^ (static_cast<uint32_t>(cellY) * 19349663U)) & bucketMask;
+		}
+
+		// Returns true if the two rectangles overlap or touch.
+		static bool IsOverlap(const Sprite& one, const Sprite& two)
+		{
+			return one.m_left <= two.m_right && two.m_left <= one.m_right && one.m_top <= two.m_bottom && two.m_top <= one.m_bottom;
+		}
+
+		// The width and height of each grid cell.
+		float						m_cellSize;
+
+		// 1.0f / m_cellSize.
+		float						m_inverseCellSize;
+
+		// The rectangles that have been added, indexed by id.
+		std::vector<Sprite>			m_sprites;
+
+		// The ids of the rectangles that touch more than MaxCellsPerSprite cells, in the order they were added.
+		std::vector<uint32_t>		m_oversizedIds;
+
+		// The total number of cells touched by all of the rectangles that are recorded in the grid.
+		size_t						m_entryCount;
+
+		// The cell entries, grouped by bucket by FindPairs.
+		std::vector<Entry>			m_entries;
+
+		// The index of the first entry in each bucket. Has one more element than there are buckets so that the end of bucket i is m_bucketStarts[i + 1].
+		std::vector<size_t>			m_bucketStarts;
+	};
+}
@@ -0,0 +1,116 @@
+#pragma once
+
+// Portable (see README_PORTABLE.txt). It is a template so there is no .cpp file.
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+
+namespace DX
+{
+	// A fixed size, lock-free, single producer single consumer queue. Exactly one thread may push and exactly one thread may pop (they may be the
+	// same thread). Neither side ever blocks or allocates: TryPush fails when the queue is full and TryPop fails when it is empty. The two sides
+	// only share the read and write positions, each of which is written by one side and read by the other, so no locks or compare-exchange
+	// loops are needed. T is copied in and out, so it should be small and cheap to copy.
+	template<class T>
+	class SpscRing
+	{
+	public:
+		// Constructor. Allocates the storage, so construct the queue before any thread uses it.
+		// capacity - The most items the queue can hold. Rounded up to a power of two.
+		explicit SpscRing(size_t capacity) :
+			m_items(),
+			m_mask(),
+			m_write(0),
+			m_read(0)
+		{
+			size_t size = 1;
+			while (size < capacity)
+			{
+				size <<= 1;
+			}
+
+			m_items.reset(new T[size]);
+			m_mask = size - 1;
+		}
+
+		// Returns the most items the queue can hold.
+		size_t GetCapacity() const { return m_mask + 1; }
+
+		// Adds an item to the back of the queue. Returns false (and does nothing) if the queue is full. Producer only.
+		// item - The item to add.
+		bool TryPush(const T& item)
+		{
+			size_t write = m_write.load(std::memory_order_relaxed);
+			if (write - m_read.load(std::memory_order_acquire) > m_mask)
+			{
+				return false;
+			}
+
+			m_items[write & m_mask] = item;
+			m_write.store(write + 1, std::memory_order_release);
+			return true;
+		}
+
+		// Returns the number of items that can be pushed before the queue is full. Producer only; the true number can only be larger since the
+		// consumer may pop items at any time.
+		size_t GetFreeCount() const
+		{
+			return GetCapacity() - (m_write.load(std::memory_order_relaxed) - m_read.load(std::memory_order_acquire));
+		}
+
+		// Returns the item at the front of the queue without removing it, or nullptr if the queue is empty. The item stays valid until Pop is
+		// called. Consumer only.
+		const T* Peek() const
+		{
+			size_t read = m_read.load(std::memory_order_relaxed);
+			if (read == m_write.load(std::memory_order_acquire))
+			{
+				return nullptr;
+			}
+
+			return &m_items[read & m_mask];
+		}
+
+		// Removes the item at the front of the queue. The queue must not be empty (i.e. Peek must have returned an item). Consumer only.
+		void Pop()
+		{
+			m_read.store(m_read.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+		}
+
+		// Removes the item at the front of the queue and copies it to item. Returns false (and leaves item alone) if the queue is empty. Consumer only.
+		// item - Receives the item.
+		bool TryPop(T& item)
+		{
+			auto front = Peek();
+			if (front == nullptr)
+			{
+				return false;
+			}
+
+			item = *front;
+			Pop();
+			return true;
+		}
+
+	private:
+		// Disable copy constructor.
+		SpscRing(const SpscRing&);
+		// Disable copy assignment.
+		SpscRing& operator=(const SpscRing&);
+
+		// The storage. Its size is a power of two so positions can be wrapped with m_mask.
+		std::unique_ptr<T[]>				m_items;
+
+		// The size of the storage minus one.
+		size_t								m_mask;
+
+		// The number of items ever pushed. Only written by the producer. The padding keeps it off the consumer's cache line.
+		std::atomic<size_t>					m_write;
+		uint8_t								m_writePadding[64];
+
+		// The number of items ever popped. Only written by the consumer.
+		std::atomic<size_t>					m_read;
+		uint8_t								m_readPadding[64];
+	};
+}
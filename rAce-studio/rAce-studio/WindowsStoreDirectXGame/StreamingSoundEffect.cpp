@@ -0,0 +1,409 @@
+#include "pch.h"
+#include "StreamingSoundEffect.h"
+
+#include "DirectXHelper.h"
+
+#ifndef MAKEFOURCC
+	#define MAKEFOURCC(ch0, ch1, ch2, ch3)                              \
+				((uint32)(byte)(ch0) | ((uint32)(byte)(ch1) << 8) |       \
+				((uint32)(byte)(ch2) << 16) | ((uint32)(byte)(ch3) << 24 ))
+#endif /* defined(MAKEFOURCC) */
+
+StreamingSoundEffect::StreamingSoundEffect() :
+	m_file(INVALID_HANDLE_VALUE),
+	m_dataOffset(),
+	m_format(),
+	m_bufferData(),
+	m_scheduler(),
+	m_voice(),
+	m_readers(),
+	m_fillLock(),
+	m_callbackLock(),
+	m_generation(0),
+	m_loopCount(),
+	m_playing(false),
+	m_criticalError(S_OK),
+	m_paused()
+{
+	InitializeSRWLock(&m_fillLock);
+	InitializeSRWLock(&m_callbackLock);
+}
+
+StreamingSoundEffect::~StreamingSoundEffect()
+{
+	DestroyVoice();
+	Close();
+}
+
+void StreamingSoundEffect::Open(
+	_In_ const wchar_t* filename,
+	uint32 bufferCount,
+	uint32 bufferSize
+	)
+{
+	if (filename == nullptr)
+	{
+		throw ref new Platform::InvalidArgumentException(L"filename");
+	}
+
+	if (bufferCount < 2)
+	{
+		throw ref new Platform::InvalidArgumentException(L"bufferCount");
+	}
+
+	StopAndFlush();
+	Close();
+
+	// Relative paths are relative to the installed location, like BasicReaderWriter.
+	Platform::String^ path = ref new Platform::String(filename);
+	if (path->Length() < 2 || filename[1] != L':')
+	{
+		path = Platform::String::Concat(Platform::String::Concat(Windows::ApplicationModel::Package::Current->InstalledLocation->Path, "\\"), path);
+	}
+
+	CREATEFILE2_EXTENDED_PARAMETERS extendedParams = {0};
+	extendedParams.dwSize = sizeof(CREATEFILE2_EXTENDED_PARAMETERS);
+	extendedParams.dwFileAttributes = FILE_ATTRIBUTE_NORMAL;
+	extendedParams.dwFileFlags = FILE_FLAG_SEQUENTIAL_SCAN;
+	extendedParams.dwSecurityQosFlags = SECURITY_ANONYMOUS;
+	extendedParams.lpSecurityAttributes = nullptr;
+	extendedParams.hTemplateFile = nullptr;
+
+	m_file = CreateFile2(path->Data(), GENERIC_READ, FILE_SHARE_READ, OPEN_EXISTING, &extendedParams);
+	if (m_file == INVALID_HANDLE_VALUE)
+	{
+		DX::ThrowIfFailed(HRESULT_FROM_WIN32(GetLastError()), __FILEW__, __LINE__);
+	}
+
+	// Walk the RIFF chunks to find the 'fmt ' and 'data' chunks without reading the audio data.
+	uint32 header[3];
+	if (!ReadAt(0, header, sizeof(header)) || header[0] != MAKEFOURCC('R', 'I', 'F', 'F') || header[2] != MAKEFOURCC('W', 'A', 'V', 'E'))
+	{
+		Close();
+		DX::ThrowIfFailed(E_FAIL, __FILEW__, __LINE__);
+	}
+
+	// Check every chunk against the size of the file like DX::ParseWaveFile does, using the file size if the RIFF size is larger than the file.
+	FILE_STANDARD_INFO fileInfo = {};
+	if (!GetFileInformationByHandleEx(m_file, FileStandardInfo, &fileInfo, sizeof(fileInfo)))
+	{
+		auto hr = HRESULT_FROM_WIN32(GetLastError());
+		Close();
+		DX::ThrowIfFailed(hr, __FILEW__, __LINE__);
+	}
+
+	uint64 riffEnd = min(static_cast<uint64>(header[1]) + 8, static_cast<uint64>(fileInfo.EndOfFile.QuadPart));
+	uint64 offset = sizeof(header);
+	uint64 dataLength = 0;
+	bool foundData = false;
+	m_format.clear();
+
+	while (offset + 8 <= riffEnd && (m_format.empty() || !foundData))
+	{
+		uint32 chunkHeader[2];
+		if (!ReadAt(offset, chunkHeader, sizeof(chunkHeader)))
+		{
+			break;
+		}
+		offset += sizeof(chunkHeader);
+
+		// A 'fmt ' or 'data' chunk that runs past the end of the file means that the file is truncated or corrupt.
+		bool isFormat = (chunkHeader[0] == MAKEFOURCC('f', 'm', 't', ' '));
+		bool isData = (chunkHeader[0] == MAKEFOURCC('d', 'a', 't', 'a'));
+		if (chunkHeader[1] > riffEnd - offset)
+		{
+			if (isFormat || isData)
+			{
+				m_format.clear();
+			}
+			break;
+		}
+
+		if (isFormat && m_format.empty())
+		{
+			// The chunk has to hold at least a PCMWAVEFORMAT and no more than a WAVEFORMATEX with the largest cbSize. Keep at least a whole
+			// WAVEFORMATEX so that cbSize is always valid (it is zero for plain PCM files with a 16 byte 'fmt ' chunk).
+			if (chunkHeader[1] < sizeof(PCMWAVEFORMAT) || chunkHeader[1] > sizeof(WAVEFORMATEX) + 0xFFFF)
+			{
+				break;
+			}
+
+			m_format.assign(max(static_cast<size_t>(chunkHeader[1]), sizeof(WAVEFORMATEX)), 0);
+			if (!ReadAt(offset, &m_format[0], chunkHeader[1]))
+			{
+				m_format.clear();
+				break;
+			}
+
+			// XAudio2 reads cbSize bytes past the WAVEFORMATEX so they have to be in the chunk.
+			auto waveFormat = reinterpret_cast<const WAVEFORMATEX*>(&m_format[0]);
+			if (chunkHeader[1] >= sizeof(WAVEFORMATEX) && waveFormat->cbSize > chunkHeader[1] - sizeof(WAVEFORMATEX))
+			{
+				m_format.clear();
+				break;
+			}
+		}
+		else if (isData && !foundData)
+		{
+			m_dataOffset = offset;
+			dataLength = chunkHeader[1];
+			foundData = true;
+		}
+
+		// Chunks are padded to an even size.
+		offset += chunkHeader[1] + (chunkHeader[1] & 1);
+	}
+
+	if (m_format.empty() || !foundData)
+	{
+		Close();
+		DX::ThrowIfFailed(E_FAIL, __FILEW__, __LINE__);
+	}
+
+	auto waveFormat = reinterpret_cast<const WAVEFORMATEX*>(&m_format[0]);
+	if (waveFormat->nBlockAlign == 0)
+	{
+		Close();
+		DX::ThrowIfFailed(E_FAIL, __FILEW__, __LINE__);
+	}
+
+	m_scheduler.Initialize(bufferCount, bufferSize, waveFormat->nBlockAlign, dataLength, 0, 0, 0);
+	m_bufferData.assign(bufferCount * m_scheduler.GetBufferSize(), 0);
+}
+
+void StreamingSoundEffect::Close()
+{
+	if (m_file != INVALID_HANDLE_VALUE)
+	{
+		CloseHandle(m_file);
+		m_file = INVALID_HANDLE_VALUE;
+	}
+}
+
+void StreamingSoundEffect::CreateVoice(_In_ IXAudio2* engine)
+{
+	DestroyVoice();
+
+	if (m_format.empty())
+	{
+		throw ref new Platform::FailureException(L"The file has not been opened.");
+	}
+
+	m_criticalError.store(S_OK);
+
+	DX::ThrowIfFailed(
+		engine->CreateSourceVoice(&m_voice, reinterpret_cast<const WAVEFORMATEX*>(&m_format[0]), 0U, 2.0f, this), __FILEW__, __LINE__
+		);
+}
+
+void StreamingSoundEffect::DestroyVoice()
+{
+	StopAndFlush();
+	auto lock = Microsoft::WRL::Wrappers::SRWLock::LockExclusive(&m_fillLock);
+	m_voice.Reset();
+	lock.Unlock();
+
+	// Destroying the voice waits for its callbacks to return, so nothing can start another read after this.
+	m_readers.wait();
+	m_playing = false;
+	m_paused = false;
+}
+
+void StreamingSoundEffect::StopAndFlush()
+{
+	m_playing = false;
+
+	// Move to a new generation first. From then on OnBufferEnd ignores every buffer that is still queued (including the ones that the flush
+	// returns) so it can't touch the scheduler or start another read, and a read that is already running stops before its next chunk.
+	NextGeneration();
+
+	// Taking the fill lock waits for a read that is part way through a chunk, so nothing can be submitted after the flush.
+	auto lock = Microsoft::WRL::Wrappers::SRWLock::LockExclusive(&m_fillLock);
+	if (m_voice.Get() != nullptr)
+	{
+		m_voice->Stop();
+		m_voice->FlushSourceBuffers();
+	}
+	m_scheduler.Reset(0);
+	lock.Unlock();
+
+	m_readers.wait();
+}
+
+void StreamingSoundEffect::NextGeneration()
+{
+	auto lock = Microsoft::WRL::Wrappers::SRWLock::LockExclusive(&m_callbackLock);
+	m_generation++;
+}
+
+void StreamingSoundEffect::Play(uint32 loopCount)
+{
+	if (m_voice.Get() == nullptr)
+	{
+		return;
+	}
+
+	StopAndFlush();
+
+	m_loopCount = loopCount;
+	m_criticalError.store(S_OK);
+
+	{
+		auto lock = Microsoft::WRL::Wrappers::SRWLock::LockExclusive(&m_fillLock);
+		m_scheduler.Rewind((loopCount == XAUDIO2_LOOP_INFINITE) ? DX::AudioStreamScheduler::LoopInfinite : loopCount);
+	}
+
+	// Fill every buffer before starting so that the voice can't run dry while the first background read is scheduled.
+	FillBuffers(m_generation.load());
+
+	// A file with no audio data has nothing to submit, so it never gets an OnStreamEnd. IsFinished reads the scheduler's end of stream flag,
+	// which only the fill lock protects.
+	{
+		auto lock = Microsoft::WRL::Wrappers::SRWLock::LockExclusive(&m_fillLock);
+		m_playing = !m_scheduler.IsFinished();
+	}
+	m_paused = false;
+	DX::ThrowIfFailed(
+		m_voice->Start(), __FILEW__, __LINE__
+		);
+}
+
+void StreamingSoundEffect::Stop(bool playTails)
+{
+	if (m_voice.Get() == nullptr || !m_playing)
+	{
+		return;
+	}
+
+	if (playTails)
+	{
+		// Let the buffers that have already been submitted finish (along with any effect tails) but don't read any more of the file.
+		DX::ThrowIfFailed(
+			m_voice->Stop(XAUDIO2_PLAY_TAILS), __FILEW__, __LINE__
+			);
+		NextGeneration();
+	}
+	else
+	{
+		StopAndFlush();
+	}
+
+	m_playing = false;
+	m_paused = false;
+}
+
+HRESULT StreamingSoundEffect::Pause()
+{
+	if (m_voice.Get() == nullptr || !m_playing || m_paused)
+	{
+		return S_OK;
+	}
+
+	HRESULT hr = m_voice->Stop();
+	if (SUCCEEDED(hr))
+	{
+		m_paused = true;
+	}
+	return hr;
+}
+
+HRESULT StreamingSoundEffect::Resume()
+{
+	if (m_voice.Get() == nullptr || !m_playing || !m_paused)
+	{
+		return S_OK;
+	}
+
+	HRESULT hr = m_voice->Start();
+	if (SUCCEEDED(hr))
+	{
+		m_paused = false;
+	}
+	return hr;
+}
+
+bool StreamingSoundEffect::ReadAt(
+	uint64 offset,
+	_Out_writes_bytes_(byteCount) void* destination,
+	uint32 byteCount
+	)
+{
+	// The file is opened for synchronous I/O but the OVERLAPPED structure still lets us give the offset with the read.
+	OVERLAPPED overlapped = {};
+	overlapped.Offset = static_cast<DWORD>(offset & 0xFFFFFFFFULL);
+	overlapped.OffsetHigh = static_cast<DWORD>(offset >> 32);
+
+	DWORD bytesRead = 0;
+	return ReadFile(m_file, destination, byteCount, &bytesRead, &overlapped) != FALSE && bytesRead == byteCount;
+}
+
+void StreamingSoundEffect::FillBuffers(uint32 generation)
+{
+	auto lock = Microsoft::WRL::Wrappers::SRWLock::LockExclusive(&m_fillLock);
+
+	if (m_voice.Get() == nullptr)
+	{
+		return;
+	}
+
+	// Check the generation before each chunk so that a stop that happens part way through doesn't have to wait for the rest of the reads.
+	DX::AudioStreamChunk chunk;
+	while (generation == m_generation.load() && m_scheduler.GetNextChunk(chunk))
+	{
+		auto bufferData = &m_bufferData[chunk.m_buffer * m_scheduler.GetBufferSize()];
+		if (!ReadAt(m_dataOffset + chunk.m_offset, bufferData, chunk.m_byteCount))
+		{
+			SetCriticalError(HRESULT_FROM_WIN32(ERROR_READ_FAULT));
+			return;
+		}
+
+		XAUDIO2_BUFFER buffer = {};
+		buffer.AudioBytes = chunk.m_byteCount;
+		buffer.pAudioData = bufferData;
+		buffer.Flags = chunk.m_endOfStream ? XAUDIO2_END_OF_STREAM : 0U;
+		buffer.pContext = reinterpret_cast<void*>(static_cast<uintptr_t>(generation));
+
+		HRESULT hr = m_voice->SubmitSourceBuffer(&buffer);
+		if (FAILED(hr))
+		{
+			SetCriticalError(hr);
+			return;
+		}
+	}
+}
+
+void StreamingSoundEffect::OnStreamEnd()
+{
+	m_playing = false;
+}
+
+void StreamingSoundEffect::OnBufferEnd(void* pBufferContext)
+{
+	// Buffers from before the last flush have already been forgotten by the scheduler. The check is made under the callback lock, which
+	// NextGeneration also takes, so once a stop has moved to a new generation no callback can decrement the rewound scheduler or start a read
+	// behind StopAndFlush's wait. The lock is only ever held for a few instructions so this doesn't hold up XAudio2's processing thread.
+	uint32 generation = static_cast<uint32>(reinterpret_cast<uintptr_t>(pBufferContext));
+	auto lock = Microsoft::WRL::Wrappers::SRWLock::LockExclusive(&m_callbackLock);
+	if (generation != m_generation.load())
+	{
+		return;
+	}
+
+	m_scheduler.OnBufferEnd();
+
+	// Reading from the file can take a while, so do it on a background task rather than on XAudio2's processing thread.
+	if (m_playing)
+	{
+		m_readers.run([this, generation]()
+		{
+			FillBuffers(generation);
+		});
+	}
+}
+
+void StreamingSoundEffect::OnVoiceError(void* pBufferContext, HRESULT Error)
+{
+	UNREFERENCED_PARAMETER(pBufferContext);
+
+	SetCriticalError(Error);
+}
@@ -0,0 +1,159 @@
+#pragma once
+
+#include <ppl.h>
+
+#include <atomic>
+#include <vector>
+
+#include "AudioEngine.h"
+#include "AudioStreamScheduler.h"
+
+// A sound effect that is streamed from its file through a small ring of buffers instead of being loaded into memory all at once. Use it for long
+// sounds such as ambience loops, where holding all of the PCM data in memory would cost far more than a few buffers do. Only the WAV header is read
+// when the file is opened. Playing fills every buffer before the voice starts; after that, whenever the voice finishes a buffer the next chunk of
+// the file is read into it on a background task (a concurrency::task_group) and resubmitted, so file reads never happen on the game thread or on
+// XAudio2's processing thread. The AudioStreamScheduler decides which chunk goes into which buffer and handles looping.
+// The public member functions must all be called from the same thread (normally the game thread).
+class StreamingSoundEffect : public IXAudio2VoiceCallback
+{
+public:
+	// The default number of buffers (triple buffering).
+	static const uint32 DefaultBufferCount = 3;
+
+	// The default size of each buffer in bytes. About 0.37 seconds of 44.1 kHz 16-bit stereo PCM.
+	static const uint32 DefaultBufferSize = 65536;
+
+	// Constructor. Use Open to open a file.
+	StreamingSoundEffect();
+
+	// Destructor. Stops the voice, waits for any background read to finish, and destroys the voice.
+	virtual ~StreamingSoundEffect();
+
+	// Opens a WAV file and reads its format. The audio data itself is read while the sound plays.
+	// filename - The relative path and full file name of the sound, e.g. "wind.wav". Relative paths are relative to the app's installed location.
+	// bufferCount - The number of buffers to stream through. Must be at least 2.
+	// bufferSize - The size of each buffer in bytes.
+	void Open(
+		_In_ const wchar_t* filename,
+		uint32 bufferCount = DefaultBufferCount,
+		uint32 bufferSize = DefaultBufferSize
+		);
+
+	// Creates the source voice. Any existing voice is destroyed first.
+	// engine - The sound effects engine.
+	void CreateVoice(_In_ IXAudio2* engine);
+
+	// Destroys the source voice (e.g. when the sound effects engine is shut down). CreateVoice must be called again before the next Play.
+	void DestroyVoice();
+
+	// Returns true if the source voice has been created.
+	bool HasVoice() const { return m_voice.Get() != nullptr; }
+
+	// Plays the sound from the start, stopping it first if it is already playing.
+	// loopCount - The number of times to loop the sound. If infinite looping is desired, use XAUDIO2_LOOP_INFINITE. 0 means play once (i.e. loop zero times).
+	void Play(uint32 loopCount);
+
+	// Stops the sound.
+	// playTails - If true, any tailing effects (such as reverb) will be allowed to play. If false, the sound will be stopped instantly.
+	void Stop(bool playTails);
+
+	// Pauses the sound if it is playing. Resume carries on from the same place. Returns the HRESULT from stopping the voice (S_OK if there was nothing to do).
+	HRESULT Pause();
+
+	// Resumes the sound if it was paused. Returns the HRESULT from starting the voice (S_OK if there was nothing to do).
+	HRESULT Resume();
+
+	// Returns true from the time Play is called until the last buffer finishes playing or Stop is called.
+	bool IsPlaying() const { return m_playing; }
+
+	// Returns the loop count that was passed to the last call to Play.
+	uint32 GetLoopCount() const { return m_loopCount; }
+
+	// Returns the HRESULT of the last error reported by the voice or a background read and clears it, or S_OK if there hasn't been one since the
+	// last call (or since the last CreateVoice or Play). The voice may have to be destroyed and re-created to recover from the error.
+	HRESULT TakeCriticalError() { return m_criticalError.exchange(S_OK); }
+
+	// IXAudio2VoiceCallback implementation.
+	virtual void __declspec(nothrow) __stdcall OnVoiceProcessingPassStart(UINT32 BytesRequired) override { UNREFERENCED_PARAMETER(BytesRequired); }
+	virtual void __declspec(nothrow) __stdcall OnVoiceProcessingPassEnd() override { }
+	virtual void __declspec(nothrow) __stdcall OnStreamEnd() override;
+	virtual void __declspec(nothrow) __stdcall OnBufferStart(void* pBufferContext) override { UNREFERENCED_PARAMETER(pBufferContext); }
+	virtual void __declspec(nothrow) __stdcall OnBufferEnd(void* pBufferContext) override;
+	virtual void __declspec(nothrow) __stdcall OnLoopEnd(void* pBufferContext) override { UNREFERENCED_PARAMETER(pBufferContext); }
+	virtual void __declspec(nothrow) __stdcall OnVoiceError(void* pBufferContext, HRESULT Error) override;
+
+private:
+	// Disable copy constructor.
+	StreamingSoundEffect(const StreamingSoundEffect&);
+	// Disable copy assignment.
+	StreamingSoundEffect& operator=(const StreamingSoundEffect&);
+
+	// Closes the file.
+	void Close();
+
+	// Reads from the file at an offset. Returns false if the read fails or comes up short.
+	bool ReadAt(
+		uint64 offset,
+		_Out_writes_bytes_(byteCount) void* destination,
+		uint32 byteCount
+		);
+
+	// Reads and submits chunks until every buffer is in use or the stream has ended. Runs on a background task (and on the calling thread when
+	// Play fills the buffers before starting the voice).
+	// generation - The generation the read was scheduled for. Nothing is read if the buffers have been flushed since then.
+	void FillBuffers(uint32 generation);
+
+	// Stops the voice, flushes its buffers, and waits for any background read to finish.
+	void StopAndFlush();
+
+	// Moves to a new generation so that OnBufferEnd ignores the buffers that are already queued and reads stop submitting.
+	void NextGeneration();
+
+	// Records an error for TakeCriticalError. Called from XAudio2's processing thread and from the background reads.
+	void SetCriticalError(HRESULT hr) { m_criticalError.store(hr); }
+
+	// The file. Only read while holding m_fillLock.
+	HANDLE										m_file;
+
+	// The offset of the audio data in the file.
+	uint64										m_dataOffset;
+
+	// The contents of the 'fmt ' chunk. Kept as bytes since it can be longer than a WAVEFORMATEX (e.g. WAVEFORMATEXTENSIBLE or ADPCM).
+	std::vector<uint8>							m_format;
+
+	// The buffers, one after another.
+	std::vector<uint8>							m_bufferData;
+
+	// Decides which chunk goes into which buffer.
+	DX::AudioStreamScheduler					m_scheduler;
+
+	// The source voice.
+	xaudio2_voice_ptr<IXAudio2SourceVoice>		m_voice;
+
+	// Runs the background reads.
+	concurrency::task_group						m_readers;
+
+	// Makes sure that only one thread reads and submits at a time.
+	SRWLOCK										m_fillLock;
+
+	// Held by OnBufferEnd while it checks the generation, returns the buffer to the scheduler and starts a read, and by NextGeneration while it
+	// changes the generation. Never held for long; see OnBufferEnd.
+	SRWLOCK										m_callbackLock;
+
+	// Incremented every time the buffers are flushed (or stopped with tails). Each buffer is submitted with the generation as its context so that
+	// OnBufferEnd can ignore the callbacks for flushed buffers. Only changed by NextGeneration.
+	std::atomic<uint32>							m_generation;
+
+	// The loop count that was passed to Play.
+	uint32										m_loopCount;
+
+	// True while the sound is playing. Cleared by OnStreamEnd on XAudio2's processing thread and read by OnBufferEnd.
+	std::atomic<bool>							m_playing;
+
+	// The HRESULT of the last error, or S_OK if there isn't one. A single atomic rather than a flag and a separate HRESULT so that the game thread
+	// can never see the flag without the HRESULT that goes with it, or clear an error that is reported while it is handling the previous one.
+	std::atomic<HRESULT>						m_criticalError;
+
+	// True while the sound is paused.
+	bool										m_paused;
+};
@@ -0,0 +1,242 @@
+#include "pch.h"
+#include "SweepAndPrune2D.h"
+#include "CollisionDetection2D.h"
+
+#include <float.h>
+
+namespace
+{
+	// Returns true if the endpoint with value/data one belongs before the endpoint with value/data two. At equal values left (or top) ends go
+	// before right (or bottom) ends so that bounds whose edges touch are treated as overlapping.
+	inline bool IsEndpointLess(float valueOne, uint32 dataOne, float valueTwo, uint32 dataTwo)
+	{
+		return (valueOne < valueTwo) || (valueOne == valueTwo && (dataOne & 1) == 0 && (dataTwo & 1) != 0);
+	}
+}
+
+DX::SweepAndPrune2D::SweepAndPrune2D() :
+	m_proxies(),
+	m_freeProxies(),
+	m_endpointsX(),
+	m_endpointsY(),
+	m_pairs(),
+	m_pendingRemovedPairs(),
+	m_emptiedProxies()
+{
+}
+
+uint32 DX::SweepAndPrune2D::AddProxy(const Windows::Foundation::Rect& bounds)
+{
+	uint32 id;
+	if (!m_freeProxies.empty())
+	{
+		id = m_freeProxies.back();
+		m_freeProxies.pop_back();
+	}
+	else
+	{
+		id = static_cast<uint32>(m_proxies.size());
+		m_proxies.push_back(Proxy());
+	}
+
+	auto& proxy = m_proxies[id];
+	proxy.m_isInUse = true;
+	SetProxyBounds(proxy, bounds);
+
+	// Add the ends to the end of each axis. Update will sort them into place and find the proxy's pairs as it does so.
+	Endpoint endpoint;
+	endpoint.m_value = 0.0f;
+	endpoint.m_data = id << 1;
+	m_endpointsX.push_back(endpoint);
+	m_endpointsY.push_back(endpoint);
+	endpoint.m_data |= 1;
+	m_endpointsX.push_back(endpoint);
+	m_endpointsY.push_back(endpoint);
+
+	return id;
+}
+
+uint32 DX::SweepAndPrune2D::AddProxy(
+	float textureWidth,
+	float textureHeight,
+	DirectX::CXMMATRIX worldTransform
+	)
+{
+	return AddProxy(GetTransformedBoundingRectangle(Windows::Foundation::Rect(0.0f, 0.0f, textureWidth, textureHeight), worldTransform));
+}
+
+void DX::SweepAndPrune2D::UpdateProxy(
+	uint32 id,
+	const Windows::Foundation::Rect& bounds
+	)
+{
+	auto& proxy = m_proxies[id];
+	SetProxyBounds(proxy, bounds);
+
+	// An empty proxy doesn't overlap anything, but its ends might not pass anything when they move so Update removes its pairs directly.
+	if (proxy.m_isEmpty)
+	{
+		m_emptiedProxies.push_back(id);
+	}
+}
+
+void DX::SweepAndPrune2D::UpdateProxy(
+	uint32 id,
+	float textureWidth,
+	float textureHeight,
+	DirectX::CXMMATRIX worldTransform
+	)
+{
+	UpdateProxy(id, GetTransformedBoundingRectangle(Windows::Foundation::Rect(0.0f, 0.0f, textureWidth, textureHeight), worldTransform));
+}
+
+void DX::SweepAndPrune2D::RemoveProxy(uint32 id)
+{
+	RemoveProxyPairs(id);
+
+	auto isProxyEndpoint = [id](const Endpoint& endpoint) { return (endpoint.m_data >> 1) == id; };
+	m_endpointsX.erase(std::remove_if(m_endpointsX.begin(), m_endpointsX.end(), isProxyEndpoint), m_endpointsX.end());
+	m_endpointsY.erase(std::remove_if(m_endpointsY.begin(), m_endpointsY.end(), isProxyEndpoint), m_endpointsY.end());
+
+	m_proxies[id].m_isInUse = false;
+	m_freeProxies.push_back(id);
+}
+
+void DX::SweepAndPrune2D::Update(
+	std::vector<CollisionPair>& addedPairs,
+	std::vector<CollisionPair>& removedPairs
+	)
+{
+	addedPairs.clear();
+	removedPairs.clear();
+
+	// Remove the pairs of proxies that were given empty bounds (unless they have since been given non-empty bounds or been removed).
+	for (auto id : m_emptiedProxies)
+	{
+		if (m_proxies[id].m_isInUse && m_proxies[id].m_isEmpty)
+		{
+			RemoveProxyPairs(id);
+		}
+	}
+	m_emptiedProxies.clear();
+
+	removedPairs.swap(m_pendingRemovedPairs);
+
+	// Refresh the endpoint values from the proxies. This has to happen for both axes before either is sorted since sorting an axis tests
+	// the overlap of both axes.
+	for (auto& endpoint : m_endpointsX)
+	{
+		auto& proxy = m_proxies[endpoint.m_data >> 1];
+		endpoint.m_value = ((endpoint.m_data & 1) != 0) ? proxy.m_right : proxy.m_left;
+	}
+	for (auto& endpoint : m_endpointsY)
+	{
+		auto& proxy = m_proxies[endpoint.m_data >> 1];
+		endpoint.m_value = ((endpoint.m_data & 1) != 0) ? proxy.m_bottom : proxy.m_top;
+	}
+
+	SortAxis(m_endpointsX, addedPairs, removedPairs);
+	SortAxis(m_endpointsY, addedPairs, removedPairs);
+}
+
+void DX::SweepAndPrune2D::SetProxyBounds(
+	Proxy& proxy,
+	const Windows::Foundation::Rect& bounds
+	)
+{
+	proxy.m_isEmpty = bounds.IsEmpty;
+	if (proxy.m_isEmpty)
+	{
+		// Park empty proxies past the end of both axes so that they pass as few other ends as possible.
+		proxy.m_left = proxy.m_top = proxy.m_right = proxy.m_bottom = FLT_MAX;
+	}
+	else
+	{
+		proxy.m_left = bounds.Left;
+		proxy.m_top = bounds.Top;
+		proxy.m_right = bounds.Right;
+		proxy.m_bottom = bounds.Bottom;
+	}
+}
+
+void DX::SweepAndPrune2D::RemoveProxyPairs(uint32 id)
+{
+	for (auto iter = m_pairs.begin(); iter != m_pairs.end();)
+	{
+		auto first = static_cast<uint32>(*iter >> 32);
+		auto second = static_cast<uint32>(*iter);
+		if (first == id || second == id)
+		{
+			CollisionPair pair;
+			pair.m_first = first;
+			pair.m_second = second;
+			m_pendingRemovedPairs.push_back(pair);
+			iter = m_pairs.erase(iter);
+		}
+		else
+		{
+			++iter;
+		}
+	}
+}
+
+void DX::SweepAndPrune2D::SortAxis(
+	std::vector<Endpoint>& endpoints,
+	std::vector<CollisionPair>& addedPairs,
+	std::vector<CollisionPair>& removedPairs
+	)
+{
+	auto count = endpoints.size();
+	for (size_t i = 1; i < count; i++)
+	{
+		auto endpoint = endpoints[i];
+		auto j = i;
+
+		// Move the endpoint left until it is in order. Each endpoint that it passes is a pair of proxies whose order on this axis has changed.
+		while (j > 0 && IsEndpointLess(endpoint.m_value, endpoint.m_data, endpoints[j - 1].m_value, endpoints[j - 1].m_data))
+		{
+			auto& other = endpoints[j - 1];
+			auto id = endpoint.m_data >> 1;
+			auto otherId = other.m_data >> 1;
+			auto isMax = (endpoint.m_data & 1) != 0;
+			auto isOtherMax = (other.m_data & 1) != 0;
+
+			if (!isMax && isOtherMax)
+			{
+				// A left end passed a right end, so the proxies might overlap now. Every proxy already has its new bounds so test the final bounds
+				// on both axes. (The other ends might not have been sorted yet, and might never pass each other, so this axis has to be tested too.)
+				auto& proxy = m_proxies[id];
+				auto& otherProxy = m_proxies[otherId];
+				if (!proxy.m_isEmpty && !otherProxy.m_isEmpty &&
+					proxy.m_left <= otherProxy.m_right && otherProxy.m_left <= proxy.m_right &&
+					proxy.m_top <= otherProxy.m_bottom && otherProxy.m_top <= proxy.m_bottom)
+				{
+					// The pair may already have been added while sorting the other axis.
+					if (m_pairs.insert(GetPairKey(id, otherId)).second)
+					{
+						CollisionPair pair;
+						pair.m_first = min(id, otherId);
+						pair.m_second = max(id, otherId);
+						addedPairs.push_back(pair);
+					}
+				}
+			}
+			else if (isMax && !isOtherMax)
+			{
+				// A right end passed a left end, so the proxies no longer overlap on this axis.
+				if (m_pairs.erase(GetPairKey(id, otherId)) != 0)
+				{
+					CollisionPair pair;
+					pair.m_first = min(id, otherId);
+					pair.m_second = max(id, otherId);
+					removedPairs.push_back(pair);
+				}
+			}
+
+			endpoints[j] = other;
+			j--;
+		}
+
+		endpoints[j] = endpoint;
+	}
+}
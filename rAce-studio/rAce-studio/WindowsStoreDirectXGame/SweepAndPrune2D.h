@@ -0,0 +1,185 @@
+#pragma once
+
+#include <DirectXMath.h>
+
+#include <unordered_set>
+#include <utility>
+#include <vector>
+
+#include "SpatialHash2D.h"
+
+namespace DX
+{
+	// A sweep and prune broad phase for 2D collision detection. Unlike SpatialHash2D, which is rebuilt from scratch every frame, this keeps each
+	// sprite as a persistent proxy and keeps the ends of every proxy's bounds sorted along the X and Y axes from frame to frame. Sprites usually
+	// only move a little each frame so the arrays are nearly sorted already and insertion sort puts them back in order with very few swaps. The
+	// swaps are also exactly the places where two proxies start or stop overlapping, so Update reports which pairs were added and removed rather
+	// than producing the full list of overlapping pairs. Because nothing depends on a cell size this works well when sprite sizes vary a lot.
+	// Typical use: call AddProxy when a sprite is created, UpdateProxy whenever it moves, RemoveProxy when it goes away, and Update once per frame.
+	// Keep your own list of the pairs that are overlapping (based on the events) and pass them to IsTransformedPixelPerfectCollision each frame.
+	class SweepAndPrune2D
+	{
+	public:
+		// Constructor.
+		SweepAndPrune2D();
+
+		// Move constructor.
+		SweepAndPrune2D(SweepAndPrune2D&& value) :
+			m_proxies(),
+			m_freeProxies(),
+			m_endpointsX(),
+			m_endpointsY(),
+			m_pairs(),
+			m_pendingRemovedPairs(),
+			m_emptiedProxies()
+		{
+			// Invoke the move assignment operator.
+			*this = std::move(value);
+		}
+
+		// Move assignment operator.
+		SweepAndPrune2D& operator=(SweepAndPrune2D&& value)
+		{
+			if (this != &value)
+			{
+				m_proxies.swap(value.m_proxies);
+				m_freeProxies.swap(value.m_freeProxies);
+				m_endpointsX.swap(value.m_endpointsX);
+				m_endpointsY.swap(value.m_endpointsY);
+				m_pairs.swap(value.m_pairs);
+				m_pendingRemovedPairs.swap(value.m_pendingRemovedPairs);
+				m_emptiedProxies.swap(value.m_emptiedProxies);
+			}
+
+			return *this;
+		}
+
+		// Adds a proxy and returns its id. Ids of removed proxies are reused. The proxy's pairs are reported by the next call to Update.
+		// bounds - The bounding rectangle of the sprite in world space. Empty rectangles never overlap anything.
+		uint32 AddProxy(const Windows::Foundation::Rect& bounds);
+
+		// Adds a proxy for a transformed sprite and returns its id. The bounds are calculated with GetTransformedBoundingRectangle.
+		// textureWidth - The unscaled pixel width of the sprite's texture.
+		// textureHeight - The unscaled pixel height of the sprite's texture.
+		// worldTransform - The transform matrix for the sprite, as passed to IsTransformedPixelPerfectCollision.
+		uint32 AddProxy(
+			float textureWidth,
+			float textureHeight,
+			DirectX::CXMMATRIX worldTransform
+			);
+
+		// Changes the bounds of a proxy. The changes to its pairs are reported by the next call to Update.
+		// id - The id returned by AddProxy.
+		// bounds - The new bounding rectangle of the sprite in world space.
+		void UpdateProxy(
+			uint32 id,
+			const Windows::Foundation::Rect& bounds
+			);
+
+		// Changes the bounds of a proxy for a transformed sprite. The bounds are calculated with GetTransformedBoundingRectangle.
+		// id - The id returned by AddProxy.
+		// textureWidth - The unscaled pixel width of the sprite's texture.
+		// textureHeight - The unscaled pixel height of the sprite's texture.
+		// worldTransform - The new transform matrix for the sprite.
+		void UpdateProxy(
+			uint32 id,
+			float textureWidth,
+			float textureHeight,
+			DirectX::CXMMATRIX worldTransform
+			);
+
+		// Removes a proxy. Any pairs that it was part of are reported as removed by the next call to Update.
+		// id - The id returned by AddProxy.
+		void RemoveProxy(uint32 id);
+
+		// Re-sorts the axes and reports the pairs that started or stopped overlapping since the last call. Touching edges count as overlapping, the
+		// same as IsRectangleCollision. In each pair m_first is less than m_second. If a pair is in both lists then it was removed (e.g. because a
+		// proxy was removed) and then added again (e.g. because its id was reused), so process removedPairs first.
+		// addedPairs - Receives the pairs that started overlapping. It is cleared first.
+		// removedPairs - Receives the pairs that stopped overlapping. It is cleared first.
+		void Update(
+			std::vector<CollisionPair>& addedPairs,
+			std::vector<CollisionPair>& removedPairs
+			);
+
+		// Returns true if the two proxies were overlapping as of the last call to Update.
+		bool IsOverlapping(uint32 idOne, uint32 idTwo) const { return m_pairs.find(GetPairKey(idOne, idTwo)) != m_pairs.end(); }
+
+		// Returns the number of pairs that were overlapping as of the last call to Update.
+		uint32 GetPairCount() const { return static_cast<uint32>(m_pairs.size()); }
+
+	private:
+		// Disable copy constructor.
+		SweepAndPrune2D(const SweepAndPrune2D&);
+		// Disable copy assignment.
+		SweepAndPrune2D& operator=(const SweepAndPrune2D&);
+
+		// The bounds of a sprite.
+		struct Proxy
+		{
+			float					m_left;
+			float					m_top;
+			float					m_right;
+			float					m_bottom;
+			// True if the bounds are empty. The bounds of an empty proxy are moved past the end of both axes.
+			bool					m_isEmpty;
+			// False if the proxy has been removed and its id is waiting to be reused.
+			bool					m_isInUse;
+		};
+
+		// One end of a proxy's bounds on an axis.
+		struct Endpoint
+		{
+			// The coordinate of the end. Refreshed from the proxy at the start of each Update.
+			float					m_value;
+			// The proxy id shifted left by one. The low bit is set for the right (or bottom) end and clear for the left (or top) end.
+			uint32					m_data;
+		};
+
+		// Returns the key for a pair in m_pairs. The lower id is always in the high 32 bits.
+		static uint64 GetPairKey(uint32 idOne, uint32 idTwo)
+		{
+			return (idOne < idTwo) ? ((static_cast<uint64>(idOne) << 32) | idTwo) : ((static_cast<uint64>(idTwo) << 32) | idOne);
+		}
+
+		// Copies the bounds into the proxy.
+		void SetProxyBounds(
+			Proxy& proxy,
+			const Windows::Foundation::Rect& bounds
+			);
+
+		// Removes all of the pairs that a proxy is part of and queues them up to be reported by the next call to Update.
+		void RemoveProxyPairs(uint32 id);
+
+		// Insertion sorts an axis, adding and removing pairs as ends pass each other.
+		// endpoints - The endpoints of the axis.
+		// addedPairs - Receives the pairs that started overlapping.
+		// removedPairs - Receives the pairs that stopped overlapping.
+		void SortAxis(
+			std::vector<Endpoint>& endpoints,
+			std::vector<CollisionPair>& addedPairs,
+			std::vector<CollisionPair>& removedPairs
+			);
+
+		// The proxies, indexed by id.
+		std::vector<Proxy>				m_proxies;
+
+		// The ids of removed proxies that can be reused.
+		std::vector<uint32>				m_freeProxies;
+
+		// The ends of every proxy on the X axis, sorted by value.
+		std::vector<Endpoint>			m_endpointsX;
+
+		// The ends of every proxy on the Y axis, sorted by value.
+		std::vector<Endpoint>			m_endpointsY;
+
+		// The keys (see GetPairKey) of every pair of proxies that overlap.
+		std::unordered_set<uint64>		m_pairs;
+
+		// Pairs that were removed by RemoveProxy that haven't been reported by Update yet.
+		std::vector<CollisionPair>		m_pendingRemovedPairs;
+
+		// Proxies that UpdateProxy has given empty bounds since the last call to Update.
+		std::vector<uint32>				m_emptiedProxies;
+	};
+}
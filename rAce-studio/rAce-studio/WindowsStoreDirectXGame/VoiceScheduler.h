@@ -0,0 +1,1007 @@
+#pragma once
+
+// Portable (see README_PORTABLE.txt) so that the voice pool's logic can be driven by a fake voice. It is a template so there is no .cpp file.
+#include <atomic>
+#include <cmath>
+#include <cstdint>
+#include <memory>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+
+#include "SpscRing.h"
+
+namespace DX
+{
+	// The kinds of VoiceCommand.
+	enum class VoiceCommandType : uint32_t
+	{
+		// Submit m_play and start the voice.
+		Play,
+		// Stop the voice (with the flags in m_value) and flush its buffers.
+		Stop,
+		// Set the voice's volume to m_volume.
+		SetVolume,
+		// Stop the voice without flushing its buffers.
+		Pause,
+		// Start the voice again after Pause.
+		Resume,
+		// Forget the audio thread state of a voice that has been destroyed and recreated. Always carried out, whatever its m_epoch.
+		Forget,
+		// Set the voice's output matrix and/or frequency ratio, as flagged in m_value (see VoiceScheduler::OutputMatrixFlag).
+		SetOutput,
+	};
+
+	// A command from the game thread to the audio thread. See VoiceScheduler.
+	template<class PlayData>
+	struct VoiceCommand
+	{
+		// What to do.
+		VoiceCommandType							m_type;
+		// The index of the voice to do it to.
+		uint32_t									m_voice;
+		// The voice's epoch when the command was queued. The command is skipped if the voice has been destroyed since.
+		uint32_t									m_epoch;
+		// Play: the play id, which the voice passes back to VoiceScheduler::OnBufferEnd.
+		uint32_t									m_playId;
+		// Play: the loop count. Stop: the stop flags. SetOutput: what to set.
+		uint32_t									m_value;
+		// SetVolume: the volume. SetOutput: the attenuation, which is the gain when the output is mono.
+		float										m_volume;
+		// SetOutput: the gains of the left and right output channels and the frequency ratio.
+		float										m_left;
+		float										m_right;
+		float										m_frequencyRatio;
+		// Play: what to play (e.g. the buffer to submit).
+		PlayData									m_play;
+	};
+
+	// The kinds of VoiceNotification.
+	enum class VoiceNotificationType : uint32_t
+	{
+		// A buffer finished playing (or was flushed). Every play submits one buffer, so this is the end of the play.
+		BufferEnd,
+		// The voice had a critical error (or one of the commands for it failed).
+		Error,
+	};
+
+	// A notification from the audio thread to the game thread. See VoiceScheduler.
+	struct VoiceNotification
+	{
+		// What happened.
+		VoiceNotificationType						m_type;
+		// The index of the voice it happened to.
+		uint32_t									m_voice;
+		// The id of the play it happened to. Notifications for earlier plays are ignored.
+		uint32_t									m_playId;
+		// Error: the error code (an HRESULT).
+		int32_t										m_result;
+		// Error: the number of loops that were left to play.
+		uint32_t									m_loopCount;
+	};
+
+	// The bookkeeping of a pool of voices that is shared by many sounds, apart from the voices themselves. A voice can only play data in the
+	// format it was created with, so the voices are split into groups, one for each format, and each group keeps a free list of its idle voices.
+	// When all of a group's voices are busy, the voice playing the lowest priority sound is stolen, with ties going to the quietest voice
+	// (counting the attenuation of a positional play) and then to the oldest one.
+	//
+	// The game thread owns the bookkeeping and never touches the voices. Instead it queues commands (play, stop, volume, output, pause and resume)
+	// that the audio thread carries out on the voices in ExecuteCommands, and the voices' callbacks on the audio thread (OnBufferEnd and
+	// OnVoiceError) queue notifications that the game thread handles in Update. Both queues are lock-free single producer single consumer rings
+	// (see SpscRing) so neither thread ever waits for the other. Each play of a voice gets a new play id, which the voice passes back with its
+	// buffer end, so the end of a play that was stopped or stolen can't free the voice from under the play that replaced it. Each voice also has an
+	// epoch that the game thread bumps before it destroys the voice, so that the audio thread skips the commands that were queued for the old
+	// voice. The audio thread only starts a play when the notification queue has room for every notification that could follow, so the callbacks
+	// never find it full.
+	//
+	// AudioEngine's VoicePool drives XAudio2 source voices with it; PortableTests drives it with a fake voice.
+	// PlayData - What a Play command carries to the audio thread (e.g. the buffer to submit). Must be copyable and value initializable.
+	template<class PlayData>
+	class VoiceScheduler
+	{
+	public:
+		typedef DX::VoiceCommand<PlayData> Command;
+
+		// The index that means no voice.
+		static const uint32_t NoVoice = 0xFFFFFFFF;
+
+		// The loop count that means loop forever. The same value as XAUDIO2_LOOP_INFINITE.
+		static const uint32_t LoopInfinite = 255;
+
+		// The capacity of the command and notification queues.
+		static const uint32_t QueueCapacity = 1024;
+
+		// The most voices the scheduler can hold, across all groups. A playing voice has room reserved for up to two notifications (the end of
+		// its buffer and an error) so that the audio thread never finds the notification queue full.
+		static const uint32_t MaxVoices = QueueCapacity / 2;
+
+		// The flags of a SetOutput command: set the output matrix from the gains, set the frequency ratio, or go back to the default output
+		// matrix and a frequency ratio of 1.
+		static const uint32_t OutputMatrixFlag = 0x1;
+		static const uint32_t FrequencyRatioFlag = 0x2;
+		static const uint32_t DefaultOutputFlag = 0x4;
+
+		// The smallest changes in gain and frequency ratio that SetOutput passes on to the voice. Smaller ones can't be heard.
+		static const float OutputGainTolerance;
+		static const float FrequencyRatioTolerance;
+
+		// Constructor. Allocates everything the scheduler will ever need, so the audio thread never sees the voices move.
+		VoiceScheduler() :
+			m_groups(),
+			m_voices(new Voice[MaxVoices]),
+			m_voiceCount(),
+			m_nextStartOrder(),
+			m_commands(QueueCapacity),
+			m_overflowCommands(),
+			m_notifications(QueueCapacity),
+			m_reservedNotifications()
+		{
+		}
+
+		// Adds a group of idle voices and returns its index. The new voices follow the existing ones, so the group's first voice is the old
+		// GetVoiceCount(). Throws std::length_error if the group is empty or would take the scheduler past MaxVoices.
+		// voiceCount - The number of voices in the group.
+		uint32_t AddGroup(uint32_t voiceCount)
+		{
+			if (voiceCount == 0 || voiceCount > MaxVoices - m_voiceCount)
+			{
+				throw std::length_error("voiceCount");
+			}
+
+			Group group;
+			group.m_firstVoice = m_voiceCount;
+			group.m_voiceCount = voiceCount;
+			group.m_freeVoices.reserve(voiceCount);
+			m_groups.push_back(std::move(group));
+
+			auto groupIndex = static_cast<uint32_t>(m_groups.size() - 1);
+			for (uint32_t i = 0; i < voiceCount; ++i)
+			{
+				m_voices[m_voiceCount].m_group = groupIndex;
+				m_groups[groupIndex].m_freeVoices.push_back(m_voiceCount);
+				++m_voiceCount;
+			}
+
+			return groupIndex;
+		}
+
+		// Returns the number of groups.
+		uint32_t GetGroupCount() const { return static_cast<uint32_t>(m_groups.size()); }
+
+		// Returns the number of voices, across all groups.
+		uint32_t GetVoiceCount() const { return m_voiceCount; }
+
+		// Returns the index of a group's first voice. A group's voices are contiguous.
+		uint32_t GetFirstVoice(uint32_t group) const { return m_groups[group].m_firstVoice; }
+
+		// Returns the number of voices in a group.
+		uint32_t GetGroupVoiceCount(uint32_t group) const { return m_groups[group].m_voiceCount; }
+
+		// Returns the number of voices in a group's free list.
+		uint32_t GetFreeVoiceCount(uint32_t group) const { return static_cast<uint32_t>(m_groups[group].m_freeVoices.size()); }
+
+		// Returns the index of a voice to play a sound on, or NoVoice if every voice in the group is playing a higher priority sound. The voice
+		// comes from the free list if it has one. Otherwise a voice is stolen (and a command to stop it is queued). Pass the voice to Start.
+		// group - The index of the group.
+		// priority - The priority of the sound that is to be played.
+		uint32_t Acquire(uint32_t group, uint32_t priority)
+		{
+			auto& voiceGroup = m_groups[group];
+
+			// Collect any voices whose plays have ended since the last frame before resorting to stealing one.
+			if (voiceGroup.m_freeVoices.empty())
+			{
+				ProcessNotifications();
+			}
+
+			if (!voiceGroup.m_freeVoices.empty())
+			{
+				auto index = voiceGroup.m_freeVoices.back();
+				voiceGroup.m_freeVoices.pop_back();
+				auto& voice = m_voices[index];
+				voice.m_started = true;
+				++voice.m_generation;
+				voice.m_positional = false;
+				return index;
+			}
+
+			// Every voice is playing, so steal the one playing the lowest priority sound, preferring the quietest (counting the attenuation of a
+			// positional play) and then the oldest voice. A voice that is playing a higher priority sound is never stolen.
+			uint32_t stolen = NoVoice;
+			for (uint32_t i = voiceGroup.m_firstVoice; i < voiceGroup.m_firstVoice + voiceGroup.m_voiceCount; ++i)
+			{
+				auto& voice = m_voices[i];
+				if (voice.m_priority > priority)
+				{
+					continue;
+				}
+
+				if (stolen == NoVoice)
+				{
+					stolen = i;
+					continue;
+				}
+
+				auto& stolenVoice = m_voices[stolen];
+				float volume = voice.m_volume * voice.m_attenuation;
+				float stolenVolume = stolenVoice.m_volume * stolenVoice.m_attenuation;
+				if (voice.m_priority < stolenVoice.m_priority ||
+					(voice.m_priority == stolenVoice.m_priority && (volume < stolenVolume ||
+					(volume == stolenVolume && voice.m_startOrder < stolenVoice.m_startOrder))))
+				{
+					stolen = i;
+				}
+			}
+
+			if (stolen != NoVoice)
+			{
+				QueueCommand(VoiceCommandType::Stop, stolen, 0U);
+				++m_voices[stolen].m_generation;
+				m_voices[stolen].m_positional = false;
+			}
+
+			return stolen;
+		}
+
+		// Makes the next play of a voice returned by Acquire positional, with the output that Start queues before the play. Call it between
+		// Acquire and Start; after that, use SetOutput.
+		// voice - The index of the voice.
+		// left - The gain of the left output channel.
+		// right - The gain of the right output channel.
+		// attenuation - The attenuation alone. Used as the gain when the output is mono.
+		// frequencyRatio - The frequency ratio.
+		void SetPositional(
+			uint32_t voice,
+			float left,
+			float right,
+			float attenuation,
+			float frequencyRatio
+			)
+		{
+			auto& state = m_voices[voice];
+			state.m_positional = true;
+			state.m_outputLeft = left;
+			state.m_outputRight = right;
+			state.m_attenuation = attenuation;
+			state.m_frequencyRatio = frequencyRatio;
+		}
+
+		// Queues the commands to start a play on a voice returned by Acquire. A positional play's output (see SetPositional) is queued first; any
+		// other play's output goes back to the defaults if a positional play changed it. A volume that was set for an earlier play goes back to 1.
+		// voice - The index of the voice.
+		// play - What to play.
+		// sound - Identifies the sound, for StopSound, SetSoundVolume and CountSound.
+		// priority - The sound's priority.
+		// loopCount - The number of times to play the loop region again after the first time through, or LoopInfinite.
+		void Start(
+			uint32_t voice,
+			const PlayData& play,
+			uint64_t sound,
+			uint32_t priority,
+			uint32_t loopCount
+			)
+		{
+			auto& state = m_voices[voice];
+
+			// Reset the error values to their defaults.
+			state.m_error = false;
+			state.m_result = 0;
+
+			// Start a new play. The voice passes its id back with the end of its buffer so that the end of this play can be told from that of any
+			// earlier one.
+			++state.m_playId;
+			state.m_sound = sound;
+			state.m_priority = priority;
+			state.m_startOrder = m_nextStartOrder++;
+
+			// Keep the loop count so that the play can be restarted with the proper number of remaining loops if the voice needs recreating.
+			state.m_loopCount = loopCount;
+
+			// A stolen voice may have had its volume changed for the sound it was playing.
+			if (state.m_volume != 1.0f)
+			{
+				auto command = Command();
+				command.m_type = VoiceCommandType::SetVolume;
+				command.m_voice = voice;
+				command.m_epoch = state.m_epoch.load(std::memory_order_relaxed);
+				command.m_volume = 1.0f;
+				QueueCommand(command);
+				state.m_volume = 1.0f;
+			}
+
+			// Put a positional play where it belongs before it starts. Any other play goes back to the default output if a positional play changed it.
+			if (state.m_positional)
+			{
+				auto command = Command();
+				command.m_type = VoiceCommandType::SetOutput;
+				command.m_voice = voice;
+				command.m_epoch = state.m_epoch.load(std::memory_order_relaxed);
+				command.m_value = OutputMatrixFlag | FrequencyRatioFlag;
+				command.m_volume = state.m_attenuation;
+				command.m_left = state.m_outputLeft;
+				command.m_right = state.m_outputRight;
+				command.m_frequencyRatio = state.m_frequencyRatio;
+				QueueCommand(command);
+				state.m_outputChanged = true;
+			}
+			else
+			{
+				if (state.m_outputChanged)
+				{
+					QueueCommand(VoiceCommandType::SetOutput, voice, DefaultOutputFlag);
+					state.m_outputChanged = false;
+				}
+				state.m_attenuation = 1.0f;
+				state.m_frequencyRatio = 1.0f;
+			}
+
+			auto command = Command();
+			command.m_type = VoiceCommandType::Play;
+			command.m_voice = voice;
+			command.m_epoch = state.m_epoch.load(std::memory_order_relaxed);
+			command.m_playId = state.m_playId;
+			command.m_value = loopCount;
+			command.m_play = play;
+			QueueCommand(command);
+
+			state.m_started = true;
+		}
+
+		// Queues a command to stop a voice and returns it to the free list.
+		// voice - The index of the voice. Must be playing.
+		// flags - The stop flags (e.g. XAUDIO2_PLAY_TAILS).
+		void Stop(uint32_t voice, uint32_t flags)
+		{
+			QueueCommand(VoiceCommandType::Stop, voice, flags);
+			Free(voice);
+		}
+
+		// Queues commands to stop every voice in a group that is playing a sound and returns the voices to the free list.
+		// group - The index of the sound's group.
+		// sound - Identifies the sound.
+		// flags - The stop flags (e.g. XAUDIO2_PLAY_TAILS).
+		void StopSound(
+			uint32_t group,
+			uint64_t sound,
+			uint32_t flags
+			)
+		{
+			auto& voiceGroup = m_groups[group];
+			for (uint32_t i = voiceGroup.m_firstVoice; i < voiceGroup.m_firstVoice + voiceGroup.m_voiceCount; ++i)
+			{
+				if (m_voices[i].m_started && m_voices[i].m_sound == sound)
+				{
+					Stop(i, flags);
+				}
+			}
+		}
+
+		// Queues commands to set the volume of every voice in a group that is playing a sound.
+		// group - The index of the sound's group.
+		// sound - Identifies the sound.
+		// volume - The volume, as an amplitude multiplier (1.0 is unchanged).
+		void SetSoundVolume(
+			uint32_t group,
+			uint64_t sound,
+			float volume
+			)
+		{
+			auto& voiceGroup = m_groups[group];
+			for (uint32_t i = voiceGroup.m_firstVoice; i < voiceGroup.m_firstVoice + voiceGroup.m_voiceCount; ++i)
+			{
+				auto& state = m_voices[i];
+				if (state.m_started && state.m_volume != volume && state.m_sound == sound)
+				{
+					auto command = Command();
+					command.m_type = VoiceCommandType::SetVolume;
+					command.m_voice = i;
+					command.m_epoch = state.m_epoch.load(std::memory_order_relaxed);
+					command.m_volume = volume;
+					QueueCommand(command);
+					state.m_volume = volume;
+				}
+			}
+		}
+
+		// Returns the number of voices in a group that are playing a sound. Plays that ended since the last Update are still counted.
+		// group - The index of the sound's group.
+		// sound - Identifies the sound.
+		uint32_t CountSound(
+			uint32_t group,
+			uint64_t sound
+			) const
+		{
+			auto& voiceGroup = m_groups[group];
+			uint32_t count = 0;
+			for (uint32_t i = voiceGroup.m_firstVoice; i < voiceGroup.m_firstVoice + voiceGroup.m_voiceCount; ++i)
+			{
+				if (m_voices[i].m_started && m_voices[i].m_sound == sound)
+				{
+					++count;
+				}
+			}
+
+			return count;
+		}
+
+		// Queues a single command that sets the parts of a positional play's output that have changed noticeably since they were last set.
+		// voice - The index of the voice.
+		// left - The gain of the left output channel.
+		// right - The gain of the right output channel.
+		// attenuation - The attenuation alone. Used as the gain when the output is mono.
+		// frequencyRatio - The frequency ratio.
+		void SetOutput(
+			uint32_t voice,
+			float left,
+			float right,
+			float attenuation,
+			float frequencyRatio
+			)
+		{
+			// Only pass on the changes that can be heard, so that voices that are standing still cost nothing on the audio thread.
+			auto& state = m_voices[voice];
+			uint32_t flags = 0;
+			if (std::abs(left - state.m_outputLeft) > OutputGainTolerance ||
+				std::abs(right - state.m_outputRight) > OutputGainTolerance ||
+				std::abs(attenuation - state.m_attenuation) > OutputGainTolerance)
+			{
+				flags |= OutputMatrixFlag;
+				state.m_outputLeft = left;
+				state.m_outputRight = right;
+				state.m_attenuation = attenuation;
+			}
+
+			if (std::abs(frequencyRatio - state.m_frequencyRatio) > FrequencyRatioTolerance)
+			{
+				flags |= FrequencyRatioFlag;
+				state.m_frequencyRatio = frequencyRatio;
+			}
+
+			if (flags == 0)
+			{
+				return;
+			}
+
+			auto command = Command();
+			command.m_type = VoiceCommandType::SetOutput;
+			command.m_voice = voice;
+			command.m_epoch = state.m_epoch.load(std::memory_order_relaxed);
+			command.m_value = flags;
+			command.m_volume = state.m_attenuation;
+			command.m_left = state.m_outputLeft;
+			command.m_right = state.m_outputRight;
+			command.m_frequencyRatio = state.m_frequencyRatio;
+			QueueCommand(command);
+			state.m_outputChanged = true;
+		}
+
+		// Returns a voice to its group's free list without stopping it. Use for a voice that can't be played any longer, e.g. after a critical error.
+		// voice - The index of the voice.
+		void Free(uint32_t voice)
+		{
+			m_voices[voice].m_started = false;
+			m_groups[m_voices[voice].m_group].m_freeVoices.push_back(voice);
+		}
+
+		// Destroys and recreates a voice (e.g. after a critical error): bumps its epoch so that the audio thread skips the commands that were
+		// queued for the old voice, calls recreate, and then has the audio thread forget the notifications it was expecting from the old voice.
+		// The new voice starts at full volume with the default output. It stays out of the free list.
+		// voice - The index of the voice.
+		// recreate - A function or lambda with the signature void () that destroys the voice and creates it again. It must not return until the
+		// audio thread is done with the old voice (IXAudio2Voice::DestroyVoice waits for it).
+		template<class Recreate>
+		void RecreateVoice(uint32_t voice, Recreate recreate)
+		{
+			auto& state = m_voices[voice];
+			state.m_epoch.fetch_add(1);
+			recreate();
+			ResetOutput(state);
+
+			// A destroyed voice sends no more notifications, so have the audio thread forget the ones it was expecting from it.
+			QueueCommand(VoiceCommandType::Forget, voice, 0U);
+		}
+
+		// Destroys every voice and puts every one of them back on its group's free list. The audio thread skips any commands that are still
+		// queued for them since their epochs change. Call DiscardCommands once the audio thread has stopped.
+		// destroy - A function or lambda with the signature void (uint32_t voice) that destroys a voice.
+		template<class Destroy>
+		void DestroyVoices(Destroy destroy)
+		{
+			for (auto& voiceGroup : m_groups)
+			{
+				voiceGroup.m_freeVoices.clear();
+			}
+
+			for (uint32_t i = 0; i < m_voiceCount; ++i)
+			{
+				auto& state = m_voices[i];
+				state.m_epoch.fetch_add(1);
+				destroy(i);
+				state.m_started = false;
+				ResetOutput(state);
+				m_groups[state.m_group].m_freeVoices.push_back(i);
+			}
+		}
+
+		// Throws away the commands that the audio thread didn't get to and resets the audio thread state. Call this when no audio thread can be
+		// running (e.g. after the audio engine has been destroyed and before another one is created).
+		void DiscardCommands()
+		{
+			// With no audio thread the game thread can take the consumer side of the command queue.
+			while (m_commands.Peek() != nullptr)
+			{
+				m_commands.Pop();
+			}
+			m_overflowCommands.clear();
+
+			// The notifications that are left are all for destroyed voices. Handling them just drops them.
+			ProcessNotifications();
+
+			for (uint32_t i = 0; i < m_voiceCount; ++i)
+			{
+				m_voices[i].m_pendingBufferEnds = 0;
+				m_voices[i].m_errorReportable = false;
+			}
+			m_reservedNotifications = 0;
+		}
+
+		// Handles the notifications from the audio thread (returning the voices whose plays ended to their free lists and recording the errors)
+		// and queues any commands that didn't fit in the command queue earlier. Call this once per frame.
+		void Update()
+		{
+			// Move the commands that didn't fit earlier into the queue, oldest first.
+			size_t moved = 0;
+			while (moved < m_overflowCommands.size() && m_commands.TryPush(m_overflowCommands[moved]))
+			{
+				++moved;
+			}
+			m_overflowCommands.erase(m_overflowCommands.begin(), m_overflowCommands.begin() + moved);
+
+			ProcessNotifications();
+		}
+
+		// Queues commands to stop all of the voices that are playing, without flushing them.
+		void Pause()
+		{
+			for (uint32_t i = 0; i < m_voiceCount; ++i)
+			{
+				if (m_voices[i].m_started)
+				{
+					QueueCommand(VoiceCommandType::Pause, i, 0U);
+				}
+			}
+		}
+
+		// Queues commands to start all of the voices that are playing again.
+		void Resume()
+		{
+			for (uint32_t i = 0; i < m_voiceCount; ++i)
+			{
+				if (m_voices[i].m_started)
+				{
+					QueueCommand(VoiceCommandType::Resume, i, 0U);
+				}
+			}
+		}
+
+		// Returns true if a voice is still on the play that it was given for, i.e. that play hasn't ended (as of the last Update), been stopped
+		// or had its voice stolen.
+		// voice - The index of the voice.
+		// generation - The voice's generation when the play started (see GetGeneration).
+		bool IsPlaying(uint32_t voice, uint32_t generation) const
+		{
+			return voice < m_voiceCount && m_voices[voice].m_started && m_voices[voice].m_generation == generation;
+		}
+
+		// Returns true from the time a voice is taken from its group's free list until it is returned to it.
+		bool IsStarted(uint32_t voice) const { return m_voices[voice].m_started; }
+
+		// Returns the number that a voice's generation is bumped to each time it is taken for a new play, so that the handles of earlier plays
+		// can be rejected.
+		uint32_t GetGeneration(uint32_t voice) const { return m_voices[voice].m_generation; }
+
+		// Returns the sound that a voice is playing.
+		uint64_t GetSound(uint32_t voice) const { return m_voices[voice].m_sound; }
+
+		// Returns the loop count that a voice was started with, or the number of loops that were left when it had an error.
+		uint32_t GetLoopCount(uint32_t voice) const { return m_voices[voice].m_loopCount; }
+
+		// Returns the volume that was last set on a voice.
+		float GetVolume(uint32_t voice) const { return m_voices[voice].m_volume; }
+
+		// Returns true if a voice's play is positional (see SetPositional).
+		bool IsPositional(uint32_t voice) const { return m_voices[voice].m_positional; }
+
+		// Returns the group that a voice belongs to.
+		uint32_t GetGroup(uint32_t voice) const { return m_voices[voice].m_group; }
+
+		// Returns the error code that a voice's last error notification carried and clears it, or returns 0 if the voice has had no error since
+		// it was started (or since the last call).
+		// voice - The index of the voice.
+		int32_t TakeError(uint32_t voice)
+		{
+			auto& state = m_voices[voice];
+			int32_t result = state.m_error ? state.m_result : 0;
+			state.m_error = false;
+			state.m_result = 0;
+			return result;
+		}
+
+		// Carries out the queued commands. Only called on the audio thread (e.g. at the start of each processing pass). A Play waits, along with
+		// everything queued after it, until the notification queue has room for every notification that could follow it.
+		// voices - Carries the commands out on the voices. Each of these methods gets the index of the voice and returns a negative error code
+		// (an HRESULT) if it fails, which is sent back as an Error notification:
+		//   bool IsCreated(uint32_t voice) - Returns false if the voice doesn't exist (its commands are skipped). Doesn't fail.
+		//   int32_t Submit(uint32_t voice, const PlayData& play, uint32_t playId) - Queues play's buffer. The voice must call OnBufferEnd with
+		//     playId once the buffer has finished playing or has been flushed.
+		//   int32_t Start(uint32_t voice) - Starts the voice.
+		//   int32_t Stop(uint32_t voice, uint32_t flags) - Stops the voice, leaving its buffers queued.
+		//   int32_t Flush(uint32_t voice) - Flushes the voice's queued buffers.
+		//   int32_t SetVolume(uint32_t voice, float volume) - Sets the voice's volume.
+		//   int32_t SetOutput(uint32_t voice, const Command& command) - Sets the voice's output as flagged in command.m_value.
+		template<class Voices>
+		void ExecuteCommands(Voices& voices)
+		{
+			const Command* command;
+			while ((command = m_commands.Peek()) != nullptr)
+			{
+				if (!ExecuteCommand(*command, voices))
+				{
+					// Try again next pass, once the game thread has made room in the notification queue.
+					break;
+				}
+
+				m_commands.Pop();
+			}
+		}
+
+		// Queues a BufferEnd notification. Only called on the audio thread, when a voice has finished playing a buffer (or has flushed it).
+		// voice - The index of the voice.
+		// playId - The play id that the buffer was submitted with.
+		void OnBufferEnd(uint32_t voice, uint32_t playId)
+		{
+			Notify(VoiceNotificationType::BufferEnd, voice, playId, 0);
+		}
+
+		// Counts down a voice's loops. Only called on the audio thread, when a voice reaches the end of its loop region.
+		// voice - The index of the voice.
+		void OnLoopEnd(uint32_t voice)
+		{
+			auto& state = m_voices[voice];
+			if (state.m_audioLoopCount != LoopInfinite)
+			{
+				--state.m_audioLoopCount;
+			}
+		}
+
+		// Queues an Error notification for the voice's current play. Only called on the audio thread, when a voice has a critical error. Only the
+		// first error of each play is sent.
+		// voice - The index of the voice.
+		// result - The error code (an HRESULT).
+		void OnVoiceError(uint32_t voice, int32_t result)
+		{
+			Notify(VoiceNotificationType::Error, voice, m_voices[voice].m_audioPlayId, result);
+		}
+
+		// Returns the number of notifications that the voices may still send. Only called on the audio thread. Never more than QueueCapacity.
+		uint32_t GetReservedNotificationCount() const { return m_reservedNotifications; }
+
+	private:
+		// Disable copy constructor.
+		VoiceScheduler(const VoiceScheduler&);
+		// Disable copy assignment.
+		VoiceScheduler& operator=(const VoiceScheduler&);
+
+		// The voices for one format.
+		struct Group
+		{
+			// The index of the group's first voice. A group's voices are contiguous.
+			uint32_t								m_firstVoice;
+			// The number of voices in the group.
+			uint32_t								m_voiceCount;
+			// The group's idle voices. Its capacity is reserved up front so returning a voice never allocates.
+			std::vector<uint32_t>					m_freeVoices;
+		};
+
+		// The state of one voice. It is split between the game thread and the audio thread and neither thread touches the other's.
+		struct Voice
+		{
+			Voice() :
+				m_epoch(0),
+				m_group(),
+				m_started(),
+				m_playId(),
+				m_generation(),
+				m_sound(),
+				m_priority(),
+				m_loopCount(),
+				m_error(),
+				m_result(),
+				m_volume(1.0f),
+				m_startOrder(),
+				m_positional(),
+				m_outputLeft(),
+				m_outputRight(),
+				m_attenuation(1.0f),
+				m_frequencyRatio(1.0f),
+				m_outputChanged(),
+				m_audioPlayId(),
+				m_audioLoopCount(),
+				m_pendingBufferEnds(),
+				m_errorReportable()
+			{
+			}
+
+			// Incremented by the game thread just before the voice is destroyed so that the audio thread skips the commands that were queued
+			// for it.
+			std::atomic<uint32_t>					m_epoch;
+			// The index of the voice's group. Never changes.
+			uint32_t								m_group;
+
+			// Game thread state.
+
+			// True from the time the voice is taken from its group's free list until it is returned to it.
+			bool									m_started;
+			// Identifies the current play of the voice, so that the end of an earlier play (one that was stopped or stolen) is ignored.
+			uint32_t								m_playId;
+			// Bumped each time the voice is taken for a new play. See IsPlaying.
+			uint32_t								m_generation;
+			// The sound that the voice is playing.
+			uint64_t								m_sound;
+			// The priority of the sound that the voice is playing.
+			uint32_t								m_priority;
+			// The loop count that the voice was started with, or the number of loops that were left when it had an error.
+			uint32_t								m_loopCount;
+			// Set to true when an Error notification arrives, with its error code in m_result.
+			bool									m_error;
+			int32_t									m_result;
+			// The volume that was last set on the voice. Used to choose the quietest voice when one has to be stolen.
+			float									m_volume;
+			// When the voice was started, from m_nextStartOrder. Used to choose the oldest voice when one has to be stolen.
+			uint64_t								m_startOrder;
+			// True if the play is positional (see SetPositional).
+			bool									m_positional;
+			// The output gains, attenuation and frequency ratio that were last queued for a positional play. The attenuation stays at 1 for
+			// any other play. Used to only queue changes, and (with m_volume) to choose the quietest voice when one has to be stolen.
+			float									m_outputLeft;
+			float									m_outputRight;
+			float									m_attenuation;
+			float									m_frequencyRatio;
+			// True if the voice's output matrix or frequency ratio may differ from the defaults.
+			bool									m_outputChanged;
+
+			// Audio thread state.
+
+			// The id of the play that the audio thread last started.
+			uint32_t								m_audioPlayId;
+			// The number of loops left to play. Decrements each loop unless set to LoopInfinite.
+			uint32_t								m_audioLoopCount;
+			// The number of submitted buffers whose OnBufferEnd hasn't been called yet. Each one will send a BufferEnd notification.
+			uint32_t								m_pendingBufferEnds;
+			// True if the voice may still send an Error notification for its current play. Only one is sent per play.
+			bool									m_errorReportable;
+
+		private:
+			// Disable copy constructor.
+			Voice(const Voice&);
+			// Disable copy assignment.
+			Voice& operator=(const Voice&);
+		};
+
+		// Resets the game thread's record of a new voice's volume, output and error: a new voice starts at full volume with the default output.
+		static void ResetOutput(Voice& state)
+		{
+			state.m_error = false;
+			state.m_result = 0;
+			state.m_volume = 1.0f;
+			state.m_outputChanged = false;
+		}
+
+		// Queues a command. If the command queue is full the command waits (in order) in m_overflowCommands until Update.
+		void QueueCommand(const Command& command)
+		{
+			// Keep the commands in order: once one has overflowed the rest follow it until Update moves them into the queue.
+			if (!m_overflowCommands.empty() || !m_commands.TryPush(command))
+			{
+				m_overflowCommands.push_back(command);
+			}
+		}
+
+		// Queues a command with no arguments for a voice.
+		void QueueCommand(VoiceCommandType type, uint32_t voice, uint32_t value)
+		{
+			auto command = Command();
+			command.m_type = type;
+			command.m_voice = voice;
+			command.m_epoch = m_voices[voice].m_epoch.load(std::memory_order_relaxed);
+			command.m_value = value;
+			QueueCommand(command);
+		}
+
+		// Handles the notifications from the audio thread.
+		void ProcessNotifications()
+		{
+			VoiceNotification notification;
+			while (m_notifications.TryPop(notification))
+			{
+				auto& state = m_voices[notification.m_voice];
+
+				// Ignore the notifications for earlier plays and for voices that are back in the free list.
+				if (!state.m_started || notification.m_playId != state.m_playId)
+				{
+					continue;
+				}
+
+				if (notification.m_type == VoiceNotificationType::BufferEnd)
+				{
+					Free(notification.m_voice);
+				}
+				else
+				{
+					state.m_error = true;
+					state.m_result = notification.m_result;
+					state.m_loopCount = notification.m_loopCount;
+				}
+			}
+		}
+
+		// Carries out a command on the audio thread. Returns false if the command has to wait for room in the notification queue.
+		template<class Voices>
+		bool ExecuteCommand(const Command& command, Voices& voices)
+		{
+			auto& state = m_voices[command.m_voice];
+
+			if (command.m_type == VoiceCommandType::Forget)
+			{
+				m_reservedNotifications -= state.m_pendingBufferEnds + (state.m_errorReportable ? 1U : 0U);
+				state.m_pendingBufferEnds = 0;
+				state.m_errorReportable = false;
+				return true;
+			}
+
+			// Skip the commands for a voice that has been destroyed since they were queued. The epoch has to be checked first: while a voice is
+			// being recreated the game thread replaces it, but only the commands queued after that carry the new epoch.
+			if (command.m_epoch != state.m_epoch.load(std::memory_order_acquire) || !voices.IsCreated(command.m_voice))
+			{
+				return true;
+			}
+
+			int32_t result = 0;
+			switch (command.m_type)
+			{
+			case VoiceCommandType::Play:
+				{
+					// Only start the play if every notification that could follow it still fits: the end of its buffer and, unless the voice
+					// could already report one, an error. That way the callbacks never find the notification queue full.
+					uint32_t needed = m_reservedNotifications + 1U + (state.m_errorReportable ? 0U : 1U);
+					if (m_notifications.GetFreeCount() < needed)
+					{
+						return false;
+					}
+
+					state.m_audioPlayId = command.m_playId;
+					state.m_audioLoopCount = command.m_value;
+					if (!state.m_errorReportable)
+					{
+						state.m_errorReportable = true;
+						++m_reservedNotifications;
+					}
+
+					result = voices.Submit(command.m_voice, command.m_play, command.m_playId);
+					if (result >= 0)
+					{
+						++state.m_pendingBufferEnds;
+						++m_reservedNotifications;
+						result = voices.Start(command.m_voice);
+					}
+				}
+				break;
+
+			case VoiceCommandType::Stop:
+				// Stopping leaves the buffer queued (it would carry on from the same place if the voice was started again) so flush it too.
+				result = voices.Stop(command.m_voice, command.m_value);
+				if (result >= 0)
+				{
+					result = voices.Flush(command.m_voice);
+				}
+				break;
+
+			case VoiceCommandType::SetVolume:
+				result = voices.SetVolume(command.m_voice, command.m_volume);
+				break;
+
+			case VoiceCommandType::Pause:
+				result = voices.Stop(command.m_voice, 0U);
+				break;
+
+			case VoiceCommandType::Resume:
+				result = voices.Start(command.m_voice);
+				break;
+
+			case VoiceCommandType::SetOutput:
+				result = voices.SetOutput(command.m_voice, command);
+				break;
+
+			default:
+				break;
+			}
+
+			if (result < 0)
+			{
+				Notify(VoiceNotificationType::Error, command.m_voice, state.m_audioPlayId, result);
+			}
+
+			return true;
+		}
+
+		// Queues a notification, using up its reservation. Only called on the audio thread. Only one error is reported per play, and a buffer end
+		// that wasn't expected (one from before the voice was forgotten) is dropped.
+		void Notify(
+			VoiceNotificationType type,
+			uint32_t voice,
+			uint32_t playId,
+			int32_t result
+			)
+		{
+			auto& state = m_voices[voice];
+			if (type == VoiceNotificationType::BufferEnd)
+			{
+				if (state.m_pendingBufferEnds == 0)
+				{
+					return;
+				}
+				--state.m_pendingBufferEnds;
+			}
+			else
+			{
+				if (!state.m_errorReportable)
+				{
+					return;
+				}
+				state.m_errorReportable = false;
+			}
+			--m_reservedNotifications;
+
+			VoiceNotification notification;
+			notification.m_type = type;
+			notification.m_voice = voice;
+			notification.m_playId = playId;
+			notification.m_result = result;
+			notification.m_loopCount = state.m_audioLoopCount;
+
+			// There is always room since the notification was reserved when its play was started.
+			m_notifications.TryPush(notification);
+		}
+
+		// The groups.
+		std::vector<Group>							m_groups;
+
+		// Every voice, in group order. Allocated for MaxVoices up front so the audio thread never sees them move.
+		std::unique_ptr<Voice[]>					m_voices;
+
+		// The number of voices in m_voices that belong to a group.
+		uint32_t									m_voiceCount;
+
+		// Counts voice starts so that the oldest voice can be found.
+		uint64_t									m_nextStartOrder;
+
+		// The commands from the game thread to the audio thread.
+		SpscRing<Command>							m_commands;
+
+		// The commands that didn't fit in m_commands, oldest first. Only used on the game thread.
+		std::vector<Command>						m_overflowCommands;
+
+		// The notifications from the audio thread to the game thread.
+		SpscRing<VoiceNotification>					m_notifications;
+
+		// The number of notifications that the voices may still send: their pending buffer ends plus one for each voice that could still report
+		// an error. Only used on the audio thread.
+		uint32_t									m_reservedNotifications;
+	};
+
+	template<class PlayData>
+	const float VoiceScheduler<PlayData>::OutputGainTolerance = 0.001f;
+
+	template<class PlayData>
+	const float VoiceScheduler<PlayData>::FrequencyRatioTolerance = 0.0005f;
+}
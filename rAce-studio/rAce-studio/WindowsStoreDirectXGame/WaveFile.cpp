@@ -0,0 +1,173 @@
+#include "WaveFile.h"
+
+namespace
+{
+	// Builds a little endian four character code.
+	inline uint32_t FourCC(char ch0, char ch1, char ch2, char ch3)
+	{
+		return static_cast<uint32_t>(static_cast<uint8_t>(ch0)) | (static_cast<uint32_t>(static_cast<uint8_t>(ch1)) << 8) |
+			(static_cast<uint32_t>(static_cast<uint8_t>(ch2)) << 16) | (static_cast<uint32_t>(static_cast<uint8_t>(ch3)) << 24);
+	}
+
+	// Reads a little endian 16-bit value. The bytes are assembled one at a time so the pointer does not need to be aligned.
+	inline uint16_t ReadUInt16(const uint8_t* data)
+	{
+		return static_cast<uint16_t>(data[0] | (data[1] << 8));
+	}
+
+	// Reads a little endian 32-bit value. The bytes are assembled one at a time so the pointer does not need to be aligned.
+	inline uint32_t ReadUInt32(const uint8_t* data)
+	{
+		return static_cast<uint32_t>(data[0]) | (static_cast<uint32_t>(data[1]) << 8) | (static_cast<uint32_t>(data[2]) << 16) |
+			(static_cast<uint32_t>(data[3]) << 24);
+	}
+
+	// The size of a chunk header (the four character code and the size).
+	const size_t ChunkHeaderSize = 8;
+
+	// The size of a PCMWAVEFORMAT, the shortest valid 'fmt ' chunk.
+	const uint32_t MinimumFormatSize = 16;
+
+	// The size of the fixed part of a 'smpl' chunk and of each loop in it.
+	const uint32_t SampleChunkHeaderSize = 36;
+	const uint32_t SampleLoopSize = 24;
+}
+
+bool DX::ParseWaveFile(
+	const void* data,
+	size_t size,
+	WaveFileView& result
+	)
+{
+	result = WaveFileView();
+
+	auto bytes = static_cast<const uint8_t*>(data);
+	if (bytes == nullptr || size < 12 || ReadUInt32(bytes) != FourCC('R', 'I', 'F', 'F') || ReadUInt32(bytes + 8) != FourCC('W', 'A', 'V', 'E'))
+	{
+		return false;
+	}
+
+	// The RIFF size counts everything after the size field itself. All of the arithmetic below is done with sizes that have already been checked
+	// against end so none of it can overflow.
+	size_t end = size;
+	if (static_cast<uint64_t>(ReadUInt32(bytes + 4)) + 8 < static_cast<uint64_t>(size))
+	{
+		end = static_cast<size_t>(ReadUInt32(bytes + 4)) + 8;
+		if (end < 12)
+		{
+			return false;
+		}
+	}
+
+	const uint8_t* sampleChunk = nullptr;
+	uint32_t sampleChunkSize = 0;
+
+	size_t offset = 12;
+	while (end - offset >= ChunkHeaderSize)
+	{
+		uint32_t chunkId = ReadUInt32(bytes + offset);
+		uint32_t chunkSize = ReadUInt32(bytes + offset + 4);
+		offset += ChunkHeaderSize;
+
+		if (chunkSize > end - offset)
+		{
+			// A chunk that runs past the end of the file is only harmless if it's one that we ignore.
+			if (chunkId == FourCC('f', 'm', 't', ' ') || chunkId == FourCC('d', 'a', 't', 'a'))
+			{
+				return false;
+			}
+			break;
+		}
+
+		// The first of each chunk wins if a file has more than one.
+		if (chunkId == FourCC('f', 'm', 't', ' ') && result.m_format == nullptr)
+		{
+			result.m_format = bytes + offset;
+			result.m_formatSize = chunkSize;
+		}
+		else if (chunkId == FourCC('d', 'a', 't', 'a') && result.m_audioData == nullptr)
+		{
+			result.m_audioData = bytes + offset;
+			result.m_audioDataSize = chunkSize;
+		}
+		else if (chunkId == FourCC('s', 'm', 'p', 'l') && sampleChunk == nullptr)
+		{
+			sampleChunk = bytes + offset;
+			sampleChunkSize = chunkSize;
+		}
+		else if (chunkId == FourCC('d', 'p', 'd', 's') && result.m_seekTable == nullptr)
+		{
+			result.m_seekTable = bytes + offset;
+			result.m_seekTableCount = chunkSize / sizeof(uint32_t);
+		}
+
+		// Chunks are padded to an even size. The pad byte of the last chunk may be missing.
+		offset += chunkSize;
+		if ((chunkSize & 1) != 0 && offset < end)
+		{
+			++offset;
+		}
+	}
+
+	if (result.m_format == nullptr || result.m_audioData == nullptr || result.m_formatSize < MinimumFormatSize)
+	{
+		return false;
+	}
+
+	result.m_formatTag = ReadUInt16(result.m_format);
+	result.m_channels = ReadUInt16(result.m_format + 2);
+	result.m_samplesPerSecond = ReadUInt32(result.m_format + 4);
+	result.m_blockAlign = ReadUInt16(result.m_format + 12);
+	result.m_bitsPerSample = ReadUInt16(result.m_format + 14);
+
+	if (result.m_channels == 0 || result.m_samplesPerSecond == 0 || result.m_blockAlign == 0)
+	{
+		return false;
+	}
+
+	// Use the first loop from the 'smpl' chunk if there is one. Its end sample is inclusive. A loop that doesn't fit in the data is ignored (or
+	// clamped, see below) rather than treated as an error since the sound can still be played without it.
+	if (sampleChunk != nullptr && sampleChunkSize >= SampleChunkHeaderSize)
+	{
+		uint32_t loopCount = ReadUInt32(sampleChunk + 28);
+		if (loopCount > 0 && sampleChunkSize - SampleChunkHeaderSize >= SampleLoopSize)
+		{
+			uint32_t loopBegin = ReadUInt32(sampleChunk + SampleChunkHeaderSize + 8);
+			uint32_t loopEnd = ReadUInt32(sampleChunk + SampleChunkHeaderSize + 12);
+
+			// Each block holds one sample per channel for PCM, float and extensible formats, and a loop that ends past the data is ignored. ADPCM
+			// packs wSamplesPerBlock samples into each block, so only an upper bound on the samples is known (the last block can be partial) and a
+			// loop that ends past it is clamped to it; the decoder checks it exactly. Other compressed formats (e.g. xWMA) can't be checked here.
+			bool uncompressed = (result.m_formatTag == 1 || result.m_formatTag == 3 || result.m_formatTag == 0xFFFE);
+			uint64_t sampleCount = 0x100000000ULL;
+			if (uncompressed)
+			{
+				sampleCount = result.m_audioDataSize / result.m_blockAlign;
+			}
+			else if ((result.m_formatTag == 2 || result.m_formatTag == 0x11) && result.m_formatSize >= 20)
+			{
+				uint64_t blockCount = (static_cast<uint64_t>(result.m_audioDataSize) + result.m_blockAlign - 1) / result.m_blockAlign;
+				sampleCount = blockCount * ReadUInt16(result.m_format + 18);
+				if (loopEnd >= sampleCount && sampleCount > 0)
+				{
+					loopEnd = static_cast<uint32_t>(sampleCount - 1);
+				}
+			}
+
+			// A loop that ends on sample 0xFFFFFFFF would end at 2^32, and a loop over every sample would have a length of 2^32, which wraps to zero
+			// (no loop). Cut such loops one sample short so that the end fits in 32 bits, the same as SoundBank requires.
+			if (loopEnd == 0xFFFFFFFFU)
+			{
+				loopEnd--;
+			}
+
+			if (loopBegin <= loopEnd && loopEnd < sampleCount)
+			{
+				result.m_loopBegin = loopBegin;
+				result.m_loopLength = loopEnd - loopBegin + 1;
+			}
+		}
+	}
+
+	return true;
+}
@@ -0,0 +1,57 @@
+#pragma once
+
+// Portable (see README_PORTABLE.txt). SoundBankBuilder uses it to read the WAV files that it packs.
+#include <cstddef>
+#include <cstdint>
+
+namespace DX
+{
+	// The parts of a RIFF/WAVE file that are needed to play it. The pointers point into the file's data (normally a MemoryMappedFile view), so
+	// they are only valid for as long as that data is.
+	struct WaveFileView
+	{
+		// The contents of the 'fmt ' chunk (a WAVEFORMATEX or one of its extensions). It is not necessarily aligned. The chunk can be as short as
+		// 16 bytes (a PCMWAVEFORMAT, with no cbSize member) so never read more than m_formatSize bytes from it.
+		const uint8_t*				m_format;
+		// The size of the 'fmt ' chunk in bytes. Always at least 16.
+		uint32_t					m_formatSize;
+		// The contents of the 'data' chunk.
+		const uint8_t*				m_audioData;
+		// The size of the 'data' chunk in bytes.
+		uint32_t					m_audioDataSize;
+		// The first sample of the first loop in the 'smpl' chunk. Only valid if m_loopLength is not zero.
+		uint32_t					m_loopBegin;
+		// The number of samples in the first loop in the 'smpl' chunk, or zero if the file has no loop (or the loop is not inside the data). ADPCM
+		// loops that run past the data are clamped to the last block, and loops in other compressed formats aren't checked against the data.
+		// m_loopBegin + m_loopLength never exceeds 0xFFFFFFFF.
+		uint32_t					m_loopLength;
+		// The contents of the 'dpds' chunk of an xWMA file: m_seekTableCount little endian 32-bit values (the cumulative number of decoded bytes
+		// after each packet). It is not necessarily aligned. nullptr if the file has no 'dpds' chunk.
+		const uint8_t*				m_seekTable;
+		// The number of values in m_seekTable.
+		uint32_t					m_seekTableCount;
+		// The format tag from the 'fmt ' chunk (e.g. 1 for WAVE_FORMAT_PCM).
+		uint16_t					m_formatTag;
+		// The number of channels from the 'fmt ' chunk. Never zero.
+		uint16_t					m_channels;
+		// The sample rate from the 'fmt ' chunk. Never zero.
+		uint32_t					m_samplesPerSecond;
+		// The block alignment from the 'fmt ' chunk. Never zero.
+		uint16_t					m_blockAlign;
+		// The number of bits per sample from the 'fmt ' chunk.
+		uint16_t					m_bitsPerSample;
+	};
+
+	// Parses a RIFF/WAVE file in place. Nothing is copied: the result points into the data. Every read is checked against size so any data can be
+	// passed in safely, including truncated and corrupt files. Chunks other than 'fmt ', 'data', 'smpl' and 'dpds' are skipped. If the RIFF size
+	// in the header is larger than the data (which some tools write) the data size is used instead.
+	// data - The file's data. Does not need to be aligned.
+	// size - The size of the data in bytes.
+	// result - Receives the parsed file. Only valid if the function returns true.
+	// Returns true if the data is a WAVE file with a valid 'fmt ' chunk and a 'data' chunk that both lie within the data.
+	bool ParseWaveFile(
+		const void* data,
+		size_t size,
+		WaveFileView& result
+		);
+}